@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// File: BenchMath.h
+//
+// Desc: Random numbers and matrix construction shared by the headless
+//       benchmark programs in this folder, standing in for the D3DX helpers
+//       the application uses.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _BENCHMATH_H_
+#define _BENCHMATH_H_
+
+//-----------------------------------------------------------------------------
+// BenchMath Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTransform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Name : RandomFloat ()
+// Desc : Random value in the range [Min, Max]
+//-----------------------------------------------------------------------------
+inline float RandomFloat( float Min, float Max )
+{
+    return Min + ((float)rand() / RAND_MAX) * (Max - Min);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildPerspective ()
+// Desc : Equivalent of D3DXMatrixPerspectiveFovLH.
+//-----------------------------------------------------------------------------
+inline void BuildPerspective( float * m, float FOV, float Aspect, float Near, float Far )
+{
+    float YScale = 1.0f / tanf( FOV / 2.0f );
+    memset( m, 0, 16 * sizeof(float) );
+    m[0]  = YScale / Aspect;
+    m[5]  = YScale;
+    m[10] = Far / (Far - Near);
+    m[11] = 1.0f;
+    m[14] = -Near * Far / (Far - Near);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildWorld ()
+// Desc : Rotation about Y then X, followed by a translation.
+//-----------------------------------------------------------------------------
+inline void BuildWorld( float * m, float Yaw, float Pitch, float x, float y, float z )
+{
+    float RotY[16], RotX[16];
+    memset( RotY, 0, sizeof(RotY) ); memset( RotX, 0, sizeof(RotX) );
+    RotY[0] = cosf( Yaw );   RotY[2] = -sinf( Yaw );  RotY[5] = 1.0f;
+    RotY[8] = sinf( Yaw );   RotY[10] = cosf( Yaw );  RotY[15] = 1.0f;
+    RotX[0] = 1.0f;          RotX[5] = cosf( Pitch ); RotX[6] = sinf( Pitch );
+    RotX[9] = -sinf( Pitch ); RotX[10] = cosf( Pitch ); RotX[15] = 1.0f;
+    CTransform::MultiplyMatrix( m, RotY, RotX );
+    m[12] = x; m[13] = y; m[14] = z;
+}
+
+#endif // _BENCHMATH_H_
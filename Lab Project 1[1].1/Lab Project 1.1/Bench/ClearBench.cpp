@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------
+// File: ClearBench.cpp
+//
+// Desc: Headless benchmark for CFrameBuffer clears. Each target size is
+//       cleared repeatedly with:
+//
+//         - the original per pixel loop (reproduced locally),
+//         - the SSE2 fill with ordinary (cached) stores,
+//         - the SSE2 fill with non-temporal (streaming) stores,
+//
+//       and the throughput of each reported, along with the time taken to
+//       clear a typical dirty rectangle. Every clear is checked, including
+//       unaligned rectangles, to make sure no pixel outside of the requested
+//       region is touched.
+//
+// Build: g++ -O2 -msse2 ClearBench.cpp ../Source/CFrameBuffer.cpp -o ClearBench
+//
+// Usage: ClearBench [Iterations]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// ClearBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CFrameBuffer.h"
+#include "BenchTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    struct TARGETSIZE { unsigned long Width, Height; };
+    const TARGETSIZE Sizes[] = { { 400, 400 }, { 1024, 768 }, { 1920, 1080 }, { 3840, 2160 } };
+
+    //-------------------------------------------------------------------------
+    // Name : LegacyClear ()
+    // Desc : The original clear, one pixel at a time
+    //-------------------------------------------------------------------------
+    void LegacyClear( CFrameBuffer & Buffer, unsigned int Color )
+    {
+        for ( unsigned long y = 0; y < Buffer.GetHeight(); y++ )
+        {
+            unsigned int * pRow = Buffer.GetRow( y );
+            for ( unsigned long x = 0; x < Buffer.GetWidth(); x++ ) pRow[x] = Color;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckRect ()
+    // Desc : Verify that exactly the pixels inside the rectangle hold Inside
+    //-------------------------------------------------------------------------
+    bool CheckRect( const CFrameBuffer & Buffer, const CFrameBuffer::DIRTYRECT & Rect, unsigned int Inside, unsigned int Outside )
+    {
+        for ( unsigned long y = 0; y < Buffer.GetHeight(); y++ )
+        {
+            for ( unsigned long x = 0; x < Buffer.GetWidth(); x++ )
+            {
+                bool bInside = (long)x >= Rect.Left && (long)x < Rect.Right && (long)y >= Rect.Top && (long)y < Rect.Bottom;
+                if ( Buffer.GetPixel( x, y ) != (bInside ? Inside : Outside) ) return false;
+            }
+        }
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyClears ()
+    // Desc : Full and partial clears at awkward sizes / alignments
+    //-------------------------------------------------------------------------
+    bool VerifyClears( )
+    {
+        CFrameBuffer Buffer;
+        unsigned int Backing[ 67 * 41 + 1 ];
+
+        // Deliberately misaligned, padded rows
+        Buffer.Attach( Backing + 1, 61, 41, 67 );
+        for ( int Stream = 0; Stream < 2; Stream++ )
+        {
+            Buffer.SetStreamThreshold( Stream ? 0 : 0xFFFFFFFF );
+            for ( int i = 0; i < 200; i++ )
+            {
+                CFrameBuffer::DIRTYRECT Rect;
+                Rect.Left   = rand() % 70 - 5;  Rect.Right  = Rect.Left + rand() % 70;
+                Rect.Top    = rand() % 50 - 5;  Rect.Bottom = Rect.Top  + rand() % 50;
+
+                Buffer.Clear( 0x11111111 );
+                Buffer.ClearRect( Rect, 0x22222222 );
+
+                // Clip the expected rectangle to the buffer
+                if ( Rect.Left < 0 ) Rect.Left = 0;
+                if ( Rect.Top  < 0 ) Rect.Top  = 0;
+                if ( Rect.Right  > 61 ) Rect.Right  = 61;
+                if ( Rect.Bottom > 41 ) Rect.Bottom = 41;
+                if ( !CheckRect( Buffer, Rect, 0x22222222, 0x11111111 ) ) return false;
+
+            } // Next Rectangle
+
+        } // Next Store Type
+
+        // The padding between rows must never be written
+        Buffer.SetStreamThreshold( DEFAULT_STREAM_THRESHOLD );
+        for ( unsigned long y = 0; y < 41; y++ ) for ( unsigned long x = 61; x < 67; x++ ) Backing[ 1 + y * 67 + x ] = 0xDEADBEEF;
+        Buffer.Clear( 0 );
+        for ( unsigned long y = 0; y < 41; y++ ) for ( unsigned long x = 61; x < 67; x++ ) if ( Backing[ 1 + y * 67 + x ] != 0xDEADBEEF ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each clear method at each target size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long Iterations = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 200;
+    bool          bPassed    = VerifyClears();
+
+    if ( !bPassed ) printf( "FAILED : clear touched pixels outside of its rectangle\n" );
+
+#if !defined(FRAMEBUFFER_SSE)
+    printf( "Note : SSE2 fill not compiled in, the scalar fill is used for all methods\n" );
+#endif
+
+    printf( "Clear throughput (GB/s, %lu clears each)\n\n", Iterations );
+    printf( "      Size       Legacy       Cached     Streamed     Dirty 1/4 area (ms)\n" );
+
+    for ( unsigned long s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); s++ )
+    {
+        CFrameBuffer Buffer;
+        CBenchTimer  Timer;
+        double       Bytes, fLegacy, fCached, fStreamed, fDirty;
+        CFrameBuffer::DIRTYRECT Rect;
+
+        if ( !Buffer.Create( Sizes[s].Width, Sizes[s].Height ) ) { printf( "Allocation failed\n" ); return 1; }
+        Bytes = (double)Sizes[s].Width * Sizes[s].Height * sizeof(unsigned int) * Iterations;
+
+        // Original loop
+        Timer.Reset();
+        for ( unsigned long i = 0; i < Iterations; i++ ) LegacyClear( Buffer, i );
+        fLegacy = Timer.Elapsed();
+
+        // Cached stores
+        Buffer.SetStreamThreshold( 0xFFFFFFFF );
+        Timer.Reset();
+        for ( unsigned long i = 0; i < Iterations; i++ ) Buffer.Clear( i );
+        fCached = Timer.Elapsed();
+
+        // Streaming stores
+        Buffer.SetStreamThreshold( 0 );
+        Timer.Reset();
+        for ( unsigned long i = 0; i < Iterations; i++ ) Buffer.Clear( i );
+        fStreamed = Timer.Elapsed();
+
+        // A centred rectangle covering a quarter of the target, with the default threshold
+        Buffer.SetStreamThreshold( DEFAULT_STREAM_THRESHOLD );
+        Rect.Left  = Sizes[s].Width / 4;  Rect.Right  = Rect.Left + Sizes[s].Width / 2;
+        Rect.Top   = Sizes[s].Height / 4; Rect.Bottom = Rect.Top  + Sizes[s].Height / 2;
+        Timer.Reset();
+        for ( unsigned long i = 0; i < Iterations; i++ ) Buffer.ClearRect( Rect, i );
+        fDirty = Timer.Elapsed();
+
+        printf( "%5lux%-5lu %12.2f %12.2f %12.2f %12.4f\n", Sizes[s].Width, Sizes[s].Height,
+                Bytes / fLegacy / 1e9, Bytes / fCached / 1e9, Bytes / fStreamed / 1e9, fDirty * 1000.0 / Iterations );
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
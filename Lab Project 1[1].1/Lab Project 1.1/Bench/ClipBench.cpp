@@ -0,0 +1,276 @@
+//-----------------------------------------------------------------------------
+// File: ClipBench.cpp
+//
+// Desc: Headless benchmark for the clip space stage. A dense field of cubes
+//       surrounds the camera (so many lie behind it, to the sides, or cut
+//       through the near plane) and is rendered with the tile renderer:
+//
+//         - without a clip stage (every face projected and submitted, as
+//           DrawPrimitive originally did),
+//         - through CClipper with culling disabled,
+//         - through CClipper with back face culling.
+//
+//       The number of polygons removed by each stage, the triangles that
+//       reach the binner and the time spent are reported for each. A few
+//       sanity checks on winding and near plane clipping are also run.
+//
+// Build: g++ -O2 -msse2 ClipBench.cpp ../Source/CClipper.cpp ../Source/CTransform.cpp ../Source/CTileRenderer.cpp
+//            ../Source/CThreadPool.cpp ../Source/CFrameBuffer.cpp ../Source/CProfiler.cpp -lpthread -o ClipBench
+//
+// Usage: ClipBench [CubeCount] [Frames] [Width] [Height]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// ClipBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CClipper.h"
+#include "../Includes/CTileRenderer.h"
+#include "BenchTimer.h"
+#include "BenchMath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    // Welded cube (as produced by CIndexedMesh::BuildFromMesh for the demo cube)
+    const float CubeVertices[8 * 3] =
+    {
+        -2,  2, -2,    2,  2, -2,    2, -2, -2,   -2, -2, -2,
+        -2,  2,  2,    2,  2,  2,   -2, -2,  2,    2, -2,  2
+    };
+    const unsigned long CubeIndices[6 * 4] =
+    {
+        0, 1, 2, 3,   4, 5, 1, 0,   6, 7, 5, 4,
+        3, 2, 7, 6,   4, 0, 3, 6,   1, 5, 7, 2
+    };
+    const unsigned int FaceColors[6] =
+    {
+        0x00C04040, 0x0040C040, 0x004040C0, 0x00C0C040, 0x00C040C0, 0x0040C0C0
+    };
+
+    enum MODE { MODE_NOCLIP, MODE_CLIP, MODE_CLIPCULL, MODE_COUNT };
+    const char * ModeNames[] = { "No clip stage", "Clip", "Clip + cull" };
+
+    struct CUBE { float mtxWorld[16]; };
+
+    //-------------------------------------------------------------------------
+    // Name : CheckClipper ()
+    // Desc : Winding and near plane sanity checks.
+    //-------------------------------------------------------------------------
+    bool CheckClipper( const float * mtxViewProj, float Width, float Height )
+    {
+        float         mtxWorld[16], mtxCombined[16];
+        CTransform    Transform;
+        CClipper      Clipper;
+        unsigned long Count, f, i;
+
+        Clipper.SetViewport( 0, 0, Width, Height );
+        Clipper.SetCullMode( CClipper::CULL_CCW );
+
+        // A cube straight ahead : its front face (0) must survive, its back face (2) must not
+        BuildWorld( mtxWorld, 0, 0, 0, 0, 14.0f );
+        CTransform::MultiplyMatrix( mtxCombined, mtxWorld, mtxViewProj );
+        Transform.SetMatrix( mtxCombined );
+        Clipper.ProcessVertices( Transform, CubeVertices, 8 );
+        if ( Clipper.ClipPolygon( &CubeIndices[0], 4 ) != 4 ) { printf( "FAILED : front face culled\n" ); return false; }
+        if ( Clipper.ClipPolygon( &CubeIndices[8], 4 ) != 0 ) { printf( "FAILED : back face not culled\n" ); return false; }
+
+        // A cube straddling the near plane : every output vertex must be in front of it
+        Clipper.SetCullMode( CClipper::CULL_NONE );
+        for ( i = 0; i < 1000; i++ )
+        {
+            BuildWorld( mtxWorld, RandomFloat( 0, 6.28f ), RandomFloat( 0, 6.28f ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1.0f, 3.0f ) );
+            CTransform::MultiplyMatrix( mtxCombined, mtxWorld, mtxViewProj );
+            Transform.SetMatrix( mtxCombined );
+            Clipper.ProcessVertices( Transform, CubeVertices, 8 );
+
+            for ( f = 0; f < 6; f++ )
+            {
+                Count = Clipper.ClipPolygon( &CubeIndices[ f * 4 ], 4 );
+                for ( unsigned long v = 0; v < Count; v++ )
+                {
+                    const float * pVertex = &Clipper.GetClippedVertices()[ v * 3 ];
+                    if ( !(pVertex[2] >= -1e-5f) || !(fabsf( pVertex[0] ) < 1e6f) || !(fabsf( pVertex[1] ) < 1e6f) )
+                    {
+                        printf( "FAILED : clipped vertex (%g, %g, %g) lies behind the near plane\n", pVertex[0], pVertex[1], pVertex[2] );
+                        return false;
+
+                    } // End if behind
+
+                } // Next Vertex
+
+            } // Next Face
+
+        } // Next Cube
+
+        // A concave comb whose every edge crosses the near plane : clipping
+        // adds an intersection per edge, half as many vertices again
+        {
+            const unsigned long Teeth = 8;
+            float         Identity[16], Comb[ Teeth * 2 * 3 ];
+            unsigned long CombIndices[ Teeth * 2 ];
+            CClipper      CombClipper;
+
+            memset( Identity, 0, sizeof(Identity) );
+            Identity[0] = Identity[5] = Identity[10] = Identity[15] = 1.0f;
+            for ( i = 0; i < Teeth * 2; i++ )
+            {
+                Comb[ i * 3     ] = -0.5f + (float)i / (float)(Teeth * 2);
+                Comb[ i * 3 + 1 ] = 0.0f;
+                Comb[ i * 3 + 2 ] = (i & 1) ? -1.0f : 1.0f;
+                CombIndices[i]    = i;
+
+            } // Next Vertex
+
+            CombClipper.SetViewport( 0, 0, Width, Height );
+            CombClipper.SetCullMode( CClipper::CULL_NONE );
+            Transform.SetMatrix( Identity );
+            CombClipper.ProcessVertices( Transform, Comb, Teeth * 2 );
+            Count = CombClipper.ClipPolygon( CombIndices, Teeth * 2 );
+            if ( Count != Teeth * 3 ) { printf( "FAILED : concave polygon clipped to %lu vertices, expected %lu\n", Count, Teeth * 3 ); return false; }
+            for ( i = 0; i < Count; i++ )
+            {
+                if ( !(CombClipper.GetClippedVertices()[ i * 3 + 2 ] >= -1e-5f) ) { printf( "FAILED : concave polygon vertex behind the near plane\n" ); return false; }
+
+            } // Next Vertex
+        }
+
+        return true;
+    }
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Renders the same surrounding cube field through each path.
+//-----------------------------------------------------------------------------
+int main( int argc, char ** argv )
+{
+    unsigned long CubeCount = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : 20000;
+    unsigned long Frames    = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : 10;
+    unsigned long Width     = (argc > 3) ? strtoul( argv[3], NULL, 10 ) : 1024;
+    unsigned long Height    = (argc > 4) ? strtoul( argv[4], NULL, 10 ) : 768;
+    float         mtxProj[16], mtxViewport[16], mtxViewProj[16], mtxCombined[16];
+    float         x[8], y[8], z[8];
+    unsigned long i, f, v, Frame, Count;
+    bool          Failed = false;
+
+    // Scatter the cubes all around the camera
+    CUBE * pCubes = new CUBE[ CubeCount ];
+    srand( 1 );
+    for ( i = 0; i < CubeCount; i++ )
+    {
+        BuildWorld( pCubes[i].mtxWorld, RandomFloat( 0, 6.28f ), RandomFloat( 0, 6.28f ),
+                    RandomFloat( -150, 150 ), RandomFloat( -150, 150 ), RandomFloat( -150, 150 ) );
+
+    } // Next Cube
+
+    // Same projection as the demo (the view matrix is identity)
+    BuildPerspective( mtxProj, 60.0f * 3.14159265f / 180.0f, (float)Width / (float)Height, 1.01f, 1000.0f );
+    CTransform::BuildViewportMatrix( mtxViewport, 0.0f, 0.0f, (float)Width, (float)Height );
+    CTransform::MultiplyMatrix( mtxViewProj, mtxProj, mtxViewport );
+
+    CFrameBuffer  FrameBuffer;
+    CTileRenderer Renderer;
+    CThreadPool   Pool;
+    CTransform    Transform;
+    CClipper      Clipper;
+    FrameBuffer.Create( Width, Height );
+    Renderer.SetRenderTarget( &FrameBuffer );
+    Pool.Create();
+    Clipper.SetViewport( 0.0f, 0.0f, (float)Width, (float)Height );
+
+    printf( "Clip stage benchmark : %lu cubes (%lu polygons) surrounding the camera, %lux%lu, %lu frames, %lu thread(s)\n\n",
+            CubeCount, CubeCount * 6, Width, Height, Frames, Pool.GetThreadCount() );
+    printf( "  %-14s %9s %9s %9s %9s %10s %10s %10s\n", "Mode", "Rejected", "NearClip", "Culled", "Drawn", "Triangles", "Setup", "Raster" );
+
+    for ( int Mode = 0; Mode < MODE_COUNT; Mode++ )
+    {
+        double      SetupTime = 0.0, RasterTime = 0.0;
+        CBenchTimer Timer;
+
+        Clipper.SetCullMode( (Mode == MODE_CLIPCULL) ? CClipper::CULL_CCW : CClipper::CULL_NONE );
+
+        for ( Frame = 0; Frame < Frames; Frame++ )
+        {
+            FrameBuffer.Clear( 0x00FFFFFF );
+            Clipper.ResetStatistics();
+
+            // Transform, clip and bin
+            Timer.Reset();
+            Renderer.BeginFrame();
+            for ( i = 0; i < CubeCount; i++ )
+            {
+                CTransform::MultiplyMatrix( mtxCombined, pCubes[i].mtxWorld, mtxViewProj );
+                Transform.SetMatrix( mtxCombined );
+
+                if ( Mode == MODE_NOCLIP )
+                {
+                    // Project everything and submit every face
+                    Transform.TransformVertices( CubeVertices, 8, x, y, z );
+                    for ( f = 0; f < 6; f++ )
+                    {
+                        const unsigned long * pFace = &CubeIndices[ f * 4 ];
+                        for ( v = 1; v + 1 < 4; v++ )
+                        {
+                            float v0[3] = { x[pFace[0]], y[pFace[0]], z[pFace[0]] };
+                            float v1[3] = { x[pFace[v]], y[pFace[v]], z[pFace[v]] };
+                            float v2[3] = { x[pFace[v + 1]], y[pFace[v + 1]], z[pFace[v + 1]] };
+                            Renderer.DrawTriangle( v0, v1, v2, FaceColors[f] );
+
+                        } // Next Triangle
+
+                    } // Next Face
+                }
+                else
+                {
+                    // Run every face through the clip stage
+                    Clipper.ProcessVertices( Transform, CubeVertices, 8 );
+                    for ( f = 0; f < 6; f++ )
+                    {
+                        Count = Clipper.ClipPolygon( &CubeIndices[ f * 4 ], 4 );
+                        const float * pVertex = Clipper.GetClippedVertices();
+                        for ( v = 1; v + 1 < Count; v++ )
+                            Renderer.DrawTriangle( &pVertex[0], &pVertex[ v * 3 ], &pVertex[ (v + 1) * 3 ], FaceColors[f] );
+
+                    } // Next Face
+
+                } // End if mode
+
+            } // Next Cube
+            SetupTime += Timer.Elapsed();
+
+            // Rasterize
+            Timer.Reset();
+            Renderer.EndFrame( &Pool );
+            RasterTime += Timer.Elapsed();
+
+        } // Next Frame
+
+        const CClipper::STATISTICS & Stats = Clipper.GetStatistics();
+        printf( "  %-14s %9lu %9lu %9lu %9lu %10lu %7.2f ms %7.2f ms\n", ModeNames[Mode],
+                Stats.FrustumRejected, Stats.NearClipped, Stats.BackFaceCulled,
+                (Mode == MODE_NOCLIP) ? CubeCount * 6 : Stats.Accepted, Renderer.GetTriangleCount(),
+                SetupTime * 1e3 / Frames, RasterTime * 1e3 / Frames );
+
+    } // Next Mode
+
+    printf( "\n  (the unclipped path also rasterizes cubes behind the camera, projected through the eye)\n" );
+
+    // Sanity checks
+    if ( !CheckClipper( mtxViewProj, (float)Width, (float)Height ) ) Failed = true;
+    if ( !Failed ) printf( "\nWinding and near plane clipping verified.\n" );
+
+    // Clean up
+    Renderer.Release();
+    FrameBuffer.Release();
+    delete []pCubes;
+    return Failed ? 1 : 0;
+}
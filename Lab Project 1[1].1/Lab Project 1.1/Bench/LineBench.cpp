@@ -0,0 +1,156 @@
+//-----------------------------------------------------------------------------
+// File: LineBench.cpp
+//
+// Desc: Headless benchmark for the direct-to-memory line rasterizer. Draws
+//       batches of horizontal, vertical, diagonal, general and heavily
+//       clipped lines and reports throughput for each. The frame buffer is
+//       surrounded by a guard band which is checked afterwards to make sure
+//       clipping never allows a write outside of the target.
+//
+// Build: g++ -O2 LineBench.cpp ../Source/CFrameBuffer.cpp ../Source/CRasterizer.cpp -o LineBench
+//
+// Usage: LineBench [LineCount] [Width] [Height]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// LineBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CFrameBuffer.h"
+#include "../Includes/CRasterizer.h"
+#include "BenchTimer.h"
+#include "BenchMath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const unsigned long GuardSize  = 16;            // Guard band around the target (pixels)
+    const unsigned int  GuardColor = 0xDEADBEEF;    // Value stored in the guard band
+
+    enum LINE_TYPE { LINE_HORIZONTAL, LINE_VERTICAL, LINE_DIAGONAL, LINE_GENERAL, LINE_CLIPPED, LINE_TYPE_COUNT };
+    const char * LineTypeNames[] = { "Horizontal", "Vertical", "Diagonal", "General", "Clipped" };
+
+    //-------------------------------------------------------------------------
+    // Name : GenerateLines ()
+    // Desc : Fill the array with end points for the specified type of line.
+    //-------------------------------------------------------------------------
+    void GenerateLines( float * pLines, unsigned long Count, LINE_TYPE Type, float Width, float Height )
+    {
+        for ( unsigned long i = 0; i < Count; i++, pLines += 4 )
+        {
+            float x = RandomFloat( 0, Width - 1 ), y = RandomFloat( 0, Height - 1 );
+            float Length = RandomFloat( 10, 200 );
+
+            switch ( Type )
+            {
+                case LINE_HORIZONTAL: pLines[0] = x; pLines[1] = y; pLines[2] = x + Length; pLines[3] = y; break;
+                case LINE_VERTICAL:   pLines[0] = x; pLines[1] = y; pLines[2] = x; pLines[3] = y + Length; break;
+                case LINE_DIAGONAL:   pLines[0] = (float)(long)x; pLines[1] = (float)(long)y;
+                                      pLines[2] = pLines[0] + (float)(long)Length; pLines[3] = pLines[1] - (float)(long)Length; break;
+                case LINE_GENERAL:    pLines[0] = x; pLines[1] = y;
+                                      pLines[2] = RandomFloat( 0, Width - 1 ); pLines[3] = RandomFloat( 0, Height - 1 ); break;
+                default:              pLines[0] = RandomFloat( -Width * 4, Width * 5 ); pLines[1] = RandomFloat( -Height * 4, Height * 5 );
+                                      pLines[2] = RandomFloat( -Width * 4, Width * 5 ); pLines[3] = RandomFloat( -Height * 4, Height * 5 ); break;
+
+            } // End Switch
+
+        } // Next Line
+    }
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Runs each line type through the rasterizer.
+//-----------------------------------------------------------------------------
+int main( int argc, char ** argv )
+{
+    unsigned long LineCount = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : 200000;
+    unsigned long Width     = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : 1024;
+    unsigned long Height    = (argc > 3) ? strtoul( argv[3], NULL, 10 ) : 768;
+    unsigned long OuterPitch = Width + GuardSize * 2, i, x, y;
+    bool          Failed = false;
+
+    // Allocate the guarded memory and wrap the inner region
+    unsigned int * pMemory = new unsigned int[ OuterPitch * (Height + GuardSize * 2) ];
+    for ( i = 0; i < OuterPitch * (Height + GuardSize * 2); i++ ) pMemory[i] = GuardColor;
+
+    CFrameBuffer FrameBuffer;
+    FrameBuffer.Attach( pMemory + GuardSize + GuardSize * OuterPitch, Width, Height, OuterPitch );
+
+    CRasterizer Rasterizer;
+    Rasterizer.SetRenderTarget( &FrameBuffer );
+
+    float * pLines = new float[ LineCount * 4 ];
+    srand( 1 );
+
+    printf( "Line rasterizer benchmark : %lu lines per type, %lux%lu target\n\n", LineCount, Width, Height );
+
+    for ( int Type = 0; Type < LINE_TYPE_COUNT; Type++ )
+    {
+        GenerateLines( pLines, LineCount, (LINE_TYPE)Type, (float)Width, (float)Height );
+        FrameBuffer.Clear( 0x00FFFFFF );
+
+        CBenchTimer Timer;
+        for ( i = 0; i < LineCount; i++ )
+        {
+            const float * pLine = &pLines[i * 4];
+            Rasterizer.DrawLine( pLine[0], pLine[1], pLine[2], pLine[3], (unsigned int)i );
+
+        } // Next Line
+        double Seconds = Timer.Elapsed();
+
+        printf( "  %-10s %8.1f ns/line  %8.2f Mlines/s\n", LineTypeNames[Type],
+                Seconds * 1e9 / LineCount, LineCount / Seconds / 1e6 );
+
+    } // Next Type
+
+    // Check that the end points of unclipped general lines are hit exactly
+    GenerateLines( pLines, 1000, LINE_GENERAL, (float)Width, (float)Height );
+    for ( i = 0; i < 1000; i++ )
+    {
+        const float * pLine = &pLines[i * 4];
+        FrameBuffer.Clear( 0 );
+        Rasterizer.DrawLine( pLine[0], pLine[1], pLine[2], pLine[3], 1 );
+        if ( FrameBuffer.GetPixel( (long)pLine[0], (long)pLine[1] ) != 1 || FrameBuffer.GetPixel( (long)pLine[2], (long)pLine[3] ) != 1 )
+        {
+            printf( "\nFAILED : end point missed for line (%g,%g)-(%g,%g)\n", pLine[0], pLine[1], pLine[2], pLine[3] );
+            Failed = true;
+            break;
+
+        } // End if missed
+
+    } // Next Line
+
+    // Verify the guard band is intact
+    for ( y = 0; y < Height + GuardSize * 2 && !Failed; y++ )
+    {
+        for ( x = 0; x < OuterPitch; x++ )
+        {
+            bool Inside = (x >= GuardSize && x < GuardSize + Width && y >= GuardSize && y < GuardSize + Height);
+            if ( !Inside && pMemory[ x + y * OuterPitch ] != GuardColor )
+            {
+                printf( "\nFAILED : write outside of target at (%ld,%ld)\n", (long)x - (long)GuardSize, (long)y - (long)GuardSize );
+                Failed = true;
+                break;
+
+            } // End if overwritten
+
+        } // Next Column
+
+    } // Next Row
+
+    if ( !Failed ) printf( "\nEnd points and clipping guard band verified.\n" );
+
+    // Clean up
+    FrameBuffer.Release();
+    delete []pMemory;
+    delete []pLines;
+    return Failed ? 1 : 0;
+}
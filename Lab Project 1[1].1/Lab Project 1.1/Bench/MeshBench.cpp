@@ -0,0 +1,315 @@
+//-----------------------------------------------------------------------------
+// File: MeshBench.cpp
+//
+// Desc: Headless load benchmark for CMesh. Builds grids of quads one polygon
+//       at a time (AddPolygon followed by AddVertex, as a file loader would)
+//       and reports the time taken by:
+//
+//         - the original storage scheme (every AddPolygon / AddVertex call
+//           reallocating and copying its array, and each polygon / vertex
+//           array allocated separately), reproduced locally,
+//         - the pooled CMesh, growing on demand,
+//         - the pooled CMesh with its final size reserved up front.
+//
+//       The original scheme is quadratic, so it is only run on the smaller
+//       sizes. For the largest mesh (1M polygons by default) the time taken
+//       to walk every vertex, and to build the indexed mesh, is also given.
+//       The contents of every pooled mesh are verified after building.
+//
+// Build: g++ -O2 MeshBench.cpp ../Source/CObject.cpp -o MeshBench
+//
+// Usage: MeshBench [PolygonCount] [LegacyMaxPolygons]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// MeshBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CObject.h"
+#include "BenchTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Classes, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : CLegacyPolygon (Class)
+    // Desc : The original polygon storage, every AddVertex reallocates.
+    //-------------------------------------------------------------------------
+    class CLegacyPolygon
+    {
+    public:
+        CLegacyPolygon() { m_nVertexCount = 0; m_pVertex = NULL; }
+       ~CLegacyPolygon() { delete []m_pVertex; }
+
+        long AddVertex( USHORT Count )
+        {
+            CVertex * pVertexBuffer = new CVertex[ m_nVertexCount + Count ];
+            if ( m_pVertex ) { memcpy( pVertexBuffer, m_pVertex, m_nVertexCount * sizeof(CVertex) ); delete []m_pVertex; }
+            m_pVertex = pVertexBuffer;
+            m_nVertexCount += Count;
+            return m_nVertexCount - Count;
+        }
+
+        USHORT      m_nVertexCount;
+        CVertex    *m_pVertex;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : CLegacyMesh (Class)
+    // Desc : The original mesh storage, every AddPolygon reallocates the
+    //        pointer array and each polygon is allocated separately.
+    //-------------------------------------------------------------------------
+    class CLegacyMesh
+    {
+    public:
+        CLegacyMesh() { m_nPolygonCount = 0; m_pPolygon = NULL; }
+       ~CLegacyMesh()
+        {
+            for ( ULONG i = 0; i < m_nPolygonCount; i++ ) delete m_pPolygon[i];
+            delete []m_pPolygon;
+        }
+
+        long AddPolygon( ULONG Count )
+        {
+            CLegacyPolygon ** pPolyBuffer = new CLegacyPolygon*[ m_nPolygonCount + Count ];
+            if ( m_pPolygon ) { memcpy( pPolyBuffer, m_pPolygon, m_nPolygonCount * sizeof(CLegacyPolygon*) ); delete []m_pPolygon; }
+            m_pPolygon = pPolyBuffer;
+            for ( ULONG i = 0; i < Count; i++ ) m_pPolygon[ m_nPolygonCount++ ] = new CLegacyPolygon();
+            return m_nPolygonCount - Count;
+        }
+
+        bool Reserve( ULONG, ULONG ) { return true; }
+
+        ULONG            m_nPolygonCount;
+        CLegacyPolygon **m_pPolygon;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : GridSide ()
+    // Desc : Number of quads along each side of the grid used for a mesh
+    //-------------------------------------------------------------------------
+    ULONG GridSide( ULONG PolygonCount )
+    {
+        ULONG Side = (ULONG)sqrt( (double)PolygonCount );
+        while ( Side * Side < PolygonCount ) Side++;
+        return Side;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : QuadVertex ()
+    // Desc : Position of corner c of quad p in a grid of the specified side
+    //-------------------------------------------------------------------------
+    CVertex QuadVertex( ULONG p, ULONG c, ULONG Side )
+    {
+        static const ULONG Corner[4][2] = { {0,1}, {1,1}, {1,0}, {0,0} };
+        return CVertex( (float)(p % Side + Corner[c][0]), 0.0f, (float)(p / Side + Corner[c][1]) );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BuildGrid ()
+    // Desc : Add the quads one at a time, as a loader would. Returns seconds.
+    //-------------------------------------------------------------------------
+    template <class MESH> double BuildGrid( MESH & Mesh, ULONG PolygonCount, bool bReserve )
+    {
+        ULONG       Side = GridSide( PolygonCount );
+        CBenchTimer Timer;
+
+        if ( bReserve ) Mesh.Reserve( PolygonCount, PolygonCount * 4 );
+        for ( ULONG p = 0; p < PolygonCount; p++ )
+        {
+            long Poly = Mesh.AddPolygon( 1 );
+            if ( Poly < 0 || Mesh.m_pPolygon[ Poly ]->AddVertex( 4 ) < 0 ) { printf( "Allocation failed\n" ); exit( 1 ); }
+            for ( ULONG c = 0; c < 4; c++ ) Mesh.m_pPolygon[ Poly ]->m_pVertex[ c ] = QuadVertex( p, c, Side );
+
+        } // Next Polygon
+
+        return Timer.Elapsed();
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SumVertices ()
+    // Desc : Walk every vertex through the m_pPolygon[i]->m_pVertex[j] pattern
+    //-------------------------------------------------------------------------
+    template <class MESH> double SumVertices( const MESH & Mesh, double & Sum )
+    {
+        CBenchTimer Timer;
+
+        Sum = 0.0;
+        for ( ULONG i = 0; i < Mesh.m_nPolygonCount; i++ )
+        {
+            for ( ULONG j = 0; j < Mesh.m_pPolygon[i]->m_nVertexCount; j++ )
+                Sum += Mesh.m_pPolygon[i]->m_pVertex[j].x + Mesh.m_pPolygon[i]->m_pVertex[j].z;
+
+        } // Next Polygon
+
+        return Timer.Elapsed();
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyGrid ()
+    // Desc : Check that every vertex of a built grid is where it should be
+    //-------------------------------------------------------------------------
+    bool VerifyGrid( const CMesh & Mesh, ULONG PolygonCount )
+    {
+        ULONG Side = GridSide( PolygonCount );
+
+        if ( Mesh.m_nPolygonCount != PolygonCount ) return false;
+        for ( ULONG p = 0; p < PolygonCount; p++ )
+        {
+            const CPolygon * pPoly = Mesh.m_pPolygon[p];
+            if ( pPoly->m_nVertexCount != 4 || pPoly->m_pVertex != Mesh.m_pVertex + pPoly->m_nFirstVertex ) return false;
+            for ( ULONG c = 0; c < 4; c++ )
+            {
+                CVertex Expected = QuadVertex( p, c, Side );
+                if ( memcmp( &pPoly->m_pVertex[c], &Expected, sizeof(CVertex) ) != 0 ) return false;
+
+            } // Next Corner
+
+        } // Next Polygon
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyRelocation ()
+    // Desc : Adding vertices to a polygon which is not at the end of the pool
+    //        must move it without disturbing any other polygon.
+    //-------------------------------------------------------------------------
+    bool VerifyRelocation( )
+    {
+        CMesh    Mesh( 3 );
+        CPolygon Standalone;
+        ULONG    p, v;
+
+        // Give every polygon two vertices, then grow the first and second again
+        for ( p = 0; p < 3; p++ ) Mesh.m_pPolygon[p]->AddVertex( 2 );
+        for ( p = 0; p < 3; p++ ) for ( v = 0; v < 2; v++ ) Mesh.m_pPolygon[p]->m_pVertex[v] = CVertex( (float)p, (float)v, 0.0f );
+        if ( Mesh.m_pPolygon[0]->AddVertex( 40 ) != 2 ) return false;
+        if ( Mesh.m_pPolygon[1]->AddVertex( 3 ) != 2 ) return false;
+        if ( Mesh.AddPolygon( 100 ) != 3 ) return false;
+
+        // Check the original vertices survived, and the new ones were cleared
+        for ( p = 0; p < 3; p++ )
+        {
+            CPolygon * pPoly = Mesh.m_pPolygon[p];
+            for ( v = 0; v < pPoly->m_nVertexCount; v++ )
+            {
+                float x = ( v < 2 ) ? (float)p : 0.0f, y = ( v < 2 ) ? (float)v : 0.0f;
+                if ( pPoly->m_pVertex[v].x != x || pPoly->m_pVertex[v].y != y ) return false;
+
+            } // Next Vertex
+
+        } // Next Polygon
+        if ( Mesh.m_pPolygon[0]->m_nVertexCount != 42 || Mesh.m_pPolygon[1]->m_nVertexCount != 5 ) return false;
+
+        // Stand alone polygons still own their own (geometrically grown) array
+        for ( v = 0; v < 100; v++ ) { Standalone.AddVertex( 1 ); Standalone.m_pVertex[v] = CVertex( (float)v, 0, 0 ); }
+        for ( v = 0; v < 100; v++ ) if ( Standalone.m_pVertex[v].x != (float)v ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Run each build scheme at increasing sizes and report the results.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    ULONG   PolygonCount = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    ULONG   LegacyMax    = ( argc > 2 ) ? strtoul( argv[2], NULL, 10 ) : 32768;
+    ULONG   Count;
+    bool    bPassed = true;
+    double  LegacySum = 0.0, PooledSum = 0.0;
+
+    // Sanity check span relocation first
+    if ( !VerifyRelocation() ) { printf( "FAILED : polygon span relocation\n" ); bPassed = false; }
+
+    printf( "Incremental build, AddPolygon( 1 ) + AddVertex( 4 ) per quad (ms)\n\n" );
+    printf( "  Polygons       Legacy       Pooled     Reserved\n" );
+
+    // Double the size each time, finishing on the requested count
+    for ( Count = 4096; ; Count = ( Count * 2 < PolygonCount ) ? Count * 2 : PolygonCount )
+    {
+        CMesh  Pooled, Reserved;
+        double fPooled, fReserved;
+
+        if ( Count > PolygonCount ) Count = PolygonCount;
+        printf( "%10lu ", Count );
+
+        // The original scheme, while it is still practical
+        if ( Count <= LegacyMax )
+        {
+            CLegacyMesh Legacy;
+            printf( "%12.2f ", BuildGrid( Legacy, Count, false ) * 1000.0 );
+
+        } // End if legacy
+        else printf( "%12s ", "-" );
+
+        fPooled   = BuildGrid( Pooled, Count, false );
+        fReserved = BuildGrid( Reserved, Count, true );
+        printf( "%12.2f %12.2f\n", fPooled * 1000.0, fReserved * 1000.0 );
+
+        // Check the contents
+        if ( !VerifyGrid( Pooled, Count ) || !VerifyGrid( Reserved, Count ) )
+        {
+            printf( "FAILED : mesh contents incorrect at %lu polygons\n", Count );
+            bPassed = false;
+
+        } // End if failed
+
+        if ( Count >= PolygonCount ) break;
+
+    } // Next Size
+
+    // Traversal and indexed mesh build at the final size
+    {
+        CMesh        Pooled;
+        CIndexedMesh Indexed;
+        CBenchTimer  Timer;
+        ULONG        Side = GridSide( PolygonCount );
+        double       fWalk, fIndexed;
+
+        BuildGrid( Pooled, PolygonCount, false );
+        fWalk = SumVertices( Pooled, PooledSum );
+        Timer.Reset();
+        if ( !Indexed.BuildFromMesh( &Pooled ) ) { printf( "FAILED : BuildFromMesh\n" ); bPassed = false; }
+        fIndexed = Timer.Elapsed();
+
+        printf( "\n%lu polygons : vertex walk %.2f ms, BuildFromMesh %.2f ms (%lu unique vertices)\n",
+                PolygonCount, fWalk * 1000.0, fIndexed * 1000.0, Indexed.m_nVertexCount );
+        printf( "Pool : %lu vertices (%.1f MB)\n", Pooled.m_nVertexCount, Pooled.m_nVertexCount * sizeof(CVertex) / (1024.0 * 1024.0) );
+
+        // Every grid point should be shared by the quads around it (the last row may be partial)
+        if ( Indexed.m_nVertexCount > (Side + 1) * (Side + 1) ) { printf( "FAILED : vertices not welded\n" ); bPassed = false; }
+
+    } // End final size
+
+    // Compare walks at the largest size the original scheme was run at
+    if ( LegacyMax > 0 )
+    {
+        CLegacyMesh Legacy;
+        CMesh       Pooled;
+        ULONG       Size = ( LegacyMax < PolygonCount ) ? LegacyMax : PolygonCount;
+        double      fLegacy, fPooled;
+
+        BuildGrid( Legacy, Size, false );
+        BuildGrid( Pooled, Size, false );
+        fLegacy = SumVertices( Legacy, LegacySum );
+        fPooled = SumVertices( Pooled, PooledSum );
+        printf( "Vertex walk at %lu polygons : legacy %.3f ms, pooled %.3f ms\n", Size, fLegacy * 1000.0, fPooled * 1000.0 );
+        if ( LegacySum != PooledSum ) { printf( "FAILED : walk results differ\n" ); bPassed = false; }
+
+    } // End if legacy comparison
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+//-----------------------------------------------------------------------------
+// File: PacingBench.cpp
+//
+// Desc: Headless benchmark for the CTimer frame rate lock. A fixed amount of
+//       simulated work is done each frame, and the frame rate locked with
+//       both pacing modes:
+//
+//         - PACING_SPIN   : the original busy wait for the whole frame,
+//         - PACING_HYBRID : sleep until shortly before the deadline, then
+//                           spin for the final slice only,
+//
+//       reporting the processor time each consumed alongside the achieved
+//       frame period, deadline misses and wake-up jitter. Both modes are
+//       checked to hold the requested rate, and the hybrid mode to use less
+//       processor time than spinning.
+//
+// Build: g++ -O2 PacingBench.cpp ../Source/CTimer.cpp -o PacingBench
+//
+// Usage: PacingBench [FrameCount] [LockFPS] [WorkMs]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// PacingBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTimer.h"
+#include "BenchTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#if !defined(_WIN32)
+    #include <time.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : ProcessTime ()
+    // Desc : Processor time consumed by this process so far (seconds)
+    //-------------------------------------------------------------------------
+    double ProcessTime( )
+    {
+#if defined(_WIN32)
+        FILETIME Creation, Exit, Kernel, User;
+        GetProcessTimes( GetCurrentProcess(), &Creation, &Exit, &Kernel, &User );
+        return ( ((double)Kernel.dwHighDateTime + (double)User.dwHighDateTime) * 4294967296.0 +
+                 (double)Kernel.dwLowDateTime + (double)User.dwLowDateTime ) * 1e-7;
+#else
+        return (double)clock() / CLOCKS_PER_SEC;
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SimulateWork ()
+    // Desc : Keep the processor busy for the specified time
+    //-------------------------------------------------------------------------
+    void SimulateWork( double fSeconds )
+    {
+        double fEnd = CBenchTimer::Now() + fSeconds;
+        while ( CBenchTimer::Now() < fEnd );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RunPaced ()
+    // Desc : Run the frame loop with the specified pacing mode. Returns the
+    //        timer's statistics, along with the average frame period and the
+    //        processor time used per frame (seconds)
+    //-------------------------------------------------------------------------
+    CTimer::PACINGSTATS RunPaced( CTimer::PACINGMODE Mode, unsigned long FrameCount, float fLockFPS,
+                                  double fWork, double & fPeriod, double & fProcess )
+    {
+        CTimer Timer;
+        double fStartWall, fStartProcess;
+
+        Timer.SetPacingMode( Mode );
+
+        // Settle on to the frame boundaries before measuring
+        Timer.Tick( fLockFPS );
+        Timer.ResetPacingStats();
+
+        fStartWall    = CBenchTimer::Now();
+        fStartProcess = ProcessTime();
+        for ( unsigned long i = 0; i < FrameCount; i++ )
+        {
+            SimulateWork( fWork );
+            Timer.Tick( fLockFPS );
+
+        } // Next Frame
+
+        fPeriod  = ( CBenchTimer::Now() - fStartWall ) / FrameCount;
+        fProcess = ( ProcessTime() - fStartProcess ) / FrameCount;
+        return Timer.GetPacingStats();
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Run the same frame loop with each pacing mode and compare.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long FrameCount = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 180;
+    float         fLockFPS   = ( argc > 2 ) ? (float)atof( argv[2] ) : 60.0f;
+    double        fWork      = ( ( argc > 3 ) ? atof( argv[3] ) : 4.0 ) / 1000.0;
+    const char  * Names[]    = { "Spin", "Hybrid" };
+    double        fProcess[2];
+    bool          bPassed    = true;
+
+    if ( FrameCount == 0 || fLockFPS <= 0.0f ) { printf( "Usage : %s [FrameCount] [LockFPS] [WorkMs]\n", argv[0] ); return 2; }
+
+    printf( "%lu frames locked to %.1f fps, %.1f ms of work per frame\n\n", FrameCount, fLockFPS, fWork * 1000.0 );
+    printf( "  Mode     Period (ms)   CPU/frame (ms)   Misses   Overruns   Jitter avg / max (ms)\n" );
+
+    for ( int m = 0; m < 2; m++ )
+    {
+        CTimer::PACINGSTATS Stats;
+        double fPeriod;
+
+        Stats = RunPaced( m ? CTimer::PACING_HYBRID : CTimer::PACING_SPIN, FrameCount, fLockFPS, fWork, fPeriod, fProcess[m] );
+        printf( "  %-8s %11.3f %16.3f %8lu %10lu %12.3f / %.3f\n", Names[m], fPeriod * 1000.0, fProcess[m] * 1000.0,
+                Stats.DeadlineMisses, Stats.OverrunFrames, Stats.WakeJitterAvg * 1000.0f, Stats.WakeJitterMax * 1000.0f );
+
+        // The lock must hold the requested rate (within 5%) either way
+        if ( fabs( fPeriod * fLockFPS - 1.0 ) > 0.05 )
+        {
+            printf( "FAILED : %s pacing ran at %.2f fps\n", Names[m], 1.0 / fPeriod );
+            bPassed = false;
+
+        } // End if wrong rate
+
+    } // Next Mode
+
+    // Sleeping must save processor time over spinning
+    if ( fProcess[1] >= fProcess[0] )
+    {
+        printf( "FAILED : hybrid pacing used as much processor time as spinning\n" );
+        bPassed = false;
+
+    } // End if no saving
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
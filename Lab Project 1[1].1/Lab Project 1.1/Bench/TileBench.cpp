@@ -0,0 +1,278 @@
+//-----------------------------------------------------------------------------
+// File: TileBench.cpp
+//
+// Desc: Headless benchmark for the tile binned triangle rasterizer. Renders a
+//       field of several thousand solid cubes (the same mesh the demo builds
+//       in BuildObjects) with 1, 2, 4 ... threads and reports how the tile
+//       rasterization phase scales with the number of cores. The output of
+//       each run is compared against the single threaded image, and a fill
+//       rule check makes sure triangles sharing an edge never overlap.
+//
+// Build: g++ -O2 -msse2 TileBench.cpp ../Source/CTileRenderer.cpp ../Source/CThreadPool.cpp
+//            ../Source/CFrameBuffer.cpp ../Source/CTransform.cpp ../Source/CProfiler.cpp -lpthread -o TileBench
+//
+// Usage: TileBench [CubeCount] [MaxThreads] [Frames] [Width] [Height]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TileBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTileRenderer.h"
+#include "../Includes/CTransform.h"
+#include "BenchTimer.h"
+#include "BenchMath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    // Welded cube (as produced by CIndexedMesh::BuildFromMesh for the demo cube)
+    const float CubeVertices[8 * 3] =
+    {
+        -2,  2, -2,    2,  2, -2,    2, -2, -2,   -2, -2, -2,
+        -2,  2,  2,    2,  2,  2,   -2, -2,  2,    2, -2,  2
+    };
+    const unsigned long CubeFaces[6][4] =
+    {
+        { 0, 1, 2, 3 }, { 4, 5, 1, 0 }, { 6, 7, 5, 4 },
+        { 3, 2, 7, 6 }, { 4, 0, 3, 6 }, { 1, 5, 7, 2 }
+    };
+    const unsigned int FaceColors[6] =
+    {
+        0x00C04040, 0x0040C040, 0x004040C0, 0x00C0C040, 0x00C040C0, 0x0040C0C0
+    };
+
+    struct CUBE { float mtxWorld[16]; };
+
+    //-------------------------------------------------------------------------
+    // Name : SubmitCubes ()
+    // Desc : Transform each cube and submit its faces as triangle fans.
+    //-------------------------------------------------------------------------
+    void SubmitCubes( CTileRenderer & Renderer, CTransform & Transform, const CUBE * pCubes,
+                      unsigned long CubeCount, const float * mtxViewProj )
+    {
+        float mtxCombined[16], x[8], y[8], z[8], v[3][3];
+
+        for ( unsigned long i = 0; i < CubeCount; i++ )
+        {
+            CTransform::MultiplyMatrix( mtxCombined, pCubes[i].mtxWorld, mtxViewProj );
+            Transform.SetMatrix( mtxCombined );
+            Transform.TransformVertices( CubeVertices, 8, x, y, z );
+
+            for ( unsigned long f = 0; f < 6; f++ )
+            {
+                const unsigned long * pFace = CubeFaces[f];
+                v[0][0] = x[pFace[0]]; v[0][1] = y[pFace[0]]; v[0][2] = z[pFace[0]];
+                for ( unsigned long j = 1; j + 1 < 4; j++ )
+                {
+                    v[1][0] = x[pFace[j]];     v[1][1] = y[pFace[j]];     v[1][2] = z[pFace[j]];
+                    v[2][0] = x[pFace[j + 1]]; v[2][1] = y[pFace[j + 1]]; v[2][2] = z[pFace[j + 1]];
+                    Renderer.DrawTriangle( v[0], v[1], v[2], FaceColors[f] );
+
+                } // Next Triangle
+
+            } // Next Face
+
+        } // Next Cube
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : Checksum ()
+    // Desc : Simple hash of the frame buffer contents.
+    //-------------------------------------------------------------------------
+    unsigned long Checksum( CFrameBuffer & FrameBuffer )
+    {
+        unsigned long Hash = 2166136261UL;
+        for ( unsigned long y = 0; y < FrameBuffer.GetHeight(); y++ )
+        {
+            const unsigned int * pRow = FrameBuffer.GetRow( y );
+            for ( unsigned long x = 0; x < FrameBuffer.GetWidth(); x++ ) Hash = (Hash ^ pRow[x]) * 16777619UL;
+
+        } // Next Row
+        return Hash & 0xFFFFFFFFUL;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckFillRule ()
+    // Desc : Renders star shaped triangle fans one triangle at a time and
+    //        checks that no pixel is ever covered by more than one of them,
+    //        and that the total coverage matches the polygon area.
+    //-------------------------------------------------------------------------
+    bool CheckFillRule( )
+    {
+        const unsigned long Size = 128, Points = 12;
+        CFrameBuffer  FrameBuffer;
+        CTileRenderer Renderer;
+        unsigned char Coverage[ Size * Size ];
+        float         Ring[ Points ][3], Centre[3];
+
+        FrameBuffer.Create( Size, Size );
+        Renderer.SetRenderTarget( &FrameBuffer );
+
+        for ( unsigned long Test = 0; Test < 100; Test++ )
+        {
+            double Area = 0.0, Perimeter = 0.0;
+            unsigned long Covered = 0, i, p;
+
+            // Random star shaped polygon around a (sub pixel) centre
+            Centre[0] = RandomFloat( 40, 88 ); Centre[1] = RandomFloat( 40, 88 ); Centre[2] = 0.5f;
+            for ( p = 0; p < Points; p++ )
+            {
+                float Angle  = (p + RandomFloat( 0.1f, 0.9f )) * 6.2831853f / Points;
+                float Radius = RandomFloat( 5, 38 );
+                Ring[p][0] = Centre[0] + cosf( Angle ) * Radius;
+                Ring[p][1] = Centre[1] + sinf( Angle ) * Radius;
+                Ring[p][2] = 0.5f;
+
+            } // Next Point
+
+            // Render each triangle on its own, accumulating coverage
+            memset( Coverage, 0, sizeof(Coverage) );
+            for ( p = 0; p < Points; p++ )
+            {
+                const float * pA = Ring[p], * pB = Ring[(p + 1) % Points];
+                FrameBuffer.Clear( 0 );
+                Renderer.BeginFrame();
+                Renderer.DrawTriangle( Centre, pA, pB, 1 );
+                Renderer.EndFrame( NULL );
+                for ( i = 0; i < Size * Size; i++ ) Coverage[i] += (unsigned char)FrameBuffer.GetBits()[i];
+
+                Area      += 0.5 * fabs( (pA[0] - Centre[0]) * (pB[1] - Centre[1]) - (pA[1] - Centre[1]) * (pB[0] - Centre[0]) );
+                Perimeter += sqrt( (pB[0] - pA[0]) * (pB[0] - pA[0]) + (pB[1] - pA[1]) * (pB[1] - pA[1]) );
+
+            } // Next Triangle
+
+            for ( i = 0; i < Size * Size; i++ )
+            {
+                if ( Coverage[i] > 1 )
+                {
+                    printf( "FAILED : pixel (%lu,%lu) covered %d times\n", i % Size, i / Size, Coverage[i] );
+                    return false;
+
+                } // End if overlap
+                Covered += Coverage[i];
+
+            } // Next Pixel
+
+            if ( fabs( Covered - Area ) > Perimeter )
+            {
+                printf( "FAILED : covered %lu pixels, polygon area %.1f\n", Covered, Area );
+                return false;
+
+            } // End if gaps
+
+        } // Next Test
+
+        return true;
+    }
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Renders the cube field with an increasing number of threads.
+//-----------------------------------------------------------------------------
+int main( int argc, char ** argv )
+{
+    unsigned long CubeCount  = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : 10000;
+    unsigned long MaxThreads = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : 0;
+    unsigned long Frames     = (argc > 3) ? strtoul( argv[3], NULL, 10 ) : 20;
+    unsigned long Width      = (argc > 4) ? strtoul( argv[4], NULL, 10 ) : 1024;
+    unsigned long Height     = (argc > 5) ? strtoul( argv[5], NULL, 10 ) : 768;
+    unsigned long Processors = CThreadPool::GetProcessorCount(), Threads, Frame, i;
+    unsigned long Reference  = 0;
+    float         mtxProj[16], mtxViewport[16], mtxViewProj[16];
+    double        BaseRaster = 0.0;
+    bool          Failed     = false;
+
+    // Default to covering every core (and at least two threads)
+    if ( MaxThreads == 0 ) MaxThreads = (Processors > 2) ? Processors : 2;
+
+    // Scatter the cubes through the view frustum
+    CUBE * pCubes = new CUBE[ CubeCount ];
+    srand( 1 );
+    for ( i = 0; i < CubeCount; i++ )
+    {
+        float z = RandomFloat( 30.0f, 300.0f );
+        BuildWorld( pCubes[i].mtxWorld, RandomFloat( 0, 6.28f ), RandomFloat( 0, 6.28f ),
+                    RandomFloat( -0.7f, 0.7f ) * z, RandomFloat( -0.55f, 0.55f ) * z, z );
+
+    } // Next Cube
+
+    // Same projection as the demo (the view matrix is identity)
+    BuildPerspective( mtxProj, 60.0f * 3.14159265f / 180.0f, (float)Width / (float)Height, 1.01f, 1000.0f );
+    CTransform::BuildViewportMatrix( mtxViewport, 0.0f, 0.0f, (float)Width, (float)Height );
+    CTransform::MultiplyMatrix( mtxViewProj, mtxProj, mtxViewport );
+
+    CFrameBuffer  FrameBuffer;
+    CTileRenderer Renderer;
+    CTransform    Transform;
+    FrameBuffer.Create( Width, Height );
+    Renderer.SetRenderTarget( &FrameBuffer );
+
+    printf( "Tile rasterizer benchmark : %lu cubes, %lux%lu target, %lu tiles, %lu frames, %lu processor(s)\n\n",
+            CubeCount, Width, Height, Renderer.GetTileCount(), Frames, Processors );
+    printf( "  Threads   Setup+Bin   Rasterize   Speedup    Mtri/s\n" );
+
+    for ( Threads = 1; ; Threads = (Threads * 2 < MaxThreads) ? Threads * 2 : MaxThreads )
+    {
+        CThreadPool Pool;
+        double      SetupTime = 0.0, RasterTime = 0.0;
+        CBenchTimer Timer;
+
+        Pool.Create( Threads );
+
+        for ( Frame = 0; Frame < Frames; Frame++ )
+        {
+            FrameBuffer.Clear( 0x00FFFFFF );
+
+            // Serial phase : transform, triangle setup and binning
+            Timer.Reset();
+            Renderer.BeginFrame();
+            SubmitCubes( Renderer, Transform, pCubes, CubeCount, mtxViewProj );
+            SetupTime += Timer.Elapsed();
+
+            // Parallel phase : one tile per task
+            Timer.Reset();
+            Renderer.EndFrame( &Pool );
+            RasterTime += Timer.Elapsed();
+
+        } // Next Frame
+
+        if ( Threads == 1 ) { BaseRaster = RasterTime; Reference = Checksum( FrameBuffer ); }
+
+        printf( "  %7lu   %6.2f ms   %6.2f ms   %6.2fx   %7.2f\n", Threads,
+                SetupTime * 1e3 / Frames, RasterTime * 1e3 / Frames, BaseRaster / RasterTime,
+                (double)Renderer.GetTriangleCount() * Frames / (SetupTime + RasterTime) / 1e6 );
+
+        // Every thread count must produce exactly the same image
+        if ( Checksum( FrameBuffer ) != Reference )
+        {
+            printf( "\nFAILED : image rendered with %lu threads differs from the single threaded image\n", Threads );
+            Failed = true;
+
+        } // End if mismatch
+
+        if ( Threads >= MaxThreads ) break;
+
+    } // Next Thread Count
+
+    printf( "\n  %lu triangles binned per frame\n", Renderer.GetTriangleCount() );
+
+    // Verify the fill rule
+    if ( !CheckFillRule() ) Failed = true;
+    if ( !Failed ) printf( "\nThread count invariance and fill rule verified.\n" );
+
+    // Clean up
+    Renderer.Release();
+    FrameBuffer.Release();
+    delete []pCubes;
+    return Failed ? 1 : 0;
+}
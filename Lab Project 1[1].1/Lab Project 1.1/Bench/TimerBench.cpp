@@ -0,0 +1,148 @@
+//-----------------------------------------------------------------------------
+// File: TimerBench.cpp
+//
+// Desc: Headless benchmark for the CTimer frame time bookkeeping. Compares
+//       the cost of the original per frame update (memmove of the sample
+//       FIFO, then a full re-sum) with the ring buffer and running sum, and
+//       times a GetFrameStats call. The statistics and histogram gathered
+//       over a real run of Tick calls are checked for consistency.
+//
+// Build: g++ -O2 TimerBench.cpp ../Source/CTimer.cpp -o TimerBench
+//
+// Usage: TimerBench [Iterations]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TimerBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTimer.h"
+#include "BenchTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : LegacyUpdate ()
+    // Desc : The original sample update, returns the new average
+    //-------------------------------------------------------------------------
+    float LegacyUpdate( float * pSamples, unsigned long & Count, float fTime )
+    {
+        float fAverage = 0.0f;
+
+        memmove( &pSamples[1], pSamples, (MAX_SAMPLE_COUNT - 1) * sizeof(float) );
+        pSamples[0] = fTime;
+        if ( Count < MAX_SAMPLE_COUNT ) Count++;
+
+        for ( unsigned long i = 0; i < Count; i++ ) fAverage += pSamples[i];
+        return fAverage / Count;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RingUpdate ()
+    // Desc : The ring buffer / running sum update, returns the new average
+    //-------------------------------------------------------------------------
+    float RingUpdate( float * pSamples, unsigned long & Count, unsigned long & Head, double & fSum, float fTime )
+    {
+        if ( Count == MAX_SAMPLE_COUNT ) fSum -= pSamples[ Head ]; else Count++;
+        pSamples[ Head ] = fTime;
+        fSum += fTime;
+        Head = (Head + 1) % MAX_SAMPLE_COUNT;
+        return (float)(fSum / Count);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyStats ()
+    // Desc : Tick a real timer and check the statistics agree with themselves
+    //-------------------------------------------------------------------------
+    bool VerifyStats( )
+    {
+        CTimer Timer;
+        CTimer::FRAMESTATS Stats;
+        ULONG  Total = 0;
+
+        Timer.SetStatsWindow( 500 );
+        for ( ULONG i = 0; i < 2000; i++ )
+        {
+            // Uneven frame times, with the odd hitch
+            double fEnd = CBenchTimer::Now() + ( (i % 97) == 0 ? 0.004 : 0.0001 * (i % 5) );
+            while ( CBenchTimer::Now() < fEnd );
+            Timer.Tick();
+
+        } // Next Frame
+
+        Stats = Timer.GetFrameStats();
+        if ( Stats.SampleCount != 500 ) return false;
+        if ( !(Stats.Min <= Stats.P50 && Stats.P50 <= Stats.P95 && Stats.P95 <= Stats.P99 && Stats.P99 <= Stats.Max) ) return false;
+        if ( Stats.Avg < Stats.Min || Stats.Avg > Stats.Max ) return false;
+        if ( Stats.Max < 0.004f ) return false;
+
+        // Every frame must land in exactly one histogram bin
+        const CTimer::FRAMEHISTOGRAM & Histogram = Timer.GetHistogram();
+        for ( ULONG Bin = 0; Bin < HISTOGRAM_BIN_COUNT; Bin++ ) Total += Histogram.Bins[ Bin ];
+        if ( Total != 2000 || Histogram.Total != 2000 ) return false;
+
+        // Resetting empties both
+        Timer.ResetFrameStats();
+        return Timer.GetFrameStats().SampleCount == 0 && Timer.GetHistogram().Total == 0;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each update method and verify the statistics.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long Iterations = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 10000000;
+    bool          bPassed    = VerifyStats();
+    float         LegacySamples[MAX_SAMPLE_COUNT], RingSamples[MAX_SAMPLE_COUNT];
+    unsigned long LegacyCount = 0, RingCount = 0, RingHead = 0;
+    double        fRingSum = 0.0, fLegacy, fRing, fStats;
+    float         fLegacyAvg = 0.0f, fRingAvg = 0.0f, fP99 = 0.0f;
+    CBenchTimer   Timer;
+    CTimer        FrameTimer;
+
+    if ( !bPassed ) printf( "FAILED : frame statistics are inconsistent\n" );
+
+    // Original update
+    Timer.Reset();
+    for ( unsigned long i = 0; i < Iterations; i++ ) fLegacyAvg = LegacyUpdate( LegacySamples, LegacyCount, 0.016f + (i & 7) * 0.0001f );
+    fLegacy = Timer.Elapsed();
+
+    // Ring buffer update
+    Timer.Reset();
+    for ( unsigned long i = 0; i < Iterations; i++ ) fRingAvg = RingUpdate( RingSamples, RingCount, RingHead, fRingSum, 0.016f + (i & 7) * 0.0001f );
+    fRing = Timer.Elapsed();
+
+    // Both must agree on the final average
+    if ( fabsf( fLegacyAvg - fRingAvg ) > 1e-6f )
+    {
+        printf( "FAILED : running sum average %.7f differs from re-summed %.7f\n", fRingAvg, fLegacyAvg );
+        bPassed = false;
+
+    } // End if mismatch
+
+    // Statistics over a full history
+    FrameTimer.SetStatsWindow( MAX_HISTORY_COUNT );
+    for ( unsigned long i = 0; i < MAX_HISTORY_COUNT; i++ ) FrameTimer.Tick();
+    Timer.Reset();
+    for ( unsigned long i = 0; i < 1000; i++ ) fP99 += FrameTimer.GetFrameStats().P99;
+    fStats = Timer.Elapsed() / 1000;
+
+    printf( "Sample update (%lu frames)\n\n", Iterations );
+    printf( "  memmove + re-sum    %8.2f ns/frame\n", fLegacy * 1e9 / Iterations );
+    printf( "  ring + running sum  %8.2f ns/frame\n", fRing * 1e9 / Iterations );
+    printf( "  GetFrameStats (%lu frame window) %.2f us, p99 %.4f ms\n", MAX_HISTORY_COUNT, fStats * 1e6, fP99 / 1000 * 1000.0f );
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
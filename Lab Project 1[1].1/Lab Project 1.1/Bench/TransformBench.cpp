@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+// File: TransformBench.cpp
+//
+// Desc: Headless microbenchmark for the vertex transformation stage. Compares
+//       the original three-matrix path used by DrawPrimitive (world, view and
+//       projection applied separately, each with its own divide) against the
+//       single concatenated matrix kernels in CTransform.
+//
+// Build: g++ -O2 -msse2 TransformBench.cpp ../Source/CTransform.cpp -o TransformBench
+//        (add -mavx to compile in the AVX kernel)
+//
+// Usage: TransformBench [VertexCount] [Iterations]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TransformBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTransform.h"
+#include "BenchTimer.h"
+#include "BenchMath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : TransformCoord ()
+    // Desc : Equivalent of D3DXVec3TransformCoord (transform, then divide).
+    //-------------------------------------------------------------------------
+    void TransformCoord( float * pOut, const float * pIn, const float * m )
+    {
+        float x = pIn[0], y = pIn[1], z = pIn[2];
+        float rw = 1.0f / (x * m[3] + y * m[7] + z * m[11] + m[15]);
+        pOut[0] = (x * m[0] + y * m[4] + z * m[8]  + m[12]) * rw;
+        pOut[1] = (x * m[1] + y * m[5] + z * m[9]  + m[13]) * rw;
+        pOut[2] = (x * m[2] + y * m[6] + z * m[10] + m[14]) * rw;
+    }
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Runs each transformation path over the same vertex set.
+//-----------------------------------------------------------------------------
+int main( int argc, char ** argv )
+{
+    unsigned long VertexCount = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : 100000;
+    unsigned long Iterations  = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : 200;
+    float         mtxWorld[16], mtxView[16], mtxProj[16], mtxViewport[16], mtxCombined[16];
+    unsigned long i, j;
+    double        Seconds, Baseline;
+    float         MaxError, Checksum = 0.0f;
+
+    // Allocate the vertex data and the output arrays
+    float * pPositions = new float[ VertexCount * 3 ];
+    float * pOutX      = new float[ VertexCount ];
+    float * pOutY      = new float[ VertexCount ];
+    float * pOutZ      = new float[ VertexCount ];
+    float * pRefX      = new float[ VertexCount ];
+    float * pRefY      = new float[ VertexCount ];
+    float * pRefZ      = new float[ VertexCount ];
+
+    // Scatter points within a cube around the origin
+    srand( 1 );
+    for ( i = 0; i < VertexCount * 3; i++ ) pPositions[i] = ((float)rand() / RAND_MAX) * 4.0f - 2.0f;
+
+    // Set up the same matrices used by the demo
+    memset( mtxWorld, 0, sizeof(mtxWorld) );
+    mtxWorld[0] = mtxWorld[5] = mtxWorld[10] = mtxWorld[15] = 1.0f;
+    mtxWorld[12] = -3.5f; mtxWorld[13] = 2.0f; mtxWorld[14] = 14.0f;
+    memset( mtxView, 0, sizeof(mtxView) );
+    mtxView[0] = mtxView[5] = mtxView[10] = mtxView[15] = 1.0f;
+    BuildPerspective( mtxProj, 60.0f * 3.14159265f / 180.0f, 1.0f, 1.01f, 1000.0f );
+    CTransform::BuildViewportMatrix( mtxViewport, 0.0f, 0.0f, 400.0f, 400.0f );
+
+    printf( "Vertex transform benchmark : %lu vertices x %lu iterations\n\n", VertexCount, Iterations );
+
+    // Baseline : three separate transforms, each with a divide, then viewport
+    CBenchTimer Timer;
+    for ( j = 0; j < Iterations; j++ )
+    {
+        for ( i = 0; i < VertexCount; i++ )
+        {
+            float v[3];
+            TransformCoord( v, &pPositions[i * 3], mtxWorld );
+            TransformCoord( v, v, mtxView );
+            TransformCoord( v, v, mtxProj );
+            pRefX[i] =  v[0] * 400.0f / 2 + 400.0f / 2;
+            pRefY[i] = -v[1] * 400.0f / 2 + 400.0f / 2;
+            pRefZ[i] =  v[2];
+
+        } // Next Vertex
+
+        Checksum += pRefX[ j % VertexCount ];
+
+    } // Next Iteration
+    Baseline = Timer.Elapsed();
+    printf( "  %-10s %8.2f ns/vertex  %8.1f Mvert/s\n", "3 x Matrix",
+            Baseline * 1e9 / ((double)VertexCount * Iterations), (double)VertexCount * Iterations / Baseline / 1e6 );
+
+    // Concatenate once, as CGameApp now does per object
+    CTransform::MultiplyMatrix( mtxCombined, mtxWorld, mtxView );
+    CTransform::MultiplyMatrix( mtxCombined, mtxCombined, mtxProj );
+    CTransform::MultiplyMatrix( mtxCombined, mtxCombined, mtxViewport );
+
+    // Run each available kernel
+    CTransform Transform;
+    Transform.SetMatrix( mtxCombined );
+    for ( int k = CTransform::KERNEL_SCALAR; k <= CTransform::KERNEL_AVX; k++ )
+    {
+        CTransform::KERNEL Kernel = (CTransform::KERNEL)k;
+        if ( !Transform.SetKernel( Kernel ) ) { printf( "  %-10s (not compiled in)\n", CTransform::GetKernelName( Kernel ) ); continue; }
+
+        Timer.Reset();
+        for ( j = 0; j < Iterations; j++ )
+        {
+            Transform.TransformVertices( pPositions, VertexCount, pOutX, pOutY, pOutZ );
+            Checksum += pOutX[ j % VertexCount ];
+
+        } // Next Iteration
+        Seconds = Timer.Elapsed();
+
+        // Validate against the baseline
+        MaxError = 0.0f;
+        for ( i = 0; i < VertexCount; i++ )
+        {
+            float Error = fabsf( pOutX[i] - pRefX[i] ) + fabsf( pOutY[i] - pRefY[i] );
+            if ( Error > MaxError ) MaxError = Error;
+
+        } // Next Vertex
+
+        printf( "  %-10s %8.2f ns/vertex  %8.1f Mvert/s  x%5.2f  (max screen error %.4f px)\n", CTransform::GetKernelName( Kernel ),
+                Seconds * 1e9 / ((double)VertexCount * Iterations), (double)VertexCount * Iterations / Seconds / 1e6,
+                Baseline / Seconds, MaxError );
+
+    } // Next Kernel
+
+    printf( "\n(checksum %g)\n", Checksum );
+
+    // Clean up
+    delete []pPositions;
+    delete []pOutX; delete []pOutY; delete []pOutZ;
+    delete []pRefX; delete []pRefY; delete []pRefZ;
+    return 0;
+}
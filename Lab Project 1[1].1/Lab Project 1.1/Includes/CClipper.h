@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+// File: CClipper.h
+//
+// Desc: Clip space stage of the software pipeline. Transforms a mesh's shared
+//       vertex pool into homogeneous space, classifies each vertex against
+//       the view frustum, and then processes polygons one at a time:
+//       trivially rejecting those entirely outside the frustum, clipping
+//       those which straddle the near plane, and optionally culling those
+//       which face away from the viewer.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CCLIPPER_H_
+#define _CCLIPPER_H_
+
+//-----------------------------------------------------------------------------
+// CClipper Specific Includes
+//-----------------------------------------------------------------------------
+#include "CTransform.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CClipper (Class)
+// Desc : Owns the per mesh vertex cache (homogeneous coordinates, out codes
+//        and projected screen positions) and produces clipped screen space
+//        polygons from it.
+// Note : The transformation matrix is expected to include the viewport
+//        mapping (see CTransform::BuildViewportMatrix), so the frustum side
+//        planes are expressed in terms of the viewport rectangle.
+//-----------------------------------------------------------------------------
+class CClipper
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum CULLMODE { CULL_NONE = 0, CULL_CW = 1, CULL_CCW = 2 };
+
+    enum OUTCODE  { CLIP_LEFT   = 0x01, CLIP_RIGHT = 0x02, CLIP_TOP = 0x04,
+                    CLIP_BOTTOM = 0x08, CLIP_NEAR  = 0x10, CLIP_FAR = 0x20 };
+
+    //-------------------------------------------------------------------------
+    // Structures
+    //-------------------------------------------------------------------------
+    struct STATISTICS
+    {
+        unsigned long   Submitted;          // Polygons passed to ClipPolygon
+        unsigned long   FrustumRejected;    // Trivially rejected by out codes (or clipped away)
+        unsigned long   NearClipped;        // Straddled the near plane and were clipped
+        unsigned long   BackFaceCulled;     // Rejected by the back face test
+        unsigned long   Accepted;           // Passed on for rasterization
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CClipper();
+	virtual ~CClipper();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    void            SetViewport     ( float X, float Y, float Width, float Height );
+    void            SetCullMode     ( CULLMODE Mode ) { m_CullMode = Mode; }
+    CULLMODE        GetCullMode     ( ) const { return m_CullMode; }
+    void            Release         ( );
+
+    bool            ProcessVertices ( const CTransform & Transform, const float * pPositions, unsigned long Count );
+    unsigned long   ClipPolygon     ( const unsigned long * pIndex, unsigned long Count );
+    const float    *GetClippedVertices( ) const { return m_pClipped; }
+
+    unsigned long   GetVertexCount  ( ) const { return m_nVertexCount; }
+    const unsigned char *GetOutCodes( ) const { return m_pCodes; }
+
+    void            ResetStatistics ( );
+    const STATISTICS & GetStatistics( ) const { return m_Stats; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            ReserveVertices ( unsigned long Count );
+    bool            ReservePolygon  ( unsigned long Count );
+    unsigned long   ClipNearPlane   ( const unsigned long * pIndex, unsigned long Count );
+    bool            IsCulled        ( const float * pVertices, unsigned long Count ) const;
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    float           m_fLeft;            // Viewport rectangle the side planes pass through
+    float           m_fTop;
+    float           m_fRight;
+    float           m_fBottom;
+    CULLMODE        m_CullMode;         // Which winding (if any) to cull
+    STATISTICS      m_Stats;            // Polygon counts for each stage
+
+    float          *m_pX;               // Homogeneous vertex cache (structure of arrays)
+    float          *m_pY;
+    float          *m_pZ;
+    float          *m_pW;
+    unsigned char  *m_pCodes;           // Frustum out codes for each cached vertex
+    float          *m_pScreen;          // Projected x/y/z of each unclipped cached vertex
+    unsigned long   m_nVertexCount;     // Number of vertices currently cached
+    unsigned long   m_nVertexCapacity;  // Allocated size of the cache arrays
+
+    float          *m_pClipped;         // Output polygon (packed screen space x/y/z)
+    float          *m_pWork;            // Homogeneous scratch polygon used while clipping
+    unsigned long   m_nPolygonCapacity; // Vertices the output / scratch polygons can hold
+
+};
+
+#endif // _CCLIPPER_H_
@@ -0,0 +1,94 @@
+//-----------------------------------------------------------------------------
+// File: CFrameBuffer.h
+//
+// Desc: Simple 32 bit software frame buffer. The pixel memory can either be
+//       owned by the frame buffer, or wrap memory allocated elsewhere (such
+//       as the bits of a DIB section).
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CFRAMEBUFFER_H_
+#define _CFRAMEBUFFER_H_
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define FRAMEBUFFER_SSE         // SSE2 fill is compiled in
+#endif
+
+const unsigned long DEFAULT_STREAM_THRESHOLD = 8 * 1024 * 1024; // Fills of at least this many bytes bypass the cache
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameBuffer (Class)
+// Desc : Stores a 32 bit (0x00RRGGBB, matching a 32bpp DIB) pixel array
+//        along with its dimensions.
+//-----------------------------------------------------------------------------
+class CFrameBuffer
+{
+public:
+    //-------------------------------------------------------------------------
+    // Structures
+    //-------------------------------------------------------------------------
+    struct DIRTYRECT
+    {
+        long            Left, Top;      // Inclusive top left pixel
+        long            Right, Bottom;  // Exclusive bottom right (empty if Right <= Left)
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CFrameBuffer();
+	virtual ~CFrameBuffer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            Create      ( unsigned long Width, unsigned long Height );
+    void            Attach      ( unsigned int * pBits, unsigned long Width, unsigned long Height, unsigned long Pitch );
+    void            Release     ( );
+    void            Clear       ( unsigned int Color );
+    void            ClearRect   ( const DIRTYRECT & Rect, unsigned int Color );
+    void            SetStreamThreshold( unsigned long Bytes ) { m_nStreamThreshold = Bytes; }
+    bool            SavePPM     ( const char * pFileName ) const;
+
+    unsigned int   *GetBits     ( ) const { return m_pBits; }
+    unsigned int   *GetRow      ( unsigned long y ) const { return m_pBits + y * m_nPitch; }
+    unsigned long   GetWidth    ( ) const { return m_nWidth; }
+    unsigned long   GetHeight   ( ) const { return m_nHeight; }
+    unsigned long   GetPitch    ( ) const { return m_nPitch; }
+    bool            IsValid     ( ) const { return m_pBits != 0; }
+
+    void            SetPixel    ( unsigned long x, unsigned long y, unsigned int Color ) { m_pBits[ x + y * m_nPitch ] = Color; }
+    unsigned int    GetPixel    ( unsigned long x, unsigned long y ) const { return m_pBits[ x + y * m_nPitch ]; }
+
+    void            AddDirtyRect    ( long Left, long Top, long Right, long Bottom );
+    void            ResetDirtyRect  ( );
+    const DIRTYRECT &GetDirtyRect   ( ) const { return m_rcDirty; }
+    static void     UnionRect       ( DIRTYRECT & Dest, const DIRTYRECT & Src );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            Fill        ( long Left, long Top, long Right, long Bottom, unsigned int Color );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    unsigned int   *m_pBits;            // Pixel data
+    unsigned long   m_nWidth;           // Width of the frame buffer in pixels
+    unsigned long   m_nHeight;          // Height of the frame buffer in pixels
+    unsigned long   m_nPitch;           // Distance between rows, in pixels
+    bool            m_bOwnsMemory;      // Did we allocate m_pBits ourselves?
+    unsigned long   m_nStreamThreshold; // Size (in bytes) at which fills use non-temporal stores
+    DIRTYRECT       m_rcDirty;          // Bounds of everything drawn since ResetDirtyRect
+
+};
+
+#endif // _CFRAMEBUFFER_H_
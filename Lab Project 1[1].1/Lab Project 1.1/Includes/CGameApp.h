@@ -15,6 +15,18 @@
 #include "Main.h"
 #include "CTimer.h"
 #include "CObject.h"
+#include "CTransform.h"
+#include "CClipper.h"
+#include "CFrameBuffer.h"
+#include "CRasterizer.h"
+#include "CTileRenderer.h"
+#include "CThreadPool.h"
+#include "CProfiler.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG MAX_DUMP_FRAMES = 64;   // Maximum number of individually listed frames to write
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -26,6 +38,29 @@
 class CGameApp
 {
 public:
+    //-------------------------------------------------------------------------
+    // Structures
+    //-------------------------------------------------------------------------
+    struct HEADLESSDESC
+    {
+        ULONG       Width;              // Size of the in-memory frame buffer
+        ULONG       Height;
+        ULONG       FrameCount;         // Number of frames to render
+        ULONG       ThreadCount;        // Rasterizer threads (0 = one per processor)
+        float       TimeStep;           // Simulated seconds per frame (0 = real elapsed time)
+        float       LockFPS;            // Frame rate to lock to (0 = run unlocked)
+        bool        SpinPacing;         // Busy wait for the whole of each locked frame
+        bool        Filled;             // Render filled polygons rather than wireframe
+        bool        Culling;            // Enable back face culling
+        bool        DirtyRects;         // Clear only the area drawn during the previous frame
+        ULONG       DumpInterval;       // Write every Nth frame (0 = only those listed)
+        ULONG       DumpFrames[MAX_DUMP_FRAMES]; // Individual frames to write
+        ULONG       DumpFrameCount;     // Number of entries in DumpFrames
+        const char *OutputPrefix;       // Image file name prefix ("<prefix>00042.ppm")
+        const char *ReportFile;         // File to write the timing report to (NULL = stdout)
+        const char *ProfilePrefix;      // Profiler output ("<prefix>.json" & "<prefix>_zones.csv", NULL = none)
+    };
+
     //-------------------------------------------------------------------------
 	// Constructors & Destructors for This Class.
 	//-------------------------------------------------------------------------
@@ -35,9 +70,13 @@ public:
 	//-------------------------------------------------------------------------
 	// Public Functions for This Class
 	//-------------------------------------------------------------------------
+#if defined(_WIN32)
     LRESULT     DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM lParam );
 	bool        InitInstance( HANDLE hInstance, LPCTSTR lpCmdLine, int iCmdShow );
     int         BeginGame( );
+#endif
+    bool        InitHeadless( const HEADLESSDESC & Desc );
+    int         RunHeadless( );
 	bool        ShutDown( );
 	
 private:
@@ -46,38 +85,69 @@ private:
 	//-------------------------------------------------------------------------
     bool        BuildObjects( );
     void        FrameAdvance( );
+#if defined(_WIN32)
     bool        CreateDisplay( );
+    bool        BuildFrameBuffer( ULONG Width, ULONG Height );
+#endif
     void        SetupGameState( );
     void        AnimateObjects( );
     void        PresentFrameBuffer( );
     void        ClearFrameBuffer( ULONG Color );
-    bool        BuildFrameBuffer( ULONG Width, ULONG Height );
-    void        DrawPrimitive( CPolygon * pPoly, D3DXMATRIX * pmtxWorld );
+    bool        IsDumpFrame( ULONG Frame ) const;
+    void        MarkDirty( const float * pVertices, ULONG Count );
+    void        TransformMesh( CIndexedMesh * pMesh );
+    void        DrawPrimitive( CIndexedMesh * pMesh, ULONG Polygon );
+    void        DrawPrimitiveFilled( CIndexedMesh * pMesh, ULONG Polygon, ULONG Color );
     void        DrawLine( const D3DXVECTOR3 & vtx1, const D3DXVECTOR3 & vtx2, ULONG Color );
 
     //-------------------------------------------------------------------------
 	// Private Static Functions For This Class
 	//-------------------------------------------------------------------------
+#if defined(_WIN32)
     static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT Message, WPARAM wParam, LPARAM lParam);
+#endif
 
     //-------------------------------------------------------------------------
 	// Private Variables For This Class
 	//-------------------------------------------------------------------------
     D3DXMATRIX  m_mtxView;          // View Matrix
     D3DXMATRIX  m_mtxProjection;    // Projection matrix
+    D3DXMATRIX  m_mtxViewport;      // Maps projected coordinates to the viewport
+
+    CTransform  m_Transform;        // Batched vertex transformation stage
+    CClipper    m_Clipper;          // Clip space stage, owns the transformed vertex cache
+    ULONG       m_nTransformCount;  // Vertices transformed during the current frame
 
     CMesh       m_Mesh;             // Mesh to be rendered
+    CIndexedMesh m_IndexedMesh;     // Shared vertex / indexed version of m_Mesh
     CObject     m_pObject[2];       // Objects storing mesh instances
     
     CTimer      m_Timer;            // Game timer
+    float       m_fLockFPS;         // Frame rate the timer is locked to (0 = unlocked)
     
+#if defined(_WIN32)
     HWND        m_hWnd;             // Main window HWND
     HDC         m_hdcFrameBuffer;   // Frame Buffers Device Context
-    HBITMAP     m_hbmFrameBuffer;   // Frame buffers Bitmap
+    HBITMAP     m_hbmFrameBuffer;   // Frame buffers Bitmap (32bpp DIB section)
     HBITMAP     m_hbmSelectOut;     // Used for selecting out of the DC
+#endif
+    bool        m_bHeadless;        // Rendering to memory only, with no window
+    HEADLESSDESC m_Headless;        // Options for the headless run
+    CFrameBuffer m_FrameBuffer;     // Wraps the DIB section pixels (or owns them when headless)
+    CRasterizer m_Rasterizer;       // Renders directly into m_FrameBuffer
+    CTileRenderer m_TileRenderer;   // Tile binned, depth buffered triangle renderer
+    CThreadPool m_ThreadPool;       // Worker threads used to rasterize the tiles
+    TCHAR       m_szOverlay[512];   // Text drawn over the frame when presented
+
+    bool        m_bDirtyRects;      // Clear / present only the regions that changed
+    bool        m_bClearValid;      // Frame buffer holds m_nClearColor outside the dirty rectangle
+    bool        m_bFullPresent;     // Next present must copy the entire frame buffer
+    ULONG       m_nClearColor;      // Colour used by the last clear
+    CFrameBuffer::DIRTYRECT m_rcCleared; // Region cleared at the start of this frame
 
     bool        m_bRotation1;       // Object 1 rotation enabled / disabled 
     bool        m_bRotation2;       // Object 2 rotation enabled / disabled 
+    bool        m_bFilled;          // Render filled polygons rather than wireframe
 
     ULONG       m_nViewX;           // X Position of render viewport
     ULONG       m_nViewY;           // Y Position of render viewport
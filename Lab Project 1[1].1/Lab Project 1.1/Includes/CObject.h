@@ -14,6 +14,11 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 
+//-----------------------------------------------------------------------------
+// Forward Declarations
+//-----------------------------------------------------------------------------
+class CMesh;
+
 //-----------------------------------------------------------------------------
 // Main Class Declarations
 //-----------------------------------------------------------------------------
@@ -42,6 +47,11 @@ public:
 //-----------------------------------------------------------------------------
 // Name : CPolygon (Class)
 // Desc : Basic polygon class used to store this polygons vertex data.
+// Note : Polygons created by a mesh do not own their vertices, they are a
+//        span (m_nFirstVertex, m_nVertexCount) within the mesh's vertex pool
+//        and m_pVertex points at the start of that span. Growing the pool
+//        updates m_pVertex, so it should be re-read after any AddVertex or
+//        AddPolygon call rather than kept.
 //-----------------------------------------------------------------------------
 class CPolygon
 {
@@ -63,12 +73,25 @@ public:
 	//-------------------------------------------------------------------------
     USHORT      m_nVertexCount;         // Number of vertices stored.
     CVertex    *m_pVertex;              // Simple vertex array
+    ULONG       m_nFirstVertex;         // Start of our span within the mesh vertex pool
+    CMesh      *m_pMesh;                // Mesh whose pool we live in (NULL if we own m_pVertex)
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    USHORT      m_nVertexCapacity;      // Allocated size of m_pVertex (when we own it)
 
 };
 
 //-----------------------------------------------------------------------------
 // Name : CMesh (Class)
 // Desc : Basic mesh class used to store individual mesh data.
+// Note : All polygons are stored back to back in a single array, and all of
+//        their vertices in a single pool. Both grow geometrically, so
+//        building a mesh one polygon at a time is linear. m_pPolygon is
+//        kept as a table of pointers into the polygon array so that
+//        m_pPolygon[i]->m_pVertex[j] still works.
 //-----------------------------------------------------------------------------
 class CMesh
 {
@@ -84,12 +107,85 @@ public:
 	// Public Functions for This Class
 	//-------------------------------------------------------------------------
     long        AddPolygon( ULONG Count = 1 );
+    bool        Reserve   ( ULONG PolygonCount, ULONG VertexCount );
 
     //-------------------------------------------------------------------------
 	// Public Variables for This Class
 	//-------------------------------------------------------------------------
     ULONG       m_nPolygonCount;        // Number of polygons stored
     CPolygon  **m_pPolygon;             // Simply polygon array.
+    ULONG       m_nVertexCount;         // Vertex pool entries in use (including any abandoned spans)
+    CVertex    *m_pVertex;              // Vertex pool, every polygon's vertices live here
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    bool        ReservePolygons ( ULONG Count );
+    bool        ReserveVertices ( ULONG Count );
+    long        GrowPolygon     ( CPolygon * pPoly, USHORT Count );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    CPolygon   *m_pPolygonPool;         // The polygons themselves, back to back
+    ULONG       m_nPolygonCapacity;     // Allocated size of m_pPolygonPool / m_pPolygon
+    ULONG       m_nVertexCapacity;      // Allocated size of m_pVertex
+
+    friend class CPolygon;              // CPolygon::AddVertex grows spans through GrowPolygon
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : CIndexedPolygon (Class)
+// Desc : Polygon stored as a span within its parent mesh's index list.
+//-----------------------------------------------------------------------------
+class CIndexedPolygon
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class.
+    //-------------------------------------------------------------------------
+    CIndexedPolygon() { m_nFirstIndex = 0; m_nIndexCount = 0; }
+
+    //-------------------------------------------------------------------------
+	// Public Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG       m_nFirstIndex;          // First entry in the mesh index list
+    USHORT      m_nIndexCount;          // Number of indices (vertices) used
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : CIndexedMesh (Class)
+// Desc : Mesh class storing a single shared vertex pool, with each polygon
+//        referencing that pool by index. Vertices shared between polygons
+//        are stored (and therefore transformed) only once.
+//-----------------------------------------------------------------------------
+class CIndexedMesh
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CIndexedMesh();
+	virtual ~CIndexedMesh();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool        BuildFromMesh   ( const CMesh * pMesh );
+    void        Release         ( );
+
+    //-------------------------------------------------------------------------
+	// Public Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG            m_nVertexCount;    // Number of unique vertices stored
+    CVertex         *m_pVertex;         // Shared vertex pool
+    ULONG            m_nIndexCount;     // Number of indices stored
+    ULONG           *m_pIndex;          // Polygon index lists, back to back
+    ULONG            m_nPolygonCount;   // Number of polygons stored
+    CIndexedPolygon *m_pPolygon;        // Polygon spans into the index list
 
 };
 
@@ -109,8 +205,9 @@ public:
 	//-------------------------------------------------------------------------
 	// Public Variables for This Class
 	//-------------------------------------------------------------------------
-    D3DXMATRIX  m_mtxWorld;             // Objects world matrix
-    CMesh      *m_pMesh;                // Mesh we are instancing
+    D3DXMATRIX    m_mtxWorld;           // Objects world matrix
+    CMesh        *m_pMesh;              // Mesh we are instancing
+    CIndexedMesh *m_pIndexedMesh;       // Indexed version of the mesh we are instancing
 
 };
 
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// File: CRasterizer.h
+//
+// Desc: Software rasterizer which writes directly into a CFrameBuffer's pixel
+//       memory, with no operating system involvement.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CRASTERIZER_H_
+#define _CRASTERIZER_H_
+
+//-----------------------------------------------------------------------------
+// CRasterizer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CFrameBuffer.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CRasterizer (Class)
+// Desc : Clips and rasterizes primitives into the currently set render target.
+//-----------------------------------------------------------------------------
+class CRasterizer
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CRasterizer();
+	virtual ~CRasterizer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    void            SetRenderTarget ( CFrameBuffer * pTarget );
+    CFrameBuffer   *GetRenderTarget ( ) const { return m_pTarget; }
+    void            SetClipRect     ( long Left, long Top, long Right, long Bottom );
+
+    void            DrawLine        ( float x1, float y1, float x2, float y2, unsigned int Color );
+    bool            ClipLine        ( float & x1, float & y1, float & x2, float & y2 ) const;
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    unsigned int    ComputeOutCode  ( float x, float y ) const;
+    void            RasterizeLine   ( long x1, long y1, long x2, long y2, unsigned int Color );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    CFrameBuffer   *m_pTarget;          // Frame buffer we are rendering into
+    long            m_nClipLeft;        // Left most pixel column we may write
+    long            m_nClipTop;         // Top most pixel row we may write
+    long            m_nClipRight;       // Right most pixel column we may write (inclusive)
+    long            m_nClipBottom;      // Bottom most pixel row we may write (inclusive)
+
+};
+
+#endif // _CRASTERIZER_H_
@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------
+// File: CThreadPool.h
+//
+// Desc: Simple fork / join thread pool. A batch of independent tasks is
+//       dispatched across a set of persistent worker threads (plus the
+//       calling thread), and the call returns once every task has completed.
+//
+// Note: Uses Win32 threads on Windows and POSIX threads elsewhere.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTHREADPOOL_H_
+#define _CTHREADPOOL_H_
+
+//-----------------------------------------------------------------------------
+// CThreadPool Specific Includes
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+typedef void (*THREADTASK)( void * pContext, unsigned long TaskIndex );
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CThreadPool (Class)
+// Desc : Runs 'TaskCount' invocations of a task function across all threads.
+//        Tasks are handed out one at a time from a shared counter, so faster
+//        threads simply pick up more of the work.
+//-----------------------------------------------------------------------------
+class CThreadPool
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CThreadPool();
+	virtual ~CThreadPool();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( unsigned long ThreadCount = 0 );
+    void            Release         ( );
+    void            Dispatch        ( THREADTASK pTask, void * pContext, unsigned long TaskCount );
+    unsigned long   GetThreadCount  ( ) const { return m_nThreadCount; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static unsigned long GetProcessorCount( );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            RunTasks        ( );
+    void            WorkerLoop      ( );
+#if defined(_WIN32)
+    static DWORD WINAPI WorkerProc  ( LPVOID pParam );
+#else
+    static void *   WorkerProc      ( void * pParam );
+#endif
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    unsigned long   m_nThreadCount;     // Total threads including the caller
+    unsigned long   m_nWorkerCount;     // Number of worker threads created
+    bool            m_bShutdown;        // Signals the workers to exit
+
+    THREADTASK      m_pTask;            // Task function currently dispatched
+    void          * m_pContext;         // Context passed to the task function
+    long            m_nTaskCount;       // Number of tasks in the current batch
+    volatile long   m_nNextTask;        // Next task index to be claimed
+    volatile long   m_nBusyWorkers;     // Workers still processing the batch
+
+#if defined(_WIN32)
+    HANDLE        * m_pThreads;         // Worker thread handles
+    HANDLE          m_hStart;           // Semaphore releasing workers for a batch
+    HANDLE          m_hDone;            // Event set when the last worker finishes
+#else
+    pthread_t     * m_pThreads;         // Worker threads
+    pthread_mutex_t m_Mutex;            // Guards the batch generation & busy count
+    pthread_cond_t  m_StartCond;        // Signalled when a new batch is available
+    pthread_cond_t  m_DoneCond;         // Signalled when the last worker finishes
+    unsigned long   m_nGeneration;      // Incremented for each dispatched batch
+#endif
+
+};
+
+#endif // _CTHREADPOOL_H_
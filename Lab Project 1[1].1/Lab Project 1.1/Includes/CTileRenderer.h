@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+// File: CTileRenderer.h
+//
+// Desc: Tile binned, multi-threaded triangle rasterizer. Triangles submitted
+//       during a frame are set up and sorted into 64x64 pixel screen tiles,
+//       then each tile is rasterized (half-space / edge function method with
+//       a 32 bit depth buffer) by whichever thread of the pool claims it.
+//       Because no two threads ever touch the same tile, no locking is
+//       required while rasterizing.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTILERENDERER_H_
+#define _CTILERENDERER_H_
+
+//-----------------------------------------------------------------------------
+// CTileRenderer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CFrameBuffer.h"
+#include "CThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(_MSC_VER)
+typedef __int64   EDGEVALUE;
+#else
+typedef long long EDGEVALUE;
+#endif
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTileRenderer (Class)
+// Desc : Bins screen space triangles into tiles, and rasterizes the tiles in
+//        parallel into the render target and its depth buffer.
+//-----------------------------------------------------------------------------
+class CTileRenderer
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum { TILE_SIZE = 64 };
+
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTileRenderer();
+	virtual ~CTileRenderer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            SetRenderTarget ( CFrameBuffer * pTarget );
+    CFrameBuffer   *GetRenderTarget ( ) const { return m_pTarget; }
+    void            Release         ( );
+
+    void            BeginFrame      ( );
+    void            DrawTriangle    ( const float * pV1, const float * pV2, const float * pV3, unsigned int Color );
+    void            EndFrame        ( CThreadPool * pPool );
+
+    const float    *GetDepthBuffer  ( ) const { return m_pDepth; }
+    unsigned long   GetTriangleCount( ) const { return m_nTriangleCount; }
+    unsigned long   GetTileCount    ( ) const { return m_nTilesWide * m_nTilesHigh; }
+
+private:
+    //-------------------------------------------------------------------------
+    // Private Structures
+    //-------------------------------------------------------------------------
+    struct TRIANGLE
+    {
+        EDGEVALUE       C[3];           // Edge function values at the centre of pixel (0,0)
+        EDGEVALUE       A[3];           // Edge function step per pixel in x
+        EDGEVALUE       B[3];           // Edge function step per pixel in y
+        float           Z, DZDX, DZDY;  // Depth plane (value at pixel (0,0) centre and gradients)
+        long            MinX, MinY;     // Inclusive pixel bounding box (clamped to the target)
+        long            MaxX, MaxY;
+        unsigned int    Color;          // Flat fill colour
+    };
+
+    struct TILEBIN
+    {
+        unsigned long * pTriangles;     // Indices of triangles overlapping this tile
+        unsigned long   Count;          // Number of triangles in the bin
+        unsigned long   Capacity;       // Allocated size of the index array
+    };
+
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            RenderTile      ( unsigned long Tile );
+    static void     RenderTileTask  ( void * pContext, unsigned long Tile );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    CFrameBuffer   *m_pTarget;          // Frame buffer we are rendering into
+    float          *m_pDepth;           // 32 bit depth buffer (Width * Height)
+    unsigned long   m_nWidth;           // Dimensions of the render target
+    unsigned long   m_nHeight;
+
+    TRIANGLE       *m_pTriangles;       // Triangles set up during this frame
+    unsigned long   m_nTriangleCount;   // Number of triangles submitted
+    unsigned long   m_nTriangleCapacity;// Allocated size of the triangle array
+
+    TILEBIN        *m_pBins;            // One bin per screen tile
+    unsigned long   m_nTilesWide;       // Number of tile columns
+    unsigned long   m_nTilesHigh;       // Number of tile rows
+
+};
+
+#endif // _CTILERENDERER_H_
@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+// File: CTransform.h
+//
+// Desc: Batched vertex transformation stage. The world, view, projection and
+//       viewport mappings are concatenated into a single matrix, and whole
+//       vertex arrays are then pushed through it using SIMD kernels.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTRANSFORM_H_
+#define _CTRANSFORM_H_
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TRANSFORM_SSE           // SSE kernel is compiled in
+#endif
+
+#if defined(__AVX__)
+    #define TRANSFORM_AVX           // AVX kernel is compiled in
+#endif
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTransform (Class)
+// Desc : Stores a single concatenated 4x4 matrix (row vector convention, laid
+//        out exactly as a D3DXMATRIX) and transforms packed x/y/z position
+//        arrays through it, including the perspective divide, in one pass.
+//-----------------------------------------------------------------------------
+class CTransform
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum KERNEL { KERNEL_AUTO = 0, KERNEL_SCALAR = 1, KERNEL_SSE = 2, KERNEL_AVX = 3 };
+
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTransform();
+	virtual ~CTransform();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    void            SetMatrix       ( const float * pMatrix );
+    const float    *GetMatrix       ( ) const { return m_fMatrix; }
+    bool            SetKernel       ( KERNEL Kernel );
+    KERNEL          GetKernel       ( ) const { return m_Kernel; }
+    void            TransformVertices( const float * pPositions, unsigned long Count,
+                                       float * pOutX, float * pOutY, float * pOutZ ) const;
+    void            TransformHomogeneous( const float * pPositions, unsigned long Count,
+                                       float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const;
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static void     BuildViewportMatrix ( float * pOut, float X, float Y, float Width, float Height );
+    static void     MultiplyMatrix      ( float * pOut, const float * pM1, const float * pM2 );
+    static bool     IsKernelSupported   ( KERNEL Kernel );
+    static const char * GetKernelName   ( KERNEL Kernel );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            TransformScalar ( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const;
+    void            TransformSSE    ( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const;
+    void            TransformAVX    ( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const;
+    void            HomogeneousScalar( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const;
+    void            HomogeneousSSE  ( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const;
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    float           m_fMatrix[16];      // Concatenated World/View/Projection/Viewport matrix
+    KERNEL          m_Kernel;           // Kernel selected for transformation
+
+};
+
+#endif // _CTRANSFORM_H_
@@ -12,10 +12,14 @@
 //-----------------------------------------------------------------------------
 // Main Application Includes
 //-----------------------------------------------------------------------------
-#include "..\\Res\\resource.h"
+#include "../Res/resource.h"
+#if defined(_WIN32)
 #include <windows.h>
 #include <tchar.h>
 #include <D3DX9.h>
+#else
+#include "Portable.h"
+#endif
 
 //-----------------------------------------------------------------------------
 // Miscellaneous Macros
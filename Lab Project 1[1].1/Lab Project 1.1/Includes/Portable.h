@@ -0,0 +1,205 @@
+//-----------------------------------------------------------------------------
+// File: Portable.h
+//
+// Desc: The small subset of the Win32 / TCHAR types and D3DX maths library
+//       that the platform independent parts of the application rely upon.
+//       Used in place of windows.h / D3DX9.h when building the headless
+//       version of the application on other platforms.
+//
+// Note: Only ever included by Main.h, and only when _WIN32 is not defined.
+//       The D3DX functions here follow the same (row vector, left handed)
+//       conventions as the real library.
+//
+//       The pipeline modules (CFrameBuffer, CRasterizer, CTransform,
+//       CClipper, CTileRenderer, CThreadPool and CProfiler) include neither
+//       windows.h / D3DX nor this file, and only use the native thread API
+//       where they need threads. Keep it that way, so that they build on any
+//       platform and can be benchmarked on their own (see the Bench folder).
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _PORTABLE_H_
+#define _PORTABLE_H_
+
+//-----------------------------------------------------------------------------
+// Portable Specific Includes
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Win32 Types & TCHAR Mappings
+//-----------------------------------------------------------------------------
+typedef unsigned long   ULONG;
+typedef unsigned short  USHORT;
+typedef unsigned char   UCHAR;
+typedef unsigned int    UINT;
+typedef int             BOOL;
+typedef char            TCHAR;
+typedef char          * LPTSTR;
+typedef const char    * LPCTSTR;
+
+#ifndef TRUE
+#define TRUE            1
+#define FALSE           0
+#endif
+
+#define _T( x )         x
+#define _stprintf       sprintf
+#define _tcslen         strlen
+#define _tcscpy         strcpy
+#define ZeroMemory( pDest, Length ) memset( (pDest), 0, (Length) )
+
+//-----------------------------------------------------------------------------
+// Name : _itot ()
+// Desc : Convert an integer to a string in the specified radix (10 or 16).
+//-----------------------------------------------------------------------------
+inline LPTSTR _itot( int Value, LPTSTR lpszString, int Radix )
+{
+    sprintf( lpszString, (Radix == 16) ? "%x" : "%d", Value );
+    return lpszString;
+}
+
+//-----------------------------------------------------------------------------
+// D3DX Constants & Macros
+//-----------------------------------------------------------------------------
+#define D3DX_PI             3.141592654f
+#define D3DXToRadian( d )   ((d) * (D3DX_PI / 180.0f))
+#define D3DXToDegree( r )   ((r) * (180.0f / D3DX_PI))
+
+//-----------------------------------------------------------------------------
+// Name : D3DXVECTOR3 (Struct)
+// Desc : Three component vector.
+//-----------------------------------------------------------------------------
+struct D3DXVECTOR3
+{
+    D3DXVECTOR3( ) {}
+    D3DXVECTOR3( float fx, float fy, float fz ) { x = fx; y = fy; z = fz; }
+
+    float x, y, z;
+};
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMATRIX (Struct)
+// Desc : 4x4 row major matrix, laid out exactly as the D3DX version.
+//-----------------------------------------------------------------------------
+struct D3DXMATRIX
+{
+    union
+    {
+        struct
+        {
+            float _11, _12, _13, _14;
+            float _21, _22, _23, _24;
+            float _31, _32, _33, _34;
+            float _41, _42, _43, _44;
+        };
+        float m[4][4];
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixIdentity ()
+// Desc : Build an identity matrix.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixIdentity( D3DXMATRIX * pOut )
+{
+    memset( pOut, 0, sizeof(D3DXMATRIX) );
+    pOut->_11 = pOut->_22 = pOut->_33 = pOut->_44 = 1.0f;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixMultiply ()
+// Desc : pOut = pM1 * pM2. pOut may be the same as either of the inputs.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixMultiply( D3DXMATRIX * pOut, const D3DXMATRIX * pM1, const D3DXMATRIX * pM2 )
+{
+    D3DXMATRIX mtxResult;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        for ( int j = 0; j < 4; j++ )
+        {
+            mtxResult.m[i][j] = pM1->m[i][0] * pM2->m[0][j] + pM1->m[i][1] * pM2->m[1][j] +
+                                pM1->m[i][2] * pM2->m[2][j] + pM1->m[i][3] * pM2->m[3][j];
+        } // Next Column
+
+    } // Next Row
+
+    *pOut = mtxResult;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixTranslation ()
+// Desc : Build a translation matrix.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixTranslation( D3DXMATRIX * pOut, float x, float y, float z )
+{
+    D3DXMatrixIdentity( pOut );
+    pOut->_41 = x; pOut->_42 = y; pOut->_43 = z;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixRotationX ()
+// Desc : Build a matrix which rotates around the X axis.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixRotationX( D3DXMATRIX * pOut, float Angle )
+{
+    float s = sinf( Angle ), c = cosf( Angle );
+    D3DXMatrixIdentity( pOut );
+    pOut->_22 = c; pOut->_23 = s;
+    pOut->_32 = -s; pOut->_33 = c;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixRotationY ()
+// Desc : Build a matrix which rotates around the Y axis.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixRotationY( D3DXMATRIX * pOut, float Angle )
+{
+    float s = sinf( Angle ), c = cosf( Angle );
+    D3DXMatrixIdentity( pOut );
+    pOut->_11 = c; pOut->_13 = -s;
+    pOut->_31 = s; pOut->_33 = c;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixRotationZ ()
+// Desc : Build a matrix which rotates around the Z axis.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixRotationZ( D3DXMATRIX * pOut, float Angle )
+{
+    float s = sinf( Angle ), c = cosf( Angle );
+    D3DXMatrixIdentity( pOut );
+    pOut->_11 = c; pOut->_12 = s;
+    pOut->_21 = -s; pOut->_22 = c;
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Name : D3DXMatrixPerspectiveFovLH ()
+// Desc : Build a left handed perspective projection matrix.
+//-----------------------------------------------------------------------------
+inline D3DXMATRIX * D3DXMatrixPerspectiveFovLH( D3DXMATRIX * pOut, float FovY, float Aspect, float zn, float zf )
+{
+    float yScale = 1.0f / tanf( FovY * 0.5f );
+
+    memset( pOut, 0, sizeof(D3DXMATRIX) );
+    pOut->_11 = yScale / Aspect;
+    pOut->_22 = yScale;
+    pOut->_33 = zf / (zf - zn);
+    pOut->_34 = 1.0f;
+    pOut->_43 = -zn * zf / (zf - zn);
+    return pOut;
+}
+
+#endif // _PORTABLE_H_
@@ -92,6 +92,14 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\Source\CClipper.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CFrameBuffer.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CGameApp.cpp
 # End Source File
 # Begin Source File
@@ -100,10 +108,30 @@ SOURCE=.\Source\CObject.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CProfiler.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CRasterizer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CThreadPool.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTileRenderer.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CTimer.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CTransform.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\Main.cpp
 # End Source File
 # End Group
@@ -112,6 +140,14 @@ SOURCE=.\Source\Main.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\Includes\CClipper.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CFrameBuffer.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CGameApp.h
 # End Source File
 # Begin Source File
@@ -120,12 +156,36 @@ SOURCE=.\Includes\CObject.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CProfiler.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CRasterizer.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CThreadPool.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTileRenderer.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CTimer.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CTransform.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\Main.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\Includes\Portable.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
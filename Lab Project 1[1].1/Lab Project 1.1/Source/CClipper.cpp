@@ -0,0 +1,355 @@
+//-----------------------------------------------------------------------------
+// File: CClipper.cpp
+//
+// Desc: Clip space stage of the software pipeline. Transforms a mesh's shared
+//       vertex pool into homogeneous space, classifies each vertex against
+//       the view frustum, and then processes polygons one at a time:
+//       trivially rejecting those entirely outside the frustum, clipping
+//       those which straddle the near plane, and optionally culling those
+//       which face away from the viewer.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CClipper Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CClipper.h"
+#include <stddef.h>
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Name : CClipper () (Constructor)
+// Desc : CClipper Class Constructor
+//-----------------------------------------------------------------------------
+CClipper::CClipper()
+{
+	// Reset / Clear all required values
+    m_fLeft             = 0.0f;
+    m_fTop              = 0.0f;
+    m_fRight            = 0.0f;
+    m_fBottom           = 0.0f;
+    m_CullMode          = CULL_NONE;
+    m_pX                = NULL;
+    m_pY                = NULL;
+    m_pZ                = NULL;
+    m_pW                = NULL;
+    m_pCodes            = NULL;
+    m_pScreen           = NULL;
+    m_nVertexCount      = 0;
+    m_nVertexCapacity   = 0;
+    m_pClipped          = NULL;
+    m_pWork             = NULL;
+    m_nPolygonCapacity  = 0;
+
+    ResetStatistics();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CClipper () (Destructor)
+// Desc : CClipper Class Destructor
+//-----------------------------------------------------------------------------
+CClipper::~CClipper()
+{
+    // Release any memory we own
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Release the vertex cache and polygon scratch memory.
+//-----------------------------------------------------------------------------
+void CClipper::Release()
+{
+    if ( m_pX       ) delete []m_pX;
+    if ( m_pY       ) delete []m_pY;
+    if ( m_pZ       ) delete []m_pZ;
+    if ( m_pW       ) delete []m_pW;
+    if ( m_pCodes   ) delete []m_pCodes;
+    if ( m_pScreen  ) delete []m_pScreen;
+    if ( m_pClipped ) delete []m_pClipped;
+    if ( m_pWork    ) delete []m_pWork;
+
+    // Clear variables
+    m_pX                = NULL;
+    m_pY                = NULL;
+    m_pZ                = NULL;
+    m_pW                = NULL;
+    m_pCodes            = NULL;
+    m_pScreen           = NULL;
+    m_nVertexCount      = 0;
+    m_nVertexCapacity   = 0;
+    m_pClipped          = NULL;
+    m_pWork             = NULL;
+    m_nPolygonCapacity  = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetViewport ()
+// Desc : Set the viewport rectangle that the transformation matrix maps the
+//        projection onto. The left, right, top and bottom frustum planes pass
+//        through its edges.
+//-----------------------------------------------------------------------------
+void CClipper::SetViewport( float X, float Y, float Width, float Height )
+{
+    m_fLeft   = X;
+    m_fTop    = Y;
+    m_fRight  = X + Width;
+    m_fBottom = Y + Height;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetStatistics ()
+// Desc : Zero the per stage polygon counters (typically once per frame).
+//-----------------------------------------------------------------------------
+void CClipper::ResetStatistics()
+{
+    memset( &m_Stats, 0, sizeof(STATISTICS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReserveVertices () (Private)
+// Desc : Ensures the vertex cache can hold at least 'Count' vertices.
+//-----------------------------------------------------------------------------
+bool CClipper::ReserveVertices( unsigned long Count )
+{
+    // Already large enough?
+    if ( Count <= m_nVertexCapacity ) return true;
+
+    // Release the old arrays
+    if ( m_pX      ) delete []m_pX;
+    if ( m_pY      ) delete []m_pY;
+    if ( m_pZ      ) delete []m_pZ;
+    if ( m_pW      ) delete []m_pW;
+    if ( m_pCodes  ) delete []m_pCodes;
+    if ( m_pScreen ) delete []m_pScreen;
+    m_nVertexCapacity = 0;
+
+    // Allocate the new arrays
+    m_pX      = new float[ Count ];
+    m_pY      = new float[ Count ];
+    m_pZ      = new float[ Count ];
+    m_pW      = new float[ Count ];
+    m_pCodes  = new unsigned char[ Count ];
+    m_pScreen = new float[ Count * 3 ];
+    if ( !m_pX || !m_pY || !m_pZ || !m_pW || !m_pCodes || !m_pScreen ) return false;
+
+    // Success!
+    m_nVertexCapacity = Count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReservePolygon () (Private)
+// Desc : Ensures the output and scratch polygons can hold 'Count' vertices.
+//-----------------------------------------------------------------------------
+bool CClipper::ReservePolygon( unsigned long Count )
+{
+    // Already large enough?
+    if ( Count <= m_nPolygonCapacity ) return true;
+
+    // Release the old arrays
+    if ( m_pClipped ) delete []m_pClipped;
+    if ( m_pWork    ) delete []m_pWork;
+    m_nPolygonCapacity = 0;
+
+    // Allocate the new arrays
+    m_pClipped = new float[ Count * 3 ];
+    m_pWork    = new float[ Count * 4 ];
+    if ( !m_pClipped || !m_pWork ) return false;
+
+    // Success!
+    m_nPolygonCapacity = Count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProcessVertices ()
+// Desc : Transform a mesh's vertex pool into homogeneous space, compute the
+//        frustum out codes of each vertex, and project every vertex which
+//        lies in front of the near plane through to the screen.
+//-----------------------------------------------------------------------------
+bool CClipper::ProcessVertices( const CTransform & Transform, const float * pPositions, unsigned long Count )
+{
+    unsigned char Code;
+    float         x, y, z, w, rw;
+
+    // Make sure we have room for the transformed vertices
+    m_nVertexCount = 0;
+    if ( !ReserveVertices( Count ) ) return false;
+
+    // Transform without the divide
+    Transform.TransformHomogeneous( pPositions, Count, m_pX, m_pY, m_pZ, m_pW );
+
+    for ( unsigned long i = 0; i < Count; i++ )
+    {
+        x = m_pX[i]; y = m_pY[i]; z = m_pZ[i]; w = m_pW[i];
+
+        // Classify against each frustum plane
+        Code = 0;
+        if ( x < m_fLeft   * w ) Code |= CLIP_LEFT;
+        if ( x > m_fRight  * w ) Code |= CLIP_RIGHT;
+        if ( y < m_fTop    * w ) Code |= CLIP_TOP;
+        if ( y > m_fBottom * w ) Code |= CLIP_BOTTOM;
+        if ( z > w             ) Code |= CLIP_FAR;
+        if ( z < 0.0f || !(w > 0.0f) ) Code |= CLIP_NEAR;
+        m_pCodes[i] = Code;
+
+        // Vertices behind the near plane are only ever used via the clipper
+        if ( Code & CLIP_NEAR )
+        {
+            m_pScreen[ i * 3 ] = m_pScreen[ i * 3 + 1 ] = m_pScreen[ i * 3 + 2 ] = 0.0f;
+            continue;
+
+        } // End if behind
+
+        rw = 1.0f / w;
+        m_pScreen[ i * 3     ] = x * rw;
+        m_pScreen[ i * 3 + 1 ] = y * rw;
+        m_pScreen[ i * 3 + 2 ] = z * rw;
+
+    } // Next Vertex
+
+    // Success!
+    m_nVertexCount = Count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClipPolygon ()
+// Desc : Run a single polygon (indices into the vertex cache) through the
+//        clip space stage. Returns the number of screen space vertices left
+//        in the output polygon (see GetClippedVertices), or 0 if the polygon
+//        was rejected.
+//-----------------------------------------------------------------------------
+unsigned long CClipper::ClipPolygon( const unsigned long * pIndex, unsigned long Count )
+{
+    unsigned char CodeAnd = 0xFF, CodeOr = 0;
+    unsigned long i, OutCount;
+
+    m_Stats.Submitted++;
+
+    // Need at least a triangle
+    if ( Count < 3 ) { m_Stats.FrustumRejected++; return 0; }
+
+    // Combine the vertex out codes
+    for ( i = 0; i < Count; i++ )
+    {
+        CodeAnd &= m_pCodes[ pIndex[i] ];
+        CodeOr  |= m_pCodes[ pIndex[i] ];
+
+    } // Next Vertex
+
+    // Every vertex outside the same plane? Trivially rejected
+    if ( CodeAnd ) { m_Stats.FrustumRejected++; return 0; }
+
+    // Each edge emits at most two vertices (intersection and end point), a
+    // convex polygon gains at most one but a concave one can gain more
+    if ( !ReservePolygon( Count * 2 ) ) return 0;
+
+    if ( CodeOr & CLIP_NEAR )
+    {
+        // Straddles the near plane, clip in homogeneous space
+        m_Stats.NearClipped++;
+        OutCount = ClipNearPlane( pIndex, Count );
+        if ( OutCount < 3 ) { m_Stats.FrustumRejected++; return 0; }
+    }
+    else
+    {
+        // Entirely in front of the near plane, use the projected cache
+        for ( i = 0; i < Count; i++ ) memcpy( &m_pClipped[ i * 3 ], &m_pScreen[ pIndex[i] * 3 ], 3 * sizeof(float) );
+        OutCount = Count;
+
+    } // End if near
+
+    // Back face test on the final screen space polygon
+    if ( IsCulled( m_pClipped, OutCount ) ) { m_Stats.BackFaceCulled++; return 0; }
+
+    // Accepted
+    m_Stats.Accepted++;
+    return OutCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClipNearPlane () (Private)
+// Desc : Sutherland-Hodgman clip of the polygon against the near plane
+//        (z >= 0) in homogeneous space, after which the surviving vertices
+//        are projected into the output polygon.
+//-----------------------------------------------------------------------------
+unsigned long CClipper::ClipNearPlane( const unsigned long * pIndex, unsigned long Count )
+{
+    unsigned long Previous = pIndex[ Count - 1 ], Current, i, OutCount = 0;
+    float         DistPrev = m_pZ[ Previous ], DistCur, t, rw;
+    float       * pOut     = m_pWork;
+
+    for ( i = 0; i < Count; i++ )
+    {
+        Current = pIndex[i];
+        DistCur = m_pZ[ Current ];
+
+        // Edge crosses the plane? Emit the intersection
+        if ( (DistPrev >= 0.0f) != (DistCur >= 0.0f) )
+        {
+            t = DistPrev / (DistPrev - DistCur);
+            pOut[0] = m_pX[Previous] + (m_pX[Current] - m_pX[Previous]) * t;
+            pOut[1] = m_pY[Previous] + (m_pY[Current] - m_pY[Previous]) * t;
+            pOut[2] = 0.0f;
+            pOut[3] = m_pW[Previous] + (m_pW[Current] - m_pW[Previous]) * t;
+            pOut += 4; OutCount++;
+
+        } // End if crossing
+
+        // Keep the vertex if it is in front
+        if ( DistCur >= 0.0f )
+        {
+            pOut[0] = m_pX[Current]; pOut[1] = m_pY[Current];
+            pOut[2] = m_pZ[Current]; pOut[3] = m_pW[Current];
+            pOut += 4; OutCount++;
+
+        } // End if inside
+
+        Previous = Current;
+        DistPrev = DistCur;
+
+    } // Next Edge
+
+    // Project the clipped polygon
+    for ( i = 0, pOut = m_pWork; i < OutCount; i++, pOut += 4 )
+    {
+        // Only possible with an unusual projection, nothing sensible to draw
+        if ( !(pOut[3] > 0.0f) ) return 0;
+
+        rw = 1.0f / pOut[3];
+        m_pClipped[ i * 3     ] = pOut[0] * rw;
+        m_pClipped[ i * 3 + 1 ] = pOut[1] * rw;
+        m_pClipped[ i * 3 + 2 ] = pOut[2] * rw;
+
+    } // Next Vertex
+
+    return OutCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsCulled () (Private)
+// Desc : Determine whether a screen space polygon should be culled based on
+//        its winding. With y pointing down the screen, a positive signed area
+//        means the vertices run clockwise. Zero area polygons are culled
+//        whenever culling is enabled.
+//-----------------------------------------------------------------------------
+bool CClipper::IsCulled( const float * pVertices, unsigned long Count ) const
+{
+    float Area = 0.0f;
+
+    // Culling disabled?
+    if ( m_CullMode == CULL_NONE ) return false;
+
+    // Twice the signed area (shoelace formula), relative to the first vertex
+    for ( unsigned long i = 1; i + 1 < Count; i++ )
+    {
+        const float * p1 = &pVertices[ i * 3 ], * p2 = &pVertices[ (i + 1) * 3 ];
+        Area += (p1[0] - pVertices[0]) * (p2[1] - pVertices[1]) - (p2[0] - pVertices[0]) * (p1[1] - pVertices[1]);
+
+    } // Next Triangle
+
+    return ( m_CullMode == CULL_CCW ) ? !(Area > 0.0f) : !(Area < 0.0f);
+}
@@ -0,0 +1,306 @@
+//-----------------------------------------------------------------------------
+// File: CFrameBuffer.cpp
+//
+// Desc: Simple 32 bit software frame buffer. The pixel memory can either be
+//       owned by the frame buffer, or wrap memory allocated elsewhere (such
+//       as the bits of a DIB section).
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CFrameBuffer Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CFrameBuffer.h"
+#include <stddef.h>
+#include <stdio.h>
+
+#if defined(FRAMEBUFFER_SSE)
+    #include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : CFrameBuffer () (Constructor)
+// Desc : CFrameBuffer Class Constructor
+//-----------------------------------------------------------------------------
+CFrameBuffer::CFrameBuffer()
+{
+	// Reset / Clear all required values
+    m_pBits       = NULL;
+    m_nWidth      = 0;
+    m_nHeight     = 0;
+    m_nPitch      = 0;
+    m_bOwnsMemory = false;
+    m_nStreamThreshold = DEFAULT_STREAM_THRESHOLD;
+    ResetDirtyRect();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CFrameBuffer () (Destructor)
+// Desc : CFrameBuffer Class Destructor
+//-----------------------------------------------------------------------------
+CFrameBuffer::~CFrameBuffer()
+{
+    // Release any memory we own
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Allocate a frame buffer of the specified size which we own.
+//-----------------------------------------------------------------------------
+bool CFrameBuffer::Create( unsigned long Width, unsigned long Height )
+{
+    // Release any previous buffer
+    Release();
+
+    // Allocate the pixel data
+    m_pBits = new unsigned int[ Width * Height ];
+    if ( !m_pBits ) return false;
+
+    // Store details
+    m_nWidth      = Width;
+    m_nHeight     = Height;
+    m_nPitch      = Width;
+    m_bOwnsMemory = true;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Attach ()
+// Desc : Wrap memory which is owned elsewhere (i.e. a top-down DIB section).
+// Note : Pitch is specified in pixels, not bytes.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::Attach( unsigned int * pBits, unsigned long Width, unsigned long Height, unsigned long Pitch )
+{
+    // Release any previous buffer
+    Release();
+
+    // Store details
+    m_pBits       = pBits;
+    m_nWidth      = Width;
+    m_nHeight     = Height;
+    m_nPitch      = Pitch;
+    m_bOwnsMemory = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Release (or detach from) the pixel data.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::Release()
+{
+    // Free the pixel data if we allocated it
+    if ( m_pBits && m_bOwnsMemory ) delete []m_pBits;
+
+    // Clear variables
+    m_pBits       = NULL;
+    m_nWidth      = 0;
+    m_nHeight     = 0;
+    m_nPitch      = 0;
+    m_bOwnsMemory = false;
+    ResetDirtyRect();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : Fill the entire frame buffer with the specified colour.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::Clear( unsigned int Color )
+{
+    // Validate
+    if ( !m_pBits ) return;
+
+    // Fill everything
+    Fill( 0, 0, (long)m_nWidth, (long)m_nHeight, Color );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClearRect ()
+// Desc : Fill the specified rectangle (clipped to the frame buffer) with the
+//        specified colour.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::ClearRect( const DIRTYRECT & Rect, unsigned int Color )
+{
+    long Left   = ( Rect.Left   > 0 ) ? Rect.Left : 0;
+    long Top    = ( Rect.Top    > 0 ) ? Rect.Top  : 0;
+    long Right  = ( Rect.Right  < (long)m_nWidth  ) ? Rect.Right  : (long)m_nWidth;
+    long Bottom = ( Rect.Bottom < (long)m_nHeight ) ? Rect.Bottom : (long)m_nHeight;
+
+    // Validate
+    if ( !m_pBits || Left >= Right || Top >= Bottom ) return;
+
+    // Fill the region
+    Fill( Left, Top, Right, Bottom, Color );
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddDirtyRect ()
+// Desc : Grow the dirty rectangle to include the specified region (clipped
+//        to the frame buffer).
+//-----------------------------------------------------------------------------
+void CFrameBuffer::AddDirtyRect( long Left, long Top, long Right, long Bottom )
+{
+    // Clip to the frame buffer
+    if ( Left   < 0 ) Left = 0;
+    if ( Top    < 0 ) Top  = 0;
+    if ( Right  > (long)m_nWidth  ) Right  = (long)m_nWidth;
+    if ( Bottom > (long)m_nHeight ) Bottom = (long)m_nHeight;
+    if ( Left >= Right || Top >= Bottom ) return;
+
+    // Merge with the existing region
+    DIRTYRECT Rect = { Left, Top, Right, Bottom };
+    UnionRect( m_rcDirty, Rect );
+}
+
+//-----------------------------------------------------------------------------
+// Name : UnionRect () (Static)
+// Desc : Grow the destination rectangle to include the source rectangle.
+//        Empty rectangles are ignored.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::UnionRect( DIRTYRECT & Dest, const DIRTYRECT & Src )
+{
+    // Nothing to add?
+    if ( Src.Left >= Src.Right || Src.Top >= Src.Bottom ) return;
+
+    // Adding to an empty rectangle?
+    if ( Dest.Left >= Dest.Right || Dest.Top >= Dest.Bottom ) { Dest = Src; return; }
+
+    // Union
+    if ( Src.Left   < Dest.Left   ) Dest.Left   = Src.Left;
+    if ( Src.Top    < Dest.Top    ) Dest.Top    = Src.Top;
+    if ( Src.Right  > Dest.Right  ) Dest.Right  = Src.Right;
+    if ( Src.Bottom > Dest.Bottom ) Dest.Bottom = Src.Bottom;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetDirtyRect ()
+// Desc : Empty the dirty rectangle.
+//-----------------------------------------------------------------------------
+void CFrameBuffer::ResetDirtyRect( )
+{
+    m_rcDirty.Left  = m_rcDirty.Top    = 0;
+    m_rcDirty.Right = m_rcDirty.Bottom = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Fill () (Private)
+// Desc : Fill a (pre-clipped) rectangle with the specified colour.
+// Note : Uses 16 byte SSE2 stores where available. Fills larger than the
+//        stream threshold use non-temporal stores, so that a target which
+//        would not fit in the cache anyway does not evict everything else
+//        (or get read in before being overwritten).
+//-----------------------------------------------------------------------------
+void CFrameBuffer::Fill( long Left, long Top, long Right, long Bottom, unsigned int Color )
+{
+    unsigned long Width = (unsigned long)(Right - Left), Rows = (unsigned long)(Bottom - Top);
+
+    // Full width rows of an unpadded buffer are one contiguous run
+    if ( Width == m_nPitch ) { Width *= Rows; Rows = 1; }
+
+#if defined(FRAMEBUFFER_SSE)
+    const __m128i Fill4   = _mm_set1_epi32( (int)Color );
+    const bool    bStream = ( Width * Rows * sizeof(unsigned int) >= m_nStreamThreshold );
+
+    for ( unsigned long y = 0; y < Rows; y++ )
+    {
+        unsigned int * pPixel = GetRow( Top + y ) + Left;
+        unsigned int * pEnd   = pPixel + Width;
+
+        // Single pixels until we reach a 16 byte boundary
+        while ( pPixel < pEnd && ((size_t)pPixel & 15) ) *pPixel++ = Color;
+
+        // Four registers (16 pixels) at a time, then one register at a time
+        if ( bStream )
+        {
+            for ( ; pEnd - pPixel >= 16; pPixel += 16 )
+            {
+                _mm_stream_si128( (__m128i*)pPixel,      Fill4 );
+                _mm_stream_si128( (__m128i*)pPixel + 1,  Fill4 );
+                _mm_stream_si128( (__m128i*)pPixel + 2,  Fill4 );
+                _mm_stream_si128( (__m128i*)pPixel + 3,  Fill4 );
+            
+            } // Next 16 Pixels
+            for ( ; pEnd - pPixel >= 4; pPixel += 4 ) _mm_stream_si128( (__m128i*)pPixel, Fill4 );
+
+        } // End if streaming
+        else
+        {
+            for ( ; pEnd - pPixel >= 16; pPixel += 16 )
+            {
+                _mm_store_si128( (__m128i*)pPixel,      Fill4 );
+                _mm_store_si128( (__m128i*)pPixel + 1,  Fill4 );
+                _mm_store_si128( (__m128i*)pPixel + 2,  Fill4 );
+                _mm_store_si128( (__m128i*)pPixel + 3,  Fill4 );
+            
+            } // Next 16 Pixels
+            for ( ; pEnd - pPixel >= 4; pPixel += 4 ) _mm_store_si128( (__m128i*)pPixel, Fill4 );
+
+        } // End if cached
+
+        // Remaining pixels
+        while ( pPixel < pEnd ) *pPixel++ = Color;
+
+    } // Next Row
+
+    // Make the streamed stores visible before anything else touches the pixels
+    if ( bStream ) _mm_sfence();
+#else
+    // Fill each row
+    for ( unsigned long y = 0; y < Rows; y++ )
+    {
+        unsigned int * pRow = GetRow( Top + y ) + Left;
+        for ( unsigned long x = 0; x < Width; x++ ) pRow[x] = Color;
+
+    } // Next Row
+#endif // FRAMEBUFFER_SSE
+}
+
+//-----------------------------------------------------------------------------
+// Name : SavePPM ()
+// Desc : Write the frame buffer contents to disk as a binary (P6) PPM image.
+// Note : PPM was chosen as it needs no external library to write, and can be
+//        read by practically every image tool for comparison / inspection.
+//-----------------------------------------------------------------------------
+bool CFrameBuffer::SavePPM( const char * pFileName ) const
+{
+    FILE          * pFile = NULL;
+    unsigned char * pLine = NULL;
+    bool            bResult = true;
+
+    // Validate
+    if ( !m_pBits || !pFileName ) return false;
+
+    // Open the file and allocate a single row of packed RGB
+    pFile = fopen( pFileName, "wb" );
+    if ( !pFile ) return false;
+    pLine = new unsigned char[ m_nWidth * 3 ];
+
+    // Write the header
+    fprintf( pFile, "P6\n%lu %lu\n255\n", m_nWidth, m_nHeight );
+
+    // Convert and write each row (0x00RRGGBB to R, G, B)
+    for ( unsigned long y = 0; y < m_nHeight && bResult; y++ )
+    {
+        const unsigned int * pRow = GetRow( y );
+        for ( unsigned long x = 0; x < m_nWidth; x++ )
+        {
+            pLine[ x * 3     ] = (unsigned char)(pRow[x] >> 16);
+            pLine[ x * 3 + 1 ] = (unsigned char)(pRow[x] >> 8);
+            pLine[ x * 3 + 2 ] = (unsigned char)(pRow[x]);
+
+        } // Next Pixel
+
+        if ( fwrite( pLine, 3, m_nWidth, pFile ) != m_nWidth ) bResult = false;
+
+    } // Next Row
+
+    // Clean up
+    delete []pLine;
+    if ( fclose( pFile ) != 0 ) bResult = false;
+
+    // Success?
+    return bResult;
+}
@@ -9,7 +9,19 @@
 //-----------------------------------------------------------------------------
 // CGameApp Specific Includes
 //-----------------------------------------------------------------------------
-#include "..\\Includes\\CGameApp.h"
+#include "../Includes/CGameApp.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Name : CompareFrameTimes () (Module Local)
+// Desc : qsort callback used to order frame times when building the report.
+//-----------------------------------------------------------------------------
+static int CompareFrameTimes( const void * pA, const void * pB )
+{
+    float fA = *(const float*)pA, fB = *(const float*)pB;
+    return (fA < fB) ? -1 : (fA > fB) ? 1 : 0;
+}
 
 //-----------------------------------------------------------------------------
 // Name : CGameApp () (Constructor)
@@ -18,10 +30,23 @@
 CGameApp::CGameApp()
 {
 	// Reset / Clear all required values
+#if defined(_WIN32)
     m_hWnd              = NULL;
     m_hdcFrameBuffer    = NULL;
     m_hbmSelectOut      = NULL;
     m_hbmFrameBuffer    = NULL;
+#endif
+    m_szOverlay[0]      = _T('\0');
+    m_nTransformCount   = 0;
+    m_bFilled           = false;
+    m_bHeadless         = false;
+    m_fLockFPS          = 60.0f;
+    m_bDirtyRects       = false;
+    m_bClearValid       = false;
+    m_bFullPresent      = true;
+    m_nClearColor       = 0;
+    ZeroMemory( &m_Headless, sizeof(HEADLESSDESC) );
+    ZeroMemory( &m_rcCleared, sizeof(m_rcCleared) );
 }
 
 //-----------------------------------------------------------------------------
@@ -34,6 +59,7 @@ CGameApp::~CGameApp()
     ShutDown();
 }
 
+#if defined(_WIN32)
 //-----------------------------------------------------------------------------
 // Name : InitInstance ()
 // Desc : Initialises the entire Engine here.
@@ -43,6 +69,9 @@ bool CGameApp::InitInstance( HANDLE hInstance, LPCTSTR lpCmdLine, int iCmdShow )
     // Create the primary display device
     if (!CreateDisplay()) { ShutDown(); return false; }
 
+    // Spin up one rasterizer thread per processor
+    if (!m_ThreadPool.Create()) { ShutDown(); return false; }
+
     // Build Objects
     if (!BuildObjects()) { ShutDown(); return false; }
 
@@ -112,6 +141,9 @@ bool CGameApp::CreateDisplay()
 //-----------------------------------------------------------------------------
 bool CGameApp::BuildFrameBuffer( ULONG Width, ULONG Height )
 {
+    BITMAPINFO  bmi;
+    LPVOID      pBits = NULL;
+
     // Obtain window's HDC.
     HDC hDC = ::GetDC( m_hWnd );
 
@@ -121,6 +153,11 @@ bool CGameApp::BuildFrameBuffer( ULONG Width, ULONG Height )
     // If an old FrameBuffer bitmap has already been generated then delete it
     if ( m_hbmFrameBuffer ) 
     {
+        // Detach from the old pixels before they are destroyed
+        m_FrameBuffer.Release();
+        m_Rasterizer.SetRenderTarget( NULL );
+        m_TileRenderer.SetRenderTarget( NULL );
+
         // Select the frame buffer back out and destroy it
         ::SelectObject( m_hdcFrameBuffer, m_hbmSelectOut );
         ::DeleteObject( m_hbmFrameBuffer );
@@ -129,9 +166,18 @@ bool CGameApp::BuildFrameBuffer( ULONG Width, ULONG Height )
 
     } // End if
 
+    // Describe a top-down 32bpp DIB so that we can write pixels directly
+    ZeroMemory( &bmi, sizeof(BITMAPINFO) );
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = Width;
+    bmi.bmiHeader.biHeight      = -(LONG)Height;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
     // Create the frame buffer
-    m_hbmFrameBuffer = CreateCompatibleBitmap( hDC, Width, Height );    
-    if ( !m_hbmFrameBuffer ) return false;
+    m_hbmFrameBuffer = ::CreateDIBSection( hDC, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0 );
+    if ( !m_hbmFrameBuffer || !pBits ) { ::ReleaseDC( m_hWnd, hDC ); return false; }
 
     // Select this bitmap into our Frame Buffer DC
     m_hbmSelectOut = (HBITMAP)::SelectObject( m_hdcFrameBuffer, m_hbmFrameBuffer );
@@ -142,94 +188,396 @@ bool CGameApp::BuildFrameBuffer( ULONG Width, ULONG Height )
     // Set up initial DC states
     ::SetBkMode( m_hdcFrameBuffer, TRANSPARENT );
 
+    // Wrap the DIB pixels and point the rasterizer at them
+    m_FrameBuffer.Attach( (unsigned int*)pBits, Width, Height, Width );
+    m_Rasterizer.SetRenderTarget( &m_FrameBuffer );
+
+    // The tile renderer also needs a matching depth buffer
+    if ( !m_TileRenderer.SetRenderTarget( &m_FrameBuffer ) ) return false;
+
+    // The new pixels are undefined, so the next frame must be cleared and presented in full
+    m_bClearValid  = false;
+    m_bFullPresent = true;
+
     // Success!!
     return true;
 }
+#endif // _WIN32
+
+//-----------------------------------------------------------------------------
+// Name : InitHeadless ()
+// Desc : Initialises the engine to render into an in-memory frame buffer,
+//        without creating a window. Used for automated / performance runs,
+//        and the only mode available on platforms other than Windows.
+//-----------------------------------------------------------------------------
+bool CGameApp::InitHeadless( const HEADLESSDESC & Desc )
+{
+    // Validate
+    if ( Desc.Width == 0 || Desc.Height == 0 ) return false;
+
+    // Store the run options
+    m_Headless  = Desc;
+    m_bHeadless = true;
+    m_fLockFPS  = Desc.LockFPS;
+    m_Timer.SetPacingMode( Desc.SpinPacing ? CTimer::PACING_SPIN : CTimer::PACING_HYBRID );
+    m_Timer.SetStatsWindow( Desc.FrameCount );
+
+    // With no window, the viewport covers the whole frame buffer
+    m_nViewX      = 0;
+    m_nViewY      = 0;
+    m_nViewWidth  = Desc.Width;
+    m_nViewHeight = Desc.Height;
+
+    // Allocate our own frame buffer memory in place of the DIB section
+    if ( !m_FrameBuffer.Create( Desc.Width, Desc.Height ) ) { ShutDown(); return false; }
+    m_Rasterizer.SetRenderTarget( &m_FrameBuffer );
+    if ( !m_TileRenderer.SetRenderTarget( &m_FrameBuffer ) ) { ShutDown(); return false; }
+
+    // Spin up the requested number of rasterizer threads
+    if (!m_ThreadPool.Create( Desc.ThreadCount )) { ShutDown(); return false; }
+
+    // Build Objects
+    if (!BuildObjects()) { ShutDown(); return false; }
+
+    // Set up all required game states, then apply the requested render modes
+    SetupGameState();
+    m_bFilled     = Desc.Filled;
+    m_bDirtyRects = Desc.DirtyRects;
+    m_Clipper.SetCullMode( Desc.Culling ? CClipper::CULL_CCW : CClipper::CULL_NONE );
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunHeadless ()
+// Desc : Renders the requested number of frames into memory, writing any
+//        selected frames to disk, and reports the time taken by each frame
+//        (in CSV form) followed by a summary line.
+// Note : Only the FrameAdvance call is timed, writing images is excluded.
+//        Returns a non zero exit code if anything failed.
+//-----------------------------------------------------------------------------
+int CGameApp::RunHeadless( )
+{
+    const CClipper::STATISTICS & Stats = m_Clipper.GetStatistics();
+    FILE      * pReport     = stdout;
+    FILE      * pZones      = NULL;
+    float     * pFrameTimes = NULL;
+    double      fStart, fTotal = 0.0;
+    char        szFileName[512];
+    ULONG       Frame, FrameCount = m_Headless.FrameCount;
+    int         retCode = 0;
+
+    // Validate
+    if ( !m_bHeadless ) return 1;
+    if ( FrameCount == 0 ) return 0;
+
+    // Open the report file if one was requested
+    if ( m_Headless.ReportFile )
+    {
+        pReport = fopen( m_Headless.ReportFile, "w" );
+        if ( !pReport ) { fprintf( stderr, "Unable to open report file '%s'\n", m_Headless.ReportFile ); return 1; }
+
+    } // End if report file
+
+    // Open the per frame zone summary, and capture the whole run for the trace
+    if ( m_Headless.ProfilePrefix )
+    {
+        if ( !CProfiler::IsCompiledIn() ) fprintf( stderr, "Profiler zones are not compiled in to this build (NDEBUG), no data will be recorded.\n" );
+
+        sprintf( szFileName, "%.480s_zones.csv", m_Headless.ProfilePrefix );
+        pZones = fopen( szFileName, "w" );
+        if ( !pZones ) { fprintf( stderr, "Unable to open zone summary file '%s'\n", szFileName ); retCode = 1; }
+        else fprintf( pZones, "frame,zone,calls,total_ms,self_ms,max_ms\n" );
+
+        CProfiler::Reset();
+        CProfiler::SetTraceCapture( true );
+
+    } // End if profiling
+
+    // Storage for every frame's time
+    pFrameTimes = new float[ FrameCount ];
+
+    // Write the report header
+    fprintf( pReport, "# %lux%lu, %s, culling %s, dirty rectangles %s, %lu threads\n", m_nViewWidth, m_nViewHeight,
+             m_bFilled ? "filled" : "wireframe", (m_Clipper.GetCullMode() != CClipper::CULL_NONE) ? "on" : "off",
+             m_bDirtyRects ? "on" : "off", m_ThreadPool.GetThreadCount() );
+    fprintf( pReport, "frame,ms,polygons,drawn,triangles\n" );
+
+    // Render each frame
+    for ( Frame = 0; Frame < FrameCount; Frame++ )
+    {
+        // Time the frame itself
+        fStart = m_Timer.GetTime();
+        FrameAdvance();
+        pFrameTimes[ Frame ] = (float)((m_Timer.GetTime() - fStart) * 1000.0);
+        fTotal += pFrameTimes[ Frame ];
+        PROFILE_FRAME();
+
+        // Write out this frame's zone summary
+        if ( pZones )
+        {
+            const CProfiler::ZONESUMMARY * pSummary;
+            ULONG ZoneCount = CProfiler::GetFrameSummary( &pSummary );
+            for ( ULONG i = 0; i < ZoneCount; i++ )
+            {
+                fprintf( pZones, "%lu,%s,%lu,%.4f,%.4f,%.4f\n", Frame, pSummary[i].Name, pSummary[i].Calls,
+                         pSummary[i].Total, pSummary[i].Self, pSummary[i].Max );
+            
+            } // Next Zone
+
+        } // End if zone summary
+
+        // Report it
+        fprintf( pReport, "%lu,%.3f,%lu,%lu,%lu\n", Frame, pFrameTimes[ Frame ], Stats.Submitted, Stats.Accepted,
+                 m_bFilled ? m_TileRenderer.GetTriangleCount() : 0UL );
+
+        // Write the image if this frame was selected
+        if ( IsDumpFrame( Frame ) )
+        {
+            sprintf( szFileName, "%.480s%05lu.ppm", m_Headless.OutputPrefix ? m_Headless.OutputPrefix : "", Frame );
+            if ( !m_FrameBuffer.SavePPM( szFileName ) )
+            {
+                fprintf( stderr, "Unable to write frame image '%s'\n", szFileName );
+                retCode = 1;
+
+            } // End if failed
+
+        } // End if dump frame
+
+    } // Next Frame
+
+    // Summarise (percentiles are read from the sorted frame times)
+    qsort( pFrameTimes, FrameCount, sizeof(float), CompareFrameTimes );
+    fprintf( pReport, "# %lu frames in %.1f ms : min %.3f, avg %.3f, median %.3f, p95 %.3f, max %.3f ms (%.1f fps)\n",
+             FrameCount, fTotal, pFrameTimes[0], fTotal / FrameCount, pFrameTimes[ FrameCount / 2 ],
+             pFrameTimes[ (FrameCount * 95) / 100 ], pFrameTimes[ FrameCount - 1 ],
+             (fTotal > 0.0) ? (FrameCount * 1000.0) / fTotal : 0.0 );
+
+    // Tick to tick times as seen by the timer (these include writing images)
+    CTimer::FRAMESTATS FrameStats = m_Timer.GetFrameStats();
+    const CTimer::FRAMEHISTOGRAM & Histogram = m_Timer.GetHistogram();
+    fprintf( pReport, "# tick to tick over %lu frames : min %.3f, avg %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f ms\n",
+             FrameStats.SampleCount, FrameStats.Min * 1000.0f, FrameStats.Avg * 1000.0f, FrameStats.P50 * 1000.0f,
+             FrameStats.P95 * 1000.0f, FrameStats.P99 * 1000.0f, FrameStats.Max * 1000.0f );
+    fprintf( pReport, "# histogram (%.1f ms bins) :", Histogram.BinWidth * 1000.0f );
+    for ( ULONG Bin = 0; Bin < HISTOGRAM_BIN_COUNT; Bin++ )
+    {
+        if ( Histogram.Bins[ Bin ] == 0 ) continue;
+        fprintf( pReport, " %lu%s:%lu", Bin, (Bin == HISTOGRAM_BIN_COUNT - 1) ? "+" : "", Histogram.Bins[ Bin ] );
+    
+    } // Next Bin
+    fprintf( pReport, "\n" );
+
+    // How well did the frame rate lock hold?
+    if ( m_fLockFPS > 0.0f )
+    {
+        CTimer::PACINGSTATS Pacing = m_Timer.GetPacingStats();
+        fprintf( pReport, "# paced to %.1f fps (%s) : %lu deadline misses, %lu overruns, wake jitter avg %.3f max %.3f ms, "
+                          "slept %.1f ms, spun %.1f ms\n", m_fLockFPS, (m_Timer.GetPacingMode() == CTimer::PACING_SPIN) ? "spin" : "hybrid",
+                 Pacing.DeadlineMisses, Pacing.OverrunFrames, Pacing.WakeJitterAvg * 1000.0f, Pacing.WakeJitterMax * 1000.0f,
+                 Pacing.SleepTime * 1000.0, Pacing.SpinTime * 1000.0 );
+
+    } // End if locked
+
+    // Export the captured trace
+    if ( m_Headless.ProfilePrefix )
+    {
+        CProfiler::SetTraceCapture( false );
+        if ( CProfiler::GetDroppedCount() > 0 ) fprintf( stderr, "Profiler buffers filled, %lu zones were not recorded.\n", CProfiler::GetDroppedCount() );
+
+        sprintf( szFileName, "%.480s.json", m_Headless.ProfilePrefix );
+        if ( !CProfiler::ExportChromeTrace( szFileName ) )
+        {
+            fprintf( stderr, "Unable to write profiler trace '%s'\n", szFileName );
+            retCode = 1;
+
+        } // End if failed
+
+    } // End if profiling
+
+    // Clean up
+    delete []pFrameTimes;
+    if ( pZones ) fclose( pZones );
+    if ( pReport != stdout ) fclose( pReport );
+
+    return retCode;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsDumpFrame () (Private)
+// Desc : Determine whether the specified frame should be written to disk
+//        during a headless run.
+//-----------------------------------------------------------------------------
+bool CGameApp::IsDumpFrame( ULONG Frame ) const
+{
+    // Every Nth frame?
+    if ( m_Headless.DumpInterval > 0 && (Frame % m_Headless.DumpInterval) == 0 ) return true;
+
+    // Individually listed?
+    for ( ULONG i = 0; i < m_Headless.DumpFrameCount; i++ )
+    {
+        if ( m_Headless.DumpFrames[i] == Frame ) return true;
+
+    } // Next Listed Frame
+
+    return false;
+}
 
 //-----------------------------------------------------------------------------
 // Name : ClearFrameBuffer () (Private)
 // Desc : Clears the Frame Buffer (fills with the value passed)
+// Note : With dirty rectangles enabled, only the area drawn into during the
+//        previous frame is cleared, since everything outside of it still
+//        holds the clear colour.
 //-----------------------------------------------------------------------------
 void CGameApp::ClearFrameBuffer( ULONG Color )
 {
+    PROFILE_ZONE( "ClearFrameBuffer" );
+    // Stripped of alpha, the colour matches the DIB's pixel layout
+    Color &= 0x00FFFFFF;
 
-    LOGBRUSH logBrush;
-    HBRUSH   hBrush = NULL, hOldBrush = NULL;
-    
-    // Set up the rendering brush
-    logBrush.lbStyle = BS_SOLID;
-    
-    // Set up the colour, converted to BGR & stripped of alpha
-    logBrush.lbColor = 0x00FFFFFF & RGB2BGR( Color );
-    
-    // Create the rendering brush
-    hBrush = ::CreateBrushIndirect( &logBrush );
-    if (!hBrush) return;
+    // Can we get away with clearing just last frame's drawing?
+    if ( m_bDirtyRects && m_bClearValid && Color == m_nClearColor )
+    {
+        m_rcCleared = m_FrameBuffer.GetDirtyRect();
+        m_FrameBuffer.ClearRect( m_rcCleared, Color );
+
+    } // End if dirty clear
+    else
+    {
+        // Fill the pixels directly
+        m_FrameBuffer.Clear( Color );
+        m_rcCleared.Left  = 0; m_rcCleared.Right  = (long)m_FrameBuffer.GetWidth();
+        m_rcCleared.Top   = 0; m_rcCleared.Bottom = (long)m_FrameBuffer.GetHeight();
 
-    // Select into the frame buffer DC
-    hOldBrush = (HBRUSH)::SelectObject( m_hdcFrameBuffer, hBrush );
+    } // End if full clear
 
-    // Draw the rectangle
-    Rectangle( m_hdcFrameBuffer, m_nViewX, m_nViewY, m_nViewWidth, m_nViewHeight );
-    
-    // Destroy rendering brush
-    ::SelectObject( m_hdcFrameBuffer, hOldBrush );
-    ::DeleteObject( hBrush );
+    // Start tracking this frame's drawing
+    m_FrameBuffer.ResetDirtyRect();
+    m_bClearValid = m_bDirtyRects;
+    m_nClearColor = Color;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MarkDirty () (Private)
+// Desc : Adds the screen space bounds of a (clipped) polygon to the frame
+//        buffer's dirty rectangle, when dirty rectangles are enabled.
+// Note : The bounds are clamped to the viewport, and a pixel of slack is
+//        added on all sides to cover rounding.
+//-----------------------------------------------------------------------------
+void CGameApp::MarkDirty( const float * pVertices, ULONG Count )
+{
+    float MinX, MinY, MaxX, MaxY, Left, Top, Right, Bottom;
+
+    // Validate
+    if ( !m_bDirtyRects || Count == 0 ) return;
+
+    // Find the bounds
+    MinX = MaxX = pVertices[0];
+    MinY = MaxY = pVertices[1];
+    for ( ULONG v = 1; v < Count; v++ )
+    {
+        const float * pVertex = &pVertices[ v * 3 ];
+        if ( pVertex[0] < MinX ) MinX = pVertex[0];
+        if ( pVertex[0] > MaxX ) MaxX = pVertex[0];
+        if ( pVertex[1] < MinY ) MinY = pVertex[1];
+        if ( pVertex[1] > MaxY ) MaxY = pVertex[1];
+
+    } // Next Vertex
 
+    // Only the near plane is clipped, so a polygon straddling the sides of
+    // the frustum can reach far beyond the viewport. Clamp to the viewport
+    // before converting, AddDirtyRect then clamps to the frame buffer.
+    Left   = (float)m_nViewX;
+    Top    = (float)m_nViewY;
+    Right  = Left + (float)m_nViewWidth;
+    Bottom = Top  + (float)m_nViewHeight;
+    if ( !(MinX >= Left)   ) MinX = Left;
+    if ( !(MinY >= Top)    ) MinY = Top;
+    if ( !(MaxX <= Right)  ) MaxX = Right;
+    if ( !(MaxY <= Bottom) ) MaxY = Bottom;
+
+    m_FrameBuffer.AddDirtyRect( (long)MinX - 1, (long)MinY - 1, (long)MaxX + 2, (long)MaxY + 2 );
 }
 
 //-----------------------------------------------------------------------------
 // Name : PresentFrameBuffer ()
 // Desc : We can now render the frame buffer to the final output device
+// Note : This is the only place in which GDI is used during the frame.
 //-----------------------------------------------------------------------------
 void CGameApp::PresentFrameBuffer( )
 {    
-    HDC hDC = NULL; 
+    PROFILE_ZONE( "PresentFrameBuffer" );
+
+#if defined(_WIN32)
+    HDC  hDC = NULL; 
+    RECT rcText = { 5, 5, (LONG)m_nViewWidth, (LONG)m_nViewHeight };
+    CFrameBuffer::DIRTYRECT rcBlit;
+
+    // Headless frames simply stay in memory
+    if ( m_bHeadless ) return;
+
+    // Draw any overlay text into the frame buffer
+    if ( m_szOverlay[0] ) 
+    {
+        // The text must be cleared again next frame
+        if ( m_bDirtyRects )
+        {
+            RECT rcBounds = rcText;
+            ::DrawText( m_hdcFrameBuffer, m_szOverlay, -1, &rcBounds, DT_LEFT | DT_TOP | DT_NOCLIP | DT_CALCRECT );
+            m_FrameBuffer.AddDirtyRect( rcBounds.left, rcBounds.top, rcBounds.right, rcBounds.bottom );
+
+        } // End if dirty rectangles
+
+        ::DrawText( m_hdcFrameBuffer, m_szOverlay, -1, &rcText, DT_LEFT | DT_TOP | DT_NOCLIP );
+
+    } // End if overlay
+
+    // Work out which part of the frame buffer needs copying to the window
+    if ( !m_bDirtyRects || m_bFullPresent )
+    {
+        // Everything
+        rcBlit.Left  = m_nViewX; rcBlit.Right  = m_nViewX + m_nViewWidth;
+        rcBlit.Top   = m_nViewY; rcBlit.Bottom = m_nViewY + m_nViewHeight;
+
+    } // End if full present
+    else
+    {
+        // Only the cleared and newly drawn areas can differ from what is on screen
+        rcBlit = m_rcCleared;
+        CFrameBuffer::UnionRect( rcBlit, m_FrameBuffer.GetDirtyRect() );
+
+    } // End if partial present
+    m_bFullPresent = false;
+
+    // Anything to copy?
+    if ( rcBlit.Left >= rcBlit.Right || rcBlit.Top >= rcBlit.Bottom ) return;
 
     // Retrieve the DC of the window
     hDC = ::GetDC(m_hWnd);
 
     // Blit the frame buffer to the screen
-    ::BitBlt( hDC, m_nViewX, m_nViewY, m_nViewWidth, m_nViewHeight, m_hdcFrameBuffer,
-              m_nViewX, m_nViewY, SRCCOPY );
+    ::BitBlt( hDC, rcBlit.Left, rcBlit.Top, rcBlit.Right - rcBlit.Left, rcBlit.Bottom - rcBlit.Top, m_hdcFrameBuffer,
+              rcBlit.Left, rcBlit.Top, SRCCOPY );
 
     // Clean up
     ::ReleaseDC( m_hWnd, hDC );
 
+    // Make sure GDI has finished with the pixels before we next write to them
+    ::GdiFlush();
+#endif // _WIN32
+
 }
 
 //-----------------------------------------------------------------------------
 // Name : DrawLine () (Private)
-// Desc : Simple line drawing using GDI for clarity.
+// Desc : Draw a line directly into the frame buffer memory.
 //-----------------------------------------------------------------------------
 void CGameApp::DrawLine( const D3DXVECTOR3 & vtx1, const D3DXVECTOR3 & vtx2, ULONG Color )
 {
-    LOGPEN logPen;
-    HPEN   hPen = NULL, hOldPen = NULL;
-    
-    // Set up the rendering pen
-    logPen.lopnStyle   = PS_SOLID;
-    logPen.lopnWidth.x = 1;
-    logPen.lopnWidth.y = 1;
-
-    // Set up the colour, converted to BGR & stripped of alpha
-    logPen.lopnColor   = 0x00FFFFFF & RGB2BGR( Color ); 
-    
-    // Create the rendering pen
-    hPen = ::CreatePenIndirect( &logPen );
-    if (!hPen) return;
-
-    // Select into the frame buffer DC
-    hOldPen = (HPEN)::SelectObject( m_hdcFrameBuffer, hPen );
-
-    // Draw the line segment
-    MoveToEx( m_hdcFrameBuffer, (long)vtx1.x, (long)vtx1.y, NULL );
-    LineTo( m_hdcFrameBuffer, (long)vtx2.x, (long)vtx2.y );
-
-    // Destroy rendering pen
-    ::SelectObject( m_hdcFrameBuffer, hOldPen );
-    ::DeleteObject( hPen );
-    
+    // Stripped of alpha, the colour matches the DIB's pixel layout
+    m_Rasterizer.DrawLine( vtx1.x, vtx1.y, vtx2.x, vtx2.y, 0x00FFFFFF & Color );
 }
 
 //-----------------------------------------------------------------------------
@@ -248,13 +596,23 @@ void CGameApp::SetupGameState()
 
     // Set up a perspective projection matrix
     D3DXMatrixPerspectiveFovLH( &m_mtxProjection, D3DXToRadian( 60.0f ), fAspect, 1.01f, 1000.0f );
+
+    // Set up the matrix mapping projected coordinates to the viewport
+    CTransform::BuildViewportMatrix( (float*)&m_mtxViewport, (float)m_nViewX, (float)m_nViewY, (float)m_nViewWidth, (float)m_nViewHeight );
+    m_Clipper.SetViewport( (float)m_nViewX, (float)m_nViewY, (float)m_nViewWidth, (float)m_nViewHeight );
     
     // Enable rotation
     m_bRotation1 = true;
     m_bRotation2 = true;
 
+    // Start out in wireframe, with back faces visible, clearing the whole frame
+    m_bFilled     = false;
+    m_bDirtyRects = false;
+    m_Clipper.SetCullMode( CClipper::CULL_NONE );
+
 }
 
+#if defined(_WIN32)
 //-----------------------------------------------------------------------------
 // Name : BeginGame ()
 // Desc : Signals the beginning of the physical post-initialisation stage.
@@ -278,6 +636,7 @@ int CGameApp::BeginGame()
         {
 			// Advance Game Frame.
 			FrameAdvance();
+            PROFILE_FRAME();
 
 		} // End If messages waiting
 	
@@ -285,6 +644,7 @@ int CGameApp::BeginGame()
 
     return 0;
 }
+#endif // _WIN32
 
 //-----------------------------------------------------------------------------
 // Name : ShutDown ()
@@ -292,6 +652,15 @@ int CGameApp::BeginGame()
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+    // Detach from the frame buffer pixels
+    m_Rasterizer.SetRenderTarget( NULL );
+    m_TileRenderer.Release();
+    m_FrameBuffer.Release();
+
+    // Stop the rasterizer threads
+    m_ThreadPool.Release();
+
+#if defined(_WIN32)
     // Destroy the frame buffer and associated DC's
     if ( m_hdcFrameBuffer && m_hbmFrameBuffer )
     {
@@ -303,16 +672,24 @@ bool CGameApp::ShutDown()
 
     // Destroy the render window
     if ( m_hWnd ) DestroyWindow( m_hWnd );
+#endif // _WIN32
+
+    // Release the transformed vertex cache
+    m_Clipper.Release();
     
     // Clear all variables
+#if defined(_WIN32)
     m_hWnd              = NULL;
     m_hbmFrameBuffer    = NULL;
     m_hdcFrameBuffer    = NULL;
+#endif
+    m_bHeadless         = false;
     
     // Shutdown Success
     return true;
 }
 
+#if defined(_WIN32)
 //-----------------------------------------------------------------------------
 // Name : StaticWndProc () (Static Callback)
 // Desc : This is the main messge pump for ALL display devices, it captures
@@ -369,12 +746,20 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
             // Set up new perspective projection matrix
             fAspect = (float)m_nViewWidth / (float)m_nViewHeight;
             D3DXMatrixPerspectiveFovLH( &m_mtxProjection, D3DXToRadian( 60.0f ), fAspect, 1.01f, 1000.0f );
+            CTransform::BuildViewportMatrix( (float*)&m_mtxViewport, (float)m_nViewX, (float)m_nViewY, (float)m_nViewWidth, (float)m_nViewHeight );
+            m_Clipper.SetViewport( (float)m_nViewX, (float)m_nViewY, (float)m_nViewWidth, (float)m_nViewHeight );
 
             // Rebuild the new frame buffer
             BuildFrameBuffer( m_nViewWidth, m_nViewHeight );
 
 			break;
 
+        case WM_PAINT:
+
+            // Some of the window was uncovered, so make sure all of it is copied next frame
+            m_bFullPresent = true;
+            return DefWindowProc( hWnd, Message, wParam, lParam );
+
         case WM_KEYDOWN:
 
             // Which key was pressed?
@@ -407,6 +792,28 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
                                      MF_BYCOMMAND | (m_bRotation2) ? MF_CHECKED :  MF_UNCHECKED );
                     break;
 
+                case ID_RENDER_WIREFRAME:
+                case ID_RENDER_FILLED:
+                    // Switch between the line and tile renderers
+                    m_bFilled = ( LOWORD(wParam) == ID_RENDER_FILLED );
+                    ::CheckMenuItem( ::GetMenu( m_hWnd ), ID_RENDER_WIREFRAME, MF_BYCOMMAND | (m_bFilled ? MF_UNCHECKED : MF_CHECKED) );
+                    ::CheckMenuItem( ::GetMenu( m_hWnd ), ID_RENDER_FILLED,    MF_BYCOMMAND | (m_bFilled ? MF_CHECKED : MF_UNCHECKED) );
+                    break;
+
+                case ID_RENDER_CULLING:
+                    // Disable / enable back face culling (clockwise polygons face the viewer)
+                    m_Clipper.SetCullMode( (m_Clipper.GetCullMode() == CClipper::CULL_NONE) ? CClipper::CULL_CCW : CClipper::CULL_NONE );
+                    ::CheckMenuItem( ::GetMenu( m_hWnd ), ID_RENDER_CULLING,
+                                     MF_BYCOMMAND | ((m_Clipper.GetCullMode() != CClipper::CULL_NONE) ? MF_CHECKED : MF_UNCHECKED) );
+                    break;
+
+                case ID_RENDER_DIRTYRECTS:
+                    // Disable / enable partial clears and presents
+                    m_bDirtyRects = !m_bDirtyRects;
+                    ::CheckMenuItem( ::GetMenu( m_hWnd ), ID_RENDER_DIRTYRECTS,
+                                     MF_BYCOMMAND | (m_bDirtyRects ? MF_CHECKED : MF_UNCHECKED) );
+                    break;
+
                 case ID_EXIT:
                     // Recieved key/menu command to exit app
                     SendMessage( m_hWnd, WM_CLOSE, 0, 0 );
@@ -421,6 +828,7 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
     
     return 0;
 }
+#endif // _WIN32
 
 //-----------------------------------------------------------------------------
 // Name : BuildObjects ()
@@ -487,9 +895,14 @@ bool CGameApp::BuildObjects()
     pPoly->m_pVertex[2] = CVertex(  2, -2,  2 );
     pPoly->m_pVertex[3] = CVertex(  2, -2, -2 );
 
+    // Build the shared vertex version of the mesh used for rendering
+    if ( !m_IndexedMesh.BuildFromMesh( &m_Mesh ) ) return false;
+
     // Our two objects should reference this mesh
     m_pObject[ 0 ].m_pMesh = &m_Mesh;
     m_pObject[ 1 ].m_pMesh = &m_Mesh;
+    m_pObject[ 0 ].m_pIndexedMesh = &m_IndexedMesh;
+    m_pObject[ 1 ].m_pIndexedMesh = &m_IndexedMesh;
 
     // Set both objects matrices so that they are offset slightly
     D3DXMatrixTranslation( &m_pObject[ 0 ].m_mtxWorld, -3.5f,  2.0f, 14.0f );
@@ -505,37 +918,93 @@ bool CGameApp::BuildObjects()
 //-----------------------------------------------------------------------------
 void CGameApp::FrameAdvance()
 {
-    CMesh      *pMesh = NULL;
+    PROFILE_ZONE( "FrameAdvance" );
+    CIndexedMesh *pMesh = NULL;
     TCHAR       lpszFPS[30];
+    D3DXMATRIX  mtxTransform;
+    ULONG       UnindexedCount = 0;
+    const CClipper::STATISTICS & Stats = m_Clipper.GetStatistics();
+    static const ULONG FaceColors[6] = { 0xC04040, 0x40C040, 0x4040C0, 0xC0C040, 0xC040C0, 0x40C0C0 };
 
-    // Advance the timer
-    m_Timer.Tick( 60.0f );
+    // Advance the timer (any frame rate lock waits in here)
+    {
+        PROFILE_ZONE( "Tick" );
+        m_Timer.Tick( m_fLockFPS );
+    }
     
     // Animate the two objects
     AnimateObjects();
 
     // Clear the frame buffer ready for drawing
     ClearFrameBuffer( 0x00FFFFFF );
+
+    // Reset per frame statistics
+    m_nTransformCount = 0;
+    m_Clipper.ResetStatistics();
+
+    // Discard last frame's triangle bins
+    if ( m_bFilled ) m_TileRenderer.BeginFrame();
     
     // Loop through each object
     for ( ULONG i = 0; i < 2; i++ )
     {
+        PROFILE_ZONE( "DrawObject" );
+
         // Store mesh for easy access
-        pMesh = m_pObject[i].m_pMesh;
+        pMesh = m_pObject[i].m_pIndexedMesh;
+
+        // Concatenate World, View, Projection & Viewport into a single matrix
+        D3DXMatrixMultiply( &mtxTransform, &m_pObject[i].m_mtxWorld, &m_mtxView );
+        D3DXMatrixMultiply( &mtxTransform, &mtxTransform, &m_mtxProjection );
+        D3DXMatrixMultiply( &mtxTransform, &mtxTransform, &m_mtxViewport );
+        m_Transform.SetMatrix( (float*)&mtxTransform );
+
+        // Transform the shared vertex pool once for this object
+        TransformMesh( pMesh );
 
         // Loop through each polygon
         for ( ULONG f = 0; f < pMesh->m_nPolygonCount; f++ )
         {
             // Render the primitive
-            DrawPrimitive( pMesh->m_pPolygon[f], &m_pObject[i].m_mtxWorld );
+            if ( m_bFilled )
+                DrawPrimitiveFilled( pMesh, f, FaceColors[ f % 6 ] );
+            else
+                DrawPrimitive( pMesh, f );
+
+            // Tally the vertices the per-polygon layout would have transformed
+            UnindexedCount += pMesh->m_pPolygon[f].m_nIndexCount;
     
         } // Next Polygon
     
     } // Next Object
 
-    // Display Frame Rate
+    // Rasterize the binned triangles across the thread pool
+    if ( m_bFilled ) m_TileRenderer.EndFrame( &m_ThreadPool );
+
+    // Build the frame rate & vertex transformation statistics overlay
     m_Timer.GetFrameRate( lpszFPS );
-    TextOut( m_hdcFrameBuffer, 5, 5, lpszFPS, strlen( lpszFPS ) ); 
+    _stprintf( m_szOverlay, _T("%s\n%lu vertices transformed (%lu unindexed)"), lpszFPS, m_nTransformCount, UnindexedCount );
+    _stprintf( m_szOverlay + _tcslen( m_szOverlay ), _T("\n%lu polygons : %lu rejected, %lu near clipped, %lu culled, %lu drawn"),
+               Stats.Submitted, Stats.FrustumRejected, Stats.NearClipped, Stats.BackFaceCulled, Stats.Accepted );
+    if ( m_bFilled )
+    {
+        _stprintf( m_szOverlay + _tcslen( m_szOverlay ), _T("\n%lu triangles, %lu tiles, %lu threads"),
+                   m_TileRenderer.GetTriangleCount(), m_TileRenderer.GetTileCount(), m_ThreadPool.GetThreadCount() );
+
+    } // End if filled
+
+    // Frame time distribution, the hitches are hidden by the frame rate alone
+    CTimer::FRAMESTATS FrameStats = m_Timer.GetFrameStats();
+    _stprintf( m_szOverlay + _tcslen( m_szOverlay ), _T("\nframe ms : avg %.2f, p95 %.2f, p99 %.2f, max %.2f"),
+               FrameStats.Avg * 1000.0f, FrameStats.P95 * 1000.0f, FrameStats.P99 * 1000.0f, FrameStats.Max * 1000.0f );
+
+    if ( m_fLockFPS > 0.0f )
+    {
+        CTimer::PACINGSTATS Pacing = m_Timer.GetPacingStats();
+        _stprintf( m_szOverlay + _tcslen( m_szOverlay ), _T("\n%lu deadline misses, wake jitter %.2f ms (max %.2f)"),
+                   Pacing.DeadlineMisses, Pacing.WakeJitterAvg * 1000.0f, Pacing.WakeJitterMax * 1000.0f );
+
+    } // End if locked
     
     // Present the buffer
     PresentFrameBuffer();
@@ -543,61 +1012,102 @@ void CGameApp::FrameAdvance()
 }
 
 //-----------------------------------------------------------------------------
-// Name : DrawPrimitive () (Private)
-// Desc : This function renders an individual polygon.
+// Name : TransformMesh () (Private)
+// Desc : Transforms the mesh's shared vertex pool into the clipper's vertex
+//        cache, ready for each of its polygons to be clipped and drawn.
+// Note : The transformation matrix must already have been set on m_Transform.
 //-----------------------------------------------------------------------------
-void CGameApp::DrawPrimitive( CPolygon * pPoly, D3DXMATRIX * pmtxWorld )
+void CGameApp::TransformMesh( CIndexedMesh * pMesh )
 {
-    D3DXVECTOR3 vtxPrevious, vtxCurrent;
+    PROFILE_ZONE( "TransformMesh" );
+    // Transform and classify every vertex in one pass
+    if ( !m_Clipper.ProcessVertices( m_Transform, (float*)pMesh->m_pVertex, pMesh->m_nVertexCount ) ) return;
+    m_nTransformCount += pMesh->m_nVertexCount;
+}
 
-    // Loop round each vertex transforming as we go
-    for ( USHORT v = 0; v < pPoly->m_nVertexCount + 1; v++ ) 
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitive () (Private)
+// Desc : This function renders an individual polygon of the specified mesh,
+//        after passing it through the clip space stage.
+// Note : TransformMesh must have been called for this mesh beforehand.
+//-----------------------------------------------------------------------------
+void CGameApp::DrawPrimitive( CIndexedMesh * pMesh, ULONG Polygon )
+{
+    const CIndexedPolygon & Poly = pMesh->m_pPolygon[ Polygon ];
+    const float * pVertex, * pPrevious, * pCurrent;
+    ULONG         Count;
+
+    // Reject, clip and cull. Nothing left to draw?
+    Count = m_Clipper.ClipPolygon( &pMesh->m_pIndex[ Poly.m_nFirstIndex ], Poly.m_nIndexCount );
+    if ( Count == 0 ) return;
+    pVertex   = m_Clipper.GetClippedVertices();
+    pPrevious = &pVertex[ (Count - 1) * 3 ];
+    MarkDirty( pVertex, Count );
+
+    // Loop round each edge, starting with the closing edge
+    for ( ULONG v = 0; v < Count; v++ ) 
     {
-        // Store the current vertex
-        vtxCurrent = (D3DXVECTOR3&)pPoly->m_pVertex[ v % pPoly->m_nVertexCount ];
-
-        // Multiply the vertex position by the World / object matrix
-        D3DXVec3TransformCoord( &vtxCurrent, &vtxCurrent, pmtxWorld );
-
-        // Multiply by View matrix
-        D3DXVec3TransformCoord( &vtxCurrent, &vtxCurrent, &m_mtxView );
-
-        // Multiply by Projection matrix
-        D3DXVec3TransformCoord( &vtxCurrent, &vtxCurrent, &m_mtxProjection );
-
-        // Convert to screen space coordinates
-        vtxCurrent.x =   vtxCurrent.x * m_nViewWidth  / 2 + m_nViewX + m_nViewWidth  / 2;
-        vtxCurrent.y =  -vtxCurrent.y * m_nViewHeight / 2 + m_nViewY + m_nViewHeight / 2;
-
-        // If this is the first vertex, continue. This is the first point of our first line.
-        if ( v == 0 ) { vtxPrevious = vtxCurrent; continue; }
+        pCurrent = &pVertex[ v * 3 ];
 
         // Draw the line
-        DrawLine( vtxPrevious, vtxCurrent, 0 );
+        DrawLine( D3DXVECTOR3( pPrevious[0], pPrevious[1], pPrevious[2] ),
+                  D3DXVECTOR3( pCurrent[0], pCurrent[1], pCurrent[2] ), 0 );
 
         // Store this as new line's first point
-        vtxPrevious = vtxCurrent; 
+        pPrevious = pCurrent;
 
     } // Next Vertex
 }
 
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitiveFilled () (Private)
+// Desc : Passes an individual polygon of the specified mesh through the clip
+//        space stage, and submits what remains to the tile renderer as a
+//        triangle fan.
+// Note : Nothing is drawn until the tile renderer's EndFrame is called.
+//-----------------------------------------------------------------------------
+void CGameApp::DrawPrimitiveFilled( CIndexedMesh * pMesh, ULONG Polygon, ULONG Color )
+{
+    const CIndexedPolygon & Poly = pMesh->m_pPolygon[ Polygon ];
+    const float * pVertex;
+    ULONG         Count;
+
+    // Reject, clip and cull. Nothing left to draw?
+    Count = m_Clipper.ClipPolygon( &pMesh->m_pIndex[ Poly.m_nFirstIndex ], Poly.m_nIndexCount );
+    if ( Count < 3 ) return;
+    pVertex = m_Clipper.GetClippedVertices();
+    MarkDirty( pVertex, Count );
+
+    // The first vertex is shared by every triangle in the fan
+    for ( ULONG v = 1; v + 1 < Count; v++ )
+    {
+        // Bin the triangle, stripped of alpha
+        m_TileRenderer.DrawTriangle( &pVertex[0], &pVertex[ v * 3 ], &pVertex[ (v + 1) * 3 ], 0x00FFFFFF & Color );
+
+    } // Next Triangle
+}
+
 //-----------------------------------------------------------------------------
 // Name : AnimateObjects () (Private)
 // Desc : Animates the objects we currently have loaded.
 //-----------------------------------------------------------------------------
 void CGameApp::AnimateObjects()
 {
+    PROFILE_ZONE( "AnimateObjects" );
     // Note : Expanded for the purposes of this example only.
     D3DXMATRIX mtxYaw, mtxPitch, mtxRoll, mtxRotate;
     float RotationYaw, RotationPitch, RotationRoll;
 
+    // Headless runs may advance by a fixed step so that their frames are reproducible
+    float fTimeElapsed = ( m_bHeadless && m_Headless.TimeStep > 0.0f ) ? m_Headless.TimeStep : m_Timer.GetTimeElapsed();
+
     // Rotate Object 1 by small amount
     if ( m_bRotation1 )
     {
         // Calculate rotation values for object 0
-        RotationYaw   = D3DXToRadian( 75.0f * m_Timer.GetTimeElapsed() );
-        RotationPitch = D3DXToRadian( 50.0f * m_Timer.GetTimeElapsed() );
-        RotationRoll  = D3DXToRadian( 25.0f * m_Timer.GetTimeElapsed() );
+        RotationYaw   = D3DXToRadian( 75.0f * fTimeElapsed );
+        RotationPitch = D3DXToRadian( 50.0f * fTimeElapsed );
+        RotationRoll  = D3DXToRadian( 25.0f * fTimeElapsed );
 
         // Build rotation matrices 
         D3DXMatrixIdentity( &mtxRotate );
@@ -619,9 +1129,9 @@ void CGameApp::AnimateObjects()
     if ( m_bRotation2 )
     {
         // Calculate rotation values for object 1
-        RotationYaw   = D3DXToRadian( -25.0f * m_Timer.GetTimeElapsed() );
-        RotationPitch = D3DXToRadian(  50.0f * m_Timer.GetTimeElapsed() );
-        RotationRoll  = D3DXToRadian( -75.0f * m_Timer.GetTimeElapsed() );
+        RotationYaw   = D3DXToRadian( -25.0f * fTimeElapsed );
+        RotationPitch = D3DXToRadian(  50.0f * fTimeElapsed );
+        RotationRoll  = D3DXToRadian( -75.0f * fTimeElapsed );
 
         // Build rotation matrices 
         D3DXMatrixIdentity( &mtxRotate );
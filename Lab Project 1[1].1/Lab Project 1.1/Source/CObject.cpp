@@ -9,7 +9,7 @@
 //-----------------------------------------------------------------------------
 // CObject Specific Includes
 //-----------------------------------------------------------------------------
-#include "..\\Includes\\CObject.h"
+#include "../Includes/CObject.h"
 
 //-----------------------------------------------------------------------------
 // Name : CObject () (Constructor)
@@ -18,7 +18,8 @@
 CObject::CObject()
 {
 	// Reset / Clear all required values
-    m_pMesh = NULL;
+    m_pMesh         = NULL;
+    m_pIndexedMesh  = NULL;
     D3DXMatrixIdentity( &m_mtxWorld );
 }
 
@@ -32,7 +33,8 @@ CObject::CObject( CMesh * pMesh )
     D3DXMatrixIdentity( &m_mtxWorld );
 
     // Set Mesh
-    m_pMesh = pMesh;
+    m_pMesh         = pMesh;
+    m_pIndexedMesh  = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -42,8 +44,13 @@ CObject::CObject( CMesh * pMesh )
 CMesh::CMesh()
 {
 	// Reset / Clear all required values
-    m_nPolygonCount = 0;
-    m_pPolygon      = NULL;
+    m_nPolygonCount     = 0;
+    m_pPolygon          = NULL;
+    m_nVertexCount      = 0;
+    m_pVertex           = NULL;
+    m_pPolygonPool      = NULL;
+    m_nPolygonCapacity  = 0;
+    m_nVertexCapacity   = 0;
 
 }
 
@@ -54,8 +61,13 @@ CMesh::CMesh()
 CMesh::CMesh( ULONG Count )
 {
 	// Reset / Clear all required values
-    m_nPolygonCount = 0;
-    m_pPolygon      = NULL;
+    m_nPolygonCount     = 0;
+    m_pPolygon          = NULL;
+    m_nVertexCount      = 0;
+    m_pVertex           = NULL;
+    m_pPolygonPool      = NULL;
+    m_nPolygonCapacity  = 0;
+    m_nVertexCapacity   = 0;
 
     // Add Polygons
     AddPolygon( Count );
@@ -67,24 +79,19 @@ CMesh::CMesh( ULONG Count )
 //-----------------------------------------------------------------------------
 CMesh::~CMesh()
 {
-	// Release our mesh components
-    if ( m_pPolygon ) 
-    {
-        // Delete all individual polygons in the array.
-        for ( ULONG i = 0; i < m_nPolygonCount; i++ )
-        {
-            if ( m_pPolygon[i] ) delete m_pPolygon[i];
-        
-        } // Next Polygon
-
-        // Free up the array itself
-        delete []m_pPolygon;
-    
-    } // End if
+	// Release our mesh components (the polygons do not own their vertices)
+    if ( m_pPolygonPool ) delete []m_pPolygonPool;
+    if ( m_pPolygon     ) delete []m_pPolygon;
+    if ( m_pVertex      ) delete []m_pVertex;
 
     // Clear variables
-    m_pPolygon      = NULL;
-    m_nPolygonCount = 0;
+    m_pPolygon          = NULL;
+    m_nPolygonCount     = 0;
+    m_pVertex           = NULL;
+    m_nVertexCount      = 0;
+    m_pPolygonPool      = NULL;
+    m_nPolygonCapacity  = 0;
+    m_nVertexCapacity   = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -94,42 +101,291 @@ CMesh::~CMesh()
 //-----------------------------------------------------------------------------
 long CMesh::AddPolygon( ULONG Count )
 {
+    // Make sure there is room for the new polygons
+    if ( !ReservePolygons( m_nPolygonCount + Count ) ) return -1;
+
+    // Initialise each new polygon as an empty span at the end of the pool
+    for ( ULONG i = 0; i < Count; i++ )
+    {
+        CPolygon * pPoly = &m_pPolygonPool[ m_nPolygonCount ];
+        pPoly->m_pMesh        = this;
+        pPoly->m_nFirstVertex = m_nVertexCount;
+        pPoly->m_nVertexCount = 0;
+        pPoly->m_pVertex      = m_pVertex + m_nVertexCount;
 
-    CPolygon ** pPolyBuffer = NULL;
+        // Increase overall poly count
+        m_pPolygon[ m_nPolygonCount++ ] = pPoly;
+
+    } // Next Polygon
     
-    // Allocate new resized array
-    if (!( pPolyBuffer = new CPolygon*[ m_nPolygonCount + Count ] )) return -1;
+    // Return first polygon
+    return m_nPolygonCount - Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reserve()
+// Desc : Pre-allocate room for the specified total number of polygons and
+//        vertices, so that a mesh whose size is known up front can be built
+//        without any further allocation.
+//-----------------------------------------------------------------------------
+bool CMesh::Reserve( ULONG PolygonCount, ULONG VertexCount )
+{
+    return ReservePolygons( PolygonCount ) && ReserveVertices( VertexCount );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReservePolygons() (Private)
+// Desc : Ensure the polygon array can hold at least Count polygons, growing
+//        it geometrically if it cannot.
+//-----------------------------------------------------------------------------
+bool CMesh::ReservePolygons( ULONG Count )
+{
+    CPolygon  * pNewPool  = NULL;
+    CPolygon ** pNewTable = NULL;
+    ULONG       Capacity, i;
+
+    // Already large enough?
+    if ( Count <= m_nPolygonCapacity ) return true;
 
-    // Clear out slack pointers
-    ZeroMemory( &pPolyBuffer[ m_nPolygonCount ], Count * sizeof( CPolygon* ) );
+    // At least double the current size
+    Capacity = ( m_nPolygonCapacity < 8 ) ? 8 : m_nPolygonCapacity * 2;
+    if ( Capacity < Count ) Capacity = Count;
 
-    // Existing Data?
-    if ( m_pPolygon )
+    // Allocate the new arrays
+    pNewPool  = new CPolygon[ Capacity ];
+    pNewTable = new CPolygon*[ Capacity ];
+    if ( !pNewPool || !pNewTable ) { delete []pNewPool; delete []pNewTable; return false; }
+
+    // Move the existing polygons over (their vertex spans are unaffected)
+    for ( i = 0; i < m_nPolygonCount; i++ )
     {
-        // Copy old data into new buffer
-        memcpy( pPolyBuffer, m_pPolygon, m_nPolygonCount * sizeof( CPolygon* ) );
+        pNewPool[i]  = m_pPolygonPool[i];
+        pNewTable[i] = &pNewPool[i];
+
+    } // Next Polygon
+
+    // Release the old arrays
+    if ( m_pPolygonPool ) delete []m_pPolygonPool;
+    if ( m_pPolygon     ) delete []m_pPolygon;
 
-        // Release old buffer
-        delete []m_pPolygon;
+    // Store new arrays
+    m_pPolygonPool     = pNewPool;
+    m_pPolygon         = pNewTable;
+    m_nPolygonCapacity = Capacity;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReserveVertices() (Private)
+// Desc : Ensure the vertex pool can hold at least Count vertices, growing it
+//        geometrically if it cannot.
+// Note : Every polygon's m_pVertex is updated if the pool moves.
+//-----------------------------------------------------------------------------
+bool CMesh::ReserveVertices( ULONG Count )
+{
+    CVertex * pNewPool = NULL;
+    ULONG     Capacity, i;
+
+    // Already large enough?
+    if ( Count <= m_nVertexCapacity ) return true;
+
+    // At least double the current size
+    Capacity = ( m_nVertexCapacity < 32 ) ? 32 : m_nVertexCapacity * 2;
+    if ( Capacity < Count ) Capacity = Count;
+
+    // Allocate the new pool and copy the existing vertices over
+    if (!( pNewPool = new CVertex[ Capacity ] )) return false;
+    if ( m_pVertex )
+    {
+        memcpy( pNewPool, m_pVertex, m_nVertexCount * sizeof(CVertex) );
+        delete []m_pVertex;
 
     } // End if
-    
-    // Store pointer for new buffer
-    m_pPolygon = pPolyBuffer;
 
-    // Allocate new polygon pointers
-    for ( UINT i = 0; i < Count; i++ )
+    // Store new pool
+    m_pVertex         = pNewPool;
+    m_nVertexCapacity = Capacity;
+
+    // Re-point each polygon at its span
+    for ( i = 0; i < m_nPolygonCount; i++ ) m_pPolygonPool[i].m_pVertex = m_pVertex + m_pPolygonPool[i].m_nFirstVertex;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GrowPolygon() (Private)
+// Desc : Adds vertices to the span of one of this mesh's polygons.
+// Note : Spans at the end of the pool (the usual case when building a mesh
+//        one polygon at a time) simply grow in place. Any other span must be
+//        moved to the end of the pool, and the space it occupied is not
+//        reused. Returns the index of the first vertex added, or -1.
+//-----------------------------------------------------------------------------
+long CMesh::GrowPolygon( CPolygon * pPoly, USHORT Count )
+{
+    ULONG OldCount = pPoly->m_nVertexCount;
+    ULONG NewCount = OldCount + Count;
+    ULONG First    = pPoly->m_nFirstVertex;
+
+    // Validate (vertex counts are stored as USHORT)
+    if ( NewCount > 0xFFFF ) return -1;
+
+    // Move to the end of the pool unless we are already there
+    if ( First + OldCount != m_nVertexCount || OldCount == 0 ) First = m_nVertexCount;
+
+    // Make sure there is room (this may move the pool)
+    if ( !ReserveVertices( First + NewCount ) ) return -1;
+
+    // Relocate any existing vertices
+    if ( First != pPoly->m_nFirstVertex && OldCount > 0 )
+        memcpy( &m_pVertex[ First ], &m_pVertex[ pPoly->m_nFirstVertex ], OldCount * sizeof(CVertex) );
+
+    // Clear the new vertices
+    for ( ULONG i = OldCount; i < NewCount; i++ ) m_pVertex[ First + i ] = CVertex();
+
+    // Store the updated span
+    pPoly->m_nFirstVertex = First;
+    pPoly->m_nVertexCount = (USHORT)NewCount;
+    pPoly->m_pVertex      = m_pVertex + First;
+    m_nVertexCount        = First + NewCount;
+
+    // Return first vertex
+    return (long)OldCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CIndexedMesh () (Constructor)
+// Desc : CIndexedMesh Class Constructor
+//-----------------------------------------------------------------------------
+CIndexedMesh::CIndexedMesh()
+{
+	// Reset / Clear all required values
+    m_nVertexCount  = 0;
+    m_pVertex       = NULL;
+    m_nIndexCount   = 0;
+    m_pIndex        = NULL;
+    m_nPolygonCount = 0;
+    m_pPolygon      = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CIndexedMesh () (Destructor)
+// Desc : CIndexedMesh Class Destructor
+//-----------------------------------------------------------------------------
+CIndexedMesh::~CIndexedMesh()
+{
+    // Release our mesh components
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Release all mesh data so that the mesh can be rebuilt.
+//-----------------------------------------------------------------------------
+void CIndexedMesh::Release()
+{
+    // Free up the arrays
+    if ( m_pVertex  ) delete []m_pVertex;
+    if ( m_pIndex   ) delete []m_pIndex;
+    if ( m_pPolygon ) delete []m_pPolygon;
+
+    // Clear variables
+    m_nVertexCount  = 0;
+    m_pVertex       = NULL;
+    m_nIndexCount   = 0;
+    m_pIndex        = NULL;
+    m_nPolygonCount = 0;
+    m_pPolygon      = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildFromMesh ()
+// Desc : Converts a mesh stored in the per-polygon vertex layout into shared
+//        vertex / index list form. Vertices with identical positions are
+//        welded into a single pool entry.
+//-----------------------------------------------------------------------------
+bool CIndexedMesh::BuildFromMesh( const CMesh * pMesh )
+{
+    ULONG   i, v, Slot, HashSize, HashMask, *pHash = NULL;
+    ULONG   TotalVertices = 0;
+    const ULONG EmptySlot = (ULONG)-1;
+
+    // Validate parameters
+    if ( !pMesh ) return false;
+
+    // Release any previous data
+    Release();
+
+    // Count the total number of polygon vertices
+    for ( i = 0; i < pMesh->m_nPolygonCount; i++ ) TotalVertices += pMesh->m_pPolygon[i]->m_nVertexCount;
+
+    // Allocate worst case storage (no vertices shared)
+    m_pVertex  = new CVertex[ TotalVertices ];
+    m_pIndex   = new ULONG[ TotalVertices ];
+    m_pPolygon = new CIndexedPolygon[ pMesh->m_nPolygonCount ];
+    if ( !m_pVertex || !m_pIndex || !m_pPolygon ) { Release(); return false; }
+
+    // Allocate the weld hash table (power of two, at least twice the vertex count)
+    for ( HashSize = 16; HashSize < TotalVertices * 2; HashSize <<= 1 );
+    HashMask = HashSize - 1;
+    if (!( pHash = new ULONG[ HashSize ] )) { Release(); return false; }
+    for ( i = 0; i < HashSize; i++ ) pHash[i] = EmptySlot;
+
+    // Loop through each polygon
+    for ( i = 0; i < pMesh->m_nPolygonCount; i++ )
     {
-        // Allocate new poly
-        if (!( m_pPolygon[ m_nPolygonCount ] = new CPolygon() )) return -1;
+        CPolygon * pPoly = pMesh->m_pPolygon[i];
 
-        // Increase overall poly count
-        m_nPolygonCount++;
+        // Store the polygon span
+        m_pPolygon[i].m_nFirstIndex = m_nIndexCount;
+        m_pPolygon[i].m_nIndexCount = pPoly->m_nVertexCount;
+
+        // Loop through each vertex
+        for ( v = 0; v < pPoly->m_nVertexCount; v++ )
+        {
+            const CVertex & Vertex = pPoly->m_pVertex[v];
+            UINT  Key[3], Hash;
+
+            // Hash the raw position bits, mixing the high bits down (the low
+            // mantissa bits of whole number coordinates are all zero)
+            memcpy( Key, &Vertex, sizeof(Key) );
+            Hash  = (Key[0] * 73856093) ^ (Key[1] * 19349663) ^ (Key[2] * 83492791);
+            Hash ^= Hash >> 16; Hash *= 0x85EBCA6B; Hash ^= Hash >> 13;
+            Slot  = Hash & HashMask;
+
+            // Probe until we find a match, or an empty slot
+            while ( pHash[Slot] != EmptySlot )
+            {
+                if ( memcmp( &m_pVertex[ pHash[Slot] ], &Vertex, sizeof(CVertex) ) == 0 ) break;
+                Slot = (Slot + 1) & HashMask;
+
+            } // Next Slot
+
+            // Add a new pool entry if this position has not been seen before
+            if ( pHash[Slot] == EmptySlot )
+            {
+                m_pVertex[ m_nVertexCount ] = Vertex;
+                pHash[Slot] = m_nVertexCount++;
+
+            } // End if new vertex
+
+            // Store the index
+            m_pIndex[ m_nIndexCount++ ] = pHash[Slot];
+
+        } // Next Vertex
 
     } // Next Polygon
-    
-    // Return first polygon
-    return m_nPolygonCount - Count;
+
+    // Store final polygon count
+    m_nPolygonCount = pMesh->m_nPolygonCount;
+
+    // Clean up
+    delete []pHash;
+
+    // Success!
+    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -139,8 +395,11 @@ long CMesh::AddPolygon( ULONG Count )
 CPolygon::CPolygon()
 {
 	// Reset / Clear all required values
-    m_nVertexCount  = 0;
-    m_pVertex       = NULL;
+    m_nVertexCount      = 0;
+    m_pVertex           = NULL;
+    m_nFirstVertex      = 0;
+    m_pMesh             = NULL;
+    m_nVertexCapacity   = 0;
 
 }
 
@@ -151,8 +410,11 @@ CPolygon::CPolygon()
 CPolygon::CPolygon( USHORT Count )
 {
 	// Reset / Clear all required values
-    m_nVertexCount  = 0;
-    m_pVertex       = NULL;
+    m_nVertexCount      = 0;
+    m_pVertex           = NULL;
+    m_nFirstVertex      = 0;
+    m_pMesh             = NULL;
+    m_nVertexCapacity   = 0;
 
     // Add vertices
     AddVertex( Count );
@@ -164,12 +426,13 @@ CPolygon::CPolygon( USHORT Count )
 //-----------------------------------------------------------------------------
 CPolygon::~CPolygon()
 {
-	// Release our vertices
-    if ( m_pVertex ) delete []m_pVertex;
+	// Release our vertices (unless they belong to a mesh's vertex pool)
+    if ( m_pVertex && !m_pMesh ) delete []m_pVertex;
     
     // Clear variables
-    m_pVertex       = NULL;
-    m_nVertexCount  = 0;
+    m_pVertex           = NULL;
+    m_nVertexCount      = 0;
+    m_nVertexCapacity   = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -180,23 +443,44 @@ CPolygon::~CPolygon()
 long CPolygon::AddVertex( USHORT Count )
 {
     CVertex * pVertexBuffer = NULL;
-    
-    // Allocate new resized array
-    if (!( pVertexBuffer = new CVertex[ m_nVertexCount + Count ] )) return -1;
+    ULONG     Capacity;
 
-    // Existing Data?
-    if ( m_pVertex )
+    // Polygons belonging to a mesh grow their span within its vertex pool
+    if ( m_pMesh ) return m_pMesh->GrowPolygon( this, Count );
+
+    // Validate (vertex counts are stored as USHORT)
+    if ( (ULONG)m_nVertexCount + Count > 0xFFFF ) return -1;
+
+    // Grow the array geometrically if it is too small
+    if ( m_nVertexCount + Count > m_nVertexCapacity )
     {
-        // Copy old data into new buffer
-        memcpy( pVertexBuffer, m_pVertex, m_nVertexCount * sizeof(CVertex) );
+        // At least double the current size
+        Capacity = ( m_nVertexCapacity < 4 ) ? 4 : (ULONG)m_nVertexCapacity * 2;
+        if ( Capacity < (ULONG)m_nVertexCount + Count ) Capacity = m_nVertexCount + Count;
+        if ( Capacity > 0xFFFF ) Capacity = 0xFFFF;
 
-        // Release old buffer
-        delete []m_pVertex;
+        // Allocate new resized array
+        if (!( pVertexBuffer = new CVertex[ Capacity ] )) return -1;
 
-    } // End if
+        // Existing Data?
+        if ( m_pVertex )
+        {
+            // Copy old data into new buffer
+            memcpy( pVertexBuffer, m_pVertex, m_nVertexCount * sizeof(CVertex) );
+
+            // Release old buffer
+            delete []m_pVertex;
+
+        } // End if
+
+        // Store pointer for new buffer
+        m_pVertex         = pVertexBuffer;
+        m_nVertexCapacity = (USHORT)Capacity;
+
+    } // End if grow
 
-    // Store pointer for new buffer
-    m_pVertex = pVertexBuffer;
+    // Clear the new vertices
+    for ( ULONG i = m_nVertexCount; i < (ULONG)m_nVertexCount + Count; i++ ) m_pVertex[i] = CVertex();
     m_nVertexCount += Count;
 
     // Return first vertex
@@ -0,0 +1,274 @@
+//-----------------------------------------------------------------------------
+// File: CRasterizer.cpp
+//
+// Desc: Software rasterizer which writes directly into a CFrameBuffer's pixel
+//       memory, with no operating system involvement.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CRasterizer Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CRasterizer.h"
+#include <stddef.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants
+//-----------------------------------------------------------------------------
+namespace
+{
+    const unsigned int CLIP_INSIDE = 0;     // Cohen-Sutherland region out codes
+    const unsigned int CLIP_LEFT   = 1;
+    const unsigned int CLIP_RIGHT  = 2;
+    const unsigned int CLIP_TOP    = 4;
+    const unsigned int CLIP_BOTTOM = 8;
+
+    const float        MAX_COORD   = 1e30f; // Anything beyond this (or NaN) is rejected
+};
+
+//-----------------------------------------------------------------------------
+// Name : CRasterizer () (Constructor)
+// Desc : CRasterizer Class Constructor
+//-----------------------------------------------------------------------------
+CRasterizer::CRasterizer()
+{
+	// Reset / Clear all required values
+    m_pTarget     = NULL;
+    m_nClipLeft   = 0;
+    m_nClipTop    = 0;
+    m_nClipRight  = -1;
+    m_nClipBottom = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CRasterizer () (Destructor)
+// Desc : CRasterizer Class Destructor
+//-----------------------------------------------------------------------------
+CRasterizer::~CRasterizer()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderTarget ()
+// Desc : Set the frame buffer to render into. Resets the clip rectangle to
+//        cover the entire frame buffer.
+//-----------------------------------------------------------------------------
+void CRasterizer::SetRenderTarget( CFrameBuffer * pTarget )
+{
+    m_pTarget = pTarget;
+
+    // Clip to the full target
+    if ( pTarget )
+        SetClipRect( 0, 0, (long)pTarget->GetWidth() - 1, (long)pTarget->GetHeight() - 1 );
+    else
+        SetClipRect( 0, 0, -1, -1 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetClipRect ()
+// Desc : Set the inclusive pixel rectangle that rendering is restricted to.
+//        The rectangle is always constrained to lie within the render target.
+//-----------------------------------------------------------------------------
+void CRasterizer::SetClipRect( long Left, long Top, long Right, long Bottom )
+{
+    // Constrain to the render target
+    if ( m_pTarget )
+    {
+        if ( Left < 0 ) Left = 0;
+        if ( Top  < 0 ) Top  = 0;
+        if ( Right  > (long)m_pTarget->GetWidth()  - 1 ) Right  = (long)m_pTarget->GetWidth()  - 1;
+        if ( Bottom > (long)m_pTarget->GetHeight() - 1 ) Bottom = (long)m_pTarget->GetHeight() - 1;
+
+    } // End if target
+
+    m_nClipLeft   = Left;
+    m_nClipTop    = Top;
+    m_nClipRight  = Right;
+    m_nClipBottom = Bottom;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ComputeOutCode () (Private)
+// Desc : Classify a point against each edge of the clip rectangle.
+//-----------------------------------------------------------------------------
+unsigned int CRasterizer::ComputeOutCode( float x, float y ) const
+{
+    unsigned int Code = CLIP_INSIDE;
+
+    if      ( x < (float)m_nClipLeft   ) Code |= CLIP_LEFT;
+    else if ( x > (float)m_nClipRight  ) Code |= CLIP_RIGHT;
+    if      ( y < (float)m_nClipTop    ) Code |= CLIP_TOP;
+    else if ( y > (float)m_nClipBottom ) Code |= CLIP_BOTTOM;
+
+    return Code;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClipLine ()
+// Desc : Cohen-Sutherland line clipping against the clip rectangle. Returns
+//        false if the line lies entirely outside, otherwise the end points
+//        are adjusted to lie within the rectangle.
+//-----------------------------------------------------------------------------
+bool CRasterizer::ClipLine( float & x1, float & y1, float & x2, float & y2 ) const
+{
+    unsigned int Code1, Code2, CodeOut;
+    float        x = 0.0f, y = 0.0f;
+
+    // Reject anything degenerate (infinite / NaN coordinates)
+    if ( !(fabsf(x1) < MAX_COORD) || !(fabsf(y1) < MAX_COORD) ||
+         !(fabsf(x2) < MAX_COORD) || !(fabsf(y2) < MAX_COORD) ) return false;
+
+    // Empty clip rectangle?
+    if ( m_nClipRight < m_nClipLeft || m_nClipBottom < m_nClipTop ) return false;
+
+    Code1 = ComputeOutCode( x1, y1 );
+    Code2 = ComputeOutCode( x2, y2 );
+
+    for ( ; ; )
+    {
+        // Trivial accept / reject
+        if ( !(Code1 | Code2) ) return true;
+        if ( Code1 & Code2 ) return false;
+
+        // Pick a point that lies outside
+        CodeOut = Code1 ? Code1 : Code2;
+
+        // Find the intersection with the relevant edge
+        if ( CodeOut & CLIP_BOTTOM )
+        {
+            x = x1 + (x2 - x1) * ((float)m_nClipBottom - y1) / (y2 - y1);
+            y = (float)m_nClipBottom;
+        }
+        else if ( CodeOut & CLIP_TOP )
+        {
+            x = x1 + (x2 - x1) * ((float)m_nClipTop - y1) / (y2 - y1);
+            y = (float)m_nClipTop;
+        }
+        else if ( CodeOut & CLIP_RIGHT )
+        {
+            y = y1 + (y2 - y1) * ((float)m_nClipRight - x1) / (x2 - x1);
+            x = (float)m_nClipRight;
+        }
+        else if ( CodeOut & CLIP_LEFT )
+        {
+            y = y1 + (y2 - y1) * ((float)m_nClipLeft - x1) / (x2 - x1);
+            x = (float)m_nClipLeft;
+
+        } // End if edge
+
+        // Replace the outside point and re-classify it
+        if ( CodeOut == Code1 )
+        {
+            x1 = x; y1 = y;
+            Code1 = ComputeOutCode( x1, y1 );
+        }
+        else
+        {
+            x2 = x; y2 = y;
+            Code2 = ComputeOutCode( x2, y2 );
+
+        } // End if which point
+
+    } // Next Pass
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawLine ()
+// Desc : Clip and draw a single pixel wide line (both end points inclusive).
+//-----------------------------------------------------------------------------
+void CRasterizer::DrawLine( float x1, float y1, float x2, float y2, unsigned int Color )
+{
+    // Validate
+    if ( !m_pTarget || !m_pTarget->IsValid() ) return;
+
+    // Clip to the screen, bail if nothing remains
+    if ( !ClipLine( x1, y1, x2, y2 ) ) return;
+
+    // Rasterize on integer pixel coordinates
+    RasterizeLine( (long)x1, (long)y1, (long)x2, (long)y2, Color );
+}
+
+//-----------------------------------------------------------------------------
+// Name : RasterizeLine () (Private)
+// Desc : Integer Bresenham line rasterization, with dedicated paths for the
+//        horizontal, vertical and 45 degree diagonal cases.
+// Note : The end points must already be clipped to the render target.
+//-----------------------------------------------------------------------------
+void CRasterizer::RasterizeLine( long x1, long y1, long x2, long y2, unsigned int Color )
+{
+    long           dx, dy, Error, Count, StepMajor, StepMinor, i;
+    long           Pitch  = (long)m_pTarget->GetPitch();
+    unsigned int * pPixel;
+
+    // Always rasterize from top to bottom (or left to right if horizontal)
+    if ( y1 > y2 || (y1 == y2 && x1 > x2) )
+    {
+        long Temp;
+        Temp = x1; x1 = x2; x2 = Temp;
+        Temp = y1; y1 = y2; y2 = Temp;
+
+    } // End if swap
+
+    dx     = x2 - x1;
+    dy     = y2 - y1;
+    pPixel = m_pTarget->GetBits() + x1 + y1 * Pitch;
+
+    // Horizontal span
+    if ( dy == 0 )
+    {
+        for ( i = 0; i <= dx; i++ ) pPixel[i] = Color;
+        return;
+
+    } // End if horizontal
+
+    // Vertical span
+    if ( dx == 0 )
+    {
+        for ( i = 0; i <= dy; i++, pPixel += Pitch ) *pPixel = Color;
+        return;
+
+    } // End if vertical
+
+    // 45 degree diagonal
+    if ( dx == dy || dx == -dy )
+    {
+        StepMajor = Pitch + ((dx > 0) ? 1 : -1);
+        for ( i = 0; i <= dy; i++, pPixel += StepMajor ) *pPixel = Color;
+        return;
+
+    } // End if diagonal
+
+    // General case
+    StepMinor = (dx > 0) ? 1 : -1;
+    if ( dx < 0 ) dx = -dx;
+
+    if ( dx > dy )
+    {
+        // X Major : always step across, occasionally step down
+        Count = dx; Error = dx >> 1;
+        for ( i = 0; i <= Count; i++ )
+        {
+            *pPixel = Color;
+            pPixel += StepMinor;
+            Error  -= dy;
+            if ( Error < 0 ) { pPixel += Pitch; Error += dx; }
+
+        } // Next Pixel
+    }
+    else
+    {
+        // Y Major : always step down, occasionally step across
+        Count = dy; Error = dy >> 1;
+        for ( i = 0; i <= Count; i++ )
+        {
+            *pPixel = Color;
+            pPixel += Pitch;
+            Error  -= dx;
+            if ( Error < 0 ) { pPixel += StepMinor; Error += dy; }
+
+        } // Next Pixel
+
+    } // End if major axis
+}
@@ -0,0 +1,406 @@
+//-----------------------------------------------------------------------------
+// File: CTileRenderer.cpp
+//
+// Desc: Tile binned, multi-threaded triangle rasterizer. Triangles submitted
+//       during a frame are set up and sorted into 64x64 pixel screen tiles,
+//       then each tile is rasterized (half-space / edge function method with
+//       a 32 bit depth buffer) by whichever thread of the pool claims it.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTileRenderer Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTileRenderer.h"
+#include "../Includes/CProfiler.h"
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float MAX_COORD   = 1048576.0f;   // Anything beyond this (or NaN) is rejected
+    const float DEPTH_CLEAR = 1.0f;         // Depth buffer value at the start of a frame
+    const long  SUBPIXEL    = 16;           // Vertices are snapped to 28.4 fixed point
+};
+
+//-----------------------------------------------------------------------------
+// Name : CTileRenderer () (Constructor)
+// Desc : CTileRenderer Class Constructor
+//-----------------------------------------------------------------------------
+CTileRenderer::CTileRenderer()
+{
+	// Reset / Clear all required values
+    m_pTarget           = NULL;
+    m_pDepth            = NULL;
+    m_nWidth            = 0;
+    m_nHeight           = 0;
+    m_pTriangles        = NULL;
+    m_nTriangleCount    = 0;
+    m_nTriangleCapacity = 0;
+    m_pBins             = NULL;
+    m_nTilesWide        = 0;
+    m_nTilesHigh        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTileRenderer () (Destructor)
+// Desc : CTileRenderer Class Destructor
+//-----------------------------------------------------------------------------
+CTileRenderer::~CTileRenderer()
+{
+    // Release any memory we own
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Release the depth buffer, tile bins and triangle storage.
+//-----------------------------------------------------------------------------
+void CTileRenderer::Release()
+{
+    // Release the bins
+    if ( m_pBins )
+    {
+        for ( unsigned long i = 0; i < m_nTilesWide * m_nTilesHigh; i++ )
+        {
+            if ( m_pBins[i].pTriangles ) delete []m_pBins[i].pTriangles;
+
+        } // Next Bin
+        delete []m_pBins;
+
+    } // End if bins
+
+    // Release everything else
+    if ( m_pDepth     ) delete []m_pDepth;
+    if ( m_pTriangles ) delete []m_pTriangles;
+
+    // Clear variables
+    m_pTarget           = NULL;
+    m_pDepth            = NULL;
+    m_nWidth            = 0;
+    m_nHeight           = 0;
+    m_pTriangles        = NULL;
+    m_nTriangleCount    = 0;
+    m_nTriangleCapacity = 0;
+    m_pBins             = NULL;
+    m_nTilesWide        = 0;
+    m_nTilesHigh        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderTarget ()
+// Desc : Set the frame buffer to render into, (re)allocating the depth buffer
+//        and tile bins to match its dimensions.
+//-----------------------------------------------------------------------------
+bool CTileRenderer::SetRenderTarget( CFrameBuffer * pTarget )
+{
+    // Release any previous target data
+    Release();
+
+    // Detaching?
+    if ( !pTarget || !pTarget->IsValid() ) return true;
+
+    // Allocate the depth buffer
+    m_nWidth  = pTarget->GetWidth();
+    m_nHeight = pTarget->GetHeight();
+    m_pDepth  = new float[ m_nWidth * m_nHeight ];
+    if ( !m_pDepth ) { Release(); return false; }
+
+    // Allocate the tile bins
+    m_nTilesWide = (m_nWidth  + TILE_SIZE - 1) / TILE_SIZE;
+    m_nTilesHigh = (m_nHeight + TILE_SIZE - 1) / TILE_SIZE;
+    m_pBins      = new TILEBIN[ m_nTilesWide * m_nTilesHigh ];
+    if ( !m_pBins ) { Release(); return false; }
+    memset( m_pBins, 0, m_nTilesWide * m_nTilesHigh * sizeof(TILEBIN) );
+
+    // Success!
+    m_pTarget = pTarget;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginFrame ()
+// Desc : Discard all triangles binned during the previous frame.
+//-----------------------------------------------------------------------------
+void CTileRenderer::BeginFrame()
+{
+    m_nTriangleCount = 0;
+    for ( unsigned long i = 0; i < m_nTilesWide * m_nTilesHigh; i++ ) m_pBins[i].Count = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawTriangle ()
+// Desc : Set up a screen space triangle (each vertex is x, y, z) and add it
+//        to the bin of every tile its bounding box overlaps. Either winding
+//        order is accepted; nothing is rasterized until EndFrame.
+//-----------------------------------------------------------------------------
+void CTileRenderer::DrawTriangle( const float * pV1, const float * pV2, const float * pV3, unsigned int Color )
+{
+    const float * pV[3];
+    long          X[3], Y[3], MinX, MinY, MaxX, MaxY, tx, ty;
+    EDGEVALUE     Area;
+    int           i;
+
+    // Validate
+    if ( !m_pTarget ) return;
+
+    // Reject anything degenerate (infinite / NaN coordinates)
+    pV[0] = pV1; pV[1] = pV2; pV[2] = pV3;
+    for ( i = 0; i < 3; i++ )
+    {
+        if ( !(fabsf(pV[i][0]) < MAX_COORD) || !(fabsf(pV[i][1]) < MAX_COORD) ) return;
+
+    } // Next Vertex
+
+    // Snap to 28.4 fixed point
+    for ( i = 0; i < 3; i++ )
+    {
+        X[i] = (long)floorf( pV[i][0] * SUBPIXEL + 0.5f );
+        Y[i] = (long)floorf( pV[i][1] * SUBPIXEL + 0.5f );
+
+    } // Next Vertex
+
+    // Reject zero area triangles, and bring the rest to a consistent winding
+    Area = (EDGEVALUE)(X[1] - X[0]) * (Y[2] - Y[0]) - (EDGEVALUE)(Y[1] - Y[0]) * (X[2] - X[0]);
+    if ( Area == 0 ) return;
+    if ( Area > 0 )
+    {
+        long Temp; const float * pTemp;
+        Temp  = X[1]; X[1] = X[2]; X[2] = Temp;
+        Temp  = Y[1]; Y[1] = Y[2]; Y[2] = Temp;
+        pTemp = pV[1]; pV[1] = pV[2]; pV[2] = pTemp;
+
+    } // End if swap winding
+
+    // Pixels whose centres may fall inside the triangle, clamped to the target
+    MinX = X[0]; MaxX = X[0]; MinY = Y[0]; MaxY = Y[0];
+    for ( i = 1; i < 3; i++ )
+    {
+        if ( X[i] < MinX ) MinX = X[i];
+        if ( X[i] > MaxX ) MaxX = X[i];
+        if ( Y[i] < MinY ) MinY = Y[i];
+        if ( Y[i] > MaxY ) MaxY = Y[i];
+
+    } // Next Vertex
+    MinX = (MinX + 7) >> 4; MaxX = (MaxX - 8) >> 4;
+    MinY = (MinY + 7) >> 4; MaxY = (MaxY - 8) >> 4;
+    if ( MinX < 0 ) MinX = 0;
+    if ( MinY < 0 ) MinY = 0;
+    if ( MaxX > (long)m_nWidth  - 1 ) MaxX = (long)m_nWidth  - 1;
+    if ( MaxY > (long)m_nHeight - 1 ) MaxY = (long)m_nHeight - 1;
+    if ( MinX > MaxX || MinY > MaxY ) return;
+
+    // Grow the triangle store if required
+    if ( m_nTriangleCount == m_nTriangleCapacity )
+    {
+        unsigned long NewCapacity = m_nTriangleCapacity ? m_nTriangleCapacity * 2 : 1024;
+        TRIANGLE    * pNew        = new TRIANGLE[ NewCapacity ];
+        if ( !pNew ) return;
+        if ( m_pTriangles )
+        {
+            memcpy( pNew, m_pTriangles, m_nTriangleCount * sizeof(TRIANGLE) );
+            delete []m_pTriangles;
+
+        } // End if existing
+        m_pTriangles        = pNew;
+        m_nTriangleCapacity = NewCapacity;
+
+    } // End if full
+
+    TRIANGLE * pTri = &m_pTriangles[ m_nTriangleCount ];
+    pTri->MinX  = MinX; pTri->MaxX = MaxX;
+    pTri->MinY  = MinY; pTri->MaxY = MaxY;
+    pTri->Color = Color;
+
+    // Set up the three edge functions, sampled at pixel centres. Pixels
+    // exactly on an edge belong to the triangle only if that edge is a top
+    // or left edge, so shared edges are never drawn twice. The bias of -1
+    // lets a single sign test ( E >= 0 ) decide coverage.
+    for ( i = 0; i < 3; i++ )
+    {
+        int       j  = (i + 1) % 3;
+        EDGEVALUE DX = X[i] - X[j];
+        EDGEVALUE DY = Y[i] - Y[j];
+        EDGEVALUE C  = DY * X[i] - DX * Y[i];
+        bool      TopLeft = (DY < 0 || (DY == 0 && DX > 0));
+
+        pTri->C[i] = C + DX * (SUBPIXEL / 2) - DY * (SUBPIXEL / 2) + (TopLeft ? 0 : -1);
+        pTri->A[i] = -DY * SUBPIXEL;
+        pTri->B[i] =  DX * SUBPIXEL;
+
+    } // Next Edge
+
+    // Set up the depth plane, relative to the first pixel of the bounding box
+    float x1 = X[0] / (float)SUBPIXEL, y1 = Y[0] / (float)SUBPIXEL, z1 = pV[0][2];
+    float dx2 = X[1] / (float)SUBPIXEL - x1, dy2 = Y[1] / (float)SUBPIXEL - y1, dz2 = pV[1][2] - z1;
+    float dx3 = X[2] / (float)SUBPIXEL - x1, dy3 = Y[2] / (float)SUBPIXEL - y1, dz3 = pV[2][2] - z1;
+    float Denom = dx2 * dy3 - dx3 * dy2;
+    pTri->DZDX  = (dz2 * dy3 - dz3 * dy2) / Denom;
+    pTri->DZDY  = (dz3 * dx2 - dz2 * dx3) / Denom;
+    pTri->Z     = z1 + pTri->DZDX * (MinX + 0.5f - x1) + pTri->DZDY * (MinY + 0.5f - y1);
+
+    // Add to the bin of every tile the bounding box touches
+    for ( ty = MinY / TILE_SIZE; ty <= MaxY / TILE_SIZE; ty++ )
+    {
+        for ( tx = MinX / TILE_SIZE; tx <= MaxX / TILE_SIZE; tx++ )
+        {
+            TILEBIN * pBin = &m_pBins[ tx + ty * m_nTilesWide ];
+
+            // Grow the bin if required
+            if ( pBin->Count == pBin->Capacity )
+            {
+                unsigned long   NewCapacity = pBin->Capacity ? pBin->Capacity * 2 : 64;
+                unsigned long * pNew        = new unsigned long[ NewCapacity ];
+                if ( !pNew ) continue;
+                if ( pBin->pTriangles )
+                {
+                    memcpy( pNew, pBin->pTriangles, pBin->Count * sizeof(unsigned long) );
+                    delete []pBin->pTriangles;
+
+                } // End if existing
+                pBin->pTriangles = pNew;
+                pBin->Capacity   = NewCapacity;
+
+            } // End if full
+
+            pBin->pTriangles[ pBin->Count++ ] = m_nTriangleCount;
+
+        } // Next Tile Column
+
+    } // Next Tile Row
+
+    m_nTriangleCount++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndFrame ()
+// Desc : Rasterize every tile, spreading the tiles over the thread pool if
+//        one is supplied (otherwise the calling thread renders them all).
+//-----------------------------------------------------------------------------
+void CTileRenderer::EndFrame( CThreadPool * pPool )
+{
+    PROFILE_ZONE( "RasterizeTiles" );
+    unsigned long TileCount = m_nTilesWide * m_nTilesHigh;
+
+    // Validate
+    if ( !m_pTarget || m_nTriangleCount == 0 ) return;
+
+    if ( pPool )
+    {
+        pPool->Dispatch( RenderTileTask, this, TileCount );
+    }
+    else
+    {
+        for ( unsigned long i = 0; i < TileCount; i++ ) RenderTile( i );
+
+    } // End if pool
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderTileTask () (Private, Static)
+// Desc : Thread pool task entry point, routes through to RenderTile.
+//-----------------------------------------------------------------------------
+void CTileRenderer::RenderTileTask( void * pContext, unsigned long Tile )
+{
+    ((CTileRenderer*)pContext)->RenderTile( Tile );
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderTile () (Private)
+// Desc : Clear the depth of a single tile, then rasterize each triangle in
+//        its bin (in submission order) restricted to the tile's pixels.
+//-----------------------------------------------------------------------------
+void CTileRenderer::RenderTile( unsigned long Tile )
+{
+    PROFILE_ZONE( "RenderTile" );
+    const TILEBIN * pBin = &m_pBins[ Tile ];
+    long            Left, Top, Right, Bottom, x, y, x0, y0, x1, y1;
+    unsigned long   i;
+
+    // Nothing to draw?
+    if ( pBin->Count == 0 ) return;
+
+    // Calculate the tile rectangle (inclusive)
+    Left   = (long)(Tile % m_nTilesWide) * TILE_SIZE;
+    Top    = (long)(Tile / m_nTilesWide) * TILE_SIZE;
+    Right  = Left + TILE_SIZE - 1; if ( Right  > (long)m_nWidth  - 1 ) Right  = (long)m_nWidth  - 1;
+    Bottom = Top  + TILE_SIZE - 1; if ( Bottom > (long)m_nHeight - 1 ) Bottom = (long)m_nHeight - 1;
+
+    // Clear the depth for this tile
+    for ( y = Top; y <= Bottom; y++ )
+    {
+        float * pDepth = m_pDepth + y * m_nWidth;
+        for ( x = Left; x <= Right; x++ ) pDepth[x] = DEPTH_CLEAR;
+
+    } // Next Row
+
+    // Rasterize each triangle
+    for ( i = 0; i < pBin->Count; i++ )
+    {
+        const TRIANGLE * pTri = &m_pTriangles[ pBin->pTriangles[i] ];
+
+        // Overlap of the triangle bounds and this tile
+        x0 = (pTri->MinX > Left  ) ? pTri->MinX : Left;
+        x1 = (pTri->MaxX < Right ) ? pTri->MaxX : Right;
+        y0 = (pTri->MinY > Top   ) ? pTri->MinY : Top;
+        y1 = (pTri->MaxY < Bottom) ? pTri->MaxY : Bottom;
+
+        // Copy the set up data locally (pixel writes could otherwise alias it)
+        const EDGEVALUE A1 = pTri->A[0], A2 = pTri->A[1], A3 = pTri->A[2];
+        const EDGEVALUE B1 = pTri->B[0], B2 = pTri->B[1], B3 = pTri->B[2];
+        const float     DZDX = pTri->DZDX, DZDY = pTri->DZDY;
+        const unsigned int Color = pTri->Color;
+
+        // Edge and depth values at the first pixel
+        EDGEVALUE RowE1 = pTri->C[0] + A1 * x0 + B1 * y0;
+        EDGEVALUE RowE2 = pTri->C[1] + A2 * x0 + B2 * y0;
+        EDGEVALUE RowE3 = pTri->C[2] + A3 * x0 + B3 * y0;
+        float     RowZ  = pTri->Z + DZDX * (x0 - pTri->MinX) + DZDY * (y0 - pTri->MinY);
+
+        for ( y = y0; y <= y1; y++ )
+        {
+            unsigned int * pPixel = m_pTarget->GetRow( y );
+            float        * pDepth = m_pDepth + y * m_nWidth;
+            EDGEVALUE      E1 = RowE1, E2 = RowE2, E3 = RowE3;
+            float          z  = RowZ;
+            bool           Entered = false;
+
+            for ( x = x0; x <= x1; x++ )
+            {
+                // Inside all three edges?
+                if ( (E1 | E2 | E3) >= 0 )
+                {
+                    // Nearer than the stored depth?
+                    if ( z < pDepth[x] )
+                    {
+                        pDepth[x] = z;
+                        pPixel[x] = Color;
+
+                    } // End if depth passed
+                    Entered = true;
+
+                }
+                else if ( Entered )
+                {
+                    // Triangles are convex, so the span on this row has ended
+                    break;
+
+                } // End if covered
+
+                E1 += A1; E2 += A2; E3 += A3;
+                z  += DZDX;
+
+            } // Next Pixel
+
+            RowE1 += B1; RowE2 += B2; RowE3 += B3;
+            RowZ  += DZDY;
+
+        } // Next Row
+
+    } // Next Triangle
+}
@@ -0,0 +1,395 @@
+//-----------------------------------------------------------------------------
+// File: CTransform.cpp
+//
+// Desc: Batched vertex transformation stage. The world, view, projection and
+//       viewport mappings are concatenated into a single matrix, and whole
+//       vertex arrays are then pushed through it using SIMD kernels.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTransform Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTransform.h"
+#include <string.h>
+
+#if defined(TRANSFORM_SSE)
+    #include <emmintrin.h>
+#endif
+
+#if defined(TRANSFORM_AVX)
+    #include <immintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+#if defined(TRANSFORM_SSE)
+    //-------------------------------------------------------------------------
+    // Name : Deinterleave4 ()
+    // Desc : Loads four packed x/y/z positions (12 floats) and swizzles them
+    //        into structure of arrays form, one register per component.
+    //-------------------------------------------------------------------------
+    inline void Deinterleave4( const float * pIn, __m128 & X, __m128 & Y, __m128 & Z )
+    {
+        __m128 v0 = _mm_loadu_ps( pIn     );    // x0 y0 z0 x1
+        __m128 v1 = _mm_loadu_ps( pIn + 4 );    // y1 z1 x2 y2
+        __m128 v2 = _mm_loadu_ps( pIn + 8 );    // z2 x3 y3 z3
+        __m128 t0, t1;
+
+        // Gather X
+        t0 = _mm_shuffle_ps( v1, v2, _MM_SHUFFLE( 1, 1, 2, 2 ) );
+        X  = _mm_shuffle_ps( v0, t0, _MM_SHUFFLE( 2, 0, 3, 0 ) );
+
+        // Gather Y
+        t0 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 0, 0, 1, 1 ) );
+        t1 = _mm_shuffle_ps( v1, v2, _MM_SHUFFLE( 2, 2, 3, 3 ) );
+        Y  = _mm_shuffle_ps( t0, t1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+
+        // Gather Z
+        t0 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 1, 1, 2, 2 ) );
+        Z  = _mm_shuffle_ps( t0, v2, _MM_SHUFFLE( 3, 0, 2, 0 ) );
+    }
+#endif // TRANSFORM_SSE
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : CTransform () (Constructor)
+// Desc : CTransform Class Constructor
+//-----------------------------------------------------------------------------
+CTransform::CTransform()
+{
+    // Reset to identity
+    memset( m_fMatrix, 0, sizeof(m_fMatrix) );
+    m_fMatrix[0] = m_fMatrix[5] = m_fMatrix[10] = m_fMatrix[15] = 1.0f;
+
+    // Pick the best kernel compiled in
+    m_Kernel = KERNEL_AUTO;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTransform () (Destructor)
+// Desc : CTransform Class Destructor
+//-----------------------------------------------------------------------------
+CTransform::~CTransform()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetMatrix ()
+// Desc : Stores the concatenated matrix used by all subsequent transforms.
+//-----------------------------------------------------------------------------
+void CTransform::SetMatrix( const float * pMatrix )
+{
+    memcpy( m_fMatrix, pMatrix, sizeof(m_fMatrix) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetKernel ()
+// Desc : Select the kernel used for transformation.
+// Note : Returns false (and leaves the current kernel alone) if the requested
+//        kernel was not compiled into this build.
+//-----------------------------------------------------------------------------
+bool CTransform::SetKernel( KERNEL Kernel )
+{
+    if ( !IsKernelSupported( Kernel ) ) return false;
+    m_Kernel = Kernel;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsKernelSupported () (Static)
+// Desc : Determine if the specified kernel was compiled into this build.
+//-----------------------------------------------------------------------------
+bool CTransform::IsKernelSupported( KERNEL Kernel )
+{
+    switch ( Kernel )
+    {
+        case KERNEL_AUTO:
+        case KERNEL_SCALAR:
+            return true;
+
+#if defined(TRANSFORM_SSE)
+        case KERNEL_SSE:
+            return true;
+#endif
+
+#if defined(TRANSFORM_AVX)
+        case KERNEL_AVX:
+            return true;
+#endif
+
+        default:
+            return false;
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetKernelName () (Static)
+// Desc : Retrieve a printable name for the specified kernel.
+//-----------------------------------------------------------------------------
+const char * CTransform::GetKernelName( KERNEL Kernel )
+{
+    switch ( Kernel )
+    {
+        case KERNEL_SCALAR: return "Scalar";
+        case KERNEL_SSE:    return "SSE";
+        case KERNEL_AVX:    return "AVX";
+        default:            return "Auto";
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildViewportMatrix () (Static)
+// Desc : Builds the matrix which maps normalized device coordinates to screen
+//        space. Concatenated after the projection matrix, this allows a single
+//        perspective divide to produce final screen coordinates.
+//-----------------------------------------------------------------------------
+void CTransform::BuildViewportMatrix( float * pOut, float X, float Y, float Width, float Height )
+{
+    memset( pOut, 0, 16 * sizeof(float) );
+    pOut[0]  =  Width  / 2.0f;
+    pOut[5]  = -Height / 2.0f;
+    pOut[10] =  1.0f;
+    pOut[12] =  X + Width  / 2.0f;
+    pOut[13] =  Y + Height / 2.0f;
+    pOut[15] =  1.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MultiplyMatrix () (Static)
+// Desc : pOut = pM1 * pM2 (pM1 is applied first). Safe for pOut to alias
+//        either of the input matrices.
+//-----------------------------------------------------------------------------
+void CTransform::MultiplyMatrix( float * pOut, const float * pM1, const float * pM2 )
+{
+    float Result[16];
+
+    for ( int Row = 0; Row < 4; Row++ )
+    {
+        for ( int Col = 0; Col < 4; Col++ )
+        {
+            Result[ Row * 4 + Col ] = pM1[ Row * 4     ] * pM2[ Col      ] +
+                                      pM1[ Row * 4 + 1 ] * pM2[ Col + 4  ] +
+                                      pM1[ Row * 4 + 2 ] * pM2[ Col + 8  ] +
+                                      pM1[ Row * 4 + 3 ] * pM2[ Col + 12 ];
+        } // Next Column
+
+    } // Next Row
+
+    memcpy( pOut, Result, sizeof(Result) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformVertices ()
+// Desc : Transforms 'Count' packed x/y/z positions through the stored matrix,
+//        divides through by w, and writes the results out as separate x, y
+//        and z arrays.
+//-----------------------------------------------------------------------------
+void CTransform::TransformVertices( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const
+{
+    KERNEL Kernel = m_Kernel;
+
+    // Resolve the automatic selection to the widest kernel available
+    if ( Kernel == KERNEL_AUTO )
+    {
+#if defined(TRANSFORM_AVX)
+        Kernel = KERNEL_AVX;
+#elif defined(TRANSFORM_SSE)
+        Kernel = KERNEL_SSE;
+#else
+        Kernel = KERNEL_SCALAR;
+#endif
+    } // End if automatic
+
+    // Dispatch
+    switch ( Kernel )
+    {
+        case KERNEL_AVX:
+            TransformAVX( pPositions, Count, pOutX, pOutY, pOutZ );
+            break;
+
+        case KERNEL_SSE:
+            TransformSSE( pPositions, Count, pOutX, pOutY, pOutZ );
+            break;
+
+        default:
+            TransformScalar( pPositions, Count, pOutX, pOutY, pOutZ );
+            break;
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformScalar () (Private)
+// Desc : Reference kernel, also used to mop up any vertices left over once
+//        the SIMD kernels have consumed all full groups.
+//-----------------------------------------------------------------------------
+void CTransform::TransformScalar( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const
+{
+    const float * m = m_fMatrix;
+    float         x, y, z, rw;
+
+    for ( unsigned long i = 0; i < Count; i++, pPositions += 3 )
+    {
+        x = pPositions[0]; y = pPositions[1]; z = pPositions[2];
+
+        // Calculate reciprocal w for the perspective divide
+        rw = 1.0f / (x * m[3] + y * m[7] + z * m[11] + m[15]);
+
+        // Transform and divide
+        pOutX[i] = (x * m[0] + y * m[4] + z * m[8]  + m[12]) * rw;
+        pOutY[i] = (x * m[1] + y * m[5] + z * m[9]  + m[13]) * rw;
+        pOutZ[i] = (x * m[2] + y * m[6] + z * m[10] + m[14]) * rw;
+
+    } // Next Vertex
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformSSE () (Private)
+// Desc : Four vertices per iteration, structure of arrays form.
+//-----------------------------------------------------------------------------
+void CTransform::TransformSSE( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const
+{
+    unsigned long i = 0;
+
+#if defined(TRANSFORM_SSE)
+    __m128 m[16], X, Y, Z, W, TX, TY, TZ;
+
+    // Splat each matrix element across a register
+    for ( int j = 0; j < 16; j++ ) m[j] = _mm_set1_ps( m_fMatrix[j] );
+
+    for ( ; i + 4 <= Count; i += 4, pPositions += 12 )
+    {
+        Deinterleave4( pPositions, X, Y, Z );
+
+        TX = _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[0] ), _mm_mul_ps( Y, m[4] ) ), _mm_add_ps( _mm_mul_ps( Z, m[8]  ), m[12] ) );
+        TY = _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[1] ), _mm_mul_ps( Y, m[5] ) ), _mm_add_ps( _mm_mul_ps( Z, m[9]  ), m[13] ) );
+        TZ = _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[2] ), _mm_mul_ps( Y, m[6] ) ), _mm_add_ps( _mm_mul_ps( Z, m[10] ), m[14] ) );
+        W  = _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[3] ), _mm_mul_ps( Y, m[7] ) ), _mm_add_ps( _mm_mul_ps( Z, m[11] ), m[15] ) );
+
+        // Perspective divide
+        W = _mm_div_ps( _mm_set1_ps( 1.0f ), W );
+        _mm_storeu_ps( pOutX + i, _mm_mul_ps( TX, W ) );
+        _mm_storeu_ps( pOutY + i, _mm_mul_ps( TY, W ) );
+        _mm_storeu_ps( pOutZ + i, _mm_mul_ps( TZ, W ) );
+
+    } // Next Group
+#endif // TRANSFORM_SSE
+
+    // Finish off any remaining vertices
+    if ( i < Count ) TransformScalar( pPositions, Count - i, pOutX + i, pOutY + i, pOutZ + i );
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformAVX () (Private)
+// Desc : Eight vertices per iteration, structure of arrays form.
+//-----------------------------------------------------------------------------
+void CTransform::TransformAVX( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ ) const
+{
+    unsigned long i = 0;
+
+#if defined(TRANSFORM_AVX)
+    __m256 m[16], X, Y, Z, W, TX, TY, TZ;
+    __m128 X0, Y0, Z0, X1, Y1, Z1;
+
+    // Splat each matrix element across a register
+    for ( int j = 0; j < 16; j++ ) m[j] = _mm256_set1_ps( m_fMatrix[j] );
+
+    for ( ; i + 8 <= Count; i += 8, pPositions += 24 )
+    {
+        // Swizzle two groups of four and merge into full width registers
+        Deinterleave4( pPositions,      X0, Y0, Z0 );
+        Deinterleave4( pPositions + 12, X1, Y1, Z1 );
+        X = _mm256_insertf128_ps( _mm256_castps128_ps256( X0 ), X1, 1 );
+        Y = _mm256_insertf128_ps( _mm256_castps128_ps256( Y0 ), Y1, 1 );
+        Z = _mm256_insertf128_ps( _mm256_castps128_ps256( Z0 ), Z1, 1 );
+
+        TX = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( X, m[0] ), _mm256_mul_ps( Y, m[4] ) ), _mm256_add_ps( _mm256_mul_ps( Z, m[8]  ), m[12] ) );
+        TY = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( X, m[1] ), _mm256_mul_ps( Y, m[5] ) ), _mm256_add_ps( _mm256_mul_ps( Z, m[9]  ), m[13] ) );
+        TZ = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( X, m[2] ), _mm256_mul_ps( Y, m[6] ) ), _mm256_add_ps( _mm256_mul_ps( Z, m[10] ), m[14] ) );
+        W  = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( X, m[3] ), _mm256_mul_ps( Y, m[7] ) ), _mm256_add_ps( _mm256_mul_ps( Z, m[11] ), m[15] ) );
+
+        // Perspective divide
+        W = _mm256_div_ps( _mm256_set1_ps( 1.0f ), W );
+        _mm256_storeu_ps( pOutX + i, _mm256_mul_ps( TX, W ) );
+        _mm256_storeu_ps( pOutY + i, _mm256_mul_ps( TY, W ) );
+        _mm256_storeu_ps( pOutZ + i, _mm256_mul_ps( TZ, W ) );
+
+    } // Next Group
+#endif // TRANSFORM_AVX
+
+    // Finish off any remaining vertices (SSE can still take groups of four)
+    if ( i < Count ) TransformSSE( pPositions, Count - i, pOutX + i, pOutY + i, pOutZ + i );
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformHomogeneous ()
+// Desc : Transforms 'Count' packed x/y/z positions through the stored matrix
+//        without performing the perspective divide, so that the results can
+//        be classified and clipped in homogeneous space.
+//-----------------------------------------------------------------------------
+void CTransform::TransformHomogeneous( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const
+{
+    // Every SIMD selection shares the SSE kernel (there is no divide to hide)
+    if ( m_Kernel == KERNEL_SCALAR )
+        HomogeneousScalar( pPositions, Count, pOutX, pOutY, pOutZ, pOutW );
+    else
+        HomogeneousSSE( pPositions, Count, pOutX, pOutY, pOutZ, pOutW );
+}
+
+//-----------------------------------------------------------------------------
+// Name : HomogeneousScalar () (Private)
+// Desc : Reference homogeneous kernel, also used for any left over vertices.
+//-----------------------------------------------------------------------------
+void CTransform::HomogeneousScalar( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const
+{
+    const float * m = m_fMatrix;
+    float         x, y, z;
+
+    for ( unsigned long i = 0; i < Count; i++, pPositions += 3 )
+    {
+        x = pPositions[0]; y = pPositions[1]; z = pPositions[2];
+        pOutX[i] = x * m[0] + y * m[4] + z * m[8]  + m[12];
+        pOutY[i] = x * m[1] + y * m[5] + z * m[9]  + m[13];
+        pOutZ[i] = x * m[2] + y * m[6] + z * m[10] + m[14];
+        pOutW[i] = x * m[3] + y * m[7] + z * m[11] + m[15];
+
+    } // Next Vertex
+}
+
+//-----------------------------------------------------------------------------
+// Name : HomogeneousSSE () (Private)
+// Desc : Four vertices per iteration, structure of arrays form.
+//-----------------------------------------------------------------------------
+void CTransform::HomogeneousSSE( const float * pPositions, unsigned long Count, float * pOutX, float * pOutY, float * pOutZ, float * pOutW ) const
+{
+    unsigned long i = 0;
+
+#if defined(TRANSFORM_SSE)
+    __m128 m[16], X, Y, Z;
+
+    // Splat each matrix element across a register
+    for ( int j = 0; j < 16; j++ ) m[j] = _mm_set1_ps( m_fMatrix[j] );
+
+    for ( ; i + 4 <= Count; i += 4, pPositions += 12 )
+    {
+        Deinterleave4( pPositions, X, Y, Z );
+
+        _mm_storeu_ps( pOutX + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[0] ), _mm_mul_ps( Y, m[4] ) ), _mm_add_ps( _mm_mul_ps( Z, m[8]  ), m[12] ) ) );
+        _mm_storeu_ps( pOutY + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[1] ), _mm_mul_ps( Y, m[5] ) ), _mm_add_ps( _mm_mul_ps( Z, m[9]  ), m[13] ) ) );
+        _mm_storeu_ps( pOutZ + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[2] ), _mm_mul_ps( Y, m[6] ) ), _mm_add_ps( _mm_mul_ps( Z, m[10] ), m[14] ) ) );
+        _mm_storeu_ps( pOutW + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, m[3] ), _mm_mul_ps( Y, m[7] ) ), _mm_add_ps( _mm_mul_ps( Z, m[11] ), m[15] ) ) );
+
+    } // Next Group
+#endif // TRANSFORM_SSE
+
+    // Finish off any remaining vertices
+    if ( i < Count ) HomogeneousScalar( pPositions, Count - i, pOutX + i, pOutY + i, pOutZ + i, pOutW + i );
+}
@@ -3,20 +3,131 @@
 //
 // Desc: Main application entry & handling source file.
 //
+// Note: Passing -headless on the command line renders a fixed number of
+//       frames into memory, with no window, and reports the time taken by
+//       each. On other platforms this is the only mode, and the application
+//       can be built with:
+//
+//       g++ -O2 -msse2 Source/*.cpp -lpthread -o Software_Render
+//
+//       Add -DNDEBUG for a release build, which compiles the profiler zones
+//       out (-profile then records nothing).
+//
 // Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
 // Main Module Includes
 //-----------------------------------------------------------------------------
-#include "..\\Includes\\Main.h"
-#include "..\\Includes\\CGameApp.h"
+#include "../Includes/Main.h"
+#include "../Includes/CGameApp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 //-----------------------------------------------------------------------------
 // Global Variable Definitions
 //-----------------------------------------------------------------------------
 CGameApp    g_App;      // Core game application processing engine
 
+//-----------------------------------------------------------------------------
+// Name : ParseHeadlessArgs() (Module Local)
+// Desc : Fill out the headless run options from the command line. Returns
+//        false (after printing the usage) if any argument was not understood.
+//-----------------------------------------------------------------------------
+static bool ParseHeadlessArgs( int argc, char * argv[], CGameApp::HEADLESSDESC & Desc )
+{
+    bool bValid = true;
+
+    // Defaults : 300 frames of wireframe at 640x480, advancing 1/60th second per frame
+    memset( &Desc, 0, sizeof(CGameApp::HEADLESSDESC) );
+    Desc.Width        = 640;
+    Desc.Height       = 480;
+    Desc.FrameCount   = 300;
+    Desc.TimeStep     = 1.0f / 60.0f;
+    Desc.OutputPrefix = "frame_";
+
+    for ( int i = 1; i < argc && bValid; i++ )
+    {
+        const char * pArg   = argv[i];
+        const char * pValue = ( i + 1 < argc ) ? argv[ i + 1 ] : NULL;
+
+        // Switches
+        if      ( strcmp( pArg, "-headless" ) == 0 ) continue;
+        else if ( strcmp( pArg, "-filled"   ) == 0 ) { Desc.Filled  = true; continue; }
+        else if ( strcmp( pArg, "-cull"     ) == 0 ) { Desc.Culling = true; continue; }
+        else if ( strcmp( pArg, "-dirty"    ) == 0 ) { Desc.DirtyRects = true; continue; }
+        else if ( strcmp( pArg, "-spin"     ) == 0 ) { Desc.SpinPacing = true; continue; }
+
+        // Everything else is followed by a value
+        if ( !pValue ) { bValid = false; break; }
+        i++;
+
+        if      ( strcmp( pArg, "-frames"    ) == 0 ) Desc.FrameCount   = strtoul( pValue, NULL, 10 );
+        else if ( strcmp( pArg, "-threads"   ) == 0 ) Desc.ThreadCount  = strtoul( pValue, NULL, 10 );
+        else if ( strcmp( pArg, "-step"      ) == 0 ) Desc.TimeStep     = (float)atof( pValue );
+        else if ( strcmp( pArg, "-lock"      ) == 0 ) Desc.LockFPS      = (float)atof( pValue );
+        else if ( strcmp( pArg, "-dumpevery" ) == 0 ) Desc.DumpInterval = strtoul( pValue, NULL, 10 );
+        else if ( strcmp( pArg, "-out"       ) == 0 ) Desc.OutputPrefix = pValue;
+        else if ( strcmp( pArg, "-report"    ) == 0 ) Desc.ReportFile   = pValue;
+        else if ( strcmp( pArg, "-profile"   ) == 0 ) Desc.ProfilePrefix = pValue;
+        else if ( strcmp( pArg, "-size"      ) == 0 ) bValid = ( sscanf( pValue, "%lux%lu", &Desc.Width, &Desc.Height ) == 2 );
+        else if ( strcmp( pArg, "-dump"      ) == 0 )
+        {
+            // Comma separated list of frame numbers
+            for ( const char * pList = pValue; *pList && Desc.DumpFrameCount < MAX_DUMP_FRAMES; )
+            {
+                char * pEnd;
+                Desc.DumpFrames[ Desc.DumpFrameCount++ ] = strtoul( pList, &pEnd, 10 );
+                if ( pEnd == pList ) { bValid = false; break; }
+                pList = ( *pEnd == ',' ) ? pEnd + 1 : pEnd;
+
+            } // Next Frame Number
+        }
+        else bValid = false;
+
+    } // Next Argument
+
+    // Success?
+    if ( bValid ) return true;
+    fprintf( stderr, "Usage : %s -headless [-frames N] [-size WxH] [-threads N] [-step Seconds] [-lock FPS] [-spin]\n"
+                     "         [-filled] [-cull] [-dirty] [-dump N,N,...] [-dumpevery N] [-out Prefix] [-report File]\n"
+                     "         [-profile Prefix]\n", argv[0] );
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : HeadlessMain() (Module Local)
+// Desc : Runs the application headless, rendering a fixed number of frames
+//        into memory. Returns the process exit code.
+//-----------------------------------------------------------------------------
+static int HeadlessMain( int argc, char * argv[] )
+{
+    CGameApp::HEADLESSDESC Desc;
+    int retCode;
+
+    // Parse the options and initialise the engine
+    if ( !ParseHeadlessArgs( argc, argv, Desc ) ) return 2;
+    if ( !g_App.InitHeadless( Desc ) ) { fprintf( stderr, "Failed to initialise the headless renderer.\n" ); return 1; }
+
+    // Render, shut down and report
+    retCode = g_App.RunHeadless();
+    g_App.ShutDown();
+    return retCode;
+}
+
+#if defined(_WIN32)
+
+//-----------------------------------------------------------------------------
+// Name : IsHeadless() (Module Local)
+// Desc : Determine whether a headless run was requested on the command line.
+//-----------------------------------------------------------------------------
+static bool IsHeadless( int argc, char * argv[] )
+{
+    for ( int i = 1; i < argc; i++ ) if ( strcmp( argv[i], "-headless" ) == 0 ) return true;
+    return false;
+}
+
 //-----------------------------------------------------------------------------
 // Name : WinMain() (Application Entry Point)
 // Desc : Entry point for program, App flow starts here.
@@ -25,6 +136,9 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCmdLi
 {
     int retCode;
 
+    // Run without a window if requested
+    if ( IsHeadless( __argc, __argv ) ) return HeadlessMain( __argc, __argv );
+
 	// Initialise the engine.
 	if (!g_App.InitInstance( hInstance, lpCmdLine, iCmdShow )) return 0;
     
@@ -37,4 +151,17 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCmdLi
     // Return the correct exit code.
     return retCode;
 
-}
\ No newline at end of file
+}
+#else
+
+//-----------------------------------------------------------------------------
+// Name : main() (Application Entry Point)
+// Desc : Entry point for platforms other than Windows, where only the headless
+//        renderer is available.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    return HeadlessMain( argc, argv );
+}
+
+#endif // _WIN32
@@ -12,6 +12,33 @@
 // CTimer Specific Includes
 //-----------------------------------------------------------------------------
 #include "..\\Includes\\CTimer.h"
+#include <stdlib.h>
+#if !defined(_WIN32)
+    #include <time.h>
+    #include <errno.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Types
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+    // Not present in older platform SDK headers
+    #ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+    #endif
+
+    typedef HANDLE (WINAPI * LPCREATEWAITABLETIMEREXW)( LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD );
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : CompareFrameTimes () (Module Local)
+// Desc : qsort callback, orders frame times from shortest to longest.
+//-----------------------------------------------------------------------------
+static int CompareFrameTimes( const void * pLeft, const void * pRight )
+{
+    float fLeft = *(const float*)pLeft, fRight = *(const float*)pRight;
+    return ( fLeft < fRight ) ? -1 : ( fLeft > fRight ) ? 1 : 0;
+}
 
 //-----------------------------------------------------------------------------
 // Name : CTimer () (Constructor)
@@ -19,27 +46,56 @@
 //-----------------------------------------------------------------------------
 CTimer::CTimer()
 {
+#if defined(_WIN32)
 	// Query performance hardware and setup time scaling values
 	if (QueryPerformanceFrequency((LARGE_INTEGER *)&m_PerfFreq)) 
     { 
 		m_PerfHardware		= TRUE;
-		QueryPerformanceCounter((LARGE_INTEGER *) &m_LastTime); 
 		m_TimeScale			= 1.0f / m_PerfFreq;
 	} 
     else 
     { 
 		// no performance counter, read in using timeGetTime 
 		m_PerfHardware		= FALSE;
-		m_LastTime			= timeGetTime(); 
+		m_PerfFreq			= 1000;
 		m_TimeScale			= 0.001f;
 	
     } // End If No Hardware
+#else
+    // The monotonic clock is always available, and counts in nanoseconds
+    m_PerfHardware      = true;
+    m_PerfFreq          = 1000000000;
+    m_TimeScale         = 1.0f / m_PerfFreq;
+#endif
+
+    // Sample the starting time
+    m_LastTime          = QueryCounter();
 
 	// Clear any needed values
     m_SampleCount       = 0;
+    m_SampleHead        = 0;
+    m_fSampleSum        = 0.0;
+    m_TimeElapsed       = 0.0f;
 	m_FrameRate			= 0;
 	m_FPSFrameCount		= 0;
 	m_FPSTimeElapsed	= 0.0f;
+
+    // Sleep through most of any locked frame by default
+    m_PacingMode        = PACING_HYBRID;
+    m_fSpinMargin       = DEFAULT_SPIN_MARGIN;
+    ResetPacingStats();
+
+    // Frame time statistics
+    m_StatsWindow           = DEFAULT_STATS_WINDOW;
+    m_Histogram.BinWidth    = DEFAULT_HISTOGRAM_BIN;
+    ResetFrameStats();
+
+#if defined(_WIN32)
+    // The waitable timer is only created once it is first needed
+    m_hWaitTimer        = NULL;
+    m_bWaitTimerInit    = false;
+    m_bTimerPeriod      = false;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -48,30 +104,27 @@ CTimer::CTimer()
 //-----------------------------------------------------------------------------
 CTimer::~CTimer()
 {
+#if defined(_WIN32)
+    // Release the waitable timer and restore the system timer period
+    if ( m_hWaitTimer ) CloseHandle( m_hWaitTimer );
+    if ( m_bTimerPeriod ) timeEndPeriod( 1 );
+#endif
 }
 
 //-----------------------------------------------------------------------------
 // Name : Tick () 
 // Desc : Function which signals that frame has advanced
 // Note : You can specify a number of frames per second to lock the frame rate
-//        to. This will simply soak up the remaining time to hit that target.
+//        to. The remaining time is soaked up as described by the pacing mode
+//        (see PaceFrame).
 //-----------------------------------------------------------------------------
 void CTimer::Tick( float fLockFPS )
 {
     float fTimeElapsed; 
+    ULONG Bin;
 
-    // Is performance hardware available?
-	if ( m_PerfHardware ) 
-    {
-        // Query high-resolution performance hardware
-		QueryPerformanceCounter((LARGE_INTEGER *)&m_CurrentTime);
-	} 
-    else 
-    {
-        // Fall back to less accurate timer
-		m_CurrentTime = timeGetTime();
-
-	} // End If no hardware available
+    // Sample the current time
+    m_CurrentTime = QueryCounter();
 
 	// Calculate elapsed time in seconds
 	fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
@@ -80,39 +133,32 @@ void CTimer::Tick( float fLockFPS )
     //if ( fLockFPS == 0.0f ) fLockFPS = (1.0f / GetTimeElapsed()) + 20.0f;
     
     // Should we lock the frame rate ?
-    if ( fLockFPS > 0.0f )
-    {
-        while ( fTimeElapsed < (1.0f / fLockFPS))
-        {
-            // Is performance hardware available?
-	        if ( m_PerfHardware ) 
-            {
-                // Query high-resolution performance hardware
-		        QueryPerformanceCounter((LARGE_INTEGER*)&m_CurrentTime);
-	        } 
-            else 
-            {
-                // Fall back to less accurate timer
-		        m_CurrentTime = timeGetTime();
-
-	        } // End If no hardware available
-
-	        // Calculate elapsed time in seconds
-	        fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
-
-        } // End While
-    } // End If
+    if ( fLockFPS > 0.0f ) fTimeElapsed = PaceFrame( 1.0f / fLockFPS );
 
 	// Save current frame time
 	m_LastTime = m_CurrentTime;
 
+    // Every frame goes into the statistics, hitches included
+    m_History[ m_HistoryHead ] = fTimeElapsed;
+    m_HistoryHead = (m_HistoryHead + 1) % MAX_HISTORY_COUNT;
+    if ( m_HistoryCount < MAX_HISTORY_COUNT ) m_HistoryCount++;
+
+    // Tally it in the histogram (the final bin also takes anything longer)
+    Bin = (ULONG)(fTimeElapsed / m_Histogram.BinWidth);
+    m_Histogram.Bins[ (Bin < HISTOGRAM_BIN_COUNT) ? Bin : HISTOGRAM_BIN_COUNT - 1 ]++;
+    m_Histogram.Total++;
+
     // Filter out values wildly different from current average
     if ( fabsf(fTimeElapsed - m_TimeElapsed) < 1.0f  )
     {
-        // Wrap FIFO frame time buffer.
-        memmove( &m_FrameTime[1], m_FrameTime, (MAX_SAMPLE_COUNT - 1) * sizeof(float) );
-        m_FrameTime[ 0 ] = fTimeElapsed;
-        if ( m_SampleCount < MAX_SAMPLE_COUNT ) m_SampleCount++;
+        // Overwrite the oldest sample once the ring is full, keeping the running sum current
+        if ( m_SampleCount == MAX_SAMPLE_COUNT )
+            m_fSampleSum -= m_FrameTime[ m_SampleHead ];
+        else
+            m_SampleCount++;
+        m_FrameTime[ m_SampleHead ] = fTimeElapsed;
+        m_fSampleSum += fTimeElapsed;
+        m_SampleHead = (m_SampleHead + 1) % MAX_SAMPLE_COUNT;
 
     } // End if
     
@@ -127,10 +173,8 @@ void CTimer::Tick( float fLockFPS )
 		m_FPSTimeElapsed	= 0.0f;
 	} // End If Second Elapsed
 
-    // Count up the new average elapsed time
-    m_TimeElapsed = 0.0f;
-    for ( ULONG i = 0; i < m_SampleCount; i++ ) m_TimeElapsed += m_FrameTime[ i ];
-    if ( m_SampleCount > 0 ) m_TimeElapsed /= m_SampleCount;
+    // The new average elapsed time
+    if ( m_SampleCount > 0 ) m_TimeElapsed = (float)(m_fSampleSum / m_SampleCount);
 
 }
 
@@ -163,3 +207,322 @@ float CTimer::GetTimeElapsed() const
     return m_TimeElapsed;
 
 }
+
+//-----------------------------------------------------------------------------
+// Name : GetTime () 
+// Desc : Returns the current time in seconds. Only the difference between two
+//        values is meaningful, the starting point is arbitrary.
+//-----------------------------------------------------------------------------
+double CTimer::GetTime() const
+{
+    return (double)QueryCounter() / (double)m_PerfFreq;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetPacingMode () 
+// Desc : Select how Tick waits out the remainder of a locked frame.
+//-----------------------------------------------------------------------------
+void CTimer::SetPacingMode( PACINGMODE Mode )
+{
+    m_PacingMode = Mode;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPacingMode () 
+// Desc : Returns the current frame pacing mode.
+//-----------------------------------------------------------------------------
+CTimer::PACINGMODE CTimer::GetPacingMode() const
+{
+    return m_PacingMode;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetSpinMargin () 
+// Desc : Set how long before the deadline a hybrid wait should wake up and
+//        start spinning (seconds).
+// Note : The margin still grows by itself (up to MAX_SPIN_MARGIN) whenever a
+//        sleep is seen to overshoot the deadline.
+//-----------------------------------------------------------------------------
+void CTimer::SetSpinMargin( float fSeconds )
+{
+    m_fSpinMargin = ( fSeconds > 0.0f ) ? fSeconds : 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPacingStats () 
+// Desc : Returns the frame pacing statistics gathered since the last reset.
+//-----------------------------------------------------------------------------
+CTimer::PACINGSTATS CTimer::GetPacingStats() const
+{
+    PACINGSTATS Stats = m_PacingStats;
+
+    // Fill in the derived values
+    if ( Stats.WakeCount > 0 ) Stats.WakeJitterAvg = (float)(m_fWakeJitterTotal / Stats.WakeCount);
+    Stats.SpinMargin = m_fSpinMargin;
+
+    return Stats;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetPacingStats () 
+// Desc : Clear the frame pacing statistics.
+//-----------------------------------------------------------------------------
+void CTimer::ResetPacingStats()
+{
+    memset( &m_PacingStats, 0, sizeof(PACINGSTATS) );
+    m_fWakeJitterTotal = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetStatsWindow () 
+// Desc : Set the number of most recent frames GetFrameStats examines (clamped
+//        to MAX_HISTORY_COUNT).
+//-----------------------------------------------------------------------------
+void CTimer::SetStatsWindow( ULONG FrameCount )
+{
+    if ( FrameCount < 1 ) FrameCount = 1;
+    if ( FrameCount > MAX_HISTORY_COUNT ) FrameCount = MAX_HISTORY_COUNT;
+    m_StatsWindow = FrameCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetStatsWindow () 
+// Desc : Returns the number of frames GetFrameStats examines.
+//-----------------------------------------------------------------------------
+ULONG CTimer::GetStatsWindow() const
+{
+    return m_StatsWindow;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameStats () 
+// Desc : Returns the min / average / percentile / max frame times over the
+//        statistics window (or as many frames as have been recorded so far).
+// Note : Percentiles use the nearest rank of the sorted window. This sorts a
+//        copy of up to MAX_HISTORY_COUNT samples, so is intended to be called
+//        at most once per frame.
+//-----------------------------------------------------------------------------
+CTimer::FRAMESTATS CTimer::GetFrameStats() const
+{
+    FRAMESTATS  Stats;
+    float       Sorted[MAX_HISTORY_COUNT];
+    double      fTotal = 0.0;
+    ULONG       i, Count, Index;
+
+    memset( &Stats, 0, sizeof(FRAMESTATS) );
+    Count = ( m_HistoryCount < m_StatsWindow ) ? m_HistoryCount : m_StatsWindow;
+    if ( Count == 0 ) return Stats;
+
+    // Gather the most recent samples, working back from the head
+    Index = m_HistoryHead;
+    for ( i = 0; i < Count; i++ )
+    {
+        Index = ( Index > 0 ) ? Index - 1 : MAX_HISTORY_COUNT - 1;
+        Sorted[i] = m_History[ Index ];
+        fTotal   += Sorted[i];
+
+    } // Next Sample
+    qsort( Sorted, Count, sizeof(float), CompareFrameTimes );
+
+    // Read off the statistics
+    Stats.SampleCount = Count;
+    Stats.Min         = Sorted[0];
+    Stats.Max         = Sorted[ Count - 1 ];
+    Stats.Avg         = (float)(fTotal / Count);
+    Stats.P50         = Sorted[ (Count * 50 + 99) / 100 - 1 ];
+    Stats.P95         = Sorted[ (Count * 95 + 99) / 100 - 1 ];
+    Stats.P99         = Sorted[ (Count * 99 + 99) / 100 - 1 ];
+
+    return Stats;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetHistogramBinWidth () 
+// Desc : Set the width of each frame time histogram bin (seconds). Clears
+//        the histogram.
+//-----------------------------------------------------------------------------
+void CTimer::SetHistogramBinWidth( float fSeconds )
+{
+    if ( fSeconds <= 0.0f ) return;
+    memset( &m_Histogram, 0, sizeof(FRAMEHISTOGRAM) );
+    m_Histogram.BinWidth = fSeconds;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetHistogram () 
+// Desc : Returns the histogram of every frame time since the last reset.
+//-----------------------------------------------------------------------------
+const CTimer::FRAMEHISTOGRAM & CTimer::GetHistogram() const
+{
+    return m_Histogram;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetFrameStats () 
+// Desc : Discard the frame time history and histogram (the smoothed elapsed
+//        time and frame rate are unaffected).
+//-----------------------------------------------------------------------------
+void CTimer::ResetFrameStats()
+{
+    float fBinWidth = m_Histogram.BinWidth;
+
+    m_HistoryCount = 0;
+    m_HistoryHead  = 0;
+    memset( &m_Histogram, 0, sizeof(FRAMEHISTOGRAM) );
+    m_Histogram.BinWidth = fBinWidth;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PaceFrame () (Private)
+// Desc : Wait until the specified period has passed since the last frame and
+//        return the final elapsed time.
+// Note : In hybrid mode the thread sleeps until m_fSpinMargin before the
+//        deadline, and only spins for that final slice. Spinning for the whole
+//        frame keeps a core at 100% and starves anything else that is trying
+//        to run on it (other instances included).
+//-----------------------------------------------------------------------------
+float CTimer::PaceFrame( float fPeriod )
+{
+    TIMEVALUE Deadline, WakeTime, SpinStart, Now;
+    float     fJitter;
+
+    Deadline = m_LastTime + (TIMEVALUE)(fPeriod * m_PerfFreq);
+    m_PacingStats.PacedFrames++;
+
+    // Has this frame already run past its deadline?
+    if ( m_CurrentTime >= Deadline )
+    {
+        m_PacingStats.OverrunFrames++;
+    
+    } // End if overrun
+    else
+    {
+        // Sleep through the bulk of the remaining time
+        WakeTime = Deadline - (TIMEVALUE)(m_fSpinMargin * m_PerfFreq);
+        if ( m_PacingMode == PACING_HYBRID && WakeTime > m_CurrentTime )
+        {
+            SleepUntil( WakeTime );
+            Now = QueryCounter();
+
+            // Record how far from the requested time we actually woke
+            fJitter = fabsf( (Now - WakeTime) * m_TimeScale );
+            m_fWakeJitterTotal += fJitter;
+            if ( fJitter > m_PacingStats.WakeJitterMax ) m_PacingStats.WakeJitterMax = fJitter;
+            m_PacingStats.WakeCount++;
+            m_PacingStats.SleepTime += (Now - m_CurrentTime) * m_TimeScale;
+
+            // Overslept the deadline itself, so leave more room next time
+            if ( Now > Deadline && m_fSpinMargin < MAX_SPIN_MARGIN )
+            {
+                m_fSpinMargin = ( m_fSpinMargin > 0.0f ) ? m_fSpinMargin * 2.0f : DEFAULT_SPIN_MARGIN;
+                if ( m_fSpinMargin > MAX_SPIN_MARGIN ) m_fSpinMargin = MAX_SPIN_MARGIN;
+            
+            } // End if overslept
+
+            m_CurrentTime = Now;
+
+        } // End if sleep
+
+        // Spin out whatever remains
+        SpinStart = m_CurrentTime;
+        while ( m_CurrentTime < Deadline ) m_CurrentTime = QueryCounter();
+        m_PacingStats.SpinTime += (m_CurrentTime - SpinStart) * m_TimeScale;
+
+    } // End if wait
+
+    // Released too late?
+    if ( (m_CurrentTime - Deadline) * m_TimeScale > DEADLINE_TOLERANCE ) m_PacingStats.DeadlineMisses++;
+
+    // Return the final elapsed time in seconds
+    return (m_CurrentTime - m_LastTime) * m_TimeScale;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SleepUntil () (Private)
+// Desc : Suspend the calling thread until (approximately) the counter value
+//        specified.
+//-----------------------------------------------------------------------------
+void CTimer::SleepUntil( TIMEVALUE WakeTime )
+{
+    TIMEVALUE Now = QueryCounter();
+    if ( WakeTime <= Now ) return;
+
+#if defined(_WIN32)
+    LARGE_INTEGER DueTime;
+
+    // Create the waitable timer on first use
+    if ( !m_bWaitTimerInit )
+    {
+        LPCREATEWAITABLETIMEREXW pCreateTimerEx;
+
+        // Prefer a high resolution timer (not available prior to Windows 10)
+        pCreateTimerEx = (LPCREATEWAITABLETIMEREXW)GetProcAddress( GetModuleHandle( _T("kernel32.dll") ), "CreateWaitableTimerExW" );
+        if ( pCreateTimerEx ) m_hWaitTimer = pCreateTimerEx( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+
+        // Otherwise use a standard timer, with the system timer period at 1ms
+        if ( !m_hWaitTimer )
+        {
+            m_hWaitTimer   = CreateWaitableTimer( NULL, TRUE, NULL );
+            m_bTimerPeriod = ( timeBeginPeriod( 1 ) == TIMERR_NOERROR );
+        
+        } // End if no high resolution timer
+
+        m_bWaitTimerInit = true;
+
+    } // End if create timer
+
+    // Negative due times are relative, in 100ns units
+    DueTime.QuadPart = -(LONGLONG)((WakeTime - Now) * 10000000 / m_PerfFreq);
+    if ( m_hWaitTimer && SetWaitableTimer( m_hWaitTimer, &DueTime, 0, NULL, NULL, FALSE ) )
+        WaitForSingleObject( m_hWaitTimer, INFINITE );
+    else
+        Sleep( (DWORD)((WakeTime - Now) * 1000 / m_PerfFreq) );
+#else
+    timespec Wake;
+
+#if defined(TIMER_ABSTIME)
+    // Counter values are already CLOCK_MONOTONIC nanoseconds, so sleep to the absolute time
+    Wake.tv_sec  = (time_t)(WakeTime / 1000000000);
+    Wake.tv_nsec = (long)(WakeTime % 1000000000);
+    while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &Wake, NULL ) == EINTR );
+#else
+    // Relative sleep, restarted with the remaining time if interrupted
+    Wake.tv_sec  = (time_t)((WakeTime - Now) / 1000000000);
+    Wake.tv_nsec = (long)((WakeTime - Now) % 1000000000);
+    while ( nanosleep( &Wake, &Wake ) == -1 && errno == EINTR );
+#endif
+
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryCounter () (Private)
+// Desc : Sample the highest resolution counter available.
+//-----------------------------------------------------------------------------
+TIMEVALUE CTimer::QueryCounter() const
+{
+    TIMEVALUE Counter;
+
+#if defined(_WIN32)
+    // Is performance hardware available?
+	if ( m_PerfHardware ) 
+    {
+        // Query high-resolution performance hardware
+		QueryPerformanceCounter((LARGE_INTEGER *)&Counter);
+	} 
+    else 
+    {
+        // Fall back to less accurate timer
+		Counter = timeGetTime();
+
+	} // End If no hardware available
+#else
+    timespec Now;
+
+    // Read the monotonic clock (unaffected by changes to the system time)
+    clock_gettime( CLOCK_MONOTONIC, &Now );
+    Counter = (TIMEVALUE)Now.tv_sec * 1000000000 + Now.tv_nsec;
+#endif
+
+    return Counter;
+}
@@ -19,7 +19,24 @@
 //-----------------------------------------------------------------------------
 // Definitions, Macros & Constants
 //-----------------------------------------------------------------------------
-const ULONG MAX_SAMPLE_COUNT = 50; // Maximum frame time sample count
+const ULONG MAX_SAMPLE_COUNT = 50;         // Maximum frame time sample count
+const ULONG MAX_HISTORY_COUNT = 1024;      // Frame times kept for the statistics window
+const ULONG DEFAULT_STATS_WINDOW = 240;    // Frames covered by GetFrameStats by default
+const ULONG HISTOGRAM_BIN_COUNT = 40;      // Number of frame time histogram bins
+const float DEFAULT_HISTOGRAM_BIN = 0.001f;// Width of each histogram bin (seconds)
+#if defined(_WIN32)
+const float DEFAULT_SPIN_MARGIN = 0.002f;  // Time to spin out after a sleep (seconds)
+#else
+const float DEFAULT_SPIN_MARGIN = 0.0005f; // Time to spin out after a sleep (seconds)
+#endif
+const float MAX_SPIN_MARGIN = 0.004f;      // Upper limit for the adaptive margin (seconds)
+const float DEADLINE_TOLERANCE = 0.0005f;  // Lateness beyond which a deadline is missed (seconds)
+
+#if defined(_MSC_VER)
+typedef __int64   TIMEVALUE;
+#else
+typedef long long TIMEVALUE;
+#endif
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -33,6 +50,49 @@ const ULONG MAX_SAMPLE_COUNT = 50; // Maximum frame time sample count
 class CTimer
 {
 public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum PACINGMODE
+    {
+        PACING_SPIN     = 0,    // Busy wait for the whole of the remaining frame time
+        PACING_HYBRID   = 1     // Sleep until shortly before the deadline, then spin
+    };
+
+    //-------------------------------------------------------------------------
+    // Structures
+    //-------------------------------------------------------------------------
+    struct PACINGSTATS
+    {
+        ULONG       PacedFrames;        // Number of ticks made with a frame rate lock
+        ULONG       OverrunFrames;      // Frames which had already passed their deadline on entry
+        ULONG       DeadlineMisses;     // Frames released over DEADLINE_TOLERANCE late, for any reason
+        ULONG       WakeCount;          // Number of times the thread was put to sleep
+        float       WakeJitterAvg;      // Average distance between requested and actual wake time
+        float       WakeJitterMax;      // Largest distance between requested and actual wake time
+        float       SpinMargin;         // Current time reserved for spinning after a sleep
+        double      SleepTime;          // Total time spent asleep (seconds)
+        double      SpinTime;           // Total time spent spinning (seconds)
+    };
+
+    struct FRAMESTATS
+    {
+        ULONG       SampleCount;        // Number of frames the values below cover
+        float       Min;                // Frame times, in seconds
+        float       Avg;
+        float       P50;
+        float       P95;
+        float       P99;
+        float       Max;
+    };
+
+    struct FRAMEHISTOGRAM
+    {
+        float       BinWidth;           // Width of each bin (seconds)
+        ULONG       Bins[HISTOGRAM_BIN_COUNT]; // Frames per bin, the last also holds anything longer
+        ULONG       Total;              // Number of frames recorded
+    };
+
     //-------------------------------------------------------------------------
     // Constructors & Destructors for This Class
     //-------------------------------------------------------------------------
@@ -45,6 +105,20 @@ public:
 	void	        Tick( float fLockFPS = 0.0f );
     unsigned long   GetFrameRate( LPTSTR lpszString = NULL ) const;
     float           GetTimeElapsed() const;
+    double          GetTime() const;
+
+    void            SetPacingMode( PACINGMODE Mode );
+    PACINGMODE      GetPacingMode() const;
+    void            SetSpinMargin( float fSeconds );
+    PACINGSTATS     GetPacingStats() const;
+    void            ResetPacingStats();
+
+    void            SetStatsWindow( ULONG FrameCount );
+    ULONG           GetStatsWindow() const;
+    FRAMESTATS      GetFrameStats() const;
+    void            SetHistogramBinWidth( float fSeconds );
+    const FRAMEHISTOGRAM & GetHistogram() const;
+    void            ResetFrameStats();
 
 private:
 	//------------------------------------------------------------
@@ -53,20 +127,41 @@ private:
     bool            m_PerfHardware;             // Has Performance Counter
 	float           m_TimeScale;                // Amount to scale counter
 	float           m_TimeElapsed;              // Time elapsed since previous frame
-    __int64         m_CurrentTime;              // Current Performance Counter
-    __int64         m_LastTime;                 // Performance Counter last frame
-	__int64         m_PerfFreq;                 // Performance Frequency
+    TIMEVALUE       m_CurrentTime;              // Current Performance Counter
+    TIMEVALUE       m_LastTime;                 // Performance Counter last frame
+	TIMEVALUE       m_PerfFreq;                 // Performance Frequency
+
+    float           m_FrameTime[MAX_SAMPLE_COUNT]; // Ring of filtered samples used for smoothing
+    ULONG           m_SampleCount;              // Number of valid entries in m_FrameTime
+    ULONG           m_SampleHead;               // Next entry in m_FrameTime to be written
+    double          m_fSampleSum;               // Running total of the samples in m_FrameTime
 
-    float           m_FrameTime[MAX_SAMPLE_COUNT];
-    ULONG           m_SampleCount;
+    float           m_History[MAX_HISTORY_COUNT]; // Ring of every frame time, for statistics
+    ULONG           m_HistoryCount;             // Number of valid entries in m_History
+    ULONG           m_HistoryHead;              // Next entry in m_History to be written
+    ULONG           m_StatsWindow;              // Frames covered by GetFrameStats
+    FRAMEHISTOGRAM  m_Histogram;                // Frame time histogram
 
     unsigned long   m_FrameRate;                // Stores current framerate
 	unsigned long   m_FPSFrameCount;            // Elapsed frames in any given second
 	float           m_FPSTimeElapsed;           // How much time has passed during FPS sample
+
+    PACINGMODE      m_PacingMode;               // How the frame rate lock waits
+    float           m_fSpinMargin;              // Time reserved for spinning after a sleep
+    PACINGSTATS     m_PacingStats;              // Frame pacing statistics
+    double          m_fWakeJitterTotal;         // Running total used for the average jitter
+#if defined(_WIN32)
+    HANDLE          m_hWaitTimer;               // Waitable timer used to sleep between frames
+    bool            m_bWaitTimerInit;           // Creation of the waitable timer was attempted
+    bool            m_bTimerPeriod;             // timeBeginPeriod has been called
+#endif
 	
 	//------------------------------------------------------------
 	// Private Functions For This Class
 	//------------------------------------------------------------
+    TIMEVALUE       QueryCounter() const;
+    float           PaceFrame( float fPeriod );
+    void            SleepUntil( TIMEVALUE WakeTime );
 };
 
 #endif // _CTIMER_H_
\ No newline at end of file
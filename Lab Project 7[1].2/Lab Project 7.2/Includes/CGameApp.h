@@ -14,6 +14,7 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 #include "CTimer.h"
+#include "CProfiler.h"
 #include "CObject.h"
 #include "CPlayer.h"
 #include "CScene.h"
@@ -79,6 +80,7 @@ private:
     D3DXMATRIX              m_mtxIdentity;      // A basic identity matrix
     
     CTimer                  m_Timer;            // Game timer
+    bool                    m_bProfileCapture;  // Capture a profiler trace of the whole session
     ULONG                   m_LastFrameRate;    // Used for making sure we update only when fps changes.
     
     HWND                    m_hWnd;             // Main window HWND
@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+// File: CProfiler.h
+//
+// Desc: Lightweight hierarchical CPU profiler. Code is instrumented with
+//       scoped zones (PROFILE_ZONE) which record their start time and
+//       duration into a buffer owned by the calling thread, so recording
+//       never takes a lock. At the end of each frame (PROFILE_FRAME) the
+//       zones are summarised by name, and a captured run can be exported in
+//       the Chrome trace_event format (chrome://tracing or Perfetto).
+//
+// Note: The zone macros compile away to nothing unless PROFILER_ENABLED is
+//       defined. This happens automatically for anything other than release
+//       builds (NDEBUG), and can be forced by defining PROFILER_FORCE. The
+//       CProfiler functions always exist, they simply report no data when
+//       nothing was recorded.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CPROFILER_H_
+#define _CPROFILER_H_
+
+//-----------------------------------------------------------------------------
+// CProfiler Specific Includes
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if !defined(NDEBUG) || defined(PROFILER_FORCE)
+    #define PROFILER_ENABLED                    // Zones are compiled in
+#endif
+
+const unsigned long MAX_PROFILE_EVENTS  = 65536;    // Zone events buffered per thread
+const unsigned long MAX_PROFILE_THREADS = 64;       // Threads which may record zones
+const unsigned long MAX_PROFILE_DEPTH   = 32;       // Nesting tracked for self times
+const unsigned long MAX_PROFILE_ZONES   = 64;       // Distinct zones in a frame summary
+
+#if defined(_MSC_VER)
+typedef __int64   PROFILETIME;
+#else
+typedef long long PROFILETIME;
+#endif
+
+#define PROFILE_CONCAT_( a, b )     a##b
+#define PROFILE_CONCAT( a, b )      PROFILE_CONCAT_( a, b )
+
+#if defined(PROFILER_ENABLED)
+    #define PROFILE_ZONE( Name )    CProfileZone PROFILE_CONCAT( ProfileZone_, __LINE__ )( Name )
+    #define PROFILE_FRAME()         CProfiler::EndFrame()
+#else
+    #define PROFILE_ZONE( Name )
+    #define PROFILE_FRAME()
+#endif
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProfiler (Class)
+// Desc : Static interface to the profiler. Zone names must be string literals
+//        (or otherwise outlive the profiler), only the pointer is stored.
+// Note : EndFrame, Reset and ExportChromeTrace read every thread's buffer, so
+//        must only be called while no other thread is inside a zone (for
+//        instance between thread pool dispatches).
+//-----------------------------------------------------------------------------
+class CProfiler
+{
+public:
+    //-------------------------------------------------------------------------
+    // Structures
+    //-------------------------------------------------------------------------
+    struct ZONESUMMARY
+    {
+        const char    * Name;           // Zone name, as passed to PROFILE_ZONE
+        unsigned long   Calls;          // Number of times the zone was entered
+        double          Total;          // Inclusive time (ms)
+        double          Self;           // Exclusive time, less any nested zones (ms)
+        double          Max;            // Longest single call (ms)
+    };
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static PROFILETIME      BeginZone           ( );
+    static void             EndZone             ( const char * pName, PROFILETIME Start );
+    static void             EndFrame            ( );
+    static unsigned long    GetFrameSummary     ( const ZONESUMMARY ** ppSummary );
+    static unsigned long    GetFrameIndex       ( );
+    static void             SetTraceCapture     ( bool bCapture );
+    static bool             GetTraceCapture     ( );
+    static bool             ExportChromeTrace   ( const char * pFileName );
+    static unsigned long    GetDroppedCount     ( );
+    static void             Reset               ( );
+    static bool             IsCompiledIn        ( );
+};
+
+//-----------------------------------------------------------------------------
+// Name : CProfileZone (Class)
+// Desc : RAII marker, records a zone covering its own lifetime. Normally only
+//        created through the PROFILE_ZONE macro.
+//-----------------------------------------------------------------------------
+class CProfileZone
+{
+public:
+    CProfileZone( const char * pName ) : m_pName( pName ) { m_Start = CProfiler::BeginZone(); }
+    ~CProfileZone( ) { CProfiler::EndZone( m_pName, m_Start ); }
+
+private:
+    const char    * m_pName;            // Name of the zone
+    PROFILETIME     m_Start;            // Time the zone was entered
+};
+
+#endif // _CPROFILER_H_
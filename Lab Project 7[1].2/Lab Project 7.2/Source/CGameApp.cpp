@@ -29,6 +29,7 @@ CGameApp::CGameApp()
     m_hMenu         = NULL;
     m_bLostDevice   = false;
     m_LastFrameRate = 0;
+    m_bProfileCapture = false;
     
     // Set up initial states (these will be adjusted later if not supported)
     m_FillMode      = D3DFILL_SOLID;
@@ -54,6 +55,14 @@ CGameApp::~CGameApp()
 //-----------------------------------------------------------------------------
 bool CGameApp::InitInstance( HANDLE hInstance, LPCTSTR lpCmdLine, int iCmdShow )
 {    
+    // Capture a profiler trace of the whole session if requested (written on shut down)
+    if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-profile") ) )
+    {
+        m_bProfileCapture = true;
+        CProfiler::SetTraceCapture( true );
+
+    } // End if profiling
+
     // Create the primary display device
     if (!CreateDisplay()) { ShutDown(); return false; }
     
@@ -575,6 +584,7 @@ int CGameApp::BeginGame()
         {
 			// Advance Game Frame.
 			FrameAdvance();
+			PROFILE_FRAME();
 
 		} // End If messages waiting
 	
@@ -589,6 +599,15 @@ int CGameApp::BeginGame()
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+    // Write out the profiler trace (for chrome://tracing)
+    if ( m_bProfileCapture )
+    {
+        CProfiler::SetTraceCapture( false );
+        CProfiler::ExportChromeTrace( "Profile.json" );
+        m_bProfileCapture = false;
+
+    } // End if profiling
+
     // Release any previously built objects
     ReleaseObjects ( );
 
@@ -984,6 +1003,7 @@ void CGameApp::ReleaseObjects( )
 //-----------------------------------------------------------------------------
 void CGameApp::FrameAdvance()
 {
+    PROFILE_ZONE( "FrameAdvance" );
     static TCHAR FrameRate[ 50 ];
     static TCHAR TitleBuffer[ 255 ];
     
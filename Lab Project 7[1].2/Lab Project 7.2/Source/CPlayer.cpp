@@ -13,6 +13,7 @@
 #include "..\\Includes\\CPlayer.h"
 #include "..\\Includes\\CCamera.h"
 #include "..\\Includes\\CObject.h"
+#include "..\\Includes\\CProfiler.h"
 
 //-----------------------------------------------------------------------------
 // Name : CPlayer () (Constructor)
@@ -128,6 +129,7 @@ void CPlayer::SetCamOffset( const D3DXVECTOR3& Offset )
 //-----------------------------------------------------------------------------
 void CPlayer::Update( float TimeScale )
 {
+    PROFILE_ZONE( "CPlayer::Update" );
     D3DXVECTOR3 vecDirection;
     float fScale;
     ULONG i;
@@ -12,6 +12,7 @@
 #include "..\\Includes\\CScene.h"
 #include "..\\Includes\\CObject.h"
 #include "..\\Includes\\CTimer.h"
+#include "..\\Includes\\CProfiler.h"
 
 //-----------------------------------------------------------------------------
 // IWF File Reading includes
@@ -133,6 +134,7 @@ void CScene::SetTextureFormat( const D3DFORMAT & Format, const D3DFORMAT & Alpha
 //-----------------------------------------------------------------------------
 bool CScene::LoadScene( TCHAR * strFileName )
 {
+    PROFILE_ZONE( "CScene::LoadScene" );
     CFileIWF File;
 
     // File loading may throw an exception
@@ -486,6 +488,7 @@ void CScene::AnimateObjects( CTimer & Timer )
 //-----------------------------------------------------------------------------
 void CScene::Render( )
 {
+    PROFILE_ZONE( "CScene::Render" );
     // We render in reverse in our example to ensure that the opaque
     // inner core gets rendererd first.
     for ( long i = 1; i >= 0; i-- )
@@ -113,6 +113,10 @@ SOURCE=.\Source\CObject.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CProfiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CPlayer.cpp
 # End Source File
 # Begin Source File
@@ -153,6 +157,10 @@ SOURCE=.\Includes\CObject.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CProfiler.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CPlayer.h
 # End Source File
 # Begin Source File
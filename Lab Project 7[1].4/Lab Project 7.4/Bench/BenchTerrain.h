@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// File: BenchTerrain.h
+//
+// Desc: Synthetic heightmap shared by the headless terrain benchmarks in this
+//       folder, so that every benchmark measures the same landscape.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _BENCHTERRAIN_H_
+#define _BENCHTERRAIN_H_
+
+//-----------------------------------------------------------------------------
+// BenchTerrain Specific Includes
+//-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+enum HEIGHTMAPSTYLE
+{
+    HEIGHTMAP_NOISY     = 0,        // Rolling hills, heavy per sample noise (+/- 16)
+    HEIGHTMAP_RIDGED    = 1,        // Rolling hills and ridges, light per sample noise (+/- 2)
+    HEIGHTMAP_CREASED   = 2         // Rolling hills and sharp creases, light per sample noise (0 - 7)
+};
+
+//-----------------------------------------------------------------------------
+// Name : GenerateHeightMap ()
+// Desc : Rolling hills, 0 - 255, with the detail described by 'Style' on top.
+//        Reseeds rand() so that the same map is produced on every call.
+//-----------------------------------------------------------------------------
+inline void GenerateHeightMap( float * pData, unsigned long Width, unsigned long Height, HEIGHTMAPSTYLE Style = HEIGHTMAP_NOISY )
+{
+    int   NoiseRange  = 32;
+    float NoiseOffset = 16.0f;
+
+    if ( Style == HEIGHTMAP_RIDGED  ) { NoiseRange = 5; NoiseOffset = 2.0f; }
+    if ( Style == HEIGHTMAP_CREASED ) { NoiseRange = 8; NoiseOffset = 0.0f; }
+
+    srand( 1 );
+    for ( unsigned long z = 0; z < Height; ++z )
+    {
+        for ( unsigned long x = 0; x < Width; ++x )
+        {
+            float Hills  = sinf( (float)x * 0.013f ) * cosf( (float)z * 0.017f ) * 96.0f + 128.0f;
+            float Ridges = 0.0f;
+            if ( Style == HEIGHTMAP_RIDGED  ) Ridges = sinf( (float)(x + z) * 0.11f ) * 12.0f;
+            if ( Style == HEIGHTMAP_CREASED ) Ridges = fabsf( sinf( (float)(x + z) * 0.05f ) ) * 24.0f;
+            pData[ x + z * Width ] = Hills + Ridges + (float)(rand() % NoiseRange) - NoiseOffset;
+
+        } // Next X
+
+    } // Next Z
+}
+
+#endif // _BENCHTERRAIN_H_
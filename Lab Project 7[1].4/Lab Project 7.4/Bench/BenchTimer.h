@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// File: BenchTimer.h
+//
+// Desc: Minimal high resolution stopwatch shared by the headless benchmark
+//       programs in this folder. Uses the performance counter on Windows and
+//       the monotonic clock everywhere else.
+//
+// Note: The benchmarks build the terrain modules they exercise (CHeightMap,
+//       CHeightMapFilter, CNormalMap, CTerrainLOD, CTerrainQuadTree,
+//       CTerrainPager, CTerrainRayCast, CTerrainBrush, CTerrainCache and
+//       CThreadPool) straight from the Source folder, see the Build line at
+//       the top of each. Those modules must not depend on Direct3D or D3DX,
+//       only CTerrain and the application wrap them for rendering.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _BENCHTIMER_H_
+#define _BENCHTIMER_H_
+
+//-----------------------------------------------------------------------------
+// BenchTimer Specific Includes
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CBenchTimer (Class)
+// Desc : Simple stopwatch, returns the seconds elapsed since the last Reset.
+//-----------------------------------------------------------------------------
+class CBenchTimer
+{
+public:
+    CBenchTimer() { Reset(); }
+
+    //-------------------------------------------------------------------------
+    // Name : Now () (Static)
+    // Desc : Returns the current time in seconds from an arbitrary base.
+    //-------------------------------------------------------------------------
+    static double Now()
+    {
+#if defined(_WIN32)
+        LARGE_INTEGER Counter, Frequency;
+        QueryPerformanceFrequency( &Frequency );
+        QueryPerformanceCounter( &Counter );
+        return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+    }
+
+    void    Reset   ( )       { m_fStart = Now(); }
+    double  Elapsed ( ) const { return Now() - m_fStart; }
+
+private:
+    double  m_fStart;           // Time at which the stopwatch was last reset
+};
+
+#endif // _BENCHTIMER_H_
@@ -0,0 +1,277 @@
+//-----------------------------------------------------------------------------
+// File: FilterBench.cpp
+//
+// Desc: Headless benchmark for heightmap filtering. A noisy heightmap is
+//       generated at each size, then smoothed with:
+//
+//         - the original single threaded 3x3 filter (reproduced locally),
+//         - CHeightMapFilter box, radius 1, on the calling thread only,
+//         - CHeightMapFilter box, radius 1, across the thread pool,
+//         - CHeightMapFilter Gaussian, radius 3, across the thread pool,
+//         - CHeightMapFilter box, radius 2, 3 iterations, across the pool,
+//
+//       reporting the time taken by each. The radius 1 box filter is checked
+//       against the original, threaded results are checked against single
+//       threaded ones, and the outer ring must be left untouched.
+//
+// Build: g++ -O2 -msse2 FilterBench.cpp ../Source/CHeightMapFilter.cpp ../Source/CThreadPool.cpp -lpthread -o FilterBench
+//
+// Usage: FilterBench [Threads] [Size ...]
+//        Threads defaults to one per logical processor, sizes default to
+//        1025 4097 8193.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// FilterBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CHeightMapFilter.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float MAX_BOX_ERROR = 1e-3f;     // Allowed difference from the original filter
+
+    //-------------------------------------------------------------------------
+    // Name : LegacyFilter ()
+    // Desc : The original CTerrain::FilterHeightMap
+    //-------------------------------------------------------------------------
+    void LegacyFilter( float *& pHeightMap, unsigned long Width, unsigned long Height )
+    {
+        unsigned long x, z;
+        float Value;
+
+        float * pResult = new float[Width * Height];
+        memcpy( pResult, pHeightMap, Width * Height * sizeof(float) );
+
+        for ( z = 1; z < Height - 1; ++z )
+        {
+            for ( x = 1; x < Width - 1; ++x )
+            {
+                Value  = pHeightMap[ (x - 1) + (z - 1) * Width ];
+                Value += pHeightMap[ (x    ) + (z - 1) * Width ];
+                Value += pHeightMap[ (x + 1) + (z - 1) * Width ];
+
+                Value += pHeightMap[ (x - 1) + (z    ) * Width ];
+                Value += pHeightMap[ (x    ) + (z    ) * Width ];
+                Value += pHeightMap[ (x + 1) + (z    ) * Width ];
+
+                Value += pHeightMap[ (x - 1) + (z + 1) * Width ];
+                Value += pHeightMap[ (x    ) + (z + 1) * Width ];
+                Value += pHeightMap[ (x + 1) + (z + 1) * Width ];
+
+                pResult[ x + z * Width ] = Value / 9.0f;
+
+            } // Next X
+
+        } // Next Z
+
+        delete []pHeightMap;
+        pHeightMap = pResult;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : MaxDifference ()
+    // Desc : Largest absolute difference between two heightmaps
+    //-------------------------------------------------------------------------
+    float MaxDifference( const float * p1, const float * p2, unsigned long Count )
+    {
+        float Max = 0.0f;
+        for ( unsigned long i = 0; i < Count; ++i )
+        {
+            float Diff = fabsf( p1[i] - p2[i] );
+            if ( Diff > Max ) Max = Diff;
+
+        } // Next Sample
+        return Max;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RingPreserved ()
+    // Desc : Is the outermost ring of samples unchanged?
+    //-------------------------------------------------------------------------
+    bool RingPreserved( const float * pFiltered, const float * pOriginal, unsigned long Width, unsigned long Height )
+    {
+        unsigned long i;
+        for ( i = 0; i < Width; ++i )
+        {
+            if ( pFiltered[i] != pOriginal[i] ) return false;
+            if ( pFiltered[i + (Height - 1) * Width] != pOriginal[i + (Height - 1) * Width] ) return false;
+
+        } // Next Column
+        for ( i = 0; i < Height; ++i )
+        {
+            if ( pFiltered[i * Width] != pOriginal[i * Width] ) return false;
+            if ( pFiltered[i * Width + Width - 1] != pOriginal[i * Width + Width - 1] ) return false;
+
+        } // Next Row
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifySmallMaps ()
+    // Desc : Flat maps stay flat, odd widths hit the scalar tail, tiny maps
+    //        and bad settings are handled.
+    //-------------------------------------------------------------------------
+    bool VerifySmallMaps( CThreadPool * pPool )
+    {
+        CHeightMapFilter Filter;
+        float            Data[ 37 * 23 ], Copy[ 37 * 23 ];
+        unsigned long    i;
+
+        // A flat map must not move (the weights sum to 1)
+        for ( i = 0; i < 37 * 23; ++i ) Data[i] = 42.0f;
+        if ( !Filter.SetFilter( CHeightMapFilter::FILTER_GAUSSIAN, 5, 2 ) ) return false;
+        Filter.Apply( Data, 37, 23, pPool );
+        for ( i = 0; i < 37 * 23; ++i ) if ( fabsf( Data[i] - 42.0f ) > 1e-4f ) return false;
+
+        // Odd sized map against the original filter
+        float * pLegacy = new float[ 37 * 23 ];
+        GenerateHeightMap( Data, 37, 23 );
+        memcpy( pLegacy, Data, sizeof(Data) );
+        memcpy( Copy, Data, sizeof(Data) );
+        LegacyFilter( pLegacy, 37, 23 );
+        Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 1, 1 );
+        Filter.Apply( Data, 37, 23, pPool );
+        bool bMatch = MaxDifference( Data, pLegacy, 37 * 23 ) < MAX_BOX_ERROR && RingPreserved( Data, Copy, 37, 23 );
+        delete []pLegacy;
+        if ( !bMatch ) return false;
+
+        // A radius wider than the map is clamped at the edges
+        if ( !Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 32, 1 ) ) return false;
+        if ( !Filter.Apply( Data, 37, 23, pPool ) ) return false;
+
+        // No interior, nothing to do
+        memcpy( Copy, Data, sizeof(Data) );
+        if ( !Filter.Apply( Data, 2, 2, pPool ) || memcmp( Copy, Data, sizeof(Data) ) != 0 ) return false;
+
+        // Invalid settings and names
+        CHeightMapFilter::FILTERTYPE Type;
+        if ( Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 0, 1 ) ) return false;
+        if ( Filter.SetFilter( CHeightMapFilter::FILTER_BOX, MAX_FILTER_RADIUS + 1, 1 ) ) return false;
+        if ( !CHeightMapFilter::ParseType( " Gaussian", Type ) || Type != CHeightMapFilter::FILTER_GAUSSIAN ) return false;
+        if ( !CHeightMapFilter::ParseType( "", Type ) || Type != CHeightMapFilter::FILTER_BOX ) return false;
+        if ( !CHeightMapFilter::ParseType( "none", Type ) || Type != CHeightMapFilter::FILTER_NONE ) return false;
+        if ( CHeightMapFilter::ParseType( "median", Type ) ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each filter at each heightmap size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097, 8193 };
+    unsigned long Threads   = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 0;
+    unsigned long SizeCount = ( argc > 2 ) ? (unsigned long)(argc - 2) : 3;
+    CThreadPool   Pool;
+    bool          bPassed;
+
+    if ( !Pool.Create( Threads ) ) { printf( "Unable to create thread pool\n" ); return 1; }
+    bPassed = VerifySmallMaps( &Pool );
+    if ( !bPassed ) printf( "FAILED : small map checks\n" );
+
+#if !defined(HEIGHTMAPFILTER_SSE)
+    printf( "Note : SSE passes not compiled in, the scalar loops are used\n" );
+#endif
+
+    printf( "Heightmap filtering (ms), %lu thread(s)\n\n", Pool.GetThreadCount() );
+    printf( "  Size      Original   Box r1 x1   Box r1 x1   Gauss r3 x1   Box r2 x3\n" );
+    printf( "                         1 thread      pool          pool        pool\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long    Size  = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        unsigned long    Count = Size * Size;
+        double           fTime[5];
+        CHeightMapFilter Filter;
+        CBenchTimer      Timer;
+
+        if ( Size < 3 ) { printf( "  %-6lu    skipped (too small)\n", Size ); continue; }
+
+        float * pOriginal = new float[ Count ];
+        float * pLegacy   = new float[ Count ];
+        float * pWork     = new float[ Count ];
+
+        GenerateHeightMap( pOriginal, Size, Size );
+
+        // Original filter
+        memcpy( pLegacy, pOriginal, Count * sizeof(float) );
+        Timer.Reset();
+        LegacyFilter( pLegacy, Size, Size );
+        fTime[0] = Timer.Elapsed();
+
+        // Box radius 1 on the calling thread only
+        Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 1, 1 );
+        memcpy( pWork, pOriginal, Count * sizeof(float) );
+        Timer.Reset();
+        Filter.Apply( pWork, Size, Size );
+        fTime[1] = Timer.Elapsed();
+
+        float fError = MaxDifference( pWork, pLegacy, Count );
+        if ( fError >= MAX_BOX_ERROR || !RingPreserved( pWork, pOriginal, Size, Size ) )
+        {
+            printf( "FAILED : %lu box filter differs from the original (max error %g)\n", Size, fError );
+            bPassed = false;
+
+        } // End if mismatch
+
+        // Same again across the pool, must match exactly
+        memcpy( pLegacy, pWork, Count * sizeof(float) );
+        memcpy( pWork, pOriginal, Count * sizeof(float) );
+        Timer.Reset();
+        Filter.Apply( pWork, Size, Size, &Pool );
+        fTime[2] = Timer.Elapsed();
+
+        if ( memcmp( pWork, pLegacy, Count * sizeof(float) ) != 0 )
+        {
+            printf( "FAILED : %lu threaded result differs from single threaded\n", Size );
+            bPassed = false;
+
+        } // End if mismatch
+
+        // Wider kernels
+        Filter.SetFilter( CHeightMapFilter::FILTER_GAUSSIAN, 3, 1 );
+        memcpy( pWork, pOriginal, Count * sizeof(float) );
+        Timer.Reset();
+        Filter.Apply( pWork, Size, Size, &Pool );
+        fTime[3] = Timer.Elapsed();
+
+        Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 2, 3 );
+        memcpy( pWork, pOriginal, Count * sizeof(float) );
+        Timer.Reset();
+        Filter.Apply( pWork, Size, Size, &Pool );
+        fTime[4] = Timer.Elapsed();
+
+        if ( !RingPreserved( pWork, pOriginal, Size, Size ) )
+        {
+            printf( "FAILED : %lu outer ring was modified\n", Size );
+            bPassed = false;
+
+        } // End if modified
+
+        printf( "  %-6lu %11.2f %11.2f %11.2f %13.2f %11.2f\n", Size,
+                fTime[0] * 1000.0, fTime[1] * 1000.0, fTime[2] * 1000.0, fTime[3] * 1000.0, fTime[4] * 1000.0 );
+
+        delete []pOriginal;
+        delete []pLegacy;
+        delete []pWork;
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
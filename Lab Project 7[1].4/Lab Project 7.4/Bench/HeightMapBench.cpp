@@ -0,0 +1,231 @@
+//-----------------------------------------------------------------------------
+// File: HeightMapBench.cpp
+//
+// Desc: Headless benchmark for RAW heightmap loading. A heightmap of each
+//       sample format is written out, then loaded with:
+//
+//         - the original loop, one fread and conversion per sample (8 bit
+//           only, reproduced locally),
+//         - CHeightMap::LoadRaw reading the file with a single fread,
+//         - CHeightMap::LoadRaw mapping the file in to memory,
+//
+//       reporting the time taken by each. Every load is checked against the
+//       values written, including the scalar tail of the conversion kernels.
+//       The files are freshly written, so these are warm cache timings.
+//
+// Build: g++ -O2 -msse2 HeightMapBench.cpp ../Source/CHeightMap.cpp -o HeightMapBench
+//
+// Usage: HeightMapBench [Size] [Iterations]
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// HeightMapBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CHeightMap.h"
+#include "BenchTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const char * FileNames[]   = { "HeightMapBench_8.raw", "HeightMapBench_16.raw", "HeightMapBench_F.raw" };
+    const char * FormatNames[] = { "8 bit", "16 bit", "float" };
+
+    //-------------------------------------------------------------------------
+    // Name : WriteTestFile ()
+    // Desc : Write a heightmap of the specified format, returning the values
+    //        which should be read back.
+    //-------------------------------------------------------------------------
+    bool WriteTestFile( const char * pFileName, CHeightMap::SAMPLEFORMAT Format, unsigned long Count, float * pExpected )
+    {
+        unsigned long   SampleSize = CHeightMap::GetSampleSize( Format );
+        unsigned char * pData      = new unsigned char[ Count * SampleSize ];
+        FILE          * pFile;
+        bool            bResult;
+
+        for ( unsigned long i = 0; i < Count; i++ )
+        {
+            unsigned long Random = (unsigned long)rand() * 31 + i;
+            if ( Format == CHeightMap::FORMAT_UINT8 )
+            {
+                pData[i] = (unsigned char)Random;
+                pExpected[i] = (float)pData[i];
+            }
+            else if ( Format == CHeightMap::FORMAT_UINT16 )
+            {
+                unsigned short Value = (unsigned short)Random;
+                pData[i * 2]     = (unsigned char)(Value & 0xFF);
+                pData[i * 2 + 1] = (unsigned char)(Value >> 8);
+                pExpected[i] = (float)Value / 256.0f;
+            }
+            else
+            {
+                pExpected[i] = (float)(Random % 100000) * 0.01f - 200.0f;
+                memcpy( pData + i * 4, &pExpected[i], 4 );
+
+            } // End if float
+
+        } // Next Sample
+
+        pFile = fopen( pFileName, "wb" );
+        if ( !pFile ) { delete []pData; return false; }
+        bResult = ( fwrite( pData, SampleSize, Count, pFile ) == Count );
+        fclose( pFile );
+
+        delete []pData;
+        return bResult;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : LegacyLoad ()
+    // Desc : The original loader, one byte at a time
+    //-------------------------------------------------------------------------
+    bool LegacyLoad( const char * pFileName, float * pDest, unsigned long Count )
+    {
+        FILE * pFile = fopen( pFileName, "rb" );
+        if ( !pFile ) return false;
+
+        for ( unsigned long i = 0; i < Count; i++ )
+        {
+            unsigned char HeightValue;
+            fread( &HeightValue, 1, 1, pFile );
+            pDest[i] = (float)HeightValue;
+        }
+
+        fclose( pFile );
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : Matches ()
+    // Desc : Compare loaded samples with those expected
+    //-------------------------------------------------------------------------
+    bool Matches( const float * pLoaded, const float * pExpected, unsigned long Count )
+    {
+        return memcmp( pLoaded, pExpected, Count * sizeof(float) ) == 0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyEdgeCases ()
+    // Desc : Odd sample counts, misaligned sources and short files
+    //-------------------------------------------------------------------------
+    bool VerifyEdgeCases( )
+    {
+        unsigned char Source[ 2 * 41 + 1 ];
+        float         Dest[ 41 ];
+
+        // Every count up to 40, from an odd address, through both kernels
+        for ( unsigned long i = 0; i < sizeof(Source); i++ ) Source[i] = (unsigned char)(i * 37 + 11);
+        for ( unsigned long Count = 0; Count <= 40; Count++ )
+        {
+            Dest[ Count ] = -1.0f;
+            CHeightMap::ConvertSamples( Source + 1, CHeightMap::FORMAT_UINT8, Dest, Count );
+            for ( unsigned long i = 0; i < Count; i++ ) if ( Dest[i] != (float)Source[i + 1] ) return false;
+            if ( Dest[ Count ] != -1.0f ) return false;
+
+            CHeightMap::ConvertSamples( Source + 1, CHeightMap::FORMAT_UINT16, Dest, Count );
+            for ( unsigned long i = 0; i < Count; i++ ) if ( Dest[i] != (float)(Source[i * 2 + 1] | (Source[i * 2 + 2] << 8)) / 256.0f ) return false;
+            if ( Dest[ Count ] != -1.0f ) return false;
+
+        } // Next Count
+
+        // A file shorter than the requested map must fail, mapped or not
+        float Expected[ 16 ];
+        if ( !WriteTestFile( FileNames[0], CHeightMap::FORMAT_UINT8, 16, Expected ) ) return false;
+        if ( CHeightMap::LoadRaw( FileNames[0], CHeightMap::FORMAT_UINT8, Dest, 17, true  ) ) return false;
+        if ( CHeightMap::LoadRaw( FileNames[0], CHeightMap::FORMAT_UINT8, Dest, 17, false ) ) return false;
+        if ( CHeightMap::LoadRaw( "HeightMapBench_Missing.raw", CHeightMap::FORMAT_UINT8, Dest, 1 ) ) return false;
+
+        // Format names
+        CHeightMap::SAMPLEFORMAT Format;
+        if ( !CHeightMap::ParseFormat( "", Format ) || Format != CHeightMap::FORMAT_UINT8 ) return false;
+        if ( !CHeightMap::ParseFormat( " 16", Format ) || Format != CHeightMap::FORMAT_UINT16 ) return false;
+        if ( !CHeightMap::ParseFormat( "Float", Format ) || Format != CHeightMap::FORMAT_FLOAT32 ) return false;
+        if ( CHeightMap::ParseFormat( "24", Format ) ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each load method for each sample format.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long Size       = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 4097;
+    unsigned long Iterations = ( argc > 2 ) ? strtoul( argv[2], NULL, 10 ) : 3;
+    unsigned long Count      = Size * Size;
+    bool          bPassed    = VerifyEdgeCases();
+    float       * pExpected  = new float[ Count ];
+    float       * pLoaded    = new float[ Count ];
+
+    if ( !bPassed ) printf( "FAILED : conversion edge cases\n" );
+
+#if !defined(HEIGHTMAP_SSE)
+    printf( "Note : SSE2 conversion not compiled in, the scalar kernels are used\n" );
+#endif
+
+    printf( "%lu x %lu heightmap load (ms, best of %lu)\n\n", Size, Size, Iterations );
+    printf( "  Format     Per sample    Bulk read       Mapped\n" );
+
+    for ( int f = 0; f < 3; f++ )
+    {
+        CHeightMap::SAMPLEFORMAT Format = (CHeightMap::SAMPLEFORMAT)f;
+        double      fBest[3] = { 0.0, 1e30, 1e30 };
+        CBenchTimer Timer;
+
+        if ( !WriteTestFile( FileNames[f], Format, Count, pExpected ) ) { printf( "Unable to write %s\n", FileNames[f] ); return 1; }
+
+        for ( unsigned long i = 0; i < Iterations; i++ )
+        {
+            for ( int m = 0; m < 3; m++ )
+            {
+                bool bLoaded;
+
+                // The original loop only ever handled bytes
+                if ( m == 0 && Format != CHeightMap::FORMAT_UINT8 ) continue;
+
+                memset( pLoaded, 0, Count * sizeof(float) );
+                Timer.Reset();
+                if ( m == 0 )
+                    bLoaded = LegacyLoad( FileNames[f], pLoaded, Count );
+                else
+                    bLoaded = CHeightMap::LoadRaw( FileNames[f], Format, pLoaded, Count, m == 2 );
+                double fElapsed = Timer.Elapsed();
+                if ( m == 0 && (i == 0 || fElapsed < fBest[0]) ) fBest[0] = fElapsed;
+                if ( m != 0 && fElapsed < fBest[m] ) fBest[m] = fElapsed;
+
+                if ( !bLoaded || !Matches( pLoaded, pExpected, Count ) )
+                {
+                    printf( "FAILED : %s heightmap loaded incorrectly (method %i)\n", FormatNames[f], m );
+                    bPassed = false;
+
+                } // End if mismatch
+
+            } // Next Method
+
+        } // Next Iteration
+
+        if ( Format == CHeightMap::FORMAT_UINT8 )
+            printf( "  %-8s %12.2f %12.2f %12.2f\n", FormatNames[f], fBest[0] * 1000.0, fBest[1] * 1000.0, fBest[2] * 1000.0 );
+        else
+            printf( "  %-8s %12s %12.2f %12.2f\n", FormatNames[f], "-", fBest[1] * 1000.0, fBest[2] * 1000.0 );
+
+        remove( FileNames[f] );
+
+    } // Next Format
+
+    delete []pExpected;
+    delete []pLoaded;
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
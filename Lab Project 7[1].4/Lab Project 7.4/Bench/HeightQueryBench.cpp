@@ -0,0 +1,336 @@
+//-----------------------------------------------------------------------------
+// File: HeightQueryBench.cpp
+//
+// Desc: Headless accuracy check and throughput benchmark for terrain height
+//       queries. Points are scattered over a generated heightmap and their
+//       heights found with:
+//
+//         - the original per point CTerrain::GetHeight (reproduced locally),
+//         - CHeightMap::GetHeights, heights only,
+//         - CHeightMap::GetHeights, heights and normals,
+//
+//       reporting millions of queries per second for each. Batch heights must
+//       match the per point path, and batch normals must match normals built
+//       independently from the triangle's edges.
+//
+// Build: g++ -O2 -msse2 HeightQueryBench.cpp ../Source/CHeightMap.cpp -o HeightQueryBench
+//
+// Usage: HeightQueryBench [Queries] [Size ...]
+//        Queries defaults to 1048576, sizes default to 1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// HeightQueryBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CHeightMap.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    struct VECTOR3 { float x, y, z; };                  // Stand in for D3DXVECTOR3
+
+    const float Scale[3]         = { 4.0f, 0.5f, 4.0f };// World scale of the test terrain
+    const float MAX_HEIGHT_ERROR = 1e-4f;               // Allowed difference from the per point path
+    const float MAX_NORMAL_ERROR = 1e-5f;               // Allowed difference from the reference normal
+
+    //-------------------------------------------------------------------------
+    // Name : LegacyGetHeight ()
+    // Desc : The original CTerrain::GetHeight
+    //-------------------------------------------------------------------------
+    float LegacyGetHeight( const float * pHeightMap, unsigned long Width, unsigned long Height, float x, float z, bool ReverseQuad )
+    {
+        float fTopLeft, fTopRight, fBottomLeft, fBottomRight;
+
+        x = x / Scale[0];
+        z = z / Scale[2];
+        if ( x < 0.0f || z < 0.0f || x >= Width || z >= Height ) return 0.0f;
+
+        int ix = (int)x;
+        int iz = (int)z;
+        float fPercentX = x - ((float)ix);
+        float fPercentZ = z - ((float)iz);
+
+        if ( ReverseQuad )
+        {
+            fTopLeft     = pHeightMap[ix + iz * Width] * Scale[1];
+            fBottomRight = pHeightMap[(ix + 1) + (iz + 1) * Width] * Scale[1];
+            if ( fPercentX < fPercentZ )
+            {
+                fBottomLeft = pHeightMap[ix + (iz + 1) * Width] * Scale[1];
+                fTopRight = fTopLeft + (fBottomRight - fBottomLeft);
+            }
+            else
+            {
+                fTopRight   = pHeightMap[(ix + 1) + iz * Width] * Scale[1];
+                fBottomLeft = fTopLeft + (fBottomRight - fTopRight);
+            }
+        }
+        else
+        {
+            fTopRight   = pHeightMap[(ix + 1) + iz * Width] * Scale[1];
+            fBottomLeft = pHeightMap[ix + (iz + 1) * Width] * Scale[1];
+            if ( fPercentX < (1.0f - fPercentZ))
+            {
+                fTopLeft = pHeightMap[ix + iz * Width] * Scale[1];
+                fBottomRight = fBottomLeft + (fTopRight - fTopLeft);
+            }
+            else
+            {
+                fBottomRight = pHeightMap[(ix + 1) + (iz + 1) * Width] * Scale[1];
+                fTopLeft = fTopRight + (fBottomLeft - fBottomRight);
+            }
+        }
+
+        float fTopHeight    = fTopLeft    + ((fTopRight - fTopLeft) * fPercentX );
+        float fBottomHeight = fBottomLeft + ((fBottomRight - fBottomLeft) * fPercentX );
+        return fTopHeight + ((fBottomHeight - fTopHeight) * fPercentZ );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ReferenceNormal ()
+    // Desc : Normal of the triangle beneath a point, from the cross product of
+    //        two of its world space edges (double precision).
+    //-------------------------------------------------------------------------
+    void ReferenceNormal( const float * pHeightMap, unsigned long Width, float x, float z, bool ReverseQuad, double Normal[3] )
+    {
+        x /= Scale[0]; z /= Scale[2];
+        int    ix = (int)x, iz = (int)z;
+        double px = x - ix, pz = z - iz;
+        double Corner[4][3];   // TL, TR, BL, BR
+        int    a, b, c;
+
+        for ( int i = 0; i < 4; ++i )
+        {
+            int cx = ix + (i & 1), cz = iz + (i >> 1);
+            Corner[i][0] = cx * (double)Scale[0];
+            Corner[i][1] = pHeightMap[ cx + cz * Width ] * (double)Scale[1];
+            Corner[i][2] = cz * (double)Scale[2];
+
+        } // Next Corner
+
+        // Pick the triangle, wound so that the normal faces up
+        if ( ReverseQuad ) { if ( px < pz ) { a = 0; b = 2; c = 3; } else { a = 0; b = 3; c = 1; } }
+        else               { if ( px < 1.0 - pz ) { a = 0; b = 2; c = 1; } else { a = 1; b = 2; c = 3; } }
+
+        double e1[3] = { Corner[b][0] - Corner[a][0], Corner[b][1] - Corner[a][1], Corner[b][2] - Corner[a][2] };
+        double e2[3] = { Corner[c][0] - Corner[a][0], Corner[c][1] - Corner[a][1], Corner[c][2] - Corner[a][2] };
+        Normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        Normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        Normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        double Length = sqrt( Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2] );
+        Normal[0] /= Length; Normal[1] /= Length; Normal[2] /= Length;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RandomPoints ()
+    // Desc : Points inside the terrain (excluding the last row and column of
+    //        quads, where the original path reads past the heightmap). When
+    //        'Cluster' is non zero the points are kept within a square of
+    //        that many quads, as a group of nearby objects would be.
+    //-------------------------------------------------------------------------
+    void RandomPoints( VECTOR3 * pPoints, unsigned long Count, unsigned long Size, unsigned long Cluster )
+    {
+        if ( Cluster == 0 || Cluster > Size - 1 ) Cluster = Size - 1;
+        float Range = (float)Cluster - 0.001f;
+        float Base  = (float)((Size - 1 - Cluster) / 2);
+
+        for ( unsigned long i = 0; i < Count; ++i )
+        {
+            pPoints[i].x = (Base + Range * (float)rand() / (float)RAND_MAX) * Scale[0];
+            pPoints[i].y = 0.0f;
+            pPoints[i].z = (Base + Range * (float)rand() / (float)RAND_MAX) * Scale[2];
+
+        } // Next Point
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyAccuracy ()
+    // Desc : Compare batch heights and normals against the per point path
+    //        and the reference normals, for both quad orientations.
+    //-------------------------------------------------------------------------
+    bool VerifyAccuracy( const float * pHeightMap, unsigned long Size, const VECTOR3 * pPoints, unsigned long Count,
+                         float * pHeights, float * pNormals, float & MaxHeightError, float & MaxNormalError )
+    {
+        MaxHeightError = 0.0f;
+        MaxNormalError = 0.0f;
+
+        for ( int Reverse = 0; Reverse < 2; ++Reverse )
+        {
+            CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &pPoints[0].x, &pPoints[0].z, sizeof(VECTOR3), Count, pHeights, pNormals, Reverse != 0 );
+
+            for ( unsigned long i = 0; i < Count; ++i )
+            {
+                double Normal[3];
+                float  Expected = LegacyGetHeight( pHeightMap, Size, Size, pPoints[i].x, pPoints[i].z, Reverse != 0 );
+                float  Error    = fabsf( pHeights[i] - Expected );
+                if ( Error > MaxHeightError ) MaxHeightError = Error;
+
+                ReferenceNormal( pHeightMap, Size, pPoints[i].x, pPoints[i].z, Reverse != 0, Normal );
+                for ( int k = 0; k < 3; ++k )
+                {
+                    Error = (float)fabs( pNormals[ i * 3 + k ] - Normal[k] );
+                    if ( Error > MaxNormalError ) MaxNormalError = Error;
+
+                } // Next Component
+
+            } // Next Point
+
+        } // Next Orientation
+
+        return MaxHeightError <= MAX_HEIGHT_ERROR && MaxNormalError <= MAX_NORMAL_ERROR;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyEdgeCases ()
+    // Desc : Out of bounds points, the last row / column of quads, NaNs,
+    //        every batch length through the SIMD tail, and packed arrays.
+    //-------------------------------------------------------------------------
+    bool VerifyEdgeCases( const float * pHeightMap, unsigned long Size )
+    {
+        float   Max = (float)Size * Scale[0], Nan = sqrtf( -1.0f ), Heights[9], Normals[27];
+        VECTOR3 Points[9] = { { -1.0f, 0, 5.0f }, { 5.0f, 0, -0.01f }, { Max, 0, 5.0f }, { 5.0f, 0, Max },
+                              { Nan, 0, 5.0f }, { Max - 0.5f, 0, Max - 0.5f }, { Max - 0.5f, 0, 5.0f },
+                              { 6.0f, 0, 7.0f }, { 0.0f, 0, 0.0f } };
+        unsigned long i;
+
+        CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &Points[0].x, &Points[0].z, sizeof(VECTOR3), 9, Heights, Normals, true );
+
+        // Out of bounds: zero height, upward normal
+        for ( i = 0; i < 5; ++i )
+        {
+            if ( Heights[i] != 0.0f ) return false;
+            if ( Normals[i * 3] != 0.0f || Normals[i * 3 + 1] != 1.0f || Normals[i * 3 + 2] != 0.0f ) return false;
+
+        } // Next Point
+
+        // Within the last quad the far samples are clamped to the edge
+        if ( Heights[5] != pHeightMap[ Size * Size - 1 ] * Scale[1] ) return false;
+        if ( Normals[16] != 1.0f ) return false;
+
+        // Every batch length must agree with single queries
+        for ( unsigned long Count = 0; Count <= 9; ++Count )
+        {
+            float Batch[9];
+            CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &Points[0].x, &Points[0].z, sizeof(VECTOR3), Count, Batch, NULL, false );
+            for ( i = 0; i < Count; ++i )
+            {
+                float Single;
+                CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &Points[i].x, &Points[i].z, 0, 1, &Single, NULL, false );
+                if ( memcmp( &Single, &Batch[i], sizeof(float) ) != 0 ) return false;
+
+            } // Next Point
+
+        } // Next Count
+
+        // Separate packed x and z arrays (zero stride means packed floats)
+        float x[7], z[7], Packed[7];
+        for ( i = 0; i < 7; ++i ) { x[i] = Points[i + 2].x; z[i] = Points[i + 2].z; }
+        CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, x, z, 0, 7, Packed, NULL, true );
+        for ( i = 0; i < 7; ++i ) if ( memcmp( &Packed[i], &Heights[i + 2], sizeof(float) ) != 0 ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Check accuracy then measure query throughput at each size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long Queries   = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 1048576;
+    unsigned long SizeCount = ( argc > 2 ) ? (unsigned long)(argc - 2) : 2;
+    bool          bPassed   = true;
+
+    if ( Queries < 1 ) Queries = 1;
+
+    VECTOR3 * pPoints  = new VECTOR3[ Queries ];
+    float   * pHeights = new float[ Queries ];
+    float   * pNormals = new float[ Queries * 3 ];
+
+#if !defined(HEIGHTMAP_SSE)
+    printf( "Note : SSE2 query kernel not compiled in, the scalar path is used\n" );
+#endif
+
+    printf( "Terrain height queries, %lu per run (millions per second)\n\n", Queries );
+    printf( "  Size   Points        Original      Batch    Batch+Normals\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long Size = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        float         HeightError, NormalError;
+
+        if ( Size < 2 ) { printf( "  %-6lu skipped (too small)\n", Size ); continue; }
+
+        float * pHeightMap = new float[ Size * Size ];
+        GenerateHeightMap( pHeightMap, Size, Size );
+
+        // Accuracy first
+        if ( !VerifyEdgeCases( pHeightMap, Size ) )
+        {
+            printf( "FAILED : %lu edge cases\n", Size );
+            bPassed = false;
+
+        } // End if failed
+
+        RandomPoints( pPoints, Queries, Size, 0 );
+        if ( !VerifyAccuracy( pHeightMap, Size, pPoints, Queries, pHeights, pNormals, HeightError, NormalError ) )
+        {
+            printf( "FAILED : %lu max height error %g, max normal error %g\n", Size, HeightError, NormalError );
+            bPassed = false;
+
+        } // End if failed
+
+        // Then throughput, with points scattered everywhere and clustered
+        for ( int Pattern = 0; Pattern < 2; ++Pattern )
+        {
+            CBenchTimer Timer;
+            double      fTime[3];
+            float       Sum = 0.0f;
+
+            RandomPoints( pPoints, Queries, Size, Pattern ? 64 : 0 );
+
+            Timer.Reset();
+            for ( unsigned long i = 0; i < Queries; ++i ) pHeights[i] = LegacyGetHeight( pHeightMap, Size, Size, pPoints[i].x, pPoints[i].z, true );
+            fTime[0] = Timer.Elapsed();
+            Sum += pHeights[ Queries / 2 ];
+
+            Timer.Reset();
+            CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &pPoints[0].x, &pPoints[0].z, sizeof(VECTOR3), Queries, pHeights, NULL, true );
+            fTime[1] = Timer.Elapsed();
+            Sum += pHeights[ Queries / 2 ];
+
+            Timer.Reset();
+            CHeightMap::GetHeights( pHeightMap, Size, Size, Scale, &pPoints[0].x, &pPoints[0].z, sizeof(VECTOR3), Queries, pHeights, pNormals, true );
+            fTime[2] = Timer.Elapsed();
+            Sum += pHeights[ Queries / 2 ] + pNormals[ Queries / 2 ];
+
+            printf( "  %-6lu %-9s %12.1f %10.1f %14.1f%s\n", Size, Pattern ? "clustered" : "scattered",
+                    Queries / fTime[0] / 1e6, Queries / fTime[1] / 1e6, Queries / fTime[2] / 1e6, (Sum != Sum) ? " (nan)" : "" );
+
+        } // Next Pattern
+
+        printf( "         max error : height %g, normal %g\n", HeightError, NormalError );
+        delete []pHeightMap;
+
+    } // Next Size
+
+    delete []pPoints;
+    delete []pHeights;
+    delete []pNormals;
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+//-----------------------------------------------------------------------------
+// File: NormalMapBench.cpp
+//
+// Desc: Headless benchmark for the precomputed terrain normal map. A noisy
+//       heightmap is generated at each size, then:
+//
+//         - every normal is calculated on demand, as the original
+//           CTerrain::GetHeightMapNormal did (reproduced locally),
+//         - CNormalMap is built on the calling thread only,
+//         - CNormalMap is built across the thread pool,
+//         - every normal is looked up from the normal map,
+//         - a block sized region is modified and regenerated with Update,
+//
+//       reporting the time taken by each. Looked up normals are checked
+//       against the original calculation, threaded builds against single
+//       threaded ones, and updated regions against a full rebuild.
+//
+// Build: g++ -O2 -msse2 NormalMapBench.cpp ../Source/CNormalMap.cpp ../Source/CThreadPool.cpp -lpthread -o NormalMapBench
+//
+// Usage: NormalMapBench [Threads] [Size ...]
+//        Threads defaults to one per logical processor, sizes default to
+//        1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// NormalMapBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CNormalMap.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float MAX_ANGLE_ERROR = 0.01f;   // Allowed difference from the original normal (degrees)
+    const float MAX_STEEP_ERROR = 0.5f;    // As above, for near vertical faces where y is least precise
+    const float TERRAIN_SCALE[3] = { 190.0f, 10.0f, 190.0f };
+
+    //-------------------------------------------------------------------------
+    // Name : LegacyNormal ()
+    // Desc : The original CTerrain::GetHeightMapNormal
+    //-------------------------------------------------------------------------
+    void LegacyNormal( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                       unsigned long x, unsigned long z, float Normal[3] )
+    {
+        long  HMAddX = ( x < Width - 1 ) ? 1 : -1;
+        long  HMAddZ = ( z < Height - 1 ) ? (long)Width : -(long)Width;
+        const float * pSample = pHeightMap + x + z * Width;
+        float y1 = pSample[0] * Scale[1], y2 = pSample[HMAddX] * Scale[1], y3 = pSample[HMAddZ] * Scale[1];
+
+        // Cross ( 0, y3 - y1, sz ) with ( sx, y2 - y1, 0 ) and normalize
+        float Edge1[3] = { 0.0f, y3 - y1, Scale[2] }, Edge2[3] = { Scale[0], y2 - y1, 0.0f };
+        Normal[0] = Edge1[1] * Edge2[2] - Edge1[2] * Edge2[1];
+        Normal[1] = Edge1[2] * Edge2[0] - Edge1[0] * Edge2[2];
+        Normal[2] = Edge1[0] * Edge2[1] - Edge1[1] * Edge2[0];
+        float Length = sqrtf( Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2] );
+        Normal[0] /= Length; Normal[1] /= Length; Normal[2] /= Length;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : MaxAngleError ()
+    // Desc : Largest angle (degrees) between the looked up and original normals
+    //-------------------------------------------------------------------------
+    float MaxAngleError( const CNormalMap & Map, const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3] )
+    {
+        double MaxAngle = 0.0;
+        for ( unsigned long z = 0; z < Height; ++z )
+        {
+            for ( unsigned long x = 0; x < Width; ++x )
+            {
+                float a[3], b[3];
+                Map.GetNormal( x, z, a );
+                LegacyNormal( pHeightMap, Width, Height, Scale, x, z, b );
+
+                // atan2 of the cross & dot products stays accurate for tiny angles
+                double cx = (double)a[1] * b[2] - (double)a[2] * b[1];
+                double cy = (double)a[2] * b[0] - (double)a[0] * b[2];
+                double cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+                double Dot   = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+                double Angle = atan2( sqrt( cx * cx + cy * cy + cz * cz ), Dot );
+                if ( Angle > MaxAngle ) MaxAngle = Angle;
+
+            } // Next X
+
+        } // Next Z
+
+        return (float)(MaxAngle * 180.0 / 3.14159265358979);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckUpdate ()
+    // Desc : Raise a rectangle of the map, Update it and compare the result
+    //        with a full rebuild. Returns false on any difference.
+    //-------------------------------------------------------------------------
+    bool CheckUpdate( CNormalMap & Map, float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                      unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ, CThreadPool * pPool )
+    {
+        CNormalMap Full;
+        unsigned long x, z;
+
+        for ( z = MinZ; z <= MaxZ; ++z ) for ( x = MinX; x <= MaxX; ++x ) pHeightMap[ x + z * Width ] += (float)((x * 7 + z * 3) % 11) + 5.0f;
+        Map.Update( MinX, MinZ, MaxX, MaxZ, pPool );
+
+        if ( !Full.Build( pHeightMap, Width, Height, Scale ) ) return false;
+        return memcmp( Map.GetData(), Full.GetData(), Width * Height * 2 * sizeof(short) ) == 0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifySmallMaps ()
+    // Desc : Odd widths hit the scalar tail, edges and corners are updated,
+    //        steep and flat maps are handled.
+    //-------------------------------------------------------------------------
+    bool VerifySmallMaps( CThreadPool * pPool )
+    {
+        CNormalMap    Map;
+        float         Data[ 37 * 23 ], Normal[3];
+        float         Steep[3] = { 1.0f, 40.0f, 2.0f };
+        unsigned long i;
+
+        // Too small to have neighbours
+        if ( Map.Build( Data, 1, 23, TERRAIN_SCALE ) || Map.Build( Data, 37, 1, TERRAIN_SCALE ) || Map.Build( NULL, 37, 23, TERRAIN_SCALE ) ) return false;
+
+        // Flat maps point straight up
+        for ( i = 0; i < 37 * 23; ++i ) Data[i] = 42.0f;
+        if ( !Map.Build( Data, 37, 23, TERRAIN_SCALE, pPool ) ) return false;
+        Map.GetNormal( 36, 22, Normal );
+        if ( Normal[0] != 0.0f || Normal[1] != 1.0f || Normal[2] != 0.0f ) return false;
+
+        // Odd sized, noisy & steep
+        GenerateHeightMap( Data, 37, 23 );
+        if ( !Map.Build( Data, 37, 23, Steep, pPool ) ) return false;
+        if ( MaxAngleError( Map, Data, 37, 23, Steep ) > MAX_STEEP_ERROR ) return false;
+        if ( !Map.Build( Data, 37, 23, TERRAIN_SCALE, pPool ) ) return false;
+        if ( MaxAngleError( Map, Data, 37, 23, TERRAIN_SCALE ) > MAX_ANGLE_ERROR ) return false;
+
+        // Corners, edges, single samples and the whole map
+        if ( !CheckUpdate( Map, Data, 37, 23, TERRAIN_SCALE, 0, 0, 0, 0, pPool ) ) return false;
+        if ( !CheckUpdate( Map, Data, 37, 23, TERRAIN_SCALE, 36, 22, 36, 22, pPool ) ) return false;
+        if ( !CheckUpdate( Map, Data, 37, 23, TERRAIN_SCALE, 35, 0, 35, 21, pPool ) ) return false;
+        if ( !CheckUpdate( Map, Data, 37, 23, TERRAIN_SCALE, 3, 21, 30, 21, pPool ) ) return false;
+        if ( !CheckUpdate( Map, Data, 37, 23, TERRAIN_SCALE, 0, 0, 36, 22, pPool ) ) return false;
+
+        return true;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each stage at each heightmap size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long Threads   = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 0;
+    unsigned long SizeCount = ( argc > 2 ) ? (unsigned long)(argc - 2) : 2;
+    CThreadPool   Pool;
+    bool          bPassed;
+
+    if ( !Pool.Create( Threads ) ) { printf( "Unable to create thread pool\n" ); return 1; }
+    bPassed = VerifySmallMaps( &Pool );
+    if ( !bPassed ) printf( "FAILED : small map checks\n" );
+
+#if !defined(NORMALMAP_SSE)
+    printf( "Note : SSE generation not compiled in, the scalar loop is used\n" );
+#endif
+
+    printf( "Heightmap normals (ms), %lu thread(s)\n\n", Pool.GetThreadCount() );
+    printf( "  Size     On demand     Build      Build     Lookup    Update 33x33   Max Error\n" );
+    printf( "                       1 thread     pool                              (degrees)\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long Size  = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        unsigned long Count = Size * Size, x, z;
+        double        fTime[5], Sum = 0.0;
+        float         Normal[3], fError;
+        CNormalMap    Map;
+        CBenchTimer   Timer;
+
+        if ( Size < 40 ) { printf( "  %-6lu    skipped (too small)\n", Size ); continue; }
+
+        float * pHeightMap = new float[ Count ];
+        short * pSingle    = new short[ Count * 2 ];
+        GenerateHeightMap( pHeightMap, Size, Size );
+
+        // Original, on demand
+        Timer.Reset();
+        for ( z = 0; z < Size; ++z ) for ( x = 0; x < Size; ++x )
+        {
+            LegacyNormal( pHeightMap, Size, Size, TERRAIN_SCALE, x, z, Normal );
+            Sum += Normal[1];
+        }
+        fTime[0] = Timer.Elapsed();
+
+        // Build on the calling thread, then across the pool (must match)
+        Timer.Reset();
+        Map.Build( pHeightMap, Size, Size, TERRAIN_SCALE );
+        fTime[1] = Timer.Elapsed();
+        memcpy( pSingle, Map.GetData(), Count * 2 * sizeof(short) );
+
+        Timer.Reset();
+        Map.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        fTime[2] = Timer.Elapsed();
+
+        if ( memcmp( pSingle, Map.GetData(), Count * 2 * sizeof(short) ) != 0 )
+        {
+            printf( "FAILED : %lu threaded build differs from single threaded\n", Size );
+            bPassed = false;
+
+        } // End if mismatch
+
+        // Look every normal up
+        Timer.Reset();
+        for ( z = 0; z < Size; ++z ) for ( x = 0; x < Size; ++x )
+        {
+            Map.GetNormal( x, z, Normal );
+            Sum += Normal[1];
+        }
+        fTime[3] = Timer.Elapsed();
+
+        fError = MaxAngleError( Map, pHeightMap, Size, Size, TERRAIN_SCALE );
+        if ( fError > MAX_ANGLE_ERROR )
+        {
+            printf( "FAILED : %lu normals differ from the original by %g degrees\n", Size, fError );
+            bPassed = false;
+
+        } // End if too far out
+
+        // Modify a block in the middle of the map
+        unsigned long Min = Size / 2 - 16;
+        for ( z = Min; z <= Min + 32; ++z ) for ( x = Min; x <= Min + 32; ++x ) pHeightMap[ x + z * Size ] += 10.0f;
+        Timer.Reset();
+        Map.Update( Min, Min, Min + 32, Min + 32 );
+        fTime[4] = Timer.Elapsed();
+
+        // Compare against a full rebuild
+        memcpy( pSingle, Map.GetData(), Count * 2 * sizeof(short) );
+        Map.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        if ( memcmp( pSingle, Map.GetData(), Count * 2 * sizeof(short) ) != 0 )
+        {
+            printf( "FAILED : %lu updated region differs from a full rebuild\n", Size );
+            bPassed = false;
+
+        } // End if mismatch
+
+        printf( "  %-6lu %10.2f %10.2f %10.2f %10.2f %12.4f %13.5f\n", Size, fTime[0] * 1000.0, fTime[1] * 1000.0,
+                fTime[2] * 1000.0, fTime[3] * 1000.0, fTime[4] * 1000.0, fError );
+        if ( Sum == 0.0 ) printf( "\n" );
+
+        delete []pHeightMap;
+        delete []pSingle;
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
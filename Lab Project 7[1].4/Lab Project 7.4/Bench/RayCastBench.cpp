@@ -0,0 +1,451 @@
+//-----------------------------------------------------------------------------
+// File: RayCastBench.cpp
+//
+// Desc: Headless validation and benchmark for terrain ray casting. Rays of
+//       three kinds are cast over generated terrains:
+//
+//         - line of sight, between points just above the ground,
+//         - picking, from high above and angled down,
+//         - grazing, long and almost horizontal,
+//
+//       and intersected by marching along the ray sampling the terrain
+//       height (the only option before CTerrainRayCast), then with
+//       CTerrainRayCast one at a time, as a threaded batch, and as a
+//       threaded occlusion only batch. On small maps every result is checked
+//       against a brute force test of every triangle the ray could touch,
+//       and Update is checked against a full rebuild.
+//
+// Build: g++ -O2 RayCastBench.cpp ../Source/CTerrainRayCast.cpp ../Source/CThreadPool.cpp -lpthread -o RayCastBench
+//
+// Usage: RayCastBench [Threads] [Size ...]
+//        Threads defaults to one per logical processor, sizes default to
+//        1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// RayCastBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainRayCast.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    enum RAYKIND { RAY_SIGHT = 0, RAY_PICK = 1, RAY_GRAZE = 2, RAY_KINDS = 3 };
+
+    const char        * KindNames[RAY_KINDS] = { "Line of sight", "Picking", "Grazing" };
+    const float         TERRAIN_SCALE[3]     = { 4.0f, 0.5f, 4.0f };
+    const float         EYE_HEIGHT           = 2.0f;    // Height of line of sight points above the ground
+    const float         MARCH_STEP           = 0.5f;    // Marching step (fraction of a quad)
+    const double        MAX_DISTANCE_ERROR   = 1e-3;    // Allowed difference from brute force (world units)
+    const unsigned long RAY_COUNT            = 16384;   // Rays of each kind timed
+    const unsigned long MARCH_COUNT          = 1024;    // Rays of each kind marched (much slower)
+
+    //-------------------------------------------------------------------------
+    // Name : Random ()
+    // Desc : Uniform value between Low and High
+    //-------------------------------------------------------------------------
+    float Random( float Low, float High )
+    {
+        return Low + (High - Low) * ((float)rand() / (float)RAND_MAX);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : HeightAt ()
+    // Desc : CTerrain::GetHeight with 'ReverseQuad', 0 off the map
+    //-------------------------------------------------------------------------
+    float HeightAt( const float * pHeightMap, unsigned long Width, unsigned long Height, float x, float z )
+    {
+        x /= TERRAIN_SCALE[0];
+        z /= TERRAIN_SCALE[2];
+        if ( !(x >= 0.0f && z >= 0.0f && x < (float)(Width - 1) && z < (float)(Height - 1)) ) return 0.0f;
+
+        unsigned long ix = (unsigned long)x, iz = (unsigned long)z;
+        float u = x - (float)ix, v = z - (float)iz;
+        const float * p = pHeightMap + ix + iz * Width;
+        float TL = p[0], TR = p[1], BL = p[Width], BR = p[Width + 1];
+
+        if ( u < v ) TR = TL + (BR - BL); else BL = TL + (BR - TR);
+        float Top = TL + (TR - TL) * u, Bottom = BL + (BR - BL) * u;
+        return (Top + (Bottom - Top) * v) * TERRAIN_SCALE[1];
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : MarchRay ()
+    // Desc : Step along the ray comparing against the terrain height, as a
+    //        caller would have to without CTerrainRayCast. Returns the
+    //        distance of the first step beneath the terrain, or -1.
+    //-------------------------------------------------------------------------
+    float MarchRay( const float * pHeightMap, unsigned long Width, unsigned long Height, const RAYQUERY & Ray )
+    {
+        float Length = sqrtf( Ray.Direction[0] * Ray.Direction[0] + Ray.Direction[1] * Ray.Direction[1] + Ray.Direction[2] * Ray.Direction[2] );
+        float Step   = MARCH_STEP * TERRAIN_SCALE[0];
+
+        for ( float t = 0.0f; t <= Ray.MaxDistance; t += Step )
+        {
+            float x = Ray.Origin[0] + Ray.Direction[0] / Length * t;
+            float y = Ray.Origin[1] + Ray.Direction[1] / Length * t;
+            float z = Ray.Origin[2] + Ray.Direction[2] / Length * t;
+            if ( y <= HeightAt( pHeightMap, Width, Height, x, z ) ) return t;
+
+        } // Next Step
+
+        return -1.0f;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : IntersectTriangle ()
+    // Desc : Moller & Trumbore, nearest positive distance or -1
+    //-------------------------------------------------------------------------
+    double IntersectTriangle( const double O[3], const double D[3], const double A[3], const double B[3], const double C[3] )
+    {
+        double e1[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] }, e2[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+        double p[3]  = { D[1] * e2[2] - D[2] * e2[1], D[2] * e2[0] - D[0] * e2[2], D[0] * e2[1] - D[1] * e2[0] };
+        double Det   = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if ( fabs( Det ) < 1e-12 ) return -1.0;
+
+        double s[3]  = { O[0] - A[0], O[1] - A[1], O[2] - A[2] };
+        double u     = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / Det;
+        if ( u < 0.0 || u > 1.0 ) return -1.0;
+
+        double q[3]  = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+        double v     = (D[0] * q[0] + D[1] * q[1] + D[2] * q[2]) / Det;
+        if ( v < 0.0 || u + v > 1.0 ) return -1.0;
+
+        double t     = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / Det;
+        return ( t >= 0.0 ) ? t : -1.0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BruteIntersect ()
+    // Desc : Test every triangle under the ray's bounding rectangle in world
+    //        space. Returns the nearest distance or -1.
+    //-------------------------------------------------------------------------
+    double BruteIntersect( const float * pHeightMap, unsigned long Width, unsigned long Height, const RAYQUERY & Ray )
+    {
+        double Length = sqrt( (double)Ray.Direction[0] * Ray.Direction[0] + (double)Ray.Direction[1] * Ray.Direction[1] + (double)Ray.Direction[2] * Ray.Direction[2] );
+        double O[3], D[3], Nearest = -1.0;
+        long   MinX, MinZ, MaxX, MaxZ, x, z;
+        int    i;
+
+        for ( i = 0; i < 3; ++i ) { O[i] = Ray.Origin[i]; D[i] = Ray.Direction[i] / Length; }
+
+        double x0 = O[0] / TERRAIN_SCALE[0], x1 = (O[0] + D[0] * Ray.MaxDistance) / TERRAIN_SCALE[0];
+        double z0 = O[2] / TERRAIN_SCALE[2], z1 = (O[2] + D[2] * Ray.MaxDistance) / TERRAIN_SCALE[2];
+        MinX = (long)floor( x0 < x1 ? x0 : x1 ) - 1; MaxX = (long)floor( x0 > x1 ? x0 : x1 ) + 1;
+        MinZ = (long)floor( z0 < z1 ? z0 : z1 ) - 1; MaxZ = (long)floor( z0 > z1 ? z0 : z1 ) + 1;
+        if ( MinX < 0 ) MinX = 0;
+        if ( MaxX > (long)Width - 2 )  MaxX = (long)Width - 2;
+        if ( MinZ < 0 ) MinZ = 0;
+        if ( MaxZ > (long)Height - 2 ) MaxZ = (long)Height - 2;
+
+        for ( z = MinZ; z <= MaxZ; ++z )
+        {
+            for ( x = MinX; x <= MaxX; ++x )
+            {
+                const float * p = pHeightMap + x + z * Width;
+                double TL[3] = { x * TERRAIN_SCALE[0],       p[0]         * TERRAIN_SCALE[1], z * TERRAIN_SCALE[2] };
+                double TR[3] = { (x + 1) * TERRAIN_SCALE[0], p[1]         * TERRAIN_SCALE[1], z * TERRAIN_SCALE[2] };
+                double BL[3] = { x * TERRAIN_SCALE[0],       p[Width]     * TERRAIN_SCALE[1], (z + 1) * TERRAIN_SCALE[2] };
+                double BR[3] = { (x + 1) * TERRAIN_SCALE[0], p[Width + 1] * TERRAIN_SCALE[1], (z + 1) * TERRAIN_SCALE[2] };
+                double t;
+
+                t = IntersectTriangle( O, D, TL, BL, BR );
+                if ( t >= 0.0 && t <= Ray.MaxDistance && (Nearest < 0.0 || t < Nearest) ) Nearest = t;
+                t = IntersectTriangle( O, D, TL, BR, TR );
+                if ( t >= 0.0 && t <= Ray.MaxDistance && (Nearest < 0.0 || t < Nearest) ) Nearest = t;
+
+            } // Next Quad
+
+        } // Next Row
+
+        return Nearest;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GenerateRays ()
+    // Desc : Rays of the requested kind, all starting above the ground
+    //-------------------------------------------------------------------------
+    void GenerateRays( const float * pHeightMap, unsigned long Width, unsigned long Height, RAYKIND Kind, RAYQUERY * pRays, unsigned long Count )
+    {
+        float SizeX = (float)(Width - 1) * TERRAIN_SCALE[0], SizeZ = (float)(Height - 1) * TERRAIN_SCALE[2];
+        float Reach = ( SizeX < SizeZ ? SizeX : SizeZ ) * 0.25f;
+
+        for ( unsigned long i = 0; i < Count; ++i )
+        {
+            RAYQUERY & Ray = pRays[i];
+            float      Target[3];
+
+            Ray.Origin[0] = Random( 0.0f, SizeX );
+            Ray.Origin[2] = Random( 0.0f, SizeZ );
+
+            if ( Kind == RAY_SIGHT )
+            {
+                // Eye to eye, up to a quarter of the map apart
+                Target[0] = Ray.Origin[0] + Random( -Reach, Reach );
+                Target[2] = Ray.Origin[2] + Random( -Reach, Reach );
+                if ( Target[0] < 0.0f ) Target[0] = 0.0f;
+                if ( Target[0] > SizeX ) Target[0] = SizeX;
+                if ( Target[2] < 0.0f ) Target[2] = 0.0f;
+                if ( Target[2] > SizeZ ) Target[2] = SizeZ;
+                Ray.Origin[1] = HeightAt( pHeightMap, Width, Height, Ray.Origin[0], Ray.Origin[2] ) + EYE_HEIGHT;
+                Target[1]     = HeightAt( pHeightMap, Width, Height, Target[0], Target[2] ) + EYE_HEIGHT;
+
+            } // End if line of sight
+            else if ( Kind == RAY_PICK )
+            {
+                // Camera above the highest ground (even once raised by the
+                // update checks), looking down at 20 - 80 degrees
+                float Angle = Random( 0.0f, 6.2831853f ), Pitch = Random( 0.35f, 1.4f );
+                Ray.Origin[1] = 500.0f * TERRAIN_SCALE[1] + Random( 0.0f, 50.0f );
+                Target[0] = Ray.Origin[0] + cosf( Angle ) * cosf( Pitch ) * Reach * 4.0f;
+                Target[1] = Ray.Origin[1] - sinf( Pitch ) * Reach * 4.0f;
+                Target[2] = Ray.Origin[2] + sinf( Angle ) * cosf( Pitch ) * Reach * 4.0f;
+
+            } // End if picking
+            else
+            {
+                // Just above the ground, almost level, across most of the map
+                float Angle = Random( 0.0f, 6.2831853f );
+                Ray.Origin[1] = HeightAt( pHeightMap, Width, Height, Ray.Origin[0], Ray.Origin[2] ) + Random( 0.5f, 20.0f );
+                Target[0] = Ray.Origin[0] + cosf( Angle ) * Reach * 3.0f;
+                Target[1] = Ray.Origin[1] + Random( -0.01f, 0.01f ) * Reach;
+                Target[2] = Ray.Origin[2] + sinf( Angle ) * Reach * 3.0f;
+
+            } // End if grazing
+
+            Ray.Direction[0] = Target[0] - Ray.Origin[0];
+            Ray.Direction[1] = Target[1] - Ray.Origin[1];
+            Ray.Direction[2] = Target[2] - Ray.Origin[2];
+            Ray.MaxDistance  = sqrtf( Ray.Direction[0] * Ray.Direction[0] + Ray.Direction[1] * Ray.Direction[1] + Ray.Direction[2] * Ray.Direction[2] );
+            if ( Ray.MaxDistance <= 0.0f ) { Ray.Direction[1] = -1.0f; Ray.MaxDistance = 1.0f; }
+
+        } // Next Ray
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckRays ()
+    // Desc : Compare the pyramid against brute force for every kind of ray,
+    //        and occlusion only / batched results against single rays.
+    //-------------------------------------------------------------------------
+    bool CheckRays( const CTerrainRayCast & RayCast, const float * pHeightMap, unsigned long Width, unsigned long Height, CThreadPool * pPool )
+    {
+        const unsigned long Count = 2048;
+        RAYQUERY * pRays  = new RAYQUERY[ Count ];
+        RAYHIT   * pHits  = new RAYHIT[ Count ];
+        RAYHIT   * pBlock = new RAYHIT[ Count ];
+        bool       bPassed = true;
+
+        for ( int Kind = 0; Kind < RAY_KINDS && bPassed; ++Kind )
+        {
+            GenerateRays( pHeightMap, Width, Height, (RAYKIND)Kind, pRays, Count );
+            RayCast.IntersectBatch( pRays, Count, pHits, false, pPool );
+            RayCast.IntersectBatch( pRays, Count, pBlock, true, pPool );
+
+            for ( unsigned long i = 0; i < Count; ++i )
+            {
+                RAYHIT Single;
+                double Brute = BruteIntersect( pHeightMap, Width, Height, pRays[i] );
+                bool   bHit  = RayCast.Intersect( pRays[i].Origin, pRays[i].Direction, pRays[i].MaxDistance, &Single );
+
+                if ( bHit != (Brute >= 0.0) || bHit != pHits[i].Hit || bHit != pBlock[i].Hit ||
+                     ( bHit && ( fabs( Single.Distance - Brute ) > MAX_DISTANCE_ERROR || Single.Distance != pHits[i].Distance ) ) )
+                {
+                    printf( "FAILED : %lu x %lu %s ray %lu, hit %d / %d / %d / %d at %g / %g\n", Width, Height, KindNames[Kind], i,
+                            (int)bHit, (int)(Brute >= 0.0), (int)pHits[i].Hit, (int)pBlock[i].Hit, bHit ? Single.Distance : -1.0f, Brute );
+                    bPassed = false;
+                    break;
+
+                } // End if mismatch
+
+                // The point struck must be on the ground
+                if ( bHit && fabsf( Single.Position[1] - HeightAt( pHeightMap, Width, Height, Single.Position[0], Single.Position[2] ) ) > 1e-2f )
+                {
+                    printf( "FAILED : %lu x %lu %s ray %lu struck above / below the ground\n", Width, Height, KindNames[Kind], i );
+                    bPassed = false;
+                    break;
+
+                } // End if off the ground
+
+            } // Next Ray
+
+        } // Next Kind
+
+        delete []pRays;
+        delete []pHits;
+        delete []pBlock;
+        return bPassed;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifySmallMaps ()
+    // Desc : Brute force comparisons on small, odd sized maps, edge cases and
+    //        Update against a full rebuild.
+    //-------------------------------------------------------------------------
+    bool VerifySmallMaps( CThreadPool * pPool )
+    {
+        const unsigned long Sizes[][2] = { { 2, 2 }, { 3, 7 }, { 65, 65 }, { 97, 41 }, { 130, 129 } };
+        CTerrainRayCast     RayCast, Fresh;
+        float               Data[ 130 * 129 ];
+        RAYHIT              Hit;
+
+        // Invalid heightmaps
+        if ( RayCast.Build( Data, 1, 10, TERRAIN_SCALE ) || RayCast.Build( NULL, 10, 10, TERRAIN_SCALE ) ) return false;
+
+        for ( unsigned long s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); ++s )
+        {
+            unsigned long Width = Sizes[s][0], Height = Sizes[s][1];
+
+            GenerateHeightMap( Data, Width, Height, HEIGHTMAP_CREASED );
+            if ( !RayCast.Build( Data, Width, Height, TERRAIN_SCALE, pPool ) ) return false;
+            if ( !CheckRays( RayCast, Data, Width, Height, pPool ) ) return false;
+
+        } // Next Size
+
+        // Straight down on to a sample, and straight up / off the map
+        float Down[3] = { 0.0f, -1.0f, 0.0f }, Up[3] = { 0.0f, 1.0f, 0.0f }, Flat[3] = { 1.0f, 0.0f, 0.0f };
+        float Above[3] = { 10.0f * TERRAIN_SCALE[0], 1000.0f, 20.0f * TERRAIN_SCALE[2] };
+        float Outside[3] = { -50.0f, 1000.0f, 20.0f };
+        if ( !RayCast.Intersect( Above, Down, 2000.0f, &Hit ) ) return false;
+        if ( fabsf( Hit.Position[1] - Data[ 10 + 20 * 130 ] * TERRAIN_SCALE[1] ) > 1e-3f ) return false;
+        if ( RayCast.Intersect( Above, Up, 2000.0f ) || RayCast.Intersect( Outside, Down, 2000.0f ) ) return false;
+        if ( RayCast.Intersect( Above, Flat, 2000.0f ) ) return false;
+
+        // Too short to reach the ground, and starting beneath it
+        if ( RayCast.Intersect( Above, Down, 10.0f ) ) return false;
+        Above[1] = -10.0f;
+        if ( !RayCast.Intersect( Above, Flat, 1.0f, &Hit ) || Hit.Distance != 0.0f ) return false;
+
+        // Raise a region, update & compare with a fresh build
+        for ( unsigned long z = 30; z <= 50; ++z ) for ( unsigned long x = 100; x <= 129; ++x ) Data[ x + z * 130 ] += 150.0f;
+        RayCast.Update( 100, 30, 129, 50 );
+        if ( !Fresh.Build( Data, 130, 129, TERRAIN_SCALE ) ) return false;
+
+        RAYQUERY Rays[512];
+        RAYHIT   HitsA[512], HitsB[512];
+        for ( int Kind = 0; Kind < RAY_KINDS; ++Kind )
+        {
+            GenerateRays( Data, 130, 129, (RAYKIND)Kind, Rays, 512 );
+            RayCast.IntersectBatch( Rays, 512, HitsA );
+            Fresh.IntersectBatch( Rays, 512, HitsB );
+            for ( int i = 0; i < 512; ++i )
+            {
+                if ( HitsA[i].Hit != HitsB[i].Hit || (HitsA[i].Hit && HitsA[i].Distance != HitsB[i].Distance) ) return false;
+
+            } // Next Ray
+
+        } // Next Kind
+
+        return CheckRays( RayCast, Data, 130, 129, pPool );
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time each method for each kind of ray at each heightmap size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long Threads   = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 0;
+    unsigned long SizeCount = ( argc > 2 ) ? (unsigned long)(argc - 2) : 2;
+    CThreadPool   Pool;
+    bool          bPassed;
+
+    if ( !Pool.Create( Threads ) ) { printf( "Unable to create thread pool\n" ); return 1; }
+    bPassed = VerifySmallMaps( &Pool );
+    if ( !bPassed ) printf( "FAILED : small map checks\n" );
+
+    printf( "Terrain ray casts (thousands of rays per second), %lu thread(s)\n", Pool.GetThreadCount() );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long   Size  = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        CTerrainRayCast RayCast;
+        CBenchTimer     Timer;
+        double          fBuild[2];
+
+        if ( Size < 16 ) { printf( "\n  %-6lu skipped (too small)\n", Size ); continue; }
+
+        float    * pHeightMap = new float[ Size * Size ];
+        RAYQUERY * pRays      = new RAYQUERY[ RAY_COUNT ];
+        RAYHIT   * pHits      = new RAYHIT[ RAY_COUNT ];
+        RAYHIT   * pBlock     = new RAYHIT[ RAY_COUNT ];
+        GenerateHeightMap( pHeightMap, Size, Size, HEIGHTMAP_CREASED );
+
+        // Build on the calling thread, then across the pool
+        Timer.Reset();
+        RayCast.Build( pHeightMap, Size, Size, TERRAIN_SCALE );
+        fBuild[0] = Timer.Elapsed();
+        Timer.Reset();
+        RayCast.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        fBuild[1] = Timer.Elapsed();
+
+        printf( "\n  %lu x %lu, %lu levels, build %.2f ms (1 thread) %.2f ms (pool)\n\n", Size, Size, RayCast.GetLevelCount(), fBuild[0] * 1000.0, fBuild[1] * 1000.0 );
+        printf( "  Rays              Marching     Single      Batch   Occlusion    Hits  Marching\n" );
+        printf( "                                                        batch            agrees\n" );
+
+        for ( int Kind = 0; Kind < RAY_KINDS; ++Kind )
+        {
+            double        fTime[4];
+            unsigned long i, Hits, Agree = 0;
+            float         Sum = 0.0f;
+
+            GenerateRays( pHeightMap, Size, Size, (RAYKIND)Kind, pRays, RAY_COUNT );
+
+            // Marching, a subset
+            Timer.Reset();
+            for ( i = 0; i < MARCH_COUNT; ++i ) Sum += MarchRay( pHeightMap, Size, Size, pRays[i] );
+            fTime[0] = Timer.Elapsed();
+
+            // One at a time
+            Timer.Reset();
+            for ( i = 0; i < RAY_COUNT; ++i )
+            {
+                if ( RayCast.Intersect( pRays[i].Origin, pRays[i].Direction, pRays[i].MaxDistance, &pHits[i] ) ) Sum += pHits[i].Distance;
+            }
+            fTime[1] = Timer.Elapsed();
+
+            // Batched, then occlusion only
+            Timer.Reset();
+            Hits = RayCast.IntersectBatch( pRays, RAY_COUNT, pHits, false, &Pool );
+            fTime[2] = Timer.Elapsed();
+            Timer.Reset();
+            if ( RayCast.IntersectBatch( pRays, RAY_COUNT, pBlock, true, &Pool ) != Hits )
+            {
+                printf( "FAILED : %lu %s occlusion only hits differ\n", Size, KindNames[Kind] );
+                bPassed = false;
+
+            } // End if mismatch
+            fTime[3] = Timer.Elapsed();
+
+            // Marching misses thin ridges & clips corners, count how often it agrees
+            for ( i = 0; i < MARCH_COUNT; ++i ) if ( (MarchRay( pHeightMap, Size, Size, pRays[i] ) >= 0.0f) == pHits[i].Hit ) Agree++;
+
+            printf( "  %-14s %10.0f %10.0f %10.0f %10.0f %8.1f%% %8.1f%%\n", KindNames[Kind],
+                    MARCH_COUNT / fTime[0] / 1000.0, RAY_COUNT / fTime[1] / 1000.0, RAY_COUNT / fTime[2] / 1000.0,
+                    RAY_COUNT / fTime[3] / 1000.0, 100.0 * Hits / RAY_COUNT, 100.0 * Agree / MARCH_COUNT );
+            if ( Sum == 0.0f ) printf( "\n" );
+
+        } // Next Kind
+
+        delete []pHeightMap;
+        delete []pRays;
+        delete []pHits;
+        delete []pBlock;
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,562 @@
+//-----------------------------------------------------------------------------
+// File: TerrainCacheBench.cpp
+//
+// Desc: Headless validation and benchmark for the cooked terrain cache. A
+//       generated 16 bit heightmap is written out as a RAW file, and layer
+//       maps are generated alongside it. The terrain is then:
+//
+//         - built in full, as CTerrain does without a cache: the heightmap is
+//           loaded and filtered, then each block's layer usage, splat index
+//           lists (every level of detail) and blend texels are generated.
+//         - cooked to a cache file from the full build.
+//         - loaded from the cache: the file is mapped and validated, the
+//           heightmap copied out and every block's index lists and blend
+//           texels copied to stand in buffers as CreateResources would.
+//
+//       Everything loaded is checked against the full build. The cache must
+//       be rejected once stale (a source file is newer), for another key or
+//       version, or if truncated or damaged, and an incomplete or abandoned
+//       cook must not leave a file behind.
+//
+// Note: The layer maps are generated rather than decoded from images, and
+//       the occlusion pass is not reproduced, so the full build measured
+//       here is cheaper than CTerrain's.
+//
+// Build: g++ -O2 -msse2 TerrainCacheBench.cpp ../Source/CTerrainCache.cpp ../Source/CTerrainLOD.cpp ../Source/CHeightMap.cpp
+//            ../Source/CHeightMapFilter.cpp ../Source/CThreadPool.cpp -lpthread -o TerrainCacheBench
+//
+// Usage: TerrainCacheBench [Size [CacheFile]]
+//        Size defaults to 1025, the cache file to TerrainCacheBench.cache in
+//        the current folder (it is removed afterwards, with the RAW file).
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TerrainCacheBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainCache.h"
+#include "../Includes/CHeightMap.h"
+#include "../Includes/CHeightMapFilter.h"
+#include "../Includes/CThreadPool.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(_WIN32)
+    #include <sys/utime.h>
+#else
+    #include <utime.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const unsigned long QUADS       = 16;       // Quads per block side (BlockSize 17)
+    const unsigned long RATIO       = 4;        // Blend texels per quad
+    const unsigned long LAYERS      = 3;        // Layers, including the base layer
+    const char          RAW_FILE[]  = "TerrainCacheBench.raw";
+
+    //-------------------------------------------------------------------------
+    // Name : BUILTSPLAT (Struct)
+    // Desc : A splat level as the full build leaves it for CreateResources.
+    //-------------------------------------------------------------------------
+    struct BUILTSPLAT
+    {
+        CACHESPLAT        Record;           // Layer, ranges and counts
+        unsigned short  * pIndices;         // Index list (NULL if shared)
+        unsigned short  * pBlend;           // Blend texels (NULL for the base layer)
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BUILTTERRAIN (Struct)
+    // Desc : Everything the full build produces.
+    //-------------------------------------------------------------------------
+    struct BUILTTERRAIN
+    {
+        float           * pHeightMap;       // Filtered heightmap
+        unsigned short  * pUsage;           // LAYERS per block
+        BUILTSPLAT      * pSplats;          // LAYERS per block, pIndices / pBlend NULL if unused
+        unsigned long     BlockCount;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : GenerateLayers ()
+    // Desc : Base layer everywhere, then two overlapping painted patterns,
+    //        clamped as CTerrain clamps them (nothing below 15, 255 above 220).
+    //-------------------------------------------------------------------------
+    void GenerateLayers( unsigned char * ppLayers[LAYERS], unsigned long Width )
+    {
+        unsigned long x, z, i;
+
+        memset( ppLayers[0], 255, Width * Width );
+        for ( z = 0; z < Width; ++z )
+        {
+            for ( x = 0; x < Width; ++x )
+            {
+                float Value[2];
+                Value[0] = sinf( (float)x * 0.004f ) * sinf( (float)z * 0.003f ) * 400.0f;
+                Value[1] = cosf( (float)(x + 2 * z) * 0.002f ) * 300.0f - 60.0f;
+
+                for ( i = 0; i < 2; ++i )
+                {
+                    long v = (long)Value[i];
+                    if ( v < 15 ) v = 0;
+                    if ( v > 220 ) v = 255;
+                    ppLayers[ i + 1 ][ x + z * Width ] = (unsigned char)v;
+
+                } // Next Layer
+
+            } // Next Column
+
+        } // Next Row
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BuildSplat ()
+    // Desc : Layer usage, quad mask, index lists and blend texels of one layer
+    //        of one block, as CTerrainBlock builds them (shared indices on).
+    //-------------------------------------------------------------------------
+    unsigned short BuildSplat( const unsigned char * pLayer, unsigned long LayerWidth, unsigned long Layer,
+                               unsigned long BlockX, unsigned long BlockZ, unsigned char * pQuadMask, BUILTSPLAT & Splat )
+    {
+        unsigned long  x, z, ax, az, Level, IndexCount = 0, Usage = 0;
+        bool           bFullCoverage = true;
+        LODRANGE       Ranges[MAX_TERRAIN_LOD][CTerrainLOD::RANGE_COUNT];
+        const unsigned char * pBlock = pLayer + (BlockX * QUADS * RATIO) + (BlockZ * QUADS * RATIO) * LayerWidth;
+
+        // Which quads is the layer visible in ?
+        for ( z = 0; z < QUADS; ++z )
+        {
+            for ( x = 0; x < QUADS; ++x )
+            {
+                unsigned long Texels = 0;
+                for ( az = 0; az < RATIO; ++az )
+                {
+                    for ( ax = 0; ax < RATIO; ++ax ) if ( pBlock[ (x * RATIO + ax) + (z * RATIO + az) * LayerWidth ] ) Texels++;
+
+                } // Next Texel Row
+
+                pQuadMask[ x + z * QUADS ] = ( Texels > 0 );
+                if ( !Texels ) bFullCoverage = false;
+                Usage += Texels;
+
+            } // Next Quad
+
+        } // Next Quad Row
+        if ( !Usage ) return 0;
+
+        // Measure, then build, every level's index list
+        memset( &Splat.Record, 0, sizeof(CACHESPLAT) );
+        Splat.Record.Layer    = (unsigned short)Layer;
+        Splat.Record.LODCount = CTerrainLOD::GetLevelCount( QUADS, QUADS );
+        for ( Level = 0; Level < Splat.Record.LODCount; ++Level )
+        {
+            IndexCount += CTerrainLOD::BuildIndices( QUADS, QUADS, Level, pQuadMask, NULL, IndexCount, Ranges[Level] );
+
+        } // Next Level
+
+        if ( bFullCoverage )
+        {
+            Splat.Record.SharedIndices = 1;
+
+        } // End if shared
+        else
+        {
+            if ( IndexCount == 0 ) IndexCount = 1;
+            Splat.pIndices = new unsigned short[ IndexCount ];
+            Splat.pIndices[0] = 0;
+            Splat.Record.IndexCount = IndexCount;
+            for ( Level = 0, IndexCount = 0; Level < Splat.Record.LODCount; ++Level )
+            {
+                IndexCount += CTerrainLOD::BuildIndices( QUADS, QUADS, Level, pQuadMask, Splat.pIndices + IndexCount, IndexCount, Ranges[Level] );
+
+            } // Next Level
+
+        } // End if own indices
+
+        for ( Level = 0; Level < Splat.Record.LODCount; ++Level )
+        {
+            for ( x = 0; x < CTerrainLOD::RANGE_COUNT; ++x )
+            {
+                Splat.Record.Ranges[Level][x][0] = Ranges[Level][x].StartIndex;
+                Splat.Record.Ranges[Level][x][1] = Ranges[Level][x].PrimitiveCount;
+
+            } // Next Range
+
+        } // Next Level
+
+        // Blend texels (A4R4G4B4), never for the base layer
+        if ( Layer > 0 )
+        {
+            Splat.Record.BlendTexels = (QUADS * RATIO) * (QUADS * RATIO);
+            Splat.pBlend = new unsigned short[ Splat.Record.BlendTexels ];
+            for ( z = 0; z < QUADS * RATIO; ++z )
+            {
+                for ( x = 0; x < QUADS * RATIO; ++x ) Splat.pBlend[ x + z * QUADS * RATIO ] = (unsigned short)((pBlock[ x + z * LayerWidth ] << 8) & 0xF000);
+
+            } // Next Row
+
+        } // End if blended
+
+        return (unsigned short)( Usage > 65535 ? 65535 : Usage );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : FullBuild ()
+    // Desc : Load & filter the heightmap, then build every block's splats.
+    //-------------------------------------------------------------------------
+    bool FullBuild( unsigned long Size, unsigned char * ppLayers[LAYERS], const CHeightMapFilter & Filter, CThreadPool & Pool, BUILTTERRAIN & Terrain )
+    {
+        unsigned long  BlocksWide = (Size - 1) / QUADS, LayerWidth = (Size - 1) * RATIO, b, l;
+        unsigned char  QuadMask[ QUADS * QUADS ];
+
+        Terrain.BlockCount = BlocksWide * BlocksWide;
+        Terrain.pHeightMap = new float[ Size * Size ];
+        Terrain.pUsage     = new unsigned short[ Terrain.BlockCount * LAYERS ];
+        Terrain.pSplats    = new BUILTSPLAT[ Terrain.BlockCount * LAYERS ];
+        memset( Terrain.pSplats, 0, Terrain.BlockCount * LAYERS * sizeof(BUILTSPLAT) );
+
+        if ( !CHeightMap::LoadRaw( RAW_FILE, CHeightMap::FORMAT_UINT16, Terrain.pHeightMap, Size * Size ) ) return false;
+        if ( !Filter.Apply( Terrain.pHeightMap, Size, Size, &Pool ) ) return false;
+
+        for ( b = 0; b < Terrain.BlockCount; ++b )
+        {
+            for ( l = 0; l < LAYERS; ++l )
+            {
+                Terrain.pUsage[ b * LAYERS + l ] = BuildSplat( ppLayers[l], LayerWidth, l, b % BlocksWide, b / BlocksWide, QuadMask, Terrain.pSplats[ b * LAYERS + l ] );
+
+            } // Next Layer
+
+        } // Next Block
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ReleaseBuild ()
+    //-------------------------------------------------------------------------
+    void ReleaseBuild( BUILTTERRAIN & Terrain )
+    {
+        for ( unsigned long i = 0; i < Terrain.BlockCount * LAYERS; ++i )
+        {
+            delete []Terrain.pSplats[i].pIndices;
+            delete []Terrain.pSplats[i].pBlend;
+
+        } // Next Splat
+        delete []Terrain.pSplats;
+        delete []Terrain.pUsage;
+        delete []Terrain.pHeightMap;
+        memset( &Terrain, 0, sizeof(BUILTTERRAIN) );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : Cook ()
+    // Desc : Write the full build to a cache file, as CTerrain does. Blocks
+    //        listed in 'Skip' are left out (to test incomplete cooks).
+    //-------------------------------------------------------------------------
+    bool Cook( const char * FileName, const TERRAINCACHEKEY & Key, const BUILTTERRAIN & Terrain, long Skip = -1 )
+    {
+        CTerrainCache Cache;
+        unsigned long b, l;
+
+        if ( !Cache.Create( FileName, Key, Terrain.BlockCount, Terrain.pHeightMap ) ) return false;
+        for ( b = 0; b < Terrain.BlockCount; ++b )
+        {
+            if ( (long)b == Skip ) continue;
+            if ( !Cache.BeginBlock( b ) || !Cache.Write( Terrain.pUsage + b * LAYERS, LAYERS * sizeof(unsigned short) ) ) return false;
+            for ( l = 0; l < LAYERS; ++l )
+            {
+                const BUILTSPLAT & Splat = Terrain.pSplats[ b * LAYERS + l ];
+                if ( !Terrain.pUsage[ b * LAYERS + l ] ) continue;
+                if ( !Cache.Write( &Splat.Record, sizeof(CACHESPLAT) ) ) return false;
+                if ( !Cache.Write( Splat.pIndices, Splat.Record.IndexCount * sizeof(unsigned short) ) ) return false;
+                if ( !Cache.Write( Splat.pBlend, Splat.Record.BlendTexels * sizeof(unsigned short) ) ) return false;
+
+            } // Next Layer
+            if ( !Cache.EndBlock() ) return false;
+
+        } // Next Block
+
+        return Cache.Commit();
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CachedLoad ()
+    // Desc : Load the terrain from the cache, copying the heightmap out and
+    //        every index list / blend texel array to stand in device buffers.
+    //        Returns the number of blocks which do not match the full build,
+    //        or -1 if the cache could not be opened.
+    //-------------------------------------------------------------------------
+    long CachedLoad( const char * FileName, const TERRAINCACHEKEY & Key, unsigned long Size, const BUILTTERRAIN & Terrain,
+                     float * pHeightMap, unsigned short * pDevice )
+    {
+        CTerrainCache Cache;
+        CACHECURSOR   Cursor;
+        unsigned long b, l;
+        long          Bad = 0;
+
+        if ( !Cache.Open( FileName, Key ) ) return -1;
+        memcpy( pHeightMap, Cache.GetHeightMap(), Size * Size * sizeof(float) );
+
+        for ( b = 0; b < Terrain.BlockCount; ++b )
+        {
+            const unsigned short * pUsage;
+            bool bMatch = Cache.GetBlock( b, Cursor );
+
+            pUsage = bMatch ? (const unsigned short*)CTerrainCache::Read( Cursor, LAYERS * sizeof(unsigned short) ) : NULL;
+            if ( !pUsage || memcmp( pUsage, Terrain.pUsage + b * LAYERS, LAYERS * sizeof(unsigned short) ) != 0 ) { Bad++; continue; }
+
+            for ( l = 0; l < LAYERS && bMatch; ++l )
+            {
+                const BUILTSPLAT & Splat = Terrain.pSplats[ b * LAYERS + l ];
+                const CACHESPLAT * pRecord;
+                const void       * pIndices, * pBlend;
+                if ( !pUsage[l] ) continue;
+
+                pRecord  = (const CACHESPLAT*)CTerrainCache::Read( Cursor, sizeof(CACHESPLAT) );
+                if ( !pRecord || memcmp( pRecord, &Splat.Record, sizeof(CACHESPLAT) ) != 0 ) { bMatch = false; break; }
+                pIndices = CTerrainCache::Read( Cursor, pRecord->IndexCount * sizeof(unsigned short) );
+                pBlend   = CTerrainCache::Read( Cursor, pRecord->BlendTexels * sizeof(unsigned short) );
+                if ( !pIndices || !pBlend ) { bMatch = false; break; }
+
+                // Upload, then compare the upload with the full build
+                memcpy( pDevice, pIndices, pRecord->IndexCount * sizeof(unsigned short) );
+                if ( pRecord->IndexCount && memcmp( pDevice, Splat.pIndices, pRecord->IndexCount * sizeof(unsigned short) ) != 0 ) bMatch = false;
+                memcpy( pDevice, pBlend, pRecord->BlendTexels * sizeof(unsigned short) );
+                if ( pRecord->BlendTexels && memcmp( pDevice, Splat.pBlend, pRecord->BlendTexels * sizeof(unsigned short) ) != 0 ) bMatch = false;
+
+            } // Next Layer
+
+            // Nothing may be left over
+            if ( !bMatch || Cursor.Remaining != 0 ) Bad++;
+
+        } // Next Block
+
+        return Bad;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : FileExists ()
+    //-------------------------------------------------------------------------
+    bool FileExists( const char * FileName )
+    {
+        FILE * pFile = fopen( FileName, "rb" );
+        if ( !pFile ) return false;
+        fclose( pFile );
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CopyCacheFile ()
+    // Desc : Copy a file, optionally truncated (Length bytes) and with one
+    //        byte inverted (at Flip, if Flip < Length).
+    //-------------------------------------------------------------------------
+    bool CopyCacheFile( const char * Source, const char * Dest, long Length, long Flip )
+    {
+        FILE * pIn = fopen( Source, "rb" ), * pOut = fopen( Dest, "wb" );
+        long   i;
+        int    c;
+
+        if ( !pIn || !pOut ) { if ( pIn ) fclose( pIn ); if ( pOut ) fclose( pOut ); return false; }
+        for ( i = 0; i < Length && (c = fgetc( pIn )) != EOF; ++i ) fputc( i == Flip ? (c ^ 0xFF) : c, pOut );
+        fclose( pIn );
+        fclose( pOut );
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SetModified ()
+    // Desc : Move a file's modification time relative to now.
+    //-------------------------------------------------------------------------
+    void SetModified( const char * FileName, long Seconds )
+    {
+#if defined(_WIN32)
+        struct _utimbuf Times;
+        Times.actime = Times.modtime = time( NULL ) + Seconds;
+        _utime( FileName, &Times );
+#else
+        struct utimbuf Times;
+        Times.actime = Times.modtime = time( NULL ) + Seconds;
+        utime( FileName, &Times );
+#endif
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main ()
+// Desc : Entry point
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long    Size     = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 1025;
+    const char     * FileName = ( argc > 2 ) ? argv[2] : "TerrainCacheBench.cache";
+    char             Damaged[512];
+    bool             bPassed  = true;
+    unsigned long    LayerWidth, i, Splats = 0, Indices = 0;
+    long             Bad, FileSize;
+    double           BuildTime, CookTime, LoadTime;
+    BUILTTERRAIN     Terrain;
+    TERRAINCACHEKEY  Key, OtherKey;
+    CHeightMapFilter Filter;
+    CThreadPool      Pool;
+    CBenchTimer      Timer;
+
+    if ( Size < QUADS * 4 + 1 || ((Size - 1) % QUADS) != 0 )
+    {
+        printf( "Size must be a multiple of %lu plus one, and at least %lu\n", QUADS, QUADS * 4 + 1 );
+        return 1;
+
+    } // End if invalid size
+    sprintf( Damaged, "%.500s.bad", FileName );
+
+    // Write the source heightmap, and generate the layer maps
+    {
+        float          * pHeights = new float[ Size * Size ];
+        unsigned short * pRaw     = new unsigned short[ Size * Size ];
+        FILE           * pFile    = fopen( RAW_FILE, "wb" );
+        GenerateHeightMap( pHeights, Size, Size, HEIGHTMAP_RIDGED );
+        for ( i = 0; i < Size * Size; ++i ) pRaw[i] = (unsigned short)(pHeights[i] * 256.0f);
+        if ( !pFile || fwrite( pRaw, sizeof(unsigned short), Size * Size, pFile ) != Size * Size ) { printf( "FAILED : could not write %s\n", RAW_FILE ); return 1; }
+        fclose( pFile );
+        delete []pHeights;
+        delete []pRaw;
+    }
+    LayerWidth = (Size - 1) * RATIO;
+    unsigned char * ppLayers[LAYERS];
+    for ( i = 0; i < LAYERS; ++i ) ppLayers[i] = new unsigned char[ LayerWidth * LayerWidth ];
+    GenerateLayers( ppLayers, LayerWidth );
+
+    // The settings the terrain is built with
+    memset( &Key, 0, sizeof(TERRAINCACHEKEY) );
+    Key.MapWidth = Key.MapHeight = Size;
+    Key.BlockWidth = Key.BlockHeight = QUADS + 1;
+    Key.BlendTexRatio    = RATIO;
+    Key.LayerCount       = LAYERS;
+    Key.SharedIndices    = 1;
+    Key.HeightFormat     = CHeightMap::FORMAT_UINT16;
+    Key.FilterType       = CHeightMapFilter::FILTER_BOX;
+    Key.FilterRadius     = 1;
+    Key.FilterIterations = 1;
+    Filter.SetFilter( CHeightMapFilter::FILTER_BOX, 1, 1 );
+    Pool.Create();
+
+    // Full build
+    memset( &Terrain, 0, sizeof(BUILTTERRAIN) );
+    Timer.Reset();
+    if ( !FullBuild( Size, ppLayers, Filter, Pool, Terrain ) ) { printf( "FAILED : full build\n" ); return 1; }
+    BuildTime = Timer.Elapsed();
+    for ( i = 0; i < Terrain.BlockCount * LAYERS; ++i )
+    {
+        if ( Terrain.pUsage[i] ) Splats++;
+        Indices += Terrain.pSplats[i].Record.IndexCount;
+
+    } // Next Splat
+
+    // Cook it
+    remove( FileName );
+    Timer.Reset();
+    if ( !Cook( FileName, Key, Terrain ) ) { printf( "FAILED : could not cook %s\n", FileName ); bPassed = false; }
+    CookTime = Timer.Elapsed();
+    {
+        FILE * pFile = fopen( FileName, "rb" );
+        FileSize = -1;
+        if ( pFile ) { fseek( pFile, 0, SEEK_END ); FileSize = ftell( pFile ); fclose( pFile ); }
+    }
+
+    // Load it back (best of three, the first run pulls the file in to the page cache)
+    float          * pHeightMap = new float[ Size * Size ];
+    unsigned short * pDevice    = new unsigned short[ 65536 ];
+    LoadTime = 1e9;
+    for ( i = 0; i < 3; ++i )
+    {
+        Timer.Reset();
+        Bad = CachedLoad( FileName, Key, Size, Terrain, pHeightMap, pDevice );
+        if ( Timer.Elapsed() < LoadTime ) LoadTime = Timer.Elapsed();
+
+    } // Next Run
+    if ( Bad < 0 ) { printf( "FAILED : could not open the cooked terrain\n" ); bPassed = false; }
+    if ( Bad > 0 ) { printf( "FAILED : %ld blocks do not match the full build\n", Bad ); bPassed = false; }
+    if ( memcmp( pHeightMap, Terrain.pHeightMap, Size * Size * sizeof(float) ) != 0 ) { printf( "FAILED : heightmap does not match the full build\n" ); bPassed = false; }
+
+    printf( "%lux%lu heightmap, %lu blocks, %lu splat levels, %lu indices, %lu layers at %lu texels per quad\n\n",
+            Size, Size, Terrain.BlockCount, Splats, Indices, LAYERS, RATIO );
+    printf( "  Full build     %9.2fms\n", BuildTime * 1000.0 );
+    printf( "  Cook           %9.2fms  (%.1f MB)\n", CookTime * 1000.0, (double)FileSize / (1024.0 * 1024.0) );
+    printf( "  Cached load    %9.2fms  %6.1fx\n\n", LoadTime * 1000.0, BuildTime / LoadTime );
+
+    // The cache must be rejected for other settings
+    OtherKey = Key;
+    OtherKey.FilterRadius = 2;
+    if ( CachedLoad( FileName, OtherKey, Size, Terrain, pHeightMap, pDevice ) >= 0 ) { printf( "FAILED : cache accepted for another filter\n" ); bPassed = false; }
+    OtherKey = Key;
+    OtherKey.BlendTexRatio = RATIO * 2;
+    if ( CachedLoad( FileName, OtherKey, Size, Terrain, pHeightMap, pDevice ) >= 0 ) { printf( "FAILED : cache accepted for another blend ratio\n" ); bPassed = false; }
+
+    // Or when damaged anywhere, or truncated
+    const long Flips[4] = { 4, (long)sizeof(TERRAINCACHEHEADER) + 7, FileSize / 2, FileSize - 3 };
+    for ( i = 0; i < 4; ++i )
+    {
+        CopyCacheFile( FileName, Damaged, FileSize, Flips[i] );
+        if ( CachedLoad( Damaged, Key, Size, Terrain, pHeightMap, pDevice ) >= 0 ) { printf( "FAILED : cache accepted with byte %ld damaged\n", Flips[i] ); bPassed = false; }
+
+    } // Next Flip
+    CopyCacheFile( FileName, Damaged, FileSize - 8, -1 );
+    if ( CachedLoad( Damaged, Key, Size, Terrain, pHeightMap, pDevice ) >= 0 ) { printf( "FAILED : truncated cache accepted\n" ); bPassed = false; }
+    CopyCacheFile( FileName, Damaged, FileSize, FileSize );
+    if ( CachedLoad( Damaged, Key, Size, Terrain, pHeightMap, pDevice ) != 0 ) { printf( "FAILED : intact copy rejected\n" ); bPassed = false; }
+    remove( Damaged );
+
+    // Reads may not run past the end of a record
+    {
+        CTerrainCache Cache;
+        CACHECURSOR   Cursor;
+        if ( !Cache.Open( FileName, Key ) || !Cache.GetBlock( 0, Cursor ) ) { printf( "FAILED : could not read block 0\n" ); bPassed = false; }
+        else if ( CTerrainCache::Read( Cursor, Cursor.Remaining + 1 ) || !CTerrainCache::Read( Cursor, Cursor.Remaining ) || Cursor.Remaining != 0 )
+        {
+            printf( "FAILED : record bounds not enforced\n" );
+            bPassed = false;
+
+        } // End if unbounded
+        if ( Cache.GetBlock( Terrain.BlockCount, Cursor ) ) { printf( "FAILED : read a block beyond the table\n" ); bPassed = false; }
+    }
+
+    // Staleness, newer sources invalidate the cache, missing ones do not
+    SetModified( RAW_FILE, -10 );
+    if ( CTerrainCache::IsNewer( RAW_FILE, FileName ) ) { printf( "FAILED : older source reported as newer\n" ); bPassed = false; }
+    SetModified( RAW_FILE, 10 );
+    if ( !CTerrainCache::IsNewer( RAW_FILE, FileName ) ) { printf( "FAILED : newer source not detected\n" ); bPassed = false; }
+    if ( CTerrainCache::IsNewer( "TerrainCacheBench.missing", FileName ) ) { printf( "FAILED : missing source reported as newer\n" ); bPassed = false; }
+
+    // An incomplete cook must fail and leave the existing cache alone
+    if ( Cook( FileName, Key, Terrain, (long)Terrain.BlockCount / 2 ) ) { printf( "FAILED : incomplete cook committed\n" ); bPassed = false; }
+    if ( CachedLoad( FileName, Key, Size, Terrain, pHeightMap, pDevice ) != 0 ) { printf( "FAILED : cache damaged by an incomplete cook\n" ); bPassed = false; }
+
+    // An abandoned cook must leave nothing behind
+    {
+        CTerrainCache Cache;
+        char          TempName[520];
+        sprintf( TempName, "%.500s.tmp", Damaged );
+        if ( !Cache.Create( Damaged, Key, Terrain.BlockCount, Terrain.pHeightMap ) || !FileExists( TempName ) ) { printf( "FAILED : could not start a cook\n" ); bPassed = false; }
+        Cache.Close();
+        if ( FileExists( TempName ) || FileExists( Damaged ) ) { printf( "FAILED : abandoned cook left a file behind\n" ); bPassed = false; }
+    }
+
+    // Clean up
+    delete []pHeightMap;
+    delete []pDevice;
+    for ( i = 0; i < LAYERS; ++i ) delete []ppLayers[i];
+    ReleaseBuild( Terrain );
+    remove( FileName );
+    remove( RAW_FILE );
+
+    printf( "%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+//-----------------------------------------------------------------------------
+// File: TerrainCullBench.cpp
+//
+// Desc: Headless validation and benchmark for the terrain block quadtree.
+//       A camera flies over generated terrains, first low and looking ahead
+//       then high and looking down, and every frame's visible block set is
+//       found twice:
+//
+//         - linearly, testing every block's box against all six planes in
+//           the same way as CCamera::BoundsInFrustum (the old Render loop),
+//         - with CTerrainQuadTree::Cull.
+//
+//       The two sets must be identical. The same is checked on odd grid
+//       sizes and with a random half of the blocks removed (as when
+//       streaming), and the boxes / planes tested and time taken by each
+//       method are reported.
+//
+// Build: g++ -O2 TerrainCullBench.cpp ../Source/CTerrainQuadTree.cpp -o TerrainCullBench
+//
+// Usage: TerrainCullBench [Size ...]
+//        Sizes default to 1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TerrainCullBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainQuadTree.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float         Scale[3]    = { 4.0f, 0.5f, 4.0f }; // World scale of the test terrain
+    const unsigned long BLOCK_QUADS = 16;                   // Quads per block side (BlockSize 17)
+    const unsigned long FRAMES      = 256;                  // Frames simulated per terrain
+    const float         FOV         = 60.0f;                // Camera vertical FOV (degrees)
+    const float         ASPECT      = 4.0f / 3.0f;          // Viewport aspect ratio
+    const float         NEAR_CLIP   = 1.0f;                 // Near plane distance
+    const float         FAR_CLIP    = 5000.0f;              // Far plane distance
+
+    //-------------------------------------------------------------------------
+    // Name : BOX (Struct)
+    // Desc : A block's bounding box.
+    //-------------------------------------------------------------------------
+    struct BOX
+    {
+        float   Min[3], Max[3];
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : SetPlane ()
+    // Desc : Store a plane with this outward normal passing through 'Point'.
+    //-------------------------------------------------------------------------
+    void SetPlane( float * pPlane, float nx, float ny, float nz, const float Point[3] )
+    {
+        float Length = sqrtf( nx * nx + ny * ny + nz * nz );
+        pPlane[0] = nx / Length;
+        pPlane[1] = ny / Length;
+        pPlane[2] = nz / Length;
+        pPlane[3] = -(pPlane[0] * Point[0] + pPlane[1] * Point[1] + pPlane[2] * Point[2]);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BuildFrustum ()
+    // Desc : Six outward facing planes (left, right, top, bottom, near, far)
+    //        for a camera at 'Pos' with this yaw and pitch (radians).
+    //-------------------------------------------------------------------------
+    void BuildFrustum( float * pPlanes, const float Pos[3], float Yaw, float Pitch )
+    {
+        float Look[3]  = { sinf( Yaw ) * cosf( Pitch ), sinf( Pitch ), cosf( Yaw ) * cosf( Pitch ) };
+        float Right[3] = { cosf( Yaw ), 0.0f, -sinf( Yaw ) };
+        float Up[3]    = { Look[1] * Right[2] - Look[2] * Right[1], Look[2] * Right[0] - Look[0] * Right[2], Look[0] * Right[1] - Look[1] * Right[0] };
+        float ty = tanf( FOV * 0.5f * 3.14159265f / 180.0f ), tx = ty * ASPECT;
+        float NearPoint[3], FarPoint[3];
+        int   i;
+
+        for ( i = 0; i < 3; ++i ) { NearPoint[i] = Pos[i] + Look[i] * NEAR_CLIP; FarPoint[i] = Pos[i] + Look[i] * FAR_CLIP; }
+
+        SetPlane( pPlanes +  0, -Right[0] - tx * Look[0], -Right[1] - tx * Look[1], -Right[2] - tx * Look[2], Pos );
+        SetPlane( pPlanes +  4,  Right[0] - tx * Look[0],  Right[1] - tx * Look[1],  Right[2] - tx * Look[2], Pos );
+        SetPlane( pPlanes +  8,  Up[0] - ty * Look[0],     Up[1] - ty * Look[1],     Up[2] - ty * Look[2], Pos );
+        SetPlane( pPlanes + 12, -Up[0] - ty * Look[0],    -Up[1] - ty * Look[1],    -Up[2] - ty * Look[2], Pos );
+        SetPlane( pPlanes + 16, -Look[0], -Look[1], -Look[2], NearPoint );
+        SetPlane( pPlanes + 20,  Look[0],  Look[1],  Look[2], FarPoint );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : LinearInFrustum ()
+    // Desc : Box test as performed by CCamera::BoundsInFrustum.
+    //-------------------------------------------------------------------------
+    bool LinearInFrustum( const float * pPlanes, const BOX & Box, unsigned long & PlanesTested )
+    {
+        for ( unsigned long i = 0; i < 6; ++i )
+        {
+            const float * p = pPlanes + i * 4;
+            float Near[3];
+
+            Near[0] = ( p[0] > 0.0f ) ? Box.Min[0] : Box.Max[0];
+            Near[1] = ( p[1] > 0.0f ) ? Box.Min[1] : Box.Max[1];
+            Near[2] = ( p[2] > 0.0f ) ? Box.Min[2] : Box.Max[2];
+            PlanesTested++;
+            if ( p[0] * Near[0] + p[1] * Near[1] + p[2] * Near[2] + p[3] > 0.0f ) return false;
+
+        } // Next Plane
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CompareSets ()
+    // Desc : Are the two visible lists the same set of blocks?
+    //-------------------------------------------------------------------------
+    bool CompareSets( const unsigned long * pA, unsigned long CountA, const unsigned long * pB, unsigned long CountB, unsigned char * pScratch, unsigned long BlockCount )
+    {
+        unsigned long i;
+        bool          bSame = ( CountA == CountB );
+
+        memset( pScratch, 0, BlockCount );
+        for ( i = 0; i < CountA; ++i ) pScratch[ pA[i] ]++;
+        for ( i = 0; i < CountB && bSame; ++i ) if ( pScratch[ pB[i] ]-- != 1 ) bSame = false;
+        return bSame;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyGrid ()
+    // Desc : Random boxes and frustums on an arbitrary grid, with and without
+    //        some of the blocks removed.
+    //-------------------------------------------------------------------------
+    bool VerifyGrid( unsigned long Wide, unsigned long High )
+    {
+        CTerrainQuadTree Tree;
+        unsigned long    Count = Wide * High, i, Trial;
+        BOX            * pBoxes   = new BOX[ Count ];
+        unsigned char  * pPresent = new unsigned char[ Count ];
+        unsigned char  * pScratch = new unsigned char[ Count ];
+        unsigned long  * pLinear  = new unsigned long[ Count ];
+        unsigned long  * pTree    = new unsigned long[ Count ];
+        float            Planes[24];
+        bool             bPassed  = Tree.Build( Wide, High );
+
+        srand( (unsigned int)(Wide * 977 + High) );
+        for ( i = 0; i < Count && bPassed; ++i )
+        {
+            float y = (float)(rand() % 100);
+            pBoxes[i].Min[0] = (float)(i % Wide) * 64.0f; pBoxes[i].Max[0] = pBoxes[i].Min[0] + 64.0f;
+            pBoxes[i].Min[2] = (float)(i / Wide) * 64.0f; pBoxes[i].Max[2] = pBoxes[i].Min[2] + 64.0f;
+            pBoxes[i].Min[1] = y;                         pBoxes[i].Max[1] = y + (float)(rand() % 40);
+            Tree.SetBlockBounds( i, pBoxes[i].Min, pBoxes[i].Max );
+            pPresent[i] = 1;
+
+        } // Next Block
+
+        for ( Trial = 0; Trial < 200 && bPassed; ++Trial )
+        {
+            unsigned long LinearCount = 0, TreeCount, Unused = 0;
+            float         Pos[3] = { (float)(rand() % (Wide * 64 + 256)) - 128.0f, (float)(rand() % 300), (float)(rand() % (High * 64 + 256)) - 128.0f };
+
+            // Drop (or restore) some blocks half way through
+            if ( Trial == 100 )
+            {
+                for ( i = 0; i < Count; ++i )
+                {
+                    pPresent[i] = (unsigned char)(rand() & 1);
+                    if ( pPresent[i] ) Tree.SetBlockBounds( i, pBoxes[i].Min, pBoxes[i].Max ); else Tree.ClearBlockBounds( i );
+
+                } // Next Block
+
+            } // End if removing
+
+            BuildFrustum( Planes, Pos, (float)(rand() % 628) * 0.01f, -(float)(rand() % 150) * 0.01f );
+            for ( i = 0; i < Count; ++i ) if ( pPresent[i] && LinearInFrustum( Planes, pBoxes[i], Unused ) ) pLinear[ LinearCount++ ] = i;
+            TreeCount = Tree.Cull( Planes, pTree );
+
+            if ( !CompareSets( pLinear, LinearCount, pTree, TreeCount, pScratch, Count ) )
+            {
+                printf( "FAILED : %lux%lu grid, trial %lu, linear found %lu blocks, quadtree %lu\n", Wide, High, Trial, LinearCount, TreeCount );
+                bPassed = false;
+
+            } // End if different
+
+        } // Next Trial
+
+        delete []pBoxes;
+        delete []pPresent;
+        delete []pScratch;
+        delete []pLinear;
+        delete []pTree;
+        return bPassed;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main ()
+// Desc : Entry point
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long GridSizes[][2] = { { 1, 1 }, { 1, 7 }, { 3, 5 }, { 16, 16 }, { 13, 29 }, { 64, 33 } };
+    unsigned long SizeCount = ( argc > 1 ) ? (unsigned long)(argc - 1) : 2;
+    bool          bPassed   = true;
+    unsigned long i;
+
+    // Hierarchy checks
+    for ( i = 0; i < sizeof(GridSizes) / sizeof(GridSizes[0]); ++i )
+    {
+        if ( !VerifyGrid( GridSizes[i][0], GridSizes[i][1] ) ) bPassed = false;
+
+    } // Next Grid
+    printf( "Quadtree and linear culling agree on %lu test grids\n\n", (unsigned long)(sizeof(GridSizes) / sizeof(GridSizes[0])) );
+
+    printf( "Per frame averages, %lu frames, %lux%lu quad blocks, far plane %g\n\n", FRAMES, BLOCK_QUADS, BLOCK_QUADS, FAR_CLIP );
+    printf( "  Size   Blocks   Nodes   Visible   Linear Boxes / Planes      Tree Nodes / Boxes / Planes   Linear    Tree\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long Size = ( argc > 1 ) ? strtoul( argv[s + 1], NULL, 10 ) : DefaultSizes[s];
+        if ( Size < BLOCK_QUADS + 1 || ((Size - 1) % BLOCK_QUADS) != 0 ) { printf( "  %-6lu skipped (must be a multiple of %lu, plus one)\n", Size, BLOCK_QUADS ); continue; }
+
+        unsigned long    BlocksWide = (Size - 1) / BLOCK_QUADS, BlockCount = BlocksWide * BlocksWide;
+        unsigned long    x, z, Frame;
+        float          * pHeightMap = new float[ Size * Size ];
+        BOX            * pBoxes     = new BOX[ BlockCount ];
+        unsigned long  * pLinear    = new unsigned long[ BlockCount ];
+        unsigned long  * pTree      = new unsigned long[ BlockCount ];
+        unsigned char  * pScratch   = new unsigned char[ BlockCount ];
+        double           LinearTime = 0.0, TreeTime = 0.0, Visible = 0.0, LinearPlanes = 0.0;
+        double           Nodes = 0.0, Boxes = 0.0, Planes = 0.0;
+        CTerrainQuadTree Tree;
+
+        GenerateHeightMap( pHeightMap, Size, Size, HEIGHTMAP_RIDGED );
+
+        // Block bounds, as CTerrainBlock::GenerateBlock
+        Tree.Build( BlocksWide, BlocksWide );
+        for ( z = 0; z < BlocksWide; ++z )
+        {
+            for ( x = 0; x < BlocksWide; ++x )
+            {
+                BOX & Box = pBoxes[ x + z * BlocksWide ];
+                float MinY = 1e9f, MaxY = -1e9f;
+
+                for ( unsigned long az = 0; az <= BLOCK_QUADS; ++az )
+                {
+                    for ( unsigned long ax = 0; ax <= BLOCK_QUADS; ++ax )
+                    {
+                        float y = pHeightMap[ (x * BLOCK_QUADS + ax) + (z * BLOCK_QUADS + az) * Size ] * Scale[1];
+                        if ( y < MinY ) MinY = y;
+                        if ( y > MaxY ) MaxY = y;
+
+                    } // Next Column
+
+                } // Next Row
+
+                Box.Min[0] = (float)(x * BLOCK_QUADS) * Scale[0];       Box.Min[1] = MinY; Box.Min[2] = (float)(z * BLOCK_QUADS) * Scale[2];
+                Box.Max[0] = (float)((x + 1) * BLOCK_QUADS) * Scale[0]; Box.Max[1] = MaxY; Box.Max[2] = (float)((z + 1) * BLOCK_QUADS) * Scale[2];
+                Tree.SetBlockBounds( x + z * BlocksWide, Box.Min, Box.Max );
+
+            } // Next Block
+
+        } // Next Block Row
+
+        // Fly low across the terrain turning slowly, then climb and look down
+        for ( Frame = 0; Frame < FRAMES; ++Frame )
+        {
+            float         t = ((float)Frame + 0.5f) / (float)FRAMES, Pos[3], FrustumPlanes[24];
+            unsigned long LinearCount = 0, TreeCount, PlanesTested = 0;
+            bool          bHigh = ( Frame >= FRAMES * 3 / 4 );
+            CULLSTATS     Stats;
+            CBenchTimer   Timer;
+
+            Pos[0] = (0.1f + 0.8f * t) * (float)(Size - 1) * Scale[0];
+            Pos[2] = (0.2f + 0.6f * t) * (float)(Size - 1) * Scale[2];
+            Pos[1] = pHeightMap[ (unsigned long)(Pos[0] / Scale[0]) + (unsigned long)(Pos[2] / Scale[2]) * Size ] * Scale[1] + ( bHigh ? 1500.0f : 20.0f );
+            BuildFrustum( FrustumPlanes, Pos, t * 6.2831853f, bHigh ? -1.2f : -0.15f );
+
+            // The old Render loop
+            Timer.Reset();
+            for ( unsigned long j = 0; j < BlockCount; ++j ) if ( LinearInFrustum( FrustumPlanes, pBoxes[j], PlanesTested ) ) pLinear[ LinearCount++ ] = j;
+            LinearTime += Timer.Elapsed();
+
+            // The quadtree
+            Timer.Reset();
+            TreeCount = Tree.Cull( FrustumPlanes, pTree, &Stats );
+            TreeTime += Timer.Elapsed();
+
+            if ( !CompareSets( pLinear, LinearCount, pTree, TreeCount, pScratch, BlockCount ) )
+            {
+                printf( "FAILED : %lu map, frame %lu, linear found %lu blocks, quadtree %lu\n", Size, Frame, LinearCount, TreeCount );
+                bPassed = false;
+
+            } // End if different
+
+            Visible      += TreeCount;
+            LinearPlanes += PlanesTested;
+            Nodes        += Stats.NodesVisited;
+            Boxes        += Stats.BoxesTested;
+            Planes       += Stats.PlanesTested;
+
+        } // Next Frame
+
+        printf( "  %-6lu %-8lu %-7lu %7.0f   %12lu / %-9.0f %12.0f / %5.0f / %-9.0f %6.3fms %6.3fms\n", Size, BlockCount, Tree.GetNodeCount(),
+                Visible / FRAMES, BlockCount, LinearPlanes / FRAMES, Nodes / FRAMES, Boxes / FRAMES, Planes / FRAMES,
+                LinearTime * 1000.0 / FRAMES, TreeTime * 1000.0 / FRAMES );
+
+        delete []pHeightMap;
+        delete []pBoxes;
+        delete []pLinear;
+        delete []pTree;
+        delete []pScratch;
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+//-----------------------------------------------------------------------------
+// File: TerrainEditBench.cpp
+//
+// Desc: Headless validation and benchmark for interactive terrain editing.
+//       On small maps every brush is checked to only modify the samples it
+//       reports, to apply the falloff it describes, and (for painting) to
+//       reach its target, and the blocks found for an edited region are
+//       checked against every block's own extents.
+//
+//       At each size a brush stroke (a run of overlapping dabs, as applied
+//       once per frame while a button is held) is then timed doing the CPU
+//       work CTerrain::EditHeights does for each dab:
+//
+//         - the brush itself,
+//         - regenerating the affected normals,
+//         - refitting the ray cast pyramid,
+//         - remeasuring the level of detail errors of the dirty blocks,
+//
+//       against rebuilding all of it for the whole map, as reloading the
+//       terrain would. The incremental results are checked against a full
+//       rebuild at the end of the stroke. Re-uploading the dirty vertex and
+//       blend texture regions needs a device, and is not measured here.
+//
+// Build: g++ -O2 -msse2 TerrainEditBench.cpp ../Source/CTerrainBrush.cpp ../Source/CNormalMap.cpp ../Source/CTerrainRayCast.cpp
+//            ../Source/CTerrainLOD.cpp ../Source/CThreadPool.cpp -lpthread -o TerrainEditBench
+//
+// Usage: TerrainEditBench [Threads] [Size ...]
+//        Threads defaults to one per logical processor, sizes default to
+//        1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TerrainEditBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainBrush.h"
+#include "../Includes/CNormalMap.h"
+#include "../Includes/CTerrainRayCast.h"
+#include "../Includes/CTerrainLOD.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float         TERRAIN_SCALE[3] = { 190.0f, 10.0f, 190.0f };
+    const unsigned long QUADS_PER_BLOCK  = 32;      // Block size used to find the dirty blocks
+    const unsigned long STROKE_DABS      = 64;      // Brush applications per timed stroke
+    const float         BRUSH_RADIUS     = 12.0f;   // Brush radius (samples)
+    const unsigned long CHECK_RAYS       = 4096;    // Rays compared after the stroke
+
+    //-------------------------------------------------------------------------
+    // Name : MakeBrush ()
+    // Desc : Fill out a brush.
+    //-------------------------------------------------------------------------
+    TERRAINBRUSH MakeBrush( float x, float z, float Radius, float Hardness, float Strength, float Target )
+    {
+        TERRAINBRUSH Brush;
+        Brush.x = x; Brush.z = z; Brush.Radius = Radius;
+        Brush.Hardness = Hardness; Brush.Strength = Strength; Brush.Target = Target;
+        return Brush;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : InRect ()
+    // Desc : Is the sample within the rectangle ?
+    //-------------------------------------------------------------------------
+    inline bool InRect( const EDITRECT & Rect, long x, long z )
+    {
+        return x >= Rect.MinX && x <= Rect.MaxX && z >= Rect.MinZ && z <= Rect.MaxZ;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckHeightBrush ()
+    // Desc : Apply one height brush to a copy of the map and check that only
+    //        the samples reported (and weighted) changed, by the expected
+    //        amount where that is simple to state.
+    //-------------------------------------------------------------------------
+    bool CheckHeightBrush( const float * pOriginal, unsigned long Width, unsigned long Height, const TERRAINBRUSH & Brush,
+                           CTerrainBrush::MODE Mode )
+    {
+        float  * pMap = new float[ Width * Height ];
+        EDITRECT Changed;
+        bool     bTouches, bOK = true;
+        long     x, z;
+
+        memcpy( pMap, pOriginal, Width * Height * sizeof(float) );
+        bTouches = CTerrainBrush::ApplyHeights( pMap, Width, Height, Brush, Mode, Changed );
+        if ( bTouches == CTerrainBrush::IsRectEmpty( Changed ) ) bOK = false;
+
+        for ( z = 0; z < (long)Height && bOK; ++z )
+        {
+            for ( x = 0; x < (long)Width && bOK; ++x )
+            {
+                float Before = pOriginal[ x + z * Width ], After = pMap[ x + z * Width ];
+                float Weight = CTerrainBrush::GetWeight( Brush, (float)x, (float)z );
+
+                // Nothing outside the brush may change
+                if ( ( !InRect( Changed, x, z ) || Weight == 0.0f ) && After != Before ) bOK = false;
+                if ( Weight == 0.0f ) continue;
+
+                if ( Mode == CTerrainBrush::MODE_RAISE && fabsf( After - (Before + Brush.Strength * Weight) ) > 1e-4f ) bOK = false;
+                if ( Mode == CTerrainBrush::MODE_LOWER && fabsf( After - (Before - Brush.Strength * Weight) ) > 1e-4f ) bOK = false;
+                if ( Mode == CTerrainBrush::MODE_FLATTEN && Weight == 1.0f && Brush.Strength >= 1.0f && fabsf( After - Brush.Target ) > 1e-4f ) bOK = false;
+
+            } // Next Column
+
+        } // Next Row
+
+        delete []pMap;
+        return bOK;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyBrushes ()
+    // Desc : Brush checks on small maps, including brushes hanging off (or
+    //        entirely outside) the edges.
+    //-------------------------------------------------------------------------
+    bool VerifyBrushes( )
+    {
+        const unsigned long Width = 37, Height = 23;
+        float         Map[ Width * Height ], Flat[ Width * Height ];
+        unsigned char Weights[ Width * Height ], Before[ Width * Height ];
+        float         Positions[][2] = { { 18.0f, 11.0f }, { 0.0f, 0.0f }, { 36.5f, 22.0f }, { 3.3f, 20.7f }, { -5.0f, 11.0f } };
+        EDITRECT      Changed;
+        unsigned long i, m, n;
+        long          x, z;
+
+        GenerateHeightMap( Map, Width, Height );
+        for ( i = 0; i < Width * Height; ++i ) Flat[i] = 42.0f;
+
+        // Falloff
+        TERRAINBRUSH Brush = MakeBrush( 10.0f, 10.0f, 8.0f, 0.5f, 1.0f, 0.0f );
+        if ( CTerrainBrush::GetWeight( Brush, 10.0f, 10.0f ) != 1.0f || CTerrainBrush::GetWeight( Brush, 14.0f, 10.0f ) != 1.0f ) return false;
+        if ( CTerrainBrush::GetWeight( Brush, 18.0f, 10.0f ) != 0.0f || CTerrainBrush::GetWeight( Brush, 10.0f, 30.0f ) != 0.0f ) return false;
+        if ( fabsf( CTerrainBrush::GetWeight( Brush, 16.0f, 10.0f ) - 0.5f ) > 1e-6f ) return false;
+
+        // Every mode, at every position, hard and soft
+        for ( m = 0; m < CTerrainBrush::MODE_COUNT; ++m )
+        {
+            for ( i = 0; i < sizeof(Positions) / sizeof(Positions[0]); ++i )
+            {
+                for ( n = 0; n < 2; ++n )
+                {
+                    Brush = MakeBrush( Positions[i][0], Positions[i][1], 6.5f, n ? 1.0f : 0.25f, n ? 1.0f : 3.0f, 77.0f );
+                    if ( !CheckHeightBrush( Map, Width, Height, Brush, (CTerrainBrush::MODE)m ) ) return false;
+
+                } // Next Hardness
+
+            } // Next Position
+
+        } // Next Mode
+
+        // Entirely outside the map touches nothing
+        Brush = MakeBrush( -20.0f, 5.0f, 6.0f, 0.5f, 1.0f, 0.0f );
+        if ( CTerrainBrush::ApplyHeights( Map, Width, Height, Brush, CTerrainBrush::MODE_RAISE, Changed ) ) return false;
+        if ( CTerrainBrush::GetRegion( MakeBrush( 10.0f, 10.0f, 0.0f, 0.5f, 1.0f, 0.0f ), Width, Height, Changed ) ) return false;
+
+        // Smoothing leaves a flat map alone, and removes noise
+        Brush = MakeBrush( 18.0f, 11.0f, 30.0f, 1.0f, 1.0f, 0.0f );
+        CTerrainBrush::ApplyHeights( Flat, Width, Height, Brush, CTerrainBrush::MODE_SMOOTH, Changed );
+        for ( i = 0; i < Width * Height; ++i ) if ( Flat[i] != 42.0f ) return false;
+
+        double Rough[2] = { 0.0, 0.0 };
+        for ( n = 0; n < 2; ++n )
+        {
+            for ( z = 1; z < (long)Height - 1; ++z ) for ( x = 1; x < (long)Width - 1; ++x )
+            {
+                float d = 2.0f * Map[ x + z * Width ] - Map[ x - 1 + z * Width ] - Map[ x + 1 + z * Width ];
+                Rough[n] += d * d;
+            }
+            if ( n == 0 ) CTerrainBrush::ApplyHeights( Map, Width, Height, Brush, CTerrainBrush::MODE_SMOOTH, Changed );
+
+        } // Next Pass
+        if ( Rough[1] > Rough[0] * 0.5 ) return false;
+
+        // Painting reaches its target at the centre (however gently), touches
+        // nothing outside, and erases back again
+        memset( Weights, 0, sizeof(Weights) );
+        Brush = MakeBrush( 18.0f, 11.0f, 6.0f, 0.3f, 0.05f, 255.0f );
+        for ( i = 0; i < 400; ++i ) CTerrainBrush::ApplyWeights( Weights, Width, Height, Brush, Changed );
+        if ( Weights[ 18 + 11 * Width ] != 255 || Weights[ 18 + 5 * Width ] != 0 ) return false;
+        for ( z = 0; z < (long)Height; ++z ) for ( x = 0; x < (long)Width; ++x )
+        {
+            if ( CTerrainBrush::GetWeight( Brush, (float)x, (float)z ) == 0.0f && Weights[ x + z * Width ] != 0 ) return false;
+        }
+
+        memcpy( Before, Weights, sizeof(Weights) );
+        Brush.Target = 0.0f;
+        Brush.Strength = 1.0f;
+        CTerrainBrush::ApplyWeights( Weights, Width, Height, Brush, Changed );
+        for ( i = 0; i < Width * Height; ++i ) if ( Weights[i] > Before[i] ) return false;
+        if ( Weights[ 18 + 11 * Width ] != 0 ) return false;
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyBlockRanges ()
+    // Desc : Compare GetBlockRange against the extents of every block, with
+    //        and without shared edges, for a spread of rectangles.
+    //-------------------------------------------------------------------------
+    bool VerifyBlockRanges( )
+    {
+        const unsigned long BlocksWide = 5, BlocksHigh = 4, Cells = 8;
+        EDITRECT      Rect, Blocks;
+        unsigned long i, Shared;
+        long          bx, bz;
+
+        srand( 7 );
+        for ( i = 0; i < 2000; ++i )
+        {
+            for ( Shared = 0; Shared < 2; ++Shared )
+            {
+                long Extent = (long)(BlocksWide * Cells + Shared);
+
+                Rect.MinX = rand() % Extent; Rect.MaxX = Rect.MinX + rand() % 12;
+                Rect.MinZ = rand() % Extent; Rect.MaxZ = Rect.MinZ + rand() % 12;
+
+                bool bAny = CTerrainBrush::GetBlockRange( Rect, Cells, Cells, Shared != 0, BlocksWide, BlocksHigh, Blocks );
+                bool bFound = false;
+
+                for ( bz = 0; bz < (long)BlocksHigh; ++bz )
+                {
+                    for ( bx = 0; bx < (long)BlocksWide; ++bx )
+                    {
+                        // The block's own samples (shared edges include the far side)
+                        long MinX = bx * Cells, MaxX = MinX + Cells - 1 + Shared;
+                        long MinZ = bz * Cells, MaxZ = MinZ + Cells - 1 + Shared;
+                        bool bOverlaps = Rect.MinX <= MaxX && Rect.MaxX >= MinX && Rect.MinZ <= MaxZ && Rect.MaxZ >= MinZ;
+
+                        if ( bOverlaps != ( bAny && InRect( Blocks, bx, bz ) ) ) return false;
+                        if ( bOverlaps ) bFound = true;
+
+                    } // Next Block Column
+
+                } // Next Block Row
+
+                if ( bFound != bAny ) return false;
+
+            } // Next Mode
+
+        } // Next Rect
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : DirtyBlocks ()
+    // Desc : The blocks whose vertices must be rebuilt after the samples in
+    //        'Changed' are modified, as CTerrain::EditHeights finds them (the
+    //        lighting of a vertex reads the normals to its right and below).
+    //-------------------------------------------------------------------------
+    bool DirtyBlocks( const EDITRECT & Changed, unsigned long Size, EDITRECT & Blocks )
+    {
+        EDITRECT Vertices = Changed;
+        unsigned long BlockCount = (Size - 1) / QUADS_PER_BLOCK;
+
+        CTerrainBrush::GrowRect( Vertices, 2, 1, Size, Size );
+        return CTerrainBrush::GetBlockRange( Vertices, QUADS_PER_BLOCK, QUADS_PER_BLOCK, true, BlockCount, BlockCount, Blocks );
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main () (Application Entry Point)
+// Desc : Time a brush stroke at each heightmap size.
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long Threads   = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 0;
+    unsigned long SizeCount = ( argc > 2 ) ? (unsigned long)(argc - 2) : 2;
+    CThreadPool   Pool;
+    bool          bPassed = true;
+
+    if ( !Pool.Create( Threads ) ) { printf( "Unable to create thread pool\n" ); return 1; }
+    if ( !VerifyBrushes() ) { printf( "FAILED : small map brush checks\n" ); bPassed = false; }
+    if ( !VerifyBlockRanges() ) { printf( "FAILED : dirty block ranges\n" ); bPassed = false; }
+
+    printf( "Terrain editing, per dab of a %lu dab stroke (radius %g samples, %lu quad blocks), %lu thread(s)\n\n",
+            STROKE_DABS, BRUSH_RADIUS, QUADS_PER_BLOCK, Pool.GetThreadCount() );
+    printf( "  Size      Brush    Normals   Pyramid    LOD Err    Total     Blocks     Full rebuild   Speedup\n" );
+    printf( "             (us)      (us)      (us)       (us)      (ms)     per dab        (ms)\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long   Size  = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        unsigned long   Count = Size * Size, BlockCount, i, Dirty = 0, bx, bz;
+        double          fTime[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 }, fFull;
+        float           Errors[ MAX_TERRAIN_LOD ];
+        CNormalMap      Normals, FreshNormals;
+        CTerrainRayCast RayCast, FreshRayCast;
+        CBenchTimer     Timer;
+        EDITRECT        Changed, Blocks;
+
+        if ( Size < 2 * QUADS_PER_BLOCK + 1 ) { printf( "  %-6lu    skipped (too small)\n", Size ); continue; }
+        BlockCount = (Size - 1) / QUADS_PER_BLOCK;
+
+        float * pHeightMap = new float[ Count ];
+        GenerateHeightMap( pHeightMap, Size, Size );
+        Normals.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        RayCast.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+
+        // A stroke across the middle of the map, cycling through the modes
+        for ( i = 0; i < STROKE_DABS; ++i )
+        {
+            float        Along = (float)i / (float)STROKE_DABS;
+            TERRAINBRUSH Brush = MakeBrush( (float)Size * (0.3f + 0.4f * Along), (float)Size * (0.4f + 0.2f * Along), BRUSH_RADIUS, 0.4f, 0.5f, 100.0f );
+            CTerrainBrush::MODE Mode = (CTerrainBrush::MODE)( (i / 8) % CTerrainBrush::MODE_COUNT );
+
+            if ( Mode == CTerrainBrush::MODE_RAISE || Mode == CTerrainBrush::MODE_LOWER ) Brush.Strength = 4.0f;
+
+            Timer.Reset();
+            CTerrainBrush::ApplyHeights( pHeightMap, Size, Size, Brush, Mode, Changed );
+            fTime[0] += Timer.Elapsed();
+
+            Timer.Reset();
+            Normals.Update( Changed.MinX, Changed.MinZ, Changed.MaxX, Changed.MaxZ, &Pool );
+            fTime[1] += Timer.Elapsed();
+
+            Timer.Reset();
+            RayCast.Update( Changed.MinX, Changed.MinZ, Changed.MaxX, Changed.MaxZ );
+            fTime[2] += Timer.Elapsed();
+
+            Timer.Reset();
+            if ( DirtyBlocks( Changed, Size, Blocks ) )
+            {
+                for ( bz = Blocks.MinZ; bz <= (unsigned long)Blocks.MaxZ; ++bz )
+                {
+                    for ( bx = Blocks.MinX; bx <= (unsigned long)Blocks.MaxX; ++bx, ++Dirty )
+                    {
+                        CTerrainLOD::CalculateErrors( pHeightMap, Size, bx * QUADS_PER_BLOCK, bz * QUADS_PER_BLOCK,
+                                                      QUADS_PER_BLOCK, QUADS_PER_BLOCK, TERRAIN_SCALE[1], Errors );
+
+                    } // Next Block Column
+
+                } // Next Block Row
+
+            } // End if any blocks
+            fTime[3] += Timer.Elapsed();
+
+        } // Next Dab
+
+        // Everything the stroke touched, rebuilt from scratch
+        Timer.Reset();
+        FreshNormals.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        FreshRayCast.Build( pHeightMap, Size, Size, TERRAIN_SCALE, &Pool );
+        for ( bz = 0; bz < BlockCount; ++bz ) for ( bx = 0; bx < BlockCount; ++bx )
+        {
+            CTerrainLOD::CalculateErrors( pHeightMap, Size, bx * QUADS_PER_BLOCK, bz * QUADS_PER_BLOCK,
+                                          QUADS_PER_BLOCK, QUADS_PER_BLOCK, TERRAIN_SCALE[1], Errors );
+        }
+        fFull = Timer.Elapsed();
+
+        // The incremental results must match
+        if ( memcmp( Normals.GetData(), FreshNormals.GetData(), Count * 2 * sizeof(short) ) != 0 )
+        {
+            printf( "FAILED : %lu updated normals differ from a full rebuild\n", Size );
+            bPassed = false;
+
+        } // End if mismatch
+
+        RAYQUERY * pRays  = new RAYQUERY[ CHECK_RAYS ];
+        RAYHIT   * pHitsA = new RAYHIT[ CHECK_RAYS ];
+        RAYHIT   * pHitsB = new RAYHIT[ CHECK_RAYS ];
+        srand( 3 );
+        for ( i = 0; i < CHECK_RAYS; ++i )
+        {
+            float x = (float)Size * (0.25f + 0.5f * (float)rand() / (float)RAND_MAX) * TERRAIN_SCALE[0];
+            float z = (float)Size * (0.35f + 0.3f * (float)rand() / (float)RAND_MAX) * TERRAIN_SCALE[2];
+            pRays[i].Origin[0]    = x; pRays[i].Origin[1] = 500.0f * TERRAIN_SCALE[1]; pRays[i].Origin[2] = z;
+            pRays[i].Direction[0] = (float)(rand() % 200 - 100); pRays[i].Direction[1] = -100.0f; pRays[i].Direction[2] = (float)(rand() % 200 - 100);
+            pRays[i].MaxDistance  = 1e9f;
+
+        } // Next Ray
+        RayCast.IntersectBatch( pRays, CHECK_RAYS, pHitsA, false, &Pool );
+        FreshRayCast.IntersectBatch( pRays, CHECK_RAYS, pHitsB, false, &Pool );
+        for ( i = 0; i < CHECK_RAYS; ++i )
+        {
+            if ( pHitsA[i].Hit != pHitsB[i].Hit || ( pHitsA[i].Hit && pHitsA[i].Distance != pHitsB[i].Distance ) )
+            {
+                printf( "FAILED : %lu updated pyramid differs from a full rebuild\n", Size );
+                bPassed = false;
+                break;
+
+            } // End if mismatch
+
+        } // Next Ray
+
+        fTime[4] = fTime[0] + fTime[1] + fTime[2] + fTime[3];
+        printf( "  %-6lu %9.2f %9.2f %9.2f %9.2f %10.4f %9.1f %14.2f %9.0fx\n", Size,
+                fTime[0] * 1e6 / STROKE_DABS, fTime[1] * 1e6 / STROKE_DABS, fTime[2] * 1e6 / STROKE_DABS, fTime[3] * 1e6 / STROKE_DABS,
+                fTime[4] * 1e3 / STROKE_DABS, (double)Dirty / STROKE_DABS, fFull * 1e3, fFull / (fTime[4] / STROKE_DABS) );
+
+        delete []pRays;
+        delete []pHitsA;
+        delete []pHitsB;
+        delete []pHeightMap;
+
+    } // Next Size
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,560 @@
+//-----------------------------------------------------------------------------
+// File: TerrainLODBench.cpp
+//
+// Desc: Headless validation and triangle count benchmark for the terrain
+//       block geomipmapping. The first part checks every level / stitch
+//       combination built by CTerrainLOD for a few block sizes:
+//
+//         - the surface covers every quad of the block exactly once, with
+//           every triangle wound the same way as the full detail mesh,
+//         - each edge uses exactly the vertices of the level it is matched to
+//           (its own, or the next coarser when stitched), so neighbouring
+//           blocks never leave T-junctions,
+//         - measured and written index counts agree, masked sets only hold
+//           masked quads,
+//         - the level errors match a brute force measurement of the built
+//           meshes and never decrease.
+//
+//       The second part flies a camera over generated terrains, selecting
+//       levels in the same way as CTerrain::Render, and reports the number of
+//       triangles submitted per frame with LOD disabled and enabled (no
+//       frustum culling in either case).
+//
+// Build: g++ -O2 TerrainLODBench.cpp ../Source/CTerrainLOD.cpp -o TerrainLODBench
+//
+// Usage: TerrainLODBench [PixelError [Size ...]]
+//        PixelError defaults to 4, sizes default to 1025 4097.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TerrainLODBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainLOD.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float         Scale[3]    = { 4.0f, 0.5f, 4.0f }; // World scale of the test terrain
+    const unsigned long BLOCK_QUADS = 16;                   // Quads per block side (BlockSize 17)
+    const unsigned long FRAMES      = 256;                  // Frames simulated per terrain
+    const float         FOV         = 60.0f;                // Camera vertical FOV (degrees)
+    const unsigned long VIEWPORT    = 768;                  // Viewport height (pixels)
+
+    //-------------------------------------------------------------------------
+    // Name : LODSET (Struct)
+    // Desc : Every level's index set for one block layout, as stored by a
+    //        CTerrainSplat.
+    //-------------------------------------------------------------------------
+    struct LODSET
+    {
+        unsigned long   QuadsWide, QuadsHigh, LevelCount, IndexCount;
+        unsigned short* pIndices;
+        LODRANGE        Ranges[MAX_TERRAIN_LOD][CTerrainLOD::RANGE_COUNT];
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BuildSet ()
+    // Desc : Measure and then build every level, in the same way as
+    //        CTerrainBlock::GenerateSplatLevel.
+    //-------------------------------------------------------------------------
+    bool BuildSet( LODSET & Set, unsigned long QuadsWide, unsigned long QuadsHigh, const unsigned char * pQuadMask )
+    {
+        unsigned long Level, Measured = 0, Written = 0;
+
+        Set.QuadsWide  = QuadsWide;
+        Set.QuadsHigh  = QuadsHigh;
+        Set.LevelCount = CTerrainLOD::GetLevelCount( QuadsWide, QuadsHigh );
+        for ( Level = 0; Level < Set.LevelCount; ++Level ) Measured += CTerrainLOD::BuildIndices( QuadsWide, QuadsHigh, Level, pQuadMask, NULL, Measured, Set.Ranges[Level] );
+
+        Set.pIndices = new unsigned short[ Measured + 1 ];
+        for ( Level = 0; Level < Set.LevelCount; ++Level ) Written += CTerrainLOD::BuildIndices( QuadsWide, QuadsHigh, Level, pQuadMask, Set.pIndices + Written, Written, Set.Ranges[Level] );
+        Set.IndexCount = Written;
+
+        return ( Measured == Written );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GatherTriangles ()
+    // Desc : Collect the triangles drawn for a level / stitch mask, as grid
+    //        coordinates (x0, z0, x1, z1, x2, z2 per triangle).
+    //-------------------------------------------------------------------------
+    unsigned long GatherTriangles( const LODSET & Set, unsigned long Level, unsigned long StitchMask, long * pCoords )
+    {
+        LODRANGE      Draws[ CTerrainLOD::EDGE_COUNT + 1 ];
+        unsigned long DrawCount = CTerrainLOD::BuildDrawList( Set.Ranges[Level], StitchMask, Draws ), Count = 0;
+        unsigned long Pitch = Set.QuadsWide + 1;
+
+        for ( unsigned long d = 0; d < DrawCount; ++d )
+        {
+            for ( unsigned long i = 0; i < Draws[d].PrimitiveCount * 3; ++i, ++Count )
+            {
+                unsigned short Index = Set.pIndices[ Draws[d].StartIndex + i ];
+                pCoords[ Count * 2 ]     = (long)(Index % Pitch);
+                pCoords[ Count * 2 + 1 ] = (long)(Index / Pitch);
+
+            } // Next Index
+
+        } // Next Draw
+
+        return Count / 3;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SignedArea ()
+    // Desc : Twice the signed area of a triangle in grid coordinates.
+    //-------------------------------------------------------------------------
+    long SignedArea( const long * p )
+    {
+        return (p[2] - p[0]) * (p[5] - p[1]) - (p[3] - p[1]) * (p[4] - p[0]);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CoverCount ()
+    // Desc : Number of triangles containing the point (fx, fz), which must
+    //        not lie on any triangle edge.
+    //-------------------------------------------------------------------------
+    unsigned long CoverCount( const long * pCoords, unsigned long TriCount, float fx, float fz )
+    {
+        unsigned long Count = 0;
+
+        for ( unsigned long t = 0; t < TriCount; ++t )
+        {
+            const long * p = pCoords + t * 6;
+            float d0 = (p[2] - p[0]) * (fz - p[1]) - (p[3] - p[1]) * (fx - p[0]);
+            float d1 = (p[4] - p[2]) * (fz - p[3]) - (p[5] - p[3]) * (fx - p[2]);
+            float d2 = (p[0] - p[4]) * (fz - p[5]) - (p[1] - p[5]) * (fx - p[4]);
+            if ( (d0 < 0 && d1 < 0 && d2 < 0) || (d0 > 0 && d1 > 0 && d2 > 0) ) Count++;
+
+        } // Next Triangle
+
+        return Count;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : EdgeVertexMask ()
+    // Desc : Which positions along an edge (0 - Length) are used by the mesh.
+    //-------------------------------------------------------------------------
+    void EdgeVertexMask( const long * pCoords, unsigned long TriCount, unsigned long Edge, unsigned long QuadsWide, unsigned long QuadsHigh, unsigned char * pUsed )
+    {
+        unsigned long Length = ( Edge == CTerrainLOD::EDGE_TOP || Edge == CTerrainLOD::EDGE_BOTTOM ) ? QuadsWide : QuadsHigh;
+
+        memset( pUsed, 0, Length + 1 );
+        for ( unsigned long i = 0; i < TriCount * 3; ++i )
+        {
+            long x = pCoords[ i * 2 ], z = pCoords[ i * 2 + 1 ];
+            switch ( Edge )
+            {
+                case CTerrainLOD::EDGE_TOP:    if ( z == 0 )               pUsed[x] = 1; break;
+                case CTerrainLOD::EDGE_RIGHT:  if ( x == (long)QuadsWide ) pUsed[z] = 1; break;
+                case CTerrainLOD::EDGE_BOTTOM: if ( z == (long)QuadsHigh ) pUsed[x] = 1; break;
+                case CTerrainLOD::EDGE_LEFT:   if ( x == 0 )               pUsed[z] = 1; break;
+
+            } // End Switch
+
+        } // Next Vertex
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyTopology ()
+    // Desc : Coverage, winding and edge vertex checks for every level and
+    //        stitch combination of one block size.
+    //-------------------------------------------------------------------------
+    bool VerifyTopology( unsigned long QuadsWide, unsigned long QuadsHigh )
+    {
+        LODSET          Set;
+        bool            bPassed = true;
+        long          * pCoords = new long[ QuadsWide * QuadsHigh * 12 ];
+        unsigned char * pUsed   = new unsigned char[ (QuadsWide > QuadsHigh ? QuadsWide : QuadsHigh) + 1 ];
+
+        if ( !BuildSet( Set, QuadsWide, QuadsHigh, NULL ) ) { printf( "FAILED : %lux%lu measured / written index counts differ\n", QuadsWide, QuadsHigh ); bPassed = false; }
+
+        for ( unsigned long Level = 0; Level < Set.LevelCount; ++Level )
+        {
+            unsigned long Step      = 1UL << Level;
+            bool          bCoarser  = ( Level + 1 < Set.LevelCount );
+            unsigned long MaskCount = bCoarser ? 16 : 1;
+
+            for ( unsigned long Mask = 0; Mask < MaskCount; ++Mask )
+            {
+                unsigned long TriCount = GatherTriangles( Set, Level, Mask, pCoords ), t, x, z, e;
+                long          Area = 0;
+
+                // Consistent winding (matching the full detail mesh) and area
+                for ( t = 0; t < TriCount; ++t )
+                {
+                    long TriArea = SignedArea( pCoords + t * 6 );
+                    if ( TriArea >= 0 ) { printf( "FAILED : %lux%lu level %lu mask %lu triangle %lu is degenerate or flipped\n", QuadsWide, QuadsHigh, Level, Mask, t ); bPassed = false; break; }
+                    Area -= TriArea;
+
+                } // Next Triangle
+                if ( Area != (long)(QuadsWide * QuadsHigh * 2) ) { printf( "FAILED : %lux%lu level %lu mask %lu area %ld\n", QuadsWide, QuadsHigh, Level, Mask, Area / 2 ); bPassed = false; }
+
+                // Every quad covered exactly once (two sample points per quad)
+                for ( z = 0; z < QuadsHigh && bPassed; ++z )
+                {
+                    for ( x = 0; x < QuadsWide; ++x )
+                    {
+                        if ( CoverCount( pCoords, TriCount, x + 0.2871f, z + 0.6413f ) != 1 || CoverCount( pCoords, TriCount, x + 0.7339f, z + 0.1927f ) != 1 )
+                        {
+                            printf( "FAILED : %lux%lu level %lu mask %lu quad %lu,%lu not covered once\n", QuadsWide, QuadsHigh, Level, Mask, x, z );
+                            bPassed = false;
+                            break;
+
+                        } // End if bad coverage
+
+                    } // Next Quad
+
+                } // Next Row
+
+                // Edge vertices must match the level they meet
+                for ( e = 0; e < CTerrainLOD::EDGE_COUNT; ++e )
+                {
+                    unsigned long Length   = ( e == CTerrainLOD::EDGE_TOP || e == CTerrainLOD::EDGE_BOTTOM ) ? QuadsWide : QuadsHigh;
+                    unsigned long EdgeStep = ( Mask & (1 << e) ) ? Step * 2 : Step;
+
+                    EdgeVertexMask( pCoords, TriCount, e, QuadsWide, QuadsHigh, pUsed );
+                    for ( unsigned long i = 0; i <= Length; ++i )
+                    {
+                        if ( pUsed[i] != ((i % EdgeStep) == 0) )
+                        {
+                            printf( "FAILED : %lux%lu level %lu mask %lu edge %lu vertex %lu (T-junction)\n", QuadsWide, QuadsHigh, Level, Mask, e, i );
+                            bPassed = false;
+                            break;
+
+                        } // End if mismatch
+
+                    } // Next Edge Vertex
+
+                } // Next Edge
+
+            } // Next Stitch Mask
+
+        } // Next Level
+
+        delete []Set.pIndices;
+        delete []pCoords;
+        delete []pUsed;
+        return bPassed;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyMasked ()
+    // Desc : A set built from a partial quad mask must contain exactly the
+    //        masked quads at full detail, and only coarse quads covering at
+    //        least one of them at every other level.
+    //-------------------------------------------------------------------------
+    bool VerifyMasked( unsigned long QuadsWide, unsigned long QuadsHigh )
+    {
+        LODSET          Set;
+        bool            bPassed = true;
+        unsigned long   i, Level, Masked = 0;
+        unsigned char * pMask   = new unsigned char[ QuadsWide * QuadsHigh ];
+        long          * pCoords = new long[ QuadsWide * QuadsHigh * 12 ];
+
+        srand( 7 );
+        for ( i = 0; i < QuadsWide * QuadsHigh; ++i ) { pMask[i] = ( rand() % 5 ) == 0; Masked += pMask[i]; }
+        if ( !BuildSet( Set, QuadsWide, QuadsHigh, pMask ) ) { printf( "FAILED : %lux%lu masked measured / written index counts differ\n", QuadsWide, QuadsHigh ); bPassed = false; }
+
+        for ( Level = 0; Level < Set.LevelCount; ++Level )
+        {
+            unsigned long TriCount = GatherTriangles( Set, Level, 0, pCoords );
+            if ( Level == 0 && TriCount != Masked * 2 ) { printf( "FAILED : %lux%lu masked level 0 has %lu triangles, expected %lu\n", QuadsWide, QuadsHigh, TriCount, Masked * 2 ); bPassed = false; }
+
+            for ( unsigned long t = 0; t < TriCount * 3; t += 3 )
+            {
+                // Centroid identifies the coarse quad
+                unsigned long Step = 1UL << Level;
+                long cx = (pCoords[t * 2] + pCoords[t * 2 + 2] + pCoords[t * 2 + 4]) / 3 / (long)Step;
+                long cz = (pCoords[t * 2 + 1] + pCoords[t * 2 + 3] + pCoords[t * 2 + 5]) / 3 / (long)Step;
+                bool bAny = false;
+
+                for ( unsigned long z = cz * Step; z < (cz + 1) * Step; ++z )
+                    for ( unsigned long x = cx * Step; x < (cx + 1) * Step; ++x ) bAny |= ( pMask[ x + z * QuadsWide ] != 0 );
+
+                if ( !bAny ) { printf( "FAILED : %lux%lu masked level %lu includes an unused quad\n", QuadsWide, QuadsHigh, Level ); bPassed = false; break; }
+
+            } // Next Triangle
+
+        } // Next Level
+
+        delete []Set.pIndices;
+        delete []pMask;
+        delete []pCoords;
+        return bPassed;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerifyErrors ()
+    // Desc : Compare CalculateErrors against the meshes actually built, by
+    //        interpolating every full detail vertex on the drawn triangles.
+    //-------------------------------------------------------------------------
+    bool VerifyErrors( const float * pHeightMap, unsigned long MapWidth, unsigned long QuadsWide, unsigned long QuadsHigh, float & MaxDelta )
+    {
+        LODSET  Set;
+        float   Errors[ MAX_TERRAIN_LOD ];
+        bool    bPassed = true;
+        long  * pCoords = new long[ QuadsWide * QuadsHigh * 12 ];
+
+        BuildSet( Set, QuadsWide, QuadsHigh, NULL );
+        CTerrainLOD::CalculateErrors( pHeightMap, MapWidth, 0, 0, QuadsWide, QuadsHigh, Scale[1], Errors );
+        if ( Errors[0] != 0.0f ) { printf( "FAILED : level 0 error %g\n", Errors[0] ); bPassed = false; }
+
+        for ( unsigned long Level = 1; Level < Set.LevelCount; ++Level )
+        {
+            unsigned long TriCount = GatherTriangles( Set, Level, 0, pCoords );
+            float         Measured = 0.0f;
+
+            if ( Errors[Level] < Errors[Level - 1] ) { printf( "FAILED : level %lu error decreases\n", Level ); bPassed = false; }
+
+            for ( unsigned long z = 0; z <= QuadsHigh; ++z )
+            {
+                for ( unsigned long x = 0; x <= QuadsWide; ++x )
+                {
+                    // Find the triangle containing the vertex (edges inclusive)
+                    for ( unsigned long t = 0; t < TriCount; ++t )
+                    {
+                        const long * p = pCoords + t * 6;
+                        float Area = (float)SignedArea( p );
+                        float b0   = (float)((p[4] - p[2]) * ((long)z - p[3]) - (p[5] - p[3]) * ((long)x - p[2])) / Area;
+                        float b1   = (float)((p[0] - p[4]) * ((long)z - p[5]) - (p[1] - p[5]) * ((long)x - p[4])) / Area;
+                        float b2   = 1.0f - b0 - b1;
+                        if ( b0 < -1e-6f || b1 < -1e-6f || b2 < -1e-6f ) continue;
+
+                        float fHeight = b0 * pHeightMap[ p[0] + p[1] * MapWidth ] + b1 * pHeightMap[ p[2] + p[3] * MapWidth ] + b2 * pHeightMap[ p[4] + p[5] * MapWidth ];
+                        float fDelta  = fabsf( fHeight - pHeightMap[ x + z * MapWidth ] ) * Scale[1];
+                        if ( fDelta > Measured ) Measured = fDelta;
+                        break;
+
+                    } // Next Triangle
+
+                } // Next Column
+
+            } // Next Row
+
+            // Reported error is the running maximum of the measured errors
+            float Expected = ( Measured > Errors[Level - 1] ) ? Measured : Errors[Level - 1];
+            float Delta    = fabsf( Expected - Errors[Level] );
+            if ( Delta > MaxDelta ) MaxDelta = Delta;
+            if ( Delta > 1e-3f * (1.0f + Expected) ) { printf( "FAILED : level %lu error %g, measured %g\n", Level, Errors[Level], Expected ); bPassed = false; }
+
+        } // Next Level
+
+        delete []Set.pIndices;
+        delete []pCoords;
+        return bPassed;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SIMBLOCK (Struct)
+    // Desc : The parts of a CTerrainBlock involved in level selection.
+    //-------------------------------------------------------------------------
+    struct SIMBLOCK
+    {
+        float           Errors[ MAX_TERRAIN_LOD ];
+        float           BoundsMin[3], BoundsMax[3];
+        unsigned long   LOD, StitchMask;
+    };
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main ()
+// Desc : Entry point
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long DefaultSizes[] = { 1025, 4097 };
+    unsigned long TopologySizes[][2] = { { 16, 16 }, { 32, 32 }, { 24, 40 }, { 8, 64 }, { 1, 1 } };
+    float         PixelError = ( argc > 1 ) ? (float)atof( argv[1] ) : 4.0f;
+    unsigned long SizeCount  = ( argc > 2 ) ? (unsigned long)(argc - 2) : 2;
+    bool          bPassed    = true;
+    unsigned long i;
+
+    // Index set checks
+    for ( i = 0; i < sizeof(TopologySizes) / sizeof(TopologySizes[0]); ++i )
+    {
+        if ( !VerifyTopology( TopologySizes[i][0], TopologySizes[i][1] ) ) bPassed = false;
+        if ( !VerifyMasked( TopologySizes[i][0], TopologySizes[i][1] ) ) bPassed = false;
+
+    } // Next Block Size
+
+    // Error measurement checks
+    {
+        float   MaxDelta = 0.0f;
+        float * pHeightMap = new float[ 65 * 65 ];
+        GenerateHeightMap( pHeightMap, 65, 65, HEIGHTMAP_RIDGED );
+        for ( i = 0; i < sizeof(TopologySizes) / sizeof(TopologySizes[0]); ++i )
+        {
+            if ( !VerifyErrors( pHeightMap, 65, TopologySizes[i][0], TopologySizes[i][1], MaxDelta ) ) bPassed = false;
+
+        } // Next Block Size
+        delete []pHeightMap;
+        printf( "Index sets and level errors checked (max error delta %g)\n\n", MaxDelta );
+    }
+
+    // Triangle counts for a block layout matching Level1.ini
+    LODSET Set;
+    BuildSet( Set, BLOCK_QUADS, BLOCK_QUADS, NULL );
+
+    printf( "Triangles per frame, %lu frames, %g pixel error, %lux%lu quad blocks\n\n", FRAMES, PixelError, BLOCK_QUADS, BLOCK_QUADS );
+    printf( "  Size   Blocks     LOD Off      LOD On (min / avg / max)      Ratio   Select\n" );
+
+    for ( unsigned long s = 0; s < SizeCount; ++s )
+    {
+        unsigned long Size = ( argc > 2 ) ? strtoul( argv[s + 2], NULL, 10 ) : DefaultSizes[s];
+        if ( Size < BLOCK_QUADS + 1 || ((Size - 1) % BLOCK_QUADS) != 0 ) { printf( "  %-6lu skipped (must be a multiple of %lu, plus one)\n", Size, BLOCK_QUADS ); continue; }
+
+        unsigned long BlocksWide = (Size - 1) / BLOCK_QUADS, BlockCount = BlocksWide * BlocksWide;
+        unsigned long x, z, j, Frame;
+        float       * pHeightMap = new float[ Size * Size ];
+        SIMBLOCK    * pBlocks    = new SIMBLOCK[ BlockCount ];
+        double        Total = 0.0, SelectTime = 0.0;
+        unsigned long MinTris = 0xFFFFFFFF, MaxTris = 0, FullTris = 0;
+        float         PixelScale = CTerrainLOD::GetPixelScale( FOV, VIEWPORT );
+
+        GenerateHeightMap( pHeightMap, Size, Size, HEIGHTMAP_RIDGED );
+
+        // Block bounds and level errors, as CTerrainBlock::GenerateBlock
+        for ( z = 0; z < BlocksWide; ++z )
+        {
+            for ( x = 0; x < BlocksWide; ++x )
+            {
+                SIMBLOCK & Block = pBlocks[ x + z * BlocksWide ];
+                float MinY = 1e9f, MaxY = -1e9f;
+
+                for ( unsigned long az = 0; az <= BLOCK_QUADS; ++az )
+                {
+                    for ( unsigned long ax = 0; ax <= BLOCK_QUADS; ++ax )
+                    {
+                        float y = pHeightMap[ (x * BLOCK_QUADS + ax) + (z * BLOCK_QUADS + az) * Size ] * Scale[1];
+                        if ( y < MinY ) MinY = y;
+                        if ( y > MaxY ) MaxY = y;
+
+                    } // Next Column
+
+                } // Next Row
+
+                Block.BoundsMin[0] = (float)(x * BLOCK_QUADS) * Scale[0];       Block.BoundsMin[1] = MinY; Block.BoundsMin[2] = (float)(z * BLOCK_QUADS) * Scale[2];
+                Block.BoundsMax[0] = (float)((x + 1) * BLOCK_QUADS) * Scale[0]; Block.BoundsMax[1] = MaxY; Block.BoundsMax[2] = (float)((z + 1) * BLOCK_QUADS) * Scale[2];
+                CTerrainLOD::CalculateErrors( pHeightMap, Size, x * BLOCK_QUADS, z * BLOCK_QUADS, BLOCK_QUADS, BLOCK_QUADS, Scale[1], Block.Errors );
+                FullTris += BLOCK_QUADS * BLOCK_QUADS * 2;
+
+            } // Next Block
+
+        } // Next Block Row
+
+        // Fly a camera diagonally across the terrain, a little above the ground
+        for ( Frame = 0; Frame < FRAMES; ++Frame )
+        {
+            float         t = ((float)Frame + 0.5f) / (float)FRAMES;
+            float         Camera[3];
+            unsigned long Tris = 0;
+            bool          bChanged;
+            CBenchTimer   Timer;
+
+            Camera[0] = (0.1f + 0.8f * t) * (float)(Size - 1) * Scale[0];
+            Camera[2] = (0.2f + 0.6f * t) * (float)(Size - 1) * Scale[2];
+            Camera[1] = pHeightMap[ (unsigned long)(Camera[0] / Scale[0]) + (unsigned long)(Camera[2] / Scale[2]) * Size ] * Scale[1] + 20.0f;
+
+            Timer.Reset();
+
+            // Select, as CTerrainBlock::SelectLOD
+            for ( j = 0; j < BlockCount; ++j )
+            {
+                SIMBLOCK & Block = pBlocks[j];
+                float      Distance = 0.0f;
+
+                for ( int k = 0; k < 3; ++k )
+                {
+                    float d = 0.0f;
+                    if ( Camera[k] < Block.BoundsMin[k] ) d = Block.BoundsMin[k] - Camera[k];
+                    if ( Camera[k] > Block.BoundsMax[k] ) d = Camera[k] - Block.BoundsMax[k];
+                    Distance += d * d;
+
+                } // Next Axis
+
+                Block.LOD = CTerrainLOD::SelectLevel( Block.Errors, Set.LevelCount, sqrtf( Distance ), PixelScale, PixelError );
+
+            } // Next Block
+
+            // Relax, as CTerrain::Render
+            do
+            {
+                bChanged = false;
+                for ( z = 0; z < BlocksWide; ++z )
+                {
+                    for ( x = 0; x < BlocksWide; ++x )
+                    {
+                        SIMBLOCK & Block = pBlocks[ x + z * BlocksWide ];
+                        const SIMBLOCK * pNeighbours[4] = { z > 0 ? &Block - BlocksWide : NULL, x + 1 < BlocksWide ? &Block + 1 : NULL,
+                                                            z + 1 < BlocksWide ? &Block + BlocksWide : NULL, x > 0 ? &Block - 1 : NULL };
+                        for ( int e = 0; e < 4; ++e )
+                        {
+                            if ( !pNeighbours[e] || Block.LOD <= pNeighbours[e]->LOD + 1 ) continue;
+                            Block.LOD = pNeighbours[e]->LOD + 1;
+                            bChanged  = true;
+
+                        } // Next Edge
+
+                    } // Next Block
+
+                } // Next Block Row
+
+            } while ( bChanged );
+
+            // Stitch and count, as CTerrainBlock::UpdateStitching / Render
+            for ( z = 0; z < BlocksWide; ++z )
+            {
+                for ( x = 0; x < BlocksWide; ++x )
+                {
+                    SIMBLOCK & Block = pBlocks[ x + z * BlocksWide ];
+                    const SIMBLOCK * pNeighbours[4] = { z > 0 ? &Block - BlocksWide : NULL, x + 1 < BlocksWide ? &Block + 1 : NULL,
+                                                        z + 1 < BlocksWide ? &Block + BlocksWide : NULL, x > 0 ? &Block - 1 : NULL };
+                    LODRANGE Draws[ CTerrainLOD::EDGE_COUNT + 1 ];
+
+                    Block.StitchMask = 0;
+                    for ( int e = 0; e < 4; ++e )
+                    {
+                        if ( !pNeighbours[e] ) continue;
+                        if ( pNeighbours[e]->LOD > Block.LOD + 1 ) { printf( "FAILED : neighbouring blocks more than one level apart\n" ); bPassed = false; }
+                        if ( pNeighbours[e]->LOD > Block.LOD ) Block.StitchMask |= (1 << e);
+
+                    } // Next Edge
+
+                    unsigned long DrawCount = CTerrainLOD::BuildDrawList( Set.Ranges[ Block.LOD ], Block.StitchMask, Draws );
+                    for ( j = 0; j < DrawCount; ++j ) Tris += Draws[j].PrimitiveCount;
+
+                } // Next Block
+
+            } // Next Block Row
+
+            SelectTime += Timer.Elapsed();
+            Total      += Tris;
+            if ( Tris < MinTris ) MinTris = Tris;
+            if ( Tris > MaxTris ) MaxTris = Tris;
+
+        } // Next Frame
+
+        printf( "  %-6lu %-8lu %10lu %10lu / %8.0f / %-10lu %6.1fx %6.2fms\n", Size, BlockCount, FullTris, MinTris, Total / FRAMES, MaxTris,
+                FullTris / (Total / FRAMES), SelectTime * 1000.0 / FRAMES );
+
+        delete []pHeightMap;
+        delete []pBlocks;
+
+    } // Next Size
+
+    delete []Set.pIndices;
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,369 @@
+//-----------------------------------------------------------------------------
+// File: TerrainStreamBench.cpp
+//
+// Desc: Headless validation and benchmark for the out of core terrain
+//       pager. A generated heightmap is cut in to a tile file, which is
+//       checked sample for sample (apron included) against the source. A
+//       simulated player then flies a winding path over the terrain:
+//
+//         - without a thread, loading a fixed number of tiles per Update, so
+//           the run is deterministic, once with prefetching and once without.
+//           The number of frames in which a required tile was missing is
+//           reported for both, prefetching must not be worse.
+//         - with the background loader, sleeping a little each frame in
+//           place of rendering.
+//
+//       Every run checks that each delivered tile holds the right samples,
+//       that no tile within the radius of the player is ever evicted, that
+//       the budget is respected whenever the required tiles fit in it, and
+//       (after a Flush) that every required tile is resident.
+//
+// Build: g++ -O2 TerrainStreamBench.cpp ../Source/CTerrainPager.cpp -o TerrainStreamBench -lpthread
+//
+// Usage: TerrainStreamBench [Size [TileFile]]
+//        Size defaults to 2049, the tile file to TerrainStreamBench.tiles in
+//        the current folder (it is removed afterwards).
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TerrainStreamBench Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainPager.h"
+#include "BenchTimer.h"
+#include "BenchTerrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(_WIN32)
+    #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const float         SCALE_X     = 4.0f;     // World size of a quad
+    const float         SCALE_Z     = 4.0f;     // World size of a quad
+    const unsigned long TILE_QUADS  = 16;       // Quads per tile side (BlockSize 17)
+    const float         RADIUS      = 256.0f;   // Required radius (four tiles)
+    const unsigned long BUDGET      = 128;      // Resident tile budget
+    const float         PREFETCH    = 1.0f;     // Seconds of travel to prefetch
+    const unsigned long MAX_LOADS   = 2;        // Tiles loaded per Update (deterministic runs)
+    const unsigned long FRAMES      = 2400;     // Frames simulated per run
+    const float         FRAME_TIME  = 1.0f / 60.0f;
+    const float         SPEED       = 160.0f;   // Player speed, world units per second
+    const unsigned long FRAME_WORK  = 2;        // Milliseconds slept per frame in the threaded run
+
+    //-------------------------------------------------------------------------
+    // Name : SleepFor ()
+    // Desc : Stand in for the rest of the frame (rendering etc).
+    //-------------------------------------------------------------------------
+    void SleepFor( unsigned long Milliseconds )
+    {
+#if defined(_WIN32)
+        Sleep( Milliseconds );
+#else
+        usleep( Milliseconds * 1000 );
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RUNSTATE (Struct)
+    // Desc : Shared with the pager callbacks during a run.
+    //-------------------------------------------------------------------------
+    struct RUNSTATE
+    {
+        const float   * pHeightMap;
+        unsigned long   Size;
+        float           Position[3];
+        unsigned long   BadTiles;           // Delivered with the wrong samples
+        unsigned long   RequiredEvicted;    // Evicted while within the radius
+        unsigned long   Delivered;
+        unsigned long   Evicted;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : CheckTile ()
+    // Desc : Compare a tile (first sample pointer, as handed over by the
+    //        pager) and its apron against the source heightmap.
+    //-------------------------------------------------------------------------
+    bool CheckTile( const float * pHeightMap, unsigned long Size, unsigned long TileX, unsigned long TileZ, const float * pSamples, unsigned long Pitch )
+    {
+        long x, z, Apron = (long)TILE_APRON;
+
+        for ( z = -Apron; z < (long)TILE_QUADS + 1 + Apron; ++z )
+        {
+            long sz = (long)(TileZ * TILE_QUADS) + z;
+            if ( sz < 0 ) sz = 0;
+            if ( sz > (long)Size - 1 ) sz = (long)Size - 1;
+
+            for ( x = -Apron; x < (long)TILE_QUADS + 1 + Apron; ++x )
+            {
+                long sx = (long)(TileX * TILE_QUADS) + x;
+                if ( sx < 0 ) sx = 0;
+                if ( sx > (long)Size - 1 ) sx = (long)Size - 1;
+                if ( pSamples[ x + z * (long)Pitch ] != pHeightMap[ sx + sz * (long)Size ] ) return false;
+
+            } // Next Column
+
+        } // Next Row
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : TileDistance ()
+    // Desc : Distance from a point to the nearest point of a tile, as
+    //        measured by the pager.
+    //-------------------------------------------------------------------------
+    float TileDistance( const float Position[3], unsigned long TileX, unsigned long TileZ )
+    {
+        float SizeX = TILE_QUADS * SCALE_X, SizeZ = TILE_QUADS * SCALE_Z, dx = 0.0f, dz = 0.0f;
+
+        if ( Position[0] < TileX * SizeX ) dx = TileX * SizeX - Position[0]; else if ( Position[0] > (TileX + 1) * SizeX ) dx = Position[0] - (TileX + 1) * SizeX;
+        if ( Position[2] < TileZ * SizeZ ) dz = TileZ * SizeZ - Position[2]; else if ( Position[2] > (TileZ + 1) * SizeZ ) dz = Position[2] - (TileZ + 1) * SizeZ;
+        return sqrtf( dx * dx + dz * dz );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : TileLoaded ()
+    // Desc : Pager callback, validates the delivered samples.
+    //-------------------------------------------------------------------------
+    bool TileLoaded( void * pContext, unsigned long TileX, unsigned long TileZ, const float * pSamples, unsigned long Pitch )
+    {
+        RUNSTATE * pState = (RUNSTATE*)pContext;
+
+        if ( !CheckTile( pState->pHeightMap, pState->Size, TileX, TileZ, pSamples, Pitch ) ) pState->BadTiles++;
+        pState->Delivered++;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : TileEvicted ()
+    // Desc : Pager callback, required tiles must never be evicted.
+    //-------------------------------------------------------------------------
+    void TileEvicted( void * pContext, unsigned long TileX, unsigned long TileZ )
+    {
+        RUNSTATE * pState = (RUNSTATE*)pContext;
+
+        if ( TileDistance( pState->Position, TileX, TileZ ) <= RADIUS ) pState->RequiredEvicted++;
+        pState->Evicted++;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PathPoint ()
+    // Desc : A winding loop over the terrain, 't' is in seconds.
+    //-------------------------------------------------------------------------
+    void PathPoint( unsigned long Size, float t, float Position[3] )
+    {
+        float Extent = (float)(Size - 1) * SCALE_X;
+        float a      = (t * SPEED / (Extent * 2.5f)) * 6.2831853f;
+
+        Position[0] = Extent * (0.5f + 0.38f * sinf( a ));
+        Position[1] = 0.0f;
+        Position[2] = Extent * (0.5f + 0.38f * sinf( a * 2.0f ) * cosf( a * 0.5f ));
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PathPosition ()
+    // Desc : Position on the path, and the velocity (by differencing).
+    //-------------------------------------------------------------------------
+    void PathPosition( unsigned long Size, float t, float Position[3], float Velocity[3] )
+    {
+        float Ahead[3];
+
+        PathPoint( Size, t, Position );
+        PathPoint( Size, t + 0.01f, Ahead );
+        for ( int i = 0; i < 3; ++i ) Velocity[i] = (Ahead[i] - Position[i]) / 0.01f;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RUNRESULT (Struct)
+    // Desc : Summary of a simulated run.
+    //-------------------------------------------------------------------------
+    struct RUNRESULT
+    {
+        unsigned long   MissFrames;         // Frames with a required tile missing
+        unsigned long   MissTiles;          // Sum of missing required tiles over all frames
+        unsigned long   PeakResident;
+        unsigned long   Loads, Evictions;
+        double          UpdateTime;         // Average Update (seconds)
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : SimulateRun ()
+    // Desc : Fly the path with the specified pager settings.
+    //-------------------------------------------------------------------------
+    bool SimulateRun( const char * Name, const char * FileName, const float * pHeightMap, unsigned long Size,
+                      float Prefetch, bool Threaded, RUNRESULT & Result )
+    {
+        CTerrainPager Pager;
+        RUNSTATE      State;
+        float         Velocity[3];
+        bool          bPassed = true;
+        unsigned long Frame, OverBudget = 0, x, z;
+        double        Total = 0.0;
+
+        memset( &State, 0, sizeof(RUNSTATE) );
+        memset( &Result, 0, sizeof(RUNRESULT) );
+        State.pHeightMap = pHeightMap;
+        State.Size       = Size;
+
+        if ( !Pager.Create( FileName, SCALE_X, SCALE_Z, RADIUS, BUDGET, Prefetch, Threaded, Threaded ? 0 : MAX_LOADS ) )
+        {
+            printf( "FAILED : %s, could not open the tile file\n", Name );
+            return false;
+
+        } // End if failed
+        Pager.SetCallbacks( TileLoaded, TileEvicted, &State );
+
+        for ( Frame = 0; Frame < FRAMES; ++Frame )
+        {
+            CBenchTimer Timer;
+
+            PathPosition( Size, Frame * FRAME_TIME, State.Position, Velocity );
+            Timer.Reset();
+            Pager.Update( State.Position, Velocity );
+            Total += Timer.Elapsed();
+
+            // Give the loader the rest of the frame
+            if ( Threaded ) SleepFor( FRAME_WORK );
+
+            // Start up, as CTerrain::UpdateStreaming
+            if ( Frame == 0 ) Pager.Flush();
+
+            const PAGERSTATS & Stats = Pager.GetStats();
+            if ( Stats.Missing ) { Result.MissFrames++; Result.MissTiles += Stats.Missing; }
+            if ( Stats.Resident > Result.PeakResident ) Result.PeakResident = Stats.Resident;
+            if ( Stats.Resident > BUDGET && Stats.Required <= BUDGET ) OverBudget++;
+
+        } // Next Frame
+
+        // Everything required must arrive once flushed
+        Pager.Flush();
+        for ( z = 0; z < Pager.GetTilesHigh(); ++z )
+        {
+            for ( x = 0; x < Pager.GetTilesWide(); ++x )
+            {
+                if ( TileDistance( State.Position, x, z ) > RADIUS ) continue;
+                if ( !Pager.IsResident( x, z ) ) { printf( "FAILED : %s, tile %lu, %lu not resident after Flush\n", Name, x, z ); bPassed = false; continue; }
+                if ( !CheckTile( pHeightMap, Size, x, z, Pager.GetTileSamples( x, z ), Pager.GetPitch() ) )
+                {
+                    printf( "FAILED : %s, tile %lu, %lu samples incorrect\n", Name, x, z );
+                    bPassed = false;
+
+                } // End if incorrect
+
+            } // Next Tile
+
+        } // Next Tile Row
+
+        if ( Pager.GetStats().Missing != 0 ) { printf( "FAILED : %s, %lu required tiles missing after Flush\n", Name, Pager.GetStats().Missing ); bPassed = false; }
+        if ( State.BadTiles ) { printf( "FAILED : %s, %lu tiles delivered with incorrect samples\n", Name, State.BadTiles ); bPassed = false; }
+        if ( State.RequiredEvicted ) { printf( "FAILED : %s, %lu required tiles evicted\n", Name, State.RequiredEvicted ); bPassed = false; }
+        if ( OverBudget ) { printf( "FAILED : %s, over budget in %lu frames\n", Name, OverBudget ); bPassed = false; }
+        if ( Pager.GetStats().Loads != State.Delivered || Pager.GetStats().Evictions != State.Evicted || Pager.GetStats().Failures != 0 )
+        {
+            printf( "FAILED : %s, counters disagree with the callbacks\n", Name );
+            bPassed = false;
+
+        } // End if counters wrong
+
+        Result.Loads      = Pager.GetStats().Loads;
+        Result.Evictions  = Pager.GetStats().Evictions;
+        Result.UpdateTime = Total / FRAMES;
+        Pager.Release();
+        return bPassed;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : main ()
+// Desc : Entry point
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    unsigned long Size     = ( argc > 1 ) ? strtoul( argv[1], NULL, 10 ) : 2049;
+    const char  * FileName = ( argc > 2 ) ? argv[2] : "TerrainStreamBench.tiles";
+    bool          bPassed  = true;
+    unsigned long x, z;
+    RUNRESULT     Results[3];
+
+    if ( Size < TILE_QUADS * 16 + 1 || ((Size - 1) % TILE_QUADS) != 0 )
+    {
+        printf( "Size must be a multiple of %lu plus one, and at least %lu\n", TILE_QUADS, TILE_QUADS * 16 + 1 );
+        return 1;
+
+    } // End if invalid size
+
+    // Build the source map and its tile file
+    float * pHeightMap = new float[ Size * Size ];
+    GenerateHeightMap( pHeightMap, Size, Size, HEIGHTMAP_RIDGED );
+
+    CBenchTimer Timer;
+    if ( !CTerrainTileFile::Write( FileName, pHeightMap, Size, Size, TILE_QUADS ) ) { printf( "FAILED : could not write %s\n", FileName ); delete []pHeightMap; return 1; }
+    printf( "%lux%lu heightmap written as %lu tiles in %.1fms\n", Size, Size, ((Size - 1) / TILE_QUADS) * ((Size - 1) / TILE_QUADS), Timer.Elapsed() * 1000.0 );
+
+    // Layout checks
+    if ( !CTerrainTileFile::IsValid( FileName, Size, Size, TILE_QUADS ) ) { printf( "FAILED : tile file not valid for its own layout\n" ); bPassed = false; }
+    if ( CTerrainTileFile::IsValid( FileName, Size, Size, TILE_QUADS * 2 ) ) { printf( "FAILED : tile file valid for another layout\n" ); bPassed = false; }
+
+    // Every tile, sample for sample
+    {
+        CTerrainTileFile File;
+        if ( !File.Open( FileName ) ) { printf( "FAILED : could not open %s\n", FileName ); bPassed = false; }
+        else
+        {
+            unsigned long Pitch = File.GetPitch(), Bad = 0;
+            float       * pTile = new float[ Pitch * Pitch ];
+
+            Timer.Reset();
+            for ( z = 0; z < File.GetHeader().TilesHigh; ++z )
+            {
+                for ( x = 0; x < File.GetHeader().TilesWide; ++x )
+                {
+                    if ( !File.ReadTile( x, z, pTile ) || !CheckTile( pHeightMap, Size, x, z, pTile + TILE_APRON * (Pitch + 1), Pitch ) ) Bad++;
+
+                } // Next Tile
+
+            } // Next Tile Row
+            printf( "Every tile read back and compared in %.1fms\n\n", Timer.Elapsed() * 1000.0 );
+
+            if ( Bad ) { printf( "FAILED : %lu tiles do not match the heightmap\n", Bad ); bPassed = false; }
+            if ( File.ReadTile( File.GetHeader().TilesWide, 0, pTile ) ) { printf( "FAILED : read a tile beyond the map\n" ); bPassed = false; }
+            delete []pTile;
+
+        } // End if opened
+    }
+
+    // Fly the path
+    if ( !SimulateRun( "no prefetch", FileName, pHeightMap, Size, 0.0f, false, Results[0] ) ) bPassed = false;
+    if ( !SimulateRun( "prefetch", FileName, pHeightMap, Size, PREFETCH, false, Results[1] ) ) bPassed = false;
+    if ( !SimulateRun( "threaded", FileName, pHeightMap, Size, PREFETCH, true, Results[2] ) ) bPassed = false;
+
+    printf( "%lu frames at %g units/s, radius %g, budget %lu tiles, %lu loads per frame when not threaded (%lums frames otherwise)\n\n",
+            FRAMES, SPEED, RADIUS, BUDGET, MAX_LOADS, FRAME_WORK );
+    printf( "  Run            Miss Frames  Missing Tiles  Peak Resident   Loads  Evictions   Update\n" );
+    const char * Names[3] = { "no prefetch", "prefetch", "threaded" };
+    for ( int i = 0; i < 3; ++i )
+    {
+        printf( "  %-14s %11lu %14lu %14lu %7lu %10lu %7.3fms\n", Names[i], Results[i].MissFrames, Results[i].MissTiles,
+                Results[i].PeakResident, Results[i].Loads, Results[i].Evictions, Results[i].UpdateTime * 1000.0 );
+
+    } // Next Run
+
+    // Looking ahead must pay off
+    if ( Results[1].MissTiles > Results[0].MissTiles ) { printf( "\nFAILED : prefetching missed more tiles than not prefetching\n" ); bPassed = false; }
+
+    delete []pHeightMap;
+    remove( FileName );
+
+    printf( "\n%s\n", bPassed ? "All checks passed." : "CHECKS FAILED." );
+    return bPassed ? 0 : 1;
+}
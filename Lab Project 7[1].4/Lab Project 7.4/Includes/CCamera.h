@@ -70,6 +70,9 @@ public:
     const D3DXVECTOR3&  GetUp            ( ) const { return m_vecUp;    }
     const D3DXVECTOR3&  GetRight         ( ) const { return m_vecRight; }
     const D3DXMATRIX&   GetViewMatrix    ( );
+
+    void                SetRenderOffset  ( const D3DXVECTOR3& Offset ) { m_vecRenderOffset = Offset; m_bViewDirty = true; m_bFrustumDirty = true; }
+    D3DXVECTOR3         GetRenderPosition( ) const { return m_vecPos + m_vecRenderOffset; }
     
     void                SetVolumeInfo    ( const VOLUME_INFO& Volume );
     const VOLUME_INFO&  GetVolumeInfo    ( ) const;
@@ -90,6 +93,7 @@ public:
     virtual CAMERA_MODE GetCameraMode    ( ) const = 0;
 
     bool                BoundsInFrustum  ( const D3DXVECTOR3 & Min, const D3DXVECTOR3 & Max );
+    const D3DXPLANE *   GetFrustumPlanes ( );
 
 protected:
     //-------------------------------------------------------------------------
@@ -121,6 +125,7 @@ protected:
     D3DXVECTOR3     m_vecUp;                // Camera Up Vector
     D3DXVECTOR3     m_vecLook;              // Camera Look Vector
     D3DXVECTOR3     m_vecRight;             // Camera Right Vector
+    D3DXVECTOR3     m_vecRenderOffset;      // Offset from the simulated position to the rendered (interpolated) one
 
 };
 
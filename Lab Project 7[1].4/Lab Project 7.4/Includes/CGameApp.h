@@ -14,6 +14,7 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 #include "CTimer.h"
+#include "CProfiler.h"
 #include "CObject.h"
 #include "CPlayer.h"
 #include "CTerrain.h"
@@ -67,6 +68,7 @@ private:
     void        SetupRenderStates ( );
     void        AnimateObjects    ( );
     void        ProcessInput      ( );
+    void        EditTerrain       ( const UCHAR pKeyBuffer[] );
     bool        TestDeviceCaps    ( );
     void        SelectMenuItems   ( );
 
@@ -89,6 +91,8 @@ private:
     D3DXMATRIX              m_mtxIdentity;      // A basic identity matrix
     
     CTimer                  m_Timer;            // Game timer
+    bool                    m_bProfileCapture;  // Capture a profiler trace of the whole session
+    float                   m_fStepRate;        // Fixed simulation step rate (0 for variable)
     ULONG                   m_LastFrameRate;    // Used for making sure we update only when fps changes.
     
     HWND                    m_hWnd;             // Main window HWND
@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// File: CHeightMap.h
+//
+// Desc: Heightmap file loading, sample conversion and height queries used by
+//       the terrain. RAW heightmaps are mapped into memory (or read in a
+//       single call when mapping is unavailable) and widened to floating point
+//       in bulk. Heights (and normals) can be queried for many points at once.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CHEIGHTMAP_H_
+#define _CHEIGHTMAP_H_
+
+//-----------------------------------------------------------------------------
+// CHeightMap Specific Includes
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define HEIGHTMAP_SSE           // SSE2 conversion & query kernels are compiled in
+#endif
+
+const float HEIGHTMAP_UINT16_SCALE = 1.0f / 256.0f;    // 16 bit samples are brought in to the 8 bit range
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CHeightMap (Class)
+// Desc : Static heightmap helpers. Samples are always returned as floats in
+//        the same range regardless of the file format, so that the terrain
+//        scale values apply equally to all of them:
+//
+//          - FORMAT_UINT8   : 0 - 255
+//          - FORMAT_UINT16  : 0 - 255.996 (little endian, divided by 256)
+//          - FORMAT_FLOAT32 : stored value (little endian)
+//-----------------------------------------------------------------------------
+class CHeightMap
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum SAMPLEFORMAT
+    {
+        FORMAT_UINT8    = 0,        // One unsigned byte per sample
+        FORMAT_UINT16   = 1,        // One unsigned 16 bit value per sample
+        FORMAT_FLOAT32  = 2         // One 32 bit float per sample
+    };
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static bool             ParseFormat     ( const char * pString, SAMPLEFORMAT & Format );
+    static unsigned long    GetSampleSize   ( SAMPLEFORMAT Format );
+    static bool             LoadRaw         ( const char * pFileName, SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount, bool bMapFile = true );
+    static void             ConvertSamples  ( const void * pSource, SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount );
+    static void             GetHeights      ( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                                              const float * pX, const float * pZ, unsigned long Stride, unsigned long Count,
+                                              float * pHeights, float * pNormals = NULL, bool ReverseQuad = false );
+};
+
+#endif // _CHEIGHTMAP_H_
@@ -0,0 +1,85 @@
+//-----------------------------------------------------------------------------
+// File: CHeightMapFilter.h
+//
+// Desc: Separable heightmap smoothing filters. Each iteration runs a
+//       horizontal and then a vertical pass of a 1D kernel (box or Gaussian),
+//       with the rows of each pass split in to bands and spread across a
+//       thread pool.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CHEIGHTMAPFILTER_H_
+#define _CHEIGHTMAPFILTER_H_
+
+//-----------------------------------------------------------------------------
+// CHeightMapFilter Specific Includes
+//-----------------------------------------------------------------------------
+#include "CThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define HEIGHTMAPFILTER_SSE     // SSE row / column passes are compiled in
+#endif
+
+const unsigned long MAX_FILTER_RADIUS = 32;    // Largest kernel radius supported (samples)
+const unsigned long FILTER_BAND_ROWS  = 16;    // Rows processed by each thread pool task
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CHeightMapFilter (Class)
+// Desc : Smooths a float heightmap in place. Samples beyond the edge of the
+//        map are clamped, and the outermost ring of samples is left untouched
+//        so that adjoining terrains still meet. A box filter of radius 1 run
+//        once is equivalent to the original 3x3 terrain filter.
+//-----------------------------------------------------------------------------
+class CHeightMapFilter
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum FILTERTYPE
+    {
+        FILTER_NONE     = 0,        // Heightmap is left as loaded
+        FILTER_BOX      = 1,        // Equally weighted samples
+        FILTER_GAUSSIAN = 2         // Gaussian weighted samples
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CHeightMapFilter();
+	virtual ~CHeightMapFilter();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            SetFilter       ( FILTERTYPE Type, unsigned long Radius = 1, unsigned long Iterations = 1, float Sigma = 0.0f );
+    bool            Apply           ( float * pData, unsigned long Width, unsigned long Height, CThreadPool * pPool = NULL ) const;
+    FILTERTYPE      GetType         ( ) const { return m_Type; }
+    unsigned long   GetRadius       ( ) const { return m_nRadius; }
+    unsigned long   GetIterations   ( ) const { return m_nIterations; }
+    const float   * GetWeights      ( ) const { return m_fWeights; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static bool     ParseType       ( const char * pString, FILTERTYPE & Type );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    FILTERTYPE      m_Type;                                 // Kernel type
+    unsigned long   m_nRadius;                              // Kernel radius, taps either side of the centre
+    unsigned long   m_nIterations;                          // Number of times the kernel is applied
+    float           m_fWeights[ MAX_FILTER_RADIUS * 2 + 1 ];// Normalized 1D kernel weights
+
+};
+
+#endif // _CHEIGHTMAPFILTER_H_
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// File: CNormalMap.h
+//
+// Desc: Precomputed heightmap normals. Every normal is generated up front
+//       (four at a time with SSE, with bands of rows spread across a thread
+//       pool) and stored packed, so that looking one up is a couple of loads.
+//       Regions can be regenerated after the heightmap is modified.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CNORMALMAP_H_
+#define _CNORMALMAP_H_
+
+//-----------------------------------------------------------------------------
+// CNormalMap Specific Includes
+//-----------------------------------------------------------------------------
+#include "CThreadPool.h"
+#include <stddef.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define NORMALMAP_SSE           // SSE normal generation is compiled in
+#endif
+
+const unsigned long NORMALMAP_BAND_ROWS = 16;   // Rows generated by each thread pool task
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CNormalMap (Class)
+// Desc : Stores the normal of every heightmap sample as its x and z
+//        components in 16 bits each (y is always positive, and is rebuilt
+//        from the other two). Normals are calculated exactly as the terrain
+//        always has, from the sample to the right and the sample below (to
+//        the left / above on the last column / row).
+// Note : Precision is best on gentle slopes. Rebuilding y loses accuracy as
+//        faces approach vertical, a few tenths of a degree at worst.
+//        The heightmap is referenced rather than copied, and must remain
+//        valid while the normal map is in use.
+//-----------------------------------------------------------------------------
+class CNormalMap
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CNormalMap();
+	virtual ~CNormalMap();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            Build       ( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3], CThreadPool * pPool = NULL );
+    void            Update      ( unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ, CThreadPool * pPool = NULL );
+    void            Release     ( );
+    bool            IsBuilt     ( ) const { return m_pNormals != NULL; }
+    const short   * GetData     ( ) const { return m_pNormals; }
+    unsigned long   GetWidth    ( ) const { return m_nWidth; }
+    unsigned long   GetHeight   ( ) const { return m_nHeight; }
+
+    //-------------------------------------------------------------------------
+    // Name : GetNormal ()
+    // Desc : Unpack the normal at this sample (which must be in range).
+    //-------------------------------------------------------------------------
+    void GetNormal( unsigned long x, unsigned long z, float Normal[3] ) const
+    {
+        const short * pPacked = m_pNormals + (x + z * m_nWidth) * 2;
+        float         ySquared;
+
+        Normal[0] = (float)pPacked[0] * (1.0f / 32767.0f);
+        Normal[2] = (float)pPacked[1] * (1.0f / 32767.0f);
+        ySquared  = 1.0f - Normal[0] * Normal[0] - Normal[2] * Normal[2];
+        Normal[1] = ( ySquared > 0.0f ) ? sqrtf( ySquared ) : 0.0f;
+    }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            Generate    ( unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ, CThreadPool * pPool );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    const float   * m_pHeightMap;       // Heightmap the normals are generated from
+    short         * m_pNormals;         // Packed x, z pairs, one per sample
+    unsigned long   m_nWidth;           // Width of the heightmap (samples)
+    unsigned long   m_nHeight;          // Height of the heightmap (samples)
+    float           m_fScale[3];        // Terrain scale applied to the samples
+
+};
+
+#endif // _CNORMALMAP_H_
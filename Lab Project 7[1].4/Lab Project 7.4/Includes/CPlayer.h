@@ -15,6 +15,12 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 
+//-----------------------------------------------------------------------------
+// Miscellaneous Defines, Macros and Constants
+//-----------------------------------------------------------------------------
+const ULONG MAX_SIMULATION_STEPS = 8;       // Fixed steps allowed per frame before time is dropped
+const float DEFAULT_STEP_RATE    = 60.0f;   // Default fixed simulation rate (steps per second)
+
 //-----------------------------------------------------------------------------
 // Typedefs, structures and Enumerators
 //-----------------------------------------------------------------------------
@@ -80,6 +86,10 @@ public:
     //-------------------------------------------------------------------------
     bool                SetCameraMode      ( ULONG Mode );
     void                Update             ( float TimeScale );
+    ULONG               Advance            ( float TimeElapsed );
+    void                SetFixedStepRate   ( float StepRate );
+    float               GetFixedStepRate   ( ) const { return m_fStepRate; }
+    float               GetInterpolation   ( ) const { return m_fInterpolation; }
     
     void                AddPlayerCallback    ( UPDATEPLAYER pFunc, LPVOID pContext );
     void                AddCameraCallback    ( UPDATECAMERA pFunc, LPVOID pContext );
@@ -145,6 +155,14 @@ private:
     float           m_fFriction;            // The amount of friction causing the camera to slow
     float           m_fCameraLag;           // Amount of camera lag in seconds (0 to disable)
 
+    // Fixed time step simulation
+    float           m_fStepRate;            // Simulation steps per second (0 for a variable step)
+    float           m_fAccumulator;         // Elapsed time not yet simulated
+    float           m_fInterpolation;       // Fraction of a step the rendered state is between the last two
+    D3DXVECTOR3     m_vecPrevPos;           // Player position before the last step
+    D3DXVECTOR3     m_vecPrevCamPos;        // Camera position before the last step
+    D3DXVECTOR3     m_vecRenderOffset;      // Offset from the simulated position to the rendered one
+
     // Stored collision callbacks
     CALLBACK_FUNC   m_pUpdatePlayer[255];   // Array of 'UpdatePlayer' callbacks
     CALLBACK_FUNC   m_pUpdateCamera[255];   // Array of 'UpdateCamera' callbacks
@@ -15,6 +15,14 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 #include "CObject.h"
+#include "CHeightMapFilter.h"
+#include "CNormalMap.h"
+#include "CTerrainRayCast.h"
+#include "CTerrainBrush.h"
+#include "CTerrainCache.h"
+#include "CTerrainLOD.h"
+#include "CTerrainPager.h"
+#include "CTerrainQuadTree.h"
 
 //-----------------------------------------------------------------------------
 // Forward Declarations
@@ -25,9 +33,50 @@ class CTerrainBlock;
 class CTerrainSplat;
 class CTerrainLayer;
 
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : VERTEXSTATS (Struct)
+// Desc : Vertex memory used by the resident terrain blocks, and the height
+//        error introduced by compact vertex quantization.
+//-----------------------------------------------------------------------------
+struct VERTEXSTATS
+{
+    ULONG   VertexBytes;        // Vertex buffer memory in use (including the shared grid)
+    ULONG   FullBytes;          // Memory the same blocks would need as CVertex
+    float   MaxError;           // Largest world space height error
+    float   RMSError;           // Root mean square world space height error
+};
+
 //-----------------------------------------------------------------------------
 // Main Class Declarations
 //-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CGridVertex (Class)
+// Desc : Shared grid vertex used in compact mode, the position of a vertex
+//        within a block (in quads). Every block uses the same grid.
+//-----------------------------------------------------------------------------
+class CGridVertex
+{
+public:
+    short       x;          // Column within the block
+    short       z;          // Row within the block
+};
+
+//-----------------------------------------------------------------------------
+// Name : CCompactVertex (Class)
+// Desc : Per block vertex used in compact mode. The position and texture
+//        coordinates are rebuilt from the shared grid, the block's offset and
+//        the terrain scale, so only the height and lighting are stored.
+//-----------------------------------------------------------------------------
+class CCompactVertex
+{
+public:
+    short       Height;     // Quantized height, in steps above the block minimum (biased by -32768)
+    short       Shade;      // Baked diffuse lighting, 0 - 255
+};
+
 //-----------------------------------------------------------------------------
 // Name : CTerrain (Class)
 // Desc : Game Timer class, queries performance hardware if available, and 
@@ -50,10 +99,25 @@ public:
     void                SetTextureFormat( const D3DFORMAT & Format, const D3DFORMAT & AlphaFormat );
     bool                LoadTerrain     ( LPCTSTR DefFile );
     float               GetHeight       ( float x, float z, bool ReverseQuad = false );
+    void                GetHeights      ( const D3DXVECTOR3 * pPositions, ULONG Count, float * pHeights, D3DXVECTOR3 * pNormals = NULL, bool ReverseQuad = false );
     void                Render          ( CCamera * pCamera = NULL );
     void                Release         ( );
     float              *GetHeightMap    ( ) const { return m_pHeightMap; }
     D3DXVECTOR3         GetHeightMapNormal  ( ULONG x, ULONG z );
+    D3DXVECTOR3         GetSampleNormal     ( const float * pSample, long Pitch, ULONG x, ULONG z );
+    bool                HasNormalMap    ( ) const { return m_NormalMap.IsBuilt(); }
+    void                UpdateNormals   ( ULONG MinX, ULONG MinZ, ULONG MaxX, ULONG MaxZ );
+    bool                Intersect       ( const D3DXVECTOR3 & Origin, const D3DXVECTOR3 & Direction, float MaxDistance, RAYHIT * pHit = NULL ) const;
+    bool                IntersectSegment( const D3DXVECTOR3 & Start, const D3DXVECTOR3 & End, RAYHIT * pHit = NULL ) const;
+    ULONG               IntersectBatch  ( const RAYQUERY * pRays, ULONG Count, RAYHIT * pHits, bool OcclusionOnly = false );
+    bool                EditHeights     ( CTerrainBrush::MODE Mode, const D3DXVECTOR3 & Centre, float Radius, float Strength, float Hardness = 0.5f );
+    bool                PaintLayer      ( USHORT Layer, const D3DXVECTOR3 & Centre, float Radius, float Strength, float Hardness = 0.5f );
+    void                CommitEdits     ( );
+    bool                IsEditable      ( ) const { return m_bEditable; }
+    const CTerrainCache&GetCache        ( ) const { return m_Cache; }
+    void                UpdateStreaming ( const D3DXVECTOR3 & Position, const D3DXVECTOR3 & Velocity );
+    bool                IsStreaming     ( ) const { return m_bStreaming; }
+    const PAGERSTATS&   GetStreamStats  ( ) const { return m_Pager.GetStats(); }
     ULONG               GetTerrainWidth ( ) const { return m_nHeightMapWidth; }
     ULONG               GetTerrainHeight( ) const { return m_nHeightMapHeight; }
     const D3DXVECTOR3&  GetScale        ( ) const { return m_vecScale; }
@@ -62,12 +126,23 @@ public:
     USHORT              GetLayerCount   ( ) const { return m_nLayerCount; }
     CTerrainLayer      *GetLayer        ( USHORT Index ) { return m_pLayer[Index]; }
     USHORT              GetBlendTexRatio( ) const { return m_nBlendTexRatio; }
+    void                SetLODEnabled   ( bool Enabled ) { m_bLODEnabled = Enabled; }
+    bool                IsLODEnabled    ( ) const { return m_bLODEnabled; }
+    ULONG               GetTrianglesDrawn( ) const { return m_nTrianglesDrawn; }
+    const CULLSTATS&    GetCullStats    ( ) const { return m_CullStats; }
+    bool                UseCompactVertices( ) const { return m_bCompactVertices; }
+    bool                UseSharedIndices( ) const { return m_pSharedIndices != NULL; }
+    LPDIRECT3DINDEXBUFFER9 GetSharedIndices( ) const { return m_pSharedIndices; }
+    ULONG               GetIndexSwitches( ) const { return m_nIndexSwitches; }
+    void                GetVertexStats  ( VERTEXSTATS & Stats ) const;
 
     //-------------------------------------------------------------------------
 	// Public Static Functions For This Class
 	//-------------------------------------------------------------------------
     static void     UpdatePlayer  ( LPVOID pContext, CPlayer * pPlayer, float TimeScale );
     static void     UpdateCamera  ( LPVOID pContext, CCamera * pCamera, float TimeScale );
+    static bool     TileLoaded    ( LPVOID pContext, ULONG TileX, ULONG TileZ, const float * pSamples, ULONG Pitch );
+    static void     TileEvicted   ( LPVOID pContext, ULONG TileX, ULONG TileZ );
 
 private:
 	//-------------------------------------------------------------------------
@@ -100,6 +175,37 @@ private:
     LPDIRECT3DTEXTURE9* m_pTexture;         // Array of textures loaded for this terrain
     USHORT              m_nTextureCount;    // Number of textures loaded.
 
+    CHeightMapFilter    m_HeightMapFilter;  // Filter applied to the heightmap once loaded
+    CThreadPool         m_ThreadPool;       // Worker threads used while building the terrain
+    CNormalMap          m_NormalMap;        // Precomputed heightmap normals (whole heightmap only)
+    CTerrainRayCast     m_RayCast;          // Height pyramid for ray casts (whole heightmap only)
+
+    bool                m_bLODEnabled;      // Select a detail level for each block when rendering ?
+    float               m_fLODPixelError;   // Maximum screen space error allowed (pixels, 0 = no LOD)
+    ULONG               m_nTrianglesDrawn;  // Triangles submitted by the last call to Render
+
+    CTerrainPager       m_Pager;            // Pages blocks in and out around the player
+    bool                m_bStreaming;       // Blocks are streamed from a tile file ?
+    bool                m_bStreamPrimed;    // Initial blocks around the player loaded ?
+
+    CTerrainQuadTree    m_QuadTree;         // Bounding volume hierarchy over the blocks
+    ULONG              *m_pVisible;         // Blocks found visible by the last call to Render
+    CULLSTATS           m_CullStats;        // Culling work done by the last call to Render
+
+    bool                m_bCompactVertices; // Blocks store CCompactVertex rather than CVertex ?
+    LPDIRECT3DVERTEXBUFFER9      m_pGridBuffer;     // Shared CGridVertex stream (compact mode)
+    LPDIRECT3DVERTEXDECLARATION9 m_pCompactDecl;    // Grid + compact vertex declaration
+    LPDIRECT3DVERTEXSHADER9      m_pCompactShader;  // Rebuilds compact vertices
+
+    bool                m_bSharedIndices;   // Share one index buffer between fully covered splats ?
+    LPDIRECT3DINDEXBUFFER9 m_pSharedIndices;// Every level of detail of a fully covered block
+    ULONG               m_nIndexSwitches;   // SetIndices calls made by the last call to Render
+
+    bool                m_bEditable;        // Layer weights are kept so that they can be painted ?
+    ULONG              *m_pDirtyBlocks;     // Blocks edited since the last call to CommitEdits
+    ULONG               m_nDirtyCount;      // Number of blocks listed in m_pDirtyBlocks
+
+    CTerrainCache       m_Cache;            // Cooked terrain read (or cooked) by LoadTerrain
 
 	//-------------------------------------------------------------------------
 	// Private Functions For This Class
@@ -108,7 +214,13 @@ private:
     long            AddTerrainLayer         ( USHORT Count = 1 );
     bool            GenerateLayers          ( LPCTSTR DefFile );
     bool            GenerateTerrainBlocks   ( );
+    bool            CreateCompactResources  ( );
+    bool            CreateSharedIndices     ( );
     void            FilterHeightMap         ( );
+    void            LinkBlockNeighbours     ( ULONG x, ULONG z );
+    void            ResolveLayers           ( const EDITRECT & Texels, USHORT LayerCount );
+    void            MarkBlocksDirty         ( const EDITRECT & Rect, bool Texels, USHORT LayerCount );
+    bool            IsCacheCurrent          ( LPCTSTR DefFile, LPCTSTR CacheFile, ULONG LayerCount );
     
 };
 
@@ -128,8 +240,17 @@ public:
 	//-------------------------------------------------------------------------
 	// Public Functions For This Class
 	//-------------------------------------------------------------------------
-    bool    GenerateBlock ( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight );
-    void    Render        ( LPDIRECT3DDEVICE9 pD3DDevice, USHORT LayerIndex );
+    bool    GenerateBlock   ( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight,
+                              const float * pSamples = NULL, ULONG SamplePitch = 0 );
+    bool    BuildBlock      ( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight,
+                              const float * pSamples = NULL, ULONG SamplePitch = 0 );
+    bool    CreateResources ( );
+    void    SelectLOD       ( const D3DXVECTOR3 & CameraPos, float PixelScale, float MaxPixelError );
+    void    UpdateStitching ( );
+    ULONG   Render          ( LPDIRECT3DDEVICE9 pD3DDevice, USHORT LayerIndex );
+    bool    MarkDirty       ( const EDITRECT & Rect, bool Texels, USHORT LayerCount );
+    bool    UpdateResources ( );
+    bool    WriteSplats     ( CTerrainCache & Cache, ULONG Index ) const;
 
 	//-------------------------------------------------------------------------
 	// Public Variables For This Class
@@ -150,16 +271,44 @@ public:
     D3DXVECTOR3             m_BoundsMin;        // Bounding box minimum extents
     D3DXVECTOR3             m_BoundsMax;        // Bounding box maximum extents
 
+    float                   m_fLODError[MAX_TERRAIN_LOD]; // World space height error of each detail level
+    ULONG                   m_nLODCount;        // Number of detail levels available
+    ULONG                   m_nLOD;             // Detail level selected for rendering
+    ULONG                   m_nStitchMask;      // Edges (CTerrainLOD::EDGE) bordering a coarser neighbour
+
+    float                   m_fHeightStep;      // World space height of one compact quantization step
+    float                   m_fHeightBias;      // World space height of a compact Height of zero
+    float                   m_fQuantMaxError;   // Largest height error introduced by quantization
+    float                   m_fQuantErrorSq;    // Sum of the squared height errors
+
+    CVertex               * m_pStagingVertices; // Vertices built by BuildBlock, awaiting CreateResources
+    CCompactVertex        * m_pStagingCompact;  // Compact vertices awaiting CreateResources
+
+    EDITRECT                m_DirtyVertices;    // Vertices to rebuild by UpdateResources (block relative)
+    EDITRECT                m_DirtyTexels;      // Blend texels to re-upload by UpdateResources (block relative)
+    USHORT                  m_nDirtyLayers;     // Splat levels of layers below this have been painted
+    bool                    m_bDirty;           // Listed in the parent's dirty blocks ?
+
 private:
     
     //-------------------------------------------------------------------------
 	// Private Functions For This Class
 	//-------------------------------------------------------------------------
-    bool    CountLayerUsage     ( );
+    void    BuildVertices       ( const float * pSamples, ULONG SamplePitch, bool bNormalMap, const EDITRECT & Rect, CVertex * pVertices );
+    void    CalculateBounds     ( const float * pSamples, ULONG SamplePitch );
+    bool    CountLayerUsage     ( USHORT LayerCount );
     bool    GenerateSplats      ( );
+    bool    ReadSplats          ( const CTerrainCache & Cache );
     bool    GenerateSplatLevel  ( USHORT TerrainLayer );
+    void    BuildQuadMask       ( USHORT TerrainLayer, UCHAR * pQuadMask, bool & bFullCoverage );
     long    AddSplatLevel       ( USHORT Count );
     bool    GenerateBlendMaps   ( );
+    bool    GenerateBlendMap    ( USHORT TerrainLayer );
+    bool    CreateSplatResources( USHORT TerrainLayer );
+    bool    QuantizeVertices    ( );
+    bool    UpdateVertices      ( );
+    bool    UpdateSplats        ( );
+    bool    UpdateBlendTexture  ( CTerrainSplat * pSplat );
     
 };
 
@@ -182,8 +331,18 @@ public:
     LPDIRECT3DINDEXBUFFER9  m_pIndexBuffer;     // Index buffer for rendering splat
     ULONG                   m_nIndexCount;      // Pre-Calculated Number of indices for rendering 
     ULONG                   m_nPrimitiveCount;  // Pre-calculated number of primitives for rendering
+    LODRANGE                m_LODRange[MAX_TERRAIN_LOD][CTerrainLOD::RANGE_COUNT]; // Index runs for each detail level
+    ULONG                   m_nLODCount;        // Number of detail levels stored in the index buffer
     USHORT                  m_nLayerIndex;      // Layer index used for this splat level
     LPDIRECT3DTEXTURE9      m_pBlendTexture;    // Generated blend texture.
+
+    USHORT                * m_pStagingIndices;  // Indices built by BuildBlock, awaiting CreateResources
+    ULONG                   m_nStagingIndexCount; // Number of staged indices
+    USHORT                * m_pStagingBlend;    // A4R4G4B4 blend texels awaiting CreateResources
+    bool                    m_bSharedIndices;   // Covers the whole block, m_pIndexBuffer references CTerrain's shared buffer
+    UCHAR                 * m_pQuadMask;        // Quads covered, kept on editable terrain to detect coverage changes
+    const USHORT          * m_pCachedIndices;   // Indices within the mapped cache file, awaiting CreateResources
+    const USHORT          * m_pCachedBlend;     // Blend texels within the mapped cache file, awaiting CreateResources
        
 };
 
@@ -203,13 +362,15 @@ public:
     //-------------------------------------------------------------------------
 	// Public Functions for This Class
 	//-------------------------------------------------------------------------
-    UCHAR   GetFilteredAlpha( ULONG x, ULONG z );
+    UCHAR   GetFilteredAlpha( ULONG x, ULONG z, bool Weights = false );
+    bool    StoreWeights    ( );
 	
     //-------------------------------------------------------------------------
 	// Public Variables For This Class
 	//-------------------------------------------------------------------------
     D3DXMATRIX          m_mtxTexture;       // The texture matrix applied to this layer
     UCHAR              *m_pBlendMap;        // The blend map data for this layer
+    UCHAR              *m_pWeightMap;       // Painted weights before clamping & occlusion (editable terrain only)
     ULONG               m_nLayerWidth;      // Width of the layer alpha map
     ULONG               m_nLayerHeight;     // Height of the layer alpha map
     short               m_nTextureIndex;    // Index of the texture to use
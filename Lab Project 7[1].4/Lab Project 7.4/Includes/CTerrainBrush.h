@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainBrush.h
+//
+// Desc: Brushes used to edit the terrain interactively. Raises, lowers,
+//       flattens or smooths the heightmap, or paints layer weights, within a
+//       circular brush, and reports the rectangle of samples modified so that
+//       only the parts of the terrain built from them need to be rebuilt.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINBRUSH_H_
+#define _CTERRAINBRUSH_H_
+
+//-----------------------------------------------------------------------------
+// CTerrainBrush Specific Includes
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : EDITRECT (Struct)
+// Desc : An inclusive rectangle of samples (or texels). Empty when MinX is
+//        greater than MaxX.
+//-----------------------------------------------------------------------------
+struct EDITRECT
+{
+    long            MinX;               // First column
+    long            MinZ;               // First row
+    long            MaxX;               // Last column
+    long            MaxZ;               // Last row
+};
+
+//-----------------------------------------------------------------------------
+// Name : TERRAINBRUSH (Struct)
+// Desc : A circular brush, in the sample (or texel) space of the map edited.
+//-----------------------------------------------------------------------------
+struct TERRAINBRUSH
+{
+    float           x;                  // Centre column
+    float           z;                  // Centre row
+    float           Radius;             // Nothing beyond this distance is touched
+    float           Hardness;           // Fraction of the radius applied at full strength (0 - 1)
+    float           Strength;           // Raise / lower : amount at the centre, otherwise the fraction (0 - 1) moved toward the result
+    float           Target;             // Flatten : height flattened to, paint : weight painted (0 - 255)
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainBrush (Class)
+// Desc : Static brush helpers. Every operation is weighted by the brush
+//        falloff, full strength inside 'Hardness' of the radius and easing
+//        smoothly to nothing at the radius, so that repeated applications
+//        (one per frame while a button is held) build up gradually.
+// Note : Only the samples within the brush are read or written, the cost of
+//        an application is independent of the size of the map.
+//-----------------------------------------------------------------------------
+class CTerrainBrush
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum MODE
+    {
+        MODE_RAISE      = 0,        // Add 'Strength' to the heights
+        MODE_LOWER      = 1,        // Subtract 'Strength' from the heights
+        MODE_FLATTEN    = 2,        // Move the heights toward 'Target'
+        MODE_SMOOTH     = 3,        // Move the heights toward the average of their neighbours
+        MODE_COUNT      = 4
+    };
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static float    GetWeight       ( const TERRAINBRUSH & Brush, float x, float z );
+    static bool     GetRegion       ( const TERRAINBRUSH & Brush, unsigned long Width, unsigned long Height, EDITRECT & Region );
+    static bool     ApplyHeights    ( float * pHeightMap, unsigned long Width, unsigned long Height, const TERRAINBRUSH & Brush,
+                                      MODE Mode, EDITRECT & Changed );
+    static bool     ApplyWeights    ( unsigned char * pWeights, unsigned long Width, unsigned long Height, const TERRAINBRUSH & Brush,
+                                      EDITRECT & Changed );
+
+    static void     ClearRect       ( EDITRECT & Rect );
+    static bool     IsRectEmpty     ( const EDITRECT & Rect ) { return Rect.MinX > Rect.MaxX || Rect.MinZ > Rect.MaxZ; }
+    static void     UnionRect       ( EDITRECT & Rect, const EDITRECT & Other );
+    static bool     GrowRect        ( EDITRECT & Rect, long Before, long After, unsigned long Width, unsigned long Height );
+    static bool     GetBlockRange   ( const EDITRECT & Rect, unsigned long CellsWide, unsigned long CellsHigh, bool SharedEdges,
+                                      unsigned long BlocksWide, unsigned long BlocksHigh, EDITRECT & Blocks );
+};
+
+#endif // _CTERRAINBRUSH_H_
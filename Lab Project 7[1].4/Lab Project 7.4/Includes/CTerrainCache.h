@@ -0,0 +1,171 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainCache.h
+//
+// Desc: Cooked terrain cache. The first time a terrain is built, the filtered
+//       heightmap and each block's layer usage, splat index lists and blend
+//       texels are written to a versioned, checksummed binary file. Later
+//       loads map that file and upload directly from it, skipping the
+//       heightmap filter, the layer map decoding, the occlusion pass and the
+//       splat generation entirely.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINCACHE_H_
+#define _CTERRAINCACHE_H_
+
+//-----------------------------------------------------------------------------
+// CTerrainCache Specific Includes
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include "CTerrainLOD.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const unsigned long TERRAIN_CACHE_VERSION = 1;  // Bump whenever the layout changes
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : TERRAINCACHEKEY (Struct)
+// Desc : The settings the cooked data was built with. A cache is only used
+//        if its key matches the terrain being loaded exactly, so this must be
+//        zeroed before it is filled in.
+//-----------------------------------------------------------------------------
+struct TERRAINCACHEKEY
+{
+    unsigned int    MapWidth;           // Heightmap width (samples)
+    unsigned int    MapHeight;          // Heightmap height (samples)
+    unsigned int    BlockWidth;         // Block width (vertices)
+    unsigned int    BlockHeight;        // Block height (vertices)
+    unsigned int    BlendTexRatio;      // Blend texels per quad
+    unsigned int    LayerCount;         // Layers, including the base layer
+    unsigned int    SharedIndices;      // Fully covered splats use the shared index buffer ?
+    unsigned int    HeightFormat;       // CHeightMap::SAMPLEFORMAT of the source heightmap
+    unsigned int    FilterType;         // CHeightMapFilter::FILTERTYPE applied to it
+    unsigned int    FilterRadius;       // Filter settings as specified
+    unsigned int    FilterIterations;
+    float           FilterSigma;
+};
+
+//-----------------------------------------------------------------------------
+// Name : TERRAINCACHEHEADER (Struct)
+// Desc : Header at the start of a cache file. Followed by the filtered
+//        heightmap (MapWidth x MapHeight floats), each block's record, then
+//        the block table (BlockCount CACHEBLOCKENTRY structures) which runs
+//        to the end of the file. Every item is padded to a multiple of four
+//        bytes.
+//-----------------------------------------------------------------------------
+struct TERRAINCACHEHEADER
+{
+    char            Magic[4];           // "TCOK"
+    unsigned int    Version;            // TERRAIN_CACHE_VERSION
+    TERRAINCACHEKEY Key;                // Settings the data was cooked with
+    unsigned int    BlockCount;         // Number of block records
+    unsigned int    TableOffset;        // Byte offset of the block table
+    unsigned int    FileSize;           // Total size of the file (bytes)
+    unsigned int    Checksum;           // Adler-32 of everything following the header
+};
+
+//-----------------------------------------------------------------------------
+// Name : CACHEBLOCKENTRY (Struct)
+// Desc : Location of a block's record within the cache file.
+//-----------------------------------------------------------------------------
+struct CACHEBLOCKENTRY
+{
+    unsigned int    Offset;             // Byte offset of the record
+    unsigned int    Size;               // Size of the record (bytes)
+};
+
+//-----------------------------------------------------------------------------
+// Name : CACHESPLAT (Struct)
+// Desc : A block record holds the block's layer usage (LayerCount unsigned
+//        shorts) followed by one of these for each layer in use, each
+//        followed by its index list (all levels of detail, IndexCount
+//        unsigned shorts) and its A4R4G4B4 blend texels.
+//-----------------------------------------------------------------------------
+struct CACHESPLAT
+{
+    unsigned short  Layer;              // Terrain layer
+    unsigned short  SharedIndices;      // Draws from the terrain's shared index buffer (no indices follow) ?
+    unsigned int    LODCount;           // Detail levels stored
+    unsigned int    IndexCount;         // Indices following
+    unsigned int    BlendTexels;        // Blend texels following the indices (none for the base layer)
+    unsigned int    Ranges[MAX_TERRAIN_LOD][CTerrainLOD::RANGE_COUNT][2]; // Start index & primitive count of each run
+};
+
+//-----------------------------------------------------------------------------
+// Name : CACHECURSOR (Struct)
+// Desc : Reads through a block record, see CTerrainCache::Read.
+//-----------------------------------------------------------------------------
+struct CACHECURSOR
+{
+    const unsigned char * pData;        // Next item
+    unsigned long         Remaining;    // Bytes left in the record
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainCache (Class)
+// Desc : Reads (by mapping it in to memory) or cooks a terrain cache file.
+//        Open validates the whole file, its header, key and checksum, up
+//        front so that a stale or damaged cache is rejected before anything
+//        has been built from it. Cooking writes to a temporary file which
+//        replaces the cache in Commit, so an interrupted cook never leaves a
+//        partial cache behind.
+//-----------------------------------------------------------------------------
+class CTerrainCache
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTerrainCache();
+	virtual ~CTerrainCache();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool                Open            ( const char * FileName, const TERRAINCACHEKEY & Key );
+    void                Close           ( );
+    bool                IsOpen          ( ) const { return m_pView != NULL; }
+    const float       * GetHeightMap    ( ) const;
+    bool                GetBlock        ( unsigned long Index, CACHECURSOR & Cursor ) const;
+
+    bool                Create          ( const char * FileName, const TERRAINCACHEKEY & Key, unsigned long BlockCount, const float * pHeightMap );
+    bool                BeginBlock      ( unsigned long Index );
+    bool                Write           ( const void * pData, unsigned long Size );
+    bool                EndBlock        ( );
+    bool                Commit          ( );
+    bool                IsCooking       ( ) const { return m_pFile != NULL; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static const void * Read            ( CACHECURSOR & Cursor, unsigned long Size );
+    static bool         IsNewer         ( const char * FileName, const char * ThanFile );
+    static unsigned long Checksum       ( const void * pData, unsigned long Size, unsigned long Previous = 1 );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    const unsigned char * m_pView;      // Mapped cache file (reading)
+    unsigned long       m_nViewSize;    // Size of the mapping (bytes)
+    TERRAINCACHEHEADER  m_Header;       // Header of the file being read or cooked
+
+    FILE              * m_pFile;        // Temporary file being cooked
+    char              * m_strFileName;  // Cache the temporary file replaces on Commit
+    char              * m_strTempName;  // Temporary file name
+    CACHEBLOCKENTRY   * m_pTable;       // Block table being cooked
+    unsigned long       m_nBlock;       // Block being cooked (BlockCount if none)
+    unsigned long       m_nOffset;      // Bytes written so far
+    unsigned long       m_nChecksum;    // Running checksum of the bytes after the header
+    bool                m_bFailed;      // A write has failed, the cook will be abandoned
+};
+
+#endif // _CTERRAINCACHE_H_
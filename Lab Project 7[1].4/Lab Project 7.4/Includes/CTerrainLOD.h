@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainLOD.h
+//
+// Desc: Geomipmapping support for the terrain blocks. Builds the index sets
+//       for each level of detail (including the edge variants used to stitch
+//       a block to a coarser neighbour), measures the geometric error of each
+//       level and selects levels from a screen space error threshold.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINLOD_H_
+#define _CTERRAINLOD_H_
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const unsigned long MAX_TERRAIN_LOD = 8;       // Maximum number of detail levels per block
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : LODRANGE (Struct)
+// Desc : A run of triangle list indices within a level's index set.
+//-----------------------------------------------------------------------------
+struct LODRANGE
+{
+    unsigned long StartIndex;       // First index of the run
+    unsigned long PrimitiveCount;   // Number of triangles in the run
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainLOD (Class)
+// Desc : Static geomipmapping helpers. Level 0 is the full resolution block,
+//        each subsequent level doubles the quad size. Every level's index set
+//        is laid out as:
+//
+//          RANGE_INTERIOR          : triangles unaffected by stitching
+//          RANGE_EDGE + Edge       : edge triangles, neighbour at this level
+//          RANGE_STITCHED + Edge   : edge triangles, neighbour one level
+//                                    coarser (alternate edge vertices are
+//                                    collapsed on to their neighbours)
+//
+//        so that a block whose edges all match its neighbours is drawn with
+//        a single contiguous run. Neighbouring blocks must be no more than
+//        one level apart.
+// Note : Triangles use the same top left to bottom right diagonal as the
+//        original block mesh, other than the top right and bottom left quads
+//        of any level which can be stitched.
+//-----------------------------------------------------------------------------
+class CTerrainLOD
+{
+public:
+    //-------------------------------------------------------------------------
+    // Enumerators
+    //-------------------------------------------------------------------------
+    enum EDGE
+    {
+        EDGE_TOP        = 0,        // First row of the block (lowest z)
+        EDGE_RIGHT      = 1,        // Last column of the block (highest x)
+        EDGE_BOTTOM     = 2,        // Last row of the block (highest z)
+        EDGE_LEFT       = 3,        // First column of the block (lowest x)
+        EDGE_COUNT      = 4
+    };
+
+    enum RANGE
+    {
+        RANGE_INTERIOR  = 0,        // Always drawn
+        RANGE_EDGE      = 1,        // RANGE_EDGE + EDGE_xxx
+        RANGE_STITCHED  = 5,        // RANGE_STITCHED + EDGE_xxx
+        RANGE_COUNT     = 9
+    };
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static unsigned long    GetLevelCount   ( unsigned long QuadsWide, unsigned long QuadsHigh );
+    static unsigned long    BuildIndices    ( unsigned long QuadsWide, unsigned long QuadsHigh, unsigned long Level, const unsigned char * pQuadMask,
+                                              unsigned short * pIndices, unsigned long BaseIndex, LODRANGE Ranges[RANGE_COUNT] );
+    static void             CalculateErrors ( const float * pHeightMap, unsigned long MapWidth, unsigned long StartX, unsigned long StartZ,
+                                              unsigned long QuadsWide, unsigned long QuadsHigh, float HeightScale, float * pErrors );
+    static float            GetPixelScale   ( float FOV, unsigned long ViewportHeight );
+    static unsigned long    SelectLevel     ( const float * pErrors, unsigned long LevelCount, float Distance, float PixelScale, float MaxPixelError );
+    static unsigned long    BuildDrawList   ( const LODRANGE Ranges[RANGE_COUNT], unsigned long StitchMask, LODRANGE Draws[EDGE_COUNT + 1] );
+};
+
+#endif // _CTERRAINLOD_H_
@@ -0,0 +1,252 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainPager.h
+//
+// Desc: Out of core terrain support. CTerrainTileFile stores a heightmap on
+//       disk as independently loadable tiles (one per terrain block), and
+//       CTerrainPager keeps the tiles within a radius of the player resident,
+//       loading them on a background thread, prefetching along the direction
+//       of travel and evicting the least recently used tiles once over budget.
+//
+// Note: Uses Win32 threads on Windows and POSIX threads elsewhere.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINPAGER_H_
+#define _CTERRAINPAGER_H_
+
+//-----------------------------------------------------------------------------
+// CTerrainPager Specific Includes
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const unsigned long TILE_FILE_VERSION = 1;      // Bump whenever the layout changes
+const unsigned long TILE_APRON        = 2;      // Extra samples stored around each tile
+
+//-----------------------------------------------------------------------------
+// Tile callbacks, always called on the thread calling CTerrainPager::Update.
+// 'pSamples' points at the tile's first sample (its apron can be addressed
+// with negative offsets), rows are 'Pitch' samples apart.
+//-----------------------------------------------------------------------------
+typedef bool (*TILELOADED) ( void * pContext, unsigned long TileX, unsigned long TileZ, const float * pSamples, unsigned long Pitch );
+typedef void (*TILEEVICTED)( void * pContext, unsigned long TileX, unsigned long TileZ );
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : TILEFILEHEADER (Struct)
+// Desc : Header at the start of a tile file. Followed by every tile in row
+//        order, each Pitch x Pitch 32 bit float samples, where Pitch is
+//        TileQuads + 1 + (Apron * 2). Apron samples beyond the edge of the
+//        map repeat the edge sample.
+//-----------------------------------------------------------------------------
+struct TILEFILEHEADER
+{
+    char            Magic[4];           // "TTIL"
+    unsigned int    Version;            // TILE_FILE_VERSION
+    unsigned int    MapWidth;           // Source heightmap width (samples)
+    unsigned int    MapHeight;          // Source heightmap height (samples)
+    unsigned int    TileQuads;          // Quads along each side of a tile
+    unsigned int    Apron;              // TILE_APRON
+    unsigned int    TilesWide;          // Number of tiles across
+    unsigned int    TilesHigh;          // Number of tiles down
+};
+
+//-----------------------------------------------------------------------------
+// Name : PAGERSTATS (Struct)
+// Desc : Counters describing the state of the pager after an Update.
+//-----------------------------------------------------------------------------
+struct PAGERSTATS
+{
+    unsigned long   Resident;           // Tiles currently resident
+    unsigned long   Pending;            // Tiles queued or being loaded
+    unsigned long   Required;           // Tiles within the radius of the player
+    unsigned long   Missing;            // Required tiles which are not resident yet
+    unsigned long   Prefetching;        // Tiles requested ahead of the player
+    unsigned long   Loads;              // Total tiles loaded
+    unsigned long   Evictions;          // Total tiles evicted
+    unsigned long   Failures;           // Total tiles which failed to load
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainTileFile (Class)
+// Desc : Reads (and writes) the tiled on-disk heightmap format.
+//-----------------------------------------------------------------------------
+class CTerrainTileFile
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTerrainTileFile();
+	virtual ~CTerrainTileFile();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool                    Open            ( const char * FileName );
+    void                    Close           ( );
+    bool                    ReadTile        ( unsigned long TileX, unsigned long TileZ, float * pSamples );
+    const TILEFILEHEADER &  GetHeader       ( ) const { return m_Header; }
+    unsigned long           GetPitch        ( ) const { return m_Header.TileQuads + 1 + m_Header.Apron * 2; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static bool             Write           ( const char * FileName, const float * pHeightMap, unsigned long Width, unsigned long Height, unsigned long TileQuads );
+    static bool             IsValid         ( const char * FileName, unsigned long Width, unsigned long Height, unsigned long TileQuads );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    FILE              * m_pFile;            // Open tile file
+    TILEFILEHEADER      m_Header;           // Header read from the file
+};
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainPager (Class)
+// Desc : Keeps the tiles around the player resident. Each Update, the tiles
+//        within 'Radius' of the player are required, and tiles within the
+//        radius of where the player will be in 'PrefetchTime' seconds are
+//        requested behind them. Requests are loaded nearest first by a single
+//        background thread, and handed back (through the TILELOADED callback)
+//        on the next Update. Once more than 'Budget' tiles are resident the
+//        least recently required tiles are evicted.
+//-----------------------------------------------------------------------------
+class CTerrainPager
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTerrainPager();
+	virtual ~CTerrainPager();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool                Create          ( const char * FileName, float ScaleX, float ScaleZ, float Radius, unsigned long Budget,
+                                          float PrefetchTime, bool Threaded = true, unsigned long MaxLoadsPerUpdate = 0 );
+    void                Release         ( );
+    void                SetCallbacks    ( TILELOADED pLoaded, TILEEVICTED pEvicted, void * pContext );
+    void                Update          ( const float Position[3], const float Velocity[3] );
+    void                Flush           ( );
+    bool                IsResident      ( unsigned long TileX, unsigned long TileZ ) const;
+    const float       * GetTileSamples  ( unsigned long TileX, unsigned long TileZ ) const;
+    unsigned long       GetPitch        ( ) const { return m_File.GetPitch(); }
+    unsigned long       GetTilesWide    ( ) const { return m_nTilesWide; }
+    unsigned long       GetTilesHigh    ( ) const { return m_nTilesHigh; }
+    unsigned long       GetTileQuads    ( ) const { return m_nTileQuads; }
+    const PAGERSTATS &  GetStats        ( ) const { return m_Stats; }
+
+private:
+    //-------------------------------------------------------------------------
+    // Private Enumerators
+    //-------------------------------------------------------------------------
+    enum TILESTATE
+    {
+        TILE_NONE       = 0,            // Idle (resident or not)
+        TILE_QUEUED     = 1,            // Waiting for the loader
+        TILE_LOADING    = 2,            // Being read by the loader
+        TILE_LOADED     = 3             // Read, waiting to be handed over
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Structures
+    //-------------------------------------------------------------------------
+    struct TILE
+    {
+        TILESTATE       State;          // Loader state (guarded by the lock)
+        float         * pSamples;       // Sample data once loaded
+        unsigned long   LastUsed;       // Update in which the tile was last wanted
+        bool            bResident;      // Handed over to the application
+        bool            bFailed;        // The tile could not be loaded
+    };
+
+    struct REQUEST
+    {
+        unsigned long   Tile;           // Tile index
+        float           Priority;       // Lower values are loaded first
+    };
+
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void                Lock            ( );
+    void                Unlock          ( );
+    void                Wake            ( );
+    bool                LoadNext        ( );
+    void                Deliver         ( );
+    void                Evict           ( );
+    void                UpdateStats     ( );
+    unsigned long       GatherTiles     ( float x, float z, float Priority, REQUEST * pList, unsigned long Count, unsigned long Max );
+    void                LoaderLoop      ( );
+    static int          CompareRequests ( const void * pA, const void * pB );
+#if defined(_WIN32)
+    static DWORD WINAPI LoaderProc      ( LPVOID pParam );
+#else
+    static void *       LoaderProc      ( void * pParam );
+#endif
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    CTerrainTileFile    m_File;             // Tile source (only read by the loader)
+    TILE              * m_pTiles;           // State of every tile
+    unsigned long       m_nTilesWide;       // Number of tiles across
+    unsigned long       m_nTilesHigh;       // Number of tiles down
+    unsigned long       m_nTileQuads;       // Quads along each side of a tile
+    float               m_fTileSizeX;       // World space size of a tile
+    float               m_fTileSizeZ;       // World space size of a tile
+    float               m_fRadius;          // Required radius around the player
+    float               m_fPrefetchTime;    // Seconds of travel to prefetch
+    unsigned long       m_nBudget;          // Maximum resident tiles (when possible)
+    unsigned long       m_nMaxLoads;        // Loads per Update when not threaded (0 = all)
+    unsigned long       m_nFrame;           // Update counter (LRU clock)
+
+    unsigned long     * m_pResident;        // Indices of resident tiles
+    unsigned long       m_nResidentCount;   // Number of resident tiles
+    REQUEST           * m_pWanted;          // Tiles wanted by the last Update, required first
+    unsigned long       m_nWantedCount;     // Number of wanted tiles
+    unsigned long     * m_pDelivery;        // Scratch list of tiles being handed over
+    REQUEST           * m_pRequests;        // Queue read by the loader (guarded)
+    unsigned long       m_nRequestCount;    // Number of queued requests (guarded)
+    unsigned long       m_nNextRequest;     // Next request to load (guarded)
+    unsigned long       m_nLoading;         // Tiles currently being read (guarded)
+    unsigned long     * m_pCompleted;       // Tiles read, awaiting hand over (guarded)
+    unsigned long       m_nCompletedCount;  // Number of completed tiles (guarded)
+
+    TILELOADED          m_pLoaded;          // Tile loaded callback
+    TILEEVICTED         m_pEvicted;         // Tile evicted callback
+    void              * m_pContext;         // Context passed to the callbacks
+    PAGERSTATS          m_Stats;            // Statistics
+
+    bool                m_bThreaded;        // Loader thread running ?
+    volatile bool       m_bShutdown;        // Signals the loader to exit
+#if defined(_WIN32)
+    HANDLE              m_hThread;          // Loader thread
+    HANDLE              m_hWake;            // Auto reset event, new requests queued
+    CRITICAL_SECTION    m_Lock;             // Guards the queue & tile states
+#else
+    pthread_t           m_Thread;           // Loader thread
+    pthread_mutex_t     m_Mutex;            // Guards the queue & tile states
+    pthread_cond_t      m_WakeCond;         // Signalled when requests are queued
+#endif
+
+};
+
+#endif // _CTERRAINPAGER_H_
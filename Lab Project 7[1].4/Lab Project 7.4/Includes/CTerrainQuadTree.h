@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainQuadTree.h
+//
+// Desc: Bounding volume quadtree over the terrain block grid, used to frustum
+//       cull whole regions of blocks at a time.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINQUADTREE_H_
+#define _CTERRAINQUADTREE_H_
+
+//-----------------------------------------------------------------------------
+// CTerrainQuadTree Specific Includes
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const unsigned long FRUSTUM_PLANE_COUNT = 6;                // Planes tested by CTerrainQuadTree::Cull
+const unsigned long FRUSTUM_ALL_PLANES  = (1 << FRUSTUM_PLANE_COUNT) - 1;
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CULLSTATS (Struct)
+// Desc : Work done by the last call to CTerrainQuadTree::Cull.
+//-----------------------------------------------------------------------------
+struct CULLSTATS
+{
+    unsigned long   NodesVisited;       // Nodes popped during traversal
+    unsigned long   BoxesTested;        // Node boxes tested against the frustum
+    unsigned long   PlanesTested;       // Individual box / plane tests
+    unsigned long   BlocksVisible;      // Blocks written to the visible list
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainQuadTree (Class)
+// Desc : Each node bounds a rectangle of blocks, split in to (up to) four
+//        children until a single block remains. Block bounds are supplied
+//        with SetBlockBounds, which refits the nodes above it, so blocks can
+//        come and go (streaming) or change height (editing). Blocks without
+//        bounds are never reported as visible.
+// Note : Planes are stored as a, b, c, d with normals facing out of the
+//        frustum, exactly as the D3DXPLANE array held by CCamera.
+//-----------------------------------------------------------------------------
+class CTerrainQuadTree
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTerrainQuadTree();
+	virtual ~CTerrainQuadTree();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool                Build           ( unsigned long BlocksWide, unsigned long BlocksHigh );
+    void                Release         ( );
+    void                SetBlockBounds  ( unsigned long Block, const float Min[3], const float Max[3] );
+    void                ClearBlockBounds( unsigned long Block );
+    unsigned long       Cull            ( const float * pPlanes, unsigned long * pVisible, CULLSTATS * pStats = NULL ) const;
+    unsigned long       GetNodeCount    ( ) const { return m_nNodeCount; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static bool         TestBox         ( const float * pPlanes, const float Min[3], const float Max[3], unsigned long & PlaneMask, unsigned long * pPlanesTested = NULL );
+
+private:
+    //-------------------------------------------------------------------------
+    // Private Structures
+    //-------------------------------------------------------------------------
+    struct NODE
+    {
+        float           Min[3];         // Bounds of every block below (empty if Min > Max)
+        float           Max[3];
+        unsigned long   Parent;         // Parent node (root refers to itself)
+        unsigned long   Child[4];       // Child nodes, 0 where unused (the root is never a child)
+        unsigned long   ChildCount;     // Number of children, 0 for a leaf
+        unsigned long   FirstBlock;     // First entry in m_pBlockOrder below this node
+        unsigned long   BlockCount;     // Number of blocks below this node
+    };
+
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    unsigned long       CountNodes      ( unsigned long Width, unsigned long Height ) const;
+    unsigned long       BuildNode       ( unsigned long Parent, unsigned long x, unsigned long z, unsigned long Width, unsigned long Height );
+    void                Refit           ( unsigned long Node );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    NODE              * m_pNodes;           // Node array, root first
+    unsigned long       m_nNodeCount;       // Number of nodes in use
+    unsigned long     * m_pBlockOrder;      // Block indices, each node's blocks are contiguous
+    unsigned long     * m_pBlockLeaf;       // Leaf node of each block
+    unsigned char     * m_pBlockValid;      // Non zero where the block has bounds
+    unsigned long       m_nBlocksWide;      // Number of blocks across
+    unsigned long       m_nBlockCount;      // Number of blocks
+
+};
+
+#endif // _CTERRAINQUADTREE_H_
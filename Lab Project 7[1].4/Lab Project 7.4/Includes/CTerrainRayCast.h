@@ -0,0 +1,136 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainRayCast.h
+//
+// Desc: Ray and segment intersection against the heightmap terrain, used for
+//       picking, line of sight and projectile tests. Rays are traced through
+//       a pyramid of min / max quad heights with a hierarchical DDA, so open
+//       sky is skipped in large steps and only the quads a ray actually
+//       passes close to are tested exactly.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTERRAINRAYCAST_H_
+#define _CTERRAINRAYCAST_H_
+
+//-----------------------------------------------------------------------------
+// CTerrainRayCast Specific Includes
+//-----------------------------------------------------------------------------
+#include "CThreadPool.h"
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const unsigned long RAYCAST_BATCH_SIZE  = 64;      // Rays traced by each thread pool task
+const unsigned long RAYCAST_BAND_ROWS   = 64;      // Pyramid rows built by each thread pool task
+
+//-----------------------------------------------------------------------------
+// Main Structures
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : RAYQUERY (Struct)
+// Desc : A single ray for CTerrainRayCast::IntersectBatch.
+//-----------------------------------------------------------------------------
+struct RAYQUERY
+{
+    float           Origin[3];          // World space start of the ray
+    float           Direction[3];       // World space direction (need not be unit length)
+    float           MaxDistance;        // Furthest distance tested along the ray
+};
+
+//-----------------------------------------------------------------------------
+// Name : RAYHIT (Struct)
+// Desc : Where a ray struck the terrain. Only 'Hit' is filled in by occlusion
+//        only tests.
+//-----------------------------------------------------------------------------
+struct RAYHIT
+{
+    bool            Hit;                // Ray struck the terrain ?
+    float           Distance;           // World space distance along the ray
+    float           Position[3];        // World space point of impact
+    float           Normal[3];          // Normal of the triangle struck
+    unsigned long   QuadX;              // Heightmap quad struck
+    unsigned long   QuadZ;
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTerrainRayCast (Class)
+// Desc : Level 0 of the pyramid holds the lowest and highest corner of each
+//        heightmap quad, every level above it the range of a 2 x 2 group of
+//        cells below. A ray steps through the cells of the coarsest level it
+//        can, skipping any it passes over entirely, and drops a level only
+//        where it may touch the terrain. Level 0 cells are intersected with
+//        the quad's two triangles exactly.
+// Note : Triangles use the top left to bottom right diagonal of the rendered
+//        blocks (GetHeight with 'ReverseQuad'). Nothing is struck outside of
+//        the heightmap. The heightmap is referenced rather than copied, and
+//        must remain valid while the pyramid is in use.
+//-----------------------------------------------------------------------------
+class CTerrainRayCast
+{
+public:
+    //-------------------------------------------------------------------------
+    // Constructors & Destructors for This Class
+    //-------------------------------------------------------------------------
+	         CTerrainRayCast();
+	virtual ~CTerrainRayCast();
+
+	//-------------------------------------------------------------------------
+	// Public Functions For This Class
+	//-------------------------------------------------------------------------
+    bool            Build           ( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3], CThreadPool * pPool = NULL );
+    void            Update          ( unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ );
+    void            Release         ( );
+    bool            IsBuilt         ( ) const { return m_pLevels != NULL; }
+    unsigned long   GetLevelCount   ( ) const { return m_nLevelCount; }
+
+    bool            Intersect       ( const float Origin[3], const float Direction[3], float MaxDistance, RAYHIT * pHit = NULL ) const;
+    bool            IntersectSegment( const float Start[3], const float End[3], RAYHIT * pHit = NULL ) const;
+    unsigned long   IntersectBatch  ( const RAYQUERY * pRays, unsigned long Count, RAYHIT * pHits, bool OcclusionOnly = false, CThreadPool * pPool = NULL ) const;
+
+private:
+    //-------------------------------------------------------------------------
+    // Private Structures
+    //-------------------------------------------------------------------------
+    struct RANGE
+    {
+        float           Min;            // Lowest sample below this cell
+        float           Max;            // Highest sample below this cell
+    };
+
+    struct LEVEL
+    {
+        RANGE         * pCells;         // Cell ranges, row by row
+        unsigned long   Wide;           // Cells across
+        unsigned long   High;           // Cells down
+    };
+
+	//-------------------------------------------------------------------------
+	// Private Functions For This Class
+	//-------------------------------------------------------------------------
+    void            BuildCells      ( unsigned long Level, unsigned long MinX, unsigned long MinZ, unsigned long EndX, unsigned long EndZ );
+    bool            IntersectQuad   ( unsigned long x, unsigned long z, const double Origin[3], const double Direction[3],
+                                      double tEnter, double tExit, RAYHIT * pHit ) const;
+
+	//-------------------------------------------------------------------------
+	// Private Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static void     BuildTask       ( void * pContext, unsigned long Band );
+
+	//-------------------------------------------------------------------------
+	// Private Variables For This Class
+	//-------------------------------------------------------------------------
+    const float   * m_pHeightMap;       // Heightmap intersected
+    unsigned long   m_nWidth;           // Width of the heightmap (samples)
+    unsigned long   m_nHeight;          // Height of the heightmap (samples)
+    float           m_fScale[3];        // Terrain scale applied to the samples
+    LEVEL         * m_pLevels;          // Pyramid levels, one cell per quad first
+    unsigned long   m_nLevelCount;      // Number of levels (the last is a single cell)
+
+};
+
+#endif // _CTERRAINRAYCAST_H_
@@ -29,6 +29,7 @@ CCamera::CCamera()
     m_vecUp           = D3DXVECTOR3( 0.0f, 1.0f, 0.0f );
     m_vecLook         = D3DXVECTOR3( 0.0f, 0.0f, 1.0f );
     m_vecPos          = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_vecRenderOffset = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
 
     m_fFOV            = 60.0f;
     m_fNearClip       = 1.0f;
@@ -63,6 +64,7 @@ CCamera::CCamera( const CCamera * pCamera )
     m_vecUp          = D3DXVECTOR3( 0.0f, 1.0f, 0.0f );
     m_vecLook        = D3DXVECTOR3( 0.0f, 0.0f, 1.0f );
     m_vecPos         = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_vecRenderOffset = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
 
     m_fFOV            = 60.0f;
     m_fNearClip       = 1.0f;
@@ -170,6 +172,10 @@ const D3DXMATRIX& CCamera::GetViewMatrix()
     // Only update matrix if something has changed
     if ( m_bViewDirty ) 
     {
+        // The view is built from the rendered position, which trails the
+        // simulated position when the player is using a fixed time step
+        D3DXVECTOR3 vecEye = m_vecPos + m_vecRenderOffset;
+
         // Because many rotations will cause floating point errors, the axis will eventually become
         // non-perpendicular to one other causing all hell to break loose. Therefore, we must
         // perform base vector regeneration to ensure that all vectors remain unit length and
@@ -185,9 +191,9 @@ const D3DXMATRIX& CCamera::GetViewMatrix()
         m_mtxView._11 = m_vecRight.x; m_mtxView._12 = m_vecUp.x; m_mtxView._13 = m_vecLook.x;
 	    m_mtxView._21 = m_vecRight.y; m_mtxView._22 = m_vecUp.y; m_mtxView._23 = m_vecLook.y;
 	    m_mtxView._31 = m_vecRight.z; m_mtxView._32 = m_vecUp.z; m_mtxView._33 = m_vecLook.z;
-	    m_mtxView._41 =- D3DXVec3Dot( &m_vecPos, &m_vecRight );
-	    m_mtxView._42 =- D3DXVec3Dot( &m_vecPos, &m_vecUp    );
-	    m_mtxView._43 =- D3DXVec3Dot( &m_vecPos, &m_vecLook  );
+	    m_mtxView._41 =- D3DXVec3Dot( &vecEye, &m_vecRight );
+	    m_mtxView._42 =- D3DXVec3Dot( &vecEye, &m_vecUp    );
+	    m_mtxView._43 =- D3DXVec3Dot( &vecEye, &m_vecLook  );
 
         // View Matrix has been updated
         m_bViewDirty = false;
@@ -372,6 +378,18 @@ bool CCamera::BoundsInFrustum( const D3DXVECTOR3 & Min, const D3DXVECTOR3 & Max
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Name : GetFrustumPlanes ()
+// Desc : Retrieve the 6 frustum planes (normals facing out of the frustum),
+//        for callers performing their own hierarchical culling.
+//-----------------------------------------------------------------------------
+const D3DXPLANE * CCamera::GetFrustumPlanes( )
+{
+    // Make sure the planes are up to date
+    CalcFrustumPlanes();
+    return m_Frustum;
+}
+
 //-----------------------------------------------------------------------------
 // Name : SetVolumeInfo ()
 // Desc : Set the players collision volume information
@@ -29,6 +29,8 @@ CGameApp::CGameApp()
     m_hMenu         = NULL;
     m_bLostDevice   = false;
     m_LastFrameRate = 0;
+    m_bProfileCapture = false;
+    m_fStepRate     = 0.0f;
     
     // Set up initial states (these will be adjusted later if not supported)
     m_FillMode      = D3DFILL_SOLID;
@@ -57,6 +59,23 @@ CGameApp::~CGameApp()
 //-----------------------------------------------------------------------------
 bool CGameApp::InitInstance( HANDLE hInstance, LPCTSTR lpCmdLine, int iCmdShow )
 {
+    // Capture a profiler trace of the whole session if requested (written on shut down)
+    if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-profile") ) )
+    {
+        m_bProfileCapture = true;
+        CProfiler::SetTraceCapture( true );
+
+    } // End if profiling
+
+    // Simulate with a fixed time step if requested ("-fixedstep [Rate]")
+    LPCTSTR pStepArg = lpCmdLine ? _tcsstr( lpCmdLine, _T("-fixedstep") ) : NULL;
+    if ( pStepArg )
+    {
+        m_fStepRate = (float)_tcstod( pStepArg + 10, NULL );
+        if ( m_fStepRate <= 0.0f ) m_fStepRate = DEFAULT_STEP_RATE;
+
+    } // End if fixed step
+
     // Create the primary display device
     if (!CreateDisplay()) { ShutDown(); return false; }
 
@@ -209,6 +228,9 @@ void CGameApp::SetupGameState()
     // Lets give a small initial rotation and set initial position
     m_Player.SetPosition( D3DXVECTOR3( 5433.0f, 400.0f, 8067.0f) );
     m_Player.Rotate( -10, 135, 0 );
+
+    // Select fixed or variable time step simulation
+    m_Player.SetFixedStepRate( m_fStepRate );
 }
 
 //-----------------------------------------------------------------------------
@@ -571,6 +593,7 @@ int CGameApp::BeginGame()
         {
 			// Advance Game Frame.
 			FrameAdvance();
+			PROFILE_FRAME();
 
 		} // End If messages waiting
 	
@@ -585,6 +608,15 @@ int CGameApp::BeginGame()
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+    // Write out the profiler trace (for chrome://tracing)
+    if ( m_bProfileCapture )
+    {
+        CProfiler::SetTraceCapture( false );
+        CProfiler::ExportChromeTrace( "Profile.json" );
+        m_bProfileCapture = false;
+
+    } // End if profiling
+
     // Release any previously built objects
     ReleaseObjects ( );
 
@@ -722,6 +754,11 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 
                     } // End if
                     break;
+
+                case 'L':
+                    // Toggle terrain level of detail
+                    m_Terrain.SetLODEnabled( !m_Terrain.IsLODEnabled() );
+                    break;
                     
 			} // End Switch
 
@@ -1109,6 +1146,7 @@ void CGameApp::ReleaseObjects( )
 //-----------------------------------------------------------------------------
 void CGameApp::FrameAdvance()
 {
+    PROFILE_ZONE( "FrameAdvance" );
     static TCHAR FrameRate[ 50 ];
     static TCHAR TitleBuffer[ 255 ];
 
@@ -1121,8 +1159,13 @@ void CGameApp::FrameAdvance()
     // Get / Display the framerate
     if ( m_LastFrameRate != m_Timer.GetFrameRate() )
     {
+        VERTEXSTATS VertexStats;
+        m_Terrain.GetVertexStats( VertexStats );
         m_LastFrameRate = m_Timer.GetFrameRate( FrameRate );
-        _stprintf( TitleBuffer, _T("Terrain Alpha : %s"), FrameRate );
+        _stprintf( TitleBuffer, _T("Terrain Alpha : %s : %lu Triangles (LOD %s) : %lu Blocks, %lu Nodes, %lu Boxes : %lu Index Switches : %lu KB Vertices (Max Error %.3f)"), FrameRate,
+                   m_Terrain.GetTrianglesDrawn(), m_Terrain.IsLODEnabled() ? _T("On") : _T("Off"),
+                   m_Terrain.GetCullStats().BlocksVisible, m_Terrain.GetCullStats().NodesVisited, m_Terrain.GetCullStats().BoxesTested,
+                   m_Terrain.GetIndexSwitches(), VertexStats.VertexBytes / 1024, VertexStats.MaxError );
         SetWindowText( m_hWnd, TitleBuffer );
 
     } // End if Frame Rate Altered
@@ -1152,6 +1195,9 @@ void CGameApp::FrameAdvance()
     // Poll & Process input devices
     ProcessInput();
 
+    // Page the terrain in around the player before anything collides with it
+    m_Terrain.UpdateStreaming( m_Player.GetPosition(), m_Player.GetVelocity() );
+
     // Animate the game objects
     AnimateObjects();
 
@@ -1245,14 +1291,62 @@ void CGameApp::ProcessInput( )
 
     } // End if camera moved
 
+    // Apply any terrain editing brushes
+    EditTerrain( pKeyBuffer );
+
     // Update our camera (updates velocity etc)
-    m_Player.Update( m_Timer.GetTimeElapsed() );
+    m_Player.Advance( m_Timer.GetTimeElapsed() );
 
     // Update the device matrix
     m_pCamera->UpdateRenderView( m_pD3DDevice );
 
 }
 
+//-----------------------------------------------------------------------------
+// Name : EditTerrain () (Private)
+// Desc : Applies a terrain brush where the camera is looking while the editing
+//        keys are held. R raises, F lowers, T flattens to the height under the
+//        brush and G smooths the terrain, while 1 - 9 paint that layer (erasing
+//        it if shift is held, editable terrain only).
+//-----------------------------------------------------------------------------
+void CGameApp::EditTerrain( const UCHAR pKeyBuffer[] )
+{
+    RAYHIT      Hit;
+    USHORT      i;
+    float       Radius, Rate = m_Timer.GetTimeElapsed();
+    bool        bErase = (pKeyBuffer[ VK_SHIFT ] & 0xF0) != 0, bEditing = false;
+
+    // Nothing to do (and no ray to cast) unless an editing key is held
+    if ( (pKeyBuffer[ 'R' ] | pKeyBuffer[ 'F' ] | pKeyBuffer[ 'T' ] | pKeyBuffer[ 'G' ]) & 0xF0 ) bEditing = true;
+    for ( i = 1; m_Terrain.IsEditable() && i < m_Terrain.GetLayerCount() && i <= 9; i++ )
+    {
+        if ( pKeyBuffer[ '0' + i ] & 0xF0 ) bEditing = true;
+
+    } // Next Layer
+    if ( !bEditing ) return;
+
+    // Find the point on the terrain the camera is looking at
+    Radius = 6.0f * m_Terrain.GetScale().x;
+    if ( !m_Terrain.Intersect( m_pCamera->GetPosition(), m_pCamera->GetLook(), Radius * 100.0f, &Hit ) ) return;
+    D3DXVECTOR3 vecCentre( Hit.Position[0], Hit.Position[1], Hit.Position[2] );
+
+    // Sculpt the heights (strength is in world units per second for raise / lower)
+    if ( pKeyBuffer[ 'R' ] & 0xF0 ) m_Terrain.EditHeights( CTerrainBrush::MODE_RAISE, vecCentre, Radius, 2.0f * m_Terrain.GetScale().y * Rate );
+    if ( pKeyBuffer[ 'F' ] & 0xF0 ) m_Terrain.EditHeights( CTerrainBrush::MODE_LOWER, vecCentre, Radius, 2.0f * m_Terrain.GetScale().y * Rate );
+    if ( pKeyBuffer[ 'T' ] & 0xF0 ) m_Terrain.EditHeights( CTerrainBrush::MODE_FLATTEN, vecCentre, Radius, 2.0f * Rate );
+    if ( pKeyBuffer[ 'G' ] & 0xF0 ) m_Terrain.EditHeights( CTerrainBrush::MODE_SMOOTH, vecCentre, Radius, 2.0f * Rate );
+
+    // Paint the layers
+    if ( !m_Terrain.IsEditable() ) return;
+    for ( i = 1; i < m_Terrain.GetLayerCount() && i <= 9; i++ )
+    {
+        if ( !(pKeyBuffer[ '0' + i ] & 0xF0) ) continue;
+        m_Terrain.PaintLayer( i, vecCentre, Radius, bErase ? -Rate : Rate );
+
+    } // Next Layer
+
+}
+
 //-----------------------------------------------------------------------------
 // Name : AnimateObjects () (Private)
 // Desc : Animates the objects we currently have loaded.
@@ -1363,7 +1457,7 @@ void CGameApp::RenderSkyBox( )
     if ( !m_pCamera || !m_pD3DDevice ) return;
     
     // Generate our sky box rendering origin and set as world matrix
-    D3DXVECTOR3 CamPos = m_pCamera->GetPosition();
+    D3DXVECTOR3 CamPos = m_pCamera->GetRenderPosition();
     D3DXMatrixTranslation( &mtxWorld, CamPos.x, CamPos.y + 1.3f, CamPos.z );
     m_pD3DDevice->SetTransform( D3DTS_WORLD, &mtxWorld );
 
@@ -0,0 +1,511 @@
+//-----------------------------------------------------------------------------
+// File: CHeightMap.cpp
+//
+// Desc: Heightmap file loading, sample conversion and height queries used by
+//       the terrain. RAW heightmaps are mapped into memory (or read in a
+//       single call when mapping is unavailable) and widened to floating point
+//       in bulk. Heights (and normals) can be queried for many points at once.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CHeightMap Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CHeightMap.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <strings.h>
+    #define _stricmp strcasecmp
+#endif
+
+#if defined(HEIGHTMAP_SSE)
+    #include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : ConvertUInt8 ()
+    // Desc : Widen 8 bit samples to float
+    //-------------------------------------------------------------------------
+    void ConvertUInt8( const unsigned char * pSource, float * pDest, unsigned long Count )
+    {
+        unsigned long i = 0;
+
+#if defined(HEIGHTMAP_SSE)
+        const __m128i Zero = _mm_setzero_si128();
+
+        // 16 samples at a time, bytes -> words -> dwords -> floats
+        for ( ; i + 16 <= Count; i += 16 )
+        {
+            __m128i Bytes = _mm_loadu_si128( (const __m128i*)(pSource + i) );
+            __m128i Low   = _mm_unpacklo_epi8( Bytes, Zero );
+            __m128i High  = _mm_unpackhi_epi8( Bytes, Zero );
+
+            _mm_storeu_ps( pDest + i,      _mm_cvtepi32_ps( _mm_unpacklo_epi16( Low,  Zero ) ) );
+            _mm_storeu_ps( pDest + i + 4,  _mm_cvtepi32_ps( _mm_unpackhi_epi16( Low,  Zero ) ) );
+            _mm_storeu_ps( pDest + i + 8,  _mm_cvtepi32_ps( _mm_unpacklo_epi16( High, Zero ) ) );
+            _mm_storeu_ps( pDest + i + 12, _mm_cvtepi32_ps( _mm_unpackhi_epi16( High, Zero ) ) );
+
+        } // Next 16 Samples
+#endif
+
+        // Remaining samples
+        for ( ; i < Count; i++ ) pDest[i] = (float)pSource[i];
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ConvertUInt16 ()
+    // Desc : Widen little endian 16 bit samples to float, scaled to 0 - 256
+    //-------------------------------------------------------------------------
+    void ConvertUInt16( const unsigned char * pSource, float * pDest, unsigned long Count )
+    {
+        unsigned long i = 0;
+
+#if defined(HEIGHTMAP_SSE)
+        const __m128i Zero  = _mm_setzero_si128();
+        const __m128  Scale = _mm_set1_ps( HEIGHTMAP_UINT16_SCALE );
+
+        // 8 samples at a time, words -> dwords -> floats
+        for ( ; i + 8 <= Count; i += 8 )
+        {
+            __m128i Words = _mm_loadu_si128( (const __m128i*)(pSource + i * 2) );
+
+            _mm_storeu_ps( pDest + i,     _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( Words, Zero ) ), Scale ) );
+            _mm_storeu_ps( pDest + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( Words, Zero ) ), Scale ) );
+
+        } // Next 8 Samples
+#endif
+
+        // Remaining samples (assembled byte by byte, the source may be unaligned)
+        for ( ; i < Count; i++ )
+        {
+            unsigned short Value = (unsigned short)( pSource[i * 2] | (pSource[i * 2 + 1] << 8) );
+            pDest[i] = (float)Value * HEIGHTMAP_UINT16_SCALE;
+
+        } // Next Sample
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ReadRaw ()
+    // Desc : Fallback loader, reads the file with a single fread
+    //-------------------------------------------------------------------------
+    bool ReadRaw( const char * pFileName, CHeightMap::SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount )
+    {
+        unsigned long   Size    = SampleCount * CHeightMap::GetSampleSize( Format );
+        unsigned char * pBuffer = NULL;
+        bool            bResult;
+        FILE          * pFile;
+
+        // Open up the heightmap file
+        pFile = fopen( pFileName, "rb" );
+        if ( !pFile ) return false;
+
+        // Float samples can be read straight in to the destination
+        if ( Format == CHeightMap::FORMAT_FLOAT32 )
+        {
+            bResult = ( fread( pDest, 1, Size, pFile ) == Size );
+            fclose( pFile );
+            return bResult;
+
+        } // End if float
+
+        // Everything else is read in to a temporary buffer and converted
+        pBuffer = new unsigned char[ Size ];
+        if ( !pBuffer ) { fclose( pFile ); return false; }
+
+        bResult = ( fread( pBuffer, 1, Size, pFile ) == Size );
+        fclose( pFile );
+        if ( bResult ) CHeightMap::ConvertSamples( pBuffer, Format, pDest, SampleCount );
+
+        // Clean up
+        delete []pBuffer;
+        return bResult;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : MapRaw ()
+    // Desc : Map the file in to memory and convert directly from the view.
+    // Note : Returns false, without touching the destination, if the file
+    //        could not be mapped; 'bValid' reports whether the file was large
+    //        enough to hold the requested samples.
+    //-------------------------------------------------------------------------
+    bool MapRaw( const char * pFileName, CHeightMap::SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount, bool & bValid )
+    {
+        unsigned long Size = SampleCount * CHeightMap::GetSampleSize( Format );
+
+        bValid = false;
+
+#if defined(_WIN32)
+        HANDLE hFile, hMapping;
+        void * pView;
+
+        hFile = CreateFileA( pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if ( hFile == INVALID_HANDLE_VALUE ) return false;
+
+        // The file must hold all of the samples
+        if ( GetFileSize( hFile, NULL ) < Size ) { CloseHandle( hFile ); return true; }
+
+        hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( !hMapping ) { CloseHandle( hFile ); return false; }
+
+        pView = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, Size );
+        if ( !pView ) { CloseHandle( hMapping ); CloseHandle( hFile ); return false; }
+
+        CHeightMap::ConvertSamples( pView, Format, pDest, SampleCount );
+        bValid = true;
+
+        // Clean up
+        UnmapViewOfFile( pView );
+        CloseHandle( hMapping );
+        CloseHandle( hFile );
+#else
+        struct stat Info;
+        void      * pView;
+        int         File;
+
+        File = open( pFileName, O_RDONLY );
+        if ( File < 0 ) return false;
+
+        // The file must hold all of the samples
+        if ( fstat( File, &Info ) != 0 ) { close( File ); return false; }
+        if ( (unsigned long)Info.st_size < Size ) { close( File ); return true; }
+
+        pView = mmap( NULL, Size, PROT_READ, MAP_PRIVATE, File, 0 );
+        if ( pView == MAP_FAILED ) { close( File ); return false; }
+        madvise( pView, Size, MADV_SEQUENTIAL );
+
+        CHeightMap::ConvertSamples( pView, Format, pDest, SampleCount );
+        bValid = true;
+
+        // Clean up
+        munmap( pView, Size );
+        close( File );
+#endif
+
+        // File was mapped
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : QueryHeight ()
+    // Desc : Scalar height query for a single point, the same calculation as
+    //        CTerrain::GetHeight with the far neighbour clamped to the edge of
+    //        the heightmap. Also used for the points left over by the SIMD
+    //        kernel so that both produce identical results.
+    //-------------------------------------------------------------------------
+    void QueryHeight( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                      float x, float z, bool ReverseQuad, float * pHeight, float * pNormal )
+    {
+        float fTopLeft, fTopRight, fBottomLeft, fBottomRight, fDeltaX, fDeltaZ, fLength;
+
+        // Adjust Input Values
+        x = x / Scale[0];
+        z = z / Scale[2];
+
+        // Out of bounds points are flat ground at zero
+        if ( !(x >= 0.0f && z >= 0.0f && x < (float)Width && z < (float)Height) )
+        {
+            *pHeight = 0.0f;
+            if ( pNormal ) { pNormal[0] = 0.0f; pNormal[1] = 1.0f; pNormal[2] = 0.0f; }
+            return;
+
+        } // End if out of bounds
+
+        // Retrieve the quad and the position within it
+        unsigned long ix  = (unsigned long)x, iz = (unsigned long)z;
+        unsigned long ix1 = (ix + 1 < Width) ? ix + 1 : ix;
+        unsigned long iz1 = (iz + 1 < Height) ? iz + 1 : iz;
+        float fPercentX   = x - (float)ix;
+        float fPercentZ   = z - (float)iz;
+
+        fTopLeft     = pHeightMap[ ix  + iz  * Width ] * Scale[1];
+        fTopRight    = pHeightMap[ ix1 + iz  * Width ] * Scale[1];
+        fBottomLeft  = pHeightMap[ ix  + iz1 * Width ] * Scale[1];
+        fBottomRight = pHeightMap[ ix1 + iz1 * Width ] * Scale[1];
+
+        // Replace the corner which is not part of our triangle so that the
+        // quad becomes the plane of that triangle
+        if ( ReverseQuad )
+        {
+            if ( fPercentX < fPercentZ )
+                fTopRight   = fTopLeft + (fBottomRight - fBottomLeft);
+            else
+                fBottomLeft = fTopLeft + (fBottomRight - fTopRight);
+
+        } // End if Quad is reversed
+        else
+        {
+            if ( fPercentX < (1.0f - fPercentZ) )
+                fBottomRight = fBottomLeft + (fTopRight - fTopLeft);
+            else
+                fTopLeft     = fTopRight + (fBottomLeft - fBottomRight);
+
+        } // End if Quad is not reversed
+
+        // Interpolate across the top and bottom edges, then between them
+        float fTopHeight    = fTopLeft    + ((fTopRight - fTopLeft) * fPercentX );
+        float fBottomHeight = fBottomLeft + ((fBottomRight - fBottomLeft) * fPercentX );
+        *pHeight = fTopHeight + ((fBottomHeight - fTopHeight) * fPercentZ );
+
+        if ( !pNormal ) return;
+
+        // Normal of the triangle's plane, from its world space slopes
+        fDeltaX    = (fTopRight - fTopLeft) / Scale[0];
+        fDeltaZ    = (fBottomLeft - fTopLeft) / Scale[2];
+        fLength    = sqrtf( fDeltaX * fDeltaX + 1.0f + fDeltaZ * fDeltaZ );
+        pNormal[0] = -fDeltaX / fLength;
+        pNormal[1] = 1.0f / fLength;
+        pNormal[2] = -fDeltaZ / fLength;
+    }
+
+#if defined(HEIGHTMAP_SSE)
+    //-------------------------------------------------------------------------
+    // Name : Select ()
+    // Desc : Per lane (Mask ? a : b)
+    //-------------------------------------------------------------------------
+    inline __m128 Select( __m128 Mask, __m128 a, __m128 b )
+    {
+        return _mm_or_ps( _mm_and_ps( Mask, a ), _mm_andnot_ps( Mask, b ) );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : QueryHeights4 ()
+    // Desc : SIMD height query for four points. Matches QueryHeight exactly,
+    //        the triangle selection is done with lane masks rather than
+    //        branches. Only the corner fetches are performed per lane.
+    //-------------------------------------------------------------------------
+    void QueryHeights4( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                        const char * pX, const char * pZ, unsigned long Stride, bool ReverseQuad, float * pHeights, float * pNormals )
+    {
+        __m128 X, Z, Valid, PercentX, PercentZ, TL, TR, BL, BR, Left;
+        __m128 NewTL, NewTR, NewBL, NewBR, TopHeight, BottomHeight;
+        const float * pCorner[4][4];
+        int    ix[4], iz[4];
+        int    i;
+
+        // Adjust Input Values (lanes are built directly from the strided
+        // values, storing them to an array first would stall the load)
+        X = _mm_set_ps( *(const float*)(pX + Stride * 3), *(const float*)(pX + Stride * 2), *(const float*)(pX + Stride), *(const float*)pX );
+        Z = _mm_set_ps( *(const float*)(pZ + Stride * 3), *(const float*)(pZ + Stride * 2), *(const float*)(pZ + Stride), *(const float*)pZ );
+        X = _mm_div_ps( X, _mm_set1_ps( Scale[0] ) );
+        Z = _mm_div_ps( Z, _mm_set1_ps( Scale[2] ) );
+
+        // Out of bounds lanes are zeroed so that they fetch a valid sample
+        Valid = _mm_and_ps( _mm_cmpge_ps( X, _mm_setzero_ps() ), _mm_cmpge_ps( Z, _mm_setzero_ps() ) );
+        Valid = _mm_and_ps( Valid, _mm_cmplt_ps( X, _mm_set1_ps( (float)Width ) ) );
+        Valid = _mm_and_ps( Valid, _mm_cmplt_ps( Z, _mm_set1_ps( (float)Height ) ) );
+        X     = _mm_and_ps( X, Valid );
+        Z     = _mm_and_ps( Z, Valid );
+
+        // Retrieve the quad and the position within it
+        __m128i IX = _mm_cvttps_epi32( X ), IZ = _mm_cvttps_epi32( Z );
+        PercentX   = _mm_sub_ps( X, _mm_cvtepi32_ps( IX ) );
+        PercentZ   = _mm_sub_ps( Z, _mm_cvtepi32_ps( IZ ) );
+        _mm_storeu_si128( (__m128i*)ix, IX );
+        _mm_storeu_si128( (__m128i*)iz, IZ );
+
+        // Fetch the four corners of each lane's quad
+        for ( i = 0; i < 4; ++i )
+        {
+            unsigned long ix1 = ((unsigned long)ix[i] + 1 < Width) ? ix[i] + 1 : ix[i];
+            unsigned long iz1 = ((unsigned long)iz[i] + 1 < Height) ? iz[i] + 1 : iz[i];
+            const float * pRow0 = pHeightMap + iz[i] * Width;
+            const float * pRow1 = pHeightMap + iz1 * Width;
+            pCorner[0][i] = pRow0 + ix[i];
+            pCorner[1][i] = pRow0 + ix1;
+            pCorner[2][i] = pRow1 + ix[i];
+            pCorner[3][i] = pRow1 + ix1;
+
+        } // Next Lane
+
+        __m128 ScaleY = _mm_set1_ps( Scale[1] );
+        TL = _mm_mul_ps( _mm_set_ps( *pCorner[0][3], *pCorner[0][2], *pCorner[0][1], *pCorner[0][0] ), ScaleY );
+        TR = _mm_mul_ps( _mm_set_ps( *pCorner[1][3], *pCorner[1][2], *pCorner[1][1], *pCorner[1][0] ), ScaleY );
+        BL = _mm_mul_ps( _mm_set_ps( *pCorner[2][3], *pCorner[2][2], *pCorner[2][1], *pCorner[2][0] ), ScaleY );
+        BR = _mm_mul_ps( _mm_set_ps( *pCorner[3][3], *pCorner[3][2], *pCorner[3][1], *pCorner[3][0] ), ScaleY );
+
+        // Replace the corner which is not part of each lane's triangle
+        if ( ReverseQuad )
+        {
+            Left  = _mm_cmplt_ps( PercentX, PercentZ );
+            NewTR = Select( Left, _mm_add_ps( TL, _mm_sub_ps( BR, BL ) ), TR );
+            NewBL = Select( Left, BL, _mm_add_ps( TL, _mm_sub_ps( BR, TR ) ) );
+            TR    = NewTR;
+            BL    = NewBL;
+
+        } // End if Quad is reversed
+        else
+        {
+            Left  = _mm_cmplt_ps( PercentX, _mm_sub_ps( _mm_set1_ps( 1.0f ), PercentZ ) );
+            NewBR = Select( Left, _mm_add_ps( BL, _mm_sub_ps( TR, TL ) ), BR );
+            NewTL = Select( Left, TL, _mm_add_ps( TR, _mm_sub_ps( BL, BR ) ) );
+            BR    = NewBR;
+            TL    = NewTL;
+
+        } // End if Quad is not reversed
+
+        // Interpolate across the top and bottom edges, then between them
+        TopHeight    = _mm_add_ps( TL, _mm_mul_ps( _mm_sub_ps( TR, TL ), PercentX ) );
+        BottomHeight = _mm_add_ps( BL, _mm_mul_ps( _mm_sub_ps( BR, BL ), PercentX ) );
+        _mm_storeu_ps( pHeights, _mm_and_ps( Valid, _mm_add_ps( TopHeight, _mm_mul_ps( _mm_sub_ps( BottomHeight, TopHeight ), PercentZ ) ) ) );
+
+        if ( !pNormals ) return;
+
+        // Normal of each triangle's plane (out of bounds lanes get zero slopes)
+        __m128 DeltaX = _mm_and_ps( Valid, _mm_div_ps( _mm_sub_ps( TR, TL ), _mm_set1_ps( Scale[0] ) ) );
+        __m128 DeltaZ = _mm_and_ps( Valid, _mm_div_ps( _mm_sub_ps( BL, TL ), _mm_set1_ps( Scale[2] ) ) );
+        __m128 Length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( DeltaX, DeltaX ), _mm_set1_ps( 1.0f ) ), _mm_mul_ps( DeltaZ, DeltaZ ) ) );
+        float  fNormal[3][4];
+
+        _mm_storeu_ps( fNormal[0], _mm_div_ps( _mm_sub_ps( _mm_setzero_ps(), DeltaX ), Length ) );
+        _mm_storeu_ps( fNormal[1], _mm_div_ps( _mm_set1_ps( 1.0f ), Length ) );
+        _mm_storeu_ps( fNormal[2], _mm_div_ps( _mm_sub_ps( _mm_setzero_ps(), DeltaZ ), Length ) );
+
+        // Interleave back out to x, y, z triples
+        for ( i = 0; i < 4; ++i )
+        {
+            pNormals[ i * 3 ]     = fNormal[0][i];
+            pNormals[ i * 3 + 1 ] = fNormal[1][i];
+            pNormals[ i * 3 + 2 ] = fNormal[2][i];
+
+        } // Next Lane
+    }
+#endif
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : ParseFormat () (Static)
+// Desc : Convert a format name from a terrain definition file ("8", "16" or
+//        "float") in to the matching sample format.
+//-----------------------------------------------------------------------------
+bool CHeightMap::ParseFormat( const char * pString, SAMPLEFORMAT & Format )
+{
+    // Skip any leading white space
+    while ( *pString == ' ' || *pString == '\t' ) pString++;
+
+    if ( *pString == '\0' || _stricmp( pString, "8" ) == 0 || _stricmp( pString, "uint8" ) == 0 )
+        Format = FORMAT_UINT8;
+    else if ( _stricmp( pString, "16" ) == 0 || _stricmp( pString, "uint16" ) == 0 )
+        Format = FORMAT_UINT16;
+    else if ( _stricmp( pString, "float" ) == 0 || _stricmp( pString, "float32" ) == 0 )
+        Format = FORMAT_FLOAT32;
+    else
+        return false;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSampleSize () (Static)
+// Desc : Returns the size of a single sample of the specified format (bytes)
+//-----------------------------------------------------------------------------
+unsigned long CHeightMap::GetSampleSize( SAMPLEFORMAT Format )
+{
+    switch ( Format )
+    {
+        case FORMAT_UINT16:  return 2;
+        case FORMAT_FLOAT32: return 4;
+        default:             return 1;
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoadRaw () (Static)
+// Desc : Load a RAW heightmap in to the float array passed. The file is mapped
+//        in to memory and converted directly from the mapped view, falling
+//        back to a single bulk read if the file cannot be mapped.
+// Note : Fails if the file holds fewer than 'SampleCount' samples.
+//-----------------------------------------------------------------------------
+bool CHeightMap::LoadRaw( const char * pFileName, SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount, bool bMapFile )
+{
+    bool bValid;
+
+    // Validate Parameters
+    if ( !pFileName || !pDest ) return false;
+
+    // Try and map the file first
+    if ( bMapFile && MapRaw( pFileName, Format, pDest, SampleCount, bValid ) ) return bValid;
+
+    // Read it in instead
+    return ReadRaw( pFileName, Format, pDest, SampleCount );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ConvertSamples () (Static)
+// Desc : Convert raw samples of the specified format in to floats.
+//-----------------------------------------------------------------------------
+void CHeightMap::ConvertSamples( const void * pSource, SAMPLEFORMAT Format, float * pDest, unsigned long SampleCount )
+{
+    switch ( Format )
+    {
+        case FORMAT_UINT8:
+            ConvertUInt8( (const unsigned char*)pSource, pDest, SampleCount );
+            break;
+
+        case FORMAT_UINT16:
+            ConvertUInt16( (const unsigned char*)pSource, pDest, SampleCount );
+            break;
+
+        case FORMAT_FLOAT32:
+            memcpy( pDest, pSource, SampleCount * sizeof(float) );
+            break;
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetHeights () (Static)
+// Desc : Retrieve the interpolated height, and optionally the triangle normal,
+//        at each of 'Count' world space (x, z) positions. 'Stride' is the
+//        distance in bytes between consecutive x (and z) values, so positions
+//        can be read directly from arrays of vectors. Normals are written as
+//        x, y, z triples. Points outside of the heightmap return a height of
+//        zero and an upward normal, as CTerrain::GetHeight does.
+//-----------------------------------------------------------------------------
+void CHeightMap::GetHeights( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3],
+                             const float * pX, const float * pZ, unsigned long Stride, unsigned long Count,
+                             float * pHeights, float * pNormals, bool ReverseQuad )
+{
+    const char  * pXBytes = (const char*)pX, * pZBytes = (const char*)pZ;
+    unsigned long i = 0;
+
+    // Validate Parameters
+    if ( !pHeightMap || !pX || !pZ || !pHeights || Width == 0 || Height == 0 ) return;
+    if ( Stride == 0 ) Stride = sizeof(float);
+
+#if defined(HEIGHTMAP_SSE)
+    // Four points at a time
+    for ( ; i + 4 <= Count; i += 4 )
+    {
+        QueryHeights4( pHeightMap, Width, Height, Scale, pXBytes + i * Stride, pZBytes + i * Stride, Stride,
+                       ReverseQuad, pHeights + i, pNormals ? pNormals + i * 3 : NULL );
+
+    } // Next 4 Points
+#endif
+
+    // Remaining points
+    for ( ; i < Count; ++i )
+    {
+        QueryHeight( pHeightMap, Width, Height, Scale, *(const float*)(pXBytes + i * Stride), *(const float*)(pZBytes + i * Stride),
+                     ReverseQuad, pHeights + i, pNormals ? pNormals + i * 3 : NULL );
+
+    } // Next Point
+}
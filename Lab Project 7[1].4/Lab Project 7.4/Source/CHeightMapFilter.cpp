@@ -0,0 +1,305 @@
+//-----------------------------------------------------------------------------
+// File: CHeightMapFilter.cpp
+//
+// Desc: Separable heightmap smoothing filters. Each iteration runs a
+//       horizontal and then a vertical pass of a 1D kernel (box or Gaussian),
+//       with the rows of each pass split in to bands and spread across a
+//       thread pool.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CHeightMapFilter Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CHeightMapFilter.h"
+#include <string.h>
+#include <math.h>
+
+#if !defined(_WIN32)
+    #include <strings.h>
+    #define _stricmp strcasecmp
+#endif
+
+#if defined(HEIGHTMAPFILTER_SSE)
+    #include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : FILTERPASS (Struct)
+    // Desc : Everything a thread pool task needs to process its band of rows
+    //        for one pass of the filter.
+    //-------------------------------------------------------------------------
+    struct FILTERPASS
+    {
+        const float   * pSource;        // Samples read by this pass
+        float         * pDest;          // Samples written by this pass
+        const float   * pWeights;       // 1D kernel, (Radius * 2) + 1 taps
+        unsigned long   Radius;         // Kernel radius
+        unsigned long   Width;          // Heightmap width (samples)
+        unsigned long   Height;         // Heightmap height (samples)
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : Convolve ()
+    // Desc : Weighted sum of 'Taps' source rows, 'Count' samples wide. Row
+    //        'k' is multiplied by the k'th weight. Used by both passes, the
+    //        horizontal pass simply supplies consecutive offsets in to a
+    //        single padded row.
+    //-------------------------------------------------------------------------
+    void Convolve( const float * const * ppRows, const float * pWeights, unsigned long Taps, float * pDest, unsigned long Count )
+    {
+        unsigned long x = 0, k;
+
+#if defined(HEIGHTMAPFILTER_SSE)
+        // 8 samples at a time, two independent accumulators
+        for ( ; x + 8 <= Count; x += 8 )
+        {
+            __m128 Sum0 = _mm_setzero_ps(), Sum1 = _mm_setzero_ps();
+            for ( k = 0; k < Taps; ++k )
+            {
+                __m128 Weight = _mm_set1_ps( pWeights[k] );
+                Sum0 = _mm_add_ps( Sum0, _mm_mul_ps( Weight, _mm_loadu_ps( ppRows[k] + x ) ) );
+                Sum1 = _mm_add_ps( Sum1, _mm_mul_ps( Weight, _mm_loadu_ps( ppRows[k] + x + 4 ) ) );
+
+            } // Next Tap
+            _mm_storeu_ps( pDest + x,     Sum0 );
+            _mm_storeu_ps( pDest + x + 4, Sum1 );
+
+        } // Next 8 Samples
+#endif
+
+        // Remaining samples
+        for ( ; x < Count; ++x )
+        {
+            float Sum = 0.0f;
+            for ( k = 0; k < Taps; ++k ) Sum += pWeights[k] * ppRows[k][x];
+            pDest[x] = Sum;
+
+        } // Next Sample
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : HorizontalTask ()
+    // Desc : Filter a band of rows along X. Each row is copied in to a padded
+    //        buffer with its end samples repeated, so that every output sample
+    //        can be produced by the same (unclamped) loop.
+    //-------------------------------------------------------------------------
+    void HorizontalTask( void * pContext, unsigned long Band )
+    {
+        const FILTERPASS & Pass = *(const FILTERPASS*)pContext;
+        unsigned long  Radius   = Pass.Radius, Width = Pass.Width, Taps = Radius * 2 + 1;
+        unsigned long  zStart   = Band * FILTER_BAND_ROWS, zEnd = zStart + FILTER_BAND_ROWS;
+        const float  * ppRows[ MAX_FILTER_RADIUS * 2 + 1 ];
+        float        * pPadded  = new float[ Width + Radius * 2 ];
+        unsigned long  x, z, k;
+
+        if ( zEnd > Pass.Height ) zEnd = Pass.Height;
+
+        // Each tap reads the padded row one sample further along
+        for ( k = 0; k < Taps; ++k ) ppRows[k] = pPadded + k;
+
+        for ( z = zStart; z < zEnd; ++z )
+        {
+            const float * pRow = Pass.pSource + z * Width;
+
+            // Build the padded row (clamp to the edge samples)
+            memcpy( pPadded + Radius, pRow, Width * sizeof(float) );
+            for ( x = 0; x < Radius; ++x )
+            {
+                pPadded[ x ] = pRow[ 0 ];
+                pPadded[ Radius + Width + x ] = pRow[ Width - 1 ];
+
+            } // Next Pad Sample
+
+            Convolve( ppRows, Pass.pWeights, Taps, Pass.pDest + z * Width, Width );
+
+        } // Next Row
+
+        delete []pPadded;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : VerticalTask ()
+    // Desc : Filter a band of rows along Z, from the horizontally filtered
+    //        samples back in to the heightmap. Only the interior is written,
+    //        the heightmap still holds the original outer ring of samples.
+    //-------------------------------------------------------------------------
+    void VerticalTask( void * pContext, unsigned long Band )
+    {
+        const FILTERPASS & Pass = *(const FILTERPASS*)pContext;
+        unsigned long  Radius   = Pass.Radius, Width = Pass.Width, Taps = Radius * 2 + 1;
+        unsigned long  zStart   = Band * FILTER_BAND_ROWS, zEnd = zStart + FILTER_BAND_ROWS;
+        const float  * ppRows[ MAX_FILTER_RADIUS * 2 + 1 ];
+        unsigned long  z, k;
+        long           Row;
+
+        // Skip the first and last rows
+        if ( zStart < 1 ) zStart = 1;
+        if ( zEnd > Pass.Height - 1 ) zEnd = Pass.Height - 1;
+
+        for ( z = zStart; z < zEnd; ++z )
+        {
+            // Select the source rows for each tap (clamp to the edge rows)
+            for ( k = 0; k < Taps; ++k )
+            {
+                Row = (long)z + (long)k - (long)Radius;
+                if ( Row < 0 ) Row = 0;
+                if ( Row > (long)Pass.Height - 1 ) Row = (long)Pass.Height - 1;
+                ppRows[k] = Pass.pSource + Row * Width + 1;
+
+            } // Next Tap
+
+            // Skip the first and last columns
+            Convolve( ppRows, Pass.pWeights, Taps, Pass.pDest + z * Width + 1, Width - 2 );
+
+        } // Next Row
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CHeightMapFilter () (Constructor)
+// Desc : CHeightMapFilter Class Constructor
+//-----------------------------------------------------------------------------
+CHeightMapFilter::CHeightMapFilter()
+{
+    // Default to the original 3x3 box filter
+    SetFilter( FILTER_BOX, 1, 1 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CHeightMapFilter () (Destructor)
+// Desc : CHeightMapFilter Class Destructor
+//-----------------------------------------------------------------------------
+CHeightMapFilter::~CHeightMapFilter()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : ParseType () (Static)
+// Desc : Convert a filter name from a terrain definition file ("none", "box"
+//        or "gaussian") in to the matching filter type.
+//-----------------------------------------------------------------------------
+bool CHeightMapFilter::ParseType( const char * pString, FILTERTYPE & Type )
+{
+    // Skip any leading white space
+    while ( *pString == ' ' || *pString == '\t' ) pString++;
+
+    if ( _stricmp( pString, "none" ) == 0 )
+        Type = FILTER_NONE;
+    else if ( *pString == '\0' || _stricmp( pString, "box" ) == 0 )
+        Type = FILTER_BOX;
+    else if ( _stricmp( pString, "gaussian" ) == 0 )
+        Type = FILTER_GAUSSIAN;
+    else
+        return false;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFilter ()
+// Desc : Select the filter type and build its kernel. 'Sigma' is only used by
+//        the Gaussian filter, a value of 0 selects Radius / 2.
+//-----------------------------------------------------------------------------
+bool CHeightMapFilter::SetFilter( FILTERTYPE Type, unsigned long Radius, unsigned long Iterations, float Sigma )
+{
+    unsigned long i, Taps = Radius * 2 + 1;
+    float         Total = 0.0f;
+
+    // Validate Parameters
+    if ( Type != FILTER_NONE && (Radius < 1 || Radius > MAX_FILTER_RADIUS) ) return false;
+    if ( Sigma < 0.0f ) return false;
+
+    // Store the settings
+    m_Type        = Type;
+    m_nRadius     = (Type == FILTER_NONE) ? 0 : Radius;
+    m_nIterations = (Type == FILTER_NONE) ? 0 : Iterations;
+    memset( m_fWeights, 0, sizeof(m_fWeights) );
+    if ( Type == FILTER_NONE ) return true;
+
+    // Build the kernel
+    if ( Sigma == 0.0f ) Sigma = (float)Radius * 0.5f;
+    for ( i = 0; i < Taps; ++i )
+    {
+        float Offset = (float)i - (float)Radius;
+        m_fWeights[i] = (Type == FILTER_BOX) ? 1.0f : expf( -(Offset * Offset) / (2.0f * Sigma * Sigma) );
+        Total += m_fWeights[i];
+
+    } // Next Tap
+
+    // Normalize so that flat areas stay at the same height
+    for ( i = 0; i < Taps; ++i ) m_fWeights[i] /= Total;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Apply ()
+// Desc : Filter the heightmap in place. If a thread pool is passed, the rows
+//        of each pass are distributed between its threads.
+// Note : Requires one temporary copy of the heightmap.
+//-----------------------------------------------------------------------------
+bool CHeightMapFilter::Apply( float * pData, unsigned long Width, unsigned long Height, CThreadPool * pPool ) const
+{
+    unsigned long i, BandCount;
+    FILTERPASS    Horizontal, Vertical;
+
+    // Validate Parameters
+    if ( !pData ) return false;
+    if ( m_Type == FILTER_NONE || m_nIterations == 0 ) return true;
+
+    // Nothing to filter without an interior
+    if ( Width < 3 || Height < 3 ) return true;
+
+    // Allocate the horizontally filtered intermediate
+    float * pTemp = new float[ Width * Height ];
+    if ( !pTemp ) return false;
+
+    // Describe the two passes
+    Horizontal.pSource  = pData;
+    Horizontal.pDest    = pTemp;
+    Horizontal.pWeights = m_fWeights;
+    Horizontal.Radius   = m_nRadius;
+    Horizontal.Width    = Width;
+    Horizontal.Height   = Height;
+    Vertical            = Horizontal;
+    Vertical.pSource    = pTemp;
+    Vertical.pDest      = pData;
+
+    BandCount = (Height + FILTER_BAND_ROWS - 1) / FILTER_BAND_ROWS;
+
+    // Run each iteration (the vertical pass can only start once every row
+    // has been filtered horizontally)
+    for ( i = 0; i < m_nIterations; ++i )
+    {
+        if ( pPool )
+        {
+            pPool->Dispatch( HorizontalTask, &Horizontal, BandCount );
+            pPool->Dispatch( VerticalTask, &Vertical, BandCount );
+
+        } // End if threaded
+        else
+        {
+            unsigned long Band;
+            for ( Band = 0; Band < BandCount; ++Band ) HorizontalTask( &Horizontal, Band );
+            for ( Band = 0; Band < BandCount; ++Band ) VerticalTask( &Vertical, Band );
+
+        } // End if single threaded
+
+    } // Next Iteration
+
+    // Clean up
+    delete []pTemp;
+
+    // Success!
+    return true;
+}
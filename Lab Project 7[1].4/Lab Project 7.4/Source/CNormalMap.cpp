@@ -0,0 +1,253 @@
+//-----------------------------------------------------------------------------
+// File: CNormalMap.cpp
+//
+// Desc: Precomputed heightmap normals. Every normal is generated up front
+//       (four at a time with SSE, with bands of rows spread across a thread
+//       pool) and stored packed, so that looking one up is a couple of loads.
+//       Regions can be regenerated after the heightmap is modified.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CNormalMap Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CNormalMap.h"
+
+#if defined(NORMALMAP_SSE)
+    #include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : NORMALPASS (Struct)
+    // Desc : Everything a thread pool task needs to generate its band of rows.
+    //-------------------------------------------------------------------------
+    struct NORMALPASS
+    {
+        const float   * pHeightMap;     // Source samples
+        short         * pNormals;       // Packed normals written
+        unsigned long   Width;          // Heightmap width (samples)
+        unsigned long   Height;         // Heightmap height (samples)
+        unsigned long   StartX;         // First column generated
+        unsigned long   EndX;           // One past the last column generated
+        unsigned long   StartZ;         // First row generated
+        unsigned long   EndZ;           // One past the last row generated
+        float           FactorX;        // Multiplies the x slope in to the normal's x
+        float           FactorZ;        // Multiplies the z slope in to the normal's z
+        float           YSquared;       // Square of the normal's (unnormalized) y
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : PackComponent ()
+    // Desc : Round a normal component to 16 bits, exactly as the SSE path does
+    //        so that either may generate any normal.
+    //-------------------------------------------------------------------------
+    inline short PackComponent( float Value )
+    {
+#if defined(NORMALMAP_SSE)
+        return (short)_mm_cvtss_si32( _mm_set_ss( Value * 32767.0f ) );
+#else
+        // Biased positive so truncation rounds, without a branch on the sign
+        return (short)( (long)( Value * 32767.0f + 32768.5f ) - 32768 );
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GenerateRow ()
+    // Desc : Generate the normals between StartX and EndX of a single row.
+    //        The normal of the sample is the cross product of the edges to
+    //        the neighbours below and to the right, which reduces to
+    //        ( -sz * sy * dx, sx * sz, -sx * sy * dz ) before normalizing.
+    //-------------------------------------------------------------------------
+    void GenerateRow( const NORMALPASS & Pass, unsigned long z )
+    {
+        const float   * pRow   = Pass.pHeightMap + z * Pass.Width;
+        const float   * pBelow = ( z < Pass.Height - 1 ) ? pRow + Pass.Width : pRow - Pass.Width;
+        short         * pOut   = Pass.pNormals + z * Pass.Width * 2;
+        unsigned long   x      = Pass.StartX, Interior = Pass.Width - 1;
+        float           nx, nz, Length;
+
+        // Everything before the last column reads the sample to its right
+        if ( Interior > Pass.EndX ) Interior = Pass.EndX;
+
+#if defined(NORMALMAP_SSE)
+        const __m128 FactorX  = _mm_set1_ps( Pass.FactorX );
+        const __m128 FactorZ  = _mm_set1_ps( Pass.FactorZ );
+        const __m128 YSquared = _mm_set1_ps( Pass.YSquared );
+        const __m128 Range    = _mm_set1_ps( 32767.0f );
+
+        for ( ; x + 4 <= Interior; x += 4 )
+        {
+            __m128 y   = _mm_loadu_ps( pRow + x );
+            __m128 NX  = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( pRow + x + 1 ), y ), FactorX );
+            __m128 NZ  = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( pBelow + x ), y ), FactorZ );
+            __m128 Len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( NX, NX ), YSquared ), _mm_mul_ps( NZ, NZ ) ) );
+
+            // Normalize, round & interleave the x / z pairs
+            __m128i PackX = _mm_cvtps_epi32( _mm_mul_ps( _mm_div_ps( NX, Len ), Range ) );
+            __m128i PackZ = _mm_cvtps_epi32( _mm_mul_ps( _mm_div_ps( NZ, Len ), Range ) );
+            PackX = _mm_packs_epi32( PackX, PackX );
+            PackZ = _mm_packs_epi32( PackZ, PackZ );
+            _mm_storeu_si128( (__m128i*)(pOut + x * 2), _mm_unpacklo_epi16( PackX, PackZ ) );
+
+        } // Next 4 Samples
+#endif
+
+        // Remaining samples (and the last column, which reads to its left)
+        for ( ; x < Pass.EndX; ++x )
+        {
+            float y = pRow[x];
+            nx      = ( ( x < Pass.Width - 1 ) ? pRow[x + 1] - y : pRow[x - 1] - y ) * Pass.FactorX;
+            nz      = ( pBelow[x] - y ) * Pass.FactorZ;
+            Length  = sqrtf( (nx * nx + Pass.YSquared) + nz * nz );
+            pOut[ x * 2     ] = PackComponent( nx / Length );
+            pOut[ x * 2 + 1 ] = PackComponent( nz / Length );
+
+        } // Next Sample
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GenerateTask ()
+    // Desc : Thread pool task, generate one band of rows.
+    //-------------------------------------------------------------------------
+    void GenerateTask( void * pContext, unsigned long Band )
+    {
+        const NORMALPASS & Pass = *(const NORMALPASS*)pContext;
+        unsigned long z    = Pass.StartZ + Band * NORMALMAP_BAND_ROWS;
+        unsigned long zEnd = z + NORMALMAP_BAND_ROWS;
+
+        if ( zEnd > Pass.EndZ ) zEnd = Pass.EndZ;
+        for ( ; z < zEnd; ++z ) GenerateRow( Pass, z );
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CNormalMap () (Constructor)
+// Desc : CNormalMap Class Constructor
+//-----------------------------------------------------------------------------
+CNormalMap::CNormalMap()
+{
+    // Reset all required values
+    m_pHeightMap = NULL;
+    m_pNormals   = NULL;
+    m_nWidth     = 0;
+    m_nHeight    = 0;
+    m_fScale[0]  = m_fScale[1] = m_fScale[2] = 1.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CNormalMap () (Destructor)
+// Desc : CNormalMap Class Destructor
+//-----------------------------------------------------------------------------
+CNormalMap::~CNormalMap()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Free the normals.
+//-----------------------------------------------------------------------------
+void CNormalMap::Release()
+{
+    if ( m_pNormals ) delete []m_pNormals;
+
+    m_pHeightMap = NULL;
+    m_pNormals   = NULL;
+    m_nWidth     = 0;
+    m_nHeight    = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : Generate the normal of every sample in the heightmap.
+// Note : The heightmap must be at least 2 x 2 samples.
+//-----------------------------------------------------------------------------
+bool CNormalMap::Build( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3], CThreadPool * pPool )
+{
+    // Validate parameters
+    Release();
+    if ( !pHeightMap || Width < 2 || Height < 2 ) return false;
+
+    // Allocate the packed normals
+    m_pNormals = new short[ Width * Height * 2 ];
+    if ( !m_pNormals ) return false;
+
+    // Store the source
+    m_pHeightMap = pHeightMap;
+    m_nWidth     = Width;
+    m_nHeight    = Height;
+    m_fScale[0]  = Scale[0];
+    m_fScale[1]  = Scale[1];
+    m_fScale[2]  = Scale[2];
+
+    // Generate everything
+    Generate( 0, 0, Width, Height, pPool );
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Regenerate the normals affected by a change to the heightmap samples
+//        between (MinX, MinZ) and (MaxX, MaxZ) inclusive.
+// Note : A sample is read by the normals of its neighbours above and to the
+//        left (and on the far side of the last row / column), so the region
+//        is grown by one sample in each direction.
+//-----------------------------------------------------------------------------
+void CNormalMap::Update( unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ, CThreadPool * pPool )
+{
+    // Validate parameters
+    if ( !m_pNormals || MinX > MaxX || MinZ > MaxZ || MinX >= m_nWidth || MinZ >= m_nHeight ) return;
+
+    // Grow the region, clamped to the map (end values are exclusive)
+    if ( MinX > 0 ) MinX--;
+    if ( MinZ > 0 ) MinZ--;
+    MaxX = ( MaxX + 2 < m_nWidth  ) ? MaxX + 2 : m_nWidth;
+    MaxZ = ( MaxZ + 2 < m_nHeight ) ? MaxZ + 2 : m_nHeight;
+
+    Generate( MinX, MinZ, MaxX, MaxZ, pPool );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Generate () (Private)
+// Desc : Generate the normals of the columns StartX to EndX (exclusive) on
+//        the rows StartZ to EndZ (exclusive).
+//-----------------------------------------------------------------------------
+void CNormalMap::Generate( unsigned long StartX, unsigned long StartZ, unsigned long EndX, unsigned long EndZ, CThreadPool * pPool )
+{
+    NORMALPASS    Pass;
+    unsigned long Band, BandCount;
+    float         y = m_fScale[0] * m_fScale[2];
+
+    // Describe the pass
+    Pass.pHeightMap = m_pHeightMap;
+    Pass.pNormals   = m_pNormals;
+    Pass.Width      = m_nWidth;
+    Pass.Height     = m_nHeight;
+    Pass.StartX     = StartX;
+    Pass.EndX       = EndX;
+    Pass.StartZ     = StartZ;
+    Pass.EndZ       = EndZ;
+    Pass.FactorX    = -m_fScale[2] * m_fScale[1];
+    Pass.FactorZ    = -m_fScale[0] * m_fScale[1];
+    Pass.YSquared   = y * y;
+
+    // Spread the bands across the pool if we have one
+    BandCount = (EndZ - StartZ + NORMALMAP_BAND_ROWS - 1) / NORMALMAP_BAND_ROWS;
+    if ( pPool && BandCount > 1 )
+    {
+        pPool->Dispatch( GenerateTask, &Pass, BandCount );
+
+    } // End if threaded
+    else
+    {
+        for ( Band = 0; Band < BandCount; ++Band ) GenerateTask( &Pass, Band );
+
+    } // End if single threaded
+}
@@ -13,6 +13,7 @@
 #include "..\\Includes\\CPlayer.h"
 #include "..\\Includes\\CCamera.h"
 #include "..\\Includes\\CObject.h"
+#include "..\\Includes\\CProfiler.h"
 
 //-----------------------------------------------------------------------------
 // Name : CPlayer () (Constructor)
@@ -44,6 +45,14 @@ CPlayer::CPlayer()
     m_fMaxVelocityY      = 125.0f;
     m_fFriction          = 250.0f;
 
+    // Fixed time step values, variable time step by default
+    m_fStepRate          = 0.0f;
+    m_fAccumulator       = 0.0f;
+    m_fInterpolation     = 1.0f;
+    m_vecPrevPos         = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_vecPrevCamPos      = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_vecRenderOffset    = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+
     // Default volume information
     m_Volume.Min         = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
     m_Volume.Max         = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );    
@@ -128,6 +137,7 @@ void CPlayer::SetCamOffset( const D3DXVECTOR3& Offset )
 //-----------------------------------------------------------------------------
 void CPlayer::Update( float TimeScale )
 {
+    PROFILE_ZONE( "CPlayer::Update" );
     ULONG i;
 
     // Add on our gravity vector
@@ -209,6 +219,75 @@ void CPlayer::Update( float TimeScale )
 
 }
 
+//-----------------------------------------------------------------------------
+// Name : Advance ()
+// Desc : Advance the simulation by the time elapsed since the last frame. With
+//        a variable time step this is a single call to 'Update'. With a fixed
+//        time step the elapsed time is accumulated and 'Update' called once
+//        for every whole step, the player and camera then being rendered at an
+//        interpolated point between the last two simulated states.
+// Note : Returns the number of simulation steps that were taken.
+//-----------------------------------------------------------------------------
+ULONG CPlayer::Advance( float TimeElapsed )
+{
+    ULONG Steps = 0;
+
+    // Variable time step ?
+    if ( m_fStepRate <= 0.0f ) { Update( TimeElapsed ); return 1; }
+
+    // Validate requirements
+    if (!m_pCamera) return 0;
+
+    float fStep = 1.0f / m_fStepRate;
+
+    // Simulate as many whole steps as have elapsed
+    m_fAccumulator += TimeElapsed;
+    while ( m_fAccumulator >= fStep )
+    {
+        // If we can't keep up, drop the time rather than fall further behind
+        if ( Steps == MAX_SIMULATION_STEPS ) { m_fAccumulator = fmodf( m_fAccumulator, fStep ); break; }
+
+        // Store the state we are stepping away from
+        m_vecPrevPos    = m_vecPos;
+        m_vecPrevCamPos = m_pCamera->GetPosition();
+
+        Update( fStep );
+        m_fAccumulator -= fStep;
+        Steps++;
+
+    } // Next Step
+
+    // Render between the previous and current states, based on the time left over
+    m_fInterpolation  = m_fAccumulator / fStep;
+    m_vecRenderOffset = (m_vecPrevPos - m_vecPos) * (1.0f - m_fInterpolation);
+    m_pCamera->SetRenderOffset( (m_vecPrevCamPos - m_pCamera->GetPosition()) * (1.0f - m_fInterpolation) );
+
+    // Return number of steps taken
+    return Steps;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFixedStepRate ()
+// Desc : Set the number of simulation steps per second used by 'Advance'.
+// Note : Specify 0 to return to a variable time step.
+//-----------------------------------------------------------------------------
+void CPlayer::SetFixedStepRate( float StepRate )
+{
+    m_fStepRate      = ( StepRate > 0.0f ) ? StepRate : 0.0f;
+    m_fAccumulator   = 0.0f;
+    m_fInterpolation = 1.0f;
+
+    // Start from the current state, nothing to interpolate yet
+    m_vecPrevPos      = m_vecPos;
+    m_vecRenderOffset = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    if ( m_pCamera )
+    {
+        m_vecPrevCamPos = m_pCamera->GetPosition();
+        m_pCamera->SetRenderOffset( m_vecRenderOffset );
+
+    } // End if camera available
+}
+
 //-----------------------------------------------------------------------------
 // Name : SetCameraMode ()
 // Desc : Sets the camera type we are using to view the player.
@@ -282,6 +361,9 @@ bool CPlayer::SetCameraMode( ULONG Mode )
     if ( m_pCamera ) delete m_pCamera;
     m_pCamera = pNewCamera;
 
+    // The new camera has no previous state to interpolate from
+    m_vecPrevCamPos = m_pCamera->GetPosition();
+
     // Success!!
     return true;
 }
@@ -531,9 +613,9 @@ void CPlayer::Render( LPDIRECT3DDEVICE9 pDevice )
 	pMatrix->_12 = m_vecRight.y; pMatrix->_22 = m_vecUp.y; pMatrix->_32 = m_vecLook.y;
 	pMatrix->_13 = m_vecRight.z; pMatrix->_23 = m_vecUp.z; pMatrix->_33 = m_vecLook.z;
 
-    pMatrix->_41 = m_vecPos.x;
-    pMatrix->_42 = m_vecPos.y - 10.0f;
-    pMatrix->_43 = m_vecPos.z;
+    pMatrix->_41 = m_vecPos.x + m_vecRenderOffset.x;
+    pMatrix->_42 = m_vecPos.y + m_vecRenderOffset.y - 10.0f;
+    pMatrix->_43 = m_vecPos.z + m_vecRenderOffset.z;
 
     // Render our player mesh object
     CMesh * pMesh = pObject->m_pMesh;
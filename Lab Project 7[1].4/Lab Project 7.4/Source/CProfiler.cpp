@@ -0,0 +1,437 @@
+//-----------------------------------------------------------------------------
+// File: CProfiler.cpp
+//
+// Desc: Lightweight hierarchical CPU profiler. Code is instrumented with
+//       scoped zones (PROFILE_ZONE) which record their start time and
+//       duration into a buffer owned by the calling thread, so recording
+//       never takes a lock. At the end of each frame (PROFILE_FRAME) the
+//       zones are summarised by name, and a captured run can be exported in
+//       the Chrome trace_event format (chrome://tracing or Perfetto).
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CProfiler Specific Includes
+//-----------------------------------------------------------------------------
+#include "..\\Includes\\CProfiler.h"
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <time.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define PROFILER_TLS __declspec(thread)
+#else
+    #define PROFILER_TLS __thread
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Types, Variables & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : PROFILEEVENT (Struct)
+    // Desc : A single completed zone.
+    //-------------------------------------------------------------------------
+    struct PROFILEEVENT
+    {
+        const char    * Name;           // Zone name
+        PROFILETIME     Start;          // Counter value on entry
+        PROFILETIME     Duration;       // Inclusive duration (counter ticks)
+        PROFILETIME     Self;           // Duration less nested zones (counter ticks)
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : PROFILETHREAD (Struct)
+    // Desc : Everything recorded by one thread. Only ever written by the
+    //        owning thread.
+    //-------------------------------------------------------------------------
+    struct PROFILETHREAD
+    {
+        unsigned long   Id;             // Sequential thread number (trace 'tid')
+        unsigned long   EventCount;     // Number of events held
+        unsigned long   FrameStart;     // First event belonging to the current frame
+        unsigned long   Dropped;        // Events lost because the buffer was full
+        unsigned long   Depth;          // Number of zones currently open
+        PROFILETIME     ChildTime[MAX_PROFILE_DEPTH]; // Time spent in nested zones, per open zone
+        PROFILEEVENT    Events[MAX_PROFILE_EVENTS];
+    };
+
+    PROFILER_TLS PROFILETHREAD * g_pThreadData = NULL;      // The calling thread's buffer
+    PROFILETHREAD * g_pThreads[MAX_PROFILE_THREADS];        // Every registered buffer
+    unsigned long   g_nThreadCount  = 0;
+    bool            g_bCapture      = false;                // Keep events for export
+    unsigned long   g_nFrameIndex   = 0;
+    PROFILETIME     g_Frequency     = 1000000000;           // Counter ticks per second
+    PROFILETIME     g_Epoch         = 0;                    // Counter value at start up
+
+    CProfiler::ZONESUMMARY g_Summary[MAX_PROFILE_ZONES];    // Summary of the last frame
+    unsigned long   g_nSummaryCount = 0;
+
+#if defined(_WIN32)
+    CRITICAL_SECTION g_Lock;
+#else
+    pthread_mutex_t  g_Lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+    //-------------------------------------------------------------------------
+    // Name : QueryCounter ()
+    // Desc : Sample the highest resolution counter available.
+    //-------------------------------------------------------------------------
+    inline PROFILETIME QueryCounter( )
+    {
+#if defined(_WIN32)
+        LARGE_INTEGER Counter;
+        QueryPerformanceCounter( &Counter );
+        return Counter.QuadPart;
+#else
+        timespec Now;
+        clock_gettime( CLOCK_MONOTONIC, &Now );
+        return (PROFILETIME)Now.tv_sec * 1000000000 + Now.tv_nsec;
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CProfilerState (Class)
+    // Desc : Sets up the shared state at start up, and frees the thread
+    //        buffers on exit.
+    //-------------------------------------------------------------------------
+    class CProfilerState
+    {
+    public:
+        CProfilerState( )
+        {
+#if defined(_WIN32)
+            LARGE_INTEGER Frequency;
+            InitializeCriticalSection( &g_Lock );
+            if ( QueryPerformanceFrequency( &Frequency ) ) g_Frequency = Frequency.QuadPart;
+#endif
+            g_Epoch = QueryCounter();
+        }
+
+        ~CProfilerState( )
+        {
+            for ( unsigned long i = 0; i < g_nThreadCount; i++ ) delete g_pThreads[i];
+            g_nThreadCount = 0;
+#if defined(_WIN32)
+            DeleteCriticalSection( &g_Lock );
+#endif
+        }
+
+    } g_State;
+
+    //-------------------------------------------------------------------------
+    // Name : Lock () / Unlock ()
+    // Desc : Guard the thread table.
+    //-------------------------------------------------------------------------
+    inline void Lock( )
+    {
+#if defined(_WIN32)
+        EnterCriticalSection( &g_Lock );
+#else
+        pthread_mutex_lock( &g_Lock );
+#endif
+    }
+
+    inline void Unlock( )
+    {
+#if defined(_WIN32)
+        LeaveCriticalSection( &g_Lock );
+#else
+        pthread_mutex_unlock( &g_Lock );
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RegisterThread ()
+    // Desc : Create and register the calling thread's buffer (on its first
+    //        zone). Returns NULL if no more threads can be tracked.
+    //-------------------------------------------------------------------------
+    PROFILETHREAD * RegisterThread( )
+    {
+        PROFILETHREAD * pThread = NULL;
+
+        Lock();
+        if ( g_nThreadCount < MAX_PROFILE_THREADS )
+        {
+            pThread = new PROFILETHREAD;
+            memset( pThread, 0, sizeof(PROFILETHREAD) - sizeof(pThread->Events) );
+            pThread->Id = g_nThreadCount;
+            g_pThreads[ g_nThreadCount++ ] = pThread;
+
+        } // End if room
+        Unlock();
+
+        return pThread;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : WriteJSONString ()
+    // Desc : Write a quoted, escaped string.
+    //-------------------------------------------------------------------------
+    void WriteJSONString( FILE * pFile, const char * pString )
+    {
+        fputc( '"', pFile );
+        for ( ; *pString; pString++ )
+        {
+            if ( *pString == '"' || *pString == '\\' ) fputc( '\\', pFile );
+            if ( (unsigned char)*pString >= 0x20 ) fputc( *pString, pFile );
+
+        } // Next Character
+        fputc( '"', pFile );
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : BeginZone () (Static)
+// Desc : Called on entry to a zone, returns the entry time.
+//-----------------------------------------------------------------------------
+PROFILETIME CProfiler::BeginZone( )
+{
+    PROFILETHREAD * pThread = g_pThreadData;
+
+    // First zone on this thread?
+    if ( !pThread ) pThread = g_pThreadData = RegisterThread();
+
+    // Open a new nesting level
+    if ( pThread )
+    {
+        if ( pThread->Depth < MAX_PROFILE_DEPTH ) pThread->ChildTime[ pThread->Depth ] = 0;
+        pThread->Depth++;
+
+    } // End if registered
+
+    return QueryCounter();
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndZone () (Static)
+// Desc : Called on exit from a zone, records the completed event.
+//-----------------------------------------------------------------------------
+void CProfiler::EndZone( const char * pName, PROFILETIME Start )
+{
+    PROFILETIME     Duration = QueryCounter() - Start, Self = Duration;
+    PROFILETHREAD * pThread  = g_pThreadData;
+
+    if ( !pThread || pThread->Depth == 0 ) return;
+
+    // Close this level, and charge our time to the parent
+    pThread->Depth--;
+    if ( pThread->Depth < MAX_PROFILE_DEPTH ) Self -= pThread->ChildTime[ pThread->Depth ];
+    if ( pThread->Depth > 0 && pThread->Depth <= MAX_PROFILE_DEPTH ) pThread->ChildTime[ pThread->Depth - 1 ] += Duration;
+
+    // Store the event
+    if ( pThread->EventCount < MAX_PROFILE_EVENTS )
+    {
+        PROFILEEVENT * pEvent = &pThread->Events[ pThread->EventCount++ ];
+        pEvent->Name     = pName;
+        pEvent->Start    = Start;
+        pEvent->Duration = Duration;
+        pEvent->Self     = Self;
+
+    } // End if room
+    else
+    {
+        pThread->Dropped++;
+
+    } // End if full
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndFrame () (Static)
+// Desc : Summarise every zone recorded since the previous call. Unless a
+//        trace is being captured, the buffers are then emptied.
+//-----------------------------------------------------------------------------
+void CProfiler::EndFrame( )
+{
+    double fScale = 1000.0 / (double)g_Frequency;
+    unsigned long i, j, k;
+
+    g_nSummaryCount = 0;
+
+    Lock();
+    for ( i = 0; i < g_nThreadCount; i++ )
+    {
+        PROFILETHREAD * pThread = g_pThreads[i];
+
+        for ( j = pThread->FrameStart; j < pThread->EventCount; j++ )
+        {
+            const PROFILEEVENT & Event = pThread->Events[j];
+            ZONESUMMARY * pZone = NULL;
+            double fDuration = Event.Duration * fScale;
+
+            // Find this zone's entry (the same literal may live at different addresses)
+            for ( k = 0; k < g_nSummaryCount; k++ )
+            {
+                if ( g_Summary[k].Name == Event.Name || strcmp( g_Summary[k].Name, Event.Name ) == 0 ) { pZone = &g_Summary[k]; break; }
+
+            } // Next Zone
+
+            // Add a new one if required
+            if ( !pZone )
+            {
+                if ( g_nSummaryCount == MAX_PROFILE_ZONES ) continue;
+                pZone = &g_Summary[ g_nSummaryCount++ ];
+                memset( pZone, 0, sizeof(ZONESUMMARY) );
+                pZone->Name = Event.Name;
+
+            } // End if new zone
+
+            pZone->Calls++;
+            pZone->Total += fDuration;
+            pZone->Self  += Event.Self * fScale;
+            if ( fDuration > pZone->Max ) pZone->Max = fDuration;
+
+        } // Next Event
+
+        // Start the next frame
+        if ( !g_bCapture ) pThread->EventCount = 0;
+        pThread->FrameStart = pThread->EventCount;
+
+    } // Next Thread
+    Unlock();
+
+    g_nFrameIndex++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameSummary () (Static)
+// Desc : Retrieve the per zone summary built by the last EndFrame call.
+//        Zones are listed in the order they first completed.
+//-----------------------------------------------------------------------------
+unsigned long CProfiler::GetFrameSummary( const ZONESUMMARY ** ppSummary )
+{
+    if ( ppSummary ) *ppSummary = g_Summary;
+    return g_nSummaryCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameIndex () (Static)
+// Desc : Number of frames ended since start up (or the last Reset).
+//-----------------------------------------------------------------------------
+unsigned long CProfiler::GetFrameIndex( )
+{
+    return g_nFrameIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTraceCapture () (Static)
+// Desc : While capturing, events are kept (until the buffers fill) so that
+//        they can be exported. Otherwise only a frame's worth is held.
+//-----------------------------------------------------------------------------
+void CProfiler::SetTraceCapture( bool bCapture )
+{
+    g_bCapture = bCapture;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetTraceCapture () (Static)
+// Desc : Are events being kept for export?
+//-----------------------------------------------------------------------------
+bool CProfiler::GetTraceCapture( )
+{
+    return g_bCapture;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ExportChromeTrace () (Static)
+// Desc : Write every buffered event as a Chrome trace_event JSON file.
+//-----------------------------------------------------------------------------
+bool CProfiler::ExportChromeTrace( const char * pFileName )
+{
+    double  fScale = 1000000.0 / (double)g_Frequency;
+    FILE  * pFile;
+    bool    bFirst = true;
+    unsigned long i, j;
+
+    // Open the file
+    pFile = fopen( pFileName, "w" );
+    if ( !pFile ) return false;
+
+    fprintf( pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+    Lock();
+    for ( i = 0; i < g_nThreadCount; i++ )
+    {
+        const PROFILETHREAD * pThread = g_pThreads[i];
+
+        // Name the thread
+        fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"Thread %lu\"}}",
+                 bFirst ? "" : ",\n", pThread->Id, pThread->Id );
+        bFirst = false;
+
+        // Complete ('X') events, timestamps in microseconds
+        for ( j = 0; j < pThread->EventCount; j++ )
+        {
+            const PROFILEEVENT & Event = pThread->Events[j];
+
+            fprintf( pFile, ",\n{\"name\":" );
+            WriteJSONString( pFile, Event.Name );
+            fprintf( pFile, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                     pThread->Id, (Event.Start - g_Epoch) * fScale, Event.Duration * fScale );
+
+        } // Next Event
+
+    } // Next Thread
+    Unlock();
+
+    fprintf( pFile, "\n]}\n" );
+
+    // Success?
+    return ( fclose( pFile ) == 0 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetDroppedCount () (Static)
+// Desc : Number of events lost because a thread's buffer was full.
+//-----------------------------------------------------------------------------
+unsigned long CProfiler::GetDroppedCount( )
+{
+    unsigned long Dropped = 0;
+
+    Lock();
+    for ( unsigned long i = 0; i < g_nThreadCount; i++ ) Dropped += g_pThreads[i]->Dropped;
+    Unlock();
+
+    return Dropped;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reset () (Static)
+// Desc : Discard everything recorded so far.
+//-----------------------------------------------------------------------------
+void CProfiler::Reset( )
+{
+    Lock();
+    for ( unsigned long i = 0; i < g_nThreadCount; i++ )
+    {
+        g_pThreads[i]->EventCount = 0;
+        g_pThreads[i]->FrameStart = 0;
+        g_pThreads[i]->Dropped    = 0;
+
+    } // Next Thread
+    Unlock();
+
+    g_nSummaryCount = 0;
+    g_nFrameIndex   = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsCompiledIn () (Static)
+// Desc : Were the zone macros compiled in to this build?
+//-----------------------------------------------------------------------------
+bool CProfiler::IsCompiledIn( )
+{
+#if defined(PROFILER_ENABLED)
+    return true;
+#else
+    return false;
+#endif
+}
@@ -15,13 +15,118 @@
 #include "..\\Includes\\CPlayer.h"
 #include "..\\Includes\\CCamera.h"
 #include "..\\Includes\\CGameApp.h"
+#include "..\\Includes\\CProfiler.h"
+#include "..\\Includes\\CHeightMap.h"
 
 //-----------------------------------------------------------------------------
 // Modulate Local Constants
 //-----------------------------------------------------------------------------
 namespace
 {
-    const char DataPath[] = "Data\\";               // The path to the data files.
+    const char  DataPath[]       = "Data\\";        // The path to the data files.
+    const ULONG BlockBatchSize   = 256;             // Blocks staged at a time while loading
+    const UCHAR LayerMinAlpha    = 15;              // Layer weights below this are transparent
+    const UCHAR LayerMaxAlpha    = 220;             // Layer weights above this are opaque
+
+    // Vertex declaration used in compact mode, the shared grid in stream 0
+    // and each block's CCompactVertex data in stream 1.
+    const D3DVERTEXELEMENT9 CompactDecl[] =
+    {
+        { 0, 0, D3DDECLTYPE_SHORT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+        { 1, 0, D3DDECLTYPE_SHORT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+        D3DDECL_END()
+    };
+
+    // Rebuilds the compact vertices, producing exactly what the fixed function
+    // pipeline produces for the equivalent CVertex.
+    //   c0 - c3 : Transposed view * projection matrix (world is identity)
+    //   c4      : Block origin x, height bias, block origin z
+    //   c5      : Scale x, height step, scale z
+    //   c6      : Block start column, start row, 1 / quads wide, 1 / quads high
+    //   c7, c8  : Layer texture matrix columns (m11, m21, m31) and (m12, m22, m32)
+    //   c9      : 1 / 255, 0, 0, 1
+    const char CompactShader[] =
+        "vs_1_1\n"
+        "dcl_position v0\n"
+        "dcl_texcoord v1\n"
+        "mov r0.x, v0.x\n"
+        "mov r0.y, v1.x\n"
+        "mov r0.z, v0.y\n"
+        "mov r0.w, c9.w\n"
+        "mul r0.xyz, r0, c5\n"
+        "add r0.xyz, r0, c4\n"
+        "dp4 oPos.x, r0, c0\n"
+        "dp4 oPos.y, r0, c1\n"
+        "dp4 oPos.z, r0, c2\n"
+        "dp4 oPos.w, r0, c3\n"
+        "mul oD0.xyz, v1.y, c9.x\n"
+        "mov oD0.w, c9.w\n"
+        "add r1.xy, v0.xy, c6.xy\n"
+        "mov r1.z, c9.w\n"
+        "dp3 oT0.x, r1, c7\n"
+        "dp3 oT0.y, r1, c8\n"
+        "mul oT1.xy, v0.xy, c6.zw\n";
+
+    //-------------------------------------------------------------------------
+    // Name : ClampAlpha ()
+    // Desc : Snap nearly transparent / opaque layer weights to 0 / 255.
+    //-------------------------------------------------------------------------
+    inline UCHAR ClampAlpha( UCHAR Value )
+    {
+        if ( Value < LayerMinAlpha ) return 0;
+        if ( Value > LayerMaxAlpha ) return 255;
+        return Value;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : FetchAlpha ()
+    // Desc : Read a blend map value, or clamp a painted weight as it was
+    //        clamped in to the blend map.
+    //-------------------------------------------------------------------------
+    inline long FetchAlpha( const UCHAR * pMap, long Index, bool Clamp )
+    {
+        return Clamp ? ClampAlpha( pMap[ Index ] ) : pMap[ Index ];
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : EncodeBlend ()
+    // Desc : Convert a layer blend value to an A4R4G4B4 blend texel.
+    //-------------------------------------------------------------------------
+    inline USHORT EncodeBlend( UCHAR Value )
+    {
+        // Shift right 4 and left 12
+        return (USHORT)(((LONG)Value << 8) & 0xF000);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BLOCKBATCH (Struct)
+    // Desc : A batch of blocks being built on the worker threads.
+    //-------------------------------------------------------------------------
+    struct BLOCKBATCH
+    {
+        CTerrain        * pTerrain;         // Parent terrain
+        CTerrainBlock  ** ppBlocks;         // Every block of the terrain
+        ULONG             FirstBlock;       // First block of this batch
+        ULONG             BlocksWide;       // Number of blocks across the terrain
+        ULONG             QuadsWide;        // Quads per block
+        ULONG             QuadsHigh;        // Quads per block
+        volatile long     Failed;           // Set if any block could not be built
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BuildBlockTask ()
+    // Desc : Worker task, builds the CPU side data of one block in a batch.
+    //-------------------------------------------------------------------------
+    void BuildBlockTask( void * pContext, unsigned long TaskIndex )
+    {
+        BLOCKBATCH * pBatch = (BLOCKBATCH*)pContext;
+        ULONG        Index  = pBatch->FirstBlock + TaskIndex;
+        ULONG        x      = Index % pBatch->BlocksWide, z = Index / pBatch->BlocksWide;
+
+        if ( !pBatch->ppBlocks[ Index ]->BuildBlock( pBatch->pTerrain, x * pBatch->QuadsWide, z * pBatch->QuadsHigh,
+                                                    pBatch->QuadsWide + 1, pBatch->QuadsHigh + 1 ) ) pBatch->Failed = 1;
+    }
+
 };
 
 //-----------------------------------------------------------------------------
@@ -52,6 +157,24 @@ CTerrain::CTerrain()
 
     m_vecScale          = D3DXVECTOR3( 1.0f, 1.0f, 1.0f );
 
+    m_bLODEnabled       = true;
+    m_fLODPixelError    = 0.0f;
+    m_nTrianglesDrawn   = 0;
+    m_bStreaming        = false;
+    m_bStreamPrimed     = false;
+    m_pVisible          = NULL;
+    ZeroMemory( &m_CullStats, sizeof(CULLSTATS) );
+    m_bCompactVertices  = false;
+    m_pGridBuffer       = NULL;
+    m_pCompactDecl      = NULL;
+    m_pCompactShader    = NULL;
+    m_bSharedIndices    = false;
+    m_pSharedIndices    = NULL;
+    m_nIndexSwitches    = 0;
+    m_bEditable         = false;
+    m_pDirtyBlocks      = NULL;
+    m_nDirtyCount       = 0;
+
 }
 
 //-----------------------------------------------------------------------------
@@ -70,8 +193,19 @@ CTerrain::~CTerrain()
 //-----------------------------------------------------------------------------
 void CTerrain::Release()
 {
+    // Stop paging blocks in and out
+    m_Pager.Release();
+
+    // Unmap (or abandon) the cooked terrain
+    m_Cache.Close();
+
     // Release Heightmap
     if ( m_pHeightMap ) delete[]m_pHeightMap;
+
+    // Release the culling hierarchy
+    m_QuadTree.Release();
+    if ( m_pVisible ) delete []m_pVisible;
+    if ( m_pDirtyBlocks ) delete []m_pDirtyBlocks;
     
     // Release Blocks
     if ( m_pBlock ) 
@@ -118,9 +252,24 @@ void CTerrain::Release()
     
     } // End if
 
+    // Release the compact vertex resources
+    if ( m_pGridBuffer    ) m_pGridBuffer->Release();
+    if ( m_pCompactDecl   ) m_pCompactDecl->Release();
+    if ( m_pCompactShader ) m_pCompactShader->Release();
+
+    // Release the shared index buffer (blocks have released their references)
+    if ( m_pSharedIndices ) m_pSharedIndices->Release();
+
     // Release our D3D Object ownership
     if ( m_pD3DDevice     ) m_pD3DDevice->Release();
 
+    // Free the precomputed normals & ray cast pyramid
+    m_NormalMap.Release();
+    m_RayCast.Release();
+
+    // Shut down the worker threads
+    m_ThreadPool.Release();
+
     // Clear Variables
     m_pD3DDevice        = NULL;
     m_pHeightMap        = NULL;
@@ -139,6 +288,22 @@ void CTerrain::Release()
     m_nLayerCount       = 0;
     m_pTexture          = NULL;
     m_nTextureCount     = 0;
+    m_fLODPixelError    = 0.0f;
+    m_nTrianglesDrawn   = 0;
+    m_bStreaming        = false;
+    m_bStreamPrimed     = false;
+    m_pVisible          = NULL;
+    ZeroMemory( &m_CullStats, sizeof(CULLSTATS) );
+    m_bCompactVertices  = false;
+    m_pGridBuffer       = NULL;
+    m_pCompactDecl      = NULL;
+    m_pCompactShader    = NULL;
+    m_bSharedIndices    = false;
+    m_pSharedIndices    = NULL;
+    m_nIndexSwitches    = 0;
+    m_bEditable         = false;
+    m_pDirtyBlocks      = NULL;
+    m_nDirtyCount       = 0;
     
 }
 
@@ -162,9 +327,16 @@ void CTerrain::SetTextureFormat( const D3DFORMAT & Format, const D3DFORMAT & Alp
 //-----------------------------------------------------------------------------
 bool CTerrain::LoadTerrain( LPCTSTR DefFile )
 {
-    FILE  * pFile = NULL;
-    char    Buffer  [1025], Section [100], Value[100], FileName[MAX_PATH];
-    ULONG   i;
+    PROFILE_ZONE( "CTerrain::LoadTerrain" );
+    char    Buffer  [1025], Section [100], Value[100], FileName[MAX_PATH], TilePath[MAX_PATH], CachePath[MAX_PATH];
+    ULONG   i, StreamBudget;
+    bool    bCache;
+    TERRAINCACHEKEY CacheKey;
+    float   StreamRadius = 0.0f, StreamPrefetch = 1.0f;
+    CHeightMap::SAMPLEFORMAT HeightFormat;
+    CHeightMapFilter::FILTERTYPE FilterType;
+    ULONG   FilterRadius, FilterIterations;
+    float   FilterSigma = 0.0f;
 
     // Cannot load if already allocated (must be explicitly released for reuse)
     if ( m_pBlock ) return false;
@@ -175,6 +347,8 @@ bool CTerrain::LoadTerrain( LPCTSTR DefFile )
     // Read in the terrain definition values specified by the file
     strcpy( Section, "General" );
     GetPrivateProfileString( Section, "Heightmap", "", FileName, MAX_PATH - 1, DefFile );
+    GetPrivateProfileString( Section, "HeightFormat", "8", Buffer, 1024, DefFile );
+    if ( !CHeightMap::ParseFormat( Buffer, HeightFormat ) ) return false;
     GetPrivateProfileString( Section, "Scale", "1, 1, 1", Buffer, 1024, DefFile );
     sscanf( Buffer, "%g,%g,%g", &m_vecScale.x, &m_vecScale.y, &m_vecScale.z );
     GetPrivateProfileString( Section, "TerrainSize", "257, 257", Buffer, 1024, DefFile );
@@ -183,39 +357,109 @@ bool CTerrain::LoadTerrain( LPCTSTR DefFile )
     sscanf( Buffer, "%i,%i", &m_nBlockWidth, &m_nBlockHeight );
     GetPrivateProfileString( Section, "BlendTexRatio", "1", Buffer, 1024, DefFile );
     sscanf( Buffer, "%i", &m_nBlendTexRatio );
+    GetPrivateProfileString( Section, "Filter", "box", Buffer, 1024, DefFile );
+    if ( !CHeightMapFilter::ParseType( Buffer, FilterType ) ) return false;
+    FilterRadius     = GetPrivateProfileInt( Section, "FilterRadius", 1, DefFile );
+    FilterIterations = GetPrivateProfileInt( Section, "FilterIterations", 1, DefFile );
+    GetPrivateProfileString( Section, "FilterSigma", "0", Buffer, 1024, DefFile );
+    sscanf( Buffer, "%g", &FilterSigma );
+    if ( !m_HeightMapFilter.SetFilter( FilterType, FilterRadius, FilterIterations, FilterSigma ) ) return false;
+    GetPrivateProfileString( Section, "LODPixelError", "4", Buffer, 1024, DefFile );
+    sscanf( Buffer, "%g", &m_fLODPixelError );
+    GetPrivateProfileString( Section, "TileFile", "", Buffer, MAX_PATH - 1, DefFile );
+    m_bStreaming = ( Buffer[0] != '\0' );
+    strcpy( TilePath, DataPath );
+    strcat( TilePath, Buffer );
+    GetPrivateProfileString( Section, "StreamRadius", "0", Buffer, 1024, DefFile );
+    sscanf( Buffer, "%g", &StreamRadius );
+    StreamBudget = GetPrivateProfileInt( Section, "StreamBudget", 256, DefFile );
+    GetPrivateProfileString( Section, "StreamPrefetch", "1", Buffer, 1024, DefFile );
+    sscanf( Buffer, "%g", &StreamPrefetch );
+    m_bCompactVertices = ( GetPrivateProfileInt( Section, "CompactVertices", 0, DefFile ) != 0 );
+    m_bSharedIndices   = ( GetPrivateProfileInt( Section, "SharedIndices", 1, DefFile ) != 0 );
+    m_bEditable        = ( GetPrivateProfileInt( Section, "Editable", 0, DefFile ) != 0 ) && !m_bStreaming;
+    GetPrivateProfileString( Section, "CacheFile", "", Buffer, MAX_PATH - 1, DefFile );
+    bCache = ( Buffer[0] != '\0' ) && !m_bStreaming && !m_bEditable;
+    strcpy( CachePath, DataPath );
+    strcat( CachePath, Buffer );
+
+    // Spin up the worker threads used to build the terrain
+    if ( !m_ThreadPool.Create() ) return false;
 
     // Store secondary data
     m_nQuadsWide = m_nBlockWidth - 1;
     m_nQuadsHigh = m_nBlockHeight - 1;
 
-    // Attempt to allocate space for this heightmap information
-    m_pHeightMap = new float[m_nHeightMapWidth * m_nHeightMapHeight];
-    if (!m_pHeightMap) return false;
+    // Streamed tiles are square
+    if ( m_bStreaming && m_nQuadsWide != m_nQuadsHigh ) return false;
 
-    // Build the heightmap path / filename
-    strcpy( Buffer, DataPath );
-    strcat( Buffer, FileName );
+    // Load the cooked terrain if it was cooked with these settings, and none
+    // of its source files have been modified since
+    if ( bCache )
+    {
+        ZeroMemory( &CacheKey, sizeof(TERRAINCACHEKEY) );
+        CacheKey.MapWidth         = m_nHeightMapWidth;
+        CacheKey.MapHeight        = m_nHeightMapHeight;
+        CacheKey.BlockWidth       = m_nBlockWidth;
+        CacheKey.BlockHeight      = m_nBlockHeight;
+        CacheKey.BlendTexRatio    = m_nBlendTexRatio;
+        CacheKey.LayerCount       = GetPrivateProfileInt( Section, "LayerCount", 1, DefFile );
+        CacheKey.SharedIndices    = m_bSharedIndices ? 1 : 0;
+        CacheKey.HeightFormat     = HeightFormat;
+        CacheKey.FilterType       = FilterType;
+        CacheKey.FilterRadius     = FilterRadius;
+        CacheKey.FilterIterations = FilterIterations;
+        CacheKey.FilterSigma      = FilterSigma;
+        if ( IsCacheCurrent( DefFile, CachePath, CacheKey.LayerCount ) ) m_Cache.Open( CachePath, CacheKey );
+
+    } // End if cached
+
+    // Load the heightmap, unless streaming from a tile file built for it
+    if ( !m_bStreaming || !CTerrainTileFile::IsValid( TilePath, m_nHeightMapWidth, m_nHeightMapHeight, m_nQuadsWide ) )
+    {
+        // Attempt to allocate space for this heightmap information
+        m_pHeightMap = new float[m_nHeightMapWidth * m_nHeightMapHeight];
+        if (!m_pHeightMap) return false;
 
-    // Open up the heightmap file
-    pFile = _tfopen( Buffer, _T("rb") );
-    if (!pFile) return false;
+        if ( m_Cache.IsOpen() )
+        {
+            // The cooked heightmap has already been filtered
+            memcpy( m_pHeightMap, m_Cache.GetHeightMap(), m_nHeightMapWidth * m_nHeightMapHeight * sizeof(float) );
 
-    // Read the heightmap data
-    for ( i = 0; i < m_nHeightMapWidth * m_nHeightMapHeight; i++ )
-    {
-        UCHAR HeightValue;
-        fread( &HeightValue, 1, 1, pFile );
+        } // End if cooked
+        else
+        {
+            // Build the heightmap path / filename
+            strcpy( Buffer, DataPath );
+            strcat( Buffer, FileName );
 
-        // Store it as floating point
-        m_pHeightMap[i] = (float)HeightValue;
-    
-    } // Next Value
-    
-    // Finish up
-    fclose( pFile );
+            // Load the heightmap data, converting it to floating point
+            if ( !CHeightMap::LoadRaw( Buffer, HeightFormat, m_pHeightMap, m_nHeightMapWidth * m_nHeightMapHeight ) ) return false;
+
+            // Filter the heightmap data
+            FilterHeightMap();
+
+            // Cook the terrain as it is built (it is not fatal if we can't)
+            if ( bCache ) m_Cache.Create( CachePath, CacheKey, ((m_nHeightMapWidth - 1) / m_nQuadsWide) * ((m_nHeightMapHeight - 1) / m_nQuadsHigh), m_pHeightMap );
+
+        } // End if load
+
+        // Precompute the normals of the heightmap we are keeping
+        if ( !m_bStreaming && !m_NormalMap.Build( m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, (const float*)&m_vecScale, &m_ThreadPool ) ) return false;
 
-    // Filter the heightmap data
-    FilterHeightMap();
+        // Build the height pyramid used to ray cast against it
+        if ( !m_bStreaming && !m_RayCast.Build( m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, (const float*)&m_vecScale, &m_ThreadPool ) ) return false;
+
+        // Cut it in to tiles for streaming, after which it is no longer required
+        if ( m_bStreaming )
+        {
+            if ( !CTerrainTileFile::Write( TilePath, m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, m_nQuadsWide ) ) return false;
+            delete []m_pHeightMap;
+            m_pHeightMap = NULL;
+
+        } // End if streaming
+
+    } // End if load heightmap
 
     // Load in the texture data
     strcpy( Section, "Textures" );
@@ -251,20 +495,79 @@ bool CTerrain::LoadTerrain( LPCTSTR DefFile )
     // Generate the terrain layer data
     if ( !GenerateLayers( DefFile ) ) return false;
 
+    // Fall back to full vertices if the compact mode can't be rendered
+    if ( m_bCompactVertices && !CreateCompactResources() ) m_bCompactVertices = false;
+
+    // Build the index buffer shared by every fully covered splat
+    if ( m_bSharedIndices && !CreateSharedIndices() ) return false;
+
     // Build the terrain blocks
     if ( !GenerateTerrainBlocks() ) return false;
 
-    // Erase the blend maps, they are no longer required
-    for ( i = 0; i < m_nLayerCount; i++ ) 
+    // Complete the cook, if it fails the terrain is simply cooked again next
+    // time. The cache is finished with once the blocks have been uploaded.
+    if ( m_Cache.IsCooking() ) m_Cache.Commit();
+    m_Cache.Close();
+
+    // Streamed blocks are built as they are paged in, around the player
+    if ( m_bStreaming )
     {
-        if ( m_pLayer[i]->m_pBlendMap ) { delete []m_pLayer[i]->m_pBlendMap; m_pLayer[i]->m_pBlendMap = NULL; }    
-    
-    } // Next Layer
+        if ( StreamRadius <= 0.0f ) StreamRadius = (float)(m_nQuadsWide * 4) * m_vecScale.x;
+        if ( !m_Pager.Create( TilePath, m_vecScale.x, m_vecScale.z, StreamRadius, StreamBudget, StreamPrefetch ) ) return false;
+        m_Pager.SetCallbacks( TileLoaded, TileEvicted, this );
+
+    } // End if streaming
+    else if ( !m_bEditable )
+    {
+        // Erase the blend maps, they are no longer required (unless painting)
+        for ( i = 0; i < m_nLayerCount; i++ ) 
+        {
+            if ( m_pLayer[i]->m_pBlendMap ) { delete []m_pLayer[i]->m_pBlendMap; m_pLayer[i]->m_pBlendMap = NULL; }    
+        
+        } // Next Layer
+
+    } // End if not streaming
 
     // Success!!
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Name : IsCacheCurrent () (Private)
+// Desc : Was the cache file written after the terrain definition, the
+//        heightmap and every layer map were last modified?
+// Note : Source files which can't be found are ignored, so that the cooked
+//        terrain can be used without them.
+//-----------------------------------------------------------------------------
+bool CTerrain::IsCacheCurrent( LPCTSTR DefFile, LPCTSTR CacheFile, ULONG LayerCount )
+{
+    char  Buffer[1025], Section[100], FileName[MAX_PATH];
+    ULONG i;
+
+    // The terrain definition
+    if ( CTerrainCache::IsNewer( DefFile, CacheFile ) ) return false;
+
+    // The heightmap
+    GetPrivateProfileString( "General", "Heightmap", "", FileName, MAX_PATH - 1, DefFile );
+    strcpy( Buffer, DataPath );
+    strcat( Buffer, FileName );
+    if ( CTerrainCache::IsNewer( Buffer, CacheFile ) ) return false;
+
+    // The layer maps (the base layer has none)
+    for ( i = 1; i < LayerCount; i++ )
+    {
+        sprintf( Section, "Layer %i", i );
+        GetPrivateProfileString( Section, "LayerMap", "", FileName, MAX_PATH - 1, DefFile );
+        strcpy( Buffer, DataPath );
+        strcat( Buffer, FileName );
+        if ( CTerrainCache::IsNewer( Buffer, CacheFile ) ) return false;
+
+    } // Next Layer
+
+    // Up to date
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name : GenerateLayers()
 // Desc : Generate the layer data for this terrain.
@@ -327,6 +630,9 @@ bool CTerrain::GenerateLayers( LPCTSTR DefFile )
         pLayer->m_mtxTexture._11 *= Scale.x; pLayer->m_mtxTexture._21 *= Scale.x; pLayer->m_mtxTexture._31 *= Scale.x;
         pLayer->m_mtxTexture._12 *= Scale.y; pLayer->m_mtxTexture._22 *= Scale.y; pLayer->m_mtxTexture._32 *= Scale.y;
         
+        // Cooked terrain is built without the blend maps
+        if ( m_Cache.IsOpen() ) continue;
+
         // Allocate our layer blend map array (these are temporary arrays)
         pLayer->m_pBlendMap = new UCHAR[ Width * Height ];
         if (!pLayer->m_pBlendMap) return false;
@@ -335,7 +641,13 @@ bool CTerrain::GenerateLayers( LPCTSTR DefFile )
         memset( pLayer->m_pBlendMap, 0, Width * Height );
 
         // Base layer is always fully opaque
-        if  ( i == 0 ) { memset( pLayer->m_pBlendMap, 255, Width * Height ); continue; }
+        if  ( i == 0 )
+        {
+            memset( pLayer->m_pBlendMap, 255, Width * Height );
+            if ( m_bEditable && !pLayer->StoreWeights() ) return false;
+            continue;
+
+        } // End if base layer
         
         // Get layer filename for non base layers
         GetPrivateProfileString( Section, "LayerMap", "", FileName, MAX_PATH - 1, DefFile );
@@ -378,22 +690,21 @@ bool CTerrain::GenerateLayers( LPCTSTR DefFile )
         pSurface->UnlockRect();
         pSurface->Release();
 
+        // Keep the weights as loaded if they may be painted
+        if ( m_bEditable && !pLayer->StoreWeights() ) return false;
+
         // Clamp values to min and max
         for ( j = 0; j < (Width * Height); j++ )
         {
-            UCHAR MinAlpha = 15;
-            UCHAR MaxAlpha = 220;
-            
-            // Clamp layer value
-            Value = pLayer->m_pBlendMap[ j ];
-            if ( Value < MinAlpha ) Value = 0;
-            if ( Value > MaxAlpha ) Value = 255;
-            pLayer->m_pBlendMap[ j ] = Value;
+            pLayer->m_pBlendMap[ j ] = ClampAlpha( pLayer->m_pBlendMap[ j ] );
 
         } // Next Alpha Value
 
     } // Next Layer
 
+    // The cooked splats were built from the occluded blend maps
+    if ( m_Cache.IsOpen() ) return true;
+
     // Now we need to parse the layers and determine which alpha pixels are occluded
     for ( i = 0; i < m_nLayerCount; i++ )
     {
@@ -438,111 +749,318 @@ bool CTerrain::GenerateLayers( LPCTSTR DefFile )
 //-----------------------------------------------------------------------------
 bool CTerrain::GenerateTerrainBlocks( )
 {
-    ULONG x, z, ax, az, Counter;
+    PROFILE_ZONE( "CTerrain::GenerateTerrainBlocks" );
+    ULONG x, z;
 
     // Calculate block values
     m_nBlocksWide = (USHORT)(m_nHeightMapWidth - 1) / m_nQuadsWide;
     m_nBlocksHigh = (USHORT)(m_nHeightMapHeight - 1) / m_nQuadsHigh;
+
+    // Build the culling hierarchy, blocks are added to it as they are generated
+    if ( !m_QuadTree.Build( m_nBlocksWide, m_nBlocksHigh ) ) return false;
+    m_pVisible = new ULONG[ m_nBlocksWide * m_nBlocksHigh ];
+    if ( !m_pVisible ) return false;
+
+    // Streamed blocks are only allocated as they are paged in
+    if ( m_bStreaming )
+    {
+        m_pBlock = new CTerrainBlock*[ m_nBlocksWide * m_nBlocksHigh ];
+        if ( !m_pBlock ) return false;
+        ZeroMemory( m_pBlock, m_nBlocksWide * m_nBlocksHigh * sizeof(CTerrainBlock*) );
+        m_nBlockCount = m_nBlocksWide * m_nBlocksHigh;
+        return true;
+
+    } // End if streaming
     
     // Allocate enough blocks to store the separate parts of this terrain
     if ( AddTerrainBlock(  m_nBlocksWide * m_nBlocksHigh )  < 0 ) return false;
 
-    // Initialize each terrain block
+    // Blocks modified by the editing functions are listed until committed
+    m_pDirtyBlocks = new ULONG[ m_nBlockCount ];
+    if ( !m_pDirtyBlocks ) return false;
+
+    // Calculate Neighbour Information
     for ( z = 0; z < m_nBlocksHigh; z++ )
     {
-        for ( x = 0; x < m_nBlocksHigh; x++ )
+        for ( x = 0; x < m_nBlocksWide; x++ ) LinkBlockNeighbours( x, z );
+    
+    } // Next Row
+
+    // Generate the terrain blocks a batch at a time. The vertices, index lists
+    // and blend texels are built on the worker threads, then the device
+    // resources are created here (staging is freed as we go).
+    BLOCKBATCH Batch;
+    Batch.pTerrain   = this;
+    Batch.ppBlocks   = m_pBlock;
+    Batch.BlocksWide = m_nBlocksWide;
+    Batch.QuadsWide  = m_nQuadsWide;
+    Batch.QuadsHigh  = m_nQuadsHigh;
+    Batch.Failed     = 0;
+
+    for ( Batch.FirstBlock = 0; Batch.FirstBlock < m_nBlockCount; Batch.FirstBlock += BlockBatchSize )
+    {
+        ULONG i, Count = m_nBlockCount - Batch.FirstBlock;
+        if ( Count > BlockBatchSize ) Count = BlockBatchSize;
+
+        // Build the CPU side data in parallel
+        m_ThreadPool.Dispatch( BuildBlockTask, &Batch, Count );
+        if ( Batch.Failed ) return false;
+
+        // Create the device resources
+        for ( i = Batch.FirstBlock; i < Batch.FirstBlock + Count; i++ )
         {
-            CTerrainBlock * pBlock = m_pBlock[ x + z * m_nBlocksWide ];
+            // Cook the splats before their staging memory is released (the cook is abandoned on failure)
+            if ( m_Cache.IsCooking() && !m_pBlock[i]->WriteSplats( m_Cache, i ) ) m_Cache.Close();
 
-            // Calculate Neighbour Information
-            Counter = 0;
-            for ( az = -1; az <= 1; az++ )
-            {
-                for ( ax = -1; ax <= 1; ax++, Counter++ )
-                {
-                    // Reset to NULL to begin with
-                    pBlock->m_pNeighbours[Counter] = NULL;
-                    
-                    // Bail if we are out of bounds
-                    if ( (x + ax) < 0 || (z + az) < 0 || (x + ax) >= m_nBlocksWide || (z + az) >= m_nBlocksHigh ) continue;
-                
-                    // Store Neighbour
-                    pBlock->m_pNeighbours[Counter] = m_pBlock[ (x + ax) + (z + az) * m_nBlocksWide ]; 
+            if ( !m_pBlock[i]->CreateResources() ) return false;
+            m_QuadTree.SetBlockBounds( i, m_pBlock[i]->m_BoundsMin, m_pBlock[i]->m_BoundsMax );
 
-                } // Next Adjacent Column
+        } // Next Block
 
-            } // Next Adjacent Row
-            
-        } // Next Column
-    
-    } // Next Row
+    } // Next Batch
 
-    // Generate each terrain block
-    for ( z = 0; z < m_nBlocksHigh; z++ )
+    // Success!!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateStreaming ()
+// Desc : Pages terrain blocks in and out around the player. The first call
+//        waits for the blocks around the player so that there is something
+//        to stand on, after which tiles arrive in the background.
+//-----------------------------------------------------------------------------
+void CTerrain::UpdateStreaming( const D3DXVECTOR3 & Position, const D3DXVECTOR3 & Velocity )
+{
+    if ( !m_bStreaming ) return;
+
+    m_Pager.Update( (const float*)&Position, (const float*)&Velocity );
+    if ( !m_bStreamPrimed ) { m_Pager.Flush(); m_bStreamPrimed = true; }
+}
+
+//-----------------------------------------------------------------------------
+// Name : TileLoaded () (Static)
+// Desc : Called by the pager once a tile is resident, builds its block.
+//-----------------------------------------------------------------------------
+bool CTerrain::TileLoaded( LPVOID pContext, ULONG TileX, ULONG TileZ, const float * pSamples, ULONG Pitch )
+{
+    CTerrain      * pTerrain = (CTerrain*)pContext;
+    CTerrainBlock * pBlock   = NULL;
+    ULONG           Index    = TileX + TileZ * pTerrain->m_nBlocksWide;
+
+    // Build the block from the tile samples
+    if ( !(pBlock = new CTerrainBlock()) ) return false;
+    if ( !pBlock->GenerateBlock( pTerrain, TileX * pTerrain->m_nQuadsWide, TileZ * pTerrain->m_nQuadsHigh,
+                                 pTerrain->m_nBlockWidth, pTerrain->m_nBlockHeight, pSamples, Pitch ) )
+    {
+        delete pBlock;
+        return false;
+
+    } // End if failed
+
+    // Store it and link it to any resident neighbours
+    if ( pTerrain->m_pBlock[ Index ] ) delete pTerrain->m_pBlock[ Index ];
+    pTerrain->m_pBlock[ Index ] = pBlock;
+    pTerrain->LinkBlockNeighbours( TileX, TileZ );
+    pTerrain->m_QuadTree.SetBlockBounds( Index, pBlock->m_BoundsMin, pBlock->m_BoundsMax );
+
+    // Success
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TileEvicted () (Static)
+// Desc : Called by the pager when a tile is paged out, releases its block.
+//-----------------------------------------------------------------------------
+void CTerrain::TileEvicted( LPVOID pContext, ULONG TileX, ULONG TileZ )
+{
+    CTerrain * pTerrain = (CTerrain*)pContext;
+    ULONG      Index    = TileX + TileZ * pTerrain->m_nBlocksWide;
+
+    if ( !pTerrain->m_pBlock[ Index ] ) return;
+    delete pTerrain->m_pBlock[ Index ];
+    pTerrain->m_pBlock[ Index ] = NULL;
+    pTerrain->m_QuadTree.ClearBlockBounds( Index );
+
+    // Clear the neighbours' references to it
+    pTerrain->LinkBlockNeighbours( TileX, TileZ );
+}
+
+//-----------------------------------------------------------------------------
+// Name : LinkBlockNeighbours () (Private)
+// Desc : Refresh the neighbour table of the block at this position, and the
+//        entries referring back to it from each of its neighbours (the block
+//        itself may be NULL when streaming).
+//-----------------------------------------------------------------------------
+void CTerrain::LinkBlockNeighbours( ULONG x, ULONG z )
+{
+    CTerrainBlock * pBlock = m_pBlock[ x + z * m_nBlocksWide ];
+    ULONG           Counter = 0;
+    long            ax, az;
+
+    for ( az = -1; az <= 1; az++ )
     {
-        for ( x = 0; x < m_nBlocksHigh; x++ )
+        for ( ax = -1; ax <= 1; ax++, Counter++ )
         {
-            CTerrainBlock * pBlock = m_pBlock[ x + z * m_nBlocksWide ];
-            
-            // Generate the block
-            if (!pBlock->GenerateBlock( this, x * m_nQuadsWide, z * m_nQuadsHigh, m_nBlockWidth, m_nBlockHeight )) return false;
+            CTerrainBlock * pNeighbour = NULL;
 
-        } // Next Column
-    
-    } // Next Row
+            // Look up the neighbour if we are in bounds
+            if ( (long)x + ax >= 0 && (long)z + az >= 0 && (long)x + ax < (long)m_nBlocksWide && (long)z + az < (long)m_nBlocksHigh )
+                pNeighbour = m_pBlock[ (x + ax) + (z + az) * m_nBlocksWide ];
+
+            // Store Neighbour, and ourselves in the neighbour's opposite entry
+            if ( pBlock ) pBlock->m_pNeighbours[Counter] = pNeighbour;
+            if ( pNeighbour ) pNeighbour->m_pNeighbours[ 8 - Counter ] = pBlock;
+
+        } // Next Adjacent Column
+
+    } // Next Adjacent Row
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateCompactResources () (Private)
+// Desc : Create the shared grid, vertex declaration and vertex shader used to
+//        render compact vertices.
+// Note : Returns false (releasing anything created) if the device can't run
+//        the shader, in which case full vertices are used instead.
+//-----------------------------------------------------------------------------
+bool CTerrain::CreateCompactResources( )
+{
+    HRESULT        hRet;
+    ULONG          x, z, Usage = D3DUSAGE_WRITEONLY;
+    CGridVertex  * pGrid    = NULL;
+    LPD3DXBUFFER   pCode    = NULL;
+    D3DCAPS9       Caps;
+
+    // Hardware vertex processing requires vertex shader support
+    m_pD3DDevice->GetDeviceCaps( &Caps );
+    if ( m_bHardwareTnL && Caps.VertexShaderVersion < D3DVS_VERSION(1, 1) ) return false;
+    if ( !m_bHardwareTnL ) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+
+    // Build the shader and the declaration
+    hRet = D3DXAssembleShader( CompactShader, sizeof(CompactShader) - 1, NULL, NULL, 0, &pCode, NULL );
+    if ( SUCCEEDED(hRet) )
+    {
+        hRet = m_pD3DDevice->CreateVertexShader( (DWORD*)pCode->GetBufferPointer(), &m_pCompactShader );
+        pCode->Release();
+
+    } // End if assembled
+    if ( SUCCEEDED(hRet) ) hRet = m_pD3DDevice->CreateVertexDeclaration( CompactDecl, &m_pCompactDecl );
+
+    // Build the grid shared by every block
+    if ( SUCCEEDED(hRet) ) hRet = m_pD3DDevice->CreateVertexBuffer( m_nBlockWidth * m_nBlockHeight * sizeof(CGridVertex), Usage, 0, D3DPOOL_MANAGED, &m_pGridBuffer, NULL );
+    if ( SUCCEEDED(hRet) ) hRet = m_pGridBuffer->Lock( 0, m_nBlockWidth * m_nBlockHeight * sizeof(CGridVertex), (void**)&pGrid, 0 );
+    if ( SUCCEEDED(hRet) )
+    {
+        for ( z = 0; z < m_nBlockHeight; z++ )
+        {
+            for ( x = 0; x < m_nBlockWidth; x++, pGrid++ ) { pGrid->x = (short)x; pGrid->z = (short)z; }
+
+        } // Next Row
+        m_pGridBuffer->Unlock();
+
+    } // End if locked
+
+    // Clean up on failure
+    if ( FAILED(hRet) )
+    {
+        if ( m_pGridBuffer    ) m_pGridBuffer->Release();
+        if ( m_pCompactDecl   ) m_pCompactDecl->Release();
+        if ( m_pCompactShader ) m_pCompactShader->Release();
+        m_pGridBuffer    = NULL;
+        m_pCompactDecl   = NULL;
+        m_pCompactShader = NULL;
+        return false;
+
+    } // End if failed
 
     // Success!!
     return true;
 }
 
 //-----------------------------------------------------------------------------
-// Name : FilterHeightMap ()
-// Desc : Filter the heightmap to smooth out those bumps.
+// Name : CreateSharedIndices () (Private)
+// Desc : Build the index buffer holding every level of detail of a splat
+//        which covers the whole block. All blocks have the same topology, so
+//        one buffer is used by every such splat (usually the base layer).
 //-----------------------------------------------------------------------------
-void CTerrain::FilterHeightMap( )
+bool CTerrain::CreateSharedIndices( )
 {
-    ULONG x, z;
-    float Value;
+    HRESULT  hRet;
+    ULONG    Level, LevelCount, IndexCount = 0, Usage = D3DUSAGE_WRITEONLY;
+    USHORT * pIndex = NULL;
+    LODRANGE Ranges[ CTerrainLOD::RANGE_COUNT ];
 
-    // Validate requirements
-    if (!m_pHeightMap) return;
-    
-    // Allocate the result
-    float * pResult = new float[m_nHeightMapWidth * m_nHeightMapHeight];
-    if (!pResult) return;
+    // Calculate buffer usage
+    if ( !m_bHardwareTnL ) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
 
-    // Copy over data to retain edges
-    memcpy( pResult, m_pHeightMap, m_nHeightMapWidth * m_nHeightMapHeight * sizeof(float) );
+    // Measure the index sets for every level of detail (no mask, every quad)
+    LevelCount = CTerrainLOD::GetLevelCount( m_nQuadsWide, m_nQuadsHigh );
+    for ( Level = 0; Level < LevelCount; Level++ )
+    {
+        IndexCount += CTerrainLOD::BuildIndices( m_nQuadsWide, m_nQuadsHigh, Level, NULL, NULL, IndexCount, Ranges );
+
+    } // Next Level
 
-    // Loop through and filter values (simple box style filter)
-    for ( z = 1; z < m_nHeightMapHeight - 1; ++z )
+    // Create and fill the index buffer, laid out exactly as a splat's would be
+    hRet = m_pD3DDevice->CreateIndexBuffer( IndexCount * sizeof(USHORT), Usage, D3DFMT_INDEX16, D3DPOOL_MANAGED, &m_pSharedIndices, NULL );
+    if ( FAILED(hRet) ) return false;
+    hRet = m_pSharedIndices->Lock( 0, IndexCount * sizeof(USHORT), (void**)&pIndex, 0 );
+    if ( FAILED(hRet) ) return false;
+
+    for ( Level = 0, IndexCount = 0; Level < LevelCount; Level++ )
     {
-        for ( x = 1; x < m_nHeightMapWidth - 1; ++x )
-        {
-            Value  = m_pHeightMap[ (x - 1) + (z - 1) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x    ) + (z - 1) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x + 1) + (z - 1) * m_nHeightMapWidth ]; 
+        IndexCount += CTerrainLOD::BuildIndices( m_nQuadsWide, m_nQuadsHigh, Level, NULL, pIndex + IndexCount, IndexCount, Ranges );
 
-            Value += m_pHeightMap[ (x - 1) + (z    ) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x    ) + (z    ) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x + 1) + (z    ) * m_nHeightMapWidth ]; 
+    } // Next Level
+    m_pSharedIndices->Unlock();
 
-            Value += m_pHeightMap[ (x - 1) + (z + 1) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x    ) + (z + 1) * m_nHeightMapWidth ]; 
-            Value += m_pHeightMap[ (x + 1) + (z + 1) * m_nHeightMapWidth ]; 
+    // Success!!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetVertexStats ()
+// Desc : Measure the vertex memory used by the resident blocks, and the
+//        height error introduced by compact vertices.
+//-----------------------------------------------------------------------------
+void CTerrain::GetVertexStats( VERTEXSTATS & Stats ) const
+{
+    ULONG  i, VertexCount = 0, BlockVertices = m_nBlockWidth * m_nBlockHeight;
+    double ErrorSq = 0.0;
+
+    ZeroMemory( &Stats, sizeof(VERTEXSTATS) );
+    if ( m_pGridBuffer ) Stats.VertexBytes = BlockVertices * sizeof(CGridVertex);
 
-            // Store the result
-            pResult[ x + z * m_nHeightMapWidth ] = Value / 9.0f;
+    // Sum up each block with a vertex buffer
+    for ( i = 0; i < m_nBlockCount; i++ )
+    {
+        const CTerrainBlock * pBlock = m_pBlock[i];
+        if ( !pBlock || !pBlock->m_pVertexBuffer ) continue;
+
+        Stats.VertexBytes += BlockVertices * (m_bCompactVertices ? sizeof(CCompactVertex) : sizeof(CVertex));
+        Stats.FullBytes   += BlockVertices * sizeof(CVertex);
+        if ( pBlock->m_fQuantMaxError > Stats.MaxError ) Stats.MaxError = pBlock->m_fQuantMaxError;
+        ErrorSq     += pBlock->m_fQuantErrorSq;
+        VertexCount += BlockVertices;
 
-        } // Next X
+    } // Next Block
+
+    if ( VertexCount > 0 ) Stats.RMSError = (float)sqrt( ErrorSq / VertexCount );
+}
 
-    } // Next Z
+//-----------------------------------------------------------------------------
+// Name : FilterHeightMap ()
+// Desc : Filter the heightmap to smooth out those bumps.
+//-----------------------------------------------------------------------------
+void CTerrain::FilterHeightMap( )
+{
+    PROFILE_ZONE( "CTerrain::FilterHeightMap" );
 
-    // Release the old array
-    delete []m_pHeightMap;
+    // Validate requirements
+    if (!m_pHeightMap) return;
 
-    // Store the new one
-    m_pHeightMap = pResult;
+    // Run the filter selected by the definition file across the worker threads
+    m_HeightMapFilter.Apply( m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, &m_ThreadPool );
 
 }
 
@@ -551,26 +1069,60 @@ void CTerrain::FilterHeightMap( )
 // Desc : Retrieves the normal at this position in the heightmap
 //-----------------------------------------------------------------------------
 D3DXVECTOR3 CTerrain::GetHeightMapNormal( ULONG x, ULONG z )
+{
+    D3DXVECTOR3 Normal;
+
+	// Make sure we are not out of bounds
+	if ( !m_pHeightMap || x >= m_nHeightMapWidth || z >= m_nHeightMapHeight ) return D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+
+    // Look it up if the normals were precomputed
+    if ( m_NormalMap.IsBuilt() )
+    {
+        m_NormalMap.GetNormal( x, z, (float*)&Normal );
+        return Normal;
+
+    } // End if normal map
+
+    // Calculate from the heightmap array
+    return GetSampleNormal( &m_pHeightMap[ x + z * m_nHeightMapWidth ], m_nHeightMapWidth, x, z );
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateNormals ()
+// Desc : Regenerate the precomputed normals after the heightmap samples
+//        between (MinX, MinZ) and (MaxX, MaxZ) inclusive have been modified.
+//-----------------------------------------------------------------------------
+void CTerrain::UpdateNormals( ULONG MinX, ULONG MinZ, ULONG MaxX, ULONG MaxZ )
+{
+    PROFILE_ZONE( "CTerrain::UpdateNormals" );
+
+    m_NormalMap.Update( MinX, MinZ, MaxX, MaxZ, &m_ThreadPool );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSampleNormal ()
+// Desc : Retrieves the normal at this position in the heightmap, given a
+//        pointer to its sample in any array of heights 'Pitch' samples wide
+//        (the whole heightmap, or a streamed tile including its apron).
+//-----------------------------------------------------------------------------
+D3DXVECTOR3 CTerrain::GetSampleNormal( const float * pSample, long Pitch, ULONG x, ULONG z )
 {
 	D3DXVECTOR3 Normal, Edge1, Edge2;
-	ULONG       HMIndex, HMAddX, HMAddZ;
+	long        HMAddX, HMAddZ;
     float       y1, y2, y3;
 
 	// Make sure we are not out of bounds
-	if ( x < 0.0f || z < 0.0f || x >= m_nHeightMapWidth || z >= m_nHeightMapHeight ) return D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+	if ( x >= m_nHeightMapWidth || z >= m_nHeightMapHeight ) return D3DXVECTOR3(0.0f, 1.0f, 0.0f);
 
-    // Calculate the index in the heightmap array
-    HMIndex = x + z * m_nHeightMapWidth;
-    
     // Calculate the number of pixels to add in either direction to
     // obtain the best neighbouring heightmap pixel.
     if ( x < (m_nHeightMapWidth - 1))  HMAddX = 1; else HMAddX = -1;
-	if ( z < (m_nHeightMapHeight - 1)) HMAddZ = m_nHeightMapWidth; else HMAddZ = -(signed)m_nHeightMapWidth;
+	if ( z < (m_nHeightMapHeight - 1)) HMAddZ = Pitch; else HMAddZ = -Pitch;
 	
     // Get the three height values
-	y1 = m_pHeightMap[HMIndex] * m_vecScale.y;
-	y2 = m_pHeightMap[HMIndex + HMAddX] * m_vecScale.y; 
-	y3 = m_pHeightMap[HMIndex + HMAddZ] * m_vecScale.y;
+	y1 = pSample[0] * m_vecScale.y;
+	y2 = pSample[HMAddX] * m_vecScale.y; 
+	y3 = pSample[HMAddZ] * m_vecScale.y;
 			
 	// Calculate Edges
 	Edge1 = D3DXVECTOR3( 0.0f, y3 - y1, m_vecScale.z );
@@ -595,6 +1147,15 @@ float CTerrain::GetHeight( float x, float z, bool ReverseQuad )
 {
     float fTopLeft, fTopRight, fBottomLeft, fBottomRight;
 
+    // Streamed terrain is queried through the resident tiles
+    if ( !m_pHeightMap )
+    {
+        D3DXVECTOR3 Position( x, 0.0f, z );
+        GetHeights( &Position, 1, &fTopLeft, NULL, ReverseQuad );
+        return fTopLeft;
+
+    } // End if streaming
+
     // Adjust Input Values
     x = x / m_vecScale.x;
     z = z / m_vecScale.z;
@@ -662,87 +1223,527 @@ float CTerrain::GetHeight( float x, float z, bool ReverseQuad )
 }
 
 //-----------------------------------------------------------------------------
-// Name : Render()
-// Desc : Renders all of the meshes stored within this terrain object.
+// Name : GetHeights ()
+// Desc : Retrieves the height at each of the given world space locations (the
+//        y component of each position is ignored), and optionally the normal
+//        of the terrain triangle beneath it. Prefer this to calling GetHeight
+//        in a loop when many objects need to be placed on the ground.
 //-----------------------------------------------------------------------------
-void CTerrain::Render( CCamera * pCamera )
+void CTerrain::GetHeights( const D3DXVECTOR3 * pPositions, ULONG Count, float * pHeights, D3DXVECTOR3 * pNormals, bool ReverseQuad )
 {
-    USHORT i;
-    ULONG  j;
-    
-    // Validate parameters
-    if( !m_pD3DDevice ) return;
+    // Validate Parameters
+    if ( !pPositions || !pHeights || Count == 0 ) return;
 
-    // Setup our terrain render states
-    m_pD3DDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, true );
-    m_pD3DDevice->SetRenderState( D3DRS_SRCBLEND, D3DBLEND_SRCALPHA );
-    m_pD3DDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA );
+    // Streamed terrain, each point is queried against the tile beneath it
+    if ( !m_pHeightMap )
+    {
+        ULONG Pitch = m_Pager.GetPitch(), TileQuads = m_Pager.GetTileQuads();
 
-    // stage 0 coloring : get color from texture0*diffuse
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLOROP, D3DTOP_MODULATE );
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLORARG1, D3DTA_TEXTURE );
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLORARG2, D3DTA_DIFFUSE );
+        for ( ULONG i = 0; i < Count; ++i )
+        {
+            float         x = pPositions[i].x / m_vecScale.x, z = pPositions[i].z / m_vecScale.z;
+            const float * pSamples = NULL;
+            ULONG         TileX = 0, TileZ = 0;
 
-    // stage 0 alpha : nada
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1 );
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_ALPHAARG1, D3DTA_CURRENT );
-    
-    // stage 1 coloring : nada
-    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_COLOROP, D3DTOP_SELECTARG1 );
-    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_COLORARG1, D3DTA_CURRENT );
-    
-    // stage 1 alpha : get alpha from texture1
-    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1 );
-    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_ALPHAARG1, D3DTA_TEXTURE );
+            // Find the resident tile (the apron covers the far edge samples)
+            if ( m_bStreaming && x >= 0.0f && z >= 0.0f && x < m_nHeightMapWidth && z < m_nHeightMapHeight )
+            {
+                TileX = (ULONG)x / TileQuads;
+                TileZ = (ULONG)z / TileQuads;
+                if ( TileX >= m_Pager.GetTilesWide() ) TileX = m_Pager.GetTilesWide() - 1;
+                if ( TileZ >= m_Pager.GetTilesHigh() ) TileZ = m_Pager.GetTilesHigh() - 1;
+                pSamples = m_Pager.GetTileSamples( TileX, TileZ );
 
-    // Enable Stage Texture Transforms
-    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2 );
-    
-    // Setup our terrain vertex FVF code
-    m_pD3DDevice->SetFVF( VERTEX_FVF );
+            } // End if in bounds
 
-    // Loop through blocks and signal a render
-    for ( j = 0; j < m_nBlockCount; j++ )
-    {
-        // Skip if block is not within the viewing frustum
-        if ( pCamera && (!pCamera->BoundsInFrustum( m_pBlock[j]->m_BoundsMin, m_pBlock[j]->m_BoundsMax )) ) continue;
+            // Nothing to collide with if the tile is not resident
+            if ( !pSamples )
+            {
+                pHeights[i] = 0.0f;
+                if ( pNormals ) pNormals[i] = D3DXVECTOR3( 0.0f, 1.0f, 0.0f );
+                continue;
 
-        m_pD3DDevice->SetStreamSource( 0, m_pBlock[j]->m_pVertexBuffer, 0, sizeof(CVertex) );
+            } // End if missing
 
-        // Loop through all active layers
-        for ( i = 0; i < m_nLayerCount; i++ )
-        {
-            // Skip if this layer is disabled
-            if ( GetGameApp()->GetRenderLayer( i ) == false ) continue;
+            // Position relative to the first stored sample of the tile
+            float Local[2];
+            Local[0] = pPositions[i].x - (float)((long)(TileX * TileQuads) - (long)TILE_APRON) * m_vecScale.x;
+            Local[1] = pPositions[i].z - (float)((long)(TileZ * TileQuads) - (long)TILE_APRON) * m_vecScale.z;
+            CHeightMap::GetHeights( pSamples - TILE_APRON * (Pitch + 1), Pitch, Pitch, (const float*)&m_vecScale,
+                                    &Local[0], &Local[1], sizeof(Local), 1, &pHeights[i], pNormals ? (float*)&pNormals[i] : NULL, ReverseQuad );
 
-            CTerrainLayer * pLayer = m_pLayer[i];
-            if ( !m_pBlock[j]->m_pLayerUsage[ i ] ) continue;
+        } // Next Position
+        return;
 
-            // Set our texturing information
-            m_pD3DDevice->SetTexture( 0, m_pTexture[pLayer->m_nTextureIndex] );
-            m_pD3DDevice->SetTransform( D3DTS_TEXTURE0, &pLayer->m_mtxTexture );
-            
-            m_pBlock[j]->Render( m_pD3DDevice, i );
+    } // End if streaming
 
-        } // Next Block
+    CHeightMap::GetHeights( m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, (const float*)&m_vecScale,
+                            &pPositions[0].x, &pPositions[0].z, sizeof(D3DXVECTOR3), Count,
+                            pHeights, (float*)pNormals, ReverseQuad );
+}
 
-    } // Next Layer
+//-----------------------------------------------------------------------------
+// Name : Intersect ()
+// Desc : Find where a ray first strikes the terrain within 'MaxDistance' of
+//        its origin, for picking or projectiles. Pass NULL for 'pHit' when
+//        only whether the ray is blocked matters, which is cheaper.
+// Note : Streamed terrain can not currently be ray cast against.
+//-----------------------------------------------------------------------------
+bool CTerrain::Intersect( const D3DXVECTOR3 & Origin, const D3DXVECTOR3 & Direction, float MaxDistance, RAYHIT * pHit ) const
+{
+    return m_RayCast.Intersect( (const float*)&Origin, (const float*)&Direction, MaxDistance, pHit );
+}
 
+//-----------------------------------------------------------------------------
+// Name : IntersectSegment ()
+// Desc : Find where the segment between two points first strikes the terrain
+//        (NULL 'pHit' for line of sight checks).
+//-----------------------------------------------------------------------------
+bool CTerrain::IntersectSegment( const D3DXVECTOR3 & Start, const D3DXVECTOR3 & End, RAYHIT * pHit ) const
+{
+    return m_RayCast.IntersectSegment( (const float*)&Start, (const float*)&End, pHit );
 }
 
 //-----------------------------------------------------------------------------
-// Name : AddTerrainBlock()
-// Desc : Adds a terrain block, or multiple blocks, to this object.
-// Note : Returns the index for the first block added, or -1 on failure.
+// Name : IntersectBatch ()
+// Desc : Ray cast many rays at once across the worker threads, returning the
+//        number which struck the terrain. Prefer this to calling Intersect
+//        in a loop for large numbers of visibility checks.
 //-----------------------------------------------------------------------------
-long CTerrain::AddTerrainBlock( ULONG Count )
+ULONG CTerrain::IntersectBatch( const RAYQUERY * pRays, ULONG Count, RAYHIT * pHits, bool OcclusionOnly )
 {
-    CTerrainBlock ** pBlockBuffer = NULL;
-    
-    // Allocate new resized array
-    if (!( pBlockBuffer = new CTerrainBlock*[ m_nBlockCount + Count ] )) return -1;
+    PROFILE_ZONE( "CTerrain::IntersectBatch" );
 
-    // Clear out slack pointers
+    return m_RayCast.IntersectBatch( pRays, Count, pHits, OcclusionOnly, &m_ThreadPool );
+}
+
+//-----------------------------------------------------------------------------
+// Name : EditHeights ()
+// Desc : Apply a height brush centred on the world space position 'Centre'
+//        (usually found with Intersect), once. For raise / lower 'Strength'
+//        is the world space height added at the centre, for flatten and
+//        smooth the fraction (0 - 1) of the way the heights are moved, and
+//        flatten moves them toward the height of 'Centre'. 'Hardness' is
+//        the fraction of the radius painted at full strength.
+// Note : The heightmap, normals and ray cast pyramid are updated at once, so
+//        collision and picking see the edit immediately. Only the blocks
+//        built from the modified samples are rebuilt, by CommitEdits on the
+//        next call to Render. Streamed terrain can not be edited.
+//-----------------------------------------------------------------------------
+bool CTerrain::EditHeights( CTerrainBrush::MODE Mode, const D3DXVECTOR3 & Centre, float Radius, float Strength, float Hardness )
+{
+    PROFILE_ZONE( "CTerrain::EditHeights" );
+    TERRAINBRUSH Brush;
+    EDITRECT     Changed, Vertices;
+
+    // Only a resident heightmap can be edited
+    if ( !m_pHeightMap || !m_pDirtyBlocks ) return false;
+
+    // Convert the brush in to heightmap samples
+    Brush.x        = Centre.x / m_vecScale.x;
+    Brush.z        = Centre.z / m_vecScale.z;
+    Brush.Radius   = Radius / m_vecScale.x;
+    Brush.Hardness = Hardness;
+    Brush.Strength = Strength;
+    Brush.Target   = Centre.y / m_vecScale.y;
+    if ( Mode == CTerrainBrush::MODE_RAISE || Mode == CTerrainBrush::MODE_LOWER ) Brush.Strength /= m_vecScale.y;
+
+    // Apply it
+    if ( !CTerrainBrush::ApplyHeights( m_pHeightMap, m_nHeightMapWidth, m_nHeightMapHeight, Brush, Mode, Changed ) ) return false;
+
+    // Bring the normals and ray cast pyramid up to date
+    UpdateNormals( Changed.MinX, Changed.MinZ, Changed.MaxX, Changed.MaxZ );
+    m_RayCast.Update( Changed.MinX, Changed.MinZ, Changed.MaxX, Changed.MaxZ );
+
+    // A vertex is lit by the normals to its right and below, and a normal
+    // reads the samples to its right and below, so the lighting of vertices
+    // up to two samples before the region changes too
+    Vertices = Changed;
+    CTerrainBrush::GrowRect( Vertices, 2, 1, m_nHeightMapWidth, m_nHeightMapHeight );
+    MarkBlocksDirty( Vertices, false, 0 );
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PaintLayer ()
+// Desc : Paint the weight of a layer with a brush centred on the world space
+//        position 'Centre', once. A positive 'Strength' paints the layer in,
+//        a negative one erases it, moving the weights that fraction (up to
+//        1) of the way each time.
+// Note : Requires 'Editable' in the terrain definition, which keeps the
+//        weights as painted so that the layers beneath can be uncovered
+//        again. The base layer is always opaque and can not be painted.
+//-----------------------------------------------------------------------------
+bool CTerrain::PaintLayer( USHORT Layer, const D3DXVECTOR3 & Centre, float Radius, float Strength, float Hardness )
+{
+    PROFILE_ZONE( "CTerrain::PaintLayer" );
+    TERRAINBRUSH    Brush;
+    EDITRECT        Changed;
+    CTerrainLayer * pLayer;
+
+    // Validate parameters
+    if ( !m_bEditable || !m_pDirtyBlocks || Layer == 0 || Layer >= m_nLayerCount ) return false;
+    pLayer = m_pLayer[ Layer ];
+    if ( !pLayer->m_pWeightMap || !pLayer->m_pBlendMap ) return false;
+
+    // Convert the brush in to blend map texels (measured from texel centres)
+    Brush.x        = Centre.x / m_vecScale.x * m_nBlendTexRatio - 0.5f;
+    Brush.z        = Centre.z / m_vecScale.z * m_nBlendTexRatio - 0.5f;
+    Brush.Radius   = Radius / m_vecScale.x * m_nBlendTexRatio;
+    Brush.Hardness = Hardness;
+    Brush.Strength = fabsf( Strength );
+    Brush.Target   = ( Strength < 0.0f ) ? 0.0f : 255.0f;
+
+    // Apply it
+    if ( !CTerrainBrush::ApplyWeights( pLayer->m_pWeightMap, pLayer->m_nLayerWidth, pLayer->m_nLayerHeight, Brush, Changed ) ) return false;
+
+    // The layers beneath test their occlusion against a filtered copy of
+    // this one, which reads the neighbouring texels
+    CTerrainBrush::GrowRect( Changed, 1, 1, pLayer->m_nLayerWidth, pLayer->m_nLayerHeight );
+    ResolveLayers( Changed, Layer + 1 );
+    MarkBlocksDirty( Changed, true, Layer + 1 );
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResolveLayers () (Private)
+// Desc : Rebuild the blend maps of the first 'LayerCount' layers from their
+//        painted weights within a rectangle of texels, clamping and testing
+//        occlusion exactly as GenerateLayers does.
+//-----------------------------------------------------------------------------
+void CTerrain::ResolveLayers( const EDITRECT & Texels, USHORT LayerCount )
+{
+    ULONG i, j;
+    long  x, z;
+    UCHAR Value;
+
+    for ( i = 0; i < LayerCount; i++ )
+    {
+        CTerrainLayer * pLayer = m_pLayer[i];
+
+        for ( z = Texels.MinZ; z <= Texels.MaxZ; z++ )
+        {
+            for ( x = Texels.MinX; x <= Texels.MaxX; x++ )
+            {
+                // Clamp the painted weight
+                Value = ClampAlpha( pLayer->m_pWeightMap[ x + z * pLayer->m_nLayerWidth ] );
+
+                // Layer is obscured if a layer above is opaque
+                for ( j = i + 1; j < m_nLayerCount && Value > 0; j++ )
+                {
+                    if ( m_pLayer[j]->GetFilteredAlpha( x, z, true ) == 255 ) Value = 0;
+
+                } // Next Layer
+
+                pLayer->m_pBlendMap[ x + z * pLayer->m_nLayerWidth ] = Value;
+
+            } // Next Column
+
+        } // Next Row
+
+    } // Next Layer
+}
+
+//-----------------------------------------------------------------------------
+// Name : MarkBlocksDirty () (Private)
+// Desc : Flag the region of every block overlapping a rectangle of heightmap
+//        samples (or of blend map texels, and the splat levels of the first
+//        'LayerCount' layers) for rebuilding by CommitEdits.
+//-----------------------------------------------------------------------------
+void CTerrain::MarkBlocksDirty( const EDITRECT & Rect, bool Texels, USHORT LayerCount )
+{
+    EDITRECT Blocks, Local;
+    long     x, z, CellsWide, CellsHigh, Last;
+
+    // Blocks share their edge vertices, but not their blend texels
+    CellsWide = m_nQuadsWide * ( Texels ? m_nBlendTexRatio : 1 );
+    CellsHigh = m_nQuadsHigh * ( Texels ? m_nBlendTexRatio : 1 );
+    Last      = Texels ? 1 : 0;
+    if ( !CTerrainBrush::GetBlockRange( Rect, CellsWide, CellsHigh, !Texels, m_nBlocksWide, m_nBlocksHigh, Blocks ) ) return;
+
+    for ( z = Blocks.MinZ; z <= Blocks.MaxZ; z++ )
+    {
+        for ( x = Blocks.MinX; x <= Blocks.MaxX; x++ )
+        {
+            ULONG           Index  = x + z * m_nBlocksWide;
+            CTerrainBlock * pBlock = m_pBlock[ Index ];
+            if ( !pBlock ) continue;
+
+            // The part of the rectangle within this block, relative to it
+            Local.MinX = Rect.MinX - x * CellsWide;
+            Local.MinZ = Rect.MinZ - z * CellsHigh;
+            Local.MaxX = Rect.MaxX - x * CellsWide;
+            Local.MaxZ = Rect.MaxZ - z * CellsHigh;
+            if ( Local.MinX < 0 ) Local.MinX = 0;
+            if ( Local.MinZ < 0 ) Local.MinZ = 0;
+            if ( Local.MaxX > CellsWide - Last ) Local.MaxX = CellsWide - Last;
+            if ( Local.MaxZ > CellsHigh - Last ) Local.MaxZ = CellsHigh - Last;
+
+            // List the block the first time it is modified
+            if ( pBlock->MarkDirty( Local, Texels, LayerCount ) ) m_pDirtyBlocks[ m_nDirtyCount++ ] = Index;
+
+        } // Next Block Column
+
+    } // Next Block Row
+}
+
+//-----------------------------------------------------------------------------
+// Name : CommitEdits ()
+// Desc : Rebuild the modified parts of every block edited since the last
+//        call, re-uploading just those regions of their vertex buffers and
+//        blend textures, and refit the culling hierarchy. Called by Render.
+//-----------------------------------------------------------------------------
+void CTerrain::CommitEdits( )
+{
+    ULONG i;
+
+    // Anything to do ?
+    if ( m_nDirtyCount == 0 ) return;
+
+    PROFILE_ZONE( "CTerrain::CommitEdits" );
+    for ( i = 0; i < m_nDirtyCount; i++ )
+    {
+        ULONG           Index  = m_pDirtyBlocks[i];
+        CTerrainBlock * pBlock = m_pBlock[ Index ];
+
+        // A block which fails keeps drawing as it was
+        if ( !pBlock->UpdateResources() ) continue;
+        m_QuadTree.SetBlockBounds( Index, pBlock->m_BoundsMin, pBlock->m_BoundsMax );
+
+    } // Next Dirty Block
+
+    m_nDirtyCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Render()
+// Desc : Renders all of the meshes stored within this terrain object.
+//-----------------------------------------------------------------------------
+void CTerrain::Render( CCamera * pCamera )
+{
+    PROFILE_ZONE( "CTerrain::Render" );
+    USHORT i;
+    ULONG  j, k, v, VisibleCount;
+    bool   bChanged;
+    
+    // Validate parameters
+    if( !m_pD3DDevice ) return;
+
+    // Upload any edits made since the last frame
+    CommitEdits();
+
+    // Reset the statistics
+    m_nTrianglesDrawn = 0;
+    m_nIndexSwitches  = 0;
+
+    // Select the level of detail for every block (including those outside the
+    // frustum, a visible neighbour may need to stitch to them)
+    if ( m_bLODEnabled && m_fLODPixelError > 0.0f && pCamera )
+    {
+        float PixelScale = CTerrainLOD::GetPixelScale( pCamera->GetFOV(), pCamera->GetViewport().Height );
+        for ( j = 0; j < m_nBlockCount; j++ ) if ( m_pBlock[j] ) m_pBlock[j]->SelectLOD( pCamera->GetPosition(), PixelScale, m_fLODPixelError );
+
+        // Edge neighbours may only be one level apart, refine until they are
+        do
+        {
+            bChanged = false;
+            for ( j = 0; j < m_nBlockCount; j++ )
+            {
+                CTerrainBlock * pBlock = m_pBlock[j];
+                if ( !pBlock ) continue;
+                for ( k = 1; k < 9; k += 2 )
+                {
+                    CTerrainBlock * pNeighbour = pBlock->m_pNeighbours[k];
+                    if ( !pNeighbour || pBlock->m_nLOD <= pNeighbour->m_nLOD + 1 ) continue;
+                    pBlock->m_nLOD = pNeighbour->m_nLOD + 1;
+                    bChanged = true;
+
+                } // Next Edge Neighbour
+
+            } // Next Block
+
+        } while ( bChanged );
+
+    } // End if LOD enabled
+    else
+    {
+        // Everything at full detail
+        for ( j = 0; j < m_nBlockCount; j++ ) if ( m_pBlock[j] ) m_pBlock[j]->m_nLOD = 0;
+
+    } // End if LOD disabled
+
+    // Select the edge variants to draw
+    for ( j = 0; j < m_nBlockCount; j++ ) if ( m_pBlock[j] ) m_pBlock[j]->UpdateStitching();
+
+    // Setup our terrain render states
+    m_pD3DDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, true );
+    m_pD3DDevice->SetRenderState( D3DRS_SRCBLEND, D3DBLEND_SRCALPHA );
+    m_pD3DDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA );
+
+    // stage 0 coloring : get color from texture0*diffuse
+    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLOROP, D3DTOP_MODULATE );
+    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLORARG1, D3DTA_TEXTURE );
+    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_COLORARG2, D3DTA_DIFFUSE );
+
+    // stage 0 alpha : nada
+    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1 );
+    m_pD3DDevice->SetTextureStageState( 0, D3DTSS_ALPHAARG1, D3DTA_CURRENT );
+    
+    // stage 1 coloring : nada
+    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_COLOROP, D3DTOP_SELECTARG1 );
+    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_COLORARG1, D3DTA_CURRENT );
+    
+    // stage 1 alpha : get alpha from texture1
+    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1 );
+    m_pD3DDevice->SetTextureStageState( 1, D3DTSS_ALPHAARG1, D3DTA_TEXTURE );
+
+    if ( m_bCompactVertices )
+    {
+        D3DXMATRIX mtxViewProj, mtxView, mtxProj;
+        float      Constants[4] = { 1.0f / 255.0f, 0.0f, 0.0f, 1.0f };
+
+        // The shader applies the layer texture matrix itself
+        m_pD3DDevice->SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE );
+
+        // Use the camera's matrices (the device may be pure)
+        if ( pCamera )
+        {
+            mtxViewProj = pCamera->GetViewMatrix() * pCamera->GetProjMatrix();
+
+        } // End if camera
+        else
+        {
+            m_pD3DDevice->GetTransform( D3DTS_VIEW, &mtxView );
+            m_pD3DDevice->GetTransform( D3DTS_PROJECTION, &mtxProj );
+            mtxViewProj = mtxView * mtxProj;
+
+        } // End if no camera
+        D3DXMatrixTranspose( &mtxViewProj, &mtxViewProj );
+
+        // Set up the shader and the shared grid
+        m_pD3DDevice->SetVertexDeclaration( m_pCompactDecl );
+        m_pD3DDevice->SetVertexShader( m_pCompactShader );
+        m_pD3DDevice->SetVertexShaderConstantF( 0, (float*)&mtxViewProj, 4 );
+        m_pD3DDevice->SetVertexShaderConstantF( 9, Constants, 1 );
+        m_pD3DDevice->SetStreamSource( 0, m_pGridBuffer, 0, sizeof(CGridVertex) );
+
+    } // End if compact
+    else
+    {
+        // Enable Stage Texture Transforms
+        m_pD3DDevice->SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2 );
+    
+        // Setup our terrain vertex FVF code
+        m_pD3DDevice->SetFVF( VERTEX_FVF );
+
+    } // End if full vertices
+
+    // Find the blocks within the viewing frustum (the quadtree only holds
+    // the blocks which are resident when streaming)
+    if ( pCamera )
+    {
+        VisibleCount = m_QuadTree.Cull( (const float*)pCamera->GetFrustumPlanes(), m_pVisible, &m_CullStats );
+
+    } // End if camera
+    else
+    {
+        ZeroMemory( &m_CullStats, sizeof(CULLSTATS) );
+        for ( VisibleCount = 0, j = 0; j < m_nBlockCount; j++ ) if ( m_pBlock[j] ) m_pVisible[ VisibleCount++ ] = j;
+        m_CullStats.BlocksVisible = VisibleCount;
+
+    } // End if no camera
+
+    // Render a layer at a time, so the layer texture is set once per layer
+    // and blocks using the shared index buffer only switch vertex streams
+    LPDIRECT3DINDEXBUFFER9 pBoundIndices = NULL;
+    for ( i = 0; i < m_nLayerCount; i++ )
+    {
+        // Skip if this layer is disabled
+        if ( GetGameApp()->GetRenderLayer( i ) == false ) continue;
+
+        CTerrainLayer * pLayer = m_pLayer[i];
+
+        // Set our texturing information
+        m_pD3DDevice->SetTexture( 0, m_pTexture[pLayer->m_nTextureIndex] );
+        if ( m_bCompactVertices )
+        {
+            const D3DXMATRIX & mtx = pLayer->m_mtxTexture;
+            float Constants[8] = { mtx._11, mtx._21, mtx._31, 0.0f, mtx._12, mtx._22, mtx._32, 0.0f };
+            m_pD3DDevice->SetVertexShaderConstantF( 7, Constants, 2 );
+
+        } // End if compact
+        else
+        {
+            m_pD3DDevice->SetTransform( D3DTS_TEXTURE0, &pLayer->m_mtxTexture );
+
+        } // End if full vertices
+
+        // Loop through visible blocks and signal a render
+        for ( v = 0; v < VisibleCount; v++ )
+        {
+            CTerrainBlock * pBlock = m_pBlock[ m_pVisible[v] ];
+            if ( !pBlock->m_pLayerUsage[ i ] || !pBlock->m_pSplatLevel[ i ] ) continue;
+
+            if ( m_bCompactVertices )
+            {
+                // Block offset, quantization & blend texture mapping
+                float Constants[12] = { pBlock->m_nStartX * m_vecScale.x, pBlock->m_fHeightBias, pBlock->m_nStartZ * m_vecScale.z, 0.0f,
+                                        m_vecScale.x, pBlock->m_fHeightStep, m_vecScale.z, 0.0f,
+                                        (float)pBlock->m_nStartX, (float)pBlock->m_nStartZ, 1.0f / pBlock->m_nQuadsWide, 1.0f / pBlock->m_nQuadsHigh };
+                m_pD3DDevice->SetVertexShaderConstantF( 4, Constants, 3 );
+                m_pD3DDevice->SetStreamSource( 1, pBlock->m_pVertexBuffer, 0, sizeof(CCompactVertex) );
+
+            } // End if compact
+            else
+            {
+                m_pD3DDevice->SetStreamSource( 0, pBlock->m_pVertexBuffer, 0, sizeof(CVertex) );
+
+            } // End if full vertices
+
+            // Only bind the index buffer if it has changed
+            LPDIRECT3DINDEXBUFFER9 pIndices = pBlock->m_pSplatLevel[ i ]->m_pIndexBuffer;
+            if ( pIndices != pBoundIndices )
+            {
+                m_pD3DDevice->SetIndices( pIndices );
+                pBoundIndices = pIndices;
+                m_nIndexSwitches++;
+
+            } // End if changed
+            
+            m_nTrianglesDrawn += pBlock->Render( m_pD3DDevice, i );
+
+        } // Next Block
+
+    } // Next Layer
+
+    // Restore the fixed function pipeline
+    if ( m_bCompactVertices )
+    {
+        m_pD3DDevice->SetVertexShader( NULL );
+        m_pD3DDevice->SetStreamSource( 1, NULL, 0, 0 );
+        m_pD3DDevice->SetFVF( VERTEX_FVF );
+
+    } // End if compact
+
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddTerrainBlock()
+// Desc : Adds a terrain block, or multiple blocks, to this object.
+// Note : Returns the index for the first block added, or -1 on failure.
+//-----------------------------------------------------------------------------
+long CTerrain::AddTerrainBlock( ULONG Count )
+{
+    CTerrainBlock ** pBlockBuffer = NULL;
+    
+    // Allocate new resized array
+    if (!( pBlockBuffer = new CTerrainBlock*[ m_nBlockCount + Count ] )) return -1;
+
+    // Clear out slack pointers
     ZeroMemory( &pBlockBuffer[ m_nBlockCount ], Count * sizeof( CTerrainBlock* ) );
 
     // Existing Data?
@@ -920,171 +1921,692 @@ CTerrainBlock::CTerrainBlock( )
     m_nSplatCount   = 0;
     m_pSplatLevel   = NULL;
     m_pVertexBuffer = NULL;
+    m_nLODCount     = 0;
+    m_nLOD          = 0;
+    m_nStitchMask   = 0;
+    m_pStagingVertices = NULL;
+    m_pStagingCompact  = NULL;
+    m_fHeightStep      = 0.0f;
+    m_fHeightBias      = 0.0f;
+    m_fQuantMaxError   = 0.0f;
+    m_fQuantErrorSq    = 0.0f;
+    m_nDirtyLayers     = 0;
+    m_bDirty           = false;
+    CTerrainBrush::ClearRect( m_DirtyVertices );
+    CTerrainBrush::ClearRect( m_DirtyTexels );
 
     ZeroMemory( m_pNeighbours, 9 * sizeof(CTerrainBlock*) );
+    ZeroMemory( m_fLODError, MAX_TERRAIN_LOD * sizeof(float) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainBlock () (Destructor)
+// Desc : CTerrainBlock Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainBlock::~CTerrainBlock()
+{
+    ULONG i;
+
+	// Release Splat Levels
+    if ( m_pSplatLevel )
+    {
+        for ( i = 0; i < m_nSplatCount; i++ )
+        {
+            if ( m_pSplatLevel[i] ) delete m_pSplatLevel[i];
+
+        } // Next Splat Level
+
+        // Delete the array
+        delete []m_pSplatLevel;
+
+    } // End if Allocated
+
+    // Release flat arrays
+    if ( m_pLayerUsage ) delete []m_pLayerUsage;
+    if ( m_pStagingVertices ) delete []m_pStagingVertices;
+    if ( m_pStagingCompact  ) delete []m_pStagingCompact;
+
+    // Release Direct3D Resources
+    if ( m_pVertexBuffer ) m_pVertexBuffer->Release();
+
+    // Reset pointers
+    m_pSplatLevel   = NULL;
+    m_pLayerUsage   = NULL;
+    m_pVertexBuffer = NULL;
+    m_pStagingVertices = NULL;
+    m_pStagingCompact  = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GenerateBlock ()
+// Desc : Generate this terrain block (BuildBlock followed by CreateResources).
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::GenerateBlock( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight,
+                                   const float * pSamples, ULONG SamplePitch )
+{
+    if ( !BuildBlock( pParent, StartX, StartZ, BlockWidth, BlockHeight, pSamples, SamplePitch ) ) return false;
+    return CreateResources();
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildBlock ()
+// Desc : Build the vertices, level of detail data, splat index lists and
+//        blend texels of this terrain block in system memory, ready for
+//        CreateResources. The heights are read from the parent's heightmap
+//        unless 'pSamples' is supplied, in which case it points at the
+//        block's first sample in an array 'SamplePitch' samples wide (a
+//        streamed tile, which must provide at least two samples beyond the
+//        far edges of the block for the normals). The splat levels are read
+//        from the parent's cache instead if the terrain is being loaded
+//        from one.
+// Note : Does not touch the device, so blocks may be built concurrently.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::BuildBlock( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight,
+                                const float * pSamples, ULONG SamplePitch )
+{
+    EDITRECT          Rect;
+    bool              bNormalMap;
+
+    // Validate requirements
+    if (!pParent) return false;
+
+    // Streamed samples are not covered by the precomputed normals
+    bNormalMap = ( !pSamples && pParent->HasNormalMap() );
+
+    // Read from the whole heightmap if no samples were supplied
+    if ( !pSamples )
+    {
+        if ( !pParent->GetHeightMap() ) return false;
+        pSamples    = pParent->GetHeightMap() + StartX + StartZ * pParent->GetTerrainWidth();
+        SamplePitch = pParent->GetTerrainWidth();
+
+    } // End if no samples
+
+    // Store some values
+    m_pParent      = pParent;
+    m_nStartX      = StartX;
+    m_nStartZ      = StartZ;
+    m_nBlockWidth  = BlockWidth;
+    m_nBlockHeight = BlockHeight;
+    m_nQuadsWide   = BlockWidth - 1;
+    m_nQuadsHigh   = BlockHeight - 1;
+
+    // Allocate the staging vertices
+    m_pStagingVertices = new CVertex[ BlockWidth * BlockHeight ];
+    if ( !m_pStagingVertices ) return false;
+
+    // Generate the vertex data and bounding box
+    Rect.MinX = 0; Rect.MaxX = BlockWidth - 1;
+    Rect.MinZ = 0; Rect.MaxZ = BlockHeight - 1;
+    BuildVertices( pSamples, SamplePitch, bNormalMap, Rect, m_pStagingVertices );
+    CalculateBounds( pSamples, SamplePitch );
+
+    // Quantize the vertices if the terrain is using compact vertices
+    if ( pParent->UseCompactVertices() && !QuantizeVertices() ) return false;
+
+    // Measure the error introduced by each level of detail
+    m_nLODCount = CTerrainLOD::GetLevelCount( m_nQuadsWide, m_nQuadsHigh );
+    CTerrainLOD::CalculateErrors( pSamples, SamplePitch, 0, 0, m_nQuadsWide, m_nQuadsHigh, m_pParent->GetScale().y, m_fLODError );
+
+    // Cooked terrain has the splat levels ready
+    if ( pParent->GetCache().IsOpen() ) return ReadSplats( pParent->GetCache() );
+
+    // Determine all the layers used by this block
+    if ( !CountLayerUsage( m_pParent->GetLayerCount() ) ) return false;
+
+    // Generate Splat Levels for this block
+    if ( !GenerateSplats() ) return false;
+
+    // Generate the blend maps
+    if ( !GenerateBlendMaps() ) return false;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildVertices () (Private)
+// Desc : Generate the vertices of the block within 'Rect' (block relative,
+//        inclusive). 'pSamples' points at the block's first sample, and
+//        'pVertices' at the first vertex of row 'Rect.MinZ' of a block sized
+//        vertex array (which may be a locked region of the vertex buffer).
+//-----------------------------------------------------------------------------
+void CTerrainBlock::BuildVertices( const float * pSamples, ULONG SamplePitch, bool bNormalMap, const EDITRECT & Rect, CVertex * pVertices )
+{
+    long              x, z;
+    ULONG             MapX, MapZ;
+    CVertex          *pVertex    = NULL;
+    D3DXVECTOR3       VertexPos, LightDir = D3DXVECTOR3( 0.650945f, -0.390567f, 0.650945f );
+
+    // Loop through and generate the vertex data
+    for ( z = Rect.MinZ; z <= Rect.MaxZ; z++ )
+    {
+        pVertex = pVertices + (z - Rect.MinZ) * m_nBlockWidth + Rect.MinX;
+
+        for ( x = Rect.MinX; x <= Rect.MaxX; x++ )
+        {
+            const float * pSample = pSamples + x + z * SamplePitch;
+            long          Pitch   = (long)SamplePitch;
+
+            // Position within the heightmap
+            MapX = m_nStartX + x;
+            MapZ = m_nStartZ + z;
+
+            VertexPos.x = (float)MapX * m_pParent->GetScale().x;
+            VertexPos.y = pSample[0] * m_pParent->GetScale().y;
+            VertexPos.z = (float)MapZ * m_pParent->GetScale().z;
+
+            // Calculate vertex colour scale
+            float fRed = 1.0f, fGreen = 1.0f, fBlue = 1.0f, fScale = 0.25f;
+            
+            // Generate average scale (for diffuse lighting calc)
+            if ( bNormalMap )
+            {
+                fScale  = D3DXVec3Dot( &m_pParent->GetHeightMapNormal( MapX, MapZ ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetHeightMapNormal( MapX + 1, MapZ ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetHeightMapNormal( MapX + 1, MapZ + 1 ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetHeightMapNormal( MapX, MapZ + 1 ), &(-LightDir));
+
+            } // End if normal map
+            else
+            {
+                fScale  = D3DXVec3Dot( &m_pParent->GetSampleNormal( pSample, Pitch, MapX, MapZ ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetSampleNormal( pSample + 1, Pitch, MapX + 1, MapZ ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetSampleNormal( pSample + 1 + Pitch, Pitch, MapX + 1, MapZ + 1 ), &(-LightDir));
+                fScale += D3DXVec3Dot( &m_pParent->GetSampleNormal( pSample + Pitch, Pitch, MapX, MapZ + 1 ), &(-LightDir));
+
+            } // End if calculate
+            fScale /= 4.0f;
+
+            // Increase Saturation
+            fScale += 0.25f; //0.05f; 
+
+            // Clamp colour saturation
+            if ( fScale > 1.0f ) fScale = 1.0f;
+            if ( fScale < 0.4f ) fScale = 0.4f;
+
+            // Store Vertex Values
+            pVertex->x       = VertexPos.x;
+            pVertex->y       = VertexPos.y;
+            pVertex->z       = VertexPos.z;
+            pVertex->Diffuse = D3DCOLOR_COLORVALUE( fRed * fScale, fGreen * fScale, fBlue * fScale, 1.0f );
+            pVertex->tu      = (float)MapX;
+            pVertex->tv      = (float)MapZ;
+            pVertex->tu2     = (float)x / m_nQuadsWide;
+            pVertex->tv2     = (float)z / m_nQuadsHigh;
+
+            // Move to next vertex
+            pVertex++;
+
+        } // Next Column
+    
+    } // Next Row
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalculateBounds () (Private)
+// Desc : Calculate the bounding box of the block from its samples.
+//-----------------------------------------------------------------------------
+void CTerrainBlock::CalculateBounds( const float * pSamples, ULONG SamplePitch )
+{
+    const D3DXVECTOR3 & Scale = m_pParent->GetScale();
+    D3DXVECTOR3         Corner[2];
+    ULONG               x, z;
+    float               y;
+
+    // Reset bounding box data
+    m_BoundsMin = D3DXVECTOR3( 999999.0f, 999999.0f, 999999.0f );
+    m_BoundsMax = D3DXVECTOR3( -999999.0f, -999999.0f, -999999.0f );
+
+    // Opposite corners on the x / z plane
+    Corner[0] = D3DXVECTOR3( (float)m_nStartX * Scale.x, 0.0f, (float)m_nStartZ * Scale.z );
+    Corner[1] = D3DXVECTOR3( (float)(m_nStartX + m_nQuadsWide) * Scale.x, 0.0f, (float)(m_nStartZ + m_nQuadsHigh) * Scale.z );
+    for ( x = 0; x < 2; x++ )
+    {
+        if ( Corner[x].x < m_BoundsMin.x ) m_BoundsMin.x = Corner[x].x;
+        if ( Corner[x].z < m_BoundsMin.z ) m_BoundsMin.z = Corner[x].z;
+        if ( Corner[x].x > m_BoundsMax.x ) m_BoundsMax.x = Corner[x].x;
+        if ( Corner[x].z > m_BoundsMax.z ) m_BoundsMax.z = Corner[x].z;
+
+    } // Next Corner
+
+    // Height range of the samples
+    for ( z = 0; z < m_nBlockHeight; z++ )
+    {
+        for ( x = 0; x < m_nBlockWidth; x++ )
+        {
+            y = pSamples[ x + z * SamplePitch ] * Scale.y;
+            if ( y < m_BoundsMin.y ) m_BoundsMin.y = y;
+            if ( y > m_BoundsMax.y ) m_BoundsMax.y = y;
+
+        } // Next Column
+
+    } // Next Row
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateResources ()
+// Desc : Create the vertex buffer, splat index buffers and blend textures of
+//        a block prepared by BuildBlock, and release the staging memory.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::CreateResources( )
+{
+    HRESULT           hRet;
+    USHORT            i;
+    ULONG             Usage      = D3DUSAGE_WRITEONLY;
+    ULONG             VertexBytes, FVF = VERTEX_FVF;
+    UCHAR            *pData      = NULL;
+    const void       *pVertices  = m_pStagingVertices;
+    LPDIRECT3DDEVICE9 pD3DDevice = NULL;
+
+    // Compact vertices are described by a declaration rather than an FVF
+    VertexBytes = (m_nBlockWidth * m_nBlockHeight) * sizeof(CVertex);
+    if ( m_pStagingCompact )
+    {
+        pVertices   = m_pStagingCompact;
+        VertexBytes = (m_nBlockWidth * m_nBlockHeight) * sizeof(CCompactVertex);
+        FVF         = 0;
+
+    } // End if compact
+
+    // Validate requirements
+    if ( !m_pParent || !m_pParent->GetD3DDevice() || !pVertices ) return false;
+    pD3DDevice  = m_pParent->GetD3DDevice();
+
+    // Calculate buffer usage
+    if ( !m_pParent->UseHardwareTnL() ) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+
+    // Create and fill the vertex buffer
+    hRet = pD3DDevice->CreateVertexBuffer( VertexBytes, Usage, FVF, D3DPOOL_MANAGED, &m_pVertexBuffer, NULL );
+    if (FAILED(hRet)) return false;
+    hRet = m_pVertexBuffer->Lock( 0, VertexBytes, (LPVOID*)&pData, 0 );
+    if (FAILED(hRet)) return false;
+    memcpy( pData, pVertices, VertexBytes );
+    m_pVertexBuffer->Unlock();
+
+    // Finished with the staging vertices
+    if ( m_pStagingVertices ) delete []m_pStagingVertices;
+    if ( m_pStagingCompact  ) delete []m_pStagingCompact;
+    m_pStagingVertices = NULL;
+    m_pStagingCompact  = NULL;
+
+    // Create each splat level's resources
+    for ( i = 0; i < m_nSplatCount; i++ )
+    {
+        if ( !CreateSplatResources( i ) ) return false;
+
+    } // Next Splat Level
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateSplatResources () (Private)
+// Desc : Create the index buffer and blend texture of one splat level from
+//        its staging data, and release the staging memory.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::CreateSplatResources( USHORT TerrainLayer )
+{
+    HRESULT           hRet;
+    ULONG             z, Width, Height;
+    ULONG             Usage      = D3DUSAGE_WRITEONLY;
+    ULONG             BlendTexels;
+    UCHAR            *pData      = NULL;
+    LPDIRECT3DDEVICE9 pD3DDevice = NULL;
+    D3DLOCKED_RECT    LockData;
+    const USHORT     *pIndices   = NULL, *pBlend = NULL;
+    CTerrainSplat   * pSplat     = m_pSplatLevel[ TerrainLayer ];
+
+    // Nothing to do if this layer is not in use
+    if ( !pSplat ) return true;
+
+    // Validate requirements
+    if ( !m_pParent || !m_pParent->GetD3DDevice() ) return false;
+    pD3DDevice  = m_pParent->GetD3DDevice();
+    BlendTexels = m_pParent->GetBlendTexRatio();
+
+    // Calculate buffer usage
+    if ( !m_pParent->UseHardwareTnL() ) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+
+    // Blend texture dimensions
+    Width  = m_nQuadsWide * BlendTexels;
+    Height = m_nQuadsHigh * BlendTexels;
+
+    if ( pSplat->m_bSharedIndices )
+    {
+        // Reference the terrain's shared index buffer
+        pSplat->m_pIndexBuffer = m_pParent->GetSharedIndices();
+        if ( !pSplat->m_pIndexBuffer ) return false;
+        pSplat->m_pIndexBuffer->AddRef();
+
+    } // End if shared
+    else if ( pSplat->m_pStagingIndices || pSplat->m_pCachedIndices )
+    {
+        // Uploaded from the staging indices, or straight from the mapped cache
+        pIndices = pSplat->m_pStagingIndices ? pSplat->m_pStagingIndices : pSplat->m_pCachedIndices;
+
+        // Index buffer (all levels of detail)
+        hRet = pD3DDevice->CreateIndexBuffer( pSplat->m_nStagingIndexCount * sizeof(USHORT), Usage, D3DFMT_INDEX16, D3DPOOL_MANAGED, &pSplat->m_pIndexBuffer, NULL );
+        if ( FAILED(hRet) ) return false;
+        hRet = pSplat->m_pIndexBuffer->Lock( 0, pSplat->m_nStagingIndexCount * sizeof(USHORT), (void**)&pData, 0 );
+        if ( FAILED(hRet) ) return false;
+        memcpy( pData, pIndices, pSplat->m_nStagingIndexCount * sizeof(USHORT) );
+        pSplat->m_pIndexBuffer->Unlock();
+
+        if ( pSplat->m_pStagingIndices ) delete []pSplat->m_pStagingIndices;
+        pSplat->m_pStagingIndices = NULL;
+        pSplat->m_pCachedIndices  = NULL;
+
+    } // End if own indices
+
+    // Blend texture (never built for layer 0)
+    pBlend = pSplat->m_pStagingBlend ? pSplat->m_pStagingBlend : pSplat->m_pCachedBlend;
+    if ( !pBlend ) return true;
+    hRet = pD3DDevice->CreateTexture( Width, Height, 1, 0, D3DFMT_A4R4G4B4, D3DPOOL_MANAGED, &pSplat->m_pBlendTexture, NULL );
+    if ( FAILED(hRet) ) return false;
+    hRet = pSplat->m_pBlendTexture->LockRect( 0, &LockData, NULL, 0 );
+    if ( FAILED(hRet) ) return false;
+
+    // Copy row by row, the texture may be padded
+    for ( z = 0; z < Height; z++ )
+    {
+        memcpy( (UCHAR*)LockData.pBits + z * LockData.Pitch, pBlend + z * Width, Width * sizeof(USHORT) );
+
+    } // Next Row
+    pSplat->m_pBlendTexture->UnlockRect( 0 );
+
+    if ( pSplat->m_pStagingBlend ) delete []pSplat->m_pStagingBlend;
+    pSplat->m_pStagingBlend = NULL;
+    pSplat->m_pCachedBlend  = NULL;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuantizeVertices () (Private)
+// Desc : Convert the staged vertices in to the compact format, measuring the
+//        height error this introduces.
+// Note : Heights are stored in 65536 steps between the bottom and top of the
+//        block, so the error is at most half of one step.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::QuantizeVertices( )
+{
+    ULONG   i, Count = m_nBlockWidth * m_nBlockHeight;
+    long    Steps;
+    float   Error;
+
+    // Allocate the compact vertices
+    m_pStagingCompact = new CCompactVertex[ Count ];
+    if ( !m_pStagingCompact ) return false;
+
+    // Calculate the step size, the bias moves a height of -32768 to the minimum
+    m_fHeightStep    = (m_BoundsMax.y - m_BoundsMin.y) / 65535.0f;
+    m_fHeightBias    = m_BoundsMin.y + 32768.0f * m_fHeightStep;
+    m_fQuantMaxError = 0.0f;
+    m_fQuantErrorSq  = 0.0f;
+
+    for ( i = 0; i < Count; i++ )
+    {
+        const CVertex  * pVertex  = &m_pStagingVertices[i];
+        CCompactVertex * pCompact = &m_pStagingCompact[i];
+
+        // Round to the nearest step
+        Steps = 0;
+        if ( m_fHeightStep > 0.0f ) Steps = (long)((pVertex->y - m_BoundsMin.y) / m_fHeightStep + 0.5f);
+        if ( Steps > 65535 ) Steps = 65535;
+        pCompact->Height = (short)(Steps - 32768);
+
+        // The lighting is grey, keep the blue channel
+        pCompact->Shade  = (short)(pVertex->Diffuse & 0xFF);
+
+        // Measure the height the shader will rebuild
+        Error = fabsf( (float)pCompact->Height * m_fHeightStep + m_fHeightBias - pVertex->y );
+        if ( Error > m_fQuantMaxError ) m_fQuantMaxError = Error;
+        m_fQuantErrorSq += Error * Error;
+
+    } // Next Vertex
+
+    // The full vertices are no longer required
+    delete []m_pStagingVertices;
+    m_pStagingVertices = NULL;
+
+    // Success!
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-// Name : ~CTerrainBlock () (Destructor)
-// Desc : CTerrainBlock Class Destructor
+// Name : MarkDirty ()
+// Desc : Flag a block relative rectangle of vertices (or of blend texels, and
+//        the splat levels of the first 'LayerCount' layers) for rebuilding
+//        by UpdateResources. Returns true if the block was not already
+//        waiting to be updated.
 //-----------------------------------------------------------------------------
-CTerrainBlock::~CTerrainBlock()
+bool CTerrainBlock::MarkDirty( const EDITRECT & Rect, bool Texels, USHORT LayerCount )
 {
-    ULONG i;
+    bool bListed = m_bDirty;
 
-	// Release Splat Levels
-    if ( m_pSplatLevel )
+    // Accumulate the region
+    if ( Texels )
     {
-        for ( i = 0; i < m_nSplatCount; i++ )
-        {
-            if ( m_pSplatLevel[i] ) delete m_pSplatLevel[i];
+        CTerrainBrush::UnionRect( m_DirtyTexels, Rect );
+        if ( LayerCount > m_nDirtyLayers ) m_nDirtyLayers = LayerCount;
 
-        } // Next Splat Level
+    } // End if texels
+    else
+    {
+        CTerrainBrush::UnionRect( m_DirtyVertices, Rect );
 
-        // Delete the array
-        delete []m_pSplatLevel;
+    } // End if vertices
 
-    } // End if Allocated
+    m_bDirty = true;
+    return !bListed;
+}
 
-    // Release flat arrays
-    if ( m_pLayerUsage ) delete []m_pLayerUsage;
+//-----------------------------------------------------------------------------
+// Name : UpdateResources ()
+// Desc : Rebuild everything flagged by MarkDirty, re-uploading only the
+//        modified parts of the vertex buffer and blend textures.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::UpdateResources( )
+{
+    bool bResult = true;
 
-    // Release Direct3D Resources
-    if ( m_pVertexBuffer ) m_pVertexBuffer->Release();
+    // Rebuild the vertices, then the splat levels
+    if ( !CTerrainBrush::IsRectEmpty( m_DirtyVertices ) && !UpdateVertices() ) bResult = false;
+    if ( m_nDirtyLayers > 0 && !UpdateSplats() ) bResult = false;
 
-    // Reset pointers
-    m_pSplatLevel   = NULL;
-    m_pLayerUsage   = NULL;
-    m_pVertexBuffer = NULL;
+    // Everything is up to date (or can't be brought up to date)
+    CTerrainBrush::ClearRect( m_DirtyVertices );
+    CTerrainBrush::ClearRect( m_DirtyTexels );
+    m_nDirtyLayers = 0;
+    m_bDirty       = false;
+
+    return bResult;
 }
 
 //-----------------------------------------------------------------------------
-// Name : GenerateBlock ()
-// Desc : Generate this terrain block.
+// Name : UpdateVertices () (Private)
+// Desc : Rebuild the dirty vertices from the parent's heightmap, along with
+//        the bounding box and level of detail errors. Only the rows of the
+//        vertex buffer containing them are locked.
+// Note : Compact heights are quantized between the block's lowest and
+//        highest points, which may have moved, so the whole block is
+//        requantized (it is only 4 bytes per vertex).
 //-----------------------------------------------------------------------------
-bool CTerrainBlock::GenerateBlock( CTerrain * pParent, ULONG StartX, ULONG StartZ, ULONG BlockWidth, ULONG BlockHeight )
+bool CTerrainBlock::UpdateVertices( )
 {
-    ULONG             x, z;
-    HRESULT           hRet;
-    ULONG             Usage      = D3DUSAGE_WRITEONLY;
-    USHORT           *pIndex     = NULL;
-    CVertex          *pVertex    = NULL;
-    float            *pHeightMap = NULL;
-    LPDIRECT3DDEVICE9 pD3DDevice = NULL;
-    D3DXVECTOR3       VertexPos, LightDir = D3DXVECTOR3( 0.650945f, -0.390567f, 0.650945f );
+    HRESULT       hRet;
+    EDITRECT      Rect = m_DirtyVertices;
+    ULONG         Offset, Bytes, Pitch;
+    UCHAR       * pData = NULL;
+    const float * pSamples;
 
     // Validate requirements
-    if (!pParent || !pParent->GetD3DDevice() || !pParent->GetHeightMap()) return false;
+    if ( !m_pParent || !m_pParent->GetHeightMap() || !m_pVertexBuffer ) return false;
+    Pitch    = m_pParent->GetTerrainWidth();
+    pSamples = m_pParent->GetHeightMap() + m_nStartX + m_nStartZ * Pitch;
 
-    // Store some values
-    m_pParent      = pParent;
-    m_nStartX      = StartX;
-    m_nStartZ      = StartZ;
-    m_nBlockWidth  = BlockWidth;
-    m_nBlockHeight = BlockHeight;
-    m_nQuadsHigh   = BlockHeight - 1;
-    m_nQuadsWide   = BlockWidth - 1;
-    m_nQuadsHigh   = BlockHeight - 1;
-    pHeightMap     = pParent->GetHeightMap();
-    pD3DDevice     = pParent->GetD3DDevice();
+    // The bounds and errors depend on the whole block
+    CalculateBounds( pSamples, Pitch );
+    CTerrainLOD::CalculateErrors( pSamples, Pitch, 0, 0, m_nQuadsWide, m_nQuadsHigh, m_pParent->GetScale().y, m_fLODError );
 
-    // Calculate buffer usage
-    if ( !m_pParent->UseHardwareTnL() ) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+    if ( m_pParent->UseCompactVertices() )
+    {
+        // Rebuild & requantize every vertex
+        m_pStagingVertices = new CVertex[ m_nBlockWidth * m_nBlockHeight ];
+        if ( !m_pStagingVertices ) return false;
+        Rect.MinX = 0; Rect.MaxX = m_nBlockWidth - 1;
+        Rect.MinZ = 0; Rect.MaxZ = m_nBlockHeight - 1;
+        BuildVertices( pSamples, Pitch, m_pParent->HasNormalMap(), Rect, m_pStagingVertices );
+        if ( !QuantizeVertices() ) return false;
+
+        // Upload them
+        Bytes = (m_nBlockWidth * m_nBlockHeight) * sizeof(CCompactVertex);
+        hRet  = m_pVertexBuffer->Lock( 0, Bytes, (LPVOID*)&pData, 0 );
+        if ( SUCCEEDED(hRet) )
+        {
+            memcpy( pData, m_pStagingCompact, Bytes );
+            m_pVertexBuffer->Unlock();
 
-    // Create the vertex buffer ready for generation
-    hRet = pD3DDevice->CreateVertexBuffer((BlockWidth * BlockHeight) * sizeof(CVertex), Usage, VERTEX_FVF, D3DPOOL_MANAGED, &m_pVertexBuffer, NULL );
-    if (FAILED(hRet)) return false;
+        } // End if locked
 
-    // Lock the vertex buffer ready to fill data
-    hRet = m_pVertexBuffer->Lock( 0, (BlockWidth * BlockHeight) * sizeof(CVertex), (LPVOID*)&pVertex, 0 );
-    if (FAILED(hRet)) return false;
+        // Finished with the staging vertices
+        delete []m_pStagingCompact;
+        m_pStagingCompact = NULL;
+        if ( FAILED(hRet) ) return false;
 
-    // Reset bounding box data
-    m_BoundsMin = D3DXVECTOR3( 999999.0f, 999999.0f, 999999.0f );
-    m_BoundsMax = D3DXVECTOR3( -999999.0f, -999999.0f, -999999.0f );
+    } // End if compact
+    else
+    {
+        // Lock the rows containing the dirty vertices, and build them in place
+        Offset = Rect.MinZ * m_nBlockWidth * sizeof(CVertex);
+        Bytes  = (Rect.MaxZ - Rect.MinZ + 1) * m_nBlockWidth * sizeof(CVertex);
+        hRet   = m_pVertexBuffer->Lock( Offset, Bytes, (LPVOID*)&pData, 0 );
+        if ( FAILED(hRet) ) return false;
+        BuildVertices( pSamples, Pitch, m_pParent->HasNormalMap(), Rect, (CVertex*)pData );
+        m_pVertexBuffer->Unlock();
 
-    // Loop through and generate the vertex data
-    for ( z = StartZ; z < StartZ + BlockHeight; z++ )
+    } // End if full vertices
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateSplats () (Private)
+// Desc : Bring the dirty splat levels up to date with the painted blend maps.
+//        While a layer covers the same quads only the dirty blend texels are
+//        re-uploaded, otherwise the splat level is rebuilt (it may also
+//        appear or disappear entirely).
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::UpdateSplats( )
+{
+    USHORT    i, LayerCount = m_nDirtyLayers;
+    bool      bFullCoverage, bResult = true;
+    UCHAR   * pQuadMask;
+
+    // Validate requirements
+    if ( LayerCount > m_nSplatCount ) LayerCount = m_nSplatCount;
+    if ( !CountLayerUsage( LayerCount ) ) return false;
+    pQuadMask = new UCHAR[ m_nQuadsWide * m_nQuadsHigh ];
+    if ( !pQuadMask ) return false;
+
+    for ( i = 0; i < LayerCount && bResult; i++ )
     {
-        for ( x = StartX; x < StartX + BlockWidth; x++ )
+        CTerrainSplat * pSplat = m_pSplatLevel[i];
+
+        // Painted out of this block entirely ?
+        if ( !m_pLayerUsage[i] )
         {
-            VertexPos.x = (float)x * m_pParent->GetScale().x;
-            VertexPos.y = pHeightMap[ x + z * pParent->GetTerrainWidth() ] * m_pParent->GetScale().y;
-            VertexPos.z = (float)z * m_pParent->GetScale().z;
+            if ( pSplat ) delete pSplat;
+            m_pSplatLevel[i] = NULL;
+            continue;
 
-            // Calculate vertex colour scale
-            float fRed = 1.0f, fGreen = 1.0f, fBlue = 1.0f, fScale = 0.25f;
-            
-            // Generate average scale (for diffuse lighting calc)
-            fScale  = D3DXVec3Dot( &pParent->GetHeightMapNormal( x, z ), &(-LightDir));
-            fScale += D3DXVec3Dot( &pParent->GetHeightMapNormal( x + 1, z ), &(-LightDir));
-            fScale += D3DXVec3Dot( &pParent->GetHeightMapNormal( x + 1, z + 1 ), &(-LightDir));
-            fScale += D3DXVec3Dot( &pParent->GetHeightMapNormal( x, z + 1 ), &(-LightDir));
-            fScale /= 4.0f;
+        } // End if unused
 
-            // Increase Saturation
-            fScale += 0.25f; //0.05f; 
+        // Covering the same quads, just re-upload the texels
+        BuildQuadMask( i, pQuadMask, bFullCoverage );
+        if ( pSplat && pSplat->m_pQuadMask && memcmp( pQuadMask, pSplat->m_pQuadMask, m_nQuadsWide * m_nQuadsHigh ) == 0 )
+        {
+            if ( !UpdateBlendTexture( pSplat ) ) bResult = false;
+            continue;
 
-            // Clamp colour saturation
-            if ( fScale > 1.0f ) fScale = 1.0f;
-            if ( fScale < 0.4f ) fScale = 0.4f;
+        } // End if same coverage
 
-            // Store Vertex Values
-            pVertex->x       = VertexPos.x;
-            pVertex->y       = VertexPos.y;
-            pVertex->z       = VertexPos.z;
-            pVertex->Diffuse = D3DCOLOR_COLORVALUE( fRed * fScale, fGreen * fScale, fBlue * fScale, 1.0f );
-            pVertex->tu      = (float)x;
-            pVertex->tv      = (float)z;
-            pVertex->tu2     = (float)(x - StartX) / m_nQuadsWide;
-            pVertex->tv2     = (float)(z - StartZ) / m_nQuadsHigh;
-
-            // Calculate bounding box data
-            if ( VertexPos.x < m_BoundsMin.x ) m_BoundsMin.x = VertexPos.x;
-            if ( VertexPos.y < m_BoundsMin.y ) m_BoundsMin.y = VertexPos.y;
-            if ( VertexPos.z < m_BoundsMin.z ) m_BoundsMin.z = VertexPos.z;
-            if ( VertexPos.x > m_BoundsMax.x ) m_BoundsMax.x = VertexPos.x;
-            if ( VertexPos.y > m_BoundsMax.y ) m_BoundsMax.y = VertexPos.y;
-            if ( VertexPos.z > m_BoundsMax.z ) m_BoundsMax.z = VertexPos.z;
-            
-            // Move to next vertex
-            pVertex++;
+        // Rebuild the splat level
+        if ( pSplat ) delete pSplat;
+        m_pSplatLevel[i] = NULL;
+        if ( !GenerateSplatLevel( i ) || !GenerateBlendMap( i ) || !CreateSplatResources( i ) ) bResult = false;
 
-        } // Next Column
-    
-    } // Next Row
+    } // Next Layer
 
-    // Finished with the vertex buffer
-    m_pVertexBuffer->Unlock();
+    // Clean up
+    delete []pQuadMask;
+    return bResult;
+}
 
-    // Determine all the layers used by this block
-    if ( !CountLayerUsage() ) return false;
+//-----------------------------------------------------------------------------
+// Name : UpdateBlendTexture () (Private)
+// Desc : Re-upload the dirty texels of a splat level's blend texture, locking
+//        only that rectangle.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::UpdateBlendTexture( CTerrainSplat * pSplat )
+{
+    HRESULT         hRet;
+    RECT            Rect;
+    D3DLOCKED_RECT  LockData;
+    long            x, z;
+    ULONG           BlendTexels = m_pParent->GetBlendTexRatio();
+    CTerrainLayer * pLayer      = m_pParent->GetLayer( pSplat->m_nLayerIndex );
+
+    // The base layer has no blend texture
+    if ( !pSplat->m_pBlendTexture || CTerrainBrush::IsRectEmpty( m_DirtyTexels ) ) return true;
+
+    // Lock the dirty rectangle
+    Rect.left   = m_DirtyTexels.MinX;
+    Rect.top    = m_DirtyTexels.MinZ;
+    Rect.right  = m_DirtyTexels.MaxX + 1;
+    Rect.bottom = m_DirtyTexels.MaxZ + 1;
+    hRet = pSplat->m_pBlendTexture->LockRect( 0, &LockData, &Rect, 0 );
+    if ( FAILED(hRet) ) return false;
+
+    // Copy the texels row by row
+    for ( z = m_DirtyTexels.MinZ; z <= m_DirtyTexels.MaxZ; z++ )
+    {
+        USHORT      * pTexel = (USHORT*)((UCHAR*)LockData.pBits + (z - m_DirtyTexels.MinZ) * LockData.Pitch);
+        const UCHAR * pValue = pLayer->m_pBlendMap + (m_nStartX * BlendTexels) + (z + m_nStartZ * BlendTexels) * pLayer->m_nLayerWidth;
 
-    // Generate Splat Levels for this block
-    if ( !GenerateSplats() ) return false;
+        for ( x = m_DirtyTexels.MinX; x <= m_DirtyTexels.MaxX; x++ ) *pTexel++ = EncodeBlend( pValue[x] );
 
-    // Generate the blend maps
-    if ( !GenerateBlendMaps() ) return false;
+    } // Next Row
+    pSplat->m_pBlendTexture->UnlockRect( 0 );
 
     // Success!
     return true;
 }
 
-
 //-----------------------------------------------------------------------------
 // Name : CountLayerUsage () (Private)
-// Desc : Count up the number of times a layer is used by this block.
+// Desc : Count up the number of times each of the first 'LayerCount' layers
+//        is used by this block.
 //-----------------------------------------------------------------------------
-bool CTerrainBlock::CountLayerUsage()
+bool CTerrainBlock::CountLayerUsage( USHORT LayerCount )
 {
     USHORT i;
     ULONG  x, z;
     UCHAR  Value;
 
     // Allocate the layer usage array
-    m_pLayerUsage = new USHORT[ m_pParent->GetLayerCount() ];
-    if( !m_pLayerUsage ) return false;
-    ZeroMemory( m_pLayerUsage, m_pParent->GetLayerCount() * sizeof(USHORT));
+    if ( !m_pLayerUsage )
+    {
+        m_pLayerUsage = new USHORT[ m_pParent->GetLayerCount() ];
+        if( !m_pLayerUsage ) return false;
+        ZeroMemory( m_pLayerUsage, m_pParent->GetLayerCount() * sizeof(USHORT));
+
+    } // End if not allocated
+    ZeroMemory( m_pLayerUsage, LayerCount * sizeof(USHORT));
 
     // Pre-Calculate loop counts
     ULONG LoopStartX = (m_nStartX * m_pParent->GetBlendTexRatio());
@@ -1098,7 +2620,7 @@ bool CTerrainBlock::CountLayerUsage()
         for ( x = LoopStartX; x < LoopEndX; x++ )
         {
             // Loop through each layer
-            for ( i = 0; i < m_pParent->GetLayerCount(); i++ )
+            for ( i = 0; i < LayerCount; i++ )
             {
                 CTerrainLayer * pLayer = m_pParent->GetLayer(i);
 
@@ -1142,25 +2664,158 @@ bool CTerrainBlock::GenerateSplats()
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Name : ReadSplats () (Private)
+// Desc : Set up this block's layer usage and splat levels from its record in
+//        the cooked terrain. The index lists and blend texels are left in the
+//        mapped file, CreateResources uploads them directly from there.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::ReadSplats( const CTerrainCache & Cache )
+{
+    CACHECURSOR         Cursor;
+    const CACHESPLAT  * pRecord;
+    const USHORT      * pUsage;
+    USHORT              i, LayerCount = m_pParent->GetLayerCount();
+    ULONG               Level, Range, BlocksWide, BlendTexels;
+
+    // Find this block's record
+    BlocksWide  = (m_pParent->GetTerrainWidth() - 1) / m_nQuadsWide;
+    BlendTexels = (m_nQuadsWide * m_pParent->GetBlendTexRatio()) * (m_nQuadsHigh * m_pParent->GetBlendTexRatio());
+    if ( !Cache.GetBlock( (m_nStartX / m_nQuadsWide) + (m_nStartZ / m_nQuadsHigh) * BlocksWide, Cursor ) ) return false;
+
+    // Retrieve the layer usage
+    pUsage = (const USHORT*)CTerrainCache::Read( Cursor, LayerCount * sizeof(USHORT) );
+    if ( !pUsage ) return false;
+    if ( !m_pLayerUsage ) m_pLayerUsage = new USHORT[ LayerCount ];
+    if ( !m_pLayerUsage ) return false;
+    memcpy( m_pLayerUsage, pUsage, LayerCount * sizeof(USHORT) );
+
+    // Allocate the required number of splat levels
+    if ( AddSplatLevel( LayerCount ) < 0 ) return false;
+
+    // Each layer in use has a splat level
+    for ( i = 0; i < LayerCount; i++ )
+    {
+        if ( !m_pLayerUsage[i] ) continue;
+
+        // Retrieve the splat record
+        pRecord = (const CACHESPLAT*)CTerrainCache::Read( Cursor, sizeof(CACHESPLAT) );
+        if ( !pRecord || pRecord->Layer != i || pRecord->LODCount > MAX_TERRAIN_LOD ) return false;
+        if ( (pRecord->SharedIndices != 0) != (pRecord->IndexCount == 0) ) return false;
+        if ( pRecord->BlendTexels != 0 && pRecord->BlendTexels != BlendTexels ) return false;
+
+        // Allocate a new splat
+        CTerrainSplat * pSplat = new CTerrainSplat;
+        if ( !pSplat ) return false;
+        m_pSplatLevel[i] = pSplat;
+
+        // Store the splat details
+        pSplat->m_nLayerIndex    = i;
+        pSplat->m_nLODCount      = pRecord->LODCount;
+        pSplat->m_bSharedIndices = ( pRecord->SharedIndices != 0 );
+        for ( Level = 0; Level < pSplat->m_nLODCount; Level++ )
+        {
+            for ( Range = 0; Range < CTerrainLOD::RANGE_COUNT; Range++ )
+            {
+                pSplat->m_LODRange[Level][Range].StartIndex     = pRecord->Ranges[Level][Range][0];
+                pSplat->m_LODRange[Level][Range].PrimitiveCount = pRecord->Ranges[Level][Range][1];
+
+            } // Next Range
+
+        } // Next Level
+
+        // Full detail index & primitive counts
+        for ( Range = CTerrainLOD::RANGE_INTERIOR; Range < CTerrainLOD::RANGE_STITCHED; Range++ )
+        {
+            pSplat->m_nPrimitiveCount += pSplat->m_LODRange[0][Range].PrimitiveCount;
+
+        } // Next Range
+        pSplat->m_nIndexCount = pSplat->m_nPrimitiveCount * 3;
+
+        // Reference the index list and blend texels
+        if ( pRecord->IndexCount )
+        {
+            pSplat->m_pCachedIndices     = (const USHORT*)CTerrainCache::Read( Cursor, pRecord->IndexCount * sizeof(USHORT) );
+            pSplat->m_nStagingIndexCount = pRecord->IndexCount;
+            if ( !pSplat->m_pCachedIndices ) return false;
+
+        } // End if own indices
+        if ( pRecord->BlendTexels )
+        {
+            pSplat->m_pCachedBlend = (const USHORT*)CTerrainCache::Read( Cursor, pRecord->BlendTexels * sizeof(USHORT) );
+            if ( !pSplat->m_pCachedBlend ) return false;
+
+        } // End if blended
+
+    } // Next Layer
+
+    // Success!!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteSplats ()
+// Desc : Write this block's layer usage and splat levels to the terrain
+//        being cooked, as record 'Index'. Must be called after BuildBlock and
+//        before CreateResources releases the staging data.
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::WriteSplats( CTerrainCache & Cache, ULONG Index ) const
+{
+    CACHESPLAT  Record;
+    USHORT      i;
+    ULONG       Level, Range, BlendTexels;
+
+    // Validate requirements
+    if ( !m_pParent || !m_pLayerUsage ) return false;
+    BlendTexels = (m_nQuadsWide * m_pParent->GetBlendTexRatio()) * (m_nQuadsHigh * m_pParent->GetBlendTexRatio());
+
+    // Layer usage first
+    if ( !Cache.BeginBlock( Index ) ) return false;
+    if ( !Cache.Write( m_pLayerUsage, m_pParent->GetLayerCount() * sizeof(USHORT) ) ) return false;
+
+    // Then each splat level
+    for ( i = 0; i < m_nSplatCount; i++ )
+    {
+        const CTerrainSplat * pSplat = m_pSplatLevel[i];
+        if ( !pSplat ) continue;
+
+        // Build the record
+        ZeroMemory( &Record, sizeof(CACHESPLAT) );
+        Record.Layer         = i;
+        Record.SharedIndices = pSplat->m_bSharedIndices ? 1 : 0;
+        Record.LODCount      = pSplat->m_nLODCount;
+        Record.IndexCount    = pSplat->m_pStagingIndices ? pSplat->m_nStagingIndexCount : 0;
+        Record.BlendTexels   = pSplat->m_pStagingBlend ? BlendTexels : 0;
+        for ( Level = 0; Level < pSplat->m_nLODCount; Level++ )
+        {
+            for ( Range = 0; Range < CTerrainLOD::RANGE_COUNT; Range++ )
+            {
+                Record.Ranges[Level][Range][0] = pSplat->m_LODRange[Level][Range].StartIndex;
+                Record.Ranges[Level][Range][1] = pSplat->m_LODRange[Level][Range].PrimitiveCount;
+
+            } // Next Range
+
+        } // Next Level
+
+        // Followed by its indices and blend texels
+        if ( !Cache.Write( &Record, sizeof(CACHESPLAT) ) ) return false;
+        if ( !Cache.Write( pSplat->m_pStagingIndices, Record.IndexCount * sizeof(USHORT) ) ) return false;
+        if ( !Cache.Write( pSplat->m_pStagingBlend, Record.BlendTexels * sizeof(USHORT) ) ) return false;
+
+    } // Next Splat Level
+
+    return Cache.EndBlock();
+}
+
 //-----------------------------------------------------------------------------
 // Name : GenerateSplatLevel () (Private)
 // Desc : Generate an individual splat level for this terrain block.
 //-----------------------------------------------------------------------------
 bool CTerrainBlock::GenerateSplatLevel( USHORT TerrainLayer )
 {
-    HRESULT   hRet;
     USHORT   *pIndex = NULL;
-    ULONG     x, z, ax, az;
-    UCHAR     Value;
-    float     BlendTexels = m_pParent->GetBlendTexRatio();
-
-    LPDIRECT3DDEVICE9 pD3DDevice = m_pParent->GetD3DDevice();
-    bool HardwareTnL = m_pParent->UseHardwareTnL();
-    CTerrainLayer * pLayer = m_pParent->GetLayer( TerrainLayer );
-
-    // Calculate usage variable
-    ULONG Usage = D3DUSAGE_WRITEONLY;
-    if (!HardwareTnL) Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+    ULONG     Level, IndexCount = 0;
+    bool      bFullCoverage;
 
     // Allocate a new splat
     CTerrainSplat * pSplat = new CTerrainSplat;
@@ -1172,15 +2827,80 @@ bool CTerrainBlock::GenerateSplatLevel( USHORT TerrainLayer )
     // Store layer index (handy later on)
     pSplat->m_nLayerIndex = TerrainLayer;
 
-    // Create the index buffer ready for generation
-    hRet = pD3DDevice->CreateIndexBuffer( ((m_nQuadsWide * m_nQuadsHigh) * 6) * sizeof(USHORT), Usage, D3DFMT_INDEX16, D3DPOOL_MANAGED, &pSplat->m_pIndexBuffer, NULL );
-    if ( FAILED(hRet ) ) return false;
+    // Allocate the quad usage mask
+    UCHAR * pQuadMask = new UCHAR[ m_nQuadsWide * m_nQuadsHigh ];
+    if ( !pQuadMask ) return false;
+
+    // Determine which quads this layer is visible in
+    BuildQuadMask( TerrainLayer, pQuadMask, bFullCoverage );
+
+    // Measure the index sets for every level of detail
+    pSplat->m_nLODCount = CTerrainLOD::GetLevelCount( m_nQuadsWide, m_nQuadsHigh );
+    for ( Level = 0; Level < pSplat->m_nLODCount; Level++ )
+    {
+        IndexCount += CTerrainLOD::BuildIndices( m_nQuadsWide, m_nQuadsHigh, Level, pQuadMask, NULL, IndexCount, pSplat->m_LODRange[Level] );
+
+    } // Next Level
+
+    // A splat covering every quad uses the terrain's shared index buffer,
+    // whose levels are laid out at the ranges we've just measured
+    if ( bFullCoverage && m_pParent->UseSharedIndices() )
+    {
+        pSplat->m_bSharedIndices = true;
+
+    } // End if shared
+    else
+    {
+        // Allocate the staging indices (all levels are stored)
+        if ( IndexCount == 0 ) IndexCount = 1;
+        pSplat->m_pStagingIndices    = new USHORT[ IndexCount ];
+        pSplat->m_nStagingIndexCount = IndexCount;
+        if ( !pSplat->m_pStagingIndices ) { delete []pQuadMask; return false; }
+        pIndex = pSplat->m_pStagingIndices;
+        pIndex[0] = 0;
+
+        // Calculate the indices for each level's splat tri-lists
+        for ( Level = 0, IndexCount = 0; Level < pSplat->m_nLODCount; Level++ )
+        {
+            IndexCount += CTerrainLOD::BuildIndices( m_nQuadsWide, m_nQuadsHigh, Level, pQuadMask, pIndex + IndexCount, IndexCount, pSplat->m_LODRange[Level] );
+
+        } // Next Level
+
+    } // End if own indices
+
+    // Full detail index & primitive counts
+    for ( Level = CTerrainLOD::RANGE_INTERIOR; Level < CTerrainLOD::RANGE_STITCHED; Level++ )
+    {
+        pSplat->m_nPrimitiveCount += pSplat->m_LODRange[0][Level].PrimitiveCount;
+
+    } // Next Range
+    pSplat->m_nIndexCount = pSplat->m_nPrimitiveCount * 3;
+
+    // Editable terrain keeps the mask, to tell when painting changes it
+    if ( m_pParent->IsEditable() )
+        pSplat->m_pQuadMask = pQuadMask;
+    else
+        delete []pQuadMask;
+
+    // Success!!
+    return true;
+
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildQuadMask () (Private)
+// Desc : Determine which of the block's quads a layer is visible in (any of
+//        its blend texels are non zero), and whether that is all of them.
+//-----------------------------------------------------------------------------
+void CTerrainBlock::BuildQuadMask( USHORT TerrainLayer, UCHAR * pQuadMask, bool & bFullCoverage )
+{
+    ULONG     x, z, ax, az;
+    UCHAR     Value = 0;
+    ULONG     BlendTexels = m_pParent->GetBlendTexRatio();
 
-    // Lock the index buffer ready to fill data
-    hRet = pSplat->m_pIndexBuffer->Lock( 0, ((m_nQuadsWide * m_nQuadsHigh) * 6) * sizeof(USHORT), (void**)&pIndex, 0 );
-    if ( FAILED(hRet ) ) return false;
+    CTerrainLayer * pLayer = m_pParent->GetLayer( TerrainLayer );
 
-    // Calculate the indices for the splat tri-list
+    bFullCoverage = true;
     for ( z = 0; z < m_nQuadsHigh; z++ )
     {
         // Pre-Calc Loop starts / ends
@@ -1210,27 +2930,29 @@ bool CTerrainBlock::GenerateSplatLevel( USHORT TerrainLayer )
             } // Next Alpha Row
 
             // Should we write the quad here ?
-            if ( Value == 0 ) continue;
-
-            // Insert next two triangles
-            *pIndex++ = (USHORT)(x + z * m_nBlockWidth);
-            *pIndex++ = (USHORT)(x + (z + 1) * m_nBlockWidth);
-            *pIndex++ = (USHORT)((x + 1) + (z + 1) * m_nBlockWidth);
-
-            *pIndex++ = (USHORT)(x + z * m_nBlockWidth);
-            *pIndex++ = (USHORT)((x + 1) + (z + 1) * m_nBlockWidth);
-            *pIndex++ = (USHORT)((x + 1) + z * m_nBlockWidth);
-
-            // Increase our index & Primitive counts
-            pSplat->m_nIndexCount     += 6;
-            pSplat->m_nPrimitiveCount += 2;
+            pQuadMask[ x + z * m_nQuadsWide ] = ( Value > 0 );
+            if ( Value == 0 ) bFullCoverage = false;
 
         } // Next Element Column
     
     } // Next Element ROw
+}
+
+//-----------------------------------------------------------------------------
+// Name : GenerateBlendMaps () (Private)
+// Desc : Now generate the blend maps to blend the splats together (in to
+//        staging memory, in the A4R4G4B4 texture format).
+//-----------------------------------------------------------------------------
+bool CTerrainBlock::GenerateBlendMaps( )
+{
+    USHORT i;
+
+    // Calculate each splats blend map
+    for ( i = 0; i < m_nSplatCount; i++ )
+    {
+        if ( !GenerateBlendMap( i ) ) return false;
 
-    // Unlock the index buffer
-    pSplat->m_pIndexBuffer->Unlock();
+    } // Next Splat Level        
 
     // Success!!
     return true;
@@ -1238,68 +2960,42 @@ bool CTerrainBlock::GenerateSplatLevel( USHORT TerrainLayer )
 }
 
 //-----------------------------------------------------------------------------
-// Name : GenerateBlendMaps () (Private)
-// Desc : Now generate the blend maps to blend the splats together.
+// Name : GenerateBlendMap () (Private)
+// Desc : Generate the staging blend texels of a single splat level.
 //-----------------------------------------------------------------------------
-bool CTerrainBlock::GenerateBlendMaps( )
+bool CTerrainBlock::GenerateBlendMap( USHORT TerrainLayer )
 {
-    HRESULT hRet;
-    ULONG Width, Height, i, x, z;
-    LPDIRECT3DDEVICE9 pD3DDevice = m_pParent->GetD3DDevice();
-    D3DLOCKED_RECT LockData;
-    UCHAR Value;
+    ULONG Width, Height, x, z;
     ULONG BlendTexels = m_pParent->GetBlendTexRatio();
 
-    // Bail if we have no data
-    if ( m_nSplatCount == 0 ) return true;
+    // Bail if this is an empty splat level
+    if ( !m_pSplatLevel[TerrainLayer] ) return true;
+
+    CTerrainLayer * pLayer = m_pParent->GetLayer( TerrainLayer );
+    
+    // We never generate an alpha map for terrain layer 0
+    if ( m_pSplatLevel[TerrainLayer]->m_nLayerIndex == 0) return true;
     
     // Calculate width / height of the texture
     Width = (m_nQuadsWide * BlendTexels);
     Height = (m_nQuadsHigh * BlendTexels);
     
-    // Calculate each splats blend map
-    for ( i = 0; i < m_nSplatCount; i++ )
-    {
-        // Bail if this is an empty splat level
-        if ( !m_pSplatLevel[i] ) continue;
-
-        CTerrainLayer * pLayer = m_pParent->GetLayer( i );
-        
-        // We never generate an alpha map for terrain layer 0
-        if ( m_pSplatLevel[i]->m_nLayerIndex == 0) continue;
-        
-        // Create our blend texture
-        hRet = pD3DDevice->CreateTexture( Width, Height, 1, 0, D3DFMT_A4R4G4B4, D3DPOOL_MANAGED, &m_pSplatLevel[i]->m_pBlendTexture, NULL );
-        if ( FAILED(hRet) ) return false;
-            
-        // Lock the texture
-        hRet = m_pSplatLevel[i]->m_pBlendTexture->LockRect( 0, &LockData, NULL, 0 );
-        if ( FAILED(hRet) ) return false;
-         
-        USHORT * pBuffer = (USHORT*)LockData.pBits;
+    // Allocate the staging texels
+    USHORT * pBuffer = new USHORT[ Width * Height ];
+    if ( !pBuffer ) return false;
+    m_pSplatLevel[TerrainLayer]->m_pStagingBlend = pBuffer;
 
-        // Loop through each pixel and store
-        for ( z = 0; z < Height; z++ )
+    // Loop through each pixel and store
+    for ( z = 0; z < Height; z++ )
+    {
+        for ( x = 0; x < Width; x++, pBuffer++ )
         {
-            for ( x = 0; x < Width; x++, pBuffer++ )
-            {
-                // Retrieve alpha value
-                Value = pLayer->m_pBlendMap[ (x + (m_nStartX * BlendTexels)) + (z + (m_nStartZ * BlendTexels)) * pLayer->m_nLayerWidth ];
-
-                // Store value in buffer ( Shift right 4 and left 12 )
-                *pBuffer = ((LONG)Value << 8) & 0xF000;
-            
-            } // Next Column
-
-            // Add on pitch tail
-            pBuffer += LockData.Pitch - ( Width * sizeof(USHORT) );
+            // Retrieve alpha value
+            *pBuffer = EncodeBlend( pLayer->m_pBlendMap[ (x + (m_nStartX * BlendTexels)) + (z + (m_nStartZ * BlendTexels)) * pLayer->m_nLayerWidth ] );
         
-        } // Next Row
-
-        // Unlock the blend texture
-        m_pSplatLevel[i]->m_pBlendTexture->UnlockRect( 0 );
+        } // Next Column
 
-    } // Next Splat Level        
+    } // Next Row
 
     // Success!!
     return true;
@@ -1342,23 +3038,79 @@ long CTerrainBlock::AddSplatLevel( USHORT Count )
     return m_nSplatCount - Count;
 }
 
+//-----------------------------------------------------------------------------
+// Name : SelectLOD ()
+// Desc : Select the coarsest level of detail whose error, projected from the
+//        nearest point of our bounding box, stays within the pixel threshold.
+//-----------------------------------------------------------------------------
+void CTerrainBlock::SelectLOD( const D3DXVECTOR3 & CameraPos, float PixelScale, float MaxPixelError )
+{
+    D3DXVECTOR3 Closest;
+
+    // Find the nearest point of the bounding box
+    Closest = CameraPos;
+    if ( Closest.x < m_BoundsMin.x ) Closest.x = m_BoundsMin.x;
+    if ( Closest.y < m_BoundsMin.y ) Closest.y = m_BoundsMin.y;
+    if ( Closest.z < m_BoundsMin.z ) Closest.z = m_BoundsMin.z;
+    if ( Closest.x > m_BoundsMax.x ) Closest.x = m_BoundsMax.x;
+    if ( Closest.y > m_BoundsMax.y ) Closest.y = m_BoundsMax.y;
+    if ( Closest.z > m_BoundsMax.z ) Closest.z = m_BoundsMax.z;
+
+    // Select the level
+    m_nLOD = CTerrainLOD::SelectLevel( m_fLODError, m_nLODCount, D3DXVec3Length( &(CameraPos - Closest) ), PixelScale, MaxPixelError );
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateStitching ()
+// Desc : Determine which of our edges border a coarser neighbour. Must be
+//        called once every block has its final level of detail.
+//-----------------------------------------------------------------------------
+void CTerrainBlock::UpdateStitching( )
+{
+    // Neighbour table entries for each CTerrainLOD::EDGE
+    static const ULONG EdgeNeighbour[ CTerrainLOD::EDGE_COUNT ] = { 1, 5, 7, 3 };
+
+    m_nStitchMask = 0;
+    for ( ULONG i = 0; i < CTerrainLOD::EDGE_COUNT; i++ )
+    {
+        CTerrainBlock * pNeighbour = m_pNeighbours[ EdgeNeighbour[i] ];
+        if ( pNeighbour && pNeighbour->m_nLOD > m_nLOD ) m_nStitchMask |= (1 << i);
+
+    } // Next Edge
+}
+
 //-----------------------------------------------------------------------------
 // Name : Render ()
 // Desc : Render the terrain block
+// Note : Returns the number of triangles drawn. The caller binds the vertex
+//        streams and the splat's index buffer.
 //-----------------------------------------------------------------------------
-void CTerrainBlock::Render( LPDIRECT3DDEVICE9 pD3DDevice, USHORT LayerIndex )
+ULONG CTerrainBlock::Render( LPDIRECT3DDEVICE9 pD3DDevice, USHORT LayerIndex )
 {
+    LODRANGE        Draws[ CTerrainLOD::EDGE_COUNT + 1 ];
+    ULONG           i, DrawCount, PrimitiveCount = 0;
+    CTerrainSplat * pSplat = m_pSplatLevel[LayerIndex];
+
     // Bail if this layer is not in use
-    if ( !m_pSplatLevel[LayerIndex] ) return;
+    if ( !pSplat ) return 0;
 
-    // Set up vertex streams & Textures
-    pD3DDevice->SetIndices( m_pSplatLevel[LayerIndex]->m_pIndexBuffer );
-    pD3DDevice->SetTexture( 1, m_pSplatLevel[LayerIndex]->m_pBlendTexture );
+    // Set up the blend texture
+    pD3DDevice->SetTexture( 1, pSplat->m_pBlendTexture );
 
     // Render the vertex buffer
-    if ( m_pSplatLevel[LayerIndex]->m_nPrimitiveCount == 0 ) return;
-    pD3DDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, 0, 0, (m_nBlockWidth * m_nBlockHeight), 0, m_pSplatLevel[LayerIndex]->m_nPrimitiveCount );
+    if ( pSplat->m_nPrimitiveCount == 0 || m_nLOD >= pSplat->m_nLODCount ) return 0;
+
+    // Draw the interior and the selected edge variants for our detail level
+    DrawCount = CTerrainLOD::BuildDrawList( pSplat->m_LODRange[ m_nLOD ], m_nStitchMask, Draws );
+    for ( i = 0; i < DrawCount; i++ )
+    {
+        pD3DDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, 0, 0, (m_nBlockWidth * m_nBlockHeight), Draws[i].StartIndex, Draws[i].PrimitiveCount );
+        PrimitiveCount += Draws[i].PrimitiveCount;
+
+    } // Next Draw
 
+    // Return the number of triangles drawn
+    return PrimitiveCount;
 }
 
 //-----------------------------------------------------------------------------
@@ -1373,6 +3125,16 @@ CTerrainSplat::CTerrainSplat( )
     m_nPrimitiveCount   = 0;
     m_nLayerIndex       = 0;
     m_pBlendTexture     = NULL;
+    m_nLODCount         = 0;
+    m_pStagingIndices   = NULL;
+    m_nStagingIndexCount= 0;
+    m_pStagingBlend     = NULL;
+    m_bSharedIndices    = false;
+    m_pQuadMask         = NULL;
+    m_pCachedIndices    = NULL;
+    m_pCachedBlend      = NULL;
+
+    ZeroMemory( m_LODRange, sizeof(m_LODRange) );
 }
 
 //-----------------------------------------------------------------------------
@@ -1384,10 +3146,18 @@ CTerrainSplat::~CTerrainSplat()
     // Release Direct3D Objects
     if ( m_pIndexBuffer  ) m_pIndexBuffer->Release();
     if ( m_pBlendTexture ) m_pBlendTexture->Release();
+
+    // Release staging memory
+    if ( m_pStagingIndices ) delete []m_pStagingIndices;
+    if ( m_pStagingBlend   ) delete []m_pStagingBlend;
+    if ( m_pQuadMask       ) delete []m_pQuadMask;
    
     // Reset pointers
     m_pIndexBuffer      = NULL;
     m_pBlendTexture     = NULL;
+    m_pStagingIndices   = NULL;
+    m_pStagingBlend     = NULL;
+    m_pQuadMask         = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -1401,6 +3171,7 @@ CTerrainLayer::CTerrainLayer( )
     m_nLayerWidth   = 0;
     m_nLayerHeight  = 0;
     m_pBlendMap     = NULL;
+    m_pWeightMap    = NULL;
     D3DXMatrixIdentity( &m_mtxTexture );
 }
 
@@ -1411,33 +3182,56 @@ CTerrainLayer::CTerrainLayer( )
 CTerrainLayer::~CTerrainLayer()
 {
     // Release flat arrays
-    if ( m_pBlendMap ) delete []m_pBlendMap;
+    if ( m_pBlendMap  ) delete []m_pBlendMap;
+    if ( m_pWeightMap ) delete []m_pWeightMap;
 
     // Reset pointers
-    m_pBlendMap = NULL;
+    m_pBlendMap  = NULL;
+    m_pWeightMap = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StoreWeights ()
+// Desc : Keep a copy of the blend map as loaded, the weights which are then
+//        painted on editable terrain.
+//-----------------------------------------------------------------------------
+bool CTerrainLayer::StoreWeights( )
+{
+    // Validate Parameters
+    if ( !m_pBlendMap ) return false;
+
+    // Allocate the weights
+    if ( !m_pWeightMap ) m_pWeightMap = new UCHAR[ m_nLayerWidth * m_nLayerHeight ];
+    if ( !m_pWeightMap ) return false;
+
+    memcpy( m_pWeightMap, m_pBlendMap, m_nLayerWidth * m_nLayerHeight );
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 // Name : GetFilteredAlpha ()
-// Desc : Retrieve the filtered alpha at the position specified.
+// Desc : Retrieve the filtered alpha at the position specified. Pass true
+//        for 'Weights' to filter the clamped painted weights rather than the
+//        blend map (editable terrain only).
 //-----------------------------------------------------------------------------
-UCHAR CTerrainLayer::GetFilteredAlpha( ULONG x, ULONG z )
+UCHAR CTerrainLayer::GetFilteredAlpha( ULONG x, ULONG z, bool Weights )
 {
     long Total, Sum, PosX, PosZ;
+    const UCHAR * pMap = Weights ? m_pWeightMap : m_pBlendMap;
 
     // Validate Parameters
-    if ( !m_pBlendMap ) return 0;
+    if ( !pMap ) return 0;
 
     // Loop through each neighbour
     PosX = x; PosZ = z;
-    Total = m_pBlendMap[ PosX + PosZ * m_nLayerWidth ];
+    Total = FetchAlpha( pMap, PosX + PosZ * m_nLayerWidth, Weights );
     Sum = 1;
     
     // Above Pixel
     PosX = x; PosZ = z - 1;        
     if ( PosZ >= 0 )
     {
-        Total += m_pBlendMap[ PosX + PosZ * m_nLayerWidth ];
+        Total += FetchAlpha( pMap, PosX + PosZ * m_nLayerWidth, Weights );
         Sum++;
     
     } // End if Not OOB
@@ -1446,7 +3240,7 @@ UCHAR CTerrainLayer::GetFilteredAlpha( ULONG x, ULONG z )
     PosX = x + 1; PosZ = z;
     if ( PosX < (signed)m_nLayerWidth )
     {
-        Total += m_pBlendMap[ PosX + PosZ * m_nLayerWidth ];
+        Total += FetchAlpha( pMap, PosX + PosZ * m_nLayerWidth, Weights );
         Sum++;
     
     } // End if Not OOB
@@ -1455,7 +3249,7 @@ UCHAR CTerrainLayer::GetFilteredAlpha( ULONG x, ULONG z )
     PosX = x; PosZ = z + 1;
     if ( PosZ < (signed)m_nLayerHeight )
     {
-        Total += m_pBlendMap[ PosX + PosZ * m_nLayerWidth ];
+        Total += FetchAlpha( pMap, PosX + PosZ * m_nLayerWidth, Weights );
         Sum++;
     
     } // End if Not OOB
@@ -1464,7 +3258,7 @@ UCHAR CTerrainLayer::GetFilteredAlpha( ULONG x, ULONG z )
     PosX = x - 1; PosZ = z;
     if ( PosX >= 0 )
     {
-        Total += m_pBlendMap[ PosX + PosZ * m_nLayerWidth ];
+        Total += FetchAlpha( pMap, PosX + PosZ * m_nLayerWidth, Weights );
         Sum++;
     
     } // End if Not OOB
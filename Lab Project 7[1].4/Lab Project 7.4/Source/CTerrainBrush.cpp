@@ -0,0 +1,305 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainBrush.cpp
+//
+// Desc: Brushes used to edit the terrain interactively. Raises, lowers,
+//       flattens or smooths the heightmap, or paints layer weights, within a
+//       circular brush, and reports the rectangle of samples modified so that
+//       only the parts of the terrain built from them need to be rebuilt.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainBrush Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainBrush.h"
+#include <math.h>
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : ClampFraction ()
+    // Desc : Clamp a brush strength used as a blend factor to 0 - 1.
+    //-------------------------------------------------------------------------
+    inline float ClampFraction( float Value )
+    {
+        if ( Value < 0.0f ) return 0.0f;
+        if ( Value > 1.0f ) return 1.0f;
+        return Value;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : GetWeight () (Static)
+// Desc : The brush falloff at this position, 1 within the hard centre easing
+//        (smoothstep) to 0 at the radius.
+//-----------------------------------------------------------------------------
+float CTerrainBrush::GetWeight( const TERRAINBRUSH & Brush, float x, float z )
+{
+    float dx = x - Brush.x, dz = z - Brush.z;
+    float Distance = sqrtf( dx * dx + dz * dz );
+    float Inner    = Brush.Radius * ClampFraction( Brush.Hardness ), t;
+
+    if ( Distance >= Brush.Radius ) return 0.0f;
+    if ( Distance <= Inner ) return 1.0f;
+
+    t = (Brush.Radius - Distance) / (Brush.Radius - Inner);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetRegion () (Static)
+// Desc : The rectangle of samples the brush may touch, clipped to a map of
+//        the specified size. Returns false if it misses the map entirely.
+//-----------------------------------------------------------------------------
+bool CTerrainBrush::GetRegion( const TERRAINBRUSH & Brush, unsigned long Width, unsigned long Height, EDITRECT & Region )
+{
+    ClearRect( Region );
+    if ( Brush.Radius <= 0.0f || Width == 0 || Height == 0 ) return false;
+
+    // Samples on the radius have no weight, so only those strictly inside
+    float MinX = ceilf( Brush.x - Brush.Radius ), MaxX = floorf( Brush.x + Brush.Radius );
+    float MinZ = ceilf( Brush.z - Brush.Radius ), MaxZ = floorf( Brush.z + Brush.Radius );
+
+    // Clip to the map (in floating point, the brush may be far outside it)
+    if ( MaxX < 0.0f || MaxZ < 0.0f || MinX > (float)(Width - 1) || MinZ > (float)(Height - 1) ) return false;
+    Region.MinX = ( MinX > 0.0f ) ? (long)MinX : 0;
+    Region.MinZ = ( MinZ > 0.0f ) ? (long)MinZ : 0;
+    Region.MaxX = ( MaxX < (float)(Width  - 1) ) ? (long)MaxX : (long)Width  - 1;
+    Region.MaxZ = ( MaxZ < (float)(Height - 1) ) ? (long)MaxZ : (long)Height - 1;
+
+    return !IsRectEmpty( Region );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ApplyHeights () (Static)
+// Desc : Apply the brush to the heightmap once. 'Changed' receives the
+//        samples which may have been modified.
+// Note : Smoothing reads the heights as they were before this application,
+//        so the result does not depend on the order samples are visited.
+//-----------------------------------------------------------------------------
+bool CTerrainBrush::ApplyHeights( float * pHeightMap, unsigned long Width, unsigned long Height, const TERRAINBRUSH & Brush,
+                                  MODE Mode, EDITRECT & Changed )
+{
+    EDITRECT  Source;
+    float   * pSource = NULL, Amount = Brush.Strength;
+    long      x, z, SourceWidth = 0;
+
+    // Validate parameters
+    ClearRect( Changed );
+    if ( !pHeightMap || Mode >= MODE_COUNT ) return false;
+    if ( !GetRegion( Brush, Width, Height, Changed ) ) return false;
+
+    // Flatten and smooth blend toward their result
+    if ( Mode == MODE_FLATTEN || Mode == MODE_SMOOTH ) Amount = ClampFraction( Amount );
+
+    // Take a copy of the region (and its neighbours) to smooth from
+    if ( Mode == MODE_SMOOTH )
+    {
+        Source = Changed;
+        GrowRect( Source, 1, 1, Width, Height );
+        SourceWidth = Source.MaxX - Source.MinX + 1;
+        pSource     = new float[ SourceWidth * (Source.MaxZ - Source.MinZ + 1) ];
+        if ( !pSource ) { ClearRect( Changed ); return false; }
+
+        for ( z = Source.MinZ; z <= Source.MaxZ; ++z )
+        {
+            memcpy( pSource + (z - Source.MinZ) * SourceWidth, pHeightMap + Source.MinX + z * Width, SourceWidth * sizeof(float) );
+
+        } // Next Row
+
+    } // End if smoothing
+
+    // Apply the brush to every sample it covers
+    for ( z = Changed.MinZ; z <= Changed.MaxZ; ++z )
+    {
+        for ( x = Changed.MinX; x <= Changed.MaxX; ++x )
+        {
+            float   Weight  = GetWeight( Brush, (float)x, (float)z ) * Amount;
+            float & Sample  = pHeightMap[ x + z * Width ];
+            float   Total   = 0.0f;
+            long    Count   = 0, nx, nz;
+
+            if ( Weight == 0.0f ) continue;
+
+            switch ( Mode )
+            {
+                case MODE_RAISE:
+                    Sample += Weight;
+                    break;
+
+                case MODE_LOWER:
+                    Sample -= Weight;
+                    break;
+
+                case MODE_FLATTEN:
+                    Sample += (Brush.Target - Sample) * Weight;
+                    break;
+
+                case MODE_SMOOTH:
+                    // Average of the 3 x 3 neighbourhood within the map
+                    for ( nz = z - 1; nz <= z + 1; ++nz )
+                    {
+                        if ( nz < Source.MinZ || nz > Source.MaxZ ) continue;
+                        for ( nx = x - 1; nx <= x + 1; ++nx )
+                        {
+                            if ( nx < Source.MinX || nx > Source.MaxX ) continue;
+                            Total += pSource[ (nx - Source.MinX) + (nz - Source.MinZ) * SourceWidth ];
+                            Count++;
+
+                        } // Next Column
+
+                    } // Next Row
+                    Sample += (Total / (float)Count - Sample) * Weight;
+                    break;
+
+                default:
+                    break;
+
+            } // End Switch Mode
+
+        } // Next Column
+
+    } // Next Row
+
+    // Clean up
+    if ( pSource ) delete []pSource;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ApplyWeights () (Static)
+// Desc : Apply the brush to a map of 8 bit layer weights once, moving them
+//        toward 'Target'. 'Changed' receives the texels which may have been
+//        modified.
+// Note : A weight always moves by at least one step while the brush touches
+//        it, so painting slowly still reaches the target.
+//-----------------------------------------------------------------------------
+bool CTerrainBrush::ApplyWeights( unsigned char * pWeights, unsigned long Width, unsigned long Height, const TERRAINBRUSH & Brush,
+                                  EDITRECT & Changed )
+{
+    float Amount = ClampFraction( Brush.Strength ), Target = Brush.Target, Delta;
+    long  x, z, Value, Step;
+
+    // Validate parameters
+    ClearRect( Changed );
+    if ( !pWeights ) return false;
+    if ( !GetRegion( Brush, Width, Height, Changed ) ) return false;
+
+    // Weights are 8 bit
+    if ( Target < 0.0f   ) Target = 0.0f;
+    if ( Target > 255.0f ) Target = 255.0f;
+
+    // Apply the brush to every texel it covers
+    for ( z = Changed.MinZ; z <= Changed.MaxZ; ++z )
+    {
+        for ( x = Changed.MinX; x <= Changed.MaxX; ++x )
+        {
+            unsigned char & Weight = pWeights[ x + z * Width ];
+
+            Value = Weight;
+            Delta = (Target - (float)Value) * GetWeight( Brush, (float)x, (float)z ) * Amount;
+            if ( Delta == 0.0f ) continue;
+
+            // Round to the nearest step, but always move
+            Step = (long)( Delta > 0.0f ? Delta + 0.5f : Delta - 0.5f );
+            if ( Step == 0 ) Step = ( Delta > 0.0f ) ? 1 : -1;
+
+            Value += Step;
+            if ( Value < 0   ) Value = 0;
+            if ( Value > 255 ) Value = 255;
+            Weight = (unsigned char)Value;
+
+        } // Next Column
+
+    } // Next Row
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClearRect () (Static)
+// Desc : Make the rectangle empty.
+//-----------------------------------------------------------------------------
+void CTerrainBrush::ClearRect( EDITRECT & Rect )
+{
+    Rect.MinX = Rect.MinZ = 0;
+    Rect.MaxX = Rect.MaxZ = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UnionRect () (Static)
+// Desc : Grow the rectangle to include another.
+//-----------------------------------------------------------------------------
+void CTerrainBrush::UnionRect( EDITRECT & Rect, const EDITRECT & Other )
+{
+    if ( IsRectEmpty( Other ) ) return;
+    if ( IsRectEmpty( Rect  ) ) { Rect = Other; return; }
+
+    if ( Other.MinX < Rect.MinX ) Rect.MinX = Other.MinX;
+    if ( Other.MinZ < Rect.MinZ ) Rect.MinZ = Other.MinZ;
+    if ( Other.MaxX > Rect.MaxX ) Rect.MaxX = Other.MaxX;
+    if ( Other.MaxZ > Rect.MaxZ ) Rect.MaxZ = Other.MaxZ;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GrowRect () (Static)
+// Desc : Grow the rectangle by 'Before' samples on its low sides and 'After'
+//        on its high sides, clipped to a map of the specified size. Returns
+//        false if the result is empty.
+//-----------------------------------------------------------------------------
+bool CTerrainBrush::GrowRect( EDITRECT & Rect, long Before, long After, unsigned long Width, unsigned long Height )
+{
+    if ( IsRectEmpty( Rect ) ) return false;
+
+    Rect.MinX -= Before;
+    Rect.MinZ -= Before;
+    Rect.MaxX += After;
+    Rect.MaxZ += After;
+
+    if ( Rect.MinX < 0 ) Rect.MinX = 0;
+    if ( Rect.MinZ < 0 ) Rect.MinZ = 0;
+    if ( Rect.MaxX > (long)Width  - 1 ) Rect.MaxX = (long)Width  - 1;
+    if ( Rect.MaxZ > (long)Height - 1 ) Rect.MaxZ = (long)Height - 1;
+
+    return !IsRectEmpty( Rect );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBlockRange () (Static)
+// Desc : The rectangle of blocks containing any part of 'Rect', for blocks
+//        'CellsWide' x 'CellsHigh' samples or texels apart. With
+//        'SharedEdges', neighbouring blocks share their edge samples (as the
+//        vertices of the terrain blocks do), so an edge sample belongs to
+//        both. Returns false if no block is touched.
+//-----------------------------------------------------------------------------
+bool CTerrainBrush::GetBlockRange( const EDITRECT & Rect, unsigned long CellsWide, unsigned long CellsHigh, bool SharedEdges,
+                                   unsigned long BlocksWide, unsigned long BlocksHigh, EDITRECT & Blocks )
+{
+    long Wide = (long)CellsWide, High = (long)CellsHigh;
+
+    // Validate parameters
+    ClearRect( Blocks );
+    if ( IsRectEmpty( Rect ) || Rect.MinX < 0 || Rect.MinZ < 0 || Wide <= 0 || High <= 0 ) return false;
+
+    // A shared edge sample also belongs to the block before it
+    Blocks.MinX = ( SharedEdges && Rect.MinX > 0 ) ? (Rect.MinX - 1) / Wide : Rect.MinX / Wide;
+    Blocks.MinZ = ( SharedEdges && Rect.MinZ > 0 ) ? (Rect.MinZ - 1) / High : Rect.MinZ / High;
+    Blocks.MaxX = Rect.MaxX / Wide;
+    Blocks.MaxZ = Rect.MaxZ / High;
+
+    // Clip to the blocks that exist
+    if ( Blocks.MaxX > (long)BlocksWide - 1 ) Blocks.MaxX = (long)BlocksWide - 1;
+    if ( Blocks.MaxZ > (long)BlocksHigh - 1 ) Blocks.MaxZ = (long)BlocksHigh - 1;
+    if ( IsRectEmpty( Blocks ) ) { ClearRect( Blocks ); return false; }
+
+    return true;
+}
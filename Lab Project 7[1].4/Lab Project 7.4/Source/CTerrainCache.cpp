@@ -0,0 +1,514 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainCache.cpp
+//
+// Desc: Cooked terrain cache. The first time a terrain is built, the filtered
+//       heightmap and each block's layer usage, splat index lists and blend
+//       texels are written to a versioned, checksummed binary file. Later
+//       loads map that file and upload directly from it, skipping the
+//       heightmap filter, the layer map decoding, the occlusion pass and the
+//       splat generation entirely.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainCache Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainCache.h"
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const char          CacheMagic[4] = { 'T', 'C', 'O', 'K' };
+    const unsigned long ADLER_BASE    = 65521;     // Largest prime below 65536
+    const unsigned long ADLER_NMAX    = 5552;      // Bytes summed before the 32 bit sums could overflow
+    const unsigned long MAX_OFFSET    = 0xFFFFFFFF;// Offsets are stored as 32 bit values
+    const unsigned char Padding[4]    = { 0, 0, 0, 0 };
+
+    //-------------------------------------------------------------------------
+    // Name : PadSize ()
+    // Desc : Size of an item once padded to a multiple of four bytes.
+    //-------------------------------------------------------------------------
+    inline unsigned long PadSize( unsigned long Size )
+    {
+        return (Size + 3) & ~3UL;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CopyString ()
+    // Desc : Duplicate a string, optionally appending a suffix.
+    //-------------------------------------------------------------------------
+    char * CopyString( const char * pString, const char * pSuffix = "" )
+    {
+        char * pCopy = new char[ strlen( pString ) + strlen( pSuffix ) + 1 ];
+        if ( !pCopy ) return NULL;
+        strcpy( pCopy, pString );
+        strcat( pCopy, pSuffix );
+        return pCopy;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : MapFile ()
+    // Desc : Map a whole file in to memory, read only.
+    //-------------------------------------------------------------------------
+    const unsigned char * MapFile( const char * FileName, unsigned long & Size )
+    {
+#if defined(_WIN32)
+        HANDLE hFile, hMapping;
+        void * pView;
+        DWORD  High = 0;
+
+        hFile = CreateFileA( FileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if ( hFile == INVALID_HANDLE_VALUE ) return NULL;
+
+        // Files beyond the range of the offsets can't be valid
+        Size = GetFileSize( hFile, &High );
+        if ( Size == 0xFFFFFFFF || High != 0 || Size == 0 ) { CloseHandle( hFile ); return NULL; }
+
+        // The view keeps the mapping (and the file) open once mapped
+        hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+        CloseHandle( hFile );
+        if ( !hMapping ) return NULL;
+        pView = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( hMapping );
+
+        return (const unsigned char*)pView;
+#else
+        struct stat Info;
+        void      * pView;
+        int         File;
+
+        File = open( FileName, O_RDONLY );
+        if ( File < 0 ) return NULL;
+
+        // Files beyond the range of the offsets can't be valid
+        if ( fstat( File, &Info ) != 0 || Info.st_size <= 0 || ((Info.st_size >> 16) >> 16) != 0 ) { close( File ); return NULL; }
+        Size = (unsigned long)Info.st_size;
+
+        // The mapping remains valid once the file is closed
+        pView = mmap( NULL, Size, PROT_READ, MAP_PRIVATE, File, 0 );
+        close( File );
+        if ( pView == MAP_FAILED ) return NULL;
+        madvise( pView, Size, MADV_SEQUENTIAL );
+
+        return (const unsigned char*)pView;
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : UnmapFile ()
+    // Desc : Release a view created by MapFile.
+    //-------------------------------------------------------------------------
+    void UnmapFile( const unsigned char * pView, unsigned long Size )
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile( pView );
+#else
+        munmap( (void*)pView, Size );
+#endif
+    }
+
+#if defined(_WIN32)
+    //-------------------------------------------------------------------------
+    // Name : GetWriteTime ()
+    // Desc : Retrieve the time at which a file was last written.
+    //-------------------------------------------------------------------------
+    bool GetWriteTime( const char * FileName, FILETIME & Time )
+    {
+        HANDLE hFile;
+        bool   bResult;
+
+        hFile = CreateFileA( FileName, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL );
+        if ( hFile == INVALID_HANDLE_VALUE ) return false;
+        bResult = ( GetFileTime( hFile, NULL, NULL, &Time ) != FALSE );
+        CloseHandle( hFile );
+        return bResult;
+    }
+#endif
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainCache () (Constructor)
+// Desc : CTerrainCache Class Constructor
+//-----------------------------------------------------------------------------
+CTerrainCache::CTerrainCache()
+{
+	// Reset / Clear all required values
+    m_pView       = NULL;
+    m_nViewSize   = 0;
+    m_pFile       = NULL;
+    m_strFileName = NULL;
+    m_strTempName = NULL;
+    m_pTable      = NULL;
+    m_nBlock      = 0;
+    m_nOffset     = 0;
+    m_nChecksum   = 1;
+    m_bFailed     = false;
+    memset( &m_Header, 0, sizeof(TERRAINCACHEHEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainCache () (Destructor)
+// Desc : CTerrainCache Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainCache::~CTerrainCache()
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : Map a cache file and validate it against the key of the terrain
+//        being loaded. Fails (leaving the cache closed) if the file is
+//        missing, was cooked with other settings or by another version, or
+//        is damaged in any way.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::Open( const char * FileName, const TERRAINCACHEKEY & Key )
+{
+    unsigned long i, HeightBytes, DataStart;
+    const CACHEBLOCKENTRY * pTable;
+
+    // Release any previous file
+    Close();
+
+    // Validate Parameters
+    if ( !FileName ) return false;
+
+    // Map the whole file
+    m_pView = MapFile( FileName, m_nViewSize );
+    if ( !m_pView ) return false;
+    if ( m_nViewSize < sizeof(TERRAINCACHEHEADER) ) { Close(); return false; }
+    memcpy( &m_Header, m_pView, sizeof(TERRAINCACHEHEADER) );
+
+    // Was it cooked from the terrain we are loading ?
+    if ( memcmp( m_Header.Magic, CacheMagic, 4 ) != 0 || m_Header.Version != TERRAIN_CACHE_VERSION ||
+         memcmp( &m_Header.Key, &Key, sizeof(TERRAINCACHEKEY) ) != 0 || m_Header.FileSize != m_nViewSize )
+    {
+        Close();
+        return false;
+
+    } // End if wrong file
+
+    // The heightmap and block table must fit
+    HeightBytes = Key.MapWidth * Key.MapHeight * sizeof(float);
+    DataStart   = sizeof(TERRAINCACHEHEADER) + HeightBytes;
+    if ( m_Header.BlockCount == 0 || m_Header.TableOffset < DataStart || m_Header.TableOffset > m_nViewSize ||
+         (m_nViewSize - m_Header.TableOffset) / sizeof(CACHEBLOCKENTRY) != m_Header.BlockCount ||
+         (m_nViewSize - m_Header.TableOffset) % sizeof(CACHEBLOCKENTRY) != 0 )
+    {
+        Close();
+        return false;
+
+    } // End if bad layout
+
+    // Check every byte we are going to use
+    if ( Checksum( m_pView + sizeof(TERRAINCACHEHEADER), m_nViewSize - sizeof(TERRAINCACHEHEADER) ) != m_Header.Checksum ) { Close(); return false; }
+
+    // Every block record must lie between the heightmap and the table
+    pTable = (const CACHEBLOCKENTRY*)(m_pView + m_Header.TableOffset);
+    for ( i = 0; i < m_Header.BlockCount; i++ )
+    {
+        if ( pTable[i].Offset < DataStart || (pTable[i].Offset & 3) != 0 || pTable[i].Offset > m_Header.TableOffset ||
+             pTable[i].Size > m_Header.TableOffset - pTable[i].Offset ) { Close(); return false; }
+
+    } // Next Block
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+// Desc : Unmap the file being read, or abandon the file being cooked.
+//-----------------------------------------------------------------------------
+void CTerrainCache::Close( )
+{
+    // Unmap the file
+    if ( m_pView ) UnmapFile( m_pView, m_nViewSize );
+
+    // Abandon any cook in progress
+    if ( m_pFile )
+    {
+        fclose( m_pFile );
+        remove( m_strTempName );
+
+    } // End if cooking
+
+    // Release memory
+    if ( m_strFileName ) delete []m_strFileName;
+    if ( m_strTempName ) delete []m_strTempName;
+    if ( m_pTable      ) delete []m_pTable;
+
+    // Reset / Clear all required values
+    m_pView       = NULL;
+    m_nViewSize   = 0;
+    m_pFile       = NULL;
+    m_strFileName = NULL;
+    m_strTempName = NULL;
+    m_pTable      = NULL;
+    m_nBlock      = 0;
+    m_nOffset     = 0;
+    m_nChecksum   = 1;
+    m_bFailed     = false;
+    memset( &m_Header, 0, sizeof(TERRAINCACHEHEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetHeightMap ()
+// Desc : Retrieve the filtered heightmap stored in the open cache.
+//-----------------------------------------------------------------------------
+const float * CTerrainCache::GetHeightMap( ) const
+{
+    if ( !m_pView ) return NULL;
+    return (const float*)(m_pView + sizeof(TERRAINCACHEHEADER));
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBlock ()
+// Desc : Set up a cursor to read through a block's record.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::GetBlock( unsigned long Index, CACHECURSOR & Cursor ) const
+{
+    const CACHEBLOCKENTRY * pEntry;
+
+    // Validate Parameters
+    if ( !m_pView || Index >= m_Header.BlockCount ) return false;
+
+    // Records were validated by Open
+    pEntry           = (const CACHEBLOCKENTRY*)(m_pView + m_Header.TableOffset) + Index;
+    Cursor.pData     = m_pView + pEntry->Offset;
+    Cursor.Remaining = pEntry->Size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Start cooking a cache file for the terrain described by 'Key',
+//        beginning with its filtered heightmap. Each of the 'BlockCount'
+//        block records must then be written (in any order) between calls to
+//        BeginBlock and EndBlock before the file is completed by Commit.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::Create( const char * FileName, const TERRAINCACHEKEY & Key, unsigned long BlockCount, const float * pHeightMap )
+{
+    // Release any previous file
+    Close();
+
+    // Validate Parameters
+    if ( !FileName || !pHeightMap || BlockCount == 0 ) return false;
+
+    // Store the names and allocate the block table
+    m_strFileName = CopyString( FileName );
+    m_strTempName = CopyString( FileName, ".tmp" );
+    m_pTable      = new CACHEBLOCKENTRY[ BlockCount ];
+    if ( !m_strFileName || !m_strTempName || !m_pTable ) { Close(); return false; }
+    memset( m_pTable, 0, BlockCount * sizeof(CACHEBLOCKENTRY) );
+
+    // Open the temporary file
+    m_pFile = fopen( m_strTempName, "wb" );
+    if ( !m_pFile ) { Close(); return false; }
+
+    // The header is completed by Commit
+    memcpy( m_Header.Magic, CacheMagic, 4 );
+    m_Header.Version    = TERRAIN_CACHE_VERSION;
+    m_Header.Key        = Key;
+    m_Header.BlockCount = BlockCount;
+    m_nBlock            = BlockCount;
+    m_nOffset           = sizeof(TERRAINCACHEHEADER);
+    if ( fwrite( &m_Header, sizeof(TERRAINCACHEHEADER), 1, m_pFile ) != 1 ) { Close(); return false; }
+
+    // Followed by the heightmap
+    if ( !Write( pHeightMap, Key.MapWidth * Key.MapHeight * sizeof(float) ) ) { Close(); return false; }
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginBlock ()
+// Desc : Start writing the record of the specified block.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::BeginBlock( unsigned long Index )
+{
+    // Only one block may be written at a time
+    if ( !m_pFile || m_bFailed || m_nBlock != m_Header.BlockCount || Index >= m_Header.BlockCount ) { m_bFailed = true; return false; }
+
+    m_pTable[ Index ].Offset = m_nOffset;
+    m_nBlock = Index;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Write ()
+// Desc : Append an item to the file being cooked, padded to a multiple of
+//        four bytes.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::Write( const void * pData, unsigned long Size )
+{
+    unsigned long Pad = PadSize( Size ) - Size;
+
+    // Validate Parameters
+    if ( !m_pFile || m_bFailed ) return false;
+    if ( (!pData && Size > 0) || Size > MAX_OFFSET - m_nOffset || Pad > MAX_OFFSET - m_nOffset - Size ) { m_bFailed = true; return false; }
+
+    // Write the item and its padding
+    if ( Size > 0 && fwrite( pData, 1, Size, m_pFile ) != Size ) m_bFailed = true;
+    if ( Pad  > 0 && fwrite( Padding, 1, Pad, m_pFile ) != Pad ) m_bFailed = true;
+    if ( m_bFailed ) return false;
+
+    // Keep the checksum up to date as we go
+    m_nChecksum = Checksum( pData, Size, m_nChecksum );
+    m_nChecksum = Checksum( Padding, Pad, m_nChecksum );
+    m_nOffset  += Size + Pad;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndBlock ()
+// Desc : Finish writing the current block's record.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::EndBlock( )
+{
+    if ( !m_pFile || m_bFailed || m_nBlock >= m_Header.BlockCount ) { m_bFailed = true; return false; }
+
+    m_pTable[ m_nBlock ].Size = m_nOffset - m_pTable[ m_nBlock ].Offset;
+    m_nBlock = m_Header.BlockCount;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Commit ()
+// Desc : Write the block table, complete the header and replace the cache
+//        file with the one cooked. The cook is abandoned (and any existing
+//        cache left alone) if anything went wrong, or any block is missing.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::Commit( )
+{
+    unsigned long i;
+    bool          bResult;
+
+    // Validate requirements
+    if ( !m_pFile ) return false;
+    bResult = !m_bFailed && m_nBlock == m_Header.BlockCount;
+    for ( i = 0; i < m_Header.BlockCount && bResult; i++ )
+    {
+        if ( m_pTable[i].Offset == 0 ) bResult = false;
+
+    } // Next Block
+
+    // Append the table, then fill in the header
+    if ( bResult )
+    {
+        m_Header.TableOffset = m_nOffset;
+        bResult = Write( m_pTable, m_Header.BlockCount * sizeof(CACHEBLOCKENTRY) );
+        m_Header.FileSize    = m_nOffset;
+        m_Header.Checksum    = m_nChecksum;
+
+    } // End if complete
+    if ( bResult ) bResult = ( fseek( m_pFile, 0, SEEK_SET ) == 0 );
+    if ( bResult ) bResult = ( fwrite( &m_Header, sizeof(TERRAINCACHEHEADER), 1, m_pFile ) == 1 );
+    if ( fclose( m_pFile ) != 0 ) bResult = false;
+    m_pFile = NULL;
+
+    // Replace the cache (rename will not replace an existing file on Windows)
+    if ( bResult )
+    {
+#if defined(_WIN32)
+        remove( m_strFileName );
+#endif
+        bResult = ( rename( m_strTempName, m_strFileName ) == 0 );
+
+    } // End if written
+
+    // Don't leave a partial file behind
+    if ( !bResult ) remove( m_strTempName );
+    Close();
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Read () (Static)
+// Desc : Retrieve the next item of 'Size' bytes from a block record, or NULL
+//        if the record is not large enough to hold it.
+//-----------------------------------------------------------------------------
+const void * CTerrainCache::Read( CACHECURSOR & Cursor, unsigned long Size )
+{
+    const void  * pItem  = Cursor.pData;
+    unsigned long Padded = PadSize( Size );
+
+    // Validate Parameters
+    if ( !Cursor.pData || Size > Cursor.Remaining || Padded > Cursor.Remaining ) return NULL;
+
+    Cursor.pData     += Padded;
+    Cursor.Remaining -= Padded;
+    return pItem;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsNewer () (Static)
+// Desc : Was 'FileName' modified after 'ThanFile'? Returns false if either
+//        file does not exist, so that a cache can be shipped (and used)
+//        without its source files.
+//-----------------------------------------------------------------------------
+bool CTerrainCache::IsNewer( const char * FileName, const char * ThanFile )
+{
+#if defined(_WIN32)
+    FILETIME File, Than;
+
+    if ( !GetWriteTime( FileName, File ) || !GetWriteTime( ThanFile, Than ) ) return false;
+    return CompareFileTime( &File, &Than ) > 0;
+#else
+    struct stat File, Than;
+
+    if ( stat( FileName, &File ) != 0 || stat( ThanFile, &Than ) != 0 ) return false;
+    return File.st_mtime > Than.st_mtime;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : Checksum () (Static)
+// Desc : Adler-32 checksum of a block of memory. Pass the previous result to
+//        continue a checksum over several blocks.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainCache::Checksum( const void * pData, unsigned long Size, unsigned long Previous )
+{
+    const unsigned char * pByte = (const unsigned char*)pData;
+    unsigned long         a = Previous & 0xFFFF, b = (Previous >> 16) & 0xFFFF, n;
+
+    while ( Size > 0 )
+    {
+        // Sum as many bytes as we can before reducing
+        n     = ( Size < ADLER_NMAX ) ? Size : ADLER_NMAX;
+        Size -= n;
+        for ( ; n >= 8; n -= 8, pByte += 8 )
+        {
+            a += pByte[0]; b += a; a += pByte[1]; b += a;
+            a += pByte[2]; b += a; a += pByte[3]; b += a;
+            a += pByte[4]; b += a; a += pByte[5]; b += a;
+            a += pByte[6]; b += a; a += pByte[7]; b += a;
+
+        } // Next 8 Bytes
+        for ( ; n > 0; n--, pByte++ ) { a += *pByte; b += a; }
+
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+
+    } // Next Run
+
+    return (b << 16) | a;
+}
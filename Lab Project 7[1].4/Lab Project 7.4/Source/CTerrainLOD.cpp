@@ -0,0 +1,421 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainLOD.cpp
+//
+// Desc: Geomipmapping support for the terrain blocks. Builds the index sets
+//       for each level of detail (including the edge variants used to stitch
+//       a block to a coarser neighbour), measures the geometric error of each
+//       level and selects levels from a screen space error threshold.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainLOD Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainLOD.h"
+#include <stddef.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures, Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : LODTRIANGLE (Struct)
+    // Desc : A triangle of a level's grid, in block vertex coordinates.
+    //-------------------------------------------------------------------------
+    struct LODTRIANGLE
+    {
+        long    x[3], z[3];     // Corner positions (vertex grid units)
+        long    Owner;          // RANGE_INTERIOR or RANGE_EDGE + Edge
+        long    Odd;            // Corner lying on an odd edge vertex, or -1
+        bool    bVisible;       // Owning quad is part of the index set
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : SignedArea ()
+    // Desc : Twice the signed area of a triangle on the x / z grid.
+    //-------------------------------------------------------------------------
+    inline long SignedArea( const long x[3], const long z[3] )
+    {
+        return (x[1] - x[0]) * (z[2] - z[0]) - (z[1] - z[0]) * (x[2] - x[0]);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : OddEdge ()
+    // Desc : If this vertex lies on a block edge, at a position which is not
+    //        present on the next coarser level, return that edge (else -1).
+    //-------------------------------------------------------------------------
+    long OddEdge( long x, long z, long Step, long QuadsWide, long QuadsHigh )
+    {
+        if ( z == 0         && (x / Step) & 1 ) return CTerrainLOD::EDGE_TOP;
+        if ( x == QuadsWide && (z / Step) & 1 ) return CTerrainLOD::EDGE_RIGHT;
+        if ( z == QuadsHigh && (x / Step) & 1 ) return CTerrainLOD::EDGE_BOTTOM;
+        if ( x == 0         && (z / Step) & 1 ) return CTerrainLOD::EDGE_LEFT;
+        return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : FlipQuad ()
+    // Desc : The top right and bottom left quads of a level which can be
+    //        stitched are split along the other diagonal, otherwise one of
+    //        their triangles would touch an odd vertex on two edges at once.
+    //-------------------------------------------------------------------------
+    inline bool FlipQuad( unsigned long x, unsigned long z, unsigned long Wide, unsigned long High, bool bCoarser )
+    {
+        if ( !bCoarser ) return false;
+        return ( x == Wide - 1 && z == 0 ) || ( x == 0 && z == High - 1 );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : QuadVisible ()
+    // Desc : Is any full resolution quad covered by this coarse quad set in
+    //        the mask? (No mask means every quad.)
+    //-------------------------------------------------------------------------
+    bool QuadVisible( const unsigned char * pQuadMask, unsigned long QuadsWide, unsigned long x, unsigned long z, unsigned long Step )
+    {
+        if ( !pQuadMask ) return true;
+
+        for ( unsigned long az = z; az < z + Step; ++az )
+        {
+            for ( unsigned long ax = x; ax < x + Step; ++ax )
+            {
+                if ( pQuadMask[ ax + az * QuadsWide ] ) return true;
+
+            } // Next Column
+
+        } // Next Row
+
+        return false;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CollapseTarget ()
+    // Desc : Choose which neighbouring edge vertex an odd vertex collapses on
+    //        to when stitching. The first candidate which leaves every
+    //        triangle around it with its original winding is used.
+    //-------------------------------------------------------------------------
+    void CollapseTarget( const LODTRIANGLE * pTriangles, unsigned long Count, long Edge, long x, long z, long Step, long & TargetX, long & TargetZ )
+    {
+        long Candidate[2][2], dx = 0, dz = 0;
+
+        // Candidates lie either side along the edge
+        if ( Edge == CTerrainLOD::EDGE_TOP || Edge == CTerrainLOD::EDGE_BOTTOM ) dx = Step; else dz = Step;
+        Candidate[0][0] = x - dx; Candidate[0][1] = z - dz;
+        Candidate[1][0] = x + dx; Candidate[1][1] = z + dz;
+
+        for ( int c = 0; c < 2; ++c )
+        {
+            bool bValid = true;
+
+            for ( unsigned long t = 0; t < Count && bValid; ++t )
+            {
+                const LODTRIANGLE & Tri = pTriangles[t];
+                long NewX[3], NewZ[3];
+                bool bContains = false, bDegenerate = false;
+
+                for ( int i = 0; i < 3; ++i )
+                {
+                    NewX[i] = Tri.x[i]; NewZ[i] = Tri.z[i];
+                    if ( NewX[i] == x && NewZ[i] == z ) { NewX[i] = Candidate[c][0]; NewZ[i] = Candidate[c][1]; bContains = true; }
+                    else if ( NewX[i] == Candidate[c][0] && NewZ[i] == Candidate[c][1] ) bDegenerate = true;
+
+                } // Next Corner
+
+                // Triangles which collapse away are fine, the rest must not flip
+                if ( !bContains || bDegenerate ) continue;
+                if ( (SignedArea( NewX, NewZ ) > 0) != (SignedArea( Tri.x, Tri.z ) > 0) || SignedArea( NewX, NewZ ) == 0 ) bValid = false;
+
+            } // Next Triangle
+
+            if ( bValid ) { TargetX = Candidate[c][0]; TargetZ = Candidate[c][1]; return; }
+
+        } // Next Candidate
+
+        // Should not happen on a regular grid, leave the vertex in place
+        TargetX = x; TargetZ = z;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : GetLevelCount () (Static)
+// Desc : Number of detail levels available for a block of this size. Each
+//        level requires the quad counts to divide evenly by its quad size.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainLOD::GetLevelCount( unsigned long QuadsWide, unsigned long QuadsHigh )
+{
+    unsigned long Count = 1;
+
+    // Validate Parameters
+    if ( QuadsWide == 0 || QuadsHigh == 0 ) return 0;
+
+    while ( Count < MAX_TERRAIN_LOD && (QuadsWide % (1UL << Count)) == 0 && (QuadsHigh % (1UL << Count)) == 0 ) Count++;
+
+    return Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildIndices () (Static)
+// Desc : Build the triangle list index set for a single detail level. Only
+//        quads which cover a set entry in 'pQuadMask' (one entry per full
+//        resolution quad, may be NULL) are included. Indices address the
+//        block's (QuadsWide + 1) x (QuadsHigh + 1) vertex grid. 'Ranges' is
+//        filled in relative to 'BaseIndex'.
+// Note : Returns the number of indices in the set. Pass a NULL 'pIndices' to
+//        simply measure it.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainLOD::BuildIndices( unsigned long QuadsWide, unsigned long QuadsHigh, unsigned long Level, const unsigned char * pQuadMask,
+                                         unsigned short * pIndices, unsigned long BaseIndex, LODRANGE Ranges[RANGE_COUNT] )
+{
+    unsigned long Step      = 1UL << Level;
+    unsigned long Wide      = QuadsWide / Step, High = QuadsHigh / Step;
+    unsigned long Pitch     = QuadsWide + 1;
+    bool          bCoarser  = (Level + 1 < GetLevelCount( QuadsWide, QuadsHigh ));
+    unsigned long Count     = 0, i, t, x, z, r;
+    LODTRIANGLE * pTriangles;
+
+    // Reset the ranges
+    for ( r = 0; r < RANGE_COUNT; ++r ) { Ranges[r].StartIndex = BaseIndex; Ranges[r].PrimitiveCount = 0; }
+
+    // Validate Parameters
+    if ( Level >= GetLevelCount( QuadsWide, QuadsHigh ) ) return 0;
+
+    // Build every triangle of this level's grid (same diagonal as the full
+    // resolution mesh, top left to bottom right, other than the flipped quads)
+    pTriangles = new LODTRIANGLE[ Wide * High * 2 ];
+    if ( !pTriangles ) return 0;
+
+    for ( z = 0, t = 0; z < High; ++z )
+    {
+        for ( x = 0; x < Wide; ++x )
+        {
+            long x0 = (long)(x * Step), z0 = (long)(z * Step), x1 = x0 + (long)Step, z1 = z0 + (long)Step;
+            bool bVisible = QuadVisible( pQuadMask, QuadsWide, x0, z0, Step );
+            LODTRIANGLE & Tri0 = pTriangles[t++], & Tri1 = pTriangles[t++];
+
+            if ( !FlipQuad( x, z, Wide, High, bCoarser ) )
+            {
+                Tri0.x[0] = x0; Tri0.z[0] = z0; Tri0.x[1] = x0; Tri0.z[1] = z1; Tri0.x[2] = x1; Tri0.z[2] = z1;
+                Tri1.x[0] = x0; Tri1.z[0] = z0; Tri1.x[1] = x1; Tri1.z[1] = z1; Tri1.x[2] = x1; Tri1.z[2] = z0;
+
+            } // End if regular quad
+            else
+            {
+                Tri0.x[0] = x0; Tri0.z[0] = z0; Tri0.x[1] = x0; Tri0.z[1] = z1; Tri0.x[2] = x1; Tri0.z[2] = z0;
+                Tri1.x[0] = x0; Tri1.z[0] = z1; Tri1.x[1] = x1; Tri1.z[1] = z1; Tri1.x[2] = x1; Tri1.z[2] = z0;
+
+            } // End if flipped quad
+            Tri0.bVisible = Tri1.bVisible = bVisible;
+
+        } // Next Quad
+
+    } // Next Row
+
+    // Classify them, a triangle touching an odd edge vertex belongs to that
+    // edge (there is never more than one per triangle)
+    for ( t = 0; t < Wide * High * 2; ++t )
+    {
+        LODTRIANGLE & Tri = pTriangles[t];
+        Tri.Owner = RANGE_INTERIOR;
+        Tri.Odd   = -1;
+        if ( !bCoarser ) continue;
+
+        for ( i = 0; i < 3; ++i )
+        {
+            long Edge = OddEdge( Tri.x[i], Tri.z[i], (long)Step, (long)QuadsWide, (long)QuadsHigh );
+            if ( Edge < 0 ) continue;
+            Tri.Owner = RANGE_EDGE + Edge;
+            Tri.Odd   = (long)i;
+
+        } // Next Corner
+
+    } // Next Triangle
+
+    // Emit each range in turn
+    for ( r = 0; r < RANGE_COUNT; ++r )
+    {
+        bool bStitched = (r >= RANGE_STITCHED);
+        long Owner     = bStitched ? (long)(r - RANGE_STITCHED + RANGE_EDGE) : (long)r;
+
+        Ranges[r].StartIndex = BaseIndex + Count;
+        if ( bStitched && !bCoarser ) continue;
+
+        for ( t = 0; t < Wide * High * 2; ++t )
+        {
+            const LODTRIANGLE & Tri = pTriangles[t];
+            long NewX[3], NewZ[3];
+
+            if ( Tri.Owner != Owner || !Tri.bVisible ) continue;
+
+            for ( i = 0; i < 3; ++i ) { NewX[i] = Tri.x[i]; NewZ[i] = Tri.z[i]; }
+
+            // Collapse the odd vertex on to its neighbour along the edge
+            if ( bStitched )
+            {
+                long Odd = Tri.Odd;
+                CollapseTarget( pTriangles, Wide * High * 2, Owner - RANGE_EDGE, Tri.x[Odd], Tri.z[Odd], (long)Step, NewX[Odd], NewZ[Odd] );
+                if ( SignedArea( NewX, NewZ ) == 0 ) continue;
+
+            } // End if stitched
+
+            if ( pIndices )
+            {
+                for ( i = 0; i < 3; ++i ) pIndices[ Count + i ] = (unsigned short)(NewX[i] + NewZ[i] * Pitch);
+
+            } // End if writing
+
+            Count += 3;
+            Ranges[r].PrimitiveCount++;
+
+        } // Next Triangle
+
+    } // Next Range
+
+    // Clean up
+    delete []pTriangles;
+
+    // Return the number of indices
+    return Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalculateErrors () (Static)
+// Desc : Measure the largest vertical distance between the full resolution
+//        heightmap and each detail level's surface, within a single block.
+//        Errors are in world units and never decrease from one level to the
+//        next.
+//-----------------------------------------------------------------------------
+void CTerrainLOD::CalculateErrors( const float * pHeightMap, unsigned long MapWidth, unsigned long StartX, unsigned long StartZ,
+                                   unsigned long QuadsWide, unsigned long QuadsHigh, float HeightScale, float * pErrors )
+{
+    unsigned long LevelCount = GetLevelCount( QuadsWide, QuadsHigh );
+    unsigned long Level, x, z;
+
+    // Validate Parameters
+    if ( !pHeightMap || !pErrors || LevelCount == 0 ) return;
+
+    pErrors[0] = 0.0f;
+    for ( Level = 1; Level < LevelCount; ++Level )
+    {
+        unsigned long Step     = 1UL << Level;
+        unsigned long Wide     = QuadsWide / Step, High = QuadsHigh / Step;
+        bool          bCoarser = (Level + 1 < LevelCount);
+        float         Error    = pErrors[ Level - 1 ];
+
+        for ( z = 0; z <= QuadsHigh; ++z )
+        {
+            for ( x = 0; x <= QuadsWide; ++x )
+            {
+                // Vertices kept by this level have no error
+                if ( (x % Step) == 0 && (z % Step) == 0 ) continue;
+
+                // Find the coarse quad and the position within it
+                unsigned long cx = x / Step, cz = z / Step;
+                if ( cx * Step == QuadsWide ) cx--;
+                if ( cz * Step == QuadsHigh ) cz--;
+                float fPercentX = (float)(x - cx * Step) / (float)Step;
+                float fPercentZ = (float)(z - cz * Step) / (float)Step;
+
+                const float * pTop    = pHeightMap + StartX + cx * Step + (StartZ + cz * Step) * MapWidth;
+                const float * pBottom = pTop + Step * MapWidth;
+                float fTopLeft = pTop[0], fTopRight = pTop[Step], fBottomLeft = pBottom[0], fBottomRight = pBottom[Step];
+
+                // Same triangle selection as the rendered mesh
+                float fHeight;
+                if ( FlipQuad( cx, cz, Wide, High, bCoarser ) )
+                {
+                    if ( fPercentX + fPercentZ < 1.0f )
+                        fHeight = fTopLeft + (fTopRight - fTopLeft) * fPercentX + (fBottomLeft - fTopLeft) * fPercentZ;
+                    else
+                        fHeight = fBottomRight + (fBottomLeft - fBottomRight) * (1.0f - fPercentX) + (fTopRight - fBottomRight) * (1.0f - fPercentZ);
+
+                } // End if flipped quad
+                else
+                {
+                    if ( fPercentX < fPercentZ )
+                        fTopRight   = fTopLeft + (fBottomRight - fBottomLeft);
+                    else
+                        fBottomLeft = fTopLeft + (fBottomRight - fTopRight);
+
+                    float fTopHeight    = fTopLeft    + ((fTopRight - fTopLeft) * fPercentX );
+                    float fBottomHeight = fBottomLeft + ((fBottomRight - fBottomLeft) * fPercentX );
+                    fHeight             = fTopHeight  + ((fBottomHeight - fTopHeight) * fPercentZ );
+
+                } // End if regular quad
+
+                float fDelta = fabsf( fHeight - pHeightMap[ StartX + x + (StartZ + z) * MapWidth ] ) * HeightScale;
+                if ( fDelta > Error ) Error = fDelta;
+
+            } // Next Column
+
+        } // Next Row
+
+        pErrors[ Level ] = Error;
+
+    } // Next Level
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPixelScale () (Static)
+// Desc : Pixels covered by one world unit, one unit from the camera, for a
+//        perspective projection with the specified vertical FOV (degrees).
+//-----------------------------------------------------------------------------
+float CTerrainLOD::GetPixelScale( float FOV, unsigned long ViewportHeight )
+{
+    return (float)ViewportHeight / (2.0f * tanf( FOV * 0.5f * 3.14159265f / 180.0f ));
+}
+
+//-----------------------------------------------------------------------------
+// Name : SelectLevel () (Static)
+// Desc : Choose the coarsest level whose error, projected at the specified
+//        distance, covers no more than 'MaxPixelError' pixels.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainLOD::SelectLevel( const float * pErrors, unsigned long LevelCount, float Distance, float PixelScale, float MaxPixelError )
+{
+    unsigned long Level;
+
+    for ( Level = LevelCount; Level > 1; --Level )
+    {
+        if ( pErrors[ Level - 1 ] * PixelScale <= MaxPixelError * Distance ) return Level - 1;
+
+    } // Next Level
+
+    // Full detail
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildDrawList () (Static)
+// Desc : Select the interior and the appropriate variant of each edge. Bit N
+//        of 'StitchMask' is set if the neighbour on edge N is one level
+//        coarser. Runs which follow on from each other are merged.
+// Note : Returns the number of draws required (at most EDGE_COUNT + 1).
+//-----------------------------------------------------------------------------
+unsigned long CTerrainLOD::BuildDrawList( const LODRANGE Ranges[RANGE_COUNT], unsigned long StitchMask, LODRANGE Draws[EDGE_COUNT + 1] )
+{
+    unsigned long Count = 0, i;
+
+    for ( i = 0; i <= EDGE_COUNT; ++i )
+    {
+        const LODRANGE & Range = ( i == 0 ) ? Ranges[ RANGE_INTERIOR ] :
+                                 ( StitchMask & (1 << (i - 1)) ) ? Ranges[ RANGE_STITCHED + i - 1 ] : Ranges[ RANGE_EDGE + i - 1 ];
+
+        // Skip empty runs
+        if ( Range.PrimitiveCount == 0 ) continue;
+
+        // Merge with the previous draw where possible
+        if ( Count > 0 && Draws[ Count - 1 ].StartIndex + Draws[ Count - 1 ].PrimitiveCount * 3 == Range.StartIndex )
+        {
+            Draws[ Count - 1 ].PrimitiveCount += Range.PrimitiveCount;
+            continue;
+
+        } // End if contiguous
+
+        Draws[ Count++ ] = Range;
+
+    } // Next Range
+
+    return Count;
+}
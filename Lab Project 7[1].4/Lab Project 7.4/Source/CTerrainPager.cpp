@@ -0,0 +1,846 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainPager.cpp
+//
+// Desc: Out of core terrain support. CTerrainTileFile stores a heightmap on
+//       disk as independently loadable tiles (one per terrain block), and
+//       CTerrainPager keeps the tiles within a radius of the player resident,
+//       loading them on a background thread, prefetching along the direction
+//       of travel and evicting the least recently used tiles once over budget.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainPager Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainPager.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(_WIN32)
+    #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const char          TileMagic[4]  = { 'T', 'T', 'I', 'L' };
+    const unsigned long MAX_SEEK_STEP = 0x3FFFFFFF;    // Largest single relative seek
+
+    //-------------------------------------------------------------------------
+    // Name : SeekTile ()
+    // Desc : Seek to the start of a tile. Large files are reached with several
+    //        relative seeks, so that offsets beyond the range of a long work.
+    //-------------------------------------------------------------------------
+    bool SeekTile( FILE * pFile, unsigned long TileIndex, unsigned long TileBytes )
+    {
+        unsigned long TilesPerStep = MAX_SEEK_STEP / TileBytes;
+
+        if ( fseek( pFile, sizeof(TILEFILEHEADER), SEEK_SET ) != 0 ) return false;
+        if ( TilesPerStep == 0 ) TilesPerStep = 1;
+
+        while ( TileIndex > 0 )
+        {
+            unsigned long Step = ( TileIndex < TilesPerStep ) ? TileIndex : TilesPerStep;
+            if ( fseek( pFile, (long)(Step * TileBytes), SEEK_CUR ) != 0 ) return false;
+            TileIndex -= Step;
+
+        } // Next Step
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : WaitBriefly ()
+    // Desc : Give up the rest of our time slice while waiting on the loader.
+    //-------------------------------------------------------------------------
+    void WaitBriefly( )
+    {
+#if defined(_WIN32)
+        Sleep( 1 );
+#else
+        usleep( 1000 );
+#endif
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainTileFile () (Constructor)
+// Desc : CTerrainTileFile Class Constructor
+//-----------------------------------------------------------------------------
+CTerrainTileFile::CTerrainTileFile()
+{
+	// Reset / Clear all required values
+    m_pFile = NULL;
+    memset( &m_Header, 0, sizeof(TILEFILEHEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainTileFile () (Destructor)
+// Desc : CTerrainTileFile Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainTileFile::~CTerrainTileFile()
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : Open a tile file and validate its header.
+//-----------------------------------------------------------------------------
+bool CTerrainTileFile::Open( const char * FileName )
+{
+    // Release any previous file
+    Close();
+
+    // Open the file and read the header
+    m_pFile = fopen( FileName, "rb" );
+    if ( !m_pFile ) return false;
+    if ( fread( &m_Header, sizeof(TILEFILEHEADER), 1, m_pFile ) != 1 ) { Close(); return false; }
+
+    // Validate it
+    if ( memcmp( m_Header.Magic, TileMagic, 4 ) != 0 || m_Header.Version != TILE_FILE_VERSION ||
+         m_Header.Apron != TILE_APRON || m_Header.TileQuads == 0 || m_Header.TilesWide == 0 || m_Header.TilesHigh == 0 )
+    {
+        Close();
+        return false;
+
+    } // End if invalid
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+// Desc : Close the file, if open.
+//-----------------------------------------------------------------------------
+void CTerrainTileFile::Close( )
+{
+    if ( m_pFile ) fclose( m_pFile );
+    m_pFile = NULL;
+    memset( &m_Header, 0, sizeof(TILEFILEHEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReadTile ()
+// Desc : Read a single tile's samples (GetPitch() squared floats).
+//-----------------------------------------------------------------------------
+bool CTerrainTileFile::ReadTile( unsigned long TileX, unsigned long TileZ, float * pSamples )
+{
+    unsigned long Count = GetPitch() * GetPitch();
+
+    // Validate Parameters
+    if ( !m_pFile || !pSamples || TileX >= m_Header.TilesWide || TileZ >= m_Header.TilesHigh ) return false;
+
+    if ( !SeekTile( m_pFile, TileX + TileZ * m_Header.TilesWide, Count * sizeof(float) ) ) return false;
+    return ( fread( pSamples, sizeof(float), Count, m_pFile ) == Count );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Write () (Static)
+// Desc : Cut a heightmap in to tiles of 'TileQuads' quads and write them out.
+//        Samples left over beyond the last whole tile are not stored, in the
+//        same way that CTerrain only builds whole blocks.
+//-----------------------------------------------------------------------------
+bool CTerrainTileFile::Write( const char * FileName, const float * pHeightMap, unsigned long Width, unsigned long Height, unsigned long TileQuads )
+{
+    TILEFILEHEADER Header;
+    unsigned long  Pitch = TileQuads + 1 + TILE_APRON * 2;
+    unsigned long  tx, tz, x, z;
+    bool           bResult = true;
+
+    // Validate Parameters
+    if ( !pHeightMap || TileQuads == 0 || Width < TileQuads + 1 || Height < TileQuads + 1 ) return false;
+
+    // Build the header
+    memcpy( Header.Magic, TileMagic, 4 );
+    Header.Version   = TILE_FILE_VERSION;
+    Header.MapWidth  = Width;
+    Header.MapHeight = Height;
+    Header.TileQuads = TileQuads;
+    Header.Apron     = TILE_APRON;
+    Header.TilesWide = (Width - 1) / TileQuads;
+    Header.TilesHigh = (Height - 1) / TileQuads;
+
+    FILE * pFile = fopen( FileName, "wb" );
+    if ( !pFile ) return false;
+    float * pTile = new float[ Pitch * Pitch ];
+
+    bResult = ( fwrite( &Header, sizeof(TILEFILEHEADER), 1, pFile ) == 1 );
+    for ( tz = 0; tz < Header.TilesHigh && bResult; ++tz )
+    {
+        for ( tx = 0; tx < Header.TilesWide && bResult; ++tx )
+        {
+            // Gather the tile and its apron, clamped to the map
+            for ( z = 0; z < Pitch; ++z )
+            {
+                long sz = (long)(tz * TileQuads + z) - (long)TILE_APRON;
+                if ( sz < 0 ) sz = 0;
+                if ( sz > (long)Height - 1 ) sz = (long)Height - 1;
+
+                for ( x = 0; x < Pitch; ++x )
+                {
+                    long sx = (long)(tx * TileQuads + x) - (long)TILE_APRON;
+                    if ( sx < 0 ) sx = 0;
+                    if ( sx > (long)Width - 1 ) sx = (long)Width - 1;
+                    pTile[ x + z * Pitch ] = pHeightMap[ sx + sz * Width ];
+
+                } // Next Column
+
+            } // Next Row
+
+            bResult = ( fwrite( pTile, sizeof(float), Pitch * Pitch, pFile ) == Pitch * Pitch );
+
+        } // Next Tile
+
+    } // Next Tile Row
+
+    // Clean up
+    delete []pTile;
+    if ( fclose( pFile ) != 0 ) bResult = false;
+
+    // Don't leave a partial file behind
+    if ( !bResult ) remove( FileName );
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsValid () (Static)
+// Desc : Does this tile file exist, and was it built for a heightmap of the
+//        specified size and tile layout?
+//-----------------------------------------------------------------------------
+bool CTerrainTileFile::IsValid( const char * FileName, unsigned long Width, unsigned long Height, unsigned long TileQuads )
+{
+    CTerrainTileFile File;
+
+    if ( !File.Open( FileName ) ) return false;
+    const TILEFILEHEADER & Header = File.GetHeader();
+    return ( Header.MapWidth == Width && Header.MapHeight == Height && Header.TileQuads == TileQuads );
+}
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainPager () (Constructor)
+// Desc : CTerrainPager Class Constructor
+//-----------------------------------------------------------------------------
+CTerrainPager::CTerrainPager()
+{
+	// Reset / Clear all required values
+    m_pTiles          = NULL;
+    m_nTilesWide      = 0;
+    m_nTilesHigh      = 0;
+    m_nTileQuads      = 0;
+    m_fTileSizeX      = 1.0f;
+    m_fTileSizeZ      = 1.0f;
+    m_fRadius         = 0.0f;
+    m_fPrefetchTime   = 0.0f;
+    m_nBudget         = 0;
+    m_nMaxLoads       = 0;
+    m_nFrame          = 0;
+    m_pResident       = NULL;
+    m_nResidentCount  = 0;
+    m_pWanted         = NULL;
+    m_nWantedCount    = 0;
+    m_pDelivery       = NULL;
+    m_pRequests       = NULL;
+    m_nRequestCount   = 0;
+    m_nNextRequest    = 0;
+    m_nLoading        = 0;
+    m_pCompleted      = NULL;
+    m_nCompletedCount = 0;
+    m_pLoaded         = NULL;
+    m_pEvicted        = NULL;
+    m_pContext        = NULL;
+    m_bThreaded       = false;
+    m_bShutdown       = false;
+    memset( &m_Stats, 0, sizeof(PAGERSTATS) );
+
+#if defined(_WIN32)
+    m_hThread         = NULL;
+    m_hWake           = NULL;
+    InitializeCriticalSection( &m_Lock );
+#else
+    pthread_mutex_init( &m_Mutex, NULL );
+    pthread_cond_init( &m_WakeCond, NULL );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainPager () (Destructor)
+// Desc : CTerrainPager Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainPager::~CTerrainPager()
+{
+    // Stop the loader and release the tiles
+    Release();
+
+#if defined(_WIN32)
+    DeleteCriticalSection( &m_Lock );
+#else
+    pthread_cond_destroy( &m_WakeCond );
+    pthread_mutex_destroy( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Open the tile file and start the loader. 'ScaleX' / 'ScaleZ' are the
+//        world space size of a quad, 'Radius' is in world units and 'Budget'
+//        in tiles. Without a thread (or if it cannot be created) requests
+//        are loaded during Update, at most 'MaxLoadsPerUpdate' at a time
+//        (0 = no limit).
+//-----------------------------------------------------------------------------
+bool CTerrainPager::Create( const char * FileName, float ScaleX, float ScaleZ, float Radius, unsigned long Budget,
+                            float PrefetchTime, bool Threaded, unsigned long MaxLoadsPerUpdate )
+{
+    unsigned long i, TileCount;
+
+    // Release any previous data
+    Release();
+
+    // Open the tile file
+    if ( !m_File.Open( FileName ) ) return false;
+    const TILEFILEHEADER & Header = m_File.GetHeader();
+
+    // Store the settings
+    m_nTilesWide    = Header.TilesWide;
+    m_nTilesHigh    = Header.TilesHigh;
+    m_nTileQuads    = Header.TileQuads;
+    m_fTileSizeX    = (float)m_nTileQuads * ScaleX;
+    m_fTileSizeZ    = (float)m_nTileQuads * ScaleZ;
+    m_fRadius       = Radius;
+    m_fPrefetchTime = PrefetchTime;
+    m_nBudget       = Budget;
+    m_nMaxLoads     = MaxLoadsPerUpdate;
+    m_nFrame        = 0;
+    TileCount       = m_nTilesWide * m_nTilesHigh;
+
+    // Allocate the tile table and lists
+    m_pTiles     = new TILE[ TileCount ];
+    m_pResident  = new unsigned long[ TileCount ];
+    m_pWanted    = new REQUEST[ TileCount ];
+    m_pDelivery  = new unsigned long[ TileCount ];
+    m_pRequests  = new REQUEST[ TileCount ];
+    m_pCompleted = new unsigned long[ TileCount ];
+    if ( !m_pTiles || !m_pResident || !m_pWanted || !m_pDelivery || !m_pRequests || !m_pCompleted ) { Release(); return false; }
+
+    for ( i = 0; i < TileCount; ++i )
+    {
+        m_pTiles[i].State     = TILE_NONE;
+        m_pTiles[i].pSamples  = NULL;
+        m_pTiles[i].LastUsed  = 0;
+        m_pTiles[i].bResident = false;
+        m_pTiles[i].bFailed   = false;
+
+    } // Next Tile
+
+    // Start the loader thread (falling back to loading during Update)
+    m_bShutdown = false;
+    m_bThreaded = false;
+    if ( Threaded )
+    {
+#if defined(_WIN32)
+        m_hWake = CreateEvent( NULL, FALSE, FALSE, NULL );
+        if ( m_hWake ) m_hThread = CreateThread( NULL, 0, LoaderProc, this, 0, NULL );
+        m_bThreaded = ( m_hThread != NULL );
+#else
+        m_bThreaded = ( pthread_create( &m_Thread, NULL, LoaderProc, this ) == 0 );
+#endif
+
+    } // End if threaded
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Stop the loader and free every tile. The eviction callback is not
+//        called, the application is expected to release its own data.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Release( )
+{
+    unsigned long i;
+
+    // Stop the loader thread
+    if ( m_bThreaded )
+    {
+        Lock();
+        m_bShutdown = true;
+        Unlock();
+        Wake();
+
+#if defined(_WIN32)
+        WaitForSingleObject( m_hThread, INFINITE );
+        CloseHandle( m_hThread );
+#else
+        pthread_join( m_Thread, NULL );
+#endif
+        m_bThreaded = false;
+
+    } // End if threaded
+
+#if defined(_WIN32)
+    if ( m_hWake ) CloseHandle( m_hWake );
+    m_hThread = NULL;
+    m_hWake   = NULL;
+#endif
+
+    // Release the tiles
+    if ( m_pTiles )
+    {
+        for ( i = 0; i < m_nTilesWide * m_nTilesHigh; ++i )
+        {
+            if ( m_pTiles[i].pSamples ) delete []m_pTiles[i].pSamples;
+
+        } // Next Tile
+
+        delete []m_pTiles;
+
+    } // End if tiles
+
+    // Release the lists
+    if ( m_pResident  ) delete []m_pResident;
+    if ( m_pWanted    ) delete []m_pWanted;
+    if ( m_pDelivery  ) delete []m_pDelivery;
+    if ( m_pRequests  ) delete []m_pRequests;
+    if ( m_pCompleted ) delete []m_pCompleted;
+    m_File.Close();
+
+    // Clear Variables
+    m_pTiles          = NULL;
+    m_pResident       = NULL;
+    m_pWanted         = NULL;
+    m_pDelivery       = NULL;
+    m_pRequests       = NULL;
+    m_pCompleted      = NULL;
+    m_nTilesWide      = 0;
+    m_nTilesHigh      = 0;
+    m_nResidentCount  = 0;
+    m_nWantedCount    = 0;
+    m_nRequestCount   = 0;
+    m_nNextRequest    = 0;
+    m_nLoading        = 0;
+    m_nCompletedCount = 0;
+    memset( &m_Stats, 0, sizeof(PAGERSTATS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetCallbacks ()
+// Desc : Set the functions notified as tiles become resident or are evicted.
+//-----------------------------------------------------------------------------
+void CTerrainPager::SetCallbacks( TILELOADED pLoaded, TILEEVICTED pEvicted, void * pContext )
+{
+    m_pLoaded  = pLoaded;
+    m_pEvicted = pEvicted;
+    m_pContext = pContext;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Hand over any tiles loaded since the last call, then re-prioritise
+//        the load queue around the player's position and evict whatever no
+//        longer fits in the budget. Call once per frame.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Update( const float Position[3], const float Velocity[3] )
+{
+    unsigned long i, Required, Wanted, Limit;
+
+    // Validate requirements
+    if ( !m_pTiles ) return;
+
+    // Advance the LRU clock
+    m_nFrame++;
+
+    // Hand over the tiles read since last time
+    Deliver();
+
+    // Tiles within the radius of the player are required, nearest first
+    Required = GatherTiles( Position[0], Position[2], 0.0f, m_pWanted, 0, m_nTilesWide * m_nTilesHigh );
+    qsort( m_pWanted, Required, sizeof(REQUEST), CompareRequests );
+    for ( i = 0; i < Required; ++i ) m_pTiles[ m_pWanted[i].Tile ].LastUsed = m_nFrame;
+
+    // Followed by those around the predicted position, as far as the budget allows
+    Wanted = Required;
+    if ( m_fPrefetchTime > 0.0f && (Velocity[0] != 0.0f || Velocity[2] != 0.0f) )
+    {
+        Wanted = GatherTiles( Position[0] + Velocity[0] * m_fPrefetchTime, Position[2] + Velocity[2] * m_fPrefetchTime,
+                              0.0f, m_pWanted, Required, m_nTilesWide * m_nTilesHigh );
+        qsort( m_pWanted + Required, Wanted - Required, sizeof(REQUEST), CompareRequests );
+
+        Limit = ( m_nBudget > Required ) ? m_nBudget : Required;
+        if ( Wanted > Limit ) Wanted = Limit;
+        for ( i = Required; i < Wanted; ++i ) m_pTiles[ m_pWanted[i].Tile ].LastUsed = m_nFrame;
+
+    } // End if prefetching
+    m_nWantedCount   = Wanted;
+    m_Stats.Required = Required;
+
+    // Rebuild the load queue. Tiles still queued from last time are dropped,
+    // any which are still wanted are simply queued again.
+    Lock();
+    for ( i = m_nNextRequest; i < m_nRequestCount; ++i ) m_pTiles[ m_pRequests[i].Tile ].State = TILE_NONE;
+    m_nRequestCount = 0;
+    m_nNextRequest  = 0;
+
+    for ( i = 0; i < Wanted; ++i )
+    {
+        TILE & Tile = m_pTiles[ m_pWanted[i].Tile ];
+        if ( Tile.bResident || Tile.bFailed || Tile.State != TILE_NONE ) continue;
+
+        m_pRequests[ m_nRequestCount++ ] = m_pWanted[i];
+        Tile.State = TILE_QUEUED;
+
+    } // Next Wanted Tile
+    Unlock();
+
+    // Start loading
+    if ( m_bThreaded )
+    {
+        if ( m_nRequestCount > 0 ) Wake();
+
+    } // End if threaded
+    else
+    {
+        Lock();
+        for ( i = 0; (m_nMaxLoads == 0 || i < m_nMaxLoads) && LoadNext(); ++i );
+        Unlock();
+        Deliver();
+
+    } // End if loading here
+
+    // Make room
+    Evict();
+    UpdateStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Flush ()
+// Desc : Block until every queued tile has been loaded and handed over. Used
+//        at start up so that the player never starts on a missing tile.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Flush( )
+{
+    bool bIdle;
+
+    // Validate requirements
+    if ( !m_pTiles ) return;
+
+    for ( ;; )
+    {
+        Lock();
+        if ( !m_bThreaded ) while ( LoadNext() );
+        bIdle = ( m_nNextRequest >= m_nRequestCount && m_nLoading == 0 );
+        Unlock();
+
+        // Anything finished before the loader went idle is now complete
+        Deliver();
+        if ( bIdle ) break;
+        WaitBriefly();
+
+    } // Next Wait
+
+    Evict();
+    UpdateStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsResident ()
+// Desc : Has this tile been handed over to the application?
+//-----------------------------------------------------------------------------
+bool CTerrainPager::IsResident( unsigned long TileX, unsigned long TileZ ) const
+{
+    if ( !m_pTiles || TileX >= m_nTilesWide || TileZ >= m_nTilesHigh ) return false;
+    return m_pTiles[ TileX + TileZ * m_nTilesWide ].bResident;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetTileSamples ()
+// Desc : Retrieve a resident tile's first sample (see TILELOADED), or NULL.
+//-----------------------------------------------------------------------------
+const float * CTerrainPager::GetTileSamples( unsigned long TileX, unsigned long TileZ ) const
+{
+    if ( !IsResident( TileX, TileZ ) ) return NULL;
+    return m_pTiles[ TileX + TileZ * m_nTilesWide ].pSamples + TILE_APRON * (GetPitch() + 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Lock () (Private)
+// Desc : Acquire the lock guarding the queue and tile states.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Lock( )
+{
+#if defined(_WIN32)
+    EnterCriticalSection( &m_Lock );
+#else
+    pthread_mutex_lock( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : Unlock () (Private)
+// Desc : Release the lock guarding the queue and tile states.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Unlock( )
+{
+#if defined(_WIN32)
+    LeaveCriticalSection( &m_Lock );
+#else
+    pthread_mutex_unlock( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : Wake () (Private)
+// Desc : Wake the loader thread, requests have been queued (or it must exit).
+//-----------------------------------------------------------------------------
+void CTerrainPager::Wake( )
+{
+#if defined(_WIN32)
+    if ( m_hWake ) SetEvent( m_hWake );
+#else
+    pthread_mutex_lock( &m_Mutex );
+    pthread_cond_signal( &m_WakeCond );
+    pthread_mutex_unlock( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoadNext () (Private)
+// Desc : Read the next queued tile. Called with the lock held, which is
+//        released while the file is being read.
+// Note : Returns false if the queue was empty.
+//-----------------------------------------------------------------------------
+bool CTerrainPager::LoadNext( )
+{
+    unsigned long Index, Pitch = GetPitch();
+    float       * pSamples;
+    bool          bResult;
+
+    // Anything to do?
+    if ( m_nNextRequest >= m_nRequestCount ) return false;
+
+    // Claim the request
+    Index = m_pRequests[ m_nNextRequest++ ].Tile;
+    m_pTiles[ Index ].State = TILE_LOADING;
+    m_nLoading++;
+    Unlock();
+
+    // Read it
+    pSamples = new float[ Pitch * Pitch ];
+    bResult  = pSamples && m_File.ReadTile( Index % m_nTilesWide, Index / m_nTilesWide, pSamples );
+    if ( !bResult && pSamples ) { delete []pSamples; pSamples = NULL; }
+
+    // Pass it back
+    Lock();
+    m_pTiles[ Index ].pSamples = pSamples;
+    m_pTiles[ Index ].State    = TILE_LOADED;
+    m_pCompleted[ m_nCompletedCount++ ] = Index;
+    m_nLoading--;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Deliver () (Private)
+// Desc : Hand every loaded tile over to the application.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Deliver( )
+{
+    unsigned long i, Count;
+
+    // Take the completed list
+    Lock();
+    Count = m_nCompletedCount;
+    for ( i = 0; i < Count; ++i )
+    {
+        m_pDelivery[i] = m_pCompleted[i];
+        m_pTiles[ m_pCompleted[i] ].State = TILE_NONE;
+
+    } // Next Completed Tile
+    m_nCompletedCount = 0;
+    Unlock();
+
+    // The callbacks run without the lock, the loader carries on meanwhile
+    for ( i = 0; i < Count; ++i )
+    {
+        unsigned long Index = m_pDelivery[i];
+        TILE        & Tile  = m_pTiles[ Index ];
+
+        if ( Tile.pSamples && (!m_pLoaded || m_pLoaded( m_pContext, Index % m_nTilesWide, Index / m_nTilesWide,
+                                                        Tile.pSamples + TILE_APRON * (GetPitch() + 1), GetPitch() )) )
+        {
+            Tile.bResident = true;
+            m_pResident[ m_nResidentCount++ ] = Index;
+            m_Stats.Loads++;
+
+        } // End if loaded
+        else
+        {
+            // Don't keep retrying a tile which cannot be loaded
+            if ( Tile.pSamples ) delete []Tile.pSamples;
+            Tile.pSamples = NULL;
+            Tile.bFailed  = true;
+            m_Stats.Failures++;
+
+        } // End if failed
+
+    } // Next Tile
+}
+
+//-----------------------------------------------------------------------------
+// Name : Evict () (Private)
+// Desc : Evict the least recently wanted tiles until we are within budget.
+//        Tiles wanted by the current Update are never evicted.
+//-----------------------------------------------------------------------------
+void CTerrainPager::Evict( )
+{
+    while ( m_nResidentCount > m_nBudget )
+    {
+        unsigned long i, Oldest = m_nResidentCount;
+
+        // Find the least recently used
+        for ( i = 0; i < m_nResidentCount; ++i )
+        {
+            const TILE & Tile = m_pTiles[ m_pResident[i] ];
+            if ( Tile.LastUsed == m_nFrame ) continue;
+            if ( Oldest == m_nResidentCount || Tile.LastUsed < m_pTiles[ m_pResident[Oldest] ].LastUsed ) Oldest = i;
+
+        } // Next Resident Tile
+
+        // Everything resident is in use
+        if ( Oldest == m_nResidentCount ) break;
+
+        // Evict it
+        unsigned long Index = m_pResident[ Oldest ];
+        TILE        & Tile  = m_pTiles[ Index ];
+        if ( m_pEvicted ) m_pEvicted( m_pContext, Index % m_nTilesWide, Index / m_nTilesWide );
+        delete []Tile.pSamples;
+        Tile.pSamples  = NULL;
+        Tile.bResident = false;
+        m_pResident[ Oldest ] = m_pResident[ --m_nResidentCount ];
+        m_Stats.Evictions++;
+
+    } // Next Eviction
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateStats () (Private)
+// Desc : Refresh the residency counters.
+//-----------------------------------------------------------------------------
+void CTerrainPager::UpdateStats( )
+{
+    unsigned long i;
+
+    m_Stats.Resident    = m_nResidentCount;
+    m_Stats.Missing     = 0;
+    m_Stats.Prefetching = 0;
+    for ( i = 0; i < m_nWantedCount; ++i )
+    {
+        if ( m_pTiles[ m_pWanted[i].Tile ].bResident ) continue;
+        if ( i < m_Stats.Required ) m_Stats.Missing++; else m_Stats.Prefetching++;
+
+    } // Next Wanted Tile
+
+    Lock();
+    m_Stats.Pending = (m_nRequestCount - m_nNextRequest) + m_nLoading + m_nCompletedCount;
+    Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GatherTiles () (Private)
+// Desc : Append every tile within the radius of (x, z) which is not already
+//        wanted this Update, prioritised by distance.
+// Note : Returns the new number of entries in the list.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainPager::GatherTiles( float x, float z, float Priority, REQUEST * pList, unsigned long Count, unsigned long Max )
+{
+    long MinX = (long)floorf( (x - m_fRadius) / m_fTileSizeX ), MaxX = (long)floorf( (x + m_fRadius) / m_fTileSizeX );
+    long MinZ = (long)floorf( (z - m_fRadius) / m_fTileSizeZ ), MaxZ = (long)floorf( (z + m_fRadius) / m_fTileSizeZ );
+    long tx, tz;
+
+    // Clamp to the terrain
+    if ( MinX < 0 ) MinX = 0;
+    if ( MinZ < 0 ) MinZ = 0;
+    if ( MaxX > (long)m_nTilesWide - 1 ) MaxX = (long)m_nTilesWide - 1;
+    if ( MaxZ > (long)m_nTilesHigh - 1 ) MaxZ = (long)m_nTilesHigh - 1;
+
+    for ( tz = MinZ; tz <= MaxZ; ++tz )
+    {
+        for ( tx = MinX; tx <= MaxX; ++tx )
+        {
+            unsigned long Index = (unsigned long)tx + (unsigned long)tz * m_nTilesWide;
+            float         dx = 0.0f, dz = 0.0f, Distance;
+
+            // Distance to the nearest point of the tile
+            if ( x < tx * m_fTileSizeX ) dx = tx * m_fTileSizeX - x; else if ( x > (tx + 1) * m_fTileSizeX ) dx = x - (tx + 1) * m_fTileSizeX;
+            if ( z < tz * m_fTileSizeZ ) dz = tz * m_fTileSizeZ - z; else if ( z > (tz + 1) * m_fTileSizeZ ) dz = z - (tz + 1) * m_fTileSizeZ;
+            Distance = sqrtf( dx * dx + dz * dz );
+
+            if ( Distance > m_fRadius || m_pTiles[ Index ].LastUsed == m_nFrame || Count >= Max ) continue;
+            pList[ Count ].Tile     = Index;
+            pList[ Count ].Priority = Priority + Distance;
+            Count++;
+
+        } // Next Tile
+
+    } // Next Tile Row
+
+    return Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CompareRequests () (Static, Private)
+// Desc : qsort callback, orders requests by ascending priority.
+//-----------------------------------------------------------------------------
+int CTerrainPager::CompareRequests( const void * pA, const void * pB )
+{
+    float a = ((const REQUEST*)pA)->Priority, b = ((const REQUEST*)pB)->Priority;
+    return ( a < b ) ? -1 : ( a > b ) ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoaderLoop () (Private)
+// Desc : Body of the loader thread, reads requests until shut down.
+//-----------------------------------------------------------------------------
+void CTerrainPager::LoaderLoop( )
+{
+    Lock();
+    while ( !m_bShutdown )
+    {
+        // Load the next request, or sleep until there is one
+        if ( LoadNext() ) continue;
+
+#if defined(_WIN32)
+        Unlock();
+        WaitForSingleObject( m_hWake, INFINITE );
+        Lock();
+#else
+        pthread_cond_wait( &m_WakeCond, &m_Mutex );
+#endif
+
+    } // Next Request
+    Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoaderProc () (Static, Private)
+// Desc : Loader thread entry point.
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+DWORD WINAPI CTerrainPager::LoaderProc( LPVOID pParam )
+{
+    ((CTerrainPager*)pParam)->LoaderLoop();
+    return 0;
+}
+#else
+void * CTerrainPager::LoaderProc( void * pParam )
+{
+    ((CTerrainPager*)pParam)->LoaderLoop();
+    return NULL;
+}
+#endif
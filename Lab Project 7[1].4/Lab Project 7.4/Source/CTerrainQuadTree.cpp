@@ -0,0 +1,370 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainQuadTree.cpp
+//
+// Desc: Bounding volume quadtree over the terrain block grid, used to frustum
+//       cull whole regions of blocks at a time.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainQuadTree Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainQuadTree.h"
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const unsigned long MAX_CULL_STACK = 3 * 32 + 1;   // Enough for any tree depth we can index
+    const float         EMPTY_BOUNDS   = 1e30f;         // Min / Max of a node with no blocks
+
+    //-------------------------------------------------------------------------
+    // Name : CULLENTRY (Struct)
+    // Desc : Pending node on the traversal stack.
+    //-------------------------------------------------------------------------
+    struct CULLENTRY
+    {
+        unsigned long   Node;           // Node to visit
+        unsigned long   PlaneMask;      // Planes its parent straddled
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : SetEmpty ()
+    // Desc : Invert a box so that it contains nothing.
+    //-------------------------------------------------------------------------
+    void SetEmpty( float Min[3], float Max[3] )
+    {
+        Min[0] = Min[1] = Min[2] =  EMPTY_BOUNDS;
+        Max[0] = Max[1] = Max[2] = -EMPTY_BOUNDS;
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainQuadTree () (Constructor)
+// Desc : CTerrainQuadTree Class Constructor
+//-----------------------------------------------------------------------------
+CTerrainQuadTree::CTerrainQuadTree()
+{
+	// Reset / Clear all required values
+    m_pNodes      = NULL;
+    m_nNodeCount  = 0;
+    m_pBlockOrder = NULL;
+    m_pBlockLeaf  = NULL;
+    m_pBlockValid = NULL;
+    m_nBlocksWide = 0;
+    m_nBlockCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainQuadTree () (Destructor)
+// Desc : CTerrainQuadTree Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainQuadTree::~CTerrainQuadTree()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : Build the tree over a grid of blocks. Every block starts without
+//        bounds, they must be supplied with SetBlockBounds.
+//-----------------------------------------------------------------------------
+bool CTerrainQuadTree::Build( unsigned long BlocksWide, unsigned long BlocksHigh )
+{
+    unsigned long NodeCount;
+
+    // Release any previous tree
+    Release();
+
+    // Validate Parameters
+    if ( BlocksWide == 0 || BlocksHigh == 0 ) return false;
+
+    // Allocate the node & block tables
+    NodeCount     = CountNodes( BlocksWide, BlocksHigh );
+    m_nBlocksWide = BlocksWide;
+    m_nBlockCount = BlocksWide * BlocksHigh;
+    m_pNodes      = new NODE[ NodeCount ];
+    m_pBlockOrder = new unsigned long[ m_nBlockCount ];
+    m_pBlockLeaf  = new unsigned long[ m_nBlockCount ];
+    m_pBlockValid = new unsigned char[ m_nBlockCount ];
+    if ( !m_pNodes || !m_pBlockOrder || !m_pBlockLeaf || !m_pBlockValid ) { Release(); return false; }
+    memset( m_pBlockValid, 0, m_nBlockCount );
+
+    // Build the nodes, root first
+    m_nNodeCount = 0;
+    BuildNode( 0, 0, 0, BlocksWide, BlocksHigh );
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Free the tree.
+//-----------------------------------------------------------------------------
+void CTerrainQuadTree::Release( )
+{
+    if ( m_pNodes      ) delete []m_pNodes;
+    if ( m_pBlockOrder ) delete []m_pBlockOrder;
+    if ( m_pBlockLeaf  ) delete []m_pBlockLeaf;
+    if ( m_pBlockValid ) delete []m_pBlockValid;
+
+    m_pNodes      = NULL;
+    m_nNodeCount  = 0;
+    m_pBlockOrder = NULL;
+    m_pBlockLeaf  = NULL;
+    m_pBlockValid = NULL;
+    m_nBlocksWide = 0;
+    m_nBlockCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetBlockBounds ()
+// Desc : Store the bounding box of a block and refit the nodes above it.
+//-----------------------------------------------------------------------------
+void CTerrainQuadTree::SetBlockBounds( unsigned long Block, const float Min[3], const float Max[3] )
+{
+    if ( Block >= m_nBlockCount ) return;
+
+    NODE & Leaf = m_pNodes[ m_pBlockLeaf[ Block ] ];
+    memcpy( Leaf.Min, Min, sizeof(Leaf.Min) );
+    memcpy( Leaf.Max, Max, sizeof(Leaf.Max) );
+    m_pBlockValid[ Block ] = 1;
+
+    // Refit the ancestors (unless the leaf is the root)
+    if ( m_pBlockLeaf[ Block ] != 0 ) Refit( Leaf.Parent );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClearBlockBounds ()
+// Desc : The block no longer exists (it has been paged out for instance).
+//-----------------------------------------------------------------------------
+void CTerrainQuadTree::ClearBlockBounds( unsigned long Block )
+{
+    if ( Block >= m_nBlockCount ) return;
+
+    NODE & Leaf = m_pNodes[ m_pBlockLeaf[ Block ] ];
+    SetEmpty( Leaf.Min, Leaf.Max );
+    m_pBlockValid[ Block ] = 0;
+
+    // Refit the ancestors (unless the leaf is the root)
+    if ( m_pBlockLeaf[ Block ] != 0 ) Refit( Leaf.Parent );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Cull ()
+// Desc : Write the index of every block whose bounds touch the frustum in to
+//        'pVisible' (which must hold a block count's worth of entries). Whole
+//        subtrees are skipped once outside any plane, and planes which a
+//        node lies entirely inside are not tested again below it.
+// Note : Returns the number of visible blocks.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainQuadTree::Cull( const float * pPlanes, unsigned long * pVisible, CULLSTATS * pStats ) const
+{
+    CULLENTRY     Stack[ MAX_CULL_STACK ];
+    unsigned long StackCount = 0, VisibleCount = 0, i;
+    CULLSTATS     Stats;
+
+    memset( &Stats, 0, sizeof(CULLSTATS) );
+
+    if ( m_nNodeCount > 0 )
+    {
+        Stack[0].Node      = 0;
+        Stack[0].PlaneMask = FRUSTUM_ALL_PLANES;
+        StackCount         = 1;
+
+    } // End if built
+
+    while ( StackCount > 0 )
+    {
+        CULLENTRY    Entry = Stack[ --StackCount ];
+        const NODE & Node  = m_pNodes[ Entry.Node ];
+
+        Stats.NodesVisited++;
+
+        // Nothing below this node has any bounds
+        if ( Node.Min[0] > Node.Max[0] ) continue;
+
+        // Test against the planes our parent straddled
+        Stats.BoxesTested++;
+        if ( !TestBox( pPlanes, Node.Min, Node.Max, Entry.PlaneMask, &Stats.PlanesTested ) ) continue;
+
+        // Entirely inside, every block below is visible
+        if ( Entry.PlaneMask == 0 || Node.ChildCount == 0 )
+        {
+            for ( i = Node.FirstBlock; i < Node.FirstBlock + Node.BlockCount; ++i )
+            {
+                if ( m_pBlockValid[ m_pBlockOrder[i] ] ) pVisible[ VisibleCount++ ] = m_pBlockOrder[i];
+
+            } // Next Block
+            continue;
+
+        } // End if inside or leaf
+
+        // Visit the children
+        for ( i = 0; i < Node.ChildCount; ++i )
+        {
+            Stack[ StackCount ].Node      = Node.Child[i];
+            Stack[ StackCount ].PlaneMask = Entry.PlaneMask;
+            StackCount++;
+
+        } // Next Child
+
+    } // Next Node
+
+    Stats.BlocksVisible = VisibleCount;
+    if ( pStats ) *pStats = Stats;
+    return VisibleCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TestBox () (Static)
+// Desc : Test a box against the planes set in 'PlaneMask'. Returns false if
+//        the box is entirely outside any of them, otherwise clears the bits
+//        of the planes the box is entirely inside.
+//-----------------------------------------------------------------------------
+bool CTerrainQuadTree::TestBox( const float * pPlanes, const float Min[3], const float Max[3], unsigned long & PlaneMask, unsigned long * pPlanesTested )
+{
+    unsigned long i;
+
+    for ( i = 0; i < FRUSTUM_PLANE_COUNT; ++i )
+    {
+        const float * pPlane = pPlanes + i * 4;
+        float         Near, Far;
+
+        if ( !(PlaneMask & (1 << i)) ) continue;
+        if ( pPlanesTested ) (*pPlanesTested)++;
+
+        // Distance to the box corners nearest and furthest along the normal
+        Near = Far = pPlane[3];
+        if ( pPlane[0] > 0.0f ) { Near += pPlane[0] * Min[0]; Far += pPlane[0] * Max[0]; } else { Near += pPlane[0] * Max[0]; Far += pPlane[0] * Min[0]; }
+        if ( pPlane[1] > 0.0f ) { Near += pPlane[1] * Min[1]; Far += pPlane[1] * Max[1]; } else { Near += pPlane[1] * Max[1]; Far += pPlane[1] * Min[1]; }
+        if ( pPlane[2] > 0.0f ) { Near += pPlane[2] * Min[2]; Far += pPlane[2] * Max[2]; } else { Near += pPlane[2] * Max[2]; Far += pPlane[2] * Min[2]; }
+
+        // Outside this plane, outside the frustum
+        if ( Near > 0.0f ) return false;
+
+        // Entirely inside, children need not test it again
+        if ( Far <= 0.0f ) PlaneMask &= ~(1 << i);
+
+    } // Next Plane
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CountNodes () (Private)
+// Desc : Number of nodes needed to cover a rectangle of blocks.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainQuadTree::CountNodes( unsigned long Width, unsigned long Height ) const
+{
+    unsigned long Count = 1, HalfW = (Width + 1) / 2, HalfH = (Height + 1) / 2;
+
+    if ( Width == 1 && Height == 1 ) return 1;
+
+    Count += CountNodes( HalfW, HalfH );
+    if ( Width  > 1 ) Count += CountNodes( Width - HalfW, HalfH );
+    if ( Height > 1 ) Count += CountNodes( HalfW, Height - HalfH );
+    if ( Width  > 1 && Height > 1 ) Count += CountNodes( Width - HalfW, Height - HalfH );
+    return Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildNode () (Private)
+// Desc : Build the node covering this rectangle of blocks and everything
+//        below it, returning its index.
+//-----------------------------------------------------------------------------
+unsigned long CTerrainQuadTree::BuildNode( unsigned long Parent, unsigned long x, unsigned long z, unsigned long Width, unsigned long Height )
+{
+    unsigned long Index = m_nNodeCount++, HalfW = (Width + 1) / 2, HalfH = (Height + 1) / 2;
+    unsigned long FirstBlock = ( Index == 0 ) ? 0 : m_pNodes[ Parent ].FirstBlock + m_pNodes[ Parent ].BlockCount;
+    NODE        * pNode = &m_pNodes[ Index ];
+
+    SetEmpty( pNode->Min, pNode->Max );
+    pNode->Parent     = Parent;
+    pNode->ChildCount = 0;
+    pNode->FirstBlock = FirstBlock;
+    pNode->BlockCount = 0;
+    memset( pNode->Child, 0, sizeof(pNode->Child) );
+
+    // A single block, this is a leaf
+    if ( Width == 1 && Height == 1 )
+    {
+        unsigned long Block = x + z * m_nBlocksWide;
+        m_pBlockOrder[ FirstBlock ] = Block;
+        m_pBlockLeaf[ Block ]       = Index;
+        pNode->BlockCount           = 1;
+        return Index;
+
+    } // End if leaf
+
+    // Build each quarter. The parent's block count grows as each child is
+    // built, so that each child's blocks follow on from its predecessor's.
+    unsigned long Child;
+    Child = BuildNode( Index, x, z, HalfW, HalfH );
+    m_pNodes[ Index ].Child[ m_pNodes[ Index ].ChildCount++ ] = Child;
+    m_pNodes[ Index ].BlockCount += m_pNodes[ Child ].BlockCount;
+
+    if ( Width > 1 )
+    {
+        Child = BuildNode( Index, x + HalfW, z, Width - HalfW, HalfH );
+        m_pNodes[ Index ].Child[ m_pNodes[ Index ].ChildCount++ ] = Child;
+        m_pNodes[ Index ].BlockCount += m_pNodes[ Child ].BlockCount;
+
+    } // End if split across
+
+    if ( Height > 1 )
+    {
+        Child = BuildNode( Index, x, z + HalfH, HalfW, Height - HalfH );
+        m_pNodes[ Index ].Child[ m_pNodes[ Index ].ChildCount++ ] = Child;
+        m_pNodes[ Index ].BlockCount += m_pNodes[ Child ].BlockCount;
+
+    } // End if split down
+
+    if ( Width > 1 && Height > 1 )
+    {
+        Child = BuildNode( Index, x + HalfW, z + HalfH, Width - HalfW, Height - HalfH );
+        m_pNodes[ Index ].Child[ m_pNodes[ Index ].ChildCount++ ] = Child;
+        m_pNodes[ Index ].BlockCount += m_pNodes[ Child ].BlockCount;
+
+    } // End if split both ways
+
+    return Index;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Refit () (Private)
+// Desc : Recalculate the bounds of this node and every node above it from
+//        their children.
+//-----------------------------------------------------------------------------
+void CTerrainQuadTree::Refit( unsigned long Node )
+{
+    for ( ;; )
+    {
+        NODE & Current = m_pNodes[ Node ];
+        unsigned long i, k;
+
+        // Union of the children
+        SetEmpty( Current.Min, Current.Max );
+        for ( i = 0; i < Current.ChildCount; ++i )
+        {
+            const NODE & Child = m_pNodes[ Current.Child[i] ];
+            for ( k = 0; k < 3; ++k )
+            {
+                if ( Child.Min[k] < Current.Min[k] ) Current.Min[k] = Child.Min[k];
+                if ( Child.Max[k] > Current.Max[k] ) Current.Max[k] = Child.Max[k];
+
+            } // Next Axis
+
+        } // Next Child
+
+        // Stop once the root has been refit
+        if ( Current.Parent == Node ) break;
+        Node = Current.Parent;
+
+    } // Next Ancestor
+}
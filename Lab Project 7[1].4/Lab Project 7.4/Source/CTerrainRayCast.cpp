@@ -0,0 +1,566 @@
+//-----------------------------------------------------------------------------
+// File: CTerrainRayCast.cpp
+//
+// Desc: Ray and segment intersection against the heightmap terrain, used for
+//       picking, line of sight and projectile tests. Rays are traced through
+//       a pyramid of min / max quad heights with a hierarchical DDA, so open
+//       sky is skipped in large steps and only the quads a ray actually
+//       passes close to are tested exactly.
+//
+// Copyright (c) 1997-2002 Daedalus Developments. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTerrainRayCast Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CTerrainRayCast.h"
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : BUILDPASS (Struct)
+    // Desc : Everything a thread pool task needs to build its band of a level.
+    //-------------------------------------------------------------------------
+    struct BUILDPASS
+    {
+        CTerrainRayCast * pRayCast;     // Pyramid being built
+        unsigned long     Level;        // Level being built
+        unsigned long     Wide;         // Cells across the level
+        unsigned long     High;         // Cells down the level
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BATCHPASS (Struct)
+    // Desc : Everything a thread pool task needs to trace its share of rays.
+    //-------------------------------------------------------------------------
+    struct BATCHPASS
+    {
+        const CTerrainRayCast * pRayCast;       // Pyramid traced against
+        const RAYQUERY        * pRays;          // Rays to trace
+        RAYHIT                * pHits;          // One result per ray
+        unsigned long           Count;          // Number of rays
+        bool                    OcclusionOnly;  // Only report whether each ray is blocked
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BatchTask ()
+    // Desc : Thread pool task, trace one batch of rays.
+    //-------------------------------------------------------------------------
+    void BatchTask( void * pContext, unsigned long Batch )
+    {
+        const BATCHPASS & Pass = *(const BATCHPASS*)pContext;
+        unsigned long i    = Batch * RAYCAST_BATCH_SIZE;
+        unsigned long iEnd = i + RAYCAST_BATCH_SIZE;
+
+        if ( iEnd > Pass.Count ) iEnd = Pass.Count;
+        for ( ; i < iEnd; ++i )
+        {
+            const RAYQUERY & Ray = Pass.pRays[i];
+            RAYHIT         & Hit = Pass.pHits[i];
+            Hit.Hit = Pass.pRayCast->Intersect( Ray.Origin, Ray.Direction, Ray.MaxDistance, Pass.OcclusionOnly ? NULL : &Hit );
+
+        } // Next Ray
+    }
+
+} // End Unnamed Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CTerrainRayCast () (Constructor)
+// Desc : CTerrainRayCast Class Constructor
+//-----------------------------------------------------------------------------
+CTerrainRayCast::CTerrainRayCast()
+{
+    // Reset all required values
+    m_pHeightMap  = NULL;
+    m_nWidth      = 0;
+    m_nHeight     = 0;
+    m_pLevels     = NULL;
+    m_nLevelCount = 0;
+    m_fScale[0]   = m_fScale[1] = m_fScale[2] = 1.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTerrainRayCast () (Destructor)
+// Desc : CTerrainRayCast Class Destructor
+//-----------------------------------------------------------------------------
+CTerrainRayCast::~CTerrainRayCast()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Free the pyramid.
+//-----------------------------------------------------------------------------
+void CTerrainRayCast::Release()
+{
+    if ( m_pLevels )
+    {
+        for ( unsigned long i = 0; i < m_nLevelCount; ++i )
+        {
+            if ( m_pLevels[i].pCells ) delete []m_pLevels[i].pCells;
+
+        } // Next Level
+        delete []m_pLevels;
+
+    } // End if levels
+
+    m_pHeightMap  = NULL;
+    m_nWidth      = 0;
+    m_nHeight     = 0;
+    m_pLevels     = NULL;
+    m_nLevelCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : Build every level of the pyramid for this heightmap.
+// Note : The heightmap must be at least 2 x 2 samples, and the scale positive.
+//-----------------------------------------------------------------------------
+bool CTerrainRayCast::Build( const float * pHeightMap, unsigned long Width, unsigned long Height, const float Scale[3], CThreadPool * pPool )
+{
+    unsigned long Wide, High, Level, BandCount;
+    BUILDPASS     Pass;
+
+    // Validate parameters
+    Release();
+    if ( !pHeightMap || Width < 2 || Height < 2 ) return false;
+    if ( Scale[0] <= 0.0f || Scale[1] <= 0.0f || Scale[2] <= 0.0f ) return false;
+
+    // Count the levels, halving until a single cell remains
+    m_nLevelCount = 1;
+    for ( Wide = Width - 1, High = Height - 1; Wide > 1 || High > 1; m_nLevelCount++ )
+    {
+        Wide = (Wide + 1) / 2;
+        High = (High + 1) / 2;
+
+    } // Next Level
+
+    // Allocate the levels
+    m_pLevels = new LEVEL[ m_nLevelCount ];
+    if ( !m_pLevels ) { m_nLevelCount = 0; return false; }
+
+    Wide = Width - 1; High = Height - 1;
+    for ( Level = 0; Level < m_nLevelCount; ++Level )
+    {
+        m_pLevels[Level].Wide   = Wide;
+        m_pLevels[Level].High   = High;
+        m_pLevels[Level].pCells = new RANGE[ Wide * High ];
+        Wide = (Wide + 1) / 2;
+        High = (High + 1) / 2;
+
+    } // Next Level
+
+    for ( Level = 0; Level < m_nLevelCount; ++Level )
+    {
+        if ( !m_pLevels[Level].pCells ) { Release(); return false; }
+
+    } // Next Level
+
+    // Store the source
+    m_pHeightMap = pHeightMap;
+    m_nWidth     = Width;
+    m_nHeight    = Height;
+    m_fScale[0]  = Scale[0];
+    m_fScale[1]  = Scale[1];
+    m_fScale[2]  = Scale[2];
+
+    // Build each level from the one below, in bands across the pool
+    Pass.pRayCast = this;
+    for ( Level = 0; Level < m_nLevelCount; ++Level )
+    {
+        Pass.Level = Level;
+        Pass.Wide  = m_pLevels[Level].Wide;
+        Pass.High  = m_pLevels[Level].High;
+        BandCount  = (Pass.High + RAYCAST_BAND_ROWS - 1) / RAYCAST_BAND_ROWS;
+
+        if ( pPool && BandCount > 1 )
+            pPool->Dispatch( BuildTask, &Pass, BandCount );
+        else
+            BuildCells( Level, 0, 0, Pass.Wide, Pass.High );
+
+    } // Next Level
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Rebuild the cells affected by a change to the heightmap samples
+//        between (MinX, MinZ) and (MaxX, MaxZ) inclusive.
+//-----------------------------------------------------------------------------
+void CTerrainRayCast::Update( unsigned long MinX, unsigned long MinZ, unsigned long MaxX, unsigned long MaxZ )
+{
+    unsigned long Level, EndX, EndZ;
+
+    // Validate parameters
+    if ( !m_pLevels || MinX > MaxX || MinZ > MaxZ || MinX >= m_nWidth || MinZ >= m_nHeight ) return;
+
+    // A sample is a corner of the quads either side of it (end values are exclusive)
+    if ( MinX > 0 ) MinX--;
+    if ( MinZ > 0 ) MinZ--;
+    EndX = ( MaxX + 1 < m_nWidth  ) ? MaxX + 1 : m_nWidth  - 1;
+    EndZ = ( MaxZ + 1 < m_nHeight ) ? MaxZ + 1 : m_nHeight - 1;
+
+    // Rebuild the matching cells of each level in turn
+    for ( Level = 0; Level < m_nLevelCount; ++Level )
+    {
+        BuildCells( Level, MinX, MinZ, EndX, EndZ );
+        MinX = MinX / 2;        MinZ = MinZ / 2;
+        EndX = (EndX + 1) / 2;  EndZ = (EndZ + 1) / 2;
+
+    } // Next Level
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildTask () (Private, Static)
+// Desc : Thread pool task, build one band of rows of a level.
+//-----------------------------------------------------------------------------
+void CTerrainRayCast::BuildTask( void * pContext, unsigned long Band )
+{
+    const BUILDPASS & Pass = *(const BUILDPASS*)pContext;
+    unsigned long z    = Band * RAYCAST_BAND_ROWS;
+    unsigned long zEnd = z + RAYCAST_BAND_ROWS;
+
+    if ( zEnd > Pass.High ) zEnd = Pass.High;
+    Pass.pRayCast->BuildCells( Pass.Level, 0, z, Pass.Wide, zEnd );
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildCells () (Private)
+// Desc : Build the cells of a level between (MinX, MinZ) and (EndX, EndZ)
+//        exclusive, from the heightmap (level 0) or the level below.
+//-----------------------------------------------------------------------------
+void CTerrainRayCast::BuildCells( unsigned long Level, unsigned long MinX, unsigned long MinZ, unsigned long EndX, unsigned long EndZ )
+{
+    LEVEL       & Dest = m_pLevels[Level];
+    unsigned long x, z;
+
+    if ( Level == 0 )
+    {
+        // Lowest & highest of each quad's corners
+        for ( z = MinZ; z < EndZ; ++z )
+        {
+            const float * pRow  = m_pHeightMap + z * m_nWidth;
+            RANGE       * pCell = Dest.pCells + z * Dest.Wide;
+
+            for ( x = MinX; x < EndX; ++x )
+            {
+                float a = pRow[x], b = pRow[x + 1], c = pRow[x + m_nWidth], d = pRow[x + m_nWidth + 1];
+                float Lo = ( a < b ) ? a : b, Hi = ( a > b ) ? a : b;
+                if ( c < Lo ) Lo = c;
+                if ( c > Hi ) Hi = c;
+                if ( d < Lo ) Lo = d;
+                if ( d > Hi ) Hi = d;
+                pCell[x].Min = Lo;
+                pCell[x].Max = Hi;
+
+            } // Next Quad
+
+        } // Next Row
+
+        return;
+
+    } // End if quads
+
+    // Range of each 2 x 2 group of cells below (clamped at the far edges)
+    const LEVEL & Src = m_pLevels[Level - 1];
+    for ( z = MinZ; z < EndZ; ++z )
+    {
+        unsigned long z0 = z * 2, z1 = ( z0 + 1 < Src.High ) ? z0 + 1 : z0;
+
+        for ( x = MinX; x < EndX; ++x )
+        {
+            unsigned long x0 = x * 2, x1 = ( x0 + 1 < Src.Wide ) ? x0 + 1 : x0;
+            const RANGE & a = Src.pCells[ x0 + z0 * Src.Wide ], & b = Src.pCells[ x1 + z0 * Src.Wide ];
+            const RANGE & c = Src.pCells[ x0 + z1 * Src.Wide ], & d = Src.pCells[ x1 + z1 * Src.Wide ];
+            RANGE       & Cell = Dest.pCells[ x + z * Dest.Wide ];
+
+            Cell.Min = ( a.Min < b.Min ) ? a.Min : b.Min;
+            Cell.Max = ( a.Max > b.Max ) ? a.Max : b.Max;
+            if ( c.Min < Cell.Min ) Cell.Min = c.Min;
+            if ( c.Max > Cell.Max ) Cell.Max = c.Max;
+            if ( d.Min < Cell.Min ) Cell.Min = d.Min;
+            if ( d.Max > Cell.Max ) Cell.Max = d.Max;
+
+        } // Next Cell
+
+    } // Next Row
+}
+
+//-----------------------------------------------------------------------------
+// Name : Intersect ()
+// Desc : Find where a ray first strikes the terrain within 'MaxDistance' of
+//        its origin. Pass NULL for 'pHit' if only whether or not the ray is
+//        blocked matters (line of sight), which allows the trace to finish
+//        as soon as the ray is found to pass beneath the terrain.
+// Note : A ray starting beneath the terrain strikes it immediately.
+//-----------------------------------------------------------------------------
+bool CTerrainRayCast::Intersect( const float Origin[3], const float Direction[3], float MaxDistance, RAYHIT * pHit ) const
+{
+    double O[3], D[3], Length, tStart = 0.0, tEnd = MaxDistance, Bounds[3][2];
+    long   Level, cx, cz;
+    bool   bExitX;
+    int    i;
+
+    if ( pHit ) pHit->Hit = false;
+
+    // Validate parameters
+    Length = sqrt( (double)Direction[0] * Direction[0] + (double)Direction[1] * Direction[1] + (double)Direction[2] * Direction[2] );
+    if ( !m_pLevels || Length <= 0.0 || !(MaxDistance > 0.0f) ) return false;
+
+    // Trace in heightmap space (one unit per sample, heights as stored) so that
+    // the ray parameter remains the world space distance along the ray
+    for ( i = 0; i < 3; ++i )
+    {
+        O[i] = (double)Origin[i] / m_fScale[i];
+        D[i] = (double)Direction[i] / Length / m_fScale[i];
+
+    } // Next Axis
+
+    // Clip to the heightmap, and to the space beneath its highest point
+    const LEVEL & Top = m_pLevels[ m_nLevelCount - 1 ];
+    Bounds[0][0] = 0.0;     Bounds[0][1] = (double)(m_nWidth - 1);
+    Bounds[1][0] = -HUGE_VAL; Bounds[1][1] = Top.pCells[0].Max;
+    Bounds[2][0] = 0.0;     Bounds[2][1] = (double)(m_nHeight - 1);
+
+    for ( i = 0; i < 3; ++i )
+    {
+        if ( D[i] == 0.0 )
+        {
+            if ( O[i] < Bounds[i][0] || O[i] > Bounds[i][1] ) return false;
+            continue;
+
+        } // End if parallel
+
+        double t0 = (Bounds[i][0] - O[i]) / D[i], t1 = (Bounds[i][1] - O[i]) / D[i];
+        if ( t0 > t1 ) { double Swap = t0; t0 = t1; t1 = Swap; }
+        if ( t0 > tStart ) tStart = t0;
+        if ( t1 < tEnd   ) tEnd   = t1;
+
+    } // Next Axis
+    if ( tStart > tEnd ) return false;
+
+    // Step through the cells, starting with the coarsest level
+    Level = (long)m_nLevelCount - 1;
+    double t = tStart;
+    while ( t <= tEnd )
+    {
+        const LEVEL & Cells = m_pLevels[Level];
+        double Size = (double)(1UL << Level), tExit = tEnd, tx, tz;
+
+        // Find the cell the ray is in (on a boundary, the one it is heading in
+        // to). Anything left of / above the map is clamped to the first cell.
+        double px = (O[0] + D[0] * t) / Size, pz = (O[2] + D[2] * t) / Size;
+        cx = ( px > 0.0 ) ? (long)px : 0;
+        cz = ( pz > 0.0 ) ? (long)pz : 0;
+        if ( D[0] < 0.0 && cx > 0 && (double)cx == px ) cx--;
+        if ( D[2] < 0.0 && cz > 0 && (double)cz == pz ) cz--;
+        if ( cx >= (long)Cells.Wide ) cx = (long)Cells.Wide - 1;
+        if ( cz >= (long)Cells.High ) cz = (long)Cells.High - 1;
+
+        // Where the ray leaves it. Rounding can leave us a hair short of the
+        // cell we were heading in to, in which case step across.
+        if ( D[0] != 0.0 )
+        {
+            for ( ;; )
+            {
+                tx = ((double)(D[0] > 0.0 ? cx + 1 : cx) * Size - O[0]) / D[0];
+                if ( tx > t ) break;
+                cx += ( D[0] > 0.0 ) ? 1 : -1;
+                if ( cx < 0 || cx >= (long)Cells.Wide ) return false;
+
+            } // Next Attempt
+            if ( tx < tExit ) tExit = tx;
+
+        } // End if moving across
+        bExitX = ( tExit < tEnd );
+        if ( D[2] != 0.0 )
+        {
+            for ( ;; )
+            {
+                tz = ((double)(D[2] > 0.0 ? cz + 1 : cz) * Size - O[2]) / D[2];
+                if ( tz > t ) break;
+                cz += ( D[2] > 0.0 ) ? 1 : -1;
+                if ( cz < 0 || cz >= (long)Cells.High ) return false;
+
+            } // Next Attempt
+            if ( tz < tExit ) { tExit = tz; bExitX = false; }
+
+        } // End if moving down
+
+        // Height of the ray over this cell
+        const RANGE & Cell = Cells.pCells[ cx + cz * (long)Cells.Wide ];
+        double y0 = O[1] + D[1] * t, y1 = O[1] + D[1] * tExit;
+        double yLo = ( y0 < y1 ) ? y0 : y1, yHi = ( y0 > y1 ) ? y0 : y1;
+
+        if ( yLo <= Cell.Max )
+        {
+            // Entirely beneath the cell, blocked somewhere in here
+            if ( !pHit && yHi < Cell.Min ) return true;
+
+            // Refine until we reach individual quads
+            if ( Level > 0 ) { Level--; continue; }
+
+            if ( IntersectQuad( (unsigned long)cx, (unsigned long)cz, O, D, t, tExit, pHit ) ) return true;
+
+        } // End if may touch
+
+        // Move on to the next cell
+        t = tExit;
+        if ( t >= tEnd ) break;
+
+        // Climb while the boundary crossed is also that of the parent cell
+        while ( Level + 1 < (long)m_nLevelCount )
+        {
+            long Index    = bExitX ? cx : cz;
+            bool Positive = bExitX ? ( D[0] > 0.0 ) : ( D[2] > 0.0 );
+            if ( Positive != ( (Index & 1) != 0 ) ) break;
+            cx >>= 1; cz >>= 1; Level++;
+
+        } // Next Level
+
+    } // Next Step
+
+    // No intersection
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntersectQuad () (Private)
+// Desc : Intersect the heightmap space ray with the two triangles of a quad,
+//        between the distances at which it enters and leaves the quad.
+//-----------------------------------------------------------------------------
+bool CTerrainRayCast::IntersectQuad( unsigned long x, unsigned long z, const double Origin[3], const double Direction[3],
+                                     double tEnter, double tExit, RAYHIT * pHit ) const
+{
+    const float * pSample = m_pHeightMap + x + z * m_nWidth;
+    double TL = pSample[0], TR = pSample[1], BL = pSample[m_nWidth], BR = pSample[m_nWidth + 1];
+    double u0 = Origin[0] - (double)x, v0 = Origin[2] - (double)z, du = Direction[0], dv = Direction[2];
+    double tSplit[3], DeltaU = 0.0, DeltaV = 0.0;
+    int    Segments = 1, s;
+
+    // Split where the ray crosses the diagonal (u = v)
+    tSplit[0] = tEnter;
+    if ( du != dv )
+    {
+        double tDiagonal = (v0 - u0) / (du - dv);
+        if ( tDiagonal > tEnter && tDiagonal < tExit ) tSplit[Segments++] = tDiagonal;
+
+    } // End if crosses diagonal
+    tSplit[Segments] = tExit;
+
+    for ( s = 0; s < Segments; ++s )
+    {
+        double ta = tSplit[s], tb = tSplit[s + 1], tm = (ta + tb) * 0.5;
+        double tHit;
+
+        // The triangle this part of the ray is over, as a plane h = TL + u * DeltaU + v * DeltaV
+        if ( u0 + du * tm < v0 + dv * tm )
+        {
+            DeltaU = BR - BL; DeltaV = BL - TL;
+
+        } // End if Left Triangle
+        else
+        {
+            DeltaU = TR - TL; DeltaV = BR - TR;
+
+        } // End if Right Triangle
+
+        // Height of the ray above the plane at either end
+        double fa = Origin[1] + Direction[1] * ta - (TL + (u0 + du * ta) * DeltaU + (v0 + dv * ta) * DeltaV);
+        double fb = Origin[1] + Direction[1] * tb - (TL + (u0 + du * tb) * DeltaU + (v0 + dv * tb) * DeltaV);
+
+        if ( fa <= 0.0 )
+            tHit = ta;
+        else if ( fb <= 0.0 )
+            tHit = ta + (tb - ta) * fa / (fa - fb);
+        else
+            continue;
+
+        // Fill out the hit details if required
+        if ( pHit )
+        {
+            double DeltaX = DeltaU * m_fScale[1] / m_fScale[0], DeltaZ = DeltaV * m_fScale[1] / m_fScale[2];
+            double Length = sqrt( DeltaX * DeltaX + 1.0 + DeltaZ * DeltaZ );
+
+            pHit->Hit         = true;
+            pHit->Distance    = (float)tHit;
+            pHit->Position[0] = (float)((Origin[0] + Direction[0] * tHit) * m_fScale[0]);
+            pHit->Position[1] = (float)((Origin[1] + Direction[1] * tHit) * m_fScale[1]);
+            pHit->Position[2] = (float)((Origin[2] + Direction[2] * tHit) * m_fScale[2]);
+            pHit->Normal[0]   = (float)(-DeltaX / Length);
+            pHit->Normal[1]   = (float)(1.0 / Length);
+            pHit->Normal[2]   = (float)(-DeltaZ / Length);
+            pHit->QuadX       = x;
+            pHit->QuadZ       = z;
+
+        } // End if details
+
+        return true;
+
+    } // Next Segment
+
+    // Missed both triangles
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntersectSegment ()
+// Desc : Find where the line segment from 'Start' to 'End' first strikes the
+//        terrain (NULL 'pHit' as for Intersect).
+//-----------------------------------------------------------------------------
+bool CTerrainRayCast::IntersectSegment( const float Start[3], const float End[3], RAYHIT * pHit ) const
+{
+    float Direction[3] = { End[0] - Start[0], End[1] - Start[1], End[2] - Start[2] };
+    float Length       = sqrtf( Direction[0] * Direction[0] + Direction[1] * Direction[1] + Direction[2] * Direction[2] );
+
+    if ( pHit ) pHit->Hit = false;
+    if ( Length <= 0.0f ) return false;
+    return Intersect( Start, Direction, Length, pHit );
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntersectBatch ()
+// Desc : Intersect many rays at once, spread across the thread pool if one
+//        is supplied. Returns the number of rays which struck the terrain.
+//        With 'OcclusionOnly' set only the 'Hit' member of each result is
+//        filled in (line of sight checks).
+//-----------------------------------------------------------------------------
+unsigned long CTerrainRayCast::IntersectBatch( const RAYQUERY * pRays, unsigned long Count, RAYHIT * pHits, bool OcclusionOnly, CThreadPool * pPool ) const
+{
+    unsigned long i, BatchCount, HitCount = 0;
+    BATCHPASS     Pass;
+
+    // Validate parameters
+    if ( !pRays || !pHits || Count == 0 ) return 0;
+
+    // Describe the pass
+    Pass.pRayCast      = this;
+    Pass.pRays         = pRays;
+    Pass.pHits         = pHits;
+    Pass.Count         = Count;
+    Pass.OcclusionOnly = OcclusionOnly;
+
+    // Spread the batches across the pool if we have one
+    BatchCount = (Count + RAYCAST_BATCH_SIZE - 1) / RAYCAST_BATCH_SIZE;
+    if ( pPool && BatchCount > 1 )
+    {
+        pPool->Dispatch( BatchTask, &Pass, BatchCount );
+
+    } // End if threaded
+    else
+    {
+        for ( i = 0; i < BatchCount; ++i ) BatchTask( &Pass, i );
+
+    } // End if single threaded
+
+    // Count the hits
+    for ( i = 0; i < Count; ++i ) if ( pHits[i].Hit ) HitCount++;
+    return HitCount;
+}
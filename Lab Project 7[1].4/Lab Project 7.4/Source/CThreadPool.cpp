@@ -0,0 +1,321 @@
+//-----------------------------------------------------------------------------
+// File: CThreadPool.cpp
+//
+// Desc: Simple fork / join thread pool. A batch of independent tasks is
+//       dispatched across a set of persistent worker threads (plus the
+//       calling thread), and the call returns once every task has completed.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CThreadPool Specific Includes
+//-----------------------------------------------------------------------------
+#include "../Includes/CThreadPool.h"
+#include <stddef.h>
+
+#if !defined(_WIN32)
+    #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Module Local Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : AtomicIncrement ()
+    // Desc : Increments the value and returns the value held beforehand.
+    //-------------------------------------------------------------------------
+    inline long AtomicIncrement( volatile long * pValue )
+    {
+#if defined(_WIN32)
+        return InterlockedIncrement( (LONG*)pValue ) - 1;
+#else
+        return __sync_fetch_and_add( pValue, 1 );
+#endif
+    }
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : CThreadPool () (Constructor)
+// Desc : CThreadPool Class Constructor
+//-----------------------------------------------------------------------------
+CThreadPool::CThreadPool()
+{
+	// Reset / Clear all required values
+    m_nThreadCount  = 1;
+    m_nWorkerCount  = 0;
+    m_bShutdown     = false;
+    m_pTask         = NULL;
+    m_pContext      = NULL;
+    m_nTaskCount    = 0;
+    m_nNextTask     = 0;
+    m_nBusyWorkers  = 0;
+    m_pThreads      = NULL;
+
+#if defined(_WIN32)
+    m_hStart        = NULL;
+    m_hDone         = NULL;
+#else
+    m_nGeneration   = 0;
+    pthread_mutex_init( &m_Mutex, NULL );
+    pthread_cond_init( &m_StartCond, NULL );
+    pthread_cond_init( &m_DoneCond, NULL );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CThreadPool () (Destructor)
+// Desc : CThreadPool Class Destructor
+//-----------------------------------------------------------------------------
+CThreadPool::~CThreadPool()
+{
+    // Shut down the worker threads
+    Release();
+
+#if !defined(_WIN32)
+    pthread_cond_destroy( &m_DoneCond );
+    pthread_cond_destroy( &m_StartCond );
+    pthread_mutex_destroy( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetProcessorCount () (Static)
+// Desc : Retrieve the number of logical processors in the system.
+//-----------------------------------------------------------------------------
+unsigned long CThreadPool::GetProcessorCount( )
+{
+#if defined(_WIN32)
+    SYSTEM_INFO Info;
+    GetSystemInfo( &Info );
+    return (Info.dwNumberOfProcessors > 0) ? Info.dwNumberOfProcessors : 1;
+#else
+    long Count = sysconf( _SC_NPROCESSORS_ONLN );
+    return (Count > 0) ? (unsigned long)Count : 1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Create the worker threads. The count includes the calling thread,
+//        a value of 0 uses one thread per logical processor.
+//-----------------------------------------------------------------------------
+bool CThreadPool::Create( unsigned long ThreadCount )
+{
+    // Release any previous workers
+    Release();
+
+    // Calculate thread counts
+    if ( ThreadCount == 0 ) ThreadCount = GetProcessorCount();
+    m_nThreadCount = ThreadCount;
+    m_bShutdown    = false;
+
+    // Single threaded? Nothing else to do
+    if ( ThreadCount <= 1 ) { m_nThreadCount = 1; return true; }
+
+#if defined(_WIN32)
+    // Create synchronization objects
+    m_hStart = CreateSemaphore( NULL, 0, ThreadCount, NULL );
+    m_hDone  = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if ( !m_hStart || !m_hDone ) { Release(); return false; }
+
+    // Spawn the workers
+    m_pThreads = new HANDLE[ ThreadCount - 1 ];
+    if ( !m_pThreads ) { Release(); return false; }
+    for ( m_nWorkerCount = 0; m_nWorkerCount < ThreadCount - 1; m_nWorkerCount++ )
+    {
+        m_pThreads[ m_nWorkerCount ] = CreateThread( NULL, 0, WorkerProc, this, 0, NULL );
+        if ( !m_pThreads[ m_nWorkerCount ] ) { Release(); return false; }
+
+    } // Next Worker
+#else
+    // Workers start out waiting for the first batch (generation 1)
+    m_nGeneration = 0;
+
+    // Spawn the workers
+    m_pThreads = new pthread_t[ ThreadCount - 1 ];
+    if ( !m_pThreads ) { Release(); return false; }
+    for ( m_nWorkerCount = 0; m_nWorkerCount < ThreadCount - 1; m_nWorkerCount++ )
+    {
+        if ( pthread_create( &m_pThreads[ m_nWorkerCount ], NULL, WorkerProc, this ) != 0 ) { Release(); return false; }
+
+    } // Next Worker
+#endif
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Signal all worker threads to exit and wait for them to do so.
+//-----------------------------------------------------------------------------
+void CThreadPool::Release()
+{
+    unsigned long i;
+
+#if defined(_WIN32)
+    // Wake every worker with the shutdown flag set
+    m_bShutdown = true;
+    if ( m_hStart && m_nWorkerCount ) ReleaseSemaphore( m_hStart, m_nWorkerCount, NULL );
+
+    // Wait for them to exit
+    for ( i = 0; i < m_nWorkerCount; i++ )
+    {
+        WaitForSingleObject( m_pThreads[i], INFINITE );
+        CloseHandle( m_pThreads[i] );
+
+    } // Next Worker
+
+    // Release synchronization objects
+    if ( m_hStart ) CloseHandle( m_hStart );
+    if ( m_hDone  ) CloseHandle( m_hDone );
+    m_hStart = NULL;
+    m_hDone  = NULL;
+#else
+    // Wake every worker with the shutdown flag set
+    pthread_mutex_lock( &m_Mutex );
+    m_bShutdown = true;
+    pthread_cond_broadcast( &m_StartCond );
+    pthread_mutex_unlock( &m_Mutex );
+
+    // Wait for them to exit
+    for ( i = 0; i < m_nWorkerCount; i++ ) pthread_join( m_pThreads[i], NULL );
+#endif
+
+    // Free the thread array
+    if ( m_pThreads ) delete []m_pThreads;
+
+    // Clear variables
+    m_pThreads      = NULL;
+    m_nWorkerCount  = 0;
+    m_nThreadCount  = 1;
+    m_bShutdown     = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Dispatch ()
+// Desc : Run pTask( pContext, i ) for every i in [0, TaskCount), returning
+//        once all of them have completed. The calling thread takes part.
+//-----------------------------------------------------------------------------
+void CThreadPool::Dispatch( THREADTASK pTask, void * pContext, unsigned long TaskCount )
+{
+    // Validate
+    if ( !pTask || TaskCount == 0 ) return;
+
+    // Run inline if there is nobody to share the work with
+    if ( m_nWorkerCount == 0 || TaskCount == 1 )
+    {
+        for ( unsigned long i = 0; i < TaskCount; i++ ) pTask( pContext, i );
+        return;
+
+    } // End if single threaded
+
+    // Describe the batch
+    m_pTask        = pTask;
+    m_pContext     = pContext;
+    m_nTaskCount   = (long)TaskCount;
+    m_nNextTask    = 0;
+    m_nBusyWorkers = (long)m_nWorkerCount;
+
+#if defined(_WIN32)
+    // Release the workers
+    ResetEvent( m_hDone );
+    ReleaseSemaphore( m_hStart, m_nWorkerCount, NULL );
+
+    // Help out, then wait for the stragglers
+    RunTasks();
+    WaitForSingleObject( m_hDone, INFINITE );
+#else
+    // Release the workers
+    pthread_mutex_lock( &m_Mutex );
+    m_nGeneration++;
+    pthread_cond_broadcast( &m_StartCond );
+    pthread_mutex_unlock( &m_Mutex );
+
+    // Help out, then wait for the stragglers
+    RunTasks();
+    pthread_mutex_lock( &m_Mutex );
+    while ( m_nBusyWorkers > 0 ) pthread_cond_wait( &m_DoneCond, &m_Mutex );
+    pthread_mutex_unlock( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunTasks () (Private)
+// Desc : Claim and execute tasks until none remain in the current batch.
+//-----------------------------------------------------------------------------
+void CThreadPool::RunTasks()
+{
+    long Task;
+
+    while ( (Task = AtomicIncrement( &m_nNextTask )) < m_nTaskCount )
+    {
+        m_pTask( m_pContext, (unsigned long)Task );
+
+    } // Next Task
+}
+
+//-----------------------------------------------------------------------------
+// Name : WorkerLoop () (Private)
+// Desc : Body of each worker thread. Waits for a batch, helps process it,
+//        and reports completion.
+//-----------------------------------------------------------------------------
+void CThreadPool::WorkerLoop()
+{
+#if defined(_WIN32)
+    for ( ; ; )
+    {
+        // Wait for work (or shutdown)
+        WaitForSingleObject( m_hStart, INFINITE );
+        if ( m_bShutdown ) break;
+
+        RunTasks();
+
+        // Last one out signals the dispatcher
+        if ( InterlockedDecrement( (LONG*)&m_nBusyWorkers ) == 0 ) SetEvent( m_hDone );
+
+    } // Next Batch
+#else
+    unsigned long Generation = 0;
+
+    pthread_mutex_lock( &m_Mutex );
+    for ( ; ; )
+    {
+        // Wait for work (or shutdown)
+        while ( m_nGeneration == Generation && !m_bShutdown ) pthread_cond_wait( &m_StartCond, &m_Mutex );
+        if ( m_bShutdown ) break;
+        Generation = m_nGeneration;
+        pthread_mutex_unlock( &m_Mutex );
+
+        RunTasks();
+
+        // Last one out signals the dispatcher
+        pthread_mutex_lock( &m_Mutex );
+        if ( --m_nBusyWorkers == 0 ) pthread_cond_signal( &m_DoneCond );
+
+    } // Next Batch
+    pthread_mutex_unlock( &m_Mutex );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : WorkerProc () (Private, Static)
+// Desc : Thread entry point, routes through to the owning pool.
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+DWORD WINAPI CThreadPool::WorkerProc( LPVOID pParam )
+{
+    ((CThreadPool*)pParam)->WorkerLoop();
+    return 0;
+}
+#else
+void * CThreadPool::WorkerProc( void * pParam )
+{
+    ((CThreadPool*)pParam)->WorkerLoop();
+    return NULL;
+}
+#endif
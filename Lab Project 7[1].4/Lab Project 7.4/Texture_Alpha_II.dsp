@@ -43,7 +43,7 @@ RSC=rc.exe
 # PROP Ignore_Export_Lib 0
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
-# ADD CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
+# ADD CPP /nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
 # SUBTRACT CPP /Fr
 # ADD BASE MTL /nologo /D "NDEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "NDEBUG" /mktyplib203 /win32
@@ -70,7 +70,7 @@ LINK32=link.exe
 # PROP Ignore_Export_Lib 0
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
-# ADD CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
+# ADD CPP /nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
 # SUBTRACT CPP /Fr
 # ADD BASE MTL /nologo /D "_DEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "_DEBUG" /mktyplib203 /win32
@@ -110,10 +110,26 @@ SOURCE=.\Source\CGameApp.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CHeightMap.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CHeightMapFilter.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CNormalMap.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CObject.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CProfiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CPlayer.cpp
 # End Source File
 # Begin Source File
@@ -122,6 +138,34 @@ SOURCE=.\Source\CTerrain.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Source\CTerrainLOD.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTerrainPager.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTerrainQuadTree.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTerrainRayCast.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTerrainBrush.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CTerrainCache.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Source\CThreadPool.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Source\CTimer.cpp
 # End Source File
 # Begin Source File
@@ -150,10 +194,26 @@ SOURCE=.\Includes\CGameApp.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CHeightMap.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CHeightMapFilter.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CNormalMap.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CObject.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CProfiler.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CPlayer.h
 # End Source File
 # Begin Source File
@@ -162,6 +222,34 @@ SOURCE=.\Includes\CTerrain.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Includes\CTerrainLOD.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTerrainPager.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTerrainQuadTree.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTerrainRayCast.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTerrainBrush.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CTerrainCache.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Includes\CThreadPool.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Includes\CTimer.h
 # End Source File
 # Begin Source File